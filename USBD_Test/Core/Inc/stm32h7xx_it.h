@@ -58,7 +58,8 @@ void PendSV_Handler(void);
 void SysTick_Handler(void);
 void OTG_HS_IRQHandler(void);
 /* USER CODE BEGIN EFP */
-
+void OTG_HS_EP1_OUT_IRQHandler(void);
+void OTG_HS_EP1_IN_IRQHandler(void);
 /* USER CODE END EFP */
 
 #ifdef __cplusplus
@@ -21,7 +21,7 @@
 #include "usb_otg.h"
 
 /* USER CODE BEGIN 0 */
-
+#include "usbd_conf.h"
 /* USER CODE END 0 */
 
 PCD_HandleTypeDef hpcd_USB_OTG_HS;
@@ -144,7 +144,13 @@ void HAL_PCD_MspInit(PCD_HandleTypeDef* pcdHandle)
     HAL_NVIC_SetPriority(OTG_HS_IRQn, 0, 0);
     HAL_NVIC_EnableIRQ(OTG_HS_IRQn);
   /* USER CODE BEGIN USB_OTG_HS_MspInit 1 */
-
+#if (USBD_LL_DEDICATED_EP1 == 1U)
+    /* Same priority as the shared vector, the stack is not reentrant */
+    HAL_NVIC_SetPriority(OTG_HS_EP1_OUT_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(OTG_HS_EP1_OUT_IRQn);
+    HAL_NVIC_SetPriority(OTG_HS_EP1_IN_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(OTG_HS_EP1_IN_IRQn);
+#endif
   /* USER CODE END USB_OTG_HS_MspInit 1 */
   }
 }
@@ -189,7 +195,10 @@ void HAL_PCD_MspDeInit(PCD_HandleTypeDef* pcdHandle)
     /* USB_OTG_HS interrupt Deinit */
     HAL_NVIC_DisableIRQ(OTG_HS_IRQn);
   /* USER CODE BEGIN USB_OTG_HS_MspDeInit 1 */
-
+#if (USBD_LL_DEDICATED_EP1 == 1U)
+    HAL_NVIC_DisableIRQ(OTG_HS_EP1_OUT_IRQn);
+    HAL_NVIC_DisableIRQ(OTG_HS_EP1_IN_IRQn);
+#endif
   /* USER CODE END USB_OTG_HS_MspDeInit 1 */
   }
 }
@@ -0,0 +1,667 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cdc_bench.c
+  * @brief   CDC ACM benchmark personality: sink, source, echo, round trip
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cdc_bench.h"
+
+#if (USBD_USE_CDC_BENCH == 1U)
+
+/*
+  The benchmark is driven through the data channel itself, so any host
+  able to open the tty can run it. After each DTR change a channel waits
+  for a command block: a mode command starts the mode and clears the
+  counters, STATS answers with the counters of the last mode. The host
+  ends a mode by toggling DTR (closing the port does it).
+
+  Received pool buffers are kept in order until consumed. The modes that
+  answer (echo, round trip, stats) only take the bytes the transmit ring
+  has room for, the rest of the buffer waits for USBD_CDC_Bench_Process
+  and the OUT endpoint NAKs once the pool is held. Source fills the ring
+  from USBD_CDC_Bench_Process with a 256 byte counting pattern, the one
+  sink checks.
+
+  Records are little endian and start with a 32-bit sequence number; a
+  number ahead of the expected one counts the skipped ones as gaps, one
+  behind counts an error.
+*/
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  USBD_HandleTypeDef *pdev;
+  uint8_t *RxBuf[CDC_ACM_RX_POOL_DEPTH];    /* pool buffers not consumed yet */
+  uint32_t RxLen[CDC_ACM_RX_POOL_DEPTH];
+  uint32_t RxOff;                           /* bytes of RxBuf[RxFirst] consumed */
+  uint8_t RxFirst;
+  uint8_t RxCount;
+  uint8_t Mode;                             /* 0 while waiting for a command */
+  uint8_t Dtr;
+  uint8_t SeqValid;                         /* Seq was set by a first record */
+  uint8_t Stalled;                          /* the ring is full since the last stall */
+  uint8_t Endless;                          /* source without a byte limit */
+  uint32_t Arg;                             /* record size, or bytes left to source */
+  uint32_t Pattern;                         /* pattern position of sink and source */
+  uint32_t Seq;                             /* next sequence number expected */
+  uint32_t Last;                            /* tick of the last byte moved */
+  uint32_t TickAcc;                         /* ticks not counted in Elapsed yet */
+  uint32_t RecOff;                          /* bytes of the record or command so far */
+  uint32_t RecTick;                         /* tick of its first byte */
+  uint32_t Rec[USBD_CDC_BENCH_CMD_SIZE / 4U];
+  USBD_CDC_Bench_StatsTypeDef Stats;
+} USBD_CDC_Bench_TypeDef;
+
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static USBD_CDC_Bench_TypeDef USBD_CDC_Bench[NUMBER_OF_CDC];
+
+/* Counting pattern, sent from any offset */
+static uint8_t USBD_CDC_Bench_Pattern[256];
+
+/* Private function prototypes -----------------------------------------------*/
+static void USBD_CDC_Bench_Run(uint8_t ch);
+static uint32_t USBD_CDC_Bench_Consume(uint8_t ch, const uint8_t *pbuf, uint32_t len);
+static uint32_t USBD_CDC_Bench_Echo(uint8_t ch, const uint8_t *pbuf, uint32_t len);
+static uint8_t USBD_CDC_Bench_Complete(uint8_t ch);
+static void USBD_CDC_Bench_Source(uint8_t ch);
+static uint8_t USBD_CDC_Bench_Room(uint8_t ch, uint32_t len);
+static void USBD_CDC_Bench_Seq(USBD_CDC_Bench_TypeDef *pb, uint32_t seq);
+static void USBD_CDC_Bench_Moved(USBD_CDC_Bench_TypeDef *pb);
+static void USBD_CDC_Bench_Drop(uint8_t ch);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  USBD_CDC_Bench_Attach
+  *         Run the benchmark on a CDC ACM channel, before the device starts
+  * @param  ch: CDC channel
+  * @param  pdev: device handle
+  * @retval status
+  */
+USBD_StatusTypeDef USBD_CDC_Bench_Attach(uint8_t ch, USBD_HandleTypeDef *pdev)
+{
+  if ((ch >= NUMBER_OF_CDC) || (pdev == NULL))
+  {
+    return USBD_FAIL;
+  }
+
+  (void)USBD_memset(&USBD_CDC_Bench[ch], 0, sizeof(USBD_CDC_Bench_TypeDef));
+  USBD_CDC_Bench[ch].pdev = pdev;
+  USBD_CDC_Bench[ch].Stats.TickFreq = USBD_LL_GetTimestampFreq();
+
+  for (uint32_t i = 0U; i < sizeof(USBD_CDC_Bench_Pattern); i++)
+  {
+    USBD_CDC_Bench_Pattern[i] = (uint8_t)i;
+  }
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_CDC_Bench_GetStats
+  *         Read the counters of the last mode of a channel on the device
+  * @param  ch: CDC channel
+  * @param  pstats: counters out
+  * @retval status
+  */
+uint8_t USBD_CDC_Bench_GetStats(uint8_t ch, USBD_CDC_Bench_StatsTypeDef *pstats)
+{
+  uint32_t primask;
+
+  if ((ch >= NUMBER_OF_CDC) || (USBD_CDC_Bench[ch].pdev == NULL) || (pstats == NULL))
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  USBD_ENTER_CRITICAL(primask);
+  *pstats = USBD_CDC_Bench[ch].Stats;
+  USBD_EXIT_CRITICAL(primask);
+
+  return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_CDC_Bench_Init
+  *         Wait for a command on the new configuration
+  * @param  ch: CDC channel
+  * @retval None
+  */
+void USBD_CDC_Bench_Init(uint8_t ch)
+{
+  USBD_CDC_Bench_TypeDef *pb = &USBD_CDC_Bench[ch];
+
+  if (pb->pdev == NULL)
+  {
+    return;
+  }
+
+  pb->Mode = 0U;
+  pb->Dtr = 0U;
+  pb->RecOff = 0U;
+  pb->RxCount = 0U;
+  pb->RxOff = 0U;
+}
+
+/**
+  * @brief  USBD_CDC_Bench_DeInit
+  *         Forget the pool buffers, the class takes them back
+  * @param  ch: CDC channel
+  * @retval None
+  */
+void USBD_CDC_Bench_DeInit(uint8_t ch)
+{
+  USBD_CDC_Bench_TypeDef *pb = &USBD_CDC_Bench[ch];
+
+  pb->Mode = 0U;
+  pb->RxCount = 0U;
+  pb->RxOff = 0U;
+}
+
+/**
+  * @brief  USBD_CDC_Bench_LineState
+  *         A DTR change ends the mode, the data not consumed is dropped and
+  *         the channel waits for a command
+  * @param  ch: CDC channel
+  * @retval None
+  */
+void USBD_CDC_Bench_LineState(uint8_t ch)
+{
+  USBD_CDC_Bench_TypeDef *pb = &USBD_CDC_Bench[ch];
+  uint8_t dtr;
+
+  if (pb->pdev == NULL)
+  {
+    return;
+  }
+
+  dtr = ((USBD_CDC_GetLineState(ch, pb->pdev) & CDC_CONTROL_LINE_DTR) != 0U) ? 1U : 0U;
+
+  if (dtr != pb->Dtr)
+  {
+    pb->Dtr = dtr;
+    pb->Mode = 0U;
+    pb->RecOff = 0U;
+    USBD_CDC_Bench_Drop(ch);
+  }
+}
+
+/**
+  * @brief  USBD_CDC_Bench_Receive
+  *         Take a received pool buffer of a benchmark channel
+  * @param  ch: CDC channel
+  * @param  pbuf: pool buffer, given back once consumed
+  * @param  length: number of bytes received
+  * @retval USBD_OK when the channel runs the benchmark
+  */
+USBD_StatusTypeDef USBD_CDC_Bench_Receive(uint8_t ch, uint8_t *pbuf, uint32_t length)
+{
+  USBD_CDC_Bench_TypeDef *pb;
+  uint32_t primask;
+  uint8_t idx;
+
+  if ((ch >= NUMBER_OF_CDC) || (USBD_CDC_Bench[ch].pdev == NULL))
+  {
+    return USBD_FAIL;
+  }
+
+  pb = &USBD_CDC_Bench[ch];
+
+  USBD_ENTER_CRITICAL(primask);
+
+  idx = (uint8_t)((pb->RxFirst + pb->RxCount) % CDC_ACM_RX_POOL_DEPTH);
+  pb->RxBuf[idx] = pbuf;
+  pb->RxLen[idx] = length;
+  pb->RxCount++;
+
+  USBD_CDC_Bench_Run(ch);
+
+  USBD_EXIT_CRITICAL(primask);
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_CDC_Bench_Process
+  *         Refill the transmit rings of the source channels and consume the
+  *         data that waited for room, from the main loop
+  * @retval None
+  */
+void USBD_CDC_Bench_Process(void)
+{
+  uint32_t primask;
+
+  for (uint8_t ch = 0U; ch < NUMBER_OF_CDC; ch++)
+  {
+    if (USBD_CDC_Bench[ch].pdev != NULL)
+    {
+      USBD_ENTER_CRITICAL(primask);
+      USBD_CDC_Bench_Run(ch);
+      USBD_EXIT_CRITICAL(primask);
+    }
+  }
+}
+
+/**
+  * @brief  USBD_CDC_Bench_Run
+  *         Send the source data and consume the received buffers in order,
+  *         until the transmit ring is full. Called with interrupts masked.
+  * @param  ch: CDC channel
+  * @retval None
+  */
+static void USBD_CDC_Bench_Run(uint8_t ch)
+{
+  USBD_CDC_Bench_TypeDef *pb = &USBD_CDC_Bench[ch];
+  uint8_t *pbuf;
+  uint32_t used;
+
+  if (pb->Mode == USBD_CDC_BENCH_SOURCE)
+  {
+    USBD_CDC_Bench_Source(ch);
+  }
+
+  while (pb->RxCount != 0U)
+  {
+    pbuf = pb->RxBuf[pb->RxFirst];
+    used = USBD_CDC_Bench_Consume(ch, &pbuf[pb->RxOff], pb->RxLen[pb->RxFirst] - pb->RxOff);
+    pb->RxOff += used;
+
+    if (pb->RxOff >= pb->RxLen[pb->RxFirst])
+    {
+      pb->RxFirst = (uint8_t)((pb->RxFirst + 1U) % CDC_ACM_RX_POOL_DEPTH);
+      pb->RxCount--;
+      pb->RxOff = 0U;
+      (void)USBD_CDC_ReleaseRxBuffer(ch, pb->pdev, pbuf);
+    }
+    else if (used == 0U)
+    {
+      /* Waits for room in the transmit ring */
+      break;
+    }
+    else
+    {
+      /* A command changed the mode, the rest goes to the new one */
+    }
+  }
+}
+
+/**
+  * @brief  USBD_CDC_Bench_Consume
+  *         Run received bytes through the mode of a channel
+  * @param  ch: CDC channel
+  * @param  pbuf: received bytes
+  * @param  len: number of bytes
+  * @retval number of bytes taken, less than len when the mode waits for
+  *         room or changed
+  */
+static uint32_t USBD_CDC_Bench_Consume(uint8_t ch, const uint8_t *pbuf, uint32_t len)
+{
+  USBD_CDC_Bench_TypeDef *pb = &USBD_CDC_Bench[ch];
+  uint8_t mode = pb->Mode;
+  uint32_t i = 0U;
+
+  switch (mode)
+  {
+  case USBD_CDC_BENCH_SINK:
+    for (i = 0U; i < len; i++)
+    {
+      /* Resynchronized on the byte received */
+      if (pbuf[i] != (uint8_t)pb->Pattern)
+      {
+        pb->Stats.Errors++;
+        pb->Pattern = pbuf[i];
+      }
+
+      pb->Pattern++;
+    }
+
+    pb->Stats.RxBytes += len;
+    USBD_CDC_Bench_Moved(pb);
+    break;
+
+  case USBD_CDC_BENCH_ECHO:
+    i = USBD_CDC_Bench_Echo(ch, pbuf, len);
+    break;
+
+  case USBD_CDC_BENCH_SOURCE:
+    /* The host is not expected to send, its data is dropped */
+    i = len;
+    break;
+
+  default:
+    /* Command blocks and round trip records */
+    while (pb->Mode == mode)
+    {
+      if (pb->RecOff == ((mode == 0U) ? USBD_CDC_BENCH_CMD_SIZE : USBD_CDC_BENCH_RT_SIZE))
+      {
+        if (USBD_CDC_Bench_Complete(ch) == 0U)
+        {
+          break;
+        }
+
+        continue;
+      }
+
+      if (i == len)
+      {
+        break;
+      }
+
+      if (pb->RecOff == 0U)
+      {
+        pb->RecTick = USBD_LL_GetTimestamp();
+      }
+
+      ((uint8_t *)pb->Rec)[pb->RecOff] = pbuf[i];
+      pb->RecOff++;
+      i++;
+    }
+
+    if (mode != 0U)
+    {
+      pb->Stats.RxBytes += i;
+    }
+    break;
+  }
+
+  return i;
+}
+
+/**
+  * @brief  USBD_CDC_Bench_Echo
+  *         Send received records back as they are, checking the sequence
+  *         number they start with
+  * @param  ch: CDC channel
+  * @param  pbuf: received bytes
+  * @param  len: number of bytes
+  * @retval number of bytes echoed
+  */
+static uint32_t USBD_CDC_Bench_Echo(uint8_t ch, const uint8_t *pbuf, uint32_t len)
+{
+  USBD_CDC_Bench_TypeDef *pb = &USBD_CDC_Bench[ch];
+  uint32_t n = MIN(len, USBD_CDC_TxFree(ch, pb->pdev));
+  uint32_t off = 0U;
+  uint32_t skip;
+
+  /* Counts a stall when the ring cannot take it all */
+  (void)USBD_CDC_Bench_Room(ch, len);
+
+  if (n == 0U)
+  {
+    return 0U;
+  }
+
+  while (off < n)
+  {
+    if (pb->RecOff < 4U)
+    {
+      ((uint8_t *)pb->Rec)[pb->RecOff] = pbuf[off];
+      pb->RecOff++;
+      off++;
+
+      if (pb->RecOff == 4U)
+      {
+        USBD_CDC_Bench_Seq(pb, pb->Rec[0]);
+      }
+    }
+    else
+    {
+      skip = MIN(n - off, pb->Arg - pb->RecOff);
+      pb->RecOff += skip;
+      off += skip;
+    }
+
+    if (pb->RecOff == pb->Arg)
+    {
+      pb->RecOff = 0U;
+    }
+  }
+
+  (void)USBD_CDC_TxWrite(ch, pb->pdev, pbuf, n);
+  pb->Stats.RxBytes += n;
+  pb->Stats.TxBytes += n;
+  USBD_CDC_Bench_Moved(pb);
+
+  return n;
+}
+
+/**
+  * @brief  USBD_CDC_Bench_Complete
+  *         Act on a complete command block or round trip record
+  * @param  ch: CDC channel
+  * @retval 1 when done, 0 when the answer waits for room
+  */
+static uint8_t USBD_CDC_Bench_Complete(uint8_t ch)
+{
+  USBD_CDC_Bench_TypeDef *pb = &USBD_CDC_Bench[ch];
+  uint32_t magic = USBD_CDC_BENCH_STATS_MAGIC;
+  uint32_t now;
+  uint32_t lat;
+  uint8_t cmd;
+
+  if (pb->Mode == USBD_CDC_BENCH_ROUNDTRIP)
+  {
+    if (USBD_CDC_Bench_Room(ch, USBD_CDC_BENCH_RT_SIZE) == 0U)
+    {
+      return 0U;
+    }
+
+    now = USBD_LL_GetTimestamp();
+    lat = now - pb->RecTick;
+    USBD_CDC_Bench_Seq(pb, pb->Rec[0]);
+
+    pb->Rec[2] = pb->RecTick;
+    pb->Rec[3] = now;
+    (void)USBD_CDC_TxWrite(ch, pb->pdev, (uint8_t *)pb->Rec, USBD_CDC_BENCH_RT_SIZE);
+
+    pb->Stats.TxBytes += USBD_CDC_BENCH_RT_SIZE;
+    pb->Stats.LatMin = MIN(pb->Stats.LatMin, lat);
+    pb->Stats.LatMax = MAX(pb->Stats.LatMax, lat);
+    pb->Stats.LatSum += lat;
+    USBD_CDC_Bench_Moved(pb);
+    pb->RecOff = 0U;
+
+    return 1U;
+  }
+
+  /* Out of step with the host, look for the magic one byte further */
+  if (pb->Rec[0] != USBD_CDC_BENCH_CMD_MAGIC)
+  {
+    (void)USBD_memcpy(pb->Rec, &((uint8_t *)pb->Rec)[1], USBD_CDC_BENCH_CMD_SIZE - 1U);
+    pb->RecOff = USBD_CDC_BENCH_CMD_SIZE - 1U;
+    pb->Stats.Errors++;
+
+    return 1U;
+  }
+
+  cmd = ((uint8_t *)pb->Rec)[4];
+
+  switch (cmd)
+  {
+  case USBD_CDC_BENCH_SINK:
+  case USBD_CDC_BENCH_SOURCE:
+  case USBD_CDC_BENCH_ECHO:
+  case USBD_CDC_BENCH_ROUNDTRIP:
+    (void)USBD_memset(&pb->Stats, 0, sizeof(pb->Stats));
+    pb->Stats.Mode = cmd;
+    pb->Stats.TickFreq = USBD_LL_GetTimestampFreq();
+    pb->Stats.LatMin = 0xFFFFFFFFU;
+    pb->Arg = (cmd == USBD_CDC_BENCH_ECHO) ? MAX(pb->Rec[2], 4U) : pb->Rec[2];
+    pb->Endless = (pb->Rec[2] == 0U) ? 1U : 0U;
+    pb->Pattern = 0U;
+    pb->SeqValid = 0U;
+    pb->Stalled = 0U;
+    pb->Last = USBD_LL_GetTimestamp();
+    pb->TickAcc = 0U;
+    pb->Mode = cmd;
+    break;
+
+  case USBD_CDC_BENCH_STATS:
+    if (USBD_CDC_Bench_Room(ch, sizeof(magic) + sizeof(pb->Stats)) == 0U)
+    {
+      return 0U;
+    }
+
+    (void)USBD_CDC_TxWrite(ch, pb->pdev, (uint8_t *)&magic, sizeof(magic));
+    (void)USBD_CDC_TxWrite(ch, pb->pdev, (uint8_t *)&pb->Stats, sizeof(pb->Stats));
+    (void)USBD_CDC_TxFlush(ch, pb->pdev);
+    break;
+
+  default:
+    pb->Stats.Errors++;
+    break;
+  }
+
+  pb->RecOff = 0U;
+
+  return 1U;
+}
+
+/**
+  * @brief  USBD_CDC_Bench_Source
+  *         Fill the transmit ring with the pattern
+  * @param  ch: CDC channel
+  * @retval None
+  */
+static void USBD_CDC_Bench_Source(uint8_t ch)
+{
+  USBD_CDC_Bench_TypeDef *pb = &USBD_CDC_Bench[ch];
+  uint32_t off;
+  uint32_t n;
+
+  while ((pb->Endless != 0U) || (pb->Arg != 0U))
+  {
+    if (USBD_CDC_Bench_Room(ch, 1U) == 0U)
+    {
+      return;
+    }
+
+    off = pb->Pattern & (sizeof(USBD_CDC_Bench_Pattern) - 1U);
+    n = MIN(USBD_CDC_TxFree(ch, pb->pdev), sizeof(USBD_CDC_Bench_Pattern) - off);
+
+    if (pb->Endless == 0U)
+    {
+      n = MIN(n, pb->Arg);
+      pb->Arg -= n;
+    }
+
+    (void)USBD_CDC_TxWrite(ch, pb->pdev, &USBD_CDC_Bench_Pattern[off], n);
+    pb->Pattern += n;
+    pb->Stats.TxBytes += n;
+    USBD_CDC_Bench_Moved(pb);
+  }
+}
+
+/**
+  * @brief  USBD_CDC_Bench_Room
+  *         Check the transmit ring can take an answer, a full ring counts
+  *         one stall until it takes data again
+  * @param  ch: CDC channel
+  * @param  len: bytes needed
+  * @retval 1 when the ring has room
+  */
+static uint8_t USBD_CDC_Bench_Room(uint8_t ch, uint32_t len)
+{
+  USBD_CDC_Bench_TypeDef *pb = &USBD_CDC_Bench[ch];
+
+  if (USBD_CDC_TxFree(ch, pb->pdev) >= len)
+  {
+    pb->Stalled = 0U;
+    return 1U;
+  }
+
+  if (pb->Stalled == 0U)
+  {
+    pb->Stats.Stalls++;
+    pb->Stalled = 1U;
+  }
+
+  return 0U;
+}
+
+/**
+  * @brief  USBD_CDC_Bench_Seq
+  *         Check the sequence number of a record
+  * @param  pb: channel state
+  * @param  seq: sequence number received
+  * @retval None
+  */
+static void USBD_CDC_Bench_Seq(USBD_CDC_Bench_TypeDef *pb, uint32_t seq)
+{
+  if (pb->SeqValid != 0U)
+  {
+    if ((int32_t)(seq - pb->Seq) > 0)
+    {
+      pb->Stats.Gaps += seq - pb->Seq;
+    }
+    else if (seq != pb->Seq)
+    {
+      pb->Stats.Errors++;
+    }
+    else
+    {
+      /* In order */
+    }
+  }
+
+  pb->SeqValid = 1U;
+  pb->Seq = seq + 1U;
+  pb->Stats.Records++;
+}
+
+/**
+  * @brief  USBD_CDC_Bench_Moved
+  *         Extend the elapsed time of the mode to now, in us so that long
+  *         runs do not wrap the tick counter
+  * @param  pb: channel state
+  * @retval None
+  */
+static void USBD_CDC_Bench_Moved(USBD_CDC_Bench_TypeDef *pb)
+{
+  uint32_t now = USBD_LL_GetTimestamp();
+  uint32_t tpu = MAX(pb->Stats.TickFreq / 1000000U, 1U);
+  uint32_t us;
+
+  pb->TickAcc += now - pb->Last;
+  pb->Last = now;
+
+  us = pb->TickAcc / tpu;
+  pb->TickAcc -= us * tpu;
+  pb->Stats.Elapsed += us;
+}
+
+/**
+  * @brief  USBD_CDC_Bench_Drop
+  *         Give back the received buffers not consumed
+  * @param  ch: CDC channel
+  * @retval None
+  */
+static void USBD_CDC_Bench_Drop(uint8_t ch)
+{
+  USBD_CDC_Bench_TypeDef *pb = &USBD_CDC_Bench[ch];
+
+  while (pb->RxCount != 0U)
+  {
+    (void)USBD_CDC_ReleaseRxBuffer(ch, pb->pdev, pb->RxBuf[pb->RxFirst]);
+    pb->RxFirst = (uint8_t)((pb->RxFirst + 1U) % CDC_ACM_RX_POOL_DEPTH);
+    pb->RxCount--;
+  }
+
+  pb->RxOff = 0U;
+}
+
+#endif /* (USBD_USE_CDC_BENCH == 1U) */
+
+/********************************** END OF FILE *******************************/
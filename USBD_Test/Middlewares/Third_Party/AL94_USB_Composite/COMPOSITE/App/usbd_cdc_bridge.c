@@ -0,0 +1,824 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cdc_bridge.c
+  * @brief   CDC ACM to UART bridge, one engine per bridged channel
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cdc_bridge.h"
+
+#if (USBD_USE_CDC_BRIDGE == 1U)
+
+/*
+  UART to USB: the port receives into a circular buffer (circular DMA with
+  half, full and idle line events on a HAL UART). Each event forwards the
+  bytes written since the last one to the transmit ring of the channel,
+  which coalesces them into full packets. Bytes the ring cannot take yet
+  stay in the circular buffer and are forwarded by the next event or by
+  USBD_CDC_Bridge_Process.
+
+  USB to UART: a receive pool buffer of the channel is sent as it is, the
+  class gives it back to the OUT endpoint once the port reports it sent.
+  While the port is slower than the host the pool runs out and the OUT
+  endpoint NAKs, nothing is dropped.
+
+  A line coding change waits for the buffers received before it to leave
+  the port, the data already in flight is not cut.
+
+  Flow control: a port that holds the remote sender while its reception is
+  stopped (CanHold, RTS/CTS on a HAL UART) is stopped once
+  USBD_CDC_BRIDGE_RX_HOLD bytes wait for the ring, and started again once
+  they are all forwarded. On the other way, the UART CTS stalls the port
+  transmission, the pool buffers stay held and the OUT endpoint NAKs.
+  Without flow control, bytes the port writes over before they could be
+  forwarded, and the line errors, reach the host as SERIAL_STATE events.
+*/
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  const USBD_CDC_Bridge_PortTypeDef *pPort;
+  USBD_HandleTypeDef *pdev;
+  uint32_t RxRead;                              /* next circular buffer byte to forward */
+  uint32_t RxLast;                              /* port position at the last forward */
+  uint32_t RxLevel;                             /* bytes received and not forwarded */
+  uint8_t RxHold;                               /* reception stopped to hold the sender */
+  uint8_t *TxBuf[CDC_ACM_RX_POOL_DEPTH];        /* pool buffers waiting for the port */
+  uint32_t TxLen[CDC_ACM_RX_POOL_DEPTH];
+  uint8_t TxFirst;
+  uint8_t TxCount;                              /* TxFirst included while it is sent */
+  uint8_t TxBusy;                               /* port sending or being configured */
+  uint8_t LcWait;                               /* buffers to send before the change */
+  uint8_t LcPending;
+  uint8_t Active;
+  USBD_CDC_ACM_LineCodingTypeDef LineCoding;
+} USBD_CDC_Bridge_TypeDef;
+
+/* Private define ------------------------------------------------------------*/
+#define USBD_CDC_BRIDGE_HOLD                0x01U
+#define USBD_CDC_BRIDGE_RESUME              0x02U
+
+/* Private macro -------------------------------------------------------------*/
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+#define USBD_CDC_BRIDGE_CLEAN(p, len)       SCB_CleanDCache_by_Addr((uint32_t *)((uint32_t)(p) & ~31U), \
+                                                                    (int32_t)((len) + ((uint32_t)(p) & 31U)))
+#define USBD_CDC_BRIDGE_INVALIDATE(p, len)  SCB_InvalidateDCache_by_Addr((uint32_t *)((uint32_t)(p) & ~31U), \
+                                                                         (int32_t)((len) + ((uint32_t)(p) & 31U)))
+#else
+#define USBD_CDC_BRIDGE_CLEAN(p, len)
+#define USBD_CDC_BRIDGE_INVALIDATE(p, len)
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+static USBD_CDC_Bridge_TypeDef USBD_CDC_Bridge[NUMBER_OF_CDC];
+
+/* Written by the port DMA only, cache line aligned so it can be invalidated */
+static uint8_t USBD_CDC_Bridge_RxBuf[NUMBER_OF_CDC][USBD_CDC_BRIDGE_RX_SIZE] __ALIGNED(32);
+
+/* Private function prototypes -----------------------------------------------*/
+static void USBD_CDC_Bridge_RxForward(uint8_t ch);
+static uint8_t USBD_CDC_Bridge_RxCopy(uint8_t ch);
+static void USBD_CDC_Bridge_RxRestart(uint8_t ch);
+static void USBD_CDC_Bridge_TxNext(uint8_t ch);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  USBD_CDC_Bridge_Attach
+  *         Bridge a CDC ACM channel to a UART port, before the device starts
+  * @param  ch: CDC channel
+  * @param  pdev: device handle
+  * @param  pport: UART side operations
+  * @retval status
+  */
+USBD_StatusTypeDef USBD_CDC_Bridge_Attach(uint8_t ch, USBD_HandleTypeDef *pdev,
+                                          const USBD_CDC_Bridge_PortTypeDef *pport)
+{
+  USBD_CDC_Bridge_TypeDef *pb;
+
+  if ((ch >= NUMBER_OF_CDC) || (pport == NULL))
+  {
+    return USBD_FAIL;
+  }
+
+  pb = &USBD_CDC_Bridge[ch];
+  (void)USBD_memset(pb, 0, sizeof(USBD_CDC_Bridge_TypeDef));
+
+  pb->pPort = pport;
+  pb->pdev = pdev;
+  pb->LineCoding.bitrate = 115200U;
+  pb->LineCoding.datatype = 8U;
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_CDC_Bridge_IsAttached
+  *         Check whether a channel is bridged to a UART port
+  * @param  ch: CDC channel
+  * @retval 1 when bridged, 0 otherwise
+  */
+uint8_t USBD_CDC_Bridge_IsAttached(uint8_t ch)
+{
+  return ((ch < NUMBER_OF_CDC) && (USBD_CDC_Bridge[ch].pPort != NULL)) ? 1U : 0U;
+}
+
+/**
+  * @brief  USBD_CDC_Bridge_Init
+  *         Start a bridged channel once the host configured the device
+  * @param  ch: CDC channel
+  * @retval None
+  */
+void USBD_CDC_Bridge_Init(uint8_t ch)
+{
+  USBD_CDC_Bridge_TypeDef *pb = &USBD_CDC_Bridge[ch];
+  uint32_t primask;
+
+  if (USBD_CDC_Bridge_IsAttached(ch) == 0U)
+  {
+    return;
+  }
+
+  /* Buffers of the previous configuration were taken back by the class,
+     the one the port may still send is only waited for */
+  USBD_ENTER_CRITICAL(primask);
+  pb->TxCount = pb->TxBusy;
+  pb->LcWait = 0U;
+  pb->RxHold = 0U;
+  pb->Active = 1U;
+  USBD_EXIT_CRITICAL(primask);
+
+  USBD_CDC_Bridge_RxRestart(ch);
+
+  /* The line is there as soon as the bridge runs */
+  (void)USBD_CDC_SetSerialState(ch, pb->pdev, CDC_SERIAL_STATE_DCD | CDC_SERIAL_STATE_DSR);
+}
+
+/**
+  * @brief  USBD_CDC_Bridge_DeInit
+  *         Stop a bridged channel, the port keeps its line coding
+  * @param  ch: CDC channel
+  * @retval None
+  */
+void USBD_CDC_Bridge_DeInit(uint8_t ch)
+{
+  USBD_CDC_Bridge_TypeDef *pb = &USBD_CDC_Bridge[ch];
+
+  if (USBD_CDC_Bridge_IsAttached(ch) == 0U)
+  {
+    return;
+  }
+
+  pb->Active = 0U;
+  (void)pb->pPort->StopRx(ch);
+  (void)USBD_CDC_SetSerialState(ch, pb->pdev, 0U);
+}
+
+/**
+  * @brief  USBD_CDC_Bridge_SetLineCoding
+  *         Take a line coding from the host, it is applied once the data
+  *         received before it has left the port
+  * @param  ch: CDC channel
+  * @param  plc: line coding
+  * @retval None
+  */
+void USBD_CDC_Bridge_SetLineCoding(uint8_t ch, USBD_CDC_ACM_LineCodingTypeDef *plc)
+{
+  USBD_CDC_Bridge_TypeDef *pb = &USBD_CDC_Bridge[ch];
+  uint32_t primask;
+
+  if (USBD_CDC_Bridge_IsAttached(ch) == 0U)
+  {
+    return;
+  }
+
+  USBD_ENTER_CRITICAL(primask);
+  pb->LineCoding = *plc;
+  pb->LcWait = pb->TxCount;
+  pb->LcPending = 1U;
+  USBD_EXIT_CRITICAL(primask);
+
+  USBD_CDC_Bridge_TxNext(ch);
+}
+
+/**
+  * @brief  USBD_CDC_Bridge_Receive
+  *         Queue a pool buffer received from the host on the port, it is
+  *         given back to the class once sent
+  * @param  ch: CDC channel
+  * @param  pbuf: pool buffer passed to Receive
+  * @param  length: number of bytes received
+  * @retval status: USBD_FAIL when the channel is not bridged, the caller
+  *         keeps the buffer
+  */
+USBD_StatusTypeDef USBD_CDC_Bridge_Receive(uint8_t ch, uint8_t *pbuf, uint32_t length)
+{
+  USBD_CDC_Bridge_TypeDef *pb = &USBD_CDC_Bridge[ch];
+  uint32_t primask;
+  uint8_t slot;
+
+  if ((USBD_CDC_Bridge_IsAttached(ch) == 0U) || (pb->Active == 0U))
+  {
+    return USBD_FAIL;
+  }
+
+  /* The pool is no deeper than the queue, a held buffer always fits */
+  USBD_ENTER_CRITICAL(primask);
+  slot = (uint8_t)((pb->TxFirst + pb->TxCount) % CDC_ACM_RX_POOL_DEPTH);
+  pb->TxBuf[slot] = pbuf;
+  pb->TxLen[slot] = length;
+  pb->TxCount++;
+  USBD_EXIT_CRITICAL(primask);
+
+  USBD_CDC_Bridge_TxNext(ch);
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_CDC_Bridge_RxEvent
+  *         Half, full or idle line event of the port reception
+  * @param  ch: CDC channel
+  * @retval None
+  */
+void USBD_CDC_Bridge_RxEvent(uint8_t ch)
+{
+  if ((USBD_CDC_Bridge_IsAttached(ch) != 0U) && (USBD_CDC_Bridge[ch].Active != 0U))
+  {
+    USBD_CDC_Bridge_RxForward(ch);
+  }
+}
+
+/**
+  * @brief  USBD_CDC_Bridge_RxError
+  *         Line error of the port, reported to the host. When it stopped the
+  *         reception, what was received is forwarded and reception starts
+  *         over.
+  * @param  ch: CDC channel
+  * @param  events: CDC_SERIAL_STATE_FRAMING, _PARITY or _OVERRUN bits
+  * @param  stopped: 1 when the port reception stopped
+  * @retval None
+  */
+void USBD_CDC_Bridge_RxError(uint8_t ch, uint16_t events, uint8_t stopped)
+{
+  USBD_CDC_Bridge_TypeDef *pb = &USBD_CDC_Bridge[ch];
+
+  if ((USBD_CDC_Bridge_IsAttached(ch) == 0U) || (pb->Active == 0U))
+  {
+    return;
+  }
+
+  if (events != 0U)
+  {
+    (void)USBD_CDC_ReportSerialEvent(ch, pb->pdev, events);
+  }
+
+  /* A held reception is started again by the forward that empties it */
+  if ((stopped != 0U) && (pb->RxHold == 0U))
+  {
+    USBD_CDC_Bridge_RxRestart(ch);
+  }
+}
+
+/**
+  * @brief  USBD_CDC_Bridge_TxCplt
+  *         The port sent the head buffer, it goes back to the receive pool
+  *         and the next one starts
+  * @param  ch: CDC channel
+  * @retval None
+  */
+void USBD_CDC_Bridge_TxCplt(uint8_t ch)
+{
+  USBD_CDC_Bridge_TypeDef *pb = &USBD_CDC_Bridge[ch];
+  uint8_t *pbuf = NULL;
+  uint32_t primask;
+
+  if (USBD_CDC_Bridge_IsAttached(ch) == 0U)
+  {
+    return;
+  }
+
+  USBD_ENTER_CRITICAL(primask);
+
+  if ((pb->TxBusy != 0U) && (pb->TxCount != 0U))
+  {
+    pbuf = pb->TxBuf[pb->TxFirst];
+    pb->TxFirst = (uint8_t)((pb->TxFirst + 1U) % CDC_ACM_RX_POOL_DEPTH);
+    pb->TxCount--;
+
+    if (pb->LcWait != 0U)
+    {
+      pb->LcWait--;
+    }
+  }
+
+  pb->TxBusy = 0U;
+
+  USBD_EXIT_CRITICAL(primask);
+
+  /* The OUT endpoint takes the next packet while the port sends */
+  if (pbuf != NULL)
+  {
+    (void)USBD_CDC_ReleaseRxBuffer(ch, pb->pdev, pbuf);
+  }
+
+  USBD_CDC_Bridge_TxNext(ch);
+}
+
+/**
+  * @brief  USBD_CDC_Bridge_Process
+  *         Forward the received bytes the transmit rings could not take at
+  *         the last event, from the main loop or a timer
+  * @retval None
+  */
+void USBD_CDC_Bridge_Process(void)
+{
+  for (uint8_t ch = 0U; ch < NUMBER_OF_CDC; ch++)
+  {
+    USBD_CDC_Bridge_RxEvent(ch);
+  }
+}
+
+/**
+  * @brief  USBD_CDC_Bridge_RxForward
+  *         Forward the bytes the port received since the last forward, then
+  *         hold or resume the port reception on the backlog left
+  * @param  ch: CDC channel
+  * @retval None
+  */
+static void USBD_CDC_Bridge_RxForward(uint8_t ch)
+{
+  USBD_CDC_Bridge_TypeDef *pb = &USBD_CDC_Bridge[ch];
+  uint8_t action = 0U;
+  uint8_t lost;
+  uint32_t primask;
+
+  /* Events and the main loop both forward, the ring takes one writer */
+  USBD_ENTER_CRITICAL(primask);
+
+  lost = USBD_CDC_Bridge_RxCopy(ch);
+
+  if ((pb->RxHold == 0U) && (pb->RxLevel >= USBD_CDC_BRIDGE_RX_HOLD) &&
+      (pb->pPort->CanHold != NULL) && (pb->pPort->CanHold(ch) != 0U))
+  {
+    pb->RxHold = 1U;
+    action = USBD_CDC_BRIDGE_HOLD;
+  }
+  else if ((pb->RxHold != 0U) && (pb->RxLevel == 0U))
+  {
+    action = USBD_CDC_BRIDGE_RESUME;
+  }
+  else
+  {
+    /* Keep the reception as it is */
+  }
+
+  USBD_EXIT_CRITICAL(primask);
+
+  if (lost != 0U)
+  {
+    (void)USBD_CDC_ReportSerialEvent(ch, pb->pdev, CDC_SERIAL_STATE_OVERRUN);
+  }
+
+  if (action == USBD_CDC_BRIDGE_HOLD)
+  {
+    /* The port stops the sender until the backlog is forwarded, the bytes
+       still coming in stay in the buffer */
+    (void)pb->pPort->StopRx(ch);
+  }
+  else if (action == USBD_CDC_BRIDGE_RESUME)
+  {
+    USBD_CDC_Bridge_RxRestart(ch);
+  }
+  else
+  {
+    /* Nothing to change */
+  }
+}
+
+/**
+  * @brief  USBD_CDC_Bridge_RxCopy
+  *         Copy the received bytes into the transmit ring of the channel, as
+  *         far as it has room. Called with interrupts masked.
+  * @param  ch: CDC channel
+  * @retval 1 when the port wrote over bytes not forwarded yet
+  */
+static uint8_t USBD_CDC_Bridge_RxCopy(uint8_t ch)
+{
+  USBD_CDC_Bridge_TypeDef *pb = &USBD_CDC_Bridge[ch];
+  uint8_t *prx = USBD_CDC_Bridge_RxBuf[ch];
+  uint8_t lost = 0U;
+  uint32_t pos;
+  uint32_t len;
+  uint32_t done;
+
+  /* Events come at least every half buffer, the port never moves a whole
+     lap between two copies */
+  pos = pb->pPort->RxPos(ch) % USBD_CDC_BRIDGE_RX_SIZE;
+  pb->RxLevel += (pos + USBD_CDC_BRIDGE_RX_SIZE - pb->RxLast) % USBD_CDC_BRIDGE_RX_SIZE;
+  pb->RxLast = pos;
+
+  if (pb->RxLevel > USBD_CDC_BRIDGE_RX_SIZE)
+  {
+    /* The ring had no room for them, the newest half buffer is kept */
+    pb->RxRead = (pos + (USBD_CDC_BRIDGE_RX_SIZE / 2U)) % USBD_CDC_BRIDGE_RX_SIZE;
+    pb->RxLevel = USBD_CDC_BRIDGE_RX_SIZE / 2U;
+    lost = 1U;
+  }
+
+  while (pb->RxLevel != 0U)
+  {
+    len = MIN(pb->RxLevel, USBD_CDC_BRIDGE_RX_SIZE - pb->RxRead);
+
+    USBD_CDC_BRIDGE_INVALIDATE(&prx[pb->RxRead], len);
+    done = USBD_CDC_TxWrite(ch, pb->pdev, &prx[pb->RxRead], len);
+    pb->RxRead = (pb->RxRead + done) % USBD_CDC_BRIDGE_RX_SIZE;
+    pb->RxLevel -= done;
+
+    if (done < len)
+    {
+      break;
+    }
+  }
+
+  return lost;
+}
+
+/**
+  * @brief  USBD_CDC_Bridge_RxRestart
+  *         Forward what was received and start the port reception again
+  *         at the beginning of the circular buffer, what the ring cannot
+  *         take is reported as an overrun
+  * @param  ch: CDC channel
+  * @retval None
+  */
+static void USBD_CDC_Bridge_RxRestart(uint8_t ch)
+{
+  USBD_CDC_Bridge_TypeDef *pb = &USBD_CDC_Bridge[ch];
+  uint8_t lost;
+  uint32_t primask;
+
+  USBD_ENTER_CRITICAL(primask);
+  lost = USBD_CDC_Bridge_RxCopy(ch);
+  USBD_EXIT_CRITICAL(primask);
+
+  (void)pb->pPort->StopRx(ch);
+
+  /* The bytes that came in before the port stopped */
+  USBD_ENTER_CRITICAL(primask);
+  lost |= USBD_CDC_Bridge_RxCopy(ch);
+
+  if (pb->RxLevel != 0U)
+  {
+    lost = 1U;
+  }
+
+  pb->RxRead = 0U;
+  pb->RxLast = 0U;
+  pb->RxLevel = 0U;
+  pb->RxHold = 0U;
+  USBD_EXIT_CRITICAL(primask);
+
+  if (lost != 0U)
+  {
+    (void)USBD_CDC_ReportSerialEvent(ch, pb->pdev, CDC_SERIAL_STATE_OVERRUN);
+  }
+
+  if (pb->pPort->StartRx(ch, USBD_CDC_Bridge_RxBuf[ch], USBD_CDC_BRIDGE_RX_SIZE) != 0)
+  {
+    USBD_ErrLog("CDC bridge %d: reception not started", (int)ch);
+  }
+}
+
+/**
+  * @brief  USBD_CDC_Bridge_TxNext
+  *         Start the port on the next queued buffer, or apply a pending line
+  *         coding once the buffers received before it are sent
+  * @param  ch: CDC channel
+  * @retval None
+  */
+static void USBD_CDC_Bridge_TxNext(uint8_t ch)
+{
+  USBD_CDC_Bridge_TypeDef *pb = &USBD_CDC_Bridge[ch];
+  USBD_CDC_ACM_LineCodingTypeDef lc;
+  uint8_t *pbuf = NULL;
+  uint32_t len = 0U;
+  uint8_t apply = 0U;
+  uint32_t primask;
+
+  USBD_ENTER_CRITICAL(primask);
+
+  if ((pb->TxBusy == 0U) && (pb->Active != 0U))
+  {
+    if ((pb->LcPending != 0U) && (pb->LcWait == 0U))
+    {
+      pb->LcPending = 0U;
+      pb->TxBusy = 1U;
+      lc = pb->LineCoding;
+      apply = 1U;
+    }
+    else if (pb->TxCount != 0U)
+    {
+      pb->TxBusy = 1U;
+      pbuf = pb->TxBuf[pb->TxFirst];
+      len = pb->TxLen[pb->TxFirst];
+    }
+    else
+    {
+      /* Nothing to send */
+    }
+  }
+
+  USBD_EXIT_CRITICAL(primask);
+
+  if (apply != 0U)
+  {
+    /* The port is idle, the bytes received at the old coding are forwarded
+       before reception restarts at the new one */
+    USBD_CDC_Bridge_RxForward(ch);
+    (void)pb->pPort->StopRx(ch);
+
+    if (pb->pPort->Config(ch, &lc) != 0)
+    {
+      USBD_ErrLog("CDC bridge %d: line coding %d not applied", (int)ch, (int)lc.bitrate);
+    }
+
+    USBD_CDC_Bridge_RxRestart(ch);
+
+    USBD_ENTER_CRITICAL(primask);
+    pb->TxBusy = 0U;
+    USBD_EXIT_CRITICAL(primask);
+
+    USBD_CDC_Bridge_TxNext(ch);
+  }
+  else if (pbuf != NULL)
+  {
+    /* The pool buffer goes to the port DMA as it is */
+    USBD_CDC_BRIDGE_CLEAN(pbuf, len);
+
+    if ((len == 0U) || (pb->pPort->StartTx(ch, pbuf, len) != 0))
+    {
+      USBD_CDC_Bridge_TxCplt(ch);
+    }
+  }
+  else
+  {
+    /* Port busy or nothing to do */
+  }
+}
+
+#if defined(HAL_UART_MODULE_ENABLED) && defined(HAL_DMA_MODULE_ENABLED)
+/*
+  HAL port: the UART reception DMA stream must be set up in circular mode,
+  the UART interrupt enabled and the HAL callbacks routed to the bridge (see
+  "App/usbd_cdc_acm_if.c").
+*/
+static UART_HandleTypeDef *USBD_CDC_Bridge_Uart[NUMBER_OF_CDC];
+
+static int8_t USBD_CDC_Bridge_HalConfig(uint8_t ch, USBD_CDC_ACM_LineCodingTypeDef *plc);
+static int8_t USBD_CDC_Bridge_HalStartRx(uint8_t ch, uint8_t *pbuf, uint32_t size);
+static int8_t USBD_CDC_Bridge_HalStopRx(uint8_t ch);
+static uint32_t USBD_CDC_Bridge_HalRxPos(uint8_t ch);
+static int8_t USBD_CDC_Bridge_HalStartTx(uint8_t ch, uint8_t *pbuf, uint32_t len);
+static uint8_t USBD_CDC_Bridge_HalCanHold(uint8_t ch);
+
+const USBD_CDC_Bridge_PortTypeDef USBD_CDC_Bridge_HalPort =
+{
+  USBD_CDC_Bridge_HalConfig,
+  USBD_CDC_Bridge_HalStartRx,
+  USBD_CDC_Bridge_HalStopRx,
+  USBD_CDC_Bridge_HalRxPos,
+  USBD_CDC_Bridge_HalStartTx,
+  USBD_CDC_Bridge_HalCanHold,
+};
+
+/**
+  * @brief  USBD_CDC_Bridge_AttachUart
+  *         Bridge a CDC ACM channel to a HAL UART with DMA streams
+  * @param  ch: CDC channel
+  * @param  pdev: device handle
+  * @param  huart: initialized UART handle
+  * @retval status
+  */
+USBD_StatusTypeDef USBD_CDC_Bridge_AttachUart(uint8_t ch, USBD_HandleTypeDef *pdev,
+                                              UART_HandleTypeDef *huart)
+{
+  if ((ch >= NUMBER_OF_CDC) || (huart == NULL) || (huart->hdmarx == NULL) || (huart->hdmatx == NULL))
+  {
+    return USBD_FAIL;
+  }
+
+  USBD_CDC_Bridge_Uart[ch] = huart;
+
+  return USBD_CDC_Bridge_Attach(ch, pdev, &USBD_CDC_Bridge_HalPort);
+}
+
+/**
+  * @brief  USBD_CDC_Bridge_UartToCh
+  *         Find the channel a UART is bridged to
+  * @param  huart: UART handle
+  * @retval CDC channel, NUMBER_OF_CDC when the UART is not bridged
+  */
+uint8_t USBD_CDC_Bridge_UartToCh(UART_HandleTypeDef *huart)
+{
+  uint8_t ch = 0U;
+
+  while ((ch < NUMBER_OF_CDC) && (USBD_CDC_Bridge_Uart[ch] != huart))
+  {
+    ch++;
+  }
+
+  return ch;
+}
+
+/**
+  * @brief  USBD_CDC_Bridge_UartError
+  *         Report a UART line error to the host and start the reception
+  *         again when the error stopped it
+  * @param  huart: UART handle
+  * @retval None
+  */
+void USBD_CDC_Bridge_UartError(UART_HandleTypeDef *huart)
+{
+  uint8_t ch = USBD_CDC_Bridge_UartToCh(huart);
+  uint16_t events = 0U;
+
+  if (ch >= NUMBER_OF_CDC)
+  {
+    return;
+  }
+
+  if ((huart->ErrorCode & HAL_UART_ERROR_ORE) != 0U)
+  {
+    events |= CDC_SERIAL_STATE_OVERRUN;
+  }
+
+  if ((huart->ErrorCode & (HAL_UART_ERROR_FE | HAL_UART_ERROR_NE)) != 0U)
+  {
+    events |= CDC_SERIAL_STATE_FRAMING;
+  }
+
+  if ((huart->ErrorCode & HAL_UART_ERROR_PE) != 0U)
+  {
+    events |= CDC_SERIAL_STATE_PARITY;
+  }
+
+  /* Only a blocking error (overrun, DMA) stops the reception */
+  USBD_CDC_Bridge_RxError(ch, events, (huart->RxState == HAL_UART_STATE_READY) ? 1U : 0U);
+}
+
+/**
+  * @brief  USBD_CDC_Bridge_HalConfig
+  *         Program a line coding, the UART is set up again without going
+  *         through its MSP so the DMA streams stay linked
+  * @param  ch: CDC channel
+  * @param  plc: line coding
+  * @retval 0 on success
+  */
+static int8_t USBD_CDC_Bridge_HalConfig(uint8_t ch, USBD_CDC_ACM_LineCodingTypeDef *plc)
+{
+  UART_HandleTypeDef *huart = USBD_CDC_Bridge_Uart[ch];
+  uint8_t bits = plc->datatype;
+
+  switch (plc->format)
+  {
+    case 1U:
+      huart->Init.StopBits = UART_STOPBITS_1_5;
+      break;
+
+    case 2U:
+      huart->Init.StopBits = UART_STOPBITS_2;
+      break;
+
+    default:
+      huart->Init.StopBits = UART_STOPBITS_1;
+      break;
+  }
+
+  /* Mark and space parity are not supported by the UART */
+  switch (plc->paritytype)
+  {
+    case 1U:
+      huart->Init.Parity = UART_PARITY_ODD;
+      break;
+
+    case 2U:
+      huart->Init.Parity = UART_PARITY_EVEN;
+      break;
+
+    default:
+      huart->Init.Parity = UART_PARITY_NONE;
+      break;
+  }
+
+  /* The UART word holds the parity bit */
+  if (huart->Init.Parity != UART_PARITY_NONE)
+  {
+    bits++;
+  }
+
+  switch (bits)
+  {
+    case 7U:
+      huart->Init.WordLength = UART_WORDLENGTH_7B;
+      break;
+
+    case 9U:
+      huart->Init.WordLength = UART_WORDLENGTH_9B;
+      break;
+
+    default:
+      huart->Init.WordLength = UART_WORDLENGTH_8B;
+      break;
+  }
+
+  if (plc->bitrate != 0U)
+  {
+    huart->Init.BaudRate = plc->bitrate;
+  }
+
+  return (HAL_UART_Init(huart) == HAL_OK) ? 0 : -1;
+}
+
+/**
+  * @brief  USBD_CDC_Bridge_HalStartRx
+  *         Start circular DMA reception reporting half, full and idle line
+  * @param  ch: CDC channel
+  * @param  pbuf: circular buffer
+  * @param  size: buffer size
+  * @retval 0 on success
+  */
+static int8_t USBD_CDC_Bridge_HalStartRx(uint8_t ch, uint8_t *pbuf, uint32_t size)
+{
+  return (HAL_UARTEx_ReceiveToIdle_DMA(USBD_CDC_Bridge_Uart[ch], pbuf, (uint16_t)size) == HAL_OK) ? 0 : -1;
+}
+
+/**
+  * @brief  USBD_CDC_Bridge_HalStopRx
+  *         Stop the reception
+  * @param  ch: CDC channel
+  * @retval 0 on success
+  */
+static int8_t USBD_CDC_Bridge_HalStopRx(uint8_t ch)
+{
+  return (HAL_UART_AbortReceive(USBD_CDC_Bridge_Uart[ch]) == HAL_OK) ? 0 : -1;
+}
+
+/**
+  * @brief  USBD_CDC_Bridge_HalRxPos
+  *         Circular buffer offset the DMA writes next
+  * @param  ch: CDC channel
+  * @retval offset
+  */
+static uint32_t USBD_CDC_Bridge_HalRxPos(uint8_t ch)
+{
+  UART_HandleTypeDef *huart = USBD_CDC_Bridge_Uart[ch];
+
+  /* The counter stays valid once the stream stopped on a line error */
+  if (huart->RxXferSize == 0U)
+  {
+    return USBD_CDC_Bridge[ch].RxRead;
+  }
+
+  return huart->RxXferSize - __HAL_DMA_GET_COUNTER(huart->hdmarx);
+}
+
+/**
+  * @brief  USBD_CDC_Bridge_HalStartTx
+  *         Send a buffer through the transmit DMA stream
+  * @param  ch: CDC channel
+  * @param  pbuf: buffer
+  * @param  len: number of bytes, up to 65535
+  * @retval 0 on success
+  */
+static int8_t USBD_CDC_Bridge_HalStartTx(uint8_t ch, uint8_t *pbuf, uint32_t len)
+{
+  return (HAL_UART_Transmit_DMA(USBD_CDC_Bridge_Uart[ch], pbuf, (uint16_t)len) == HAL_OK) ? 0 : -1;
+}
+
+/**
+  * @brief  USBD_CDC_Bridge_HalCanHold
+  *         A UART with RTS flow control raises RTS once its receive register
+  *         is full, the stopped reception holds the sender
+  * @param  ch: CDC channel
+  * @retval 1 when the UART drives RTS
+  */
+static uint8_t USBD_CDC_Bridge_HalCanHold(uint8_t ch)
+{
+  return ((USBD_CDC_Bridge_Uart[ch]->Init.HwFlowCtl & UART_HWCONTROL_RTS) != 0U) ? 1U : 0U;
+}
+#endif /* defined(HAL_UART_MODULE_ENABLED) && defined(HAL_DMA_MODULE_ENABLED) */
+
+#endif /* (USBD_USE_CDC_BRIDGE == 1U) */
+
+/********************************** END OF FILE *******************************/
@@ -0,0 +1,109 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cdc_bridge.h
+  * @brief   Header for usbd_cdc_bridge.c file.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CDC_BRIDGE_H
+#define __USBD_CDC_BRIDGE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cdc_acm.h"
+
+#if (USBD_USE_CDC_BRIDGE == 1U)
+
+/* Exported constants --------------------------------------------------------*/
+
+/* Circular UART receive buffer of a bridged channel, it must hold what the
+   line brings in while the host does not read */
+#ifndef USBD_CDC_BRIDGE_RX_SIZE
+#define USBD_CDC_BRIDGE_RX_SIZE                     4096U
+#endif /* USBD_CDC_BRIDGE_RX_SIZE */
+
+#if ((USBD_CDC_BRIDGE_RX_SIZE % 32U) != 0U) || (USBD_CDC_BRIDGE_RX_SIZE > 65504U)
+#error "USBD_CDC_BRIDGE_RX_SIZE must be a multiple of 32 of up to 65504 bytes"
+#endif
+
+/* Received bytes waiting for the transmit ring at which a port with flow
+   control stops its reception, the rest of the buffer takes what comes in
+   until the sender stops */
+#ifndef USBD_CDC_BRIDGE_RX_HOLD
+#define USBD_CDC_BRIDGE_RX_HOLD                     (USBD_CDC_BRIDGE_RX_SIZE / 2U)
+#endif /* USBD_CDC_BRIDGE_RX_HOLD */
+
+/* Exported types ------------------------------------------------------------*/
+
+/* UART side of a bridged channel. The operations run from the USB and the
+   UART interrupts; a port may be a HAL UART (USBD_CDC_Bridge_HalPort) or a
+   simulated line on a host */
+typedef struct
+{
+  /* Apply a line coding, only called while the port does not transmit and
+     with reception stopped */
+  int8_t (*Config)(uint8_t ch, USBD_CDC_ACM_LineCodingTypeDef *plc);
+  /* Start circular reception into pbuf, RxEvent is reported on the way */
+  int8_t (*StartRx)(uint8_t ch, uint8_t *pbuf, uint32_t size);
+  int8_t (*StopRx)(uint8_t ch);
+  /* Offset in the circular buffer the next received byte is written to */
+  uint32_t (*RxPos)(uint8_t ch);
+  /* Send a buffer, TxCplt is reported once it has left */
+  int8_t (*StartTx)(uint8_t ch, uint8_t *pbuf, uint32_t len);
+  /* 1 when the port holds the remote sender back while reception is
+     stopped (RTS/CTS flow control), may be NULL */
+  uint8_t (*CanHold)(uint8_t ch);
+} USBD_CDC_Bridge_PortTypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+/* Exported functions ------------------------------------------------------- */
+
+USBD_StatusTypeDef USBD_CDC_Bridge_Attach(uint8_t ch, USBD_HandleTypeDef *pdev,
+                                          const USBD_CDC_Bridge_PortTypeDef *pport);
+
+/* Called by the CDC ACM interface */
+uint8_t USBD_CDC_Bridge_IsAttached(uint8_t ch);
+void USBD_CDC_Bridge_Init(uint8_t ch);
+void USBD_CDC_Bridge_DeInit(uint8_t ch);
+void USBD_CDC_Bridge_SetLineCoding(uint8_t ch, USBD_CDC_ACM_LineCodingTypeDef *plc);
+USBD_StatusTypeDef USBD_CDC_Bridge_Receive(uint8_t ch, uint8_t *pbuf, uint32_t length);
+
+/* Called by the UART side */
+void USBD_CDC_Bridge_RxEvent(uint8_t ch);
+void USBD_CDC_Bridge_RxError(uint8_t ch, uint16_t events, uint8_t stopped);
+void USBD_CDC_Bridge_TxCplt(uint8_t ch);
+
+/* Called from the main loop or a timer */
+void USBD_CDC_Bridge_Process(void);
+
+#if defined(HAL_UART_MODULE_ENABLED) && defined(HAL_DMA_MODULE_ENABLED)
+extern const USBD_CDC_Bridge_PortTypeDef USBD_CDC_Bridge_HalPort;
+
+USBD_StatusTypeDef USBD_CDC_Bridge_AttachUart(uint8_t ch, USBD_HandleTypeDef *pdev,
+                                              UART_HandleTypeDef *huart);
+uint8_t USBD_CDC_Bridge_UartToCh(UART_HandleTypeDef *huart);
+void USBD_CDC_Bridge_UartError(UART_HandleTypeDef *huart);
+#endif /* defined(HAL_UART_MODULE_ENABLED) && defined(HAL_DMA_MODULE_ENABLED) */
+
+#endif /* (USBD_USE_CDC_BRIDGE == 1U) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_CDC_BRIDGE_H */
+
+/********************************** END OF FILE *******************************/
@@ -0,0 +1,310 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cdc_log.c
+  * @brief   Binary log over a CDC ACM channel, formatted on the host
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cdc_log.h"
+
+#if (USBD_USE_CDC_LOG == 1U)
+
+/*
+  USBD_LOG encodes a message into a frame on the stack: a length byte (the
+  bytes that follow, never 0), the address of the format string and the
+  arguments, all as LEB128 varints. The frame is copied into the ring of the
+  core with interrupts masked for the copy only; a full ring drops the
+  whole frame and counts it, the count is queued as a control record
+  (length byte 0) in front of the next frame that fits.
+
+  USBD_CDC_Log_Process moves whole frames from the rings to the transmit
+  ring of the channel, which sends them in full packets, and names the
+  core with a control record when it switches rings. The host tool
+  Utilities/usbd_cdc_log.py turns the stream back into text with the
+  strings of the ELF files.
+*/
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  USBD_HandleTypeDef *pdev;
+  uint8_t Ch;
+  uint8_t Core;                         /* core of the last frames sent */
+} USBD_CDC_Log_TypeDef;
+
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static USBD_CDC_Log_TypeDef USBD_CDC_Log;
+
+#if (USBD_CDC_LOG_CORES > 1U)
+/* Shared by the cores, both linker scripts place it at the same address */
+USBD_CDC_Log_RingTypeDef USBD_CDC_Log_Ring[USBD_CDC_LOG_CORES] __attribute__((section(".usbd_log")));
+#else
+static USBD_CDC_Log_RingTypeDef USBD_CDC_Log_Ring[USBD_CDC_LOG_CORES];
+#endif /* (USBD_CDC_LOG_CORES > 1U) */
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t USBD_CDC_Log_Varint(uint8_t *pbuf, uint32_t val);
+static void USBD_CDC_Log_Put(USBD_CDC_Log_RingTypeDef *pring, uint32_t head,
+                             const uint8_t *pbuf, uint32_t len);
+static uint8_t USBD_CDC_Log_Drain(USBD_CDC_Log_RingTypeDef *pring);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  USBD_CDC_Log_Attach
+  *         Send the log on a CDC ACM channel, before the device starts and
+  *         before the other cores log. The channel carries nothing else.
+  * @param  ch: CDC channel
+  * @param  pdev: device handle
+  * @retval status
+  */
+USBD_StatusTypeDef USBD_CDC_Log_Attach(uint8_t ch, USBD_HandleTypeDef *pdev)
+{
+  if ((ch >= NUMBER_OF_CDC) || (pdev == NULL))
+  {
+    return USBD_FAIL;
+  }
+
+  (void)USBD_memset(&USBD_CDC_Log, 0, sizeof(USBD_CDC_Log));
+  (void)USBD_memset(USBD_CDC_Log_Ring, 0, sizeof(USBD_CDC_Log_Ring));
+  USBD_CDC_LOG_BARRIER();
+
+  USBD_CDC_Log.Ch = ch;
+  USBD_CDC_Log.pdev = pdev;
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_CDC_Log_Write
+  *         Queue a message in the ring of this core, called by USBD_LOG
+  * @param  id: address of the format string
+  * @param  parg: arguments
+  * @param  nargs: number of arguments
+  * @retval None
+  */
+void USBD_CDC_Log_Write(uint32_t id, const uint32_t *parg, uint32_t nargs)
+{
+  USBD_CDC_Log_RingTypeDef *pring = &USBD_CDC_Log_Ring[USBD_CDC_LOG_CORE];
+  uint8_t frame[USBD_CDC_LOG_FRAME_MAX];
+  uint8_t rec[7];
+  uint32_t len = 1U;
+  uint32_t rlen;
+  uint32_t head;
+  uint32_t room;
+  uint32_t primask;
+
+  nargs = MIN(nargs, USBD_CDC_LOG_MAX_ARGS);
+  len += USBD_CDC_Log_Varint(&frame[len], id);
+
+  for (uint32_t i = 0U; i < nargs; i++)
+  {
+    len += USBD_CDC_Log_Varint(&frame[len], parg[i]);
+  }
+
+  frame[0] = (uint8_t)(len - 1U);
+
+  USBD_ENTER_CRITICAL(primask);
+
+  head = pring->head;
+  room = USBD_CDC_LOG_RING_SIZE - (head - pring->tail);
+
+  /* The drops are reported where they happened, once both fit */
+  if (pring->lost != 0U)
+  {
+    rec[0] = USBD_CDC_LOG_CONTROL;
+    rec[1] = USBD_CDC_LOG_CORE;
+    rlen = 2U + USBD_CDC_Log_Varint(&rec[2], pring->lost);
+
+    if (room >= (rlen + len))
+    {
+      USBD_CDC_Log_Put(pring, head, rec, rlen);
+      head += rlen;
+      room -= rlen;
+      pring->lost = 0U;
+    }
+  }
+
+  if (room < len)
+  {
+    pring->lost++;
+  }
+  else
+  {
+    USBD_CDC_Log_Put(pring, head, frame, len);
+    head += len;
+  }
+
+  /* The drain sees the frames once the head moves */
+  USBD_CDC_LOG_BARRIER();
+  pring->head = head;
+
+  USBD_EXIT_CRITICAL(primask);
+}
+
+/**
+  * @brief  USBD_CDC_Log_Process
+  *         Move the frames of every core to the transmit ring of the
+  *         channel, from the main loop or a timer of the core running the
+  *         stack
+  * @retval None
+  */
+void USBD_CDC_Log_Process(void)
+{
+  USBD_CDC_Log_RingTypeDef *pring;
+  uint8_t rec[3];
+
+  if (USBD_CDC_Log.pdev == NULL)
+  {
+    return;
+  }
+
+  for (uint8_t core = 0U; core < USBD_CDC_LOG_CORES; core++)
+  {
+    pring = &USBD_CDC_Log_Ring[core];
+
+    if (pring->head == pring->tail)
+    {
+      continue;
+    }
+
+    /* Name the core before its frames */
+    if (core != USBD_CDC_Log.Core)
+    {
+      rec[0] = USBD_CDC_LOG_CONTROL;
+      rec[1] = core;
+      rec[2] = 0U;
+
+      if (USBD_CDC_TxFree(USBD_CDC_Log.Ch, USBD_CDC_Log.pdev) < sizeof(rec))
+      {
+        return;
+      }
+
+      (void)USBD_CDC_TxWrite(USBD_CDC_Log.Ch, USBD_CDC_Log.pdev, rec, sizeof(rec));
+      USBD_CDC_Log.Core = core;
+    }
+
+    /* The next core waits for this one to be drained */
+    if (USBD_CDC_Log_Drain(pring) == 0U)
+    {
+      return;
+    }
+  }
+}
+
+/**
+  * @brief  USBD_CDC_Log_Drain
+  *         Move the whole frames of a ring the transmit ring has room for
+  * @param  pring: ring of a core
+  * @retval 1 when the ring is empty, 0 when the transmit ring is full
+  */
+static uint8_t USBD_CDC_Log_Drain(USBD_CDC_Log_RingTypeDef *pring)
+{
+  uint32_t head = pring->head;
+  uint32_t tail = pring->tail;
+  uint32_t room = USBD_CDC_TxFree(USBD_CDC_Log.Ch, USBD_CDC_Log.pdev);
+  uint32_t len = 0U;
+  uint32_t flen;
+  uint32_t off;
+  uint32_t part;
+
+  /* The frames up to head are complete */
+  USBD_CDC_LOG_BARRIER();
+
+  while ((tail + len) != head)
+  {
+    flen = 1U + pring->buf[(tail + len) & (USBD_CDC_LOG_RING_SIZE - 1U)];
+
+    /* A control record ends with the last byte of its varint */
+    if (flen == 1U)
+    {
+      flen = 3U;
+
+      while ((pring->buf[(tail + len + flen - 1U) & (USBD_CDC_LOG_RING_SIZE - 1U)] & 0x80U) != 0U)
+      {
+        flen++;
+      }
+    }
+
+    if ((len + flen) > room)
+    {
+      break;
+    }
+
+    len += flen;
+  }
+
+  if (len != 0U)
+  {
+    off = tail & (USBD_CDC_LOG_RING_SIZE - 1U);
+    part = MIN(len, USBD_CDC_LOG_RING_SIZE - off);
+
+    (void)USBD_CDC_TxWrite(USBD_CDC_Log.Ch, USBD_CDC_Log.pdev, &pring->buf[off], part);
+    (void)USBD_CDC_TxWrite(USBD_CDC_Log.Ch, USBD_CDC_Log.pdev, pring->buf, len - part);
+
+    /* The producer may reuse the bytes once the tail moves */
+    USBD_CDC_LOG_BARRIER();
+    pring->tail = tail + len;
+  }
+
+  return ((tail + len) == head) ? 1U : 0U;
+}
+
+/**
+  * @brief  USBD_CDC_Log_Put
+  *         Copy bytes into a ring from head on, wrapping at its end
+  * @param  pring: ring of this core
+  * @param  head: ring position of the first byte
+  * @param  pbuf: bytes to copy
+  * @param  len: number of bytes, no more than the room left
+  * @retval None
+  */
+static void USBD_CDC_Log_Put(USBD_CDC_Log_RingTypeDef *pring, uint32_t head,
+                             const uint8_t *pbuf, uint32_t len)
+{
+  uint32_t off = head & (USBD_CDC_LOG_RING_SIZE - 1U);
+  uint32_t part = MIN(len, USBD_CDC_LOG_RING_SIZE - off);
+
+  (void)USBD_memcpy(&pring->buf[off], pbuf, part);
+  (void)USBD_memcpy(pring->buf, &pbuf[part], len - part);
+}
+
+/**
+  * @brief  USBD_CDC_Log_Varint
+  *         Encode a value as a LEB128 varint, 7 bits per byte from the low
+  *         ones, the last byte has bit 7 clear
+  * @param  pbuf: destination, 5 bytes
+  * @param  val: value
+  * @retval number of bytes written
+  */
+static uint32_t USBD_CDC_Log_Varint(uint8_t *pbuf, uint32_t val)
+{
+  uint32_t n = 0U;
+
+  while (val >= 0x80U)
+  {
+    pbuf[n] = (uint8_t)(val | 0x80U);
+    val >>= 7;
+    n++;
+  }
+
+  pbuf[n] = (uint8_t)val;
+
+  return n + 1U;
+}
+
+#endif /* (USBD_USE_CDC_LOG == 1U) */
+
+/********************************** END OF FILE *******************************/
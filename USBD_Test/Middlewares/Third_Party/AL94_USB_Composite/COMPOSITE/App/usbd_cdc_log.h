@@ -0,0 +1,120 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cdc_log.h
+  * @brief   Header for usbd_cdc_log.c file.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CDC_LOG_H
+#define __USBD_CDC_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cdc_acm.h"
+
+#if (USBD_USE_CDC_LOG == 1U)
+
+/* Exported constants --------------------------------------------------------*/
+
+/* Log bytes a core buffers until the host reads them, a power of two */
+#ifndef USBD_CDC_LOG_RING_SIZE
+#define USBD_CDC_LOG_RING_SIZE                      2048U
+#endif /* USBD_CDC_LOG_RING_SIZE */
+
+/* Arguments one message may carry */
+#ifndef USBD_CDC_LOG_MAX_ARGS
+#define USBD_CDC_LOG_MAX_ARGS                       8U
+#endif /* USBD_CDC_LOG_MAX_ARGS */
+
+/* Cores logging to the host, each one fills its own ring. With more than
+   one, the rings are placed in the .usbd_log section */
+#ifndef USBD_CDC_LOG_CORES
+#define USBD_CDC_LOG_CORES                          1U
+#endif /* USBD_CDC_LOG_CORES */
+
+/* Ring of the core this image runs on */
+#ifndef USBD_CDC_LOG_CORE
+#define USBD_CDC_LOG_CORE                           0U
+#endif /* USBD_CDC_LOG_CORE */
+
+/* Orders the ring accesses seen by the draining core */
+#ifndef USBD_CDC_LOG_BARRIER
+#define USBD_CDC_LOG_BARRIER()                      __DMB()
+#endif /* USBD_CDC_LOG_BARRIER */
+
+#if ((USBD_CDC_LOG_RING_SIZE & (USBD_CDC_LOG_RING_SIZE - 1U)) != 0U)
+#error "USBD_CDC_LOG_RING_SIZE must be a power of two"
+#endif
+
+#if (USBD_CDC_LOG_MAX_ARGS > 32U) || (USBD_CDC_LOG_CORE >= USBD_CDC_LOG_CORES)
+#error "USBD_CDC_LOG_MAX_ARGS is limited to 32 and USBD_CDC_LOG_CORE must name one of the cores"
+#endif
+
+/* Longest frame: the length byte, then the format string id and each
+   argument as a varint of up to 5 bytes */
+#define USBD_CDC_LOG_FRAME_MAX                      (1U + (5U * (1U + USBD_CDC_LOG_MAX_ARGS)))
+
+/* Length byte of a control record: core index, then the number of messages
+   that core dropped at this point of the stream, as a varint */
+#define USBD_CDC_LOG_CONTROL                        0x00U
+
+/* Exported types ------------------------------------------------------------*/
+
+/* Frames of one core, single producer (the logging core, its contexts
+   serialized by a short critical section) and single consumer (the core
+   running the stack) */
+typedef struct
+{
+  volatile uint32_t head;   /* written by the logging core only */
+  volatile uint32_t tail;   /* written by the draining core only */
+  uint32_t lost;            /* messages dropped and not reported yet, logging core */
+  uint8_t buf[USBD_CDC_LOG_RING_SIZE];
+} USBD_CDC_Log_RingTypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+
+/* Log a message. The format string stays in the .usbd_log_str section the
+   host decoder reads from the ELF file, only its address and the integer
+   arguments (up to 32 bits each, %s is not supported) leave the target */
+#define USBD_LOG(fmt, ...)                                                          \
+  do                                                                                \
+  {                                                                                 \
+    static const char usbd_log_fmt[] __attribute__((section(".usbd_log_str"), used)) = fmt; \
+    const uint32_t usbd_log_arg[] = {0U, ##__VA_ARGS__};                             \
+    (void)sizeof(char[((sizeof(usbd_log_arg) / sizeof(uint32_t)) <=                 \
+                       (USBD_CDC_LOG_MAX_ARGS + 1U)) ? 1 : -1]);                     \
+    USBD_CDC_Log_Write((uint32_t)usbd_log_fmt, &usbd_log_arg[1],                    \
+                       (uint32_t)(sizeof(usbd_log_arg) / sizeof(uint32_t)) - 1U);   \
+  } while (0)
+
+/* Exported functions ------------------------------------------------------- */
+
+/* Called on the core running the stack */
+USBD_StatusTypeDef USBD_CDC_Log_Attach(uint8_t ch, USBD_HandleTypeDef *pdev);
+void USBD_CDC_Log_Process(void);
+
+/* Called on any logging core, from any context */
+void USBD_CDC_Log_Write(uint32_t id, const uint32_t *parg, uint32_t nargs);
+
+#endif /* (USBD_USE_CDC_LOG == 1U) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_CDC_LOG_H */
+
+/********************************** END OF FILE *******************************/
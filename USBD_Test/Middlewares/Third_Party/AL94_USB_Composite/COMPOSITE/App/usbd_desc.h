@@ -52,6 +52,10 @@
 
 #define  USB_SIZ_STRING_SERIAL       0x1A
 
+#if (USBD_LPM_ENABLED == 1)
+#define  USB_SIZ_BOS_DESC            0x0C
+#endif /* (USBD_LPM_ENABLED == 1) */
+
 /* USER CODE BEGIN EXPORTED_CONSTANTS */
 
 /* USER CODE END EXPORTED_CONSTANTS */
@@ -0,0 +1,991 @@
+/**
+  ******************************************************************************
+  * @file    usbd_ipc_if.c
+  * @brief   Class interfaces proxied between the two cores of a split stack
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_ipc_if.h"
+
+#if (USBD_USE_IPC == 1U)
+
+/*
+  The stack side core registers the proxies below with the classes. Calls
+  the class needs an answer to (storage access, line coding, init) wait for
+  the service side core to run the real interface. Received data is handed
+  over and the OUT endpoint stays NAKed until the service side interface
+  returns from Receive; data to send is handed the other way and comes back
+  through TransmitCplt.
+
+  Buffers cross the cores by pointer. The memory the stack side core uses
+  for class data must not be cached by the service side core, and a buffer
+  the service side hands over is cleaned from its data cache first, so it
+  must be aligned on and sized in cache lines.
+*/
+
+#if (USBD_MAX_NUM_DEV > 1U)
+#error "The inter-core proxies serve a single device"
+#endif
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+
+/* Calls, answered through USBD_IPC_Reply */
+#define USBD_IPC_OP_INIT                0x01U
+#define USBD_IPC_OP_DEINIT              0x02U
+#define USBD_IPC_OP_CONTROL             0x03U
+#define USBD_IPC_OP_CAPACITY            0x04U
+#define USBD_IPC_OP_IS_READY            0x05U
+#define USBD_IPC_OP_IS_WP               0x06U
+#define USBD_IPC_OP_READ                0x07U
+#define USBD_IPC_OP_WRITE               0x08U
+#define USBD_IPC_OP_MAX_LUN             0x09U
+
+/* Posted messages, the buffer moves with them */
+#define USBD_IPC_OP_RECEIVE             0x10U  /* to the service, until RX_RELEASE */
+#define USBD_IPC_OP_TX_CPLT             0x11U  /* to the service, buffer given back */
+#define USBD_IPC_OP_RX_RELEASE          0x12U  /* to the stack, buffer given back */
+#define USBD_IPC_OP_TRANSMIT            0x13U  /* to the stack, until TX_CPLT */
+
+#define USBD_IPC_ITF_MSC                0x00U
+#define USBD_IPC_ITF_CDC_ACM            0x01U
+#define USBD_IPC_ITF_CDC_RNDIS          0x02U
+
+#define USBD_IPC_SIDE_NONE              0xFFU
+
+/* Private macro -------------------------------------------------------------*/
+#if defined(CORE_CM7) && defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+#define USBD_IPC_CLEAN(p, len)          SCB_CleanDCache_by_Addr((uint32_t *)(void *)(p), (int32_t)(len))
+#else
+#define USBD_IPC_CLEAN(p, len)
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t USBD_IPC_IF_Ring = USBD_IPC_SIDE_NONE;  /* ring this core drains */
+
+/* Stack side */
+static USBD_HandleTypeDef *USBD_IPC_IF_Dev;
+
+#if (USBD_USE_CDC_RNDIS == 1)
+#if defined ( __ICCARM__ ) /*!< IAR Compiler */
+#pragma data_alignment=4
+#endif
+__ALIGN_BEGIN static uint8_t USBD_IPC_IF_RndisRx[CDC_RNDIS_ETH_MAX_SEGSZE + 100] __ALIGN_END;
+#endif
+
+/* Service side */
+#if (USBD_USE_MSC == 1)
+static USBD_StorageTypeDef *USBD_IPC_IF_Storage;
+#endif
+#if (USBD_USE_CDC_ACM == 1)
+static USBD_CDC_ACM_ItfTypeDef *USBD_IPC_IF_Acm;
+#endif
+#if (USBD_USE_CDC_RNDIS == 1)
+static USBD_CDC_RNDIS_ItfTypeDef *USBD_IPC_IF_Rndis;
+#endif
+
+/* Private function prototypes -----------------------------------------------*/
+static int8_t USBD_IPC_IF_Call(uint8_t itf, uint8_t op, uint8_t ch, uint8_t *pbuf,
+                               uint32_t len, USBD_IPC_MsgTypeDef *pmsg);
+static void USBD_IPC_IF_StackServe(USBD_IPC_MsgTypeDef *pmsg);
+static void USBD_IPC_IF_Serve(USBD_IPC_MsgTypeDef *pmsg);
+static void USBD_IPC_IF_Arm(uint32_t sem);
+
+#if (USBD_USE_MSC == 1)
+static int8_t IPC_STORAGE_Init(uint8_t lun);
+static int8_t IPC_STORAGE_GetCapacity(uint8_t lun, uint32_t *block_num, uint16_t *block_size);
+static int8_t IPC_STORAGE_IsReady(uint8_t lun);
+static int8_t IPC_STORAGE_IsWriteProtected(uint8_t lun);
+static int8_t IPC_STORAGE_Read(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len);
+static int8_t IPC_STORAGE_Write(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len);
+static int8_t IPC_STORAGE_GetMaxLun(void);
+static void USBD_IPC_IF_ServeStorage(USBD_IPC_MsgTypeDef *pmsg);
+
+USBD_StorageTypeDef USBD_IPC_Storage_fops =
+{
+  IPC_STORAGE_Init,
+  IPC_STORAGE_GetCapacity,
+  IPC_STORAGE_IsReady,
+  IPC_STORAGE_IsWriteProtected,
+  IPC_STORAGE_Read,
+  IPC_STORAGE_Write,
+  IPC_STORAGE_GetMaxLun,
+  NULL  /* inquiry data of the service side, read back by Init */
+};
+#endif /* (USBD_USE_MSC == 1) */
+
+#if (USBD_USE_CDC_ACM == 1)
+static int8_t IPC_CDC_Init(uint8_t cdc_ch);
+static int8_t IPC_CDC_DeInit(uint8_t cdc_ch);
+static int8_t IPC_CDC_Control(uint8_t cdc_ch, uint8_t cmd, uint8_t *pbuf, uint16_t length);
+static int8_t IPC_CDC_Receive(uint8_t cdc_ch, uint8_t *Buf, uint32_t *Len);
+static int8_t IPC_CDC_TransmitCplt(uint8_t cdc_ch, uint8_t *Buf, uint32_t *Len, uint8_t epnum);
+static void USBD_IPC_IF_ServeAcm(USBD_IPC_MsgTypeDef *pmsg);
+
+USBD_CDC_ACM_ItfTypeDef USBD_IPC_CDC_ACM_fops =
+{
+  IPC_CDC_Init,
+  IPC_CDC_DeInit,
+  IPC_CDC_Control,
+  IPC_CDC_Receive,
+  IPC_CDC_TransmitCplt
+};
+#endif /* (USBD_USE_CDC_ACM == 1) */
+
+#if (USBD_USE_CDC_RNDIS == 1)
+static int8_t IPC_RNDIS_Init(void);
+static int8_t IPC_RNDIS_DeInit(void);
+static int8_t IPC_RNDIS_Control(uint8_t cmd, uint8_t *pbuf, uint16_t length);
+static int8_t IPC_RNDIS_Receive(uint8_t *Buf, uint32_t *Len);
+static int8_t IPC_RNDIS_TransmitCplt(uint8_t *Buf, uint32_t *Len, uint8_t epnum);
+static int8_t IPC_RNDIS_Process(USBD_HandleTypeDef *pdev);
+static void USBD_IPC_IF_ServeRndis(USBD_IPC_MsgTypeDef *pmsg);
+
+USBD_CDC_RNDIS_ItfTypeDef USBD_IPC_CDC_RNDIS_fops =
+{
+  IPC_RNDIS_Init,
+  IPC_RNDIS_DeInit,
+  IPC_RNDIS_Control,
+  IPC_RNDIS_Receive,
+  IPC_RNDIS_TransmitCplt,
+  IPC_RNDIS_Process,
+  (uint8_t *)CDC_RNDIS_MAC_STR_DESC,
+};
+#endif /* (USBD_USE_CDC_RNDIS == 1) */
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  USBD_IPC_IF_StackInit
+  *         Set up the core running the USB stack, the service side core must
+  *         have run USBD_IPC_IF_ServiceInit before
+  * @param  pdev: device handle the proxies are registered with
+  * @retval None
+  */
+void USBD_IPC_IF_StackInit(USBD_HandleTypeDef *pdev)
+{
+  USBD_IPC_IF_Dev = pdev;
+  USBD_IPC_IF_Ring = USBD_IPC_TO_STACK;
+  USBD_IPC_IF_Arm(USBD_IPC_HSEM_STACK);
+}
+
+/**
+  * @brief  USBD_IPC_IF_ServiceInit
+  *         Set up the core running the class interfaces and empty the rings,
+  *         called before the stack side core is started
+  * @param  None
+  * @retval None
+  */
+void USBD_IPC_IF_ServiceInit(void)
+{
+  USBD_IPC_Init();
+  USBD_IPC_IF_Ring = USBD_IPC_TO_SERVICE;
+  USBD_IPC_IF_Arm(USBD_IPC_HSEM_SERVICE);
+}
+
+/**
+  * @brief  USBD_IPC_IF_Process
+  *         Handle the messages queued for this core, called from the doorbell
+  *         interrupt or polled. On the stack side the doorbell interrupt must
+  *         have the priority of the USB interrupt
+  * @param  None
+  * @retval None
+  */
+void USBD_IPC_IF_Process(void)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+
+  if (USBD_IPC_IF_Ring == USBD_IPC_SIDE_NONE)
+  {
+    return;
+  }
+
+  while (USBD_IPC_Receive(USBD_IPC_IF_Ring, &msg) == USBD_OK)
+  {
+    if (USBD_IPC_IF_Ring == USBD_IPC_TO_STACK)
+    {
+      USBD_IPC_IF_StackServe(&msg);
+    }
+    else
+    {
+      USBD_IPC_IF_Serve(&msg);
+    }
+  }
+}
+
+/**
+  * @brief  USBD_IPC_Doorbell
+  *         Wake the core draining a ring
+  * @param  ring: USBD_IPC_TO_SERVICE or USBD_IPC_TO_STACK
+  * @retval None
+  */
+void USBD_IPC_Doorbell(uint8_t ring)
+{
+#if defined(HAL_HSEM_MODULE_ENABLED)
+  uint32_t sem = (ring == USBD_IPC_TO_SERVICE) ? USBD_IPC_HSEM_SERVICE : USBD_IPC_HSEM_STACK;
+
+  /* The release raises the free interrupt of the core waiting on it */
+  if (HAL_HSEM_FastTake(sem) == HAL_OK)
+  {
+    HAL_HSEM_Release(sem, 0U);
+  }
+#else
+  /* No doorbell, the other core polls USBD_IPC_IF_Process */
+  UNUSED(ring);
+#endif /* HAL_HSEM_MODULE_ENABLED */
+}
+
+#if defined(HAL_HSEM_MODULE_ENABLED)
+/**
+  * @brief  HAL_HSEM_FreeCallback
+  *         Doorbell interrupt, the notification is one shot and is armed
+  *         again before the ring is drained
+  * @param  SemMask: semaphores released
+  * @retval None
+  */
+void HAL_HSEM_FreeCallback(uint32_t SemMask)
+{
+  uint32_t sem = (USBD_IPC_IF_Ring == USBD_IPC_TO_STACK) ? USBD_IPC_HSEM_STACK : USBD_IPC_HSEM_SERVICE;
+
+  if ((SemMask & __HAL_HSEM_SEMID_TO_MASK(sem)) != 0U)
+  {
+    HAL_HSEM_ActivateNotification(__HAL_HSEM_SEMID_TO_MASK(sem));
+    USBD_IPC_IF_Process();
+  }
+}
+#endif /* HAL_HSEM_MODULE_ENABLED */
+
+/**
+  * @brief  USBD_IPC_IF_Arm
+  *         Enable the doorbell interrupt of this core
+  * @param  sem: hardware semaphore the other core releases
+  * @retval None
+  */
+static void USBD_IPC_IF_Arm(uint32_t sem)
+{
+#if defined(HAL_HSEM_MODULE_ENABLED)
+  __HAL_RCC_HSEM_CLK_ENABLE();
+  HAL_HSEM_ActivateNotification(__HAL_HSEM_SEMID_TO_MASK(sem));
+#else
+  UNUSED(sem);
+#endif /* HAL_HSEM_MODULE_ENABLED */
+}
+
+/**
+  * @brief  USBD_IPC_IF_Call
+  *         Run an interface call on the service side core
+  * @param  itf: USBD_IPC_ITF_xxx
+  * @param  op: USBD_IPC_OP_xxx
+  * @param  ch: channel or logical unit
+  * @param  pbuf: buffer lent to the service side for the call
+  * @param  len: buffer length
+  * @param  pmsg: message, arg[] set by the caller, updated from the reply
+  * @retval status returned by the service side interface, -1 without reply
+  */
+static int8_t USBD_IPC_IF_Call(uint8_t itf, uint8_t op, uint8_t ch, uint8_t *pbuf,
+                               uint32_t len, USBD_IPC_MsgTypeDef *pmsg)
+{
+  pmsg->op = op;
+  pmsg->itf = itf;
+  pmsg->ch = ch;
+  pmsg->status = 0;
+  pmsg->pbuf = pbuf;
+  pmsg->len = len;
+
+  if (USBD_IPC_Call(pmsg) != USBD_OK)
+  {
+    USBD_ErrLog("Call to the service core cancelled, op %d", (int)op);
+    return -1;
+  }
+
+  return pmsg->status;
+}
+
+/**
+  * @brief  USBD_IPC_IF_StackServe
+  *         Handle a message posted to the stack side core
+  * @param  pmsg: message
+  * @retval None
+  */
+static void USBD_IPC_IF_StackServe(USBD_IPC_MsgTypeDef *pmsg)
+{
+  USBD_HandleTypeDef *pdev = USBD_IPC_IF_Dev;
+  uint8_t classId = pdev->classId;
+  uint8_t ret = (uint8_t)USBD_FAIL;
+
+  switch (pmsg->itf)
+  {
+#if (USBD_USE_CDC_ACM == 1)
+    case USBD_IPC_ITF_CDC_ACM:
+      if (pmsg->op == USBD_IPC_OP_RX_RELEASE)
+      {
+        (void)USBD_CDC_ReleaseRxBuffer(pmsg->ch, pdev, pmsg->pbuf);
+        break;
+      }
+
+      if (pmsg->op == USBD_IPC_OP_TRANSMIT)
+      {
+        (void)USBD_CDC_SetTxBuffer(pmsg->ch, pdev, pmsg->pbuf, pmsg->len);
+        ret = USBD_CDC_TransmitPacket(pmsg->ch, pdev);
+      }
+      break;
+#endif /* (USBD_USE_CDC_ACM == 1) */
+
+#if (USBD_USE_CDC_RNDIS == 1)
+    case USBD_IPC_ITF_CDC_RNDIS:
+      if (pmsg->op == USBD_IPC_OP_RX_RELEASE)
+      {
+        /* The class left the Rx buffer on the payload of the last frame */
+        if (USBD_CDC_RNDIS_SetRxBuffer(pdev, USBD_IPC_IF_RndisRx) == (uint8_t)USBD_OK)
+        {
+          ((USBD_CDC_RNDIS_HandleTypeDef *)USBD_CLASS_DATA(pdev))->RxLength = 0U;
+          ((USBD_CDC_RNDIS_HandleTypeDef *)USBD_CLASS_DATA(pdev))->RxState = 0U;
+          (void)USBD_CDC_RNDIS_ReceivePacket(pdev);
+        }
+        break;
+      }
+
+      if (pmsg->op == USBD_IPC_OP_TRANSMIT)
+      {
+        if (USBD_CDC_RNDIS_SetTxBuffer(pdev, pmsg->pbuf, pmsg->len) == (uint8_t)USBD_OK)
+        {
+          ret = USBD_CDC_RNDIS_TransmitPacket(pdev);
+        }
+      }
+      break;
+#endif /* (USBD_USE_CDC_RNDIS == 1) */
+
+    default:
+      break;
+  }
+
+  /* A frame the class did not take goes back to its owner at once */
+  if ((pmsg->op == USBD_IPC_OP_TRANSMIT) && (ret != (uint8_t)USBD_OK))
+  {
+    pmsg->op = USBD_IPC_OP_TX_CPLT;
+    pmsg->status = (int8_t)ret;
+    pmsg->arg[0] = 0U;
+    (void)USBD_IPC_Post(USBD_IPC_TO_SERVICE, pmsg);
+  }
+
+  pdev->classId = classId;
+}
+
+/**
+  * @brief  USBD_IPC_IF_Serve
+  *         Handle a message posted to the service side core
+  * @param  pmsg: message
+  * @retval None
+  */
+static void USBD_IPC_IF_Serve(USBD_IPC_MsgTypeDef *pmsg)
+{
+  /* A call the stack side timed out on is dropped, its buffer is back
+     there already */
+  if ((pmsg->seq != 0U) && (USBD_IPC_Claim(pmsg) != USBD_OK))
+  {
+    return;
+  }
+
+  switch (pmsg->itf)
+  {
+#if (USBD_USE_MSC == 1)
+    case USBD_IPC_ITF_MSC:
+      USBD_IPC_IF_ServeStorage(pmsg);
+      break;
+#endif
+#if (USBD_USE_CDC_ACM == 1)
+    case USBD_IPC_ITF_CDC_ACM:
+      USBD_IPC_IF_ServeAcm(pmsg);
+      break;
+#endif
+#if (USBD_USE_CDC_RNDIS == 1)
+    case USBD_IPC_ITF_CDC_RNDIS:
+      USBD_IPC_IF_ServeRndis(pmsg);
+      break;
+#endif
+    default:
+      pmsg->status = -1;
+      break;
+  }
+
+  /* Every call gets a reply, or the stack side core waits until timeout */
+  if (pmsg->seq != 0U)
+  {
+    USBD_IPC_Reply(pmsg);
+  }
+}
+
+#if (USBD_USE_MSC == 1)
+/**
+  * @brief  USBD_IPC_RegisterStorage
+  *         Register the storage interface run on the service side core
+  * @param  fops: storage interface
+  * @retval None
+  */
+void USBD_IPC_RegisterStorage(USBD_StorageTypeDef *fops)
+{
+  USBD_IPC_IF_Storage = fops;
+}
+
+/**
+  * @brief  USBD_IPC_IF_ServeStorage
+  *         Run a storage call on the service side core
+  * @param  pmsg: call message, status and arguments are set for the reply
+  * @retval None
+  */
+static void USBD_IPC_IF_ServeStorage(USBD_IPC_MsgTypeDef *pmsg)
+{
+  USBD_StorageTypeDef *fops = USBD_IPC_IF_Storage;
+  uint16_t block_size = 0U;
+
+  if (fops == NULL)
+  {
+    pmsg->status = -1;
+    return;
+  }
+
+  switch (pmsg->op)
+  {
+    case USBD_IPC_OP_INIT:
+      pmsg->status = fops->Init(pmsg->ch);
+      pmsg->pbuf = (uint8_t *)fops->pInquiry;
+      break;
+
+    case USBD_IPC_OP_CAPACITY:
+      pmsg->status = fops->GetCapacity(pmsg->ch, &pmsg->arg[0], &block_size);
+      pmsg->arg[1] = block_size;
+      break;
+
+    case USBD_IPC_OP_IS_READY:
+      pmsg->status = fops->IsReady(pmsg->ch);
+      break;
+
+    case USBD_IPC_OP_IS_WP:
+      pmsg->status = fops->IsWriteProtected(pmsg->ch);
+      break;
+
+    case USBD_IPC_OP_READ:
+      pmsg->status = fops->Read(pmsg->ch, pmsg->pbuf, pmsg->arg[0], (uint16_t)pmsg->arg[1]);
+      break;
+
+    case USBD_IPC_OP_WRITE:
+      pmsg->status = fops->Write(pmsg->ch, pmsg->pbuf, pmsg->arg[0], (uint16_t)pmsg->arg[1]);
+      break;
+
+    case USBD_IPC_OP_MAX_LUN:
+      pmsg->status = fops->GetMaxLun();
+      break;
+
+    default:
+      pmsg->status = -1;
+      break;
+  }
+}
+
+/**
+  * @brief  IPC_STORAGE_Init
+  *         Initialize the storage unit on the service side core and take
+  *         its inquiry data
+  * @param  lun: logical unit
+  * @retval status
+  */
+static int8_t IPC_STORAGE_Init(uint8_t lun)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+  int8_t ret = USBD_IPC_IF_Call(USBD_IPC_ITF_MSC, USBD_IPC_OP_INIT, lun, NULL, 0U, &msg);
+
+  if (ret == 0)
+  {
+    USBD_IPC_Storage_fops.pInquiry = (int8_t *)(void *)msg.pbuf;
+  }
+
+  return ret;
+}
+
+/**
+  * @brief  IPC_STORAGE_GetCapacity
+  * @param  lun: logical unit
+  * @param  block_num: number of blocks
+  * @param  block_size: block size
+  * @retval status
+  */
+static int8_t IPC_STORAGE_GetCapacity(uint8_t lun, uint32_t *block_num, uint16_t *block_size)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+  int8_t ret = USBD_IPC_IF_Call(USBD_IPC_ITF_MSC, USBD_IPC_OP_CAPACITY, lun, NULL, 0U, &msg);
+
+  *block_num = msg.arg[0];
+  *block_size = (uint16_t)msg.arg[1];
+
+  return ret;
+}
+
+/**
+  * @brief  IPC_STORAGE_IsReady
+  * @param  lun: logical unit
+  * @retval status
+  */
+static int8_t IPC_STORAGE_IsReady(uint8_t lun)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+
+  return USBD_IPC_IF_Call(USBD_IPC_ITF_MSC, USBD_IPC_OP_IS_READY, lun, NULL, 0U, &msg);
+}
+
+/**
+  * @brief  IPC_STORAGE_IsWriteProtected
+  * @param  lun: logical unit
+  * @retval status
+  */
+static int8_t IPC_STORAGE_IsWriteProtected(uint8_t lun)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+
+  return USBD_IPC_IF_Call(USBD_IPC_ITF_MSC, USBD_IPC_OP_IS_WP, lun, NULL, 0U, &msg);
+}
+
+/**
+  * @brief  IPC_STORAGE_Read
+  *         The class buffer is filled by the service side core in place
+  * @param  lun: logical unit
+  * @param  buf: class data buffer
+  * @param  blk_addr: first block
+  * @param  blk_len: number of blocks
+  * @retval status
+  */
+static int8_t IPC_STORAGE_Read(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+
+  msg.arg[0] = blk_addr;
+  msg.arg[1] = blk_len;
+
+  return USBD_IPC_IF_Call(USBD_IPC_ITF_MSC, USBD_IPC_OP_READ, lun, buf, 0U, &msg);
+}
+
+/**
+  * @brief  IPC_STORAGE_Write
+  *         The class buffer is read by the service side core in place
+  * @param  lun: logical unit
+  * @param  buf: class data buffer
+  * @param  blk_addr: first block
+  * @param  blk_len: number of blocks
+  * @retval status
+  */
+static int8_t IPC_STORAGE_Write(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+
+  msg.arg[0] = blk_addr;
+  msg.arg[1] = blk_len;
+
+  return USBD_IPC_IF_Call(USBD_IPC_ITF_MSC, USBD_IPC_OP_WRITE, lun, buf, 0U, &msg);
+}
+
+/**
+  * @brief  IPC_STORAGE_GetMaxLun
+  * @param  None
+  * @retval highest logical unit number
+  */
+static int8_t IPC_STORAGE_GetMaxLun(void)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+  int8_t ret = USBD_IPC_IF_Call(USBD_IPC_ITF_MSC, USBD_IPC_OP_MAX_LUN, 0U, NULL, 0U, &msg);
+
+  /* Without the service side core the device shows a single unit */
+  return (ret < 0) ? 0 : ret;
+}
+#endif /* (USBD_USE_MSC == 1) */
+
+#if (USBD_USE_CDC_ACM == 1)
+/**
+  * @brief  USBD_IPC_RegisterCDC_ACM
+  *         Register the CDC ACM interface run on the service side core. Its
+  *         Receive gives the buffer back by returning
+  * @param  fops: CDC ACM interface
+  * @retval None
+  */
+void USBD_IPC_RegisterCDC_ACM(USBD_CDC_ACM_ItfTypeDef *fops)
+{
+  USBD_IPC_IF_Acm = fops;
+}
+
+/**
+  * @brief  USBD_IPC_CDC_ACM_Transmit
+  *         Send data from the service side core, the buffer comes back
+  *         through TransmitCplt, with a non zero Len on success only
+  * @param  ch: CDC channel
+  * @param  pbuf: data, cache line aligned
+  * @param  length: data length
+  * @retval USBD_OK, USBD_BUSY when the ring is full
+  */
+USBD_StatusTypeDef USBD_IPC_CDC_ACM_Transmit(uint8_t ch, uint8_t *pbuf, uint32_t length)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+
+  USBD_IPC_CLEAN(pbuf, length);
+
+  msg.op = USBD_IPC_OP_TRANSMIT;
+  msg.itf = USBD_IPC_ITF_CDC_ACM;
+  msg.ch = ch;
+  msg.pbuf = pbuf;
+  msg.len = length;
+
+  return USBD_IPC_Post(USBD_IPC_TO_STACK, &msg);
+}
+
+/**
+  * @brief  USBD_IPC_IF_ServeAcm
+  *         Run a CDC ACM message on the service side core
+  * @param  pmsg: message
+  * @retval None
+  */
+static void USBD_IPC_IF_ServeAcm(USBD_IPC_MsgTypeDef *pmsg)
+{
+  USBD_CDC_ACM_ItfTypeDef *fops = USBD_IPC_IF_Acm;
+  uint32_t len = pmsg->len;
+
+  if (fops == NULL)
+  {
+    pmsg->status = -1;
+    return;
+  }
+
+  switch (pmsg->op)
+  {
+    case USBD_IPC_OP_INIT:
+      pmsg->status = fops->Init(pmsg->ch);
+      break;
+
+    case USBD_IPC_OP_DEINIT:
+      pmsg->status = fops->DeInit(pmsg->ch);
+      break;
+
+    case USBD_IPC_OP_CONTROL:
+      pmsg->status = fops->Control(pmsg->ch, (uint8_t)pmsg->arg[0], pmsg->pbuf, (uint16_t)pmsg->len);
+      break;
+
+    case USBD_IPC_OP_RECEIVE:
+      (void)fops->Receive(pmsg->ch, pmsg->pbuf, &len);
+      pmsg->op = USBD_IPC_OP_RX_RELEASE;
+      (void)USBD_IPC_Post(USBD_IPC_TO_STACK, pmsg);
+      break;
+
+    case USBD_IPC_OP_TX_CPLT:
+      if (pmsg->status != 0)
+      {
+        len = 0U;
+      }
+      (void)fops->TransmitCplt(pmsg->ch, pmsg->pbuf, &len, (uint8_t)pmsg->arg[0]);
+      break;
+
+    default:
+      pmsg->status = -1;
+      break;
+  }
+}
+
+/**
+  * @brief  IPC_CDC_Init
+  *         Initialize the channel on the service side core
+  * @param  cdc_ch: CDC channel
+  * @retval status
+  */
+static int8_t IPC_CDC_Init(uint8_t cdc_ch)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+
+  return USBD_IPC_IF_Call(USBD_IPC_ITF_CDC_ACM, USBD_IPC_OP_INIT, cdc_ch, NULL, 0U, &msg);
+}
+
+/**
+  * @brief  IPC_CDC_DeInit
+  * @param  cdc_ch: CDC channel
+  * @retval status
+  */
+static int8_t IPC_CDC_DeInit(uint8_t cdc_ch)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+
+  return USBD_IPC_IF_Call(USBD_IPC_ITF_CDC_ACM, USBD_IPC_OP_DEINIT, cdc_ch, NULL, 0U, &msg);
+}
+
+/**
+  * @brief  IPC_CDC_Control
+  *         The request data is read or written by the service side core in
+  *         place
+  * @param  cdc_ch: CDC channel
+  * @param  cmd: command code
+  * @param  pbuf: request data
+  * @param  length: request data length
+  * @retval status
+  */
+static int8_t IPC_CDC_Control(uint8_t cdc_ch, uint8_t cmd, uint8_t *pbuf, uint16_t length)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+
+  msg.arg[0] = cmd;
+
+  return USBD_IPC_IF_Call(USBD_IPC_ITF_CDC_ACM, USBD_IPC_OP_CONTROL, cdc_ch, pbuf, length, &msg);
+}
+
+/**
+  * @brief  IPC_CDC_Receive
+  *         Hand a pool buffer to the service side core, it returns to the
+  *         pool when the service side gives it back
+  * @param  cdc_ch: CDC channel
+  * @param  Buf: received data
+  * @param  Len: received length
+  * @retval status
+  */
+static int8_t IPC_CDC_Receive(uint8_t cdc_ch, uint8_t *Buf, uint32_t *Len)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+
+  msg.op = USBD_IPC_OP_RECEIVE;
+  msg.itf = USBD_IPC_ITF_CDC_ACM;
+  msg.ch = cdc_ch;
+  msg.pbuf = Buf;
+  msg.len = *Len;
+
+  if (USBD_IPC_Post(USBD_IPC_TO_SERVICE, &msg) != USBD_OK)
+  {
+    /* Drop the data rather than keep the buffer */
+    (void)USBD_CDC_ReleaseRxBuffer(cdc_ch, USBD_IPC_IF_Dev, Buf);
+    return (int8_t)USBD_FAIL;
+  }
+
+  return (int8_t)USBD_OK;
+}
+
+/**
+  * @brief  IPC_CDC_TransmitCplt
+  *         Give a sent buffer back to the service side core
+  * @param  cdc_ch: CDC channel
+  * @param  Buf: sent data
+  * @param  Len: sent length
+  * @param  epnum: endpoint number
+  * @retval status
+  */
+static int8_t IPC_CDC_TransmitCplt(uint8_t cdc_ch, uint8_t *Buf, uint32_t *Len, uint8_t epnum)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+
+  msg.op = USBD_IPC_OP_TX_CPLT;
+  msg.itf = USBD_IPC_ITF_CDC_ACM;
+  msg.ch = cdc_ch;
+  msg.pbuf = Buf;
+  msg.len = *Len;
+  msg.arg[0] = epnum;
+
+  return (int8_t)USBD_IPC_Post(USBD_IPC_TO_SERVICE, &msg);
+}
+#endif /* (USBD_USE_CDC_ACM == 1) */
+
+#if (USBD_USE_CDC_RNDIS == 1)
+/**
+  * @brief  USBD_IPC_RegisterCDC_RNDIS
+  *         Register the RNDIS interface run on the service side core. Its
+  *         Receive gives the frame back by returning
+  * @param  fops: RNDIS interface
+  * @retval None
+  */
+void USBD_IPC_RegisterCDC_RNDIS(USBD_CDC_RNDIS_ItfTypeDef *fops)
+{
+  USBD_IPC_IF_Rndis = fops;
+}
+
+/**
+  * @brief  USBD_IPC_CDC_RNDIS_Transmit
+  *         Send an Ethernet frame from the service side core, the buffer
+  *         comes back through TransmitCplt, with a non zero Len on success
+  *         only
+  * @param  pbuf: frame without RNDIS header, cache line aligned
+  * @param  length: frame length
+  * @retval USBD_OK, USBD_BUSY when the ring is full
+  */
+USBD_StatusTypeDef USBD_IPC_CDC_RNDIS_Transmit(uint8_t *pbuf, uint32_t length)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+
+  USBD_IPC_CLEAN(pbuf, length);
+
+  msg.op = USBD_IPC_OP_TRANSMIT;
+  msg.itf = USBD_IPC_ITF_CDC_RNDIS;
+  msg.pbuf = pbuf;
+  msg.len = length;
+
+  return USBD_IPC_Post(USBD_IPC_TO_STACK, &msg);
+}
+
+/**
+  * @brief  USBD_IPC_IF_ServeRndis
+  *         Run an RNDIS message on the service side core
+  * @param  pmsg: message
+  * @retval None
+  */
+static void USBD_IPC_IF_ServeRndis(USBD_IPC_MsgTypeDef *pmsg)
+{
+  USBD_CDC_RNDIS_ItfTypeDef *fops = USBD_IPC_IF_Rndis;
+  uint32_t len = pmsg->len;
+
+  if (fops == NULL)
+  {
+    pmsg->status = -1;
+    return;
+  }
+
+  switch (pmsg->op)
+  {
+    case USBD_IPC_OP_INIT:
+      pmsg->status = fops->Init();
+      break;
+
+    case USBD_IPC_OP_DEINIT:
+      pmsg->status = fops->DeInit();
+      break;
+
+    case USBD_IPC_OP_CONTROL:
+      pmsg->status = fops->Control((uint8_t)pmsg->arg[0], pmsg->pbuf, (uint16_t)pmsg->len);
+      break;
+
+    case USBD_IPC_OP_RECEIVE:
+      (void)fops->Receive(pmsg->pbuf, &len);
+      pmsg->op = USBD_IPC_OP_RX_RELEASE;
+      (void)USBD_IPC_Post(USBD_IPC_TO_STACK, pmsg);
+      break;
+
+    case USBD_IPC_OP_TX_CPLT:
+      if (pmsg->status != 0)
+      {
+        len = 0U;
+      }
+      (void)fops->TransmitCplt(pmsg->pbuf, &len, (uint8_t)pmsg->arg[0]);
+      break;
+
+    default:
+      pmsg->status = -1;
+      break;
+  }
+}
+
+/**
+  * @brief  IPC_RNDIS_Init
+  *         Point the class at a buffer of the stack side core and initialize
+  *         the interface on the service side core
+  * @param  None
+  * @retval status
+  */
+static int8_t IPC_RNDIS_Init(void)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+
+  (void)USBD_CDC_RNDIS_SetRxBuffer(USBD_IPC_IF_Dev, USBD_IPC_IF_RndisRx);
+
+  return USBD_IPC_IF_Call(USBD_IPC_ITF_CDC_RNDIS, USBD_IPC_OP_INIT, 0U, NULL, 0U, &msg);
+}
+
+/**
+  * @brief  IPC_RNDIS_DeInit
+  * @param  None
+  * @retval status
+  */
+static int8_t IPC_RNDIS_DeInit(void)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+
+  return USBD_IPC_IF_Call(USBD_IPC_ITF_CDC_RNDIS, USBD_IPC_OP_DEINIT, 0U, NULL, 0U, &msg);
+}
+
+/**
+  * @brief  IPC_RNDIS_Control
+  * @param  cmd: command code
+  * @param  pbuf: request data
+  * @param  length: request data length
+  * @retval status
+  */
+static int8_t IPC_RNDIS_Control(uint8_t cmd, uint8_t *pbuf, uint16_t length)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+
+  msg.arg[0] = cmd;
+
+  return USBD_IPC_IF_Call(USBD_IPC_ITF_CDC_RNDIS, USBD_IPC_OP_CONTROL, 0U, pbuf, length, &msg);
+}
+
+/**
+  * @brief  IPC_RNDIS_Receive
+  *         Hand a received frame to the service side core, the endpoint is
+  *         armed again when it gives the buffer back
+  * @param  Buf: frame payload
+  * @param  Len: frame length
+  * @retval status
+  */
+static int8_t IPC_RNDIS_Receive(uint8_t *Buf, uint32_t *Len)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+
+  msg.op = USBD_IPC_OP_RECEIVE;
+  msg.itf = USBD_IPC_ITF_CDC_RNDIS;
+  msg.pbuf = Buf;
+  msg.len = *Len;
+
+  if (USBD_IPC_Post(USBD_IPC_TO_SERVICE, &msg) != USBD_OK)
+  {
+    /* Drop the frame rather than stall the link */
+    msg.op = USBD_IPC_OP_RX_RELEASE;
+    USBD_IPC_IF_StackServe(&msg);
+    return (int8_t)USBD_FAIL;
+  }
+
+  return (int8_t)USBD_OK;
+}
+
+/**
+  * @brief  IPC_RNDIS_TransmitCplt
+  *         Give a sent frame back to the service side core
+  * @param  Buf: frame
+  * @param  Len: frame length
+  * @param  epnum: endpoint number
+  * @retval status
+  */
+static int8_t IPC_RNDIS_TransmitCplt(uint8_t *Buf, uint32_t *Len, uint8_t epnum)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+
+  msg.op = USBD_IPC_OP_TX_CPLT;
+  msg.itf = USBD_IPC_ITF_CDC_RNDIS;
+  msg.pbuf = Buf;
+  msg.len = *Len;
+  msg.arg[0] = epnum;
+
+  return (int8_t)USBD_IPC_Post(USBD_IPC_TO_SERVICE, &msg);
+}
+
+/**
+  * @brief  IPC_RNDIS_Process
+  *         Frames are processed on the service side core
+  * @param  pdev: device handle
+  * @retval status
+  */
+static int8_t IPC_RNDIS_Process(USBD_HandleTypeDef *pdev)
+{
+  UNUSED(pdev);
+
+  return (int8_t)USBD_OK;
+}
+#endif /* (USBD_USE_CDC_RNDIS == 1) */
+
+#endif /* (USBD_USE_IPC == 1U) */
+
+/********************************** END OF FILE *******************************/
@@ -64,11 +64,6 @@
 #define _AUDIO_MIC_AS_ITF_NBR 0x01U
 #define _AUDIO_MIC_STR_DESC_IDX 0x00U
 
-uint8_t AUDIO_MIC_EP = _AUDIO_MIC_EP;
-uint8_t AUDIO_MIC_AC_ITF_NBR = _AUDIO_MIC_AC_ITF_NBR;
-uint8_t AUDIO_MIC_AS_ITF_NBR = _AUDIO_MIC_AS_ITF_NBR;
-uint8_t AUDIO_MIC_STR_DESC_IDX = _AUDIO_MIC_STR_DESC_IDX;
-
 /** @addtogroup STM32_USB_OTG_DEVICE_LIBRARY
 * @{
 */
@@ -106,8 +101,8 @@ uint8_t AUDIO_MIC_STR_DESC_IDX = _AUDIO_MIC_STR_DESC_IDX;
 static uint8_t USBD_AUDIO_MIC_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
 static uint8_t USBD_AUDIO_MIC_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
 static uint8_t USBD_AUDIO_MIC_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
-static uint8_t *USBD_AUDIO_MIC_GetCfgDesc(uint16_t *length);
-static uint8_t *USBD_AUDIO_MIC_GetDeviceQualifierDesc(uint16_t *length);
+static uint8_t *USBD_AUDIO_MIC_GetCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_AUDIO_MIC_GetDeviceQualifierDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
 static uint8_t USBD_AUDIO_MIC_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum);
 static uint8_t USBD_AUDIO_MIC_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum);
 static uint8_t USBD_AUDIO_MIC_EP0_RxReady(USBD_HandleTypeDef *pdev);
@@ -130,8 +125,8 @@ static void USBD_AUDIO_MIC_REQ_GetResolution(USBD_HandleTypeDef *pdev, USBD_Setu
   */
 /* This dummy buffer with 0 values will be sent when there is no availble data */
 static uint8_t IsocInBuffDummy[48 * 4 * 2];
-static int16_t VOL_CUR;
-static USBD_AUDIO_MIC_HandleTypeDef haudioInstance;
+static int16_t VOL_CUR[USBD_MAX_NUM_DEV][USBD_AUDIO_MIC_MAX_INST];
+static USBD_AUDIO_MIC_HandleTypeDef haudioInstance[USBD_MAX_NUM_DEV][USBD_AUDIO_MIC_MAX_INST];
 
 USBD_ClassTypeDef USBD_AUDIO_MIC =
     {
@@ -385,14 +380,14 @@ __ALIGN_BEGIN static uint8_t USBD_AUDIO_MIC_DeviceQualifierDesc[USB_LEN_DEV_QUAL
   */
 static uint8_t USBD_AUDIO_MIC_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
 {
-  if (haudioInstance.state != STATE_USB_WAITING_FOR_INIT)
+  if (haudioInstance[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)].state != STATE_USB_WAITING_FOR_INIT)
   {
     return USBD_FAIL;
   }
 
   USBD_AUDIO_MIC_HandleTypeDef *haudio;
-  pdev->pClassData_UAC_MIC = &haudioInstance;
-  haudio = (USBD_AUDIO_MIC_HandleTypeDef *)pdev->pClassData_UAC_MIC;
+  USBD_CLASS_DATA(pdev) = &haudioInstance[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)];
+  haudio = (USBD_AUDIO_MIC_HandleTypeDef *)USBD_CLASS_DATA(pdev);
   if (haudio->paketDimension == 0)
   {
     haudio->paketDimension = 1;
@@ -403,16 +398,16 @@ static uint8_t USBD_AUDIO_MIC_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   haudio->rd_ptr = 0;
   haudio->timeout = 0;
 
-  ((USBD_AUDIO_MIC_ItfTypeDef *)pdev->pUserData_UAC_MIC)->Init(haudio->frequency, 0, haudio->channels);
+  ((USBD_AUDIO_MIC_ItfTypeDef *)USBD_USER_DATA(pdev))->Init(haudio->frequency, 0, haudio->channels);
 
   USBD_LL_OpenEP(pdev,
-                 AUDIO_MIC_EP,
+                 AUDIO_MIC_EP(pdev),
                  USBD_EP_TYPE_ISOC,
                  AUDIO_MIC_PACKET);
 
-  USBD_LL_FlushEP(pdev, AUDIO_MIC_EP);
+  USBD_LL_FlushEP(pdev, AUDIO_MIC_EP(pdev));
 
-  USBD_LL_Transmit(pdev, AUDIO_MIC_EP,
+  USBD_LL_Transmit(pdev, AUDIO_MIC_EP(pdev),
                    IsocInBuffDummy,
                    packet_dim);
 
@@ -430,12 +425,12 @@ static uint8_t USBD_AUDIO_MIC_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
 static uint8_t USBD_AUDIO_MIC_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
 {
   /* Close EP IN */
-  USBD_LL_CloseEP(pdev, AUDIO_MIC_EP);
+  USBD_LL_CloseEP(pdev, AUDIO_MIC_EP(pdev));
   /* DeInit  physical Interface components */
-  if (pdev->pClassData_UAC_MIC != NULL)
+  if (USBD_CLASS_DATA(pdev) != NULL)
   {
-    ((USBD_AUDIO_MIC_ItfTypeDef *)pdev->pUserData_UAC_MIC)->DeInit(0);
-    haudioInstance.state = STATE_USB_WAITING_FOR_INIT;
+    ((USBD_AUDIO_MIC_ItfTypeDef *)USBD_USER_DATA(pdev))->DeInit(0);
+    haudioInstance[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)].state = STATE_USB_WAITING_FOR_INIT;
   }
   return USBD_OK;
 }
@@ -456,7 +451,7 @@ static uint8_t USBD_AUDIO_MIC_Setup(USBD_HandleTypeDef *pdev,
   uint16_t status_info = 0U;
   USBD_StatusTypeDef ret = USBD_OK;
 
-  haudio = (USBD_AUDIO_MIC_HandleTypeDef *)pdev->pClassData_UAC_MIC;
+  haudio = (USBD_AUDIO_MIC_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (haudio == NULL)
   {
@@ -576,11 +571,14 @@ static uint8_t USBD_AUDIO_MIC_Setup(USBD_HandleTypeDef *pdev,
   * @brief  USBD_AUDIO_GetCfgDesc
   *         return configuration descriptor
   * @param  speed : current device speed
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_AUDIO_MIC_GetCfgDesc(uint16_t *length)
+static uint8_t *USBD_AUDIO_MIC_GetCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_AUDIO_MIC_CfgDesc);
 
   return USBD_AUDIO_MIC_CfgDesc;
@@ -601,7 +599,7 @@ static uint8_t USBD_AUDIO_MIC_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
 
   USBD_AUDIO_MIC_HandleTypeDef *haudio;
 
-  haudio = pdev->pClassData_UAC_MIC;
+  haudio = USBD_CLASS_DATA(pdev);
 
   rd_ptr = haudio->rd_ptr;
   wr_ptr = haudio->wr_ptr;
@@ -614,12 +612,12 @@ static uint8_t USBD_AUDIO_MIC_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
   uint16_t channels = haudio->channels;
   length_usb_pck = packet_dim;
   haudio->timeout = 0;
-  if (epnum == (AUDIO_MIC_EP & 0x7F))
+  if (epnum == (AUDIO_MIC_EP(pdev) & 0x7F))
   {
     if (haudio->state == STATE_USB_IDLE)
     {
       haudio->state = STATE_USB_REQUESTS_STARTED;
-      ((USBD_AUDIO_MIC_ItfTypeDef *)pdev->pUserData_UAC_MIC)->Record();
+      ((USBD_AUDIO_MIC_ItfTypeDef *)USBD_USER_DATA(pdev))->Record();
     }
     if (haudio->state == STATE_USB_BUFFER_WRITE_STARTED)
     {
@@ -640,14 +638,14 @@ static uint8_t USBD_AUDIO_MIC_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
       {
         length_usb_pck -= channels * 2;
       }
-      USBD_LL_Transmit(pdev, AUDIO_MIC_EP,
+      USBD_LL_Transmit(pdev, AUDIO_MIC_EP(pdev),
                        (uint8_t *)(&haudio->buffer[haudio->rd_ptr]),
                        length_usb_pck);
       haudio->rd_ptr += length_usb_pck;
 
       if (app < haudio->buffer_length / 10)
       {
-        ((USBD_AUDIO_MIC_ItfTypeDef *)pdev->pUserData_UAC_MIC)->Stop();
+        ((USBD_AUDIO_MIC_ItfTypeDef *)USBD_USER_DATA(pdev))->Stop();
         haudio->state = STATE_USB_IDLE;
         haudio->timeout = 0;
         memset(haudio->buffer, 0, (haudio->buffer_length + haudio->dataAmount));
@@ -655,7 +653,7 @@ static uint8_t USBD_AUDIO_MIC_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
     }
     else
     {
-      USBD_LL_Transmit(pdev, AUDIO_MIC_EP,
+      USBD_LL_Transmit(pdev, AUDIO_MIC_EP(pdev),
                        IsocInBuffDummy,
                        length_usb_pck);
     }
@@ -673,12 +671,12 @@ static uint8_t USBD_AUDIO_MIC_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
 static uint8_t USBD_AUDIO_MIC_EP0_RxReady(USBD_HandleTypeDef *pdev)
 {
   USBD_AUDIO_MIC_HandleTypeDef *haudio;
-  haudio = pdev->pClassData_UAC_MIC;
+  haudio = USBD_CLASS_DATA(pdev);
   if (haudio->control.cmd == AUDIO_REQ_SET_CUR)
   {
     if (haudio->control.unit == AUDIO_STREAMING_CTRL)
     {
-      ((USBD_AUDIO_MIC_ItfTypeDef *)pdev->pUserData_UAC_MIC)->VolumeCtl(VOL_CUR);
+      ((USBD_AUDIO_MIC_ItfTypeDef *)USBD_USER_DATA(pdev))->VolumeCtl(VOL_CUR[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)]);
 
       haudio->control.cmd = 0;
       haudio->control.len = 0;
@@ -757,8 +755,10 @@ static uint8_t USBD_AUDIO_MIC_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
 * @param  length : pointer data length
 * @retval pointer to descriptor buffer
 */
-static uint8_t *USBD_AUDIO_MIC_GetDeviceQualifierDesc(uint16_t *length)
+static uint8_t *USBD_AUDIO_MIC_GetDeviceQualifierDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = sizeof(USBD_AUDIO_MIC_DeviceQualifierDesc);
   return USBD_AUDIO_MIC_DeviceQualifierDesc;
 }
@@ -773,7 +773,7 @@ static uint8_t *USBD_AUDIO_MIC_GetDeviceQualifierDesc(uint16_t *length)
 static void USBD_AUDIO_MIC_REQ_GetMaximum(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
   USBD_AUDIO_MIC_HandleTypeDef *haudio;
-  haudio = pdev->pClassData_UAC_MIC;
+  haudio = USBD_CLASS_DATA(pdev);
 
   (haudio->control.data)[0] = (uint16_t)AUDIO_MIC_VOL_MAX & 0xFF;
   (haudio->control.data)[1] = ((uint16_t)AUDIO_MIC_VOL_MAX & 0xFF00) >> 8;
@@ -793,7 +793,7 @@ static void USBD_AUDIO_MIC_REQ_GetMaximum(USBD_HandleTypeDef *pdev, USBD_SetupRe
 static void USBD_AUDIO_MIC_REQ_GetMinimum(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
   USBD_AUDIO_MIC_HandleTypeDef *haudio;
-  haudio = pdev->pClassData_UAC_MIC;
+  haudio = USBD_CLASS_DATA(pdev);
   (haudio->control.data)[0] = (uint16_t)AUDIO_MIC_VOL_MIN & 0xFF;
   (haudio->control.data)[1] = ((uint16_t)AUDIO_MIC_VOL_MIN & 0xFF00) >> 8;
   /* Send the current mute state */
@@ -812,7 +812,7 @@ static void USBD_AUDIO_MIC_REQ_GetMinimum(USBD_HandleTypeDef *pdev, USBD_SetupRe
 static void USBD_AUDIO_MIC_REQ_GetResolution(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
   USBD_AUDIO_MIC_HandleTypeDef *haudio;
-  haudio = pdev->pClassData_UAC_MIC;
+  haudio = USBD_CLASS_DATA(pdev);
   (haudio->control.data)[0] = (uint16_t)AUDIO_MIC_VOL_RES & 0xFF;
   (haudio->control.data)[1] = ((uint16_t)AUDIO_MIC_VOL_RES & 0xFF00) >> 8;
   USBD_CtlSendData(pdev,
@@ -830,10 +830,10 @@ static void USBD_AUDIO_MIC_REQ_GetResolution(USBD_HandleTypeDef *pdev, USBD_Setu
 static void USBD_AUDIO_MIC_REQ_GetCurrent(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
   USBD_AUDIO_MIC_HandleTypeDef *haudio;
-  haudio = pdev->pClassData_UAC_MIC;
+  haudio = USBD_CLASS_DATA(pdev);
 
-  (haudio->control.data)[0] = (uint16_t)VOL_CUR & 0xFF;
-  (haudio->control.data)[1] = ((uint16_t)VOL_CUR & 0xFF00) >> 8;
+  (haudio->control.data)[0] = (uint16_t)VOL_CUR[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)] & 0xFF;
+  (haudio->control.data)[1] = ((uint16_t)VOL_CUR[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)] & 0xFF00) >> 8;
 
   USBD_CtlSendData(pdev,
                    haudio->control.data,
@@ -850,12 +850,12 @@ static void USBD_AUDIO_MIC_REQ_GetCurrent(USBD_HandleTypeDef *pdev, USBD_SetupRe
 static void USBD_AUDIO_MIC_REQ_SetCurrent(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
   USBD_AUDIO_MIC_HandleTypeDef *haudio;
-  haudio = pdev->pClassData_UAC_MIC;
+  haudio = USBD_CLASS_DATA(pdev);
   if (req->wLength)
   {
     /* Prepare the reception of the buffer over EP0 */
     USBD_CtlPrepareRx(pdev,
-                      (uint8_t *)&VOL_CUR,
+                      (uint8_t *)&VOL_CUR[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)],
                       req->wLength);
 
     haudio->control.cmd = AUDIO_REQ_SET_CUR;    /* Set the request value */
@@ -886,11 +886,16 @@ static void USBD_AUDIO_MIC_REQ_SetCurrent(USBD_HandleTypeDef *pdev, USBD_SetupRe
 */
 uint8_t USBD_AUDIO_MIC_Data_Transfer(USBD_HandleTypeDef *pdev, int16_t *audioData, uint16_t PCMSamples)
 {
-
   USBD_AUDIO_MIC_HandleTypeDef *haudio;
-  haudio = (USBD_AUDIO_MIC_HandleTypeDef *)pdev->pClassData_UAC_MIC;
 
-  if (haudioInstance.state == STATE_USB_WAITING_FOR_INIT)
+  if (USBD_CoreFindClass(pdev, &USBD_AUDIO_MIC) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  haudio = (USBD_AUDIO_MIC_HandleTypeDef *)USBD_CLASS_DATA(pdev);
+
+  if (haudioInstance[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)].state == STATE_USB_WAITING_FOR_INIT)
   {
     return USBD_BUSY;
   }
@@ -928,7 +933,7 @@ uint8_t USBD_AUDIO_MIC_Data_Transfer(USBD_HandleTypeDef *pdev, int16_t *audioDat
     if (haudio->timeout++ == TIMEOUT_VALUE)
     {
       haudio->state = STATE_USB_IDLE;
-      ((USBD_AUDIO_MIC_ItfTypeDef *)pdev->pUserData_UAC_MIC)->Stop();
+      ((USBD_AUDIO_MIC_ItfTypeDef *)USBD_USER_DATA(pdev))->Stop();
       haudio->timeout = 0;
     }
     memcpy((uint8_t *)&haudio->buffer[haudio->wr_ptr], (uint8_t *)(audioData), dataAmount);
@@ -950,22 +955,29 @@ uint8_t USBD_AUDIO_MIC_Data_Transfer(USBD_HandleTypeDef *pdev, int16_t *audioDat
 uint8_t USBD_AUDIO_MIC_RegisterInterface(USBD_HandleTypeDef *pdev,
                                          USBD_AUDIO_MIC_ItfTypeDef *fops)
 {
+  if (USBD_CoreFindClass(pdev, &USBD_AUDIO_MIC) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
   if (fops == NULL)
   {
     return (uint8_t)USBD_FAIL;
   }
 
-  pdev->pUserData_UAC_MIC = fops;
+  USBD_USER_DATA(pdev) = fops;
 
   return (uint8_t)USBD_OK;
 }
 
-void USBD_Update_Audio_MIC_DESC(uint8_t *desc,
+void USBD_Update_Audio_MIC_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc,
                                 uint8_t ac_itf,
                                 uint8_t as_itf,
                                 uint8_t in_ep,
                                 uint8_t str_idx)
 {
+  USBD_AUDIO_MIC_HandleTypeDef *haudio = &haudioInstance[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)];
+
   desc[11] = ac_itf;
   desc[19] = ac_itf;
   desc[25] = str_idx;
@@ -974,23 +986,22 @@ void USBD_Update_Audio_MIC_DESC(uint8_t *desc,
   desc[75 + AUDIO_MIC_CHANNELS] = as_itf;
   desc[102 + AUDIO_MIC_CHANNELS] = in_ep;
 
-  AUDIO_MIC_EP = in_ep;
-  AUDIO_MIC_AC_ITF_NBR = ac_itf;
-  AUDIO_MIC_AS_ITF_NBR = as_itf;
-
-  AUDIO_MIC_STR_DESC_IDX = str_idx;
-
-  haudioInstance.paketDimension = (AUDIO_MIC_SMPL_FREQ / 1000 * AUDIO_MIC_CHANNELS * 2);
-  haudioInstance.frequency = AUDIO_MIC_SMPL_FREQ;
-  haudioInstance.buffer_length = haudioInstance.paketDimension * AUDIO_MIC_PACKET_NUM;
-  haudioInstance.channels = AUDIO_MIC_CHANNELS;
-  haudioInstance.upper_treshold = 5;
-  haudioInstance.lower_treshold = 2;
-  haudioInstance.state = STATE_USB_WAITING_FOR_INIT;
-  haudioInstance.wr_ptr = 3 * haudioInstance.paketDimension;
-  haudioInstance.rd_ptr = 0;
-  haudioInstance.dataAmount = 0;
-  haudioInstance.buffer = 0;
+  USBD_CLASS_MAP(pdev).in_ep = in_ep;
+  USBD_CLASS_MAP(pdev).itf_nbr = ac_itf;
+  USBD_CLASS_MAP(pdev).itf_num = 2U;
+  USBD_CLASS_MAP(pdev).str_idx = str_idx;
+
+  haudio->paketDimension = (AUDIO_MIC_SMPL_FREQ / 1000 * AUDIO_MIC_CHANNELS * 2);
+  haudio->frequency = AUDIO_MIC_SMPL_FREQ;
+  haudio->buffer_length = haudio->paketDimension * AUDIO_MIC_PACKET_NUM;
+  haudio->channels = AUDIO_MIC_CHANNELS;
+  haudio->upper_treshold = 5;
+  haudio->lower_treshold = 2;
+  haudio->state = STATE_USB_WAITING_FOR_INIT;
+  haudio->wr_ptr = 3 * haudio->paketDimension;
+  haudio->rd_ptr = 0;
+  haudio->dataAmount = 0;
+  haudio->buffer = 0;
 }
 
 /**
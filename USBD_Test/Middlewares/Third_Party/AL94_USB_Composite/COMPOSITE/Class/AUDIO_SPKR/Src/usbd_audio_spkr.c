@@ -63,11 +63,6 @@
 #define _AUDIO_SPKR_AS_ITF_NBR 0x01U
 #define _AUDIO_SPKR_STR_DESC_IDX 0x00U
 
-uint8_t AUDIO_SPKR_EP = _AUDIO_SPKR_EP;
-uint8_t AUDIO_SPKR_AC_ITF_NBR = _AUDIO_SPKR_AC_ITF_NBR;
-uint8_t AUDIO_SPKR_AS_ITF_NBR = _AUDIO_SPKR_AS_ITF_NBR;
-uint8_t AUDIO_SPKR_STR_DESC_IDX = _AUDIO_SPKR_STR_DESC_IDX;
-
 /** @addtogroup STM32_USB_OTG_DEVICE_LIBRARY
 * @{
 */
@@ -109,8 +104,8 @@ uint8_t AUDIO_SPKR_STR_DESC_IDX = _AUDIO_SPKR_STR_DESC_IDX;
 static uint8_t USBD_AUDIO_SPKR_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
 static uint8_t USBD_AUDIO_SPKR_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
 static uint8_t USBD_AUDIO_SPKR_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
-static uint8_t *USBD_AUDIO_SPKR_GetCfgDesc(uint16_t *length);
-static uint8_t *USBD_AUDIO_SPKR_GetDeviceQualifierDesc(uint16_t *length);
+static uint8_t *USBD_AUDIO_SPKR_GetCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_AUDIO_SPKR_GetDeviceQualifierDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
 static uint8_t USBD_AUDIO_SPKR_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum);
 static uint8_t USBD_AUDIO_SPKR_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum);
 static uint8_t USBD_AUDIO_SPKR_EP0_RxReady(USBD_HandleTypeDef *pdev);
@@ -129,7 +124,7 @@ static void USBD_AUDIO_SPKR_REQ_SetCurrent(USBD_HandleTypeDef *pdev, USBD_SetupR
   * @{
   */
 
-static USBD_AUDIO_SPKR_HandleTypeDef haudioInstance;
+static USBD_AUDIO_SPKR_HandleTypeDef haudioInstance[USBD_MAX_NUM_DEV][USBD_AUDIO_SPKR_MAX_INST];
 
 USBD_ClassTypeDef USBD_AUDIO_SPKR =
     {
@@ -347,28 +342,28 @@ static uint8_t USBD_AUDIO_SPKR_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   USBD_AUDIO_SPKR_HandleTypeDef *haudio;
 
   /* Allocate Audio structure */
-  haudio = &haudioInstance;
+  haudio = &haudioInstance[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)];
 
   if (haudio == NULL)
   {
-    pdev->pClassData_UAC_SPKR = NULL;
+    USBD_CLASS_DATA(pdev) = NULL;
     return (uint8_t)USBD_EMEM;
   }
 
-  pdev->pClassData_UAC_SPKR = (void *)haudio;
+  USBD_CLASS_DATA(pdev) = (void *)haudio;
 
   if (pdev->dev_speed == USBD_SPEED_HIGH)
   {
-    pdev->ep_out[AUDIO_SPKR_EP & 0xFU].bInterval = AUDIO_HS_BINTERVAL;
+    pdev->ep_out[AUDIO_SPKR_EP(pdev) & 0xFU].bInterval = AUDIO_HS_BINTERVAL;
   }
   else /* LOW and FULL-speed endpoints */
   {
-    pdev->ep_out[AUDIO_SPKR_EP & 0xFU].bInterval = AUDIO_FS_BINTERVAL;
+    pdev->ep_out[AUDIO_SPKR_EP(pdev) & 0xFU].bInterval = AUDIO_FS_BINTERVAL;
   }
 
   /* Open EP OUT */
-  (void)USBD_LL_OpenEP(pdev, AUDIO_SPKR_EP, USBD_EP_TYPE_ISOC, AUDIO_OUT_PACKET);
-  pdev->ep_out[AUDIO_SPKR_EP & 0xFU].is_used = 1U;
+  (void)USBD_LL_OpenEP(pdev, AUDIO_SPKR_EP(pdev), USBD_EP_TYPE_ISOC, AUDIO_OUT_PACKET);
+  pdev->ep_out[AUDIO_SPKR_EP(pdev) & 0xFU].is_used = 1U;
 
   haudio->alt_setting = 0U;
   haudio->offset = AUDIO_OFFSET_UNKNOWN;
@@ -377,13 +372,13 @@ static uint8_t USBD_AUDIO_SPKR_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   haudio->rd_enable = 0U;
 
   /* Initialize the Audio output Hardware layer */
-  if (((USBD_AUDIO_SPKR_ItfTypeDef *)pdev->pUserData_UAC_SPKR)->Init(USBD_AUDIO_FREQ, AUDIO_DEFAULT_VOLUME, 0U) != 0U)
+  if (((USBD_AUDIO_SPKR_ItfTypeDef *)USBD_USER_DATA(pdev))->Init(USBD_AUDIO_FREQ, AUDIO_DEFAULT_VOLUME, 0U) != 0U)
   {
     return (uint8_t)USBD_FAIL;
   }
 
   /* Prepare Out endpoint to receive 1st packet */
-  (void)USBD_LL_PrepareReceive(pdev, AUDIO_SPKR_EP, haudio->buffer,
+  (void)USBD_LL_PrepareReceive(pdev, AUDIO_SPKR_EP(pdev), haudio->buffer,
                                AUDIO_OUT_PACKET);
 
   return (uint8_t)USBD_OK;
@@ -401,18 +396,18 @@ static uint8_t USBD_AUDIO_SPKR_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   UNUSED(cfgidx);
 
   /* Open EP OUT */
-  (void)USBD_LL_CloseEP(pdev, AUDIO_SPKR_EP);
-  pdev->ep_out[AUDIO_SPKR_EP & 0xFU].is_used = 0U;
-  pdev->ep_out[AUDIO_SPKR_EP & 0xFU].bInterval = 0U;
+  (void)USBD_LL_CloseEP(pdev, AUDIO_SPKR_EP(pdev));
+  pdev->ep_out[AUDIO_SPKR_EP(pdev) & 0xFU].is_used = 0U;
+  pdev->ep_out[AUDIO_SPKR_EP(pdev) & 0xFU].bInterval = 0U;
 
   /* DeInit  physical Interface components */
-  if (pdev->pClassData_UAC_SPKR != NULL)
+  if (USBD_CLASS_DATA(pdev) != NULL)
   {
-    ((USBD_AUDIO_SPKR_ItfTypeDef *)pdev->pUserData_UAC_SPKR)->DeInit(0U);
+    ((USBD_AUDIO_SPKR_ItfTypeDef *)USBD_USER_DATA(pdev))->DeInit(0U);
 #if (0)
-    (void)USBD_free(pdev->pClassData_UAC_SPKR);
+    (void)USBD_free(USBD_CLASS_DATA(pdev));
 #endif
-    pdev->pClassData_UAC_SPKR = NULL;
+    USBD_CLASS_DATA(pdev) = NULL;
   }
 
   return (uint8_t)USBD_OK;
@@ -434,7 +429,7 @@ static uint8_t USBD_AUDIO_SPKR_Setup(USBD_HandleTypeDef *pdev,
   uint16_t status_info = 0U;
   USBD_StatusTypeDef ret = USBD_OK;
 
-  haudio = (USBD_AUDIO_SPKR_HandleTypeDef *)pdev->pClassData_UAC_SPKR;
+  haudio = (USBD_AUDIO_SPKR_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (haudio == NULL)
   {
@@ -541,11 +536,14 @@ static uint8_t USBD_AUDIO_SPKR_Setup(USBD_HandleTypeDef *pdev,
   * @brief  USBD_AUDIO_GetCfgDesc
   *         return configuration descriptor
   * @param  speed : current device speed
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_AUDIO_SPKR_GetCfgDesc(uint16_t *length)
+static uint8_t *USBD_AUDIO_SPKR_GetCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_AUDIO_SPKR_CfgDesc);
 
   return USBD_AUDIO_SPKR_CfgDesc;
@@ -576,7 +574,7 @@ static uint8_t USBD_AUDIO_SPKR_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
 static uint8_t USBD_AUDIO_SPKR_EP0_RxReady(USBD_HandleTypeDef *pdev)
 {
   USBD_AUDIO_SPKR_HandleTypeDef *haudio;
-  haudio = (USBD_AUDIO_SPKR_HandleTypeDef *)pdev->pClassData_UAC_SPKR;
+  haudio = (USBD_AUDIO_SPKR_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (haudio == NULL)
   {
@@ -589,7 +587,7 @@ static uint8_t USBD_AUDIO_SPKR_EP0_RxReady(USBD_HandleTypeDef *pdev)
 
     if (haudio->control.unit == AUDIO_STREAMING_CTRL)
     {
-      ((USBD_AUDIO_SPKR_ItfTypeDef *)pdev->pUserData_UAC_SPKR)->MuteCtl(haudio->control.data[0]);
+      ((USBD_AUDIO_SPKR_ItfTypeDef *)USBD_USER_DATA(pdev))->MuteCtl(haudio->control.data[0]);
       haudio->control.cmd = 0U;
       haudio->control.len = 0U;
     }
@@ -634,12 +632,17 @@ void USBD_AUDIO_SPKR_Sync(USBD_HandleTypeDef *pdev, AUDIO_OffsetTypeDef offset)
   USBD_AUDIO_SPKR_HandleTypeDef *haudio;
   uint32_t BufferSize = AUDIO_TOTAL_BUF_SIZE / 2U;
 
-  if (pdev->pClassData_UAC_SPKR == NULL)
+  if (USBD_CoreFindClass(pdev, &USBD_AUDIO_SPKR) != USBD_OK)
+  {
+    return;
+  }
+
+  if (USBD_CLASS_DATA(pdev) == NULL)
   {
     return;
   }
 
-  haudio = (USBD_AUDIO_SPKR_HandleTypeDef *)pdev->pClassData_UAC_SPKR;
+  haudio = (USBD_AUDIO_SPKR_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   haudio->offset = offset;
 
@@ -685,7 +688,7 @@ void USBD_AUDIO_SPKR_Sync(USBD_HandleTypeDef *pdev, AUDIO_OffsetTypeDef offset)
 
   if (haudio->offset == AUDIO_OFFSET_FULL)
   {
-    ((USBD_AUDIO_SPKR_ItfTypeDef *)pdev->pUserData_UAC_SPKR)->AudioCmd(&haudio->buffer[0], BufferSize, AUDIO_CMD_PLAY);
+    ((USBD_AUDIO_SPKR_ItfTypeDef *)USBD_USER_DATA(pdev))->AudioCmd(&haudio->buffer[0], BufferSize, AUDIO_CMD_PLAY);
     haudio->offset = AUDIO_OFFSET_NONE;
   }
 }
@@ -730,20 +733,20 @@ static uint8_t USBD_AUDIO_SPKR_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
   uint16_t PacketSize;
   USBD_AUDIO_SPKR_HandleTypeDef *haudio;
 
-  haudio = (USBD_AUDIO_SPKR_HandleTypeDef *)pdev->pClassData_UAC_SPKR;
+  haudio = (USBD_AUDIO_SPKR_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (haudio == NULL)
   {
     return (uint8_t)USBD_FAIL;
   }
 
-  if (epnum == AUDIO_SPKR_EP)
+  if (epnum == AUDIO_SPKR_EP(pdev))
   {
     /* Get received data packet length */
     PacketSize = (uint16_t)USBD_LL_GetRxDataSize(pdev, epnum);
 
     /* Packet received Callback */
-    ((USBD_AUDIO_SPKR_ItfTypeDef *)pdev->pUserData_UAC_SPKR)->PeriodicTC(&haudio->buffer[haudio->wr_ptr], PacketSize, AUDIO_OUT_TC);
+    ((USBD_AUDIO_SPKR_ItfTypeDef *)USBD_USER_DATA(pdev))->PeriodicTC(&haudio->buffer[haudio->wr_ptr], PacketSize, AUDIO_OUT_TC);
 
     /* Increment the Buffer pointer or roll it back when all buffers are full */
     haudio->wr_ptr += PacketSize;
@@ -755,7 +758,7 @@ static uint8_t USBD_AUDIO_SPKR_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
 
       if (haudio->offset == AUDIO_OFFSET_UNKNOWN)
       {
-        ((USBD_AUDIO_SPKR_ItfTypeDef *)pdev->pUserData_UAC_SPKR)->AudioCmd(&haudio->buffer[0], AUDIO_TOTAL_BUF_SIZE / 2U, AUDIO_CMD_START);
+        ((USBD_AUDIO_SPKR_ItfTypeDef *)USBD_USER_DATA(pdev))->AudioCmd(&haudio->buffer[0], AUDIO_TOTAL_BUF_SIZE / 2U, AUDIO_CMD_START);
         haudio->offset = AUDIO_OFFSET_NONE;
       }
     }
@@ -769,7 +772,7 @@ static uint8_t USBD_AUDIO_SPKR_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
     }
 
     /* Prepare Out endpoint to receive next audio packet */
-    (void)USBD_LL_PrepareReceive(pdev, AUDIO_SPKR_EP,
+    (void)USBD_LL_PrepareReceive(pdev, AUDIO_SPKR_EP(pdev),
                                  &haudio->buffer[haudio->wr_ptr],
                                  AUDIO_OUT_PACKET);
   }
@@ -787,7 +790,7 @@ static uint8_t USBD_AUDIO_SPKR_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
 static void  USBD_AUDIO_SPKR_REQ_GetCurrent(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
   USBD_AUDIO_SPKR_HandleTypeDef *haudio;
-  haudio = (USBD_AUDIO_SPKR_HandleTypeDef *)pdev->pClassData_UAC_SPKR;
+  haudio = (USBD_AUDIO_SPKR_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (haudio == NULL)
   {
@@ -810,7 +813,7 @@ static void  USBD_AUDIO_SPKR_REQ_GetCurrent(USBD_HandleTypeDef *pdev, USBD_Setup
 static void USBD_AUDIO_SPKR_REQ_SetCurrent(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
   USBD_AUDIO_SPKR_HandleTypeDef *haudio;
-  haudio = (USBD_AUDIO_SPKR_HandleTypeDef *)pdev->pClassData_UAC_SPKR;
+  haudio = (USBD_AUDIO_SPKR_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (haudio == NULL)
   {
@@ -831,11 +834,14 @@ static void USBD_AUDIO_SPKR_REQ_SetCurrent(USBD_HandleTypeDef *pdev, USBD_SetupR
 /**
   * @brief  DeviceQualifierDescriptor
   *         return Device Qualifier descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_AUDIO_SPKR_GetDeviceQualifierDesc(uint16_t *length)
+static uint8_t *USBD_AUDIO_SPKR_GetDeviceQualifierDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_AUDIO_SPKR_DeviceQualifierDesc);
 
   return USBD_AUDIO_SPKR_DeviceQualifierDesc;
@@ -849,17 +855,22 @@ static uint8_t *USBD_AUDIO_SPKR_GetDeviceQualifierDesc(uint16_t *length)
 uint8_t USBD_AUDIO_SPKR_RegisterInterface(USBD_HandleTypeDef *pdev,
                                           USBD_AUDIO_SPKR_ItfTypeDef *fops)
 {
+  if (USBD_CoreFindClass(pdev, &USBD_AUDIO_SPKR) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
   if (fops == NULL)
   {
     return (uint8_t)USBD_FAIL;
   }
 
-  pdev->pUserData_UAC_SPKR = fops;
+  USBD_USER_DATA(pdev) = fops;
 
   return (uint8_t)USBD_OK;
 }
 
-void USBD_Update_Audio_SPKR_DESC(uint8_t *desc,
+void USBD_Update_Audio_SPKR_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc,
                                  uint8_t ac_itf,
                                  uint8_t as_itf,
                                  uint8_t out_ep,
@@ -873,11 +884,10 @@ void USBD_Update_Audio_SPKR_DESC(uint8_t *desc,
   desc[76] = as_itf;
   desc[103] = out_ep;
 
-  AUDIO_SPKR_EP = out_ep;
-  AUDIO_SPKR_AC_ITF_NBR = ac_itf;
-  AUDIO_SPKR_AS_ITF_NBR = as_itf;
-
-  AUDIO_SPKR_STR_DESC_IDX = str_idx;
+  USBD_CLASS_MAP(pdev).out_ep = out_ep;
+  USBD_CLASS_MAP(pdev).itf_nbr = ac_itf;
+  USBD_CLASS_MAP(pdev).itf_num = 2U;
+  USBD_CLASS_MAP(pdev).str_idx = str_idx;
 }
 
 /**
@@ -73,6 +73,11 @@ extern "C" {
 #define CDC_ECM_DATA_FS_IN_PACKET_SIZE                  CDC_ECM_DATA_FS_MAX_PACKET_SIZE
 #define CDC_ECM_DATA_FS_OUT_PACKET_SIZE                 CDC_ECM_DATA_FS_MAX_PACKET_SIZE
 
+/* Number of IN transfers that may be queued on the data endpoint */
+#ifndef CDC_ECM_TX_QUEUE_DEPTH
+#define CDC_ECM_TX_QUEUE_DEPTH          2U
+#endif /* CDC_ECM_TX_QUEUE_DEPTH */
+
 /*---------------------------------------------------------------------*/
 /*  CDC_ECM definitions                                                    */
 /*---------------------------------------------------------------------*/
@@ -177,6 +182,9 @@ typedef struct
   __IO uint32_t TxState;
   __IO uint32_t RxState;
 
+
+  USBD_XferTypeDef TxXfer[CDC_ECM_TX_QUEUE_DEPTH];
+
   __IO uint32_t MaxPcktLen;
   __IO uint32_t LinkStatus;
   __IO uint32_t NotificationStatus;
@@ -204,12 +212,17 @@ typedef enum
 
 extern USBD_ClassTypeDef USBD_CDC_ECM;
 
-extern uint8_t CDC_ECM_IN_EP;
-extern uint8_t CDC_ECM_OUT_EP;
-extern uint8_t CDC_ECM_CMD_EP;
-extern uint8_t CDC_ECM_CMD_ITF_NBR;
-extern uint8_t CDC_ECM_COM_ITF_NBR;
-extern uint8_t CDC_ECM_STR_DESC_IDX;
+/* Instances of the class a device can mount */
+#ifndef USBD_CDC_ECM_MAX_INST
+#define USBD_CDC_ECM_MAX_INST  1U
+#endif /* USBD_CDC_ECM_MAX_INST */
+
+#define CDC_ECM_IN_EP(pdev)         (USBD_CLASS_MAP(pdev).in_ep)
+#define CDC_ECM_OUT_EP(pdev)        (USBD_CLASS_MAP(pdev).out_ep)
+#define CDC_ECM_CMD_EP(pdev)        (USBD_CLASS_MAP(pdev).cmd_ep)
+#define CDC_ECM_CMD_ITF_NBR(pdev)   (USBD_CLASS_MAP(pdev).itf_nbr)
+#define CDC_ECM_COM_ITF_NBR(pdev)   ((uint8_t)(USBD_CLASS_MAP(pdev).itf_nbr + 1U))
+#define CDC_ECM_STR_DESC_IDX(pdev)  (USBD_CLASS_MAP(pdev).str_idx)
 
 /**
   * @}
@@ -234,7 +247,7 @@ uint8_t USBD_CDC_ECM_SendNotification(USBD_HandleTypeDef *pdev,
                                       USBD_CDC_ECM_NotifCodeTypeDef Notif,
                                       uint16_t bVal, uint8_t *pData);
 
-void USBD_Update_CDC_ECM_DESC(uint8_t *desc,
+void USBD_Update_CDC_ECM_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc,
                               uint8_t cmd_itf,
                               uint8_t com_itf,
                               uint8_t in_ep,
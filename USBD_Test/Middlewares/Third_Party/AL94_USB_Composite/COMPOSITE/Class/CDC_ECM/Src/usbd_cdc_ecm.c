@@ -42,13 +42,6 @@ EndBSPDependencies */
 #define _CDC_ECM_COM_ITF_NBR 0x01U /* Communication Interface Number 0 */
 #define _CDC_ECM_STR_DESC_IDX 0x00U
 
-uint8_t CDC_ECM_IN_EP = _CDC_ECM_IN_EP;
-uint8_t CDC_ECM_OUT_EP = _CDC_ECM_OUT_EP;
-uint8_t CDC_ECM_CMD_EP = _CDC_ECM_CMD_EP;
-uint8_t CDC_ECM_CMD_ITF_NBR = _CDC_ECM_CMD_ITF_NBR;
-uint8_t CDC_ECM_COM_ITF_NBR = _CDC_ECM_COM_ITF_NBR;
-uint8_t CDC_ECM_STR_DESC_IDX = _CDC_ECM_STR_DESC_IDX;
-
 /** @addtogroup STM32_USB_DEVICE_LIBRARY
   * @{
   */
@@ -89,20 +82,21 @@ static uint8_t USBD_CDC_ECM_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
 static uint8_t USBD_CDC_ECM_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
 static uint8_t USBD_CDC_ECM_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum);
 static uint8_t USBD_CDC_ECM_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum);
+static void USBD_CDC_ECM_TxCplt(USBD_HandleTypeDef *pdev, USBD_XferTypeDef *xfer);
 static uint8_t USBD_CDC_ECM_EP0_RxReady(USBD_HandleTypeDef *pdev);
 static uint8_t USBD_CDC_ECM_Setup(USBD_HandleTypeDef *pdev,
                                   USBD_SetupReqTypedef *req);
 
-static uint8_t *USBD_CDC_ECM_GetFSCfgDesc(uint16_t *length);
-static uint8_t *USBD_CDC_ECM_GetHSCfgDesc(uint16_t *length);
-static uint8_t *USBD_CDC_ECM_GetOtherSpeedCfgDesc(uint16_t *length);
+static uint8_t *USBD_CDC_ECM_GetFSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_CDC_ECM_GetHSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_CDC_ECM_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
 
 #if (USBD_SUPPORT_USER_STRING_DESC == 1U)
 static uint8_t *USBD_CDC_ECM_USRStringDescriptor(USBD_HandleTypeDef *pdev,
                                                  uint8_t index, uint16_t *length);
 #endif
 
-uint8_t *USBD_CDC_ECM_GetDeviceQualifierDescriptor(uint16_t *length);
+uint8_t *USBD_CDC_ECM_GetDeviceQualifierDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length);
 
 /* USB Standard Device Descriptor */
 __ALIGN_BEGIN static uint8_t USBD_CDC_ECM_DeviceQualifierDesc[USB_LEN_DEV_QUALIFIER_DESC] __ALIGN_END =
@@ -130,7 +124,7 @@ static uint32_t ConnSpeedTab[2] = {CDC_ECM_CONNECT_SPEED_UPSTREAM,
   * @{
   */
 
-static USBD_CDC_ECM_HandleTypeDef CDC_ECM_Instance;
+static USBD_CDC_ECM_HandleTypeDef CDC_ECM_Instance[USBD_MAX_NUM_DEV][USBD_CDC_ECM_MAX_INST];
 
 /* CDC_ECM interface class callbacks structure */
 USBD_ClassTypeDef USBD_CDC_ECM =
@@ -505,57 +499,59 @@ static uint8_t USBD_CDC_ECM_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
 
   USBD_CDC_ECM_HandleTypeDef *hcdc;
 
-  hcdc = &CDC_ECM_Instance;
+  hcdc = &CDC_ECM_Instance[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)];
 
   if (hcdc == NULL)
   {
-    pdev->pClassData_CDC_ECM = NULL;
+    USBD_CLASS_DATA(pdev) = NULL;
     return (uint8_t)USBD_EMEM;
   }
 
-  pdev->pClassData_CDC_ECM = (void *)hcdc;
+  USBD_CLASS_DATA(pdev) = (void *)hcdc;
 
   if (pdev->dev_speed == USBD_SPEED_HIGH)
   {
     /* Open EP IN */
-    (void)USBD_LL_OpenEP(pdev, CDC_ECM_IN_EP, USBD_EP_TYPE_BULK,
+    (void)USBD_LL_OpenEP(pdev, CDC_ECM_IN_EP(pdev), USBD_EP_TYPE_BULK,
                          CDC_ECM_DATA_HS_IN_PACKET_SIZE);
 
-    pdev->ep_in[CDC_ECM_IN_EP & 0xFU].is_used = 1U;
+    pdev->ep_in[CDC_ECM_IN_EP(pdev) & 0xFU].is_used = 1U;
+    pdev->ep_in[CDC_ECM_IN_EP(pdev) & 0xFU].maxpacket = CDC_ECM_DATA_HS_IN_PACKET_SIZE;
 
     /* Open EP OUT */
-    (void)USBD_LL_OpenEP(pdev, CDC_ECM_OUT_EP, USBD_EP_TYPE_BULK,
+    (void)USBD_LL_OpenEP(pdev, CDC_ECM_OUT_EP(pdev), USBD_EP_TYPE_BULK,
                          CDC_ECM_DATA_HS_OUT_PACKET_SIZE);
 
-    pdev->ep_out[CDC_ECM_OUT_EP & 0xFU].is_used = 1U;
+    pdev->ep_out[CDC_ECM_OUT_EP(pdev) & 0xFU].is_used = 1U;
 
     /* Set bInterval for CDC ECM CMD Endpoint */
-    pdev->ep_in[CDC_ECM_CMD_EP & 0xFU].bInterval = CDC_ECM_HS_BINTERVAL;
+    pdev->ep_in[CDC_ECM_CMD_EP(pdev) & 0xFU].bInterval = CDC_ECM_HS_BINTERVAL;
   }
   else
   {
     /* Open EP IN */
-    (void)USBD_LL_OpenEP(pdev, CDC_ECM_IN_EP, USBD_EP_TYPE_BULK,
+    (void)USBD_LL_OpenEP(pdev, CDC_ECM_IN_EP(pdev), USBD_EP_TYPE_BULK,
                          CDC_ECM_DATA_FS_IN_PACKET_SIZE);
 
-    pdev->ep_in[CDC_ECM_IN_EP & 0xFU].is_used = 1U;
+    pdev->ep_in[CDC_ECM_IN_EP(pdev) & 0xFU].is_used = 1U;
+    pdev->ep_in[CDC_ECM_IN_EP(pdev) & 0xFU].maxpacket = CDC_ECM_DATA_FS_IN_PACKET_SIZE;
 
     /* Open EP OUT */
-    (void)USBD_LL_OpenEP(pdev, CDC_ECM_OUT_EP, USBD_EP_TYPE_BULK,
+    (void)USBD_LL_OpenEP(pdev, CDC_ECM_OUT_EP(pdev), USBD_EP_TYPE_BULK,
                          CDC_ECM_DATA_FS_OUT_PACKET_SIZE);
 
-    pdev->ep_out[CDC_ECM_OUT_EP & 0xFU].is_used = 1U;
+    pdev->ep_out[CDC_ECM_OUT_EP(pdev) & 0xFU].is_used = 1U;
 
     /* Set bInterval for CDC ECM CMD Endpoint */
-    pdev->ep_in[CDC_ECM_CMD_EP & 0xFU].bInterval = CDC_ECM_FS_BINTERVAL;
+    pdev->ep_in[CDC_ECM_CMD_EP(pdev) & 0xFU].bInterval = CDC_ECM_FS_BINTERVAL;
   }
 
   /* Open Command IN EP */
-  (void)USBD_LL_OpenEP(pdev, CDC_ECM_CMD_EP, USBD_EP_TYPE_INTR, CDC_ECM_CMD_PACKET_SIZE);
-  pdev->ep_in[CDC_ECM_CMD_EP & 0xFU].is_used = 1U;
+  (void)USBD_LL_OpenEP(pdev, CDC_ECM_CMD_EP(pdev), USBD_EP_TYPE_INTR, CDC_ECM_CMD_PACKET_SIZE);
+  pdev->ep_in[CDC_ECM_CMD_EP(pdev) & 0xFU].is_used = 1U;
 
   /* Init  physical Interface components */
-  ((USBD_CDC_ECM_ItfTypeDef *)pdev->pUserData_CDC_ECM)->Init();
+  ((USBD_CDC_ECM_ItfTypeDef *)USBD_USER_DATA(pdev))->Init();
 
   /* Init Xfer states */
   hcdc->TxState = 0U;
@@ -567,7 +563,7 @@ static uint8_t USBD_CDC_ECM_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   hcdc->MaxPcktLen = (pdev->dev_speed == USBD_SPEED_HIGH) ? CDC_ECM_DATA_HS_MAX_PACKET_SIZE : CDC_ECM_DATA_FS_MAX_PACKET_SIZE;
 
   /* Prepare Out endpoint to receive next packet */
-  (void)USBD_LL_PrepareReceive(pdev, CDC_ECM_OUT_EP, hcdc->RxBuffer, hcdc->MaxPcktLen);
+  (void)USBD_LL_PrepareReceive(pdev, CDC_ECM_OUT_EP(pdev), hcdc->RxBuffer, hcdc->MaxPcktLen);
 
   return (uint8_t)USBD_OK;
 }
@@ -584,26 +580,27 @@ static uint8_t USBD_CDC_ECM_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   UNUSED(cfgidx);
 
   /* Close EP IN */
-  (void)USBD_LL_CloseEP(pdev, CDC_ECM_IN_EP);
-  pdev->ep_in[CDC_ECM_IN_EP & 0xFU].is_used = 0U;
+  (void)USBD_LL_CloseEP(pdev, CDC_ECM_IN_EP(pdev));
+  (void)USBD_Xfer_Flush(pdev, CDC_ECM_IN_EP(pdev));
+  pdev->ep_in[CDC_ECM_IN_EP(pdev) & 0xFU].is_used = 0U;
 
   /* Close EP OUT */
-  (void)USBD_LL_CloseEP(pdev, CDC_ECM_OUT_EP);
-  pdev->ep_out[CDC_ECM_OUT_EP & 0xFU].is_used = 0U;
+  (void)USBD_LL_CloseEP(pdev, CDC_ECM_OUT_EP(pdev));
+  pdev->ep_out[CDC_ECM_OUT_EP(pdev) & 0xFU].is_used = 0U;
 
   /* Close Command IN EP */
-  (void)USBD_LL_CloseEP(pdev, CDC_ECM_CMD_EP);
-  pdev->ep_in[CDC_ECM_CMD_EP & 0xFU].is_used = 0U;
-  pdev->ep_in[CDC_ECM_CMD_EP & 0xFU].bInterval = 0U;
+  (void)USBD_LL_CloseEP(pdev, CDC_ECM_CMD_EP(pdev));
+  pdev->ep_in[CDC_ECM_CMD_EP(pdev) & 0xFU].is_used = 0U;
+  pdev->ep_in[CDC_ECM_CMD_EP(pdev) & 0xFU].bInterval = 0U;
 
   /* DeInit  physical Interface components */
-  if (pdev->pClassData_CDC_ECM != NULL)
+  if (USBD_CLASS_DATA(pdev) != NULL)
   {
-    ((USBD_CDC_ECM_ItfTypeDef *)pdev->pUserData_CDC_ECM)->DeInit();
+    ((USBD_CDC_ECM_ItfTypeDef *)USBD_USER_DATA(pdev))->DeInit();
 #if (0)
-    USBD_free(pdev->pClassData_CDC_ECM);
+    USBD_free(USBD_CLASS_DATA(pdev));
 #endif
-    pdev->pClassData_CDC_ECM = NULL;
+    USBD_CLASS_DATA(pdev) = NULL;
   }
 
   return (uint8_t)USBD_OK;
@@ -619,8 +616,8 @@ static uint8_t USBD_CDC_ECM_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
 static uint8_t USBD_CDC_ECM_Setup(USBD_HandleTypeDef *pdev,
                                   USBD_SetupReqTypedef *req)
 {
-  USBD_CDC_ECM_HandleTypeDef *hcdc = (USBD_CDC_ECM_HandleTypeDef *)pdev->pClassData_CDC_ECM;
-  USBD_CDC_ECM_ItfTypeDef *EcmInterface = (USBD_CDC_ECM_ItfTypeDef *)pdev->pUserData_CDC_ECM;
+  USBD_CDC_ECM_HandleTypeDef *hcdc = (USBD_CDC_ECM_HandleTypeDef *)USBD_CLASS_DATA(pdev);
+  USBD_CDC_ECM_ItfTypeDef *EcmInterface = (USBD_CDC_ECM_ItfTypeDef *)USBD_USER_DATA(pdev);
   USBD_StatusTypeDef ret = USBD_OK;
   uint16_t len;
   uint16_t status_info = 0U;
@@ -721,35 +718,15 @@ static uint8_t USBD_CDC_ECM_Setup(USBD_HandleTypeDef *pdev,
   */
 static uint8_t USBD_CDC_ECM_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
 {
-  USBD_CDC_ECM_HandleTypeDef *hcdc = (USBD_CDC_ECM_HandleTypeDef *)pdev->pClassData_CDC_ECM;
-  PCD_HandleTypeDef *hpcd = pdev->pData;
+  USBD_CDC_ECM_HandleTypeDef *hcdc = (USBD_CDC_ECM_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
-  if (pdev->pClassData_CDC_ECM == NULL)
+  if (USBD_CLASS_DATA(pdev) == NULL)
   {
     return (uint8_t)USBD_FAIL;
   }
 
-  if (epnum == (CDC_ECM_IN_EP & 0x7FU))
-  {
-    if ((pdev->ep_in[epnum].total_length > 0U) &&
-        ((pdev->ep_in[epnum].total_length % hpcd->IN_ep[epnum].maxpacket) == 0U))
-    {
-      /* Update the packet total length */
-      pdev->ep_in[epnum].total_length = 0U;
-
-      /* Send ZLP */
-      (void)USBD_LL_Transmit(pdev, epnum, NULL, 0U);
-    }
-    else
-    {
-      hcdc->TxState = 0U;
-      if (((USBD_CDC_ECM_ItfTypeDef *)pdev->pUserData_CDC_ECM)->TransmitCplt != NULL)
-      {
-        ((USBD_CDC_ECM_ItfTypeDef *)pdev->pUserData_CDC_ECM)->TransmitCplt(hcdc->TxBuffer, &hcdc->TxLength, epnum);
-      }
-    }
-  }
-  else if (epnum == (CDC_ECM_CMD_EP & 0x7FU))
+  /* The data IN endpoint completes through its transfer queue */
+  if (epnum == (CDC_ECM_CMD_EP(pdev) & 0x7FU))
   {
     if (hcdc->NotificationStatus != 0U)
     {
@@ -767,6 +744,28 @@ static uint8_t USBD_CDC_ECM_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
   return (uint8_t)USBD_OK;
 }
 
+/**
+  * @brief  USBD_CDC_ECM_TxCplt
+  *         Transfer queue completion of a data IN transfer
+  * @param  pdev: device instance
+  * @param  xfer: completed transfer descriptor
+  * @retval None
+  */
+static void USBD_CDC_ECM_TxCplt(USBD_HandleTypeDef *pdev, USBD_XferTypeDef *xfer)
+{
+  USBD_CDC_ECM_HandleTypeDef *hcdc = (USBD_CDC_ECM_HandleTypeDef *)xfer->pOwner;
+
+  if (USBD_Xfer_IsIdle(pdev, xfer->ep_addr) != 0U)
+  {
+    hcdc->TxState = 0U;
+  }
+
+  if (((USBD_CDC_ECM_ItfTypeDef *)USBD_USER_DATA(pdev))->TransmitCplt != NULL)
+  {
+    ((USBD_CDC_ECM_ItfTypeDef *)USBD_USER_DATA(pdev))->TransmitCplt(xfer->pbuf, &xfer->length, xfer->ep_addr & 0x7FU);
+  }
+}
+
 /**
   * @brief  USBD_CDC_ECM_DataOut
   *         Data received on non-control Out endpoint
@@ -776,15 +775,15 @@ static uint8_t USBD_CDC_ECM_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
   */
 static uint8_t USBD_CDC_ECM_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
 {
-  USBD_CDC_ECM_HandleTypeDef *hcdc = (USBD_CDC_ECM_HandleTypeDef *)pdev->pClassData_CDC_ECM;
+  USBD_CDC_ECM_HandleTypeDef *hcdc = (USBD_CDC_ECM_HandleTypeDef *)USBD_CLASS_DATA(pdev);
   uint32_t CurrPcktLen;
 
-  if (pdev->pClassData_CDC_ECM == NULL)
+  if (USBD_CLASS_DATA(pdev) == NULL)
   {
     return (uint8_t)USBD_FAIL;
   }
 
-  if (epnum == CDC_ECM_OUT_EP)
+  if (epnum == CDC_ECM_OUT_EP(pdev))
   {
     /* Get the received data length */
     CurrPcktLen = USBD_LL_GetRxDataSize(pdev, epnum);
@@ -800,12 +799,12 @@ static uint8_t USBD_CDC_ECM_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
 
       /* Process data by application (ie. copy to app buffer or notify user)
       hcdc->RxLength must be reset to zero at the end of the call of this function */
-      ((USBD_CDC_ECM_ItfTypeDef *)pdev->pUserData_CDC_ECM)->Receive(hcdc->RxBuffer, &hcdc->RxLength);
+      ((USBD_CDC_ECM_ItfTypeDef *)USBD_USER_DATA(pdev))->Receive(hcdc->RxBuffer, &hcdc->RxLength);
     }
     else
     {
       /* Prepare Out endpoint to receive next packet in current/new frame */
-      (void)USBD_LL_PrepareReceive(pdev, CDC_ECM_OUT_EP,
+      (void)USBD_LL_PrepareReceive(pdev, CDC_ECM_OUT_EP(pdev),
                                    (uint8_t *)(hcdc->RxBuffer + hcdc->RxLength),
                                    hcdc->MaxPcktLen);
     }
@@ -826,16 +825,16 @@ static uint8_t USBD_CDC_ECM_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
   */
 static uint8_t USBD_CDC_ECM_EP0_RxReady(USBD_HandleTypeDef *pdev)
 {
-  USBD_CDC_ECM_HandleTypeDef *hcdc = (USBD_CDC_ECM_HandleTypeDef *)pdev->pClassData_CDC_ECM;
+  USBD_CDC_ECM_HandleTypeDef *hcdc = (USBD_CDC_ECM_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hcdc == NULL)
   {
     return (uint8_t)USBD_FAIL;
   }
 
-  if ((pdev->pUserData_CDC_ECM != NULL) && (hcdc->CmdOpCode != 0xFFU))
+  if ((USBD_USER_DATA(pdev) != NULL) && (hcdc->CmdOpCode != 0xFFU))
   {
-    ((USBD_CDC_ECM_ItfTypeDef *)pdev->pUserData_CDC_ECM)->Control(hcdc->CmdOpCode, (uint8_t *)hcdc->data, (uint16_t)hcdc->CmdLength);
+    ((USBD_CDC_ECM_ItfTypeDef *)USBD_USER_DATA(pdev))->Control(hcdc->CmdOpCode, (uint8_t *)hcdc->data, (uint16_t)hcdc->CmdLength);
     hcdc->CmdOpCode = 0xFFU;
   }
   return (uint8_t)USBD_OK;
@@ -845,11 +844,14 @@ static uint8_t USBD_CDC_ECM_EP0_RxReady(USBD_HandleTypeDef *pdev)
   * @brief  USBD_CDC_ECM_GetFSCfgDesc
   *         Return configuration descriptor
   * @param  speed : current device speed
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_CDC_ECM_GetFSCfgDesc(uint16_t *length)
+static uint8_t *USBD_CDC_ECM_GetFSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_CDC_ECM_CfgFSDesc);
 
   return USBD_CDC_ECM_CfgFSDesc;
@@ -859,11 +861,14 @@ static uint8_t *USBD_CDC_ECM_GetFSCfgDesc(uint16_t *length)
   * @brief  USBD_CDC_ECM_GetHSCfgDesc
   *         Return configuration descriptor
   * @param  speed : current device speed
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_CDC_ECM_GetHSCfgDesc(uint16_t *length)
+static uint8_t *USBD_CDC_ECM_GetHSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_CDC_ECM_CfgHSDesc);
 
   return USBD_CDC_ECM_CfgHSDesc;
@@ -873,11 +878,14 @@ static uint8_t *USBD_CDC_ECM_GetHSCfgDesc(uint16_t *length)
   * @brief  USBD_CDC_ECM_GetCfgDesc
   *         Return configuration descriptor
   * @param  speed : current device speed
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_CDC_ECM_GetOtherSpeedCfgDesc(uint16_t *length)
+static uint8_t *USBD_CDC_ECM_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_CDC_ECM_OtherSpeedCfgDesc);
 
   return USBD_CDC_ECM_OtherSpeedCfgDesc;
@@ -886,11 +894,14 @@ static uint8_t *USBD_CDC_ECM_GetOtherSpeedCfgDesc(uint16_t *length)
 /**
   * @brief  DeviceQualifierDescriptor
   *         return Device Qualifier descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-uint8_t *USBD_CDC_ECM_GetDeviceQualifierDescriptor(uint16_t *length)
+uint8_t *USBD_CDC_ECM_GetDeviceQualifierDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_CDC_ECM_DeviceQualifierDesc);
 
   return USBD_CDC_ECM_DeviceQualifierDesc;
@@ -905,12 +916,17 @@ uint8_t *USBD_CDC_ECM_GetDeviceQualifierDescriptor(uint16_t *length)
 uint8_t USBD_CDC_ECM_RegisterInterface(USBD_HandleTypeDef *pdev,
                                        USBD_CDC_ECM_ItfTypeDef *fops)
 {
+  if (USBD_CoreFindClass(pdev, &USBD_CDC_ECM) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
   if (fops == NULL)
   {
     return (uint8_t)USBD_FAIL;
   }
 
-  pdev->pUserData_CDC_ECM = fops;
+  USBD_USER_DATA(pdev) = fops;
 
   return (uint8_t)USBD_OK;
 }
@@ -931,7 +947,7 @@ static uint8_t *USBD_CDC_ECM_USRStringDescriptor(USBD_HandleTypeDef *pdev, uint8
   /* Check if the requested string interface is supported */
   if (index == CDC_ECM_MAC_STRING_INDEX)
   {
-    USBD_GetString((uint8_t *)((USBD_CDC_ECM_ItfTypeDef *)pdev->pUserData_CDC_ECM)->pStrDesc, USBD_StrDesc, length);
+    USBD_GetString((uint8_t *)((USBD_CDC_ECM_ItfTypeDef *)USBD_USER_DATA(pdev))->pStrDesc, USBD_StrDesc, length);
     return USBD_StrDesc;
   }
   /* Not supported Interface Descriptor index */
@@ -950,7 +966,14 @@ static uint8_t *USBD_CDC_ECM_USRStringDescriptor(USBD_HandleTypeDef *pdev, uint8
   */
 uint8_t USBD_CDC_ECM_SetTxBuffer(USBD_HandleTypeDef *pdev, uint8_t *pbuff, uint32_t length)
 {
-  USBD_CDC_ECM_HandleTypeDef *hcdc = (USBD_CDC_ECM_HandleTypeDef *)pdev->pClassData_CDC_ECM;
+  USBD_CDC_ECM_HandleTypeDef *hcdc;
+
+  if (USBD_CoreFindClass(pdev, &USBD_CDC_ECM) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  hcdc = (USBD_CDC_ECM_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hcdc == NULL)
   {
@@ -971,7 +994,14 @@ uint8_t USBD_CDC_ECM_SetTxBuffer(USBD_HandleTypeDef *pdev, uint8_t *pbuff, uint3
   */
 uint8_t USBD_CDC_ECM_SetRxBuffer(USBD_HandleTypeDef *pdev, uint8_t *pbuff)
 {
-  USBD_CDC_ECM_HandleTypeDef *hcdc = (USBD_CDC_ECM_HandleTypeDef *)pdev->pClassData_CDC_ECM;
+  USBD_CDC_ECM_HandleTypeDef *hcdc;
+
+  if (USBD_CoreFindClass(pdev, &USBD_CDC_ECM) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  hcdc = (USBD_CDC_ECM_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hcdc == NULL)
   {
@@ -985,32 +1015,52 @@ uint8_t USBD_CDC_ECM_SetRxBuffer(USBD_HandleTypeDef *pdev, uint8_t *pbuff)
 
 /**
   * @brief  USBD_CDC_ECM_TransmitPacket
-  *         Transmit packet on IN endpoint
+  *         Queue the current Tx buffer on the IN endpoint
   * @param  pdev: device instance
-  * @retval status
+  * @retval status: USBD_BUSY when CDC_ECM_TX_QUEUE_DEPTH transfers are pending
   */
 uint8_t USBD_CDC_ECM_TransmitPacket(USBD_HandleTypeDef *pdev)
 {
-  USBD_CDC_ECM_HandleTypeDef *hcdc = (USBD_CDC_ECM_HandleTypeDef *)pdev->pClassData_CDC_ECM;
-  USBD_StatusTypeDef ret = USBD_BUSY;
+  USBD_CDC_ECM_HandleTypeDef *hcdc;
+  USBD_XferTypeDef *xfer;
+  USBD_StatusTypeDef ret;
 
-  if (pdev->pClassData_CDC_ECM == NULL)
+  if (USBD_CoreFindClass(pdev, &USBD_CDC_ECM) != USBD_OK)
   {
     return (uint8_t)USBD_FAIL;
   }
 
-  if (hcdc->TxState == 0U)
+  hcdc = (USBD_CDC_ECM_HandleTypeDef *)USBD_CLASS_DATA(pdev);
+
+  if (USBD_CLASS_DATA(pdev) == NULL)
   {
-    /* Tx Transfer in progress */
-    hcdc->TxState = 1U;
+    return (uint8_t)USBD_FAIL;
+  }
 
-    /* Update the packet total length */
-    pdev->ep_in[CDC_ECM_IN_EP & 0xFU].total_length = hcdc->TxLength;
+  xfer = USBD_Xfer_Alloc(hcdc->TxXfer, CDC_ECM_TX_QUEUE_DEPTH);
 
-    /* Transmit next packet */
-    (void)USBD_LL_Transmit(pdev, CDC_ECM_IN_EP, hcdc->TxBuffer, hcdc->TxLength);
+  if (xfer == NULL)
+  {
+    return (uint8_t)USBD_BUSY;
+  }
+
+  xfer->ep_addr = CDC_ECM_IN_EP(pdev);
+  xfer->pbuf = hcdc->TxBuffer;
+  xfer->length = hcdc->TxLength;
+  xfer->nseg = 0U;
+  xfer->flags = USBD_XFER_FLAG_ZLP;
+  xfer->Cplt = USBD_CDC_ECM_TxCplt;
+  xfer->pOwner = hcdc;
+
+  /* Tx Transfer in progress */
+  hcdc->TxState = 1U;
 
-    ret = USBD_OK;
+  ret = USBD_Xfer_Submit(pdev, xfer);
+
+  /* Not started, nothing else is on the endpoint */
+  if ((ret != USBD_OK) && (USBD_Xfer_IsIdle(pdev, xfer->ep_addr) != 0U))
+  {
+    hcdc->TxState = 0U;
   }
 
   return (uint8_t)ret;
@@ -1024,15 +1074,22 @@ uint8_t USBD_CDC_ECM_TransmitPacket(USBD_HandleTypeDef *pdev)
   */
 uint8_t USBD_CDC_ECM_ReceivePacket(USBD_HandleTypeDef *pdev)
 {
-  USBD_CDC_ECM_HandleTypeDef *hcdc = (USBD_CDC_ECM_HandleTypeDef *)pdev->pClassData_CDC_ECM;
+  USBD_CDC_ECM_HandleTypeDef *hcdc;
 
-  if (pdev->pClassData_CDC_ECM == NULL)
+  if (USBD_CoreFindClass(pdev, &USBD_CDC_ECM) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  hcdc = (USBD_CDC_ECM_HandleTypeDef *)USBD_CLASS_DATA(pdev);
+
+  if (USBD_CLASS_DATA(pdev) == NULL)
   {
     return (uint8_t)USBD_FAIL;
   }
 
   /* Prepare Out endpoint to receive next packet */
-  (void)USBD_LL_PrepareReceive(pdev, CDC_ECM_OUT_EP, hcdc->RxBuffer, hcdc->MaxPcktLen);
+  (void)USBD_LL_PrepareReceive(pdev, CDC_ECM_OUT_EP(pdev), hcdc->RxBuffer, hcdc->MaxPcktLen);
 
   return (uint8_t)USBD_OK;
 }
@@ -1052,9 +1109,16 @@ uint8_t USBD_CDC_ECM_SendNotification(USBD_HandleTypeDef *pdev,
 {
   uint32_t Idx;
   uint32_t ReqSize = 0U;
-  USBD_CDC_ECM_HandleTypeDef *hcdc = (USBD_CDC_ECM_HandleTypeDef *)pdev->pClassData_CDC_ECM;
+  USBD_CDC_ECM_HandleTypeDef *hcdc;
   USBD_StatusTypeDef ret = USBD_OK;
 
+  if (USBD_CoreFindClass(pdev, &USBD_CDC_ECM) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  hcdc = (USBD_CDC_ECM_HandleTypeDef *)USBD_CLASS_DATA(pdev);
+
   if (hcdc == NULL)
   {
     return (uint8_t)USBD_FAIL;
@@ -1068,7 +1132,7 @@ uint8_t USBD_CDC_ECM_SendNotification(USBD_HandleTypeDef *pdev,
   {
   case ECM_NETWORK_CONNECTION:
     (hcdc->Req).wValue = bVal;
-    (hcdc->Req).wIndex = CDC_ECM_CMD_ITF_NBR;
+    (hcdc->Req).wIndex = CDC_ECM_CMD_ITF_NBR(pdev);
     (hcdc->Req).wLength = 0U;
 
     for (Idx = 0U; Idx < 8U; Idx++)
@@ -1080,7 +1144,7 @@ uint8_t USBD_CDC_ECM_SendNotification(USBD_HandleTypeDef *pdev,
 
   case ECM_RESPONSE_AVAILABLE:
     (hcdc->Req).wValue = 0U;
-    (hcdc->Req).wIndex = CDC_ECM_CMD_ITF_NBR;
+    (hcdc->Req).wIndex = CDC_ECM_CMD_ITF_NBR(pdev);
     (hcdc->Req).wLength = 0U;
     for (Idx = 0U; Idx < 8U; Idx++)
     {
@@ -1091,7 +1155,7 @@ uint8_t USBD_CDC_ECM_SendNotification(USBD_HandleTypeDef *pdev,
 
   case ECM_CONNECTION_SPEED_CHANGE:
     (hcdc->Req).wValue = 0U;
-    (hcdc->Req).wIndex = CDC_ECM_CMD_ITF_NBR;
+    (hcdc->Req).wIndex = CDC_ECM_CMD_ITF_NBR(pdev);
     (hcdc->Req).wLength = 0x0008U;
     ReqSize = 16U;
 
@@ -1113,13 +1177,13 @@ uint8_t USBD_CDC_ECM_SendNotification(USBD_HandleTypeDef *pdev,
   /* Transmit notification packet */
   if (ReqSize != 0U)
   {
-    (void)USBD_LL_Transmit(pdev, CDC_ECM_CMD_EP, (uint8_t *)&(hcdc->Req), ReqSize);
+    (void)USBD_LL_Transmit(pdev, CDC_ECM_CMD_EP(pdev), (uint8_t *)&(hcdc->Req), ReqSize);
   }
 
   return (uint8_t)ret;
 }
 
-void USBD_Update_CDC_ECM_DESC(uint8_t *desc,
+void USBD_Update_CDC_ECM_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc,
                               uint8_t cmd_itf,
                               uint8_t com_itf,
                               uint8_t in_ep,
@@ -1137,12 +1201,12 @@ void USBD_Update_CDC_ECM_DESC(uint8_t *desc,
   desc[67] = out_ep;
   desc[74] = in_ep;
 
-  CDC_ECM_IN_EP = in_ep;
-  CDC_ECM_OUT_EP = out_ep;
-  CDC_ECM_CMD_EP = cmd_ep;
-  CDC_ECM_CMD_ITF_NBR = cmd_itf;
-  CDC_ECM_COM_ITF_NBR = com_itf;
-  CDC_ECM_STR_DESC_IDX = str_idx;
+  USBD_CLASS_MAP(pdev).in_ep = in_ep;
+  USBD_CLASS_MAP(pdev).out_ep = out_ep;
+  USBD_CLASS_MAP(pdev).cmd_ep = cmd_ep;
+  USBD_CLASS_MAP(pdev).itf_nbr = cmd_itf;
+  USBD_CLASS_MAP(pdev).itf_num = 2U;
+  USBD_CLASS_MAP(pdev).str_idx = str_idx;
 }
 
 /**
@@ -126,10 +126,15 @@ typedef struct
 
 extern USBD_ClassTypeDef USBD_HID_CUSTOM;
 
-extern uint8_t CUSTOM_HID_IN_EP;
-extern uint8_t CUSTOM_HID_OUT_EP;
-extern uint8_t CUSTOM_HID_ITF_NBR;
-extern uint8_t CUSTOM_HID_STR_DESC_IDX;
+/* Instances of the class a device can mount */
+#ifndef USBD_CUSTOM_HID_MAX_INST
+#define USBD_CUSTOM_HID_MAX_INST  1U
+#endif /* USBD_CUSTOM_HID_MAX_INST */
+
+#define CUSTOM_HID_IN_EP(pdev)         (USBD_CLASS_MAP(pdev).in_ep)
+#define CUSTOM_HID_OUT_EP(pdev)        (USBD_CLASS_MAP(pdev).out_ep)
+#define CUSTOM_HID_ITF_NBR(pdev)       (USBD_CLASS_MAP(pdev).itf_nbr)
+#define CUSTOM_HID_STR_DESC_IDX(pdev)  (USBD_CLASS_MAP(pdev).str_idx)
 
 /**
   * @}
@@ -140,13 +145,17 @@ extern uint8_t CUSTOM_HID_STR_DESC_IDX;
   */
 uint8_t USBD_CUSTOM_HID_SendReport(USBD_HandleTypeDef *pdev,
                                    uint8_t *report, uint16_t len);
+#if (USBD_USE_OS == 1U)
+uint8_t USBD_CUSTOM_HID_SendReportWait(USBD_HandleTypeDef *pdev, uint8_t *report, uint16_t len,
+                                       uint32_t timeout);
+#endif /* (USBD_USE_OS == 1U) */
 
 uint8_t USBD_CUSTOM_HID_ReceivePacket(USBD_HandleTypeDef *pdev);
 
 uint8_t USBD_CUSTOM_HID_RegisterInterface(USBD_HandleTypeDef *pdev,
                                           USBD_CUSTOM_HID_ItfTypeDef *fops);
 
-void USBD_Update_HID_Custom_DESC(uint8_t *desc, uint8_t itf_no, uint8_t in_ep, uint8_t out_ep, uint8_t str_idx);
+void USBD_Update_HID_Custom_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no, uint8_t in_ep, uint8_t out_ep, uint8_t str_idx);
 
 /**
   * @}
@@ -106,9 +106,14 @@ typedef struct
 
 extern USBD_ClassTypeDef USBD_HID_MOUSE;
 
-extern uint8_t HID_MOUSE_IN_EP;
-extern uint8_t HID_MOUSE_ITF_NBR;
-extern uint8_t HID_MOUSE_STR_DESC_IDX;
+/* Instances of the class a device can mount */
+#ifndef USBD_HID_MOUSE_MAX_INST
+#define USBD_HID_MOUSE_MAX_INST  1U
+#endif /* USBD_HID_MOUSE_MAX_INST */
+
+#define HID_MOUSE_IN_EP(pdev)         (USBD_CLASS_MAP(pdev).in_ep)
+#define HID_MOUSE_ITF_NBR(pdev)       (USBD_CLASS_MAP(pdev).itf_nbr)
+#define HID_MOUSE_STR_DESC_IDX(pdev)  (USBD_CLASS_MAP(pdev).str_idx)
 
 /**
   * @}
@@ -118,9 +123,13 @@ extern uint8_t HID_MOUSE_STR_DESC_IDX;
   * @{
   */
 uint8_t USBD_HID_Mouse_SendReport(USBD_HandleTypeDef *pdev, uint8_t *report, uint16_t len);
+#if (USBD_USE_OS == 1U)
+uint8_t USBD_HID_Mouse_SendReportWait(USBD_HandleTypeDef *pdev, uint8_t *report, uint16_t len,
+                                      uint32_t timeout);
+#endif /* (USBD_USE_OS == 1U) */
 uint32_t USBD_HID_Mouse_GetPollingInterval(USBD_HandleTypeDef *pdev);
 
-void USBD_Update_HID_Mouse_DESC(uint8_t *desc, uint8_t itf_no, uint8_t in_ep, uint8_t str_idx);
+void USBD_Update_HID_Mouse_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no, uint8_t in_ep, uint8_t str_idx);
 
 /**
   * @}
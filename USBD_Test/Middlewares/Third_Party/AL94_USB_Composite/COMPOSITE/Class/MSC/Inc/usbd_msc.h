@@ -98,20 +98,32 @@ typedef struct
 
   uint32_t scsi_blk_addr;
   uint32_t scsi_blk_len;
+#if (USBD_USE_OS == 1U)
+  __IO uint8_t os_busy;    /* the worker task owns bot_data */
+  uint8_t os_rearm;        /* the next CBW waits for the worker task */
+  uint8_t os_op;           /* storage access posted, 0 once the BOT is reset */
+  uint8_t os_lun;
+  uint8_t os_class;        /* registry entry of the instance */
+#endif /* (USBD_USE_OS == 1U) */
 } USBD_MSC_BOT_HandleTypeDef;
 
 /* Structure for MSC process */
 extern USBD_ClassTypeDef USBD_MSC;
 
-extern uint8_t MSC_IN_EP;
-extern uint8_t MSC_OUT_EP;
-extern uint8_t MSC_ITF_NBR;
-extern uint8_t MSC_BOT_STR_DESC_IDX;
+/* Instances of the class a device can mount */
+#ifndef USBD_MSC_MAX_INST
+#define USBD_MSC_MAX_INST  1U
+#endif /* USBD_MSC_MAX_INST */
+
+#define MSC_IN_EP(pdev)             (USBD_CLASS_MAP(pdev).in_ep)
+#define MSC_OUT_EP(pdev)            (USBD_CLASS_MAP(pdev).out_ep)
+#define MSC_ITF_NBR(pdev)           (USBD_CLASS_MAP(pdev).itf_nbr)
+#define MSC_BOT_STR_DESC_IDX(pdev)  (USBD_CLASS_MAP(pdev).str_idx)
 
 uint8_t USBD_MSC_RegisterStorage(USBD_HandleTypeDef *pdev,
                                  USBD_StorageTypeDef *fops);
 
-void USBD_Update_MSC_DESC(uint8_t *desc, uint8_t itf_no, uint8_t in_ep, uint8_t out_ep, uint8_t str_idx);
+void USBD_Update_MSC_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no, uint8_t in_ep, uint8_t out_ep, uint8_t str_idx);
 
 /**
   * @}
@@ -78,7 +78,7 @@ EndBSPDependencies */
   */
 static void MSC_BOT_SendData(USBD_HandleTypeDef *pdev, uint8_t *pbuf, uint32_t len);
 static void MSC_BOT_CBW_Decode(USBD_HandleTypeDef *pdev);
-static void MSC_BOT_Abort(USBD_HandleTypeDef *pdev);
+static void MSC_BOT_StorageInit(USBD_HandleTypeDef *pdev);
 /**
   * @}
   */
@@ -97,7 +97,7 @@ static void MSC_BOT_Abort(USBD_HandleTypeDef *pdev);
   */
 void MSC_BOT_Init(USBD_HandleTypeDef *pdev)
 {
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
@@ -111,14 +111,30 @@ void MSC_BOT_Init(USBD_HandleTypeDef *pdev)
   hmsc->scsi_sense_head = 0U;
   hmsc->scsi_medium_state = SCSI_MEDIUM_UNLOCKED;
 
-  ((USBD_StorageTypeDef *)pdev->pUserData_MSC)->Init(0U);
+  /* Media start up may take long (SD card), run it on the first BOT request */
+  (void)USBD_CoreDeferInit(pdev, MSC_BOT_StorageInit);
 
-  (void)USBD_LL_FlushEP(pdev, MSC_OUT_EP);
-  (void)USBD_LL_FlushEP(pdev, MSC_IN_EP);
+  (void)USBD_LL_FlushEP(pdev, MSC_OUT_EP(pdev));
+  (void)USBD_LL_FlushEP(pdev, MSC_IN_EP(pdev));
+
+#if (USBD_USE_OS == 1U)
+  /* A storage access still running for the previous configuration is dropped */
+  hmsc->os_op = 0U;
+#endif /* (USBD_USE_OS == 1U) */
 
   /* Prepare EP to Receive First BOT Cmd */
-  (void)USBD_LL_PrepareReceive(pdev, MSC_OUT_EP, (uint8_t *)&hmsc->cbw,
-                               USBD_BOT_CBW_LENGTH);
+  MSC_BOT_ReceiveCBW(pdev);
+}
+
+/**
+  * @brief  MSC_BOT_StorageInit
+  *         Initialize the storage medium
+  * @param  pdev: device instance
+  * @retval None
+  */
+static void MSC_BOT_StorageInit(USBD_HandleTypeDef *pdev)
+{
+  ((USBD_StorageTypeDef *)USBD_USER_DATA(pdev))->Init(0U);
 }
 
 /**
@@ -129,7 +145,7 @@ void MSC_BOT_Init(USBD_HandleTypeDef *pdev)
   */
 void MSC_BOT_Reset(USBD_HandleTypeDef *pdev)
 {
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
@@ -139,12 +155,15 @@ void MSC_BOT_Reset(USBD_HandleTypeDef *pdev)
   hmsc->bot_state  = USBD_BOT_IDLE;
   hmsc->bot_status = USBD_BOT_STATUS_RECOVERY;
 
-  (void)USBD_LL_ClearStallEP(pdev, MSC_IN_EP);
-  (void)USBD_LL_ClearStallEP(pdev, MSC_OUT_EP);
+  (void)USBD_LL_ClearStallEP(pdev, MSC_IN_EP(pdev));
+  (void)USBD_LL_ClearStallEP(pdev, MSC_OUT_EP(pdev));
+
+#if (USBD_USE_OS == 1U)
+  hmsc->os_op = 0U;
+#endif /* (USBD_USE_OS == 1U) */
 
   /* Prepare EP to Receive First BOT Cmd */
-  (void)USBD_LL_PrepareReceive(pdev, MSC_OUT_EP, (uint8_t *)&hmsc->cbw,
-                               USBD_BOT_CBW_LENGTH);
+  MSC_BOT_ReceiveCBW(pdev);
 }
 
 /**
@@ -155,14 +174,47 @@ void MSC_BOT_Reset(USBD_HandleTypeDef *pdev)
   */
 void MSC_BOT_DeInit(USBD_HandleTypeDef  *pdev)
 {
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc != NULL)
   {
     hmsc->bot_state = USBD_BOT_IDLE;
+#if (USBD_USE_OS == 1U)
+    hmsc->os_op = 0U;
+    hmsc->os_rearm = 0U;
+#endif /* (USBD_USE_OS == 1U) */
   }
 }
 
+/**
+  * @brief  MSC_BOT_ReceiveCBW
+  *         Prepare the OUT endpoint for the next CBW. While the worker task
+  *         still accesses the media for a command the host gave up on, the
+  *         endpoint stays NAKing and the worker task arms it once done.
+  * @param  pdev: device instance
+  * @retval None
+  */
+void MSC_BOT_ReceiveCBW(USBD_HandleTypeDef *pdev)
+{
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
+
+  if (hmsc == NULL)
+  {
+    return;
+  }
+
+#if (USBD_USE_OS == 1U)
+  if (hmsc->os_busy != 0U)
+  {
+    hmsc->os_rearm = 1U;
+    return;
+  }
+#endif /* (USBD_USE_OS == 1U) */
+
+  (void)USBD_LL_PrepareReceive(pdev, MSC_OUT_EP(pdev), (uint8_t *)&hmsc->cbw,
+                               USBD_BOT_CBW_LENGTH);
+}
+
 /**
   * @brief  MSC_BOT_DataIn
   *         Handle BOT IN data stage
@@ -174,7 +226,7 @@ void MSC_BOT_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
 {
   UNUSED(epnum);
 
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
@@ -210,7 +262,7 @@ void MSC_BOT_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
 {
   UNUSED(epnum);
 
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
@@ -243,7 +295,7 @@ void MSC_BOT_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
   */
 static void  MSC_BOT_CBW_Decode(USBD_HandleTypeDef *pdev)
 {
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
@@ -253,7 +305,7 @@ static void  MSC_BOT_CBW_Decode(USBD_HandleTypeDef *pdev)
   hmsc->csw.dTag = hmsc->cbw.dTag;
   hmsc->csw.dDataResidue = hmsc->cbw.dDataLength;
 
-  if ((USBD_LL_GetRxDataSize(pdev, MSC_OUT_EP) != USBD_BOT_CBW_LENGTH) ||
+  if ((USBD_LL_GetRxDataSize(pdev, MSC_OUT_EP(pdev)) != USBD_BOT_CBW_LENGTH) ||
       (hmsc->cbw.dSignature != USBD_BOT_CBW_SIGNATURE) ||
       (hmsc->cbw.bLUN > 1U) || (hmsc->cbw.bCBLength < 1U) ||
       (hmsc->cbw.bCBLength > 16U))
@@ -311,7 +363,7 @@ static void  MSC_BOT_CBW_Decode(USBD_HandleTypeDef *pdev)
   */
 static void  MSC_BOT_SendData(USBD_HandleTypeDef *pdev, uint8_t *pbuf, uint32_t len)
 {
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   uint32_t length = MIN(hmsc->cbw.dDataLength, len);
 
@@ -324,7 +376,7 @@ static void  MSC_BOT_SendData(USBD_HandleTypeDef *pdev, uint8_t *pbuf, uint32_t
   hmsc->csw.bStatus = USBD_CSW_CMD_PASSED;
   hmsc->bot_state = USBD_BOT_SEND_DATA;
 
-  (void)USBD_LL_Transmit(pdev, MSC_IN_EP, pbuf, length);
+  (void)USBD_LL_Transmit(pdev, MSC_IN_EP(pdev), pbuf, length);
 }
 
 /**
@@ -336,7 +388,7 @@ static void  MSC_BOT_SendData(USBD_HandleTypeDef *pdev, uint8_t *pbuf, uint32_t
   */
 void  MSC_BOT_SendCSW(USBD_HandleTypeDef *pdev, uint8_t CSW_Status)
 {
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
@@ -347,11 +399,11 @@ void  MSC_BOT_SendCSW(USBD_HandleTypeDef *pdev, uint8_t CSW_Status)
   hmsc->csw.bStatus = CSW_Status;
   hmsc->bot_state = USBD_BOT_IDLE;
 
-  (void)USBD_LL_Transmit(pdev, MSC_IN_EP, (uint8_t *)&hmsc->csw,
+  (void)USBD_LL_Transmit(pdev, MSC_IN_EP(pdev), (uint8_t *)&hmsc->csw,
                          USBD_BOT_CSW_LENGTH);
 
   /* Prepare EP to Receive next Cmd */
-  (void)USBD_LL_PrepareReceive(pdev, MSC_OUT_EP, (uint8_t *)&hmsc->cbw,
+  (void)USBD_LL_PrepareReceive(pdev, MSC_OUT_EP(pdev), (uint8_t *)&hmsc->cbw,
                                USBD_BOT_CBW_LENGTH);
 }
 
@@ -362,9 +414,9 @@ void  MSC_BOT_SendCSW(USBD_HandleTypeDef *pdev, uint8_t CSW_Status)
   * @retval status
   */
 
-static void  MSC_BOT_Abort(USBD_HandleTypeDef *pdev)
+void  MSC_BOT_Abort(USBD_HandleTypeDef *pdev)
 {
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
@@ -375,15 +427,15 @@ static void  MSC_BOT_Abort(USBD_HandleTypeDef *pdev)
       (hmsc->cbw.dDataLength != 0U) &&
       (hmsc->bot_status == USBD_BOT_STATUS_NORMAL))
   {
-    (void)USBD_LL_StallEP(pdev, MSC_OUT_EP);
+    (void)USBD_LL_StallEP(pdev, MSC_OUT_EP(pdev));
   }
 
-  (void)USBD_LL_StallEP(pdev, MSC_IN_EP);
+  (void)USBD_LL_StallEP(pdev, MSC_IN_EP(pdev));
 
   if (hmsc->bot_status == USBD_BOT_STATUS_ERROR)
   {
-    (void)USBD_LL_StallEP(pdev, MSC_IN_EP);
-    (void)USBD_LL_StallEP(pdev, MSC_OUT_EP);
+    (void)USBD_LL_StallEP(pdev, MSC_IN_EP(pdev));
+    (void)USBD_LL_StallEP(pdev, MSC_OUT_EP(pdev));
   }
 }
 
@@ -397,7 +449,7 @@ static void  MSC_BOT_Abort(USBD_HandleTypeDef *pdev)
 
 void  MSC_BOT_CplClrFeature(USBD_HandleTypeDef *pdev, uint8_t epnum)
 {
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
@@ -406,8 +458,8 @@ void  MSC_BOT_CplClrFeature(USBD_HandleTypeDef *pdev, uint8_t epnum)
 
   if (hmsc->bot_status == USBD_BOT_STATUS_ERROR) /* Bad CBW Signature */
   {
-    (void)USBD_LL_StallEP(pdev, MSC_IN_EP);
-    (void)USBD_LL_StallEP(pdev, MSC_OUT_EP);
+    (void)USBD_LL_StallEP(pdev, MSC_IN_EP(pdev));
+    (void)USBD_LL_StallEP(pdev, MSC_OUT_EP(pdev));
   }
   else if (((epnum & 0x80U) == 0x80U) && (hmsc->bot_status != USBD_BOT_STATUS_RECOVERY))
   {
@@ -52,6 +52,10 @@ EndBSPDependencies */
   * @{
   */
 
+/* Media access posted to the worker task, 0 when none */
+#define SCSI_OS_READ                  1U
+#define SCSI_OS_WRITE                 2U
+
 /**
   * @}
   */
@@ -97,6 +101,12 @@ static int8_t SCSI_CheckAddressRange(USBD_HandleTypeDef *pdev, uint8_t lun,
 
 static int8_t SCSI_ProcessRead(USBD_HandleTypeDef *pdev, uint8_t lun);
 static int8_t SCSI_ProcessWrite(USBD_HandleTypeDef *pdev, uint8_t lun);
+static void SCSI_ReadDone(USBD_HandleTypeDef *pdev, uint32_t len);
+static void SCSI_WriteDone(USBD_HandleTypeDef *pdev, uint32_t len);
+#if (USBD_USE_OS == 1U)
+static int8_t SCSI_OS_Start(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t op);
+static void SCSI_OS_Work(USBD_HandleTypeDef *pdev, void *arg);
+#endif /* (USBD_USE_OS == 1U) */
 
 static int8_t SCSI_UpdateBotData(USBD_MSC_BOT_HandleTypeDef *hmsc,
                                  uint8_t *pBuff, uint16_t length);
@@ -121,7 +131,7 @@ static int8_t SCSI_UpdateBotData(USBD_MSC_BOT_HandleTypeDef *hmsc,
 int8_t SCSI_ProcessCmd(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *cmd)
 {
   int8_t ret;
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
@@ -211,7 +221,7 @@ int8_t SCSI_ProcessCmd(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *cmd)
 static int8_t SCSI_TestUnitReady(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *params)
 {
   UNUSED(params);
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
@@ -233,7 +243,7 @@ static int8_t SCSI_TestUnitReady(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t
     return -1;
   }
 
-  if (((USBD_StorageTypeDef *)pdev->pUserData_MSC)->IsReady(lun) != 0)
+  if (((USBD_StorageTypeDef *)USBD_USER_DATA(pdev))->IsReady(lun) != 0)
   {
     SCSI_SenseCode(pdev, lun, NOT_READY, MEDIUM_NOT_PRESENT);
     hmsc->bot_state = USBD_BOT_NO_DATA;
@@ -257,7 +267,7 @@ static int8_t SCSI_Inquiry(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *param
 {
   uint8_t *pPage;
   uint16_t len;
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
@@ -290,7 +300,7 @@ static int8_t SCSI_Inquiry(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *param
   }
   else
   {
-    pPage = (uint8_t *) &((USBD_StorageTypeDef *)pdev->pUserData_MSC)->pInquiry[lun * STANDARD_INQUIRY_DATA_LEN];
+    pPage = (uint8_t *) &((USBD_StorageTypeDef *)USBD_USER_DATA(pdev))->pInquiry[lun * STANDARD_INQUIRY_DATA_LEN];
     len = (uint16_t)pPage[4] + 5U;
 
     if (params[4] <= len)
@@ -316,14 +326,14 @@ static int8_t SCSI_ReadCapacity10(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t
 {
   UNUSED(params);
   int8_t ret;
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
     return -1;
   }
 
-  ret = ((USBD_StorageTypeDef *)pdev->pUserData_MSC)->GetCapacity(lun, &hmsc->scsi_blk_nbr, &hmsc->scsi_blk_size);
+  ret = ((USBD_StorageTypeDef *)USBD_USER_DATA(pdev))->GetCapacity(lun, &hmsc->scsi_blk_nbr, &hmsc->scsi_blk_size);
 
   if ((ret != 0) || (hmsc->scsi_medium_state == SCSI_MEDIUM_EJECTED))
   {
@@ -360,14 +370,14 @@ static int8_t SCSI_ReadCapacity16(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t
   UNUSED(params);
   uint8_t idx;
   int8_t ret;
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
     return -1;
   }
 
-  ret = ((USBD_StorageTypeDef *)pdev->pUserData_MSC)->GetCapacity(lun, &hmsc->scsi_blk_nbr, &hmsc->scsi_blk_size);
+  ret = ((USBD_StorageTypeDef *)USBD_USER_DATA(pdev))->GetCapacity(lun, &hmsc->scsi_blk_nbr, &hmsc->scsi_blk_size);
 
   if ((ret != 0) || (hmsc->scsi_medium_state == SCSI_MEDIUM_EJECTED))
   {
@@ -418,14 +428,14 @@ static int8_t SCSI_ReadFormatCapacity(USBD_HandleTypeDef *pdev, uint8_t lun, uin
   uint32_t blk_nbr;
   uint16_t i;
   int8_t ret;
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
     return -1;
   }
 
-  ret = ((USBD_StorageTypeDef *)pdev->pUserData_MSC)->GetCapacity(lun, &blk_nbr, &blk_size);
+  ret = ((USBD_StorageTypeDef *)USBD_USER_DATA(pdev))->GetCapacity(lun, &blk_nbr, &blk_size);
 
   if ((ret != 0) || (hmsc->scsi_medium_state == SCSI_MEDIUM_EJECTED))
   {
@@ -465,7 +475,7 @@ static int8_t SCSI_ReadFormatCapacity(USBD_HandleTypeDef *pdev, uint8_t lun, uin
 static int8_t SCSI_ModeSense6(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *params)
 {
   UNUSED(lun);
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
   uint16_t len = MODE_SENSE6_LEN;
 
   if (hmsc == NULL)
@@ -494,7 +504,7 @@ static int8_t SCSI_ModeSense6(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *pa
 static int8_t SCSI_ModeSense10(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *params)
 {
   UNUSED(lun);
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
   uint16_t len = MODE_SENSE10_LEN;
 
   if (hmsc == NULL)
@@ -524,7 +534,7 @@ static int8_t SCSI_RequestSense(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *
 {
   UNUSED(lun);
   uint8_t i;
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
@@ -581,7 +591,7 @@ static int8_t SCSI_RequestSense(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *
 void SCSI_SenseCode(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t sKey, uint8_t ASC)
 {
   UNUSED(lun);
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
@@ -610,7 +620,7 @@ void SCSI_SenseCode(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t sKey, uint8_t
 static int8_t SCSI_StartStopUnit(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *params)
 {
   UNUSED(lun);
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
@@ -656,7 +666,7 @@ static int8_t SCSI_StartStopUnit(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t
 static int8_t SCSI_AllowPreventRemovable(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *params)
 {
   UNUSED(lun);
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
@@ -687,7 +697,7 @@ static int8_t SCSI_AllowPreventRemovable(USBD_HandleTypeDef *pdev, uint8_t lun,
   */
 static int8_t SCSI_Read10(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *params)
 {
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
@@ -710,7 +720,7 @@ static int8_t SCSI_Read10(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *params
       return -1;
     }
 
-    if (((USBD_StorageTypeDef *)pdev->pUserData_MSC)->IsReady(lun) != 0)
+    if (((USBD_StorageTypeDef *)USBD_USER_DATA(pdev))->IsReady(lun) != 0)
     {
       SCSI_SenseCode(pdev, lun, NOT_READY, MEDIUM_NOT_PRESENT);
       return -1;
@@ -753,7 +763,7 @@ static int8_t SCSI_Read10(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *params
   */
 static int8_t SCSI_Read12(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *params)
 {
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
@@ -775,7 +785,7 @@ static int8_t SCSI_Read12(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *params
       return -1;
     }
 
-    if (((USBD_StorageTypeDef *)pdev->pUserData_MSC)->IsReady(lun) != 0)
+    if (((USBD_StorageTypeDef *)USBD_USER_DATA(pdev))->IsReady(lun) != 0)
     {
       SCSI_SenseCode(pdev, lun, NOT_READY, MEDIUM_NOT_PRESENT);
       return -1;
@@ -821,7 +831,7 @@ static int8_t SCSI_Read12(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *params
   */
 static int8_t SCSI_Write10(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *params)
 {
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
   uint32_t len;
 
   if (hmsc == NULL)
@@ -845,14 +855,14 @@ static int8_t SCSI_Write10(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *param
     }
 
     /* Check whether Media is ready */
-    if (((USBD_StorageTypeDef *)pdev->pUserData_MSC)->IsReady(lun) != 0)
+    if (((USBD_StorageTypeDef *)USBD_USER_DATA(pdev))->IsReady(lun) != 0)
     {
       SCSI_SenseCode(pdev, lun, NOT_READY, MEDIUM_NOT_PRESENT);
       return -1;
     }
 
     /* Check If media is write-protected */
-    if (((USBD_StorageTypeDef *)pdev->pUserData_MSC)->IsWriteProtected(lun) != 0)
+    if (((USBD_StorageTypeDef *)USBD_USER_DATA(pdev))->IsWriteProtected(lun) != 0)
     {
       SCSI_SenseCode(pdev, lun, NOT_READY, WRITE_PROTECTED);
       return -1;
@@ -886,7 +896,7 @@ static int8_t SCSI_Write10(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *param
 
     /* Prepare EP to receive first data packet */
     hmsc->bot_state = USBD_BOT_DATA_OUT;
-    (void)USBD_LL_PrepareReceive(pdev, MSC_OUT_EP, hmsc->bot_data, len);
+    (void)USBD_LL_PrepareReceive(pdev, MSC_OUT_EP(pdev), hmsc->bot_data, len);
   }
   else /* Write Process ongoing */
   {
@@ -906,7 +916,7 @@ static int8_t SCSI_Write10(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *param
   */
 static int8_t SCSI_Write12(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *params)
 {
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
   uint32_t len;
 
   if (hmsc == NULL)
@@ -930,7 +940,7 @@ static int8_t SCSI_Write12(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *param
     }
 
     /* Check whether Media is ready */
-    if (((USBD_StorageTypeDef *)pdev->pUserData_MSC)->IsReady(lun) != 0)
+    if (((USBD_StorageTypeDef *)USBD_USER_DATA(pdev))->IsReady(lun) != 0)
     {
       SCSI_SenseCode(pdev, lun, NOT_READY, MEDIUM_NOT_PRESENT);
       hmsc->bot_state = USBD_BOT_NO_DATA;
@@ -938,7 +948,7 @@ static int8_t SCSI_Write12(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *param
     }
 
     /* Check If media is write-protected */
-    if (((USBD_StorageTypeDef *)pdev->pUserData_MSC)->IsWriteProtected(lun) != 0)
+    if (((USBD_StorageTypeDef *)USBD_USER_DATA(pdev))->IsWriteProtected(lun) != 0)
     {
       SCSI_SenseCode(pdev, lun, NOT_READY, WRITE_PROTECTED);
       hmsc->bot_state = USBD_BOT_NO_DATA;
@@ -975,7 +985,7 @@ static int8_t SCSI_Write12(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *param
 
     /* Prepare EP to receive first data packet */
     hmsc->bot_state = USBD_BOT_DATA_OUT;
-    (void)USBD_LL_PrepareReceive(pdev, MSC_OUT_EP, hmsc->bot_data, len);
+    (void)USBD_LL_PrepareReceive(pdev, MSC_OUT_EP(pdev), hmsc->bot_data, len);
   }
   else /* Write Process ongoing */
   {
@@ -995,7 +1005,7 @@ static int8_t SCSI_Write12(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *param
   */
 static int8_t SCSI_Verify10(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *params)
 {
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
@@ -1029,7 +1039,7 @@ static int8_t SCSI_Verify10(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *para
 static int8_t SCSI_CheckAddressRange(USBD_HandleTypeDef *pdev, uint8_t lun,
                                      uint32_t blk_offset, uint32_t blk_nbr)
 {
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hmsc == NULL)
   {
@@ -1053,7 +1063,7 @@ static int8_t SCSI_CheckAddressRange(USBD_HandleTypeDef *pdev, uint8_t lun,
   */
 static int8_t SCSI_ProcessRead(USBD_HandleTypeDef *pdev, uint8_t lun)
 {
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
   uint32_t len = hmsc->scsi_blk_len * hmsc->scsi_blk_size;
 
   if (hmsc == NULL)
@@ -1063,7 +1073,11 @@ static int8_t SCSI_ProcessRead(USBD_HandleTypeDef *pdev, uint8_t lun)
 
   len = MIN(len, MSC_MEDIA_PACKET);
 
-  if (((USBD_StorageTypeDef *)pdev->pUserData_MSC)->Read(lun, hmsc->bot_data,
+#if (USBD_USE_OS == 1U)
+  /* The worker task reads the media, the IN endpoint stays idle meanwhile */
+  return SCSI_OS_Start(pdev, lun, SCSI_OS_READ);
+#else
+  if (((USBD_StorageTypeDef *)USBD_USER_DATA(pdev))->Read(lun, hmsc->bot_data,
                                                      hmsc->scsi_blk_addr,
                                                      (len / hmsc->scsi_blk_size)) < 0)
   {
@@ -1071,7 +1085,23 @@ static int8_t SCSI_ProcessRead(USBD_HandleTypeDef *pdev, uint8_t lun)
     return -1;
   }
 
-  (void)USBD_LL_Transmit(pdev, MSC_IN_EP, hmsc->bot_data, len);
+  SCSI_ReadDone(pdev, len);
+
+  return 0;
+#endif /* (USBD_USE_OS == 1U) */
+}
+
+/**
+  * @brief  SCSI_ReadDone
+  *         Send the blocks read from the media
+  * @param  len: bytes read into bot_data
+  * @retval None
+  */
+static void SCSI_ReadDone(USBD_HandleTypeDef *pdev, uint32_t len)
+{
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
+
+  (void)USBD_LL_Transmit(pdev, MSC_IN_EP(pdev), hmsc->bot_data, len);
 
   hmsc->scsi_blk_addr += (len / hmsc->scsi_blk_size);
   hmsc->scsi_blk_len -= (len / hmsc->scsi_blk_size);
@@ -1083,8 +1113,6 @@ static int8_t SCSI_ProcessRead(USBD_HandleTypeDef *pdev, uint8_t lun)
   {
     hmsc->bot_state = USBD_BOT_LAST_DATA_IN;
   }
-
-  return 0;
 }
 
 /**
@@ -1095,7 +1123,7 @@ static int8_t SCSI_ProcessRead(USBD_HandleTypeDef *pdev, uint8_t lun)
   */
 static int8_t SCSI_ProcessWrite(USBD_HandleTypeDef *pdev, uint8_t lun)
 {
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
   uint32_t len = hmsc->scsi_blk_len * hmsc->scsi_blk_size;
 
   if (hmsc == NULL)
@@ -1105,7 +1133,11 @@ static int8_t SCSI_ProcessWrite(USBD_HandleTypeDef *pdev, uint8_t lun)
 
   len = MIN(len, MSC_MEDIA_PACKET);
 
-  if (((USBD_StorageTypeDef *)pdev->pUserData_MSC)->Write(lun, hmsc->bot_data,
+#if (USBD_USE_OS == 1U)
+  /* The worker task writes the media, the OUT endpoint NAKs meanwhile */
+  return SCSI_OS_Start(pdev, lun, SCSI_OS_WRITE);
+#else
+  if (((USBD_StorageTypeDef *)USBD_USER_DATA(pdev))->Write(lun, hmsc->bot_data,
                                                       hmsc->scsi_blk_addr,
                                                       (len / hmsc->scsi_blk_size)) < 0)
   {
@@ -1113,6 +1145,22 @@ static int8_t SCSI_ProcessWrite(USBD_HandleTypeDef *pdev, uint8_t lun)
     return -1;
   }
 
+  SCSI_WriteDone(pdev, len);
+
+  return 0;
+#endif /* (USBD_USE_OS == 1U) */
+}
+
+/**
+  * @brief  SCSI_WriteDone
+  *         Ask for the next blocks once the previous ones are on the media
+  * @param  len: bytes written from bot_data
+  * @retval None
+  */
+static void SCSI_WriteDone(USBD_HandleTypeDef *pdev, uint32_t len)
+{
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
+
   hmsc->scsi_blk_addr += (len / hmsc->scsi_blk_size);
   hmsc->scsi_blk_len -= (len / hmsc->scsi_blk_size);
 
@@ -1128,12 +1176,131 @@ static int8_t SCSI_ProcessWrite(USBD_HandleTypeDef *pdev, uint8_t lun)
     len = MIN((hmsc->scsi_blk_len * hmsc->scsi_blk_size), MSC_MEDIA_PACKET);
 
     /* Prepare EP to Receive next packet */
-    (void)USBD_LL_PrepareReceive(pdev, MSC_OUT_EP, hmsc->bot_data, len);
+    (void)USBD_LL_PrepareReceive(pdev, MSC_OUT_EP(pdev), hmsc->bot_data, len);
+  }
+}
+
+#if (USBD_USE_OS == 1U)
+/**
+  * @brief  SCSI_OS_Start
+  *         Hand bot_data to the worker task for a media access
+  * @param  lun: Logical unit number
+  * @param  op: SCSI_OS_READ or SCSI_OS_WRITE
+  * @retval status
+  */
+static int8_t SCSI_OS_Start(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t op)
+{
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
+
+  hmsc->os_op = op;
+  hmsc->os_lun = lun;
+  hmsc->os_class = pdev->classId;
+  hmsc->os_busy = 1U;
+
+  if (USBD_OS_Post(pdev, SCSI_OS_Work, hmsc) != USBD_OK)
+  {
+    hmsc->os_busy = 0U;
+    hmsc->os_op = 0U;
+    SCSI_SenseCode(pdev, lun, HARDWARE_ERROR,
+                   (op == SCSI_OS_READ) ? UNRECOVERED_READ_ERROR : WRITE_FAULT);
+    return -1;
   }
 
   return 0;
 }
 
+/**
+  * @brief  SCSI_OS_Work
+  *         Access the media from the worker task, then carry on with the BOT
+  *         transfer as the interrupt would have. Nothing the interrupt does
+  *         meanwhile touches bot_data or the block range: both endpoints are
+  *         idle and a new CBW is not received before the job ends.
+  * @param  arg: BOT handle of the instance
+  * @retval None
+  */
+static void SCSI_OS_Work(USBD_HandleTypeDef *pdev, void *arg)
+{
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)arg;
+  USBD_StorageTypeDef *storage = (USBD_StorageTypeDef *)pdev->tclass[hmsc->os_class].pUserData;
+  uint32_t len = MIN(hmsc->scsi_blk_len * hmsc->scsi_blk_size, MSC_MEDIA_PACKET);
+  uint16_t blk_len = (uint16_t)(len / hmsc->scsi_blk_size);
+  uint8_t op = hmsc->os_op;
+  uint8_t classId;
+  uint32_t primask;
+  int8_t ret = 0;
+
+  if (op == SCSI_OS_READ)
+  {
+    ret = storage->Read(hmsc->os_lun, hmsc->bot_data, hmsc->scsi_blk_addr, blk_len);
+  }
+  else if (op == SCSI_OS_WRITE)
+  {
+    ret = storage->Write(hmsc->os_lun, hmsc->bot_data, hmsc->scsi_blk_addr, blk_len);
+  }
+  else
+  {
+    /* Reset before the job ran */
+  }
+
+  USBD_ENTER_CRITICAL(primask);
+
+  classId = pdev->classId;
+  pdev->classId = hmsc->os_class;
+  hmsc->os_busy = 0U;
+
+  if (hmsc->os_op == 0U)
+  {
+    /* The BOT was reset meanwhile, the result is stale */
+    if (hmsc->os_rearm != 0U)
+    {
+      hmsc->os_rearm = 0U;
+      MSC_BOT_ReceiveCBW(pdev);
+    }
+  }
+  else if (ret < 0)
+  {
+    hmsc->os_op = 0U;
+
+    if (op == SCSI_OS_READ)
+    {
+      SCSI_SenseCode(pdev, hmsc->os_lun, HARDWARE_ERROR, UNRECOVERED_READ_ERROR);
+
+      /* Failing before any data went out is a CBW error, as in MSC_BOT_CBW_Decode */
+      if (hmsc->csw.dDataResidue == hmsc->cbw.dDataLength)
+      {
+        MSC_BOT_Abort(pdev);
+      }
+      else
+      {
+        MSC_BOT_SendCSW(pdev, USBD_CSW_CMD_FAILED);
+      }
+    }
+    else
+    {
+      SCSI_SenseCode(pdev, hmsc->os_lun, HARDWARE_ERROR, WRITE_FAULT);
+      MSC_BOT_SendCSW(pdev, USBD_CSW_CMD_FAILED);
+    }
+  }
+  else
+  {
+    hmsc->os_op = 0U;
+
+    if (op == SCSI_OS_READ)
+    {
+      SCSI_ReadDone(pdev, len);
+    }
+    else
+    {
+      SCSI_WriteDone(pdev, len);
+    }
+  }
+
+  pdev->classId = classId;
+
+  USBD_EXIT_CRITICAL(primask);
+}
+#endif /* (USBD_USE_OS == 1U) */
+
 
 /**
   * @brief  SCSI_UpdateBotData
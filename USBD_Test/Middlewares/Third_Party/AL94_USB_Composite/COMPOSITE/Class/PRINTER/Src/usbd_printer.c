@@ -64,11 +64,6 @@ EndBSPDependencies */
 #define _PRNT_ITF_NBR 0x00
 #define _PRINTER_STR_DESC_IDX 0x01
 
-uint8_t PRNT_IN_EP = _PRNT_IN_EP;
-uint8_t PRNT_OUT_EP = _PRNT_OUT_EP;
-uint8_t PRNT_ITF_NBR = _PRNT_ITF_NBR;
-uint8_t PRINTER_STR_DESC_IDX = _PRINTER_STR_DESC_IDX;
-
 /** @addtogroup STM32_USB_DEVICE_LIBRARY
   * @{
   */
@@ -109,11 +104,11 @@ static uint8_t USBD_PRNT_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *r
 static uint8_t USBD_PRNT_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum);
 static uint8_t USBD_PRNT_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum);
 
-static uint8_t *USBD_PRNT_GetFSCfgDesc(uint16_t *length);
-static uint8_t *USBD_PRNT_GetHSCfgDesc(uint16_t *length);
-static uint8_t *USBD_PRNT_GetOtherSpeedCfgDesc(uint16_t *length);
-static uint8_t *USBD_PRNT_GetOtherSpeedCfgDesc(uint16_t *length);
-uint8_t *USBD_PRNT_GetDeviceQualifierDescriptor(uint16_t *length);
+static uint8_t *USBD_PRNT_GetFSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_PRNT_GetHSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_PRNT_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_PRNT_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+uint8_t *USBD_PRNT_GetDeviceQualifierDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length);
 
 /* USB Standard Device Descriptor */
 __ALIGN_BEGIN static uint8_t USBD_PRNT_DeviceQualifierDesc[USB_LEN_DEV_QUALIFIER_DESC] __ALIGN_END =
@@ -138,7 +133,7 @@ __ALIGN_BEGIN static uint8_t USBD_PRNT_DeviceQualifierDesc[USB_LEN_DEV_QUALIFIER
   * @{
   */
 
-static USBD_PRNT_HandleTypeDef USBD_PRNT_Instance;
+static USBD_PRNT_HandleTypeDef USBD_PRNT_Instance[USBD_MAX_NUM_DEV][USBD_PRNT_MAX_INST];
 
 /* PRNT interface class callbacks structure */
 USBD_ClassTypeDef USBD_PRNT =
@@ -323,16 +318,16 @@ static uint8_t USBD_PRNT_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
 
   USBD_PRNT_HandleTypeDef *hPRNT;
   uint16_t mps;
-  hPRNT = &USBD_PRNT_Instance;
+  hPRNT = &USBD_PRNT_Instance[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)];
 
   if (hPRNT == NULL)
   {
-    pdev->pClassData_PRNTR = NULL;
+    USBD_CLASS_DATA(pdev) = NULL;
     return (uint8_t)USBD_EMEM;
   }
 
   /* Setup the pClassData pointer */
-  pdev->pClassData_PRNTR = (void *)hPRNT;
+  USBD_CLASS_DATA(pdev) = (void *)hPRNT;
 
   /* Setup the max packet size according to selected speed */
   if (pdev->dev_speed == USBD_SPEED_HIGH)
@@ -345,22 +340,22 @@ static uint8_t USBD_PRNT_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   }
 
   /* Open EP IN */
-  (void)USBD_LL_OpenEP(pdev, PRNT_IN_EP, USBD_EP_TYPE_BULK, mps);
+  (void)USBD_LL_OpenEP(pdev, PRNT_IN_EP(pdev), USBD_EP_TYPE_BULK, mps);
 
   /* Set endpoint as used */
-  pdev->ep_in[PRNT_IN_EP & 0xFU].is_used = 1U;
+  pdev->ep_in[PRNT_IN_EP(pdev) & 0xFU].is_used = 1U;
 
   /* Open EP OUT */
-  (void)USBD_LL_OpenEP(pdev, PRNT_OUT_EP, USBD_EP_TYPE_BULK, mps);
+  (void)USBD_LL_OpenEP(pdev, PRNT_OUT_EP(pdev), USBD_EP_TYPE_BULK, mps);
 
   /* Set endpoint as used */
-  pdev->ep_out[PRNT_OUT_EP & 0xFU].is_used = 1U;
+  pdev->ep_out[PRNT_OUT_EP(pdev) & 0xFU].is_used = 1U;
 
   /* Init  physical Interface components */
-  ((USBD_PRNT_ItfTypeDef *)pdev->pUserData_PRNTR)->Init();
+  ((USBD_PRNT_ItfTypeDef *)USBD_USER_DATA(pdev))->Init();
 
   /* Prepare Out endpoint to receive next packet */
-  (void)USBD_LL_PrepareReceive(pdev, PRNT_OUT_EP, hPRNT->RxBuffer, mps);
+  (void)USBD_LL_PrepareReceive(pdev, PRNT_OUT_EP(pdev), hPRNT->RxBuffer, mps);
 
   /* End of initialization phase */
   return (uint8_t)USBD_OK;
@@ -378,21 +373,21 @@ static uint8_t USBD_PRNT_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   UNUSED(cfgidx);
 
   /* Close EP IN */
-  (void)USBD_LL_CloseEP(pdev, PRNT_IN_EP);
-  pdev->ep_in[PRNT_IN_EP & 0xFU].is_used = 0U;
+  (void)USBD_LL_CloseEP(pdev, PRNT_IN_EP(pdev));
+  pdev->ep_in[PRNT_IN_EP(pdev) & 0xFU].is_used = 0U;
 
   /* Close EP OUT */
-  (void)USBD_LL_CloseEP(pdev, PRNT_OUT_EP);
-  pdev->ep_out[PRNT_OUT_EP & 0xFU].is_used = 0U;
+  (void)USBD_LL_CloseEP(pdev, PRNT_OUT_EP(pdev));
+  pdev->ep_out[PRNT_OUT_EP(pdev) & 0xFU].is_used = 0U;
 
   /* DeInit physical Interface components */
-  if (pdev->pClassData_PRNTR != NULL)
+  if (USBD_CLASS_DATA(pdev) != NULL)
   {
-    ((USBD_PRNT_ItfTypeDef *)pdev->pUserData_PRNTR)->DeInit();
+    ((USBD_PRNT_ItfTypeDef *)USBD_USER_DATA(pdev))->DeInit();
 #if (0)
-    (void)USBD_free(pdev->pClassData_PRNTR);
+    (void)USBD_free(USBD_CLASS_DATA(pdev));
 #endif
-    pdev->pClassData_PRNTR = NULL;
+    USBD_CLASS_DATA(pdev) = NULL;
   }
 
   return 0U;
@@ -407,8 +402,8 @@ static uint8_t USBD_PRNT_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   */
 static uint8_t USBD_PRNT_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
-  USBD_PRNT_HandleTypeDef *hPRNT = (USBD_PRNT_HandleTypeDef *)pdev->pClassData_PRNTR;
-  USBD_PRNT_ItfTypeDef *hPRNTitf = (USBD_PRNT_ItfTypeDef *)pdev->pUserData_PRNTR;
+  USBD_PRNT_HandleTypeDef *hPRNT = (USBD_PRNT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
+  USBD_PRNT_ItfTypeDef *hPRNTitf = (USBD_PRNT_ItfTypeDef *)USBD_USER_DATA(pdev);
 
   USBD_StatusTypeDef ret = USBD_OK;
   uint16_t status_info = 0U;
@@ -505,7 +500,7 @@ static uint8_t USBD_PRNT_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *r
   */
 static uint8_t USBD_PRNT_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
 {
-  USBD_PRNT_HandleTypeDef *hPRNT = (USBD_PRNT_HandleTypeDef *)pdev->pClassData_PRNTR;
+  USBD_PRNT_HandleTypeDef *hPRNT = (USBD_PRNT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
   PCD_HandleTypeDef *hpcd = pdev->pData;
 
   if (hPRNT == NULL)
@@ -538,7 +533,7 @@ static uint8_t USBD_PRNT_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
   */
 static uint8_t USBD_PRNT_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
 {
-  USBD_PRNT_HandleTypeDef *hPRNT = (USBD_PRNT_HandleTypeDef *)pdev->pClassData_PRNTR;
+  USBD_PRNT_HandleTypeDef *hPRNT = (USBD_PRNT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hPRNT == NULL)
   {
@@ -550,7 +545,7 @@ static uint8_t USBD_PRNT_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
 
   /* USB data will be immediately processed, this allow next USB traffic being
   NAKed till the end of the application Xfer */
-  ((USBD_PRNT_ItfTypeDef *)pdev->pUserData_PRNTR)->Receive(hPRNT->RxBuffer, &hPRNT->RxLength);
+  ((USBD_PRNT_ItfTypeDef *)USBD_USER_DATA(pdev))->Receive(hPRNT->RxBuffer, &hPRNT->RxLength);
 
   return (uint8_t)USBD_OK;
 }
@@ -558,11 +553,14 @@ static uint8_t USBD_PRNT_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
 /**
   * @brief  USBD_PRNT_GetFSCfgDesc
   *         Return configuration descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_PRNT_GetFSCfgDesc(uint16_t *length)
+static uint8_t *USBD_PRNT_GetFSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_PRNT_CfgFSDesc);
   return USBD_PRNT_CfgFSDesc;
 }
@@ -570,11 +568,14 @@ static uint8_t *USBD_PRNT_GetFSCfgDesc(uint16_t *length)
 /**
   * @brief  USBD_PRNT_GetHSCfgDesc
   *         Return configuration descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_PRNT_GetHSCfgDesc(uint16_t *length)
+static uint8_t *USBD_PRNT_GetHSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_PRNT_CfgHSDesc);
   return USBD_PRNT_CfgHSDesc;
 }
@@ -582,11 +583,14 @@ static uint8_t *USBD_PRNT_GetHSCfgDesc(uint16_t *length)
 /**
   * @brief  USBD_PRNT_GetOtherSpeedCfgDesc
   *         Return configuration descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_PRNT_GetOtherSpeedCfgDesc(uint16_t *length)
+static uint8_t *USBD_PRNT_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_PRNT_OtherSpeedCfgDesc);
   return USBD_PRNT_OtherSpeedCfgDesc;
 }
@@ -594,11 +598,14 @@ static uint8_t *USBD_PRNT_GetOtherSpeedCfgDesc(uint16_t *length)
 /**
   * @brief  USBD_PRNT_GetDeviceQualifierDescriptor
   *         return Device Qualifier descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-uint8_t *USBD_PRNT_GetDeviceQualifierDescriptor(uint16_t *length)
+uint8_t *USBD_PRNT_GetDeviceQualifierDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_PRNT_DeviceQualifierDesc);
   return USBD_PRNT_DeviceQualifierDesc;
 }
@@ -611,6 +618,11 @@ uint8_t *USBD_PRNT_GetDeviceQualifierDescriptor(uint16_t *length)
   */
 uint8_t USBD_PRNT_RegisterInterface(USBD_HandleTypeDef *pdev, USBD_PRNT_ItfTypeDef *fops)
 {
+  if (USBD_CoreFindClass(pdev, &USBD_PRNT) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
   /* Check if the fops pointer is valid */
   if (fops == NULL)
   {
@@ -618,7 +630,7 @@ uint8_t USBD_PRNT_RegisterInterface(USBD_HandleTypeDef *pdev, USBD_PRNT_ItfTypeD
   }
 
   /* Setup the fops pointer */
-  pdev->pUserData_PRNTR = fops;
+  USBD_USER_DATA(pdev) = fops;
 
   return (uint8_t)USBD_OK;
 }
@@ -631,7 +643,14 @@ uint8_t USBD_PRNT_RegisterInterface(USBD_HandleTypeDef *pdev, USBD_PRNT_ItfTypeD
   */
 uint8_t USBD_PRNT_SetRxBuffer(USBD_HandleTypeDef *pdev, uint8_t *pbuff)
 {
-  USBD_PRNT_HandleTypeDef *hPRNT = (USBD_PRNT_HandleTypeDef *)pdev->pClassData_PRNTR;
+  USBD_PRNT_HandleTypeDef *hPRNT;
+
+  if (USBD_CoreFindClass(pdev, &USBD_PRNT) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  hPRNT = (USBD_PRNT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   hPRNT->RxBuffer = pbuff;
 
@@ -646,7 +665,14 @@ uint8_t USBD_PRNT_SetRxBuffer(USBD_HandleTypeDef *pdev, uint8_t *pbuff)
   */
 uint8_t USBD_PRNT_ReceivePacket(USBD_HandleTypeDef *pdev)
 {
-  USBD_PRNT_HandleTypeDef *hPRNT = (USBD_PRNT_HandleTypeDef *)pdev->pClassData_PRNTR;
+  USBD_PRNT_HandleTypeDef *hPRNT;
+
+  if (USBD_CoreFindClass(pdev, &USBD_PRNT) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  hPRNT = (USBD_PRNT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hPRNT == NULL)
   {
@@ -656,30 +682,31 @@ uint8_t USBD_PRNT_ReceivePacket(USBD_HandleTypeDef *pdev)
   if (pdev->dev_speed == USBD_SPEED_HIGH)
   {
     /* Prepare Out endpoint to receive next packet */
-    (void)USBD_LL_PrepareReceive(pdev, PRNT_OUT_EP, hPRNT->RxBuffer,
+    (void)USBD_LL_PrepareReceive(pdev, PRNT_OUT_EP(pdev), hPRNT->RxBuffer,
                                  PRNT_DATA_HS_OUT_PACKET_SIZE);
   }
   else
   {
     /* Prepare Out endpoint to receive next packet */
-    (void)USBD_LL_PrepareReceive(pdev, PRNT_OUT_EP, hPRNT->RxBuffer,
+    (void)USBD_LL_PrepareReceive(pdev, PRNT_OUT_EP(pdev), hPRNT->RxBuffer,
                                  PRNT_DATA_FS_OUT_PACKET_SIZE);
   }
 
   return (uint8_t)USBD_OK;
 }
 
-void USBD_Update_PRNT_DESC(uint8_t *desc, uint8_t itf_no, uint8_t in_ep, uint8_t out_ep, uint8_t str_idx)
+void USBD_Update_PRNT_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no, uint8_t in_ep, uint8_t out_ep, uint8_t str_idx)
 {
   desc[11] = itf_no;
   desc[17] = str_idx;
   desc[20] = in_ep;
   desc[27] = out_ep;
 
-  PRNT_IN_EP = in_ep;
-  PRNT_OUT_EP = out_ep;
-  PRNT_ITF_NBR = itf_no;
-  PRINTER_STR_DESC_IDX = str_idx;
+  USBD_CLASS_MAP(pdev).in_ep = in_ep;
+  USBD_CLASS_MAP(pdev).out_ep = out_ep;
+  USBD_CLASS_MAP(pdev).itf_nbr = itf_no;
+  USBD_CLASS_MAP(pdev).itf_num = 1U;
+  USBD_CLASS_MAP(pdev).str_idx = str_idx;
 }
 /**
   * @}
@@ -115,6 +115,15 @@ extern "C" {
 #define UVC_ISO_HS_MPS                                512U
 #endif
 
+/* Smallest packet sizes the composite bandwidth planner may select */
+#ifndef UVC_ISO_FS_MPS_MIN
+#define UVC_ISO_FS_MPS_MIN                            (UVC_ISO_FS_MPS / 4U)
+#endif
+
+#ifndef UVC_ISO_HS_MPS_MIN
+#define UVC_ISO_HS_MPS_MIN                            (UVC_ISO_HS_MPS / 4U)
+#endif
+
 #ifndef UVC_HEADER_PACKET_CNT
 #define UVC_HEADER_PACKET_CNT                         0x01U
 #endif
@@ -400,6 +409,7 @@ extern "C" {
     uint8_t buffer[UVC_TOTAL_BUF_SIZE];
     VIDEO_OffsetTypeDef offset;
     USBD_VIDEO_ControlTypeDef control;
+    uint8_t payload_header[2];
   } USBD_VIDEO_HandleTypeDef;
 
   typedef struct
@@ -407,6 +417,8 @@ extern "C" {
     int8_t (*Init)(void);
     int8_t (*DeInit)(void);
     int8_t (*Control)(uint8_t, uint8_t *, uint16_t);
+    /* Size in: the largest packet the endpoint carries (header included),
+       out: the packet size, clamped to the size in */
     int8_t (*Data)(uint8_t **, uint16_t *, uint16_t *);
     uint8_t *pStrDesc;
   } USBD_VIDEO_ItfTypeDef;
@@ -434,10 +446,15 @@ extern "C" {
 
   extern USBD_ClassTypeDef USBD_VIDEO;
 
-  extern uint8_t UVC_IN_EP;
-  extern uint8_t UVC_VC_IF_NUM;
-  extern uint8_t UVC_VS_IF_NUM;
-  extern uint8_t UVC_STR_DESC_IDX;
+  /* Instances of the class a device can mount */
+  #ifndef USBD_UVC_MAX_INST
+  #define USBD_UVC_MAX_INST  1U
+  #endif /* USBD_UVC_MAX_INST */
+
+  #define UVC_IN_EP(pdev)         (USBD_CLASS_MAP(pdev).in_ep)
+  #define UVC_VC_IF_NUM(pdev)     (USBD_CLASS_MAP(pdev).itf_nbr)
+  #define UVC_VS_IF_NUM(pdev)     ((uint8_t)(USBD_CLASS_MAP(pdev).itf_nbr + 1U))
+  #define UVC_STR_DESC_IDX(pdev)  (USBD_CLASS_MAP(pdev).str_idx)
 
   /**
   * @}
@@ -448,8 +465,10 @@ extern "C" {
   */
 
   uint8_t USBD_VIDEO_RegisterInterface(USBD_HandleTypeDef *pdev, USBD_VIDEO_ItfTypeDef *fops);
+  uint8_t USBD_VIDEO_SetIsoMPS(USBD_HandleTypeDef *pdev, uint16_t fs_mps, uint16_t hs_mps);
+  uint16_t USBD_VIDEO_GetIsoMPS(USBD_HandleTypeDef *pdev, uint8_t speed);
 
-  void USBD_Update_UVC_DESC(uint8_t *desc, uint8_t vc_itf, uint8_t vs_itf, uint8_t in_ep, uint8_t str_idx);
+  void USBD_Update_UVC_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t vc_itf, uint8_t vs_itf, uint8_t in_ep, uint8_t str_idx);
 
   /**
   * @}
@@ -30,6 +30,13 @@ extern "C" {
 #include "usbd_def.h"
 #include "usbd_ioreq.h"
 #include "usbd_ctlreq.h"
+#include "usbd_xfer.h"
+#include "usbd_os.h"
+#include "usbd_time.h"
+#include "usbd_enum.h"
+#include "usbd_gov.h"
+#include "usbd_fifo.h"
+#include "usbd_ipc.h"
 
 /** @addtogroup STM32_USB_DEVICE_LIBRARY
   * @{
@@ -87,8 +94,20 @@ USBD_StatusTypeDef USBD_DeInit(USBD_HandleTypeDef *pdev);
 USBD_StatusTypeDef USBD_Start(USBD_HandleTypeDef *pdev);
 USBD_StatusTypeDef USBD_Stop(USBD_HandleTypeDef *pdev);
 USBD_StatusTypeDef USBD_RegisterClass(USBD_HandleTypeDef *pdev, USBD_ClassTypeDef *pclass);
+USBD_StatusTypeDef USBD_SelectClass(USBD_HandleTypeDef *pdev,
+                                    USBD_ClassTypeDef *pclass, uint8_t inst);
+USBD_StatusTypeDef USBD_CoreFindClass(USBD_HandleTypeDef *pdev, USBD_ClassTypeDef *pclass);
+USBD_StatusTypeDef USBD_CoreDeferInit(USBD_HandleTypeDef *pdev,
+                                      void (*DeferredInit)(USBD_HandleTypeDef *pdev));
+#if (USBD_DEFER_CLASS_INIT == 1U)
+void USBD_CoreRunDeferredInit(USBD_HandleTypeDef *pdev);
+#endif /* (USBD_DEFER_CLASS_INIT == 1U) */
 
 USBD_StatusTypeDef USBD_RunTestMode(USBD_HandleTypeDef *pdev);
+#if (USBD_LPM_ENABLED == 1U)
+USBD_StatusTypeDef USBD_LPM_Veto(USBD_HandleTypeDef *pdev, uint8_t veto);
+void USBD_LPM_SetEPBusy(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t busy);
+#endif /* (USBD_LPM_ENABLED == 1U) */
 USBD_StatusTypeDef USBD_SetClassConfig(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
 USBD_StatusTypeDef USBD_ClrClassConfig(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
 
@@ -122,10 +141,14 @@ USBD_StatusTypeDef USBD_LL_FlushEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr);
 USBD_StatusTypeDef USBD_LL_StallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr);
 USBD_StatusTypeDef USBD_LL_ClearStallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr);
 USBD_StatusTypeDef USBD_LL_SetUSBAddress(USBD_HandleTypeDef *pdev, uint8_t dev_addr);
+USBD_StatusTypeDef USBD_LL_SetConfiguration(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
 
 USBD_StatusTypeDef USBD_LL_Transmit(USBD_HandleTypeDef *pdev, uint8_t ep_addr,
                                     uint8_t *pbuf, uint32_t size);
 
+USBD_StatusTypeDef USBD_LL_TransmitV(USBD_HandleTypeDef *pdev, uint8_t ep_addr,
+                                     USBD_SegmentTypeDef *pseg, uint8_t nseg);
+
 USBD_StatusTypeDef USBD_LL_PrepareReceive(USBD_HandleTypeDef *pdev, uint8_t ep_addr,
                                           uint8_t *pbuf, uint32_t size);
 
@@ -134,6 +157,24 @@ uint32_t USBD_LL_GetRxDataSize(USBD_HandleTypeDef *pdev, uint8_t  ep_addr);
 
 void  USBD_LL_Delay(uint32_t Delay);
 
+#if (USBD_LPM_ENABLED == 1U)
+USBD_StatusTypeDef USBD_LL_SetLPMAck(USBD_HandleTypeDef *pdev, uint8_t ack);
+#endif /* (USBD_LPM_ENABLED == 1U) */
+
+#if (USBD_USE_TIMEBASE == 1U)
+uint32_t USBD_LL_GetFrameNumber(USBD_HandleTypeDef *pdev);
+#endif /* (USBD_USE_TIMEBASE == 1U) */
+
+#if (USBD_USE_TIMEBASE == 1U) || (USBD_ENUM_TRACE == 1U) || (USBD_USE_CDC_BENCH == 1U) || \
+    (USBD_USE_CDC_FRAME == 1U)
+uint32_t USBD_LL_GetTimestamp(void);
+uint32_t USBD_LL_GetTimestampFreq(void);
+#endif /* (USBD_USE_TIMEBASE == 1U) || (USBD_ENUM_TRACE == 1U) || (USBD_USE_CDC_BENCH == 1U) || (USBD_USE_CDC_FRAME == 1U) */
+
+#if (USBD_USE_GOVERNOR == 1U)
+USBD_StatusTypeDef USBD_LL_SetPerfLevel(uint8_t level);
+#endif /* (USBD_USE_GOVERNOR == 1U) */
+
 /**
   * @}
   */
@@ -28,6 +28,10 @@ extern "C" {
 /* Includes ------------------------------------------------------------------*/
 #include "usbd_conf.h"
 
+#if (USBD_USE_OS == 1U)
+#include "cmsis_os2.h"
+#endif /* (USBD_USE_OS == 1U) */
+
 /** @addtogroup STM32_USBD_DEVICE_LIBRARY
   * @{
   */
@@ -53,10 +57,63 @@ extern "C" {
 #define USBD_MAX_NUM_CONFIGURATION                      1U
 #endif /* USBD_MAX_NUM_CONFIGURATION */
 
+#ifndef USBD_MAX_NUM_DEV
+#define USBD_MAX_NUM_DEV                                1U
+#endif /* USBD_MAX_NUM_DEV */
+
+#ifndef USBD_MAX_CLASS_NUM
+#define USBD_MAX_CLASS_NUM                              16U
+#endif /* USBD_MAX_CLASS_NUM */
+
+/* Endpoints of the USB core in each direction, EP0 included */
+#ifndef USBD_MAX_EP_NUM
+#define USBD_MAX_EP_NUM                                 16U
+#endif /* USBD_MAX_EP_NUM */
+
 #ifndef USBD_LPM_ENABLED
 #define USBD_LPM_ENABLED                                0U
 #endif /* USBD_LPM_ENABLED */
 
+#ifndef USBD_USE_OS
+#define USBD_USE_OS                                     0U
+#endif /* USBD_USE_OS */
+
+#ifndef USBD_USE_TIMEBASE
+#define USBD_USE_TIMEBASE                               0U
+#endif /* USBD_USE_TIMEBASE */
+
+#ifndef USBD_ENUM_TRACE
+#define USBD_ENUM_TRACE                                 0U
+#endif /* USBD_ENUM_TRACE */
+
+#ifndef USBD_USE_GOVERNOR
+#define USBD_USE_GOVERNOR                               0U
+#endif /* USBD_USE_GOVERNOR */
+
+#ifndef USBD_USE_IPC
+#define USBD_USE_IPC                                    0U
+#endif /* USBD_USE_IPC */
+
+#ifndef USBD_USE_CDC_BRIDGE
+#define USBD_USE_CDC_BRIDGE                             0U
+#endif /* USBD_USE_CDC_BRIDGE */
+
+#ifndef USBD_USE_CDC_LOG
+#define USBD_USE_CDC_LOG                                0U
+#endif /* USBD_USE_CDC_LOG */
+
+#ifndef USBD_USE_CDC_BENCH
+#define USBD_USE_CDC_BENCH                              0U
+#endif /* USBD_USE_CDC_BENCH */
+
+#ifndef USBD_USE_CDC_FRAME
+#define USBD_USE_CDC_FRAME                              0U
+#endif /* USBD_USE_CDC_FRAME */
+
+#ifndef USBD_DEFER_CLASS_INIT
+#define USBD_DEFER_CLASS_INIT                           0U
+#endif /* USBD_DEFER_CLASS_INIT */
+
 #ifndef USBD_SELF_POWERED
 #define USBD_SELF_POWERED                               1U
 #endif /*USBD_SELF_POWERED */
@@ -225,10 +282,10 @@ typedef struct _Device_cb
   uint8_t (*IsoINIncomplete)(struct _USBD_HandleTypeDef *pdev, uint8_t epnum);
   uint8_t (*IsoOUTIncomplete)(struct _USBD_HandleTypeDef *pdev, uint8_t epnum);
 
-  uint8_t  *(*GetHSConfigDescriptor)(uint16_t *length);
-  uint8_t  *(*GetFSConfigDescriptor)(uint16_t *length);
-  uint8_t  *(*GetOtherSpeedConfigDescriptor)(uint16_t *length);
-  uint8_t  *(*GetDeviceQualifierDescriptor)(uint16_t *length);
+  uint8_t  *(*GetHSConfigDescriptor)(struct _USBD_HandleTypeDef *pdev, uint16_t *length);
+  uint8_t  *(*GetFSConfigDescriptor)(struct _USBD_HandleTypeDef *pdev, uint16_t *length);
+  uint8_t  *(*GetOtherSpeedConfigDescriptor)(struct _USBD_HandleTypeDef *pdev, uint16_t *length);
+  uint8_t  *(*GetDeviceQualifierDescriptor)(struct _USBD_HandleTypeDef *pdev, uint16_t *length);
 #if (USBD_SUPPORT_USER_STRING_DESC == 1U)
   uint8_t  *(*GetUsrStrDescriptor)(struct _USBD_HandleTypeDef *pdev, uint8_t index,  uint16_t *length);
 #endif
@@ -270,6 +327,63 @@ typedef struct
 #endif
 } USBD_DescriptorsTypeDef;
 
+/* Endpoints and interfaces a class owns in the composite configuration,
+   the interfaces of a class are numbered consecutively from itf_nbr */
+typedef struct
+{
+  uint8_t  in_ep;
+  uint8_t  out_ep;
+  uint8_t  cmd_ep;
+  uint8_t  itf_nbr;
+  uint8_t  itf_num;
+  uint8_t  str_idx;
+} USBD_ClassMapTypeDef;
+
+/* Entry of the class registry of a device handle, one per class instance
+   mounted in the composite configuration. ep_in and ep_out are bit masks of
+   the endpoint numbers the instance owns, bit n of cfg_mask is set when the
+   instance is part of configuration n + 1 */
+typedef struct
+{
+  USBD_ClassTypeDef    *pClass;
+  void                 *pClassData;
+  void                 *pUserData;
+  USBD_ClassMapTypeDef map;
+  uint8_t              inst;
+  uint8_t              str_num;
+  uint8_t              cfg_mask;
+  uint16_t             ep_in;
+  uint16_t             ep_out;
+#if (USBD_DEFER_CLASS_INIT == 1U)
+  void                 (*DeferredInit)(struct _USBD_HandleTypeDef *pdev);
+#endif /* (USBD_DEFER_CLASS_INIT == 1U) */
+} USBD_ClassEntryTypeDef;
+
+/* USB Device buffer segment, used by scatter-gather transmit */
+typedef struct
+{
+  uint8_t  *pbuf;
+  uint32_t length;
+} USBD_SegmentTypeDef;
+
+/* USB Device transfer descriptor, queued per endpoint by usbd_xfer.c */
+typedef struct _USBD_XferTypeDef
+{
+  struct _USBD_XferTypeDef *next;
+  uint8_t                  *pbuf;
+  uint32_t                 length;
+  USBD_SegmentTypeDef      *pSeg;
+  uint8_t                  nseg;
+  uint32_t                 xfer_count;
+  uint8_t                  ep_addr;
+  uint8_t                  flags;
+  __IO uint8_t             state;
+  void                     (*Cplt)(struct _USBD_HandleTypeDef *pdev, struct _USBD_XferTypeDef *xfer);
+  void                     *pOwner;
+  uint8_t                  classId;
+  uint8_t                  status;    /* USBD_OK, or the LL status of a transfer that could not start */
+} USBD_XferTypeDef;
+
 /* USB Device handle structure */
 typedef struct
 {
@@ -279,6 +393,8 @@ typedef struct
   uint32_t maxpacket;
   uint16_t is_used;
   uint16_t bInterval;
+  USBD_XferTypeDef *xfer_head;
+  USBD_XferTypeDef *xfer_tail;
 } USBD_EndpointTypeDef;
 
 /* USB Device handle structure */
@@ -304,30 +420,23 @@ typedef struct _USBD_HandleTypeDef
   USBD_SetupReqTypedef    request;
   USBD_DescriptorsTypeDef *pDesc;
   USBD_ClassTypeDef       *pClass;
-  void                    *pUserData_CDC_ACM;
-  void                    *pClassData_CDC_RNDIS;
-  void                    *pUserData_CDC_RNDIS;
-  void                    *pClassData_CDC_ECM;
-  void                    *pUserData_CDC_ECM;
-  void                    *pClassData_HID_Mouse;
-  void                    *pClassData_HID_Keyboard;
-  void                    *pClassData_HID_Custom;
-  void                    *pUserData_HID_Custom;
-  void                    *pClassData_UAC_MIC;
-  void                    *pUserData_UAC_MIC;
-  void                    *pClassData_UAC_SPKR;
-  void                    *pUserData_UAC_SPKR;
-  void                    *pClassData_UVC;
-  void                    *pUserData_UVC;
-  void                    *pClassData_MSC;
-  void                    *pUserData_MSC;
-  void                    *pClassData_DFU;
-  void                    *pUserData_DFU;
-  void                    *pClassData_PRNTR;
-  void                    *pUserData_PRNTR;
+  USBD_ClassEntryTypeDef  tclass[USBD_MAX_CLASS_NUM];
+  uint8_t                 NumClasses;
+  uint8_t                 classId;
   void                    *pData;
   void                    *pBosDesc;
   void                    *pConfDesc;
+#if (USBD_LPM_ENABLED == 1U)
+  uint32_t                lpm_veto;
+  uint16_t                lpm_ep_busy;
+  uint8_t                 lpm_ack;
+#endif /* (USBD_LPM_ENABLED == 1U) */
+#if (USBD_USE_OS == 1U)
+  osEventFlagsId_t        os_event_in;
+  osEventFlagsId_t        os_event_out;
+  osMessageQueueId_t      os_work;
+  osThreadId_t            os_worker;
+#endif /* (USBD_USE_OS == 1U) */
 } USBD_HandleTypeDef;
 
 /**
@@ -353,6 +462,21 @@ __STATIC_INLINE uint16_t SWAPBYTE(uint8_t *addr)
   return _SwapVal;
 }
 
+/* Slot of a device handle in the per device class state tables, the FS and
+   HS devices only get a slot each when both run at the same time */
+#if (USBD_MAX_NUM_DEV > 1U)
+#define USBD_DEV_IDX(pdev)  ((pdev)->id)
+#else
+#define USBD_DEV_IDX(pdev)  0U
+#endif
+
+/* Registry entry the class callbacks run for, selected by pdev->classId */
+#define USBD_CLASS_ENTRY(pdev)  ((pdev)->tclass[(pdev)->classId])
+#define USBD_CLASS_DATA(pdev)   (USBD_CLASS_ENTRY(pdev).pClassData)
+#define USBD_USER_DATA(pdev)    (USBD_CLASS_ENTRY(pdev).pUserData)
+#define USBD_CLASS_MAP(pdev)    (USBD_CLASS_ENTRY(pdev).map)
+#define USBD_CLASS_INST(pdev)   (USBD_CLASS_ENTRY(pdev).inst)
+
 #ifndef LOBYTE
 #define LOBYTE(x)  ((uint8_t)((x) & 0x00FFU))
 #endif
@@ -0,0 +1,126 @@
+/**
+  ******************************************************************************
+  * @file    usbd_enum.h
+  * @brief   Header file for the usbd_enum.c file
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_ENUM_H
+#define __USBD_ENUM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include  "usbd_def.h"
+
+/** @addtogroup STM32_USB_DEVICE_LIBRARY
+  * @{
+  */
+
+/** @defgroup USBD_ENUM
+  * @brief header file for the usbd_enum.c file
+  * @{
+  */
+
+#if (USBD_ENUM_TRACE == 1U)
+
+/** @defgroup USBD_ENUM_Exported_Defines
+  * @{
+  */
+
+/* Records kept per device, later events are dropped once the log is full */
+#ifndef USBD_ENUM_TRACE_DEPTH
+#define USBD_ENUM_TRACE_DEPTH                           32U
+#endif /* USBD_ENUM_TRACE_DEPTH */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_ENUM_Exported_Types
+  * @{
+  */
+
+typedef enum
+{
+  USBD_ENUM_EVT_START = 0U,         /* USBD_Start, pull-up enabled */
+  USBD_ENUM_EVT_RESET,              /* bus reset */
+  USBD_ENUM_EVT_SET_ADDRESS,        /* wValue: address */
+  USBD_ENUM_EVT_GET_DESCRIPTOR,     /* wValue: descriptor type and index */
+  USBD_ENUM_EVT_SET_CONFIG,         /* wValue: configuration */
+  USBD_ENUM_EVT_CONFIGURED,         /* class Init done, status stage armed */
+  USBD_ENUM_EVT_CLASS_REQ,          /* first class request, wValue: wIndex */
+} USBD_EnumEventTypeDef;
+
+typedef struct
+{
+  uint32_t ts;                      /* USBD_LL_GetTimestamp at the event */
+  uint16_t wValue;
+  uint8_t  event;
+} USBD_EnumRecordTypeDef;
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_ENUM_Exported_Macros
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_ENUM_Exported_Variables
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_ENUM_Exported_FunctionsPrototype
+  * @{
+  */
+
+void USBD_Enum_Clear(USBD_HandleTypeDef *pdev);
+void USBD_Enum_Record(USBD_HandleTypeDef *pdev, uint8_t event, uint16_t wValue);
+void USBD_Enum_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
+
+uint8_t USBD_Enum_GetTrace(USBD_HandleTypeDef *pdev, const USBD_EnumRecordTypeDef **prec);
+uint32_t USBD_Enum_GetElapsedUs(USBD_HandleTypeDef *pdev, uint8_t idx);
+
+/**
+  * @}
+  */
+
+#endif /* (USBD_ENUM_TRACE == 1U) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_ENUM_H */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+/********************************** END OF FILE *******************************/
@@ -0,0 +1,113 @@
+/**
+  ******************************************************************************
+  * @file    usbd_fifo.h
+  * @brief   Header file for the usbd_fifo.c file
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_FIFO_H
+#define __USBD_FIFO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include  "usbd_def.h"
+
+/** @addtogroup STM32_USB_DEVICE_LIBRARY
+  * @{
+  */
+
+/** @defgroup USBD_FIFO
+  * @brief header file for the usbd_fifo.c file
+  * @{
+  */
+
+/** @defgroup USBD_FIFO_Exported_Defines
+  * @{
+  */
+
+/* Transmit FIFOs of the largest core, one per IN endpoint */
+#define USBD_FIFO_MAX_TX                                16U
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_FIFO_Exported_Types
+  * @{
+  */
+
+/* FIFO RAM of a core with a transmit FIFO per IN endpoint: the receive
+   FIFO at 0, then the transmit FIFOs in increasing endpoint number. Sizes
+   and offsets are in bytes, multiples of 4. */
+typedef struct
+{
+  uint16_t ram_size;                      /* FIFO RAM of the core */
+  uint16_t rx_size;                       /* receive FIFO shared by the OUT endpoints */
+  uint16_t tx_size[USBD_FIFO_MAX_TX];     /* 0 for an IN endpoint out of the configuration */
+  uint16_t tx_offset[USBD_FIFO_MAX_TX];
+  uint16_t data;                          /* bulk and isochronous IN endpoints, one bit each */
+} USBD_FiFo_LayoutTypeDef;
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_FIFO_Exported_Macros
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_FIFO_Exported_Variables
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_FIFO_Exported_FunctionsPrototype
+  * @{
+  */
+
+void USBD_FiFo_Init(USBD_FiFo_LayoutTypeDef *playout, uint16_t ram_size, uint16_t rx_size);
+void USBD_FiFo_Add(USBD_FiFo_LayoutTypeDef *playout, uint8_t ep_addr, uint16_t size, uint8_t data);
+USBD_StatusTypeDef USBD_FiFo_Plan(USBD_FiFo_LayoutTypeDef *playout);
+USBD_StatusTypeDef USBD_FiFo_Check(const USBD_FiFo_LayoutTypeDef *playout);
+
+/**
+  * @}
+  */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_FIFO_H */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/********************************** END OF FILE *******************************/
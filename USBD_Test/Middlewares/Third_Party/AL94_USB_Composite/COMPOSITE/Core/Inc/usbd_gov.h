@@ -0,0 +1,148 @@
+/**
+  ******************************************************************************
+  * @file    usbd_gov.h
+  * @brief   Header file for the usbd_gov.c file
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_GOV_H
+#define __USBD_GOV_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include  "usbd_def.h"
+
+/** @addtogroup STM32_USB_DEVICE_LIBRARY
+  * @{
+  */
+
+/** @defgroup USBD_GOV
+  * @brief header file for the usbd_gov.c file
+  * @{
+  */
+
+#if (USBD_USE_GOVERNOR == 1U)
+
+/** @defgroup USBD_GOV_Exported_Defines
+  * @{
+  */
+
+/* Slowest performance level, each level halves the core clock. The bus
+   clock must stay above 30 MHz for OTG_HS and 14.2 MHz for a FS core: the
+   low level driver refuses a deeper level and the governor stays at the
+   slowest one it accepts */
+#ifndef USBD_GOV_MAX_LEVEL
+#define USBD_GOV_MAX_LEVEL                              2U
+#endif /* USBD_GOV_MAX_LEVEL */
+
+/* Bytes moved in one (micro)frame that bring the clock back to full speed */
+#ifndef USBD_GOV_UP_BYTES
+#define USBD_GOV_UP_BYTES                               512U
+#endif /* USBD_GOV_UP_BYTES */
+
+/* Mean bytes per (micro)frame below which the link is counted as idle */
+#ifndef USBD_GOV_IDLE_BYTES
+#define USBD_GOV_IDLE_BYTES                             64U
+#endif /* USBD_GOV_IDLE_BYTES */
+
+/* Idle (micro)frames before the clock is lowered by one level */
+#ifndef USBD_GOV_IDLE_FRAMES
+#define USBD_GOV_IDLE_FRAMES                            1000U
+#endif /* USBD_GOV_IDLE_FRAMES */
+
+/* 1 once every UART of the CDC bridge runs from a kernel clock other than
+   PCLK, its baud rate then survives a level change */
+#ifndef USBD_GOV_UART_OWN_CLOCK
+#define USBD_GOV_UART_OWN_CLOCK                         0U
+#endif /* USBD_GOV_UART_OWN_CLOCK */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_GOV_Exported_Types
+  * @{
+  */
+
+/* Load seen by the stack during one (micro)frame */
+typedef struct
+{
+  uint32_t bytes;      /* data bytes moved on the non-control endpoints */
+  uint8_t  backlog;    /* IN endpoints with more than one transfer queued */
+  uint8_t  iso;        /* isochronous endpoints open, an alternate setting streams */
+} USBD_GovSampleTypeDef;
+
+/* Policy state, one per device */
+typedef struct
+{
+  uint32_t avg;        /* bytes per (micro)frame, times 8 */
+  uint16_t idle;       /* idle (micro)frames at the current level */
+  uint8_t  level;      /* 0 full speed, USBD_GOV_MAX_LEVEL slowest */
+} USBD_GovStateTypeDef;
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_GOV_Exported_Macros
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_GOV_Exported_Variables
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_GOV_Exported_FunctionsPrototype
+  * @{
+  */
+
+uint8_t USBD_Gov_Step(USBD_GovStateTypeDef *pgov, const USBD_GovSampleTypeDef *psample);
+
+void USBD_Gov_Traffic(USBD_HandleTypeDef *pdev, uint32_t bytes);
+void USBD_Gov_SetIso(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t open);
+void USBD_Gov_SOF(USBD_HandleTypeDef *pdev);
+uint8_t USBD_Gov_GetLevel(void);
+
+/**
+  * @}
+  */
+
+#endif /* (USBD_USE_GOVERNOR == 1U) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_GOV_H */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+/********************************** END OF FILE *******************************/
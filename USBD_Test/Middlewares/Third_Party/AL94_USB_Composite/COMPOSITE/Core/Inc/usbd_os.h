@@ -0,0 +1,127 @@
+/**
+  ******************************************************************************
+  * @file    usbd_os.h
+  * @brief   Header file for the usbd_os.c file
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_OS_H
+#define __USBD_OS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include  "usbd_def.h"
+
+/** @addtogroup STM32_USB_DEVICE_LIBRARY
+  * @{
+  */
+
+/** @defgroup USBD_OS
+  * @brief header file for the usbd_os.c file
+  * @{
+  */
+
+#if (USBD_USE_OS == 1U)
+
+/** @defgroup USBD_OS_Exported_Defines
+  * @{
+  */
+
+/* Jobs the worker task of a device instance can have pending */
+#ifndef USBD_OS_WORK_QUEUE_SIZE
+#define USBD_OS_WORK_QUEUE_SIZE                         4U
+#endif /* USBD_OS_WORK_QUEUE_SIZE */
+
+/* Stack of the worker task, in bytes; it runs the storage driver */
+#ifndef USBD_OS_WORKER_STACK_SIZE
+#define USBD_OS_WORKER_STACK_SIZE                       1024U
+#endif /* USBD_OS_WORKER_STACK_SIZE */
+
+#ifndef USBD_OS_WORKER_PRIORITY
+#define USBD_OS_WORKER_PRIORITY                         osPriorityAboveNormal
+#endif /* USBD_OS_WORKER_PRIORITY */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_OS_Exported_Types
+  * @{
+  */
+
+/* Wake-up condition of a blocking call, returns non zero once satisfied */
+typedef uint8_t (*USBD_OS_CondTypeDef)(void *arg);
+
+/* Job of the worker task. It runs with interrupts enabled and pdev->classId
+   belonging to whatever interrupt comes, a job touching the class state sets
+   classId itself inside USBD_ENTER_CRITICAL */
+typedef void (*USBD_OS_WorkTypeDef)(USBD_HandleTypeDef *pdev, void *arg);
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_OS_Exported_Macros
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_OS_Exported_Variables
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_OS_Exported_FunctionsPrototype
+  * @{
+  */
+
+USBD_StatusTypeDef USBD_OS_Init(USBD_HandleTypeDef *pdev);
+void USBD_OS_Signal(USBD_HandleTypeDef *pdev, uint8_t ep_addr);
+void USBD_OS_Abort(USBD_HandleTypeDef *pdev);
+USBD_StatusTypeDef USBD_OS_Wait(USBD_HandleTypeDef *pdev, uint8_t ep_addr,
+                                USBD_OS_CondTypeDef Cond, void *arg,
+                                uint32_t *timeout);
+USBD_StatusTypeDef USBD_OS_Post(USBD_HandleTypeDef *pdev, USBD_OS_WorkTypeDef Work,
+                                void *arg);
+
+/**
+  * @}
+  */
+
+#endif /* (USBD_USE_OS == 1U) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_OS_H */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+/********************************** END OF FILE *******************************/
@@ -61,6 +61,10 @@
   * @{
   */
 
+#if (USBD_LPM_ENABLED == 1U)
+static void USBD_LPM_Update(USBD_HandleTypeDef *pdev);
+#endif /* (USBD_LPM_ENABLED == 1U) */
+
 /**
   * @}
   */
@@ -114,6 +118,16 @@ USBD_StatusTypeDef USBD_Init(USBD_HandleTypeDef *pdev,
   pdev->dev_state = USBD_STATE_DEFAULT;
   pdev->id = id;
 
+#if (USBD_USE_OS == 1U)
+  /* Create the objects the blocking class APIs sleep on */
+  ret = USBD_OS_Init(pdev);
+
+  if (ret != USBD_OK)
+  {
+    return ret;
+  }
+#endif /* (USBD_USE_OS == 1U) */
+
   /* Initialize low level driver */
   ret = USBD_LL_Init(pdev);
 
@@ -143,6 +157,10 @@ USBD_StatusTypeDef USBD_DeInit(USBD_HandleTypeDef *pdev)
     pdev->pClass = NULL;
   }
 
+#if (USBD_USE_OS == 1U)
+  USBD_OS_Abort(pdev);
+#endif /* (USBD_USE_OS == 1U) */
+
   /* Free Device descriptors resources */
   pdev->pDesc = NULL;
   pdev->pConfDesc = NULL;
@@ -180,17 +198,191 @@ USBD_StatusTypeDef USBD_RegisterClass(USBD_HandleTypeDef *pdev, USBD_ClassTypeDe
   {
 	  if (pdev->pClass->GetHSConfigDescriptor != NULL)
 	  {
-		  pdev->pConfDesc = (void *)pdev->pClass->GetHSConfigDescriptor(&len);
+		  pdev->pConfDesc = (void *)pdev->pClass->GetHSConfigDescriptor(pdev, &len);
 	  }
   }
   else if (pdev->pClass->GetFSConfigDescriptor != NULL)
   {
-	  pdev->pConfDesc = (void *)pdev->pClass->GetFSConfigDescriptor(&len);
+	  pdev->pConfDesc = (void *)pdev->pClass->GetFSConfigDescriptor(pdev, &len);
   }
 
   return USBD_OK;
 }
 
+/**
+  * @brief  USBD_SelectClass
+  *         Make an instance of a registered class the current registry
+  *         entry, the class API called next works on that instance
+  * @param  pdev: device handle
+  * @param  pclass: Class handle
+  * @param  inst: instance of the class, in registration order
+  * @retval USBD Status
+  */
+USBD_StatusTypeDef USBD_SelectClass(USBD_HandleTypeDef *pdev,
+                                    USBD_ClassTypeDef *pclass, uint8_t inst)
+{
+  for (uint8_t idx = 0U; idx < pdev->NumClasses; idx++)
+  {
+    if ((pdev->tclass[idx].pClass == pclass) && (pdev->tclass[idx].inst == inst))
+    {
+      pdev->classId = idx;
+      return USBD_OK;
+    }
+  }
+
+  return USBD_FAIL;
+}
+
+/**
+  * @brief  USBD_CoreFindClass
+  *         Select the registry entry a class API called by the application
+  *         works on: the current entry when it belongs to the class,
+  *         else the first instance of the class
+  * @param  pdev: device handle
+  * @param  pclass: Class handle
+  * @retval USBD Status
+  */
+USBD_StatusTypeDef USBD_CoreFindClass(USBD_HandleTypeDef *pdev, USBD_ClassTypeDef *pclass)
+{
+  if ((pdev->classId < pdev->NumClasses) &&
+      (pdev->tclass[pdev->classId].pClass == pclass))
+  {
+    return USBD_OK;
+  }
+
+  return USBD_SelectClass(pdev, pclass, 0U);
+}
+
+/**
+  * @brief  USBD_CoreDeferInit
+  *         Hand over the slow part of a class Init, such as a storage or
+  *         codec start up, so that it runs when the host first addresses
+  *         the class instead of delaying the SET_CONFIGURATION status stage
+  * @param  pdev: device handle
+  * @param  DeferredInit: work to run for the selected class
+  * @retval USBD Status
+  */
+USBD_StatusTypeDef USBD_CoreDeferInit(USBD_HandleTypeDef *pdev,
+                                      void (*DeferredInit)(USBD_HandleTypeDef *pdev))
+{
+#if (USBD_DEFER_CLASS_INIT == 1U)
+  if (pdev->classId >= pdev->NumClasses)
+  {
+    return USBD_FAIL;
+  }
+
+  pdev->tclass[pdev->classId].DeferredInit = DeferredInit;
+#else
+  DeferredInit(pdev);
+#endif /* (USBD_DEFER_CLASS_INIT == 1U) */
+
+  return USBD_OK;
+}
+
+#if (USBD_DEFER_CLASS_INIT == 1U)
+/**
+  * @brief  USBD_CoreRunDeferredInit
+  *         Run the pending deferred Init of the selected class, called
+  *         before the class handles its first request or transfer
+  * @param  pdev: device handle
+  * @retval None
+  */
+void USBD_CoreRunDeferredInit(USBD_HandleTypeDef *pdev)
+{
+  USBD_ClassEntryTypeDef *pentry = &pdev->tclass[pdev->classId];
+  void (*DeferredInit)(USBD_HandleTypeDef *pdev) = pentry->DeferredInit;
+
+  if (DeferredInit != NULL)
+  {
+    pentry->DeferredInit = NULL;
+    DeferredInit(pdev);
+  }
+}
+#endif /* (USBD_DEFER_CLASS_INIT == 1U) */
+
+#if (USBD_LPM_ENABLED == 1U)
+/**
+  * @brief  USBD_LPM_Veto
+  *         Let the selected class refuse LPM L1 entry, for instance while it
+  *         has data to send; the device answers L1 requests with NYET as long
+  *         as one class holds its veto
+  * @param  pdev: device handle
+  * @param  veto: 1 to hold off L1, 0 to allow it again
+  * @retval USBD Status
+  */
+USBD_StatusTypeDef USBD_LPM_Veto(USBD_HandleTypeDef *pdev, uint8_t veto)
+{
+  uint32_t primask;
+
+  USBD_ENTER_CRITICAL(primask);
+
+  if (veto != 0U)
+  {
+    pdev->lpm_veto |= (1UL << pdev->classId);
+  }
+  else
+  {
+    pdev->lpm_veto &= ~(1UL << pdev->classId);
+  }
+
+  USBD_LPM_Update(pdev);
+
+  USBD_EXIT_CRITICAL(primask);
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_LPM_SetEPBusy
+  *         Track IN endpoints with queued transfers, they veto L1 entry
+  * @param  pdev: device handle
+  * @param  ep_addr: endpoint address
+  * @param  busy: 1 when the endpoint queue holds a transfer
+  * @retval None
+  */
+void USBD_LPM_SetEPBusy(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t busy)
+{
+  uint32_t primask;
+
+  if ((ep_addr & 0x80U) != 0x80U)
+  {
+    return;
+  }
+
+  USBD_ENTER_CRITICAL(primask);
+
+  if (busy != 0U)
+  {
+    pdev->lpm_ep_busy |= (uint16_t)(1U << (ep_addr & 0xFU));
+  }
+  else
+  {
+    pdev->lpm_ep_busy &= (uint16_t)~(1U << (ep_addr & 0xFU));
+  }
+
+  USBD_LPM_Update(pdev);
+
+  USBD_EXIT_CRITICAL(primask);
+}
+
+/**
+  * @brief  USBD_LPM_Update
+  *         Program the L1 handshake once the vetoes changed
+  * @param  pdev: device handle
+  * @retval None
+  */
+static void USBD_LPM_Update(USBD_HandleTypeDef *pdev)
+{
+  uint8_t ack = ((pdev->lpm_veto == 0U) && (pdev->lpm_ep_busy == 0U)) ? 1U : 0U;
+
+  if (ack != pdev->lpm_ack)
+  {
+    pdev->lpm_ack = ack;
+    (void)USBD_LL_SetLPMAck(pdev, ack);
+  }
+}
+#endif /* (USBD_LPM_ENABLED == 1U) */
+
 /**
   * @brief  USBD_Start
   *         Start the USB Device Core.
@@ -199,6 +391,11 @@ USBD_StatusTypeDef USBD_RegisterClass(USBD_HandleTypeDef *pdev, USBD_ClassTypeDe
   */
 USBD_StatusTypeDef USBD_Start(USBD_HandleTypeDef *pdev)
 {
+#if (USBD_ENUM_TRACE == 1U)
+  USBD_Enum_Clear(pdev);
+  USBD_Enum_Record(pdev, (uint8_t)USBD_ENUM_EVT_START, 0U);
+#endif /* (USBD_ENUM_TRACE == 1U) */
+
   /* Start the low level driver  */
   return USBD_LL_Start(pdev);
 }
@@ -220,6 +417,10 @@ USBD_StatusTypeDef USBD_Stop(USBD_HandleTypeDef *pdev)
     (void)pdev->pClass->DeInit(pdev, (uint8_t)pdev->dev_config);
   }
 
+#if (USBD_USE_OS == 1U)
+  USBD_OS_Abort(pdev);
+#endif /* (USBD_USE_OS == 1U) */
+
   return USBD_OK;
 }
 
@@ -286,9 +487,16 @@ USBD_StatusTypeDef USBD_ClrClassConfig(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
 USBD_StatusTypeDef USBD_LL_SetupStage(USBD_HandleTypeDef *pdev, uint8_t *psetup)
 {
   USBD_StatusTypeDef ret;
+#if (USBD_ENUM_TRACE == 1U)
+  uint8_t dev_state = pdev->dev_state;
+#endif /* (USBD_ENUM_TRACE == 1U) */
 
   USBD_ParseSetupRequest(&pdev->request, psetup);
 
+#if (USBD_ENUM_TRACE == 1U)
+  USBD_Enum_Setup(pdev, &pdev->request);
+#endif /* (USBD_ENUM_TRACE == 1U) */
+
   pdev->ep0_state = USBD_EP0_SETUP;
 
   pdev->ep0_data_len = pdev->request.wLength;
@@ -312,6 +520,13 @@ USBD_StatusTypeDef USBD_LL_SetupStage(USBD_HandleTypeDef *pdev, uint8_t *psetup)
       break;
   }
 
+#if (USBD_ENUM_TRACE == 1U)
+  if ((dev_state != USBD_STATE_CONFIGURED) && (pdev->dev_state == USBD_STATE_CONFIGURED))
+  {
+    USBD_Enum_Record(pdev, (uint8_t)USBD_ENUM_EVT_CONFIGURED, (uint16_t)pdev->dev_config);
+  }
+#endif /* (USBD_ENUM_TRACE == 1U) */
+
   return ret;
 }
 
@@ -372,15 +587,26 @@ USBD_StatusTypeDef USBD_LL_DataOutStage(USBD_HandleTypeDef *pdev,
   {
     if (pdev->dev_state == USBD_STATE_CONFIGURED)
     {
-      if (pdev->pClass->DataOut != NULL)
-      {
-        ret = (USBD_StatusTypeDef)pdev->pClass->DataOut(pdev, epnum);
+      ret = USBD_OK;
 
-        if (ret != USBD_OK)
+      /* Endpoints served by a transfer queue complete through their owner */
+      if (USBD_Xfer_DataOutStage(pdev, epnum) != USBD_OK)
+      {
+        if (pdev->pClass->DataOut != NULL)
         {
-          return ret;
+          ret = (USBD_StatusTypeDef)pdev->pClass->DataOut(pdev, epnum);
         }
       }
+
+#if (USBD_USE_OS == 1U)
+      /* Wake the tasks blocked on this endpoint */
+      USBD_OS_Signal(pdev, epnum);
+#endif /* (USBD_USE_OS == 1U) */
+
+      if (ret != USBD_OK)
+      {
+        return ret;
+      }
     }
   }
 
@@ -463,15 +689,26 @@ USBD_StatusTypeDef USBD_LL_DataInStage(USBD_HandleTypeDef *pdev,
   {
     if (pdev->dev_state == USBD_STATE_CONFIGURED)
     {
-      if (pdev->pClass->DataIn != NULL)
-      {
-        ret = (USBD_StatusTypeDef)pdev->pClass->DataIn(pdev, epnum);
+      ret = USBD_OK;
 
-        if (ret != USBD_OK)
+      /* Endpoints served by a transfer queue complete through their owner */
+      if (USBD_Xfer_DataInStage(pdev, epnum) != USBD_OK)
+      {
+        if (pdev->pClass->DataIn != NULL)
         {
-          return ret;
+          ret = (USBD_StatusTypeDef)pdev->pClass->DataIn(pdev, epnum);
         }
       }
+
+#if (USBD_USE_OS == 1U)
+      /* Wake the tasks blocked on this endpoint */
+      USBD_OS_Signal(pdev, (uint8_t)(epnum | 0x80U));
+#endif /* (USBD_USE_OS == 1U) */
+
+      if (ret != USBD_OK)
+      {
+        return ret;
+      }
     }
   }
 
@@ -487,12 +724,34 @@ USBD_StatusTypeDef USBD_LL_DataInStage(USBD_HandleTypeDef *pdev,
 
 USBD_StatusTypeDef USBD_LL_Reset(USBD_HandleTypeDef *pdev)
 {
+#if (USBD_ENUM_TRACE == 1U)
+  /* A reset of a configured device starts a new enumeration */
+  if (pdev->dev_state == USBD_STATE_CONFIGURED)
+  {
+    USBD_Enum_Clear(pdev);
+  }
+  USBD_Enum_Record(pdev, (uint8_t)USBD_ENUM_EVT_RESET, 0U);
+#endif /* (USBD_ENUM_TRACE == 1U) */
+
   /* Upon Reset call user call back */
   pdev->dev_state = USBD_STATE_DEFAULT;
   pdev->ep0_state = USBD_EP0_IDLE;
   pdev->dev_config = 0U;
   pdev->dev_remote_wakeup = 0U;
 
+#if (USBD_LPM_ENABLED == 1U)
+  /* Classes and queues are reset below, accept L1 again */
+  pdev->lpm_veto = 0U;
+  pdev->lpm_ep_busy = 0U;
+  pdev->lpm_ack = 1U;
+  (void)USBD_LL_SetLPMAck(pdev, 1U);
+#endif /* (USBD_LPM_ENABLED == 1U) */
+
+#if (USBD_USE_TIMEBASE == 1U)
+  /* The speed may change, lock again on the next SOFs */
+  USBD_Time_Reset(pdev);
+#endif /* (USBD_USE_TIMEBASE == 1U) */
+
   if (pdev->pClass == NULL)
   {
     return USBD_FAIL;
@@ -503,6 +762,10 @@ USBD_StatusTypeDef USBD_LL_Reset(USBD_HandleTypeDef *pdev)
 	  (void)pdev->pClass->DeInit(pdev, (uint8_t)pdev->dev_config);
 	}
 
+#if (USBD_USE_OS == 1U)
+  USBD_OS_Abort(pdev);
+#endif /* (USBD_USE_OS == 1U) */
+
   /* Open EP0 OUT */
   (void)USBD_LL_OpenEP(pdev, 0x00U, USBD_EP_TYPE_CTRL, USB_MAX_EP0_SIZE);
   pdev->ep_out[0x00U & 0xFU].is_used = 1U;
@@ -573,6 +836,15 @@ USBD_StatusTypeDef USBD_LL_Resume(USBD_HandleTypeDef *pdev)
 
 USBD_StatusTypeDef USBD_LL_SOF(USBD_HandleTypeDef *pdev)
 {
+#if (USBD_USE_TIMEBASE == 1U)
+  /* Latch the local time first, class SOF handlers may already use it */
+  USBD_Time_SOF(pdev, USBD_LL_GetTimestamp());
+#endif /* (USBD_USE_TIMEBASE == 1U) */
+
+#if (USBD_USE_GOVERNOR == 1U)
+  USBD_Gov_SOF(pdev);
+#endif /* (USBD_USE_GOVERNOR == 1U) */
+
   if (pdev->pClass == NULL)
   {
     return USBD_FAIL;
@@ -669,6 +941,10 @@ USBD_StatusTypeDef USBD_LL_DevDisconnected(USBD_HandleTypeDef *pdev)
     (void)pdev->pClass->DeInit(pdev, (uint8_t)pdev->dev_config);
   }
 
+#if (USBD_USE_OS == 1U)
+  USBD_OS_Abort(pdev);
+#endif /* (USBD_USE_OS == 1U) */
+
   return USBD_OK;
 }
 /**
@@ -0,0 +1,247 @@
+/**
+  ******************************************************************************
+  * @file    usbd_enum.c
+  * @brief   This file provides the enumeration timing trace.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_enum.h"
+#include "usbd_core.h"
+
+/** @addtogroup STM32_USBD_DEVICE_LIBRARY
+  * @{
+  */
+
+
+/** @defgroup USBD_ENUM
+  * @brief usbd enumeration trace module
+  *        Timestamps the steps a host goes through from USBD_Start to the
+  *        first class request: bus resets, SET_ADDRESS, each GET_DESCRIPTOR,
+  *        SET_CONFIGURATION, the end of the class Init and the first class
+  *        request. The log is restarted by USBD_Start and by a bus reset
+  *        of a configured device, so it always holds the last enumeration.
+  *        Timestamps come from USBD_LL_GetTimestamp; the whole enumeration
+  *        must fit in one wrap of that counter.
+  * @{
+  */
+
+#if (USBD_ENUM_TRACE == 1U)
+
+/** @defgroup USBD_ENUM_Private_TypesDefinitions
+  * @{
+  */
+
+typedef struct
+{
+  USBD_EnumRecordTypeDef rec[USBD_ENUM_TRACE_DEPTH];
+  uint8_t count;
+  uint8_t class_req;   /* first class request already logged */
+} USBD_EnumTraceTypeDef;
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_ENUM_Private_Defines
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_ENUM_Private_Macros
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_ENUM_Private_FunctionPrototypes
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_ENUM_Private_Variables
+  * @{
+  */
+
+static USBD_EnumTraceTypeDef USBD_EnumTrace[USBD_MAX_NUM_DEV];
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_ENUM_Private_Functions
+  * @{
+  */
+
+/**
+  * @brief  USBD_Enum_Clear
+  *         Restart the enumeration log
+  * @param  pdev: device instance
+  * @retval None
+  */
+void USBD_Enum_Clear(USBD_HandleTypeDef *pdev)
+{
+  USBD_EnumTraceTypeDef *ptrace = &USBD_EnumTrace[USBD_DEV_IDX(pdev)];
+  uint32_t primask;
+
+  USBD_ENTER_CRITICAL(primask);
+
+  ptrace->count = 0U;
+  ptrace->class_req = 0U;
+
+  USBD_EXIT_CRITICAL(primask);
+}
+
+/**
+  * @brief  USBD_Enum_Record
+  *         Append a timestamped event to the enumeration log
+  * @param  pdev: device instance
+  * @param  event: USBD_EnumEventTypeDef
+  * @param  wValue: event argument
+  * @retval None
+  */
+void USBD_Enum_Record(USBD_HandleTypeDef *pdev, uint8_t event, uint16_t wValue)
+{
+  USBD_EnumTraceTypeDef *ptrace = &USBD_EnumTrace[USBD_DEV_IDX(pdev)];
+  uint32_t ts = USBD_LL_GetTimestamp();
+  uint32_t primask;
+
+  USBD_ENTER_CRITICAL(primask);
+
+  if (ptrace->count < USBD_ENUM_TRACE_DEPTH)
+  {
+    ptrace->rec[ptrace->count].ts = ts;
+    ptrace->rec[ptrace->count].wValue = wValue;
+    ptrace->rec[ptrace->count].event = event;
+    ptrace->count++;
+  }
+
+  USBD_EXIT_CRITICAL(primask);
+}
+
+/**
+  * @brief  USBD_Enum_Setup
+  *         Log the setup requests that make up the enumeration
+  * @param  pdev: device instance
+  * @param  req: setup request
+  * @retval None
+  */
+void USBD_Enum_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
+{
+  USBD_EnumTraceTypeDef *ptrace = &USBD_EnumTrace[USBD_DEV_IDX(pdev)];
+
+  switch (req->bmRequest & USB_REQ_TYPE_MASK)
+  {
+    case USB_REQ_TYPE_STANDARD:
+      if ((req->bmRequest & USB_REQ_RECIPIENT_MASK) != USB_REQ_RECIPIENT_DEVICE)
+      {
+        break;
+      }
+
+      switch (req->bRequest)
+      {
+        case USB_REQ_GET_DESCRIPTOR:
+          USBD_Enum_Record(pdev, (uint8_t)USBD_ENUM_EVT_GET_DESCRIPTOR, req->wValue);
+          break;
+
+        case USB_REQ_SET_ADDRESS:
+          USBD_Enum_Record(pdev, (uint8_t)USBD_ENUM_EVT_SET_ADDRESS, req->wValue);
+          break;
+
+        case USB_REQ_SET_CONFIGURATION:
+          USBD_Enum_Record(pdev, (uint8_t)USBD_ENUM_EVT_SET_CONFIG, req->wValue);
+          break;
+
+        default:
+          break;
+      }
+      break;
+
+    case USB_REQ_TYPE_CLASS:
+      if (ptrace->class_req == 0U)
+      {
+        ptrace->class_req = 1U;
+        USBD_Enum_Record(pdev, (uint8_t)USBD_ENUM_EVT_CLASS_REQ, req->wIndex);
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+/**
+  * @brief  USBD_Enum_GetTrace
+  *         Return the enumeration log of a device
+  * @param  pdev: device instance
+  * @param  prec: set to the first record
+  * @retval number of records
+  */
+uint8_t USBD_Enum_GetTrace(USBD_HandleTypeDef *pdev, const USBD_EnumRecordTypeDef **prec)
+{
+  USBD_EnumTraceTypeDef *ptrace = &USBD_EnumTrace[USBD_DEV_IDX(pdev)];
+
+  *prec = ptrace->rec;
+
+  return ptrace->count;
+}
+
+/**
+  * @brief  USBD_Enum_GetElapsedUs
+  *         Time from the first record of the log to a record
+  * @param  pdev: device instance
+  * @param  idx: record index
+  * @retval elapsed time in microseconds, 0 when idx is not logged
+  */
+uint32_t USBD_Enum_GetElapsedUs(USBD_HandleTypeDef *pdev, uint8_t idx)
+{
+  USBD_EnumTraceTypeDef *ptrace = &USBD_EnumTrace[USBD_DEV_IDX(pdev)];
+  uint32_t ticks;
+
+  if (idx >= ptrace->count)
+  {
+    return 0U;
+  }
+
+  ticks = ptrace->rec[idx].ts - ptrace->rec[0].ts;
+
+  return (uint32_t)(((uint64_t)ticks * 1000000U) / USBD_LL_GetTimestampFreq());
+}
+
+/**
+  * @}
+  */
+
+#endif /* (USBD_ENUM_TRACE == 1U) */
+
+/**
+  * @}
+  */
+
+
+/**
+  * @}
+  */
+
+/********************************** END OF FILE *******************************/
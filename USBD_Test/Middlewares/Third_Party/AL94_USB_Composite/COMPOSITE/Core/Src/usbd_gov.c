@@ -0,0 +1,293 @@
+/**
+  ******************************************************************************
+  * @file    usbd_gov.c
+  * @brief   This file provides the traffic driven clock governor.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_gov.h"
+#include "usbd_core.h"
+
+/** @addtogroup STM32_USBD_DEVICE_LIBRARY
+  * @{
+  */
+
+
+/** @defgroup USBD_GOV
+  * @brief usbd clock governor module
+  *        Lowers the core clock one level at a time while the link stays
+  *        idle and brings it back to full speed as soon as a (micro)frame
+  *        moves USBD_GOV_UP_BYTES or an IN queue backs up. The load is
+  *        sampled at each SOF; the level never changes while an
+  *        isochronous endpoint is open and the clock goes back to full
+  *        speed before one opens. The level is applied through
+  *        USBD_LL_SetPerfLevel; with several devices the fastest level any
+  *        of them wants is applied. USBD_Gov_Step holds the whole policy
+  *        and touches nothing but its arguments, so it can be run on a host
+  *        against recorded traffic.
+  * @{
+  */
+
+#if (USBD_USE_GOVERNOR == 1U)
+
+/** @defgroup USBD_GOV_Private_TypesDefinitions
+  * @{
+  */
+
+typedef struct
+{
+  USBD_GovStateTypeDef state;
+  uint32_t bytes;      /* moved since the last SOF */
+  uint32_t iso_mask;   /* open isochronous endpoints, IN n on bit n, OUT n on bit 16 + n */
+} USBD_GovTypeDef;
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_GOV_Private_Defines
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_GOV_Private_Macros
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_GOV_Private_FunctionPrototypes
+  * @{
+  */
+
+static void USBD_Gov_Apply(void);
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_GOV_Private_Variables
+  * @{
+  */
+
+static USBD_GovTypeDef USBD_Gov[USBD_MAX_NUM_DEV];
+static uint8_t USBD_Gov_Level;    /* level applied to the clock */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_GOV_Private_Functions
+  * @{
+  */
+
+/**
+  * @brief  USBD_Gov_Step
+  *         Run the policy on the load of one (micro)frame
+  * @param  pgov: policy state
+  * @param  psample: load of the (micro)frame
+  * @retval performance level wanted
+  */
+uint8_t USBD_Gov_Step(USBD_GovStateTypeDef *pgov, const USBD_GovSampleTypeDef *psample)
+{
+  pgov->avg = pgov->avg - (pgov->avg >> 3) + psample->bytes;
+
+  /* A streaming alternate setting freezes the clock */
+  if (psample->iso != 0U)
+  {
+    pgov->idle = 0U;
+    return pgov->level;
+  }
+
+  /* Bulk traffic starting goes straight back to full speed */
+  if ((psample->bytes >= USBD_GOV_UP_BYTES) || (psample->backlog != 0U))
+  {
+    pgov->idle = 0U;
+    pgov->level = 0U;
+    return pgov->level;
+  }
+
+  if ((pgov->avg >> 3) >= USBD_GOV_IDLE_BYTES)
+  {
+    pgov->idle = 0U;
+    return pgov->level;
+  }
+
+  pgov->idle++;
+
+  if ((pgov->idle >= USBD_GOV_IDLE_FRAMES) && (pgov->level < USBD_GOV_MAX_LEVEL))
+  {
+    pgov->idle = 0U;
+    pgov->level++;
+  }
+
+  return pgov->level;
+}
+
+/**
+  * @brief  USBD_Gov_Traffic
+  *         Account the data of a completed non-control transfer, called by
+  *         the low level driver
+  * @param  pdev: device instance
+  * @param  bytes: bytes moved
+  * @retval None
+  */
+void USBD_Gov_Traffic(USBD_HandleTypeDef *pdev, uint32_t bytes)
+{
+  USBD_GovTypeDef *pgov = &USBD_Gov[USBD_DEV_IDX(pdev)];
+
+  pgov->bytes += bytes;
+
+  /* Do not wait for the next SOF to speed up */
+  if ((pgov->state.level != 0U) && (pgov->bytes >= USBD_GOV_UP_BYTES) &&
+      (pgov->iso_mask == 0U))
+  {
+    pgov->state.idle = 0U;
+    pgov->state.level = 0U;
+    USBD_Gov_Apply();
+  }
+}
+
+/**
+  * @brief  USBD_Gov_SetIso
+  *         Track the isochronous endpoints, called by the low level driver
+  *         when it opens or closes one. The clock is brought to full speed
+  *         before the first one opens, so it is never changed under it
+  * @param  pdev: device instance
+  * @param  ep_addr: endpoint address
+  * @param  open: 1 when the endpoint opens, 0 when it closes
+  * @retval None
+  */
+void USBD_Gov_SetIso(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t open)
+{
+  USBD_GovTypeDef *pgov = &USBD_Gov[USBD_DEV_IDX(pdev)];
+  uint32_t bit = 1UL << ((ep_addr & 0xFU) + (((ep_addr & 0x80U) == 0x80U) ? 0U : 16U));
+
+  if (open == 0U)
+  {
+    pgov->iso_mask &= ~bit;
+    return;
+  }
+
+  if (pgov->state.level != 0U)
+  {
+    pgov->state.idle = 0U;
+    pgov->state.level = 0U;
+    USBD_Gov_Apply();
+  }
+
+  pgov->iso_mask |= bit;
+}
+
+/**
+  * @brief  USBD_Gov_SOF
+  *         Sample the load of the (micro)frame that ended and apply the
+  *         level the policy wants
+  * @param  pdev: device instance
+  * @retval None
+  */
+void USBD_Gov_SOF(USBD_HandleTypeDef *pdev)
+{
+  USBD_GovTypeDef *pgov = &USBD_Gov[USBD_DEV_IDX(pdev)];
+  USBD_GovSampleTypeDef sample;
+  uint8_t level = pgov->state.level;
+
+  sample.bytes = pgov->bytes;
+  sample.backlog = 0U;
+  sample.iso = (pgov->iso_mask != 0U) ? 1U : 0U;
+  pgov->bytes = 0U;
+
+  for (uint8_t ep = 1U; ep < 16U; ep++)
+  {
+    if ((pdev->ep_in[ep].xfer_head != NULL) && (pdev->ep_in[ep].xfer_head->next != NULL))
+    {
+      sample.backlog++;
+    }
+  }
+
+  if (USBD_Gov_Step(&pgov->state, &sample) != level)
+  {
+    USBD_Gov_Apply();
+  }
+}
+
+/**
+  * @brief  USBD_Gov_GetLevel
+  *         Return the performance level applied to the clock
+  * @retval 0 for full speed, up to USBD_GOV_MAX_LEVEL
+  */
+uint8_t USBD_Gov_GetLevel(void)
+{
+  return USBD_Gov_Level;
+}
+
+/**
+  * @brief  USBD_Gov_Apply
+  *         Apply the fastest level the devices want. A slower level the low
+  *         level driver refuses, below the bus clock of the USB core, is
+  *         clamped to the slowest one it accepts; a faster one it refuses
+  *         leaves the clock where it is
+  * @retval None
+  */
+static void USBD_Gov_Apply(void)
+{
+  uint8_t level = USBD_GOV_MAX_LEVEL;
+
+  for (uint8_t dev = 0U; dev < USBD_MAX_NUM_DEV; dev++)
+  {
+    level = MIN(level, USBD_Gov[dev].state.level);
+  }
+
+  while (level != USBD_Gov_Level)
+  {
+    if (USBD_LL_SetPerfLevel(level) == USBD_OK)
+    {
+      USBD_Gov_Level = level;
+    }
+    else if (level > USBD_Gov_Level)
+    {
+      level--;
+    }
+    else
+    {
+      break;
+    }
+  }
+}
+
+/**
+  * @}
+  */
+
+#endif /* (USBD_USE_GOVERNOR == 1U) */
+
+
+/**
+  * @}
+  */
+
+
+/**
+  * @}
+  */
+
+/********************************** END OF FILE *******************************/
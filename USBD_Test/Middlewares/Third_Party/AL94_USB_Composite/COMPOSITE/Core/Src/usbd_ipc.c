@@ -0,0 +1,318 @@
+/**
+  ******************************************************************************
+  * @file    usbd_ipc.c
+  * @brief   This file provides the inter-core transport of a split stack.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_ipc.h"
+
+/** @addtogroup STM32_USBD_DEVICE_LIBRARY
+  * @{
+  */
+
+
+/** @defgroup USBD_IPC
+  * @brief usbd inter-core transport module
+  *        On a dual-core part the stack side core runs the USB interrupt and
+  *        the class state machines, the service side core runs the class
+  *        user interfaces. Two single producer, single consumer rings in
+  *        shared memory carry the messages, one per direction, and a
+  *        doorbell supplied by the interface layer wakes the side that
+  *        drains a ring. A message only carries a buffer pointer: the
+  *        buffer changes owner with the message and comes back with the
+  *        matching release, completion or reply, nothing is copied.
+  *        The module touches nothing but the shared block and the doorbell,
+  *        two threads sharing the block stand in for the two cores on a host.
+  * @{
+  */
+
+#if (USBD_USE_IPC == 1U)
+
+/** @defgroup USBD_IPC_Private_TypesDefinitions
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_IPC_Private_Defines
+  * @{
+  */
+
+#define USBD_IPC_RING_MASK                              (USBD_IPC_RING_SIZE - 1U)
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_IPC_Private_Macros
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_IPC_Private_FunctionPrototypes
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_IPC_Private_Variables
+  * @{
+  */
+
+/* Linked at the same address by both cores, in memory neither of them
+   caches. The section is not initialised by the startup code */
+#if defined ( __ICCARM__ ) /*!< IAR Compiler */
+#pragma location=".usbd_ipc"
+static USBD_IPC_ShareTypeDef USBD_IPC_Share;
+#else
+static USBD_IPC_ShareTypeDef USBD_IPC_Share __attribute__((section(".usbd_ipc")));
+#endif
+
+static uint32_t USBD_IPC_Seq;    /* last call made by this core */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_IPC_Private_Functions
+  * @{
+  */
+
+/**
+  * @brief  USBD_IPC_Put
+  *         Add a message to a ring, called by its producer only
+  * @param  pring: ring
+  * @param  pmsg: message, copied into the ring
+  * @retval USBD_OK, USBD_BUSY when the ring is full
+  */
+USBD_StatusTypeDef USBD_IPC_Put(USBD_IPC_RingTypeDef *pring, const USBD_IPC_MsgTypeDef *pmsg)
+{
+  uint32_t head = pring->head;
+
+  if ((head - pring->tail) >= USBD_IPC_RING_SIZE)
+  {
+    return USBD_BUSY;
+  }
+
+  pring->msg[head & USBD_IPC_RING_MASK] = *pmsg;
+
+  /* The message is complete before the consumer can see it */
+  USBD_IPC_BARRIER();
+  pring->head = head + 1U;
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_IPC_Get
+  *         Take the oldest message of a ring, called by its consumer only
+  * @param  pring: ring
+  * @param  pmsg: message, copied out of the ring
+  * @retval USBD_OK, USBD_FAIL when the ring is empty
+  */
+USBD_StatusTypeDef USBD_IPC_Get(USBD_IPC_RingTypeDef *pring, USBD_IPC_MsgTypeDef *pmsg)
+{
+  uint32_t tail = pring->tail;
+
+  if (tail == pring->head)
+  {
+    return USBD_FAIL;
+  }
+
+  USBD_IPC_BARRIER();
+  *pmsg = pring->msg[tail & USBD_IPC_RING_MASK];
+
+  /* The slot is read before the producer can reuse it */
+  USBD_IPC_BARRIER();
+  pring->tail = tail + 1U;
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_IPC_Init
+  *         Empty the rings, called once by the core that boots first and
+  *         before the other core uses the transport
+  * @retval None
+  */
+void USBD_IPC_Init(void)
+{
+  (void)USBD_memset(&USBD_IPC_Share, 0, sizeof(USBD_IPC_Share));
+  USBD_IPC_BARRIER();
+}
+
+/**
+  * @brief  USBD_IPC_Post
+  *         Queue a message without waiting for its outcome and ring the
+  *         doorbell of the other side
+  * @param  ring: USBD_IPC_TO_SERVICE or USBD_IPC_TO_STACK
+  * @param  pmsg: message
+  * @retval USBD_OK, USBD_BUSY when the ring stayed full
+  */
+USBD_StatusTypeDef USBD_IPC_Post(uint8_t ring, const USBD_IPC_MsgTypeDef *pmsg)
+{
+  uint32_t spin = USBD_IPC_SPIN;
+
+  while (USBD_IPC_Put(&USBD_IPC_Share.ring[ring], pmsg) != USBD_OK)
+  {
+    if (--spin == 0U)
+    {
+      return USBD_BUSY;
+    }
+  }
+
+  USBD_IPC_Doorbell(ring);
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_IPC_Call
+  *         Run an operation on the service side and wait for its reply,
+  *         called by the stack side. The buffer of the message belongs to
+  *         the service side until the call returns. A call the service side
+  *         has not claimed within USBD_IPC_SPIN polls is cancelled, one it
+  *         has claimed is waited for, the buffer being in use
+  * @param  pmsg: message, status and arguments are updated from the reply
+  * @retval USBD_OK when a reply came back, USBD_FAIL when the call was
+  *         cancelled and the buffer is back with the caller
+  */
+USBD_StatusTypeDef USBD_IPC_Call(USBD_IPC_MsgTypeDef *pmsg)
+{
+  USBD_IPC_ReplyTypeDef *preply = &USBD_IPC_Share.reply;
+  uint32_t spin = USBD_IPC_SPIN;
+
+  USBD_IPC_Seq++;
+
+  if (USBD_IPC_Seq == 0U)
+  {
+    USBD_IPC_Seq = 1U;
+  }
+
+  pmsg->seq = USBD_IPC_Seq;
+
+  if (USBD_IPC_Post(USBD_IPC_TO_SERVICE, pmsg) != USBD_OK)
+  {
+    return USBD_FAIL;
+  }
+
+  while (preply->seq != pmsg->seq)
+  {
+    if (--spin == 0U)
+    {
+      /* Cancel first, then look for the claim */
+      preply->cancel = pmsg->seq;
+      USBD_IPC_BARRIER();
+
+      if (preply->claim != pmsg->seq)
+      {
+        /* The service side drops the call when it gets to it */
+        return USBD_FAIL;
+      }
+
+      /* Started before the cancel, the buffer is the service side's until
+         the reply */
+      while (preply->seq != pmsg->seq)
+      {
+      }
+    }
+  }
+
+  USBD_IPC_BARRIER();
+  pmsg->status = (int8_t)preply->status;
+  pmsg->arg[0] = preply->arg[0];
+  pmsg->arg[1] = preply->arg[1];
+  pmsg->pbuf = preply->pbuf;
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_IPC_Claim
+  *         Take a call before touching its buffer, called by the service
+  *         side
+  * @param  pmsg: call message
+  * @retval USBD_OK to run the call, USBD_FAIL when the stack side cancelled
+  *         it: the call is dropped without reply
+  */
+USBD_StatusTypeDef USBD_IPC_Claim(const USBD_IPC_MsgTypeDef *pmsg)
+{
+  USBD_IPC_ReplyTypeDef *preply = &USBD_IPC_Share.reply;
+
+  /* Claim first, then look for the cancel */
+  preply->claim = pmsg->seq;
+  USBD_IPC_BARRIER();
+
+  return (preply->cancel == pmsg->seq) ? USBD_FAIL : USBD_OK;
+}
+
+/**
+  * @brief  USBD_IPC_Reply
+  *         Return the outcome of a call, called by the service side
+  * @param  pmsg: call message with its status and arguments filled in
+  * @retval None
+  */
+void USBD_IPC_Reply(const USBD_IPC_MsgTypeDef *pmsg)
+{
+  USBD_IPC_ReplyTypeDef *preply = &USBD_IPC_Share.reply;
+
+  preply->status = pmsg->status;
+  preply->arg[0] = pmsg->arg[0];
+  preply->arg[1] = pmsg->arg[1];
+  preply->pbuf = pmsg->pbuf;
+
+  /* The caller polls the sequence, it is written last */
+  USBD_IPC_BARRIER();
+  preply->seq = pmsg->seq;
+}
+
+/**
+  * @brief  USBD_IPC_Receive
+  *         Take the next message of a ring, called by the side draining it
+  * @param  ring: USBD_IPC_TO_SERVICE or USBD_IPC_TO_STACK
+  * @param  pmsg: message
+  * @retval USBD_OK, USBD_FAIL when the ring is empty
+  */
+USBD_StatusTypeDef USBD_IPC_Receive(uint8_t ring, USBD_IPC_MsgTypeDef *pmsg)
+{
+  return USBD_IPC_Get(&USBD_IPC_Share.ring[ring], pmsg);
+}
+
+/**
+  * @}
+  */
+
+#endif /* (USBD_USE_IPC == 1U) */
+
+/**
+  * @}
+  */
+
+
+/**
+  * @}
+  */
+
+/********************************** END OF FILE *******************************/
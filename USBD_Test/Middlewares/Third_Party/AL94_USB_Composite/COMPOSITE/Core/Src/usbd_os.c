@@ -0,0 +1,370 @@
+/**
+  ******************************************************************************
+  * @file    usbd_os.c
+  * @brief   This file provides the RTOS binding of the blocking class APIs.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_os.h"
+#include "usbd_core.h"
+
+/** @addtogroup STM32_USBD_DEVICE_LIBRARY
+  * @{
+  */
+
+
+/** @defgroup USBD_OS
+  * @brief usbd RTOS binding module
+  *        Every endpoint owns one bit of a CMSIS-RTOS2 event flags object, set
+  *        from the data stage interrupt once the class has handled it. A task
+  *        calling a blocking class API sleeps on that bit and re-tests its
+  *        wake-up condition each time it is set, bus reset and disconnect set
+  *        every bit so no task stays blocked on a dead link.
+  *        A worker task per device instance runs the jobs classes post from
+  *        interrupt context, the storage accesses of MSC for instance.
+  * @{
+  */
+
+#if (USBD_USE_OS == 1U)
+
+/** @defgroup USBD_OS_Private_TypesDefinitions
+  * @{
+  */
+
+typedef struct
+{
+  USBD_OS_WorkTypeDef Work;
+  void *arg;
+} USBD_OS_JobTypeDef;
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_OS_Private_Defines
+  * @{
+  */
+
+#define USBD_OS_ALL_EP_FLAGS                            0xFFFFU
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_OS_Private_Macros
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_OS_Private_FunctionPrototypes
+  * @{
+  */
+
+static osEventFlagsId_t USBD_OS_GetEvent(USBD_HandleTypeDef *pdev, uint8_t ep_addr);
+static uint8_t USBD_OS_IsLinkUp(USBD_HandleTypeDef *pdev);
+static void USBD_OS_Worker(void *argument);
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_OS_Private_Variables
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_OS_Private_Functions
+  * @{
+  */
+
+/**
+  * @brief  USBD_OS_Init
+  *         Create the endpoint event flags of a device instance
+  * @param  pdev: device instance
+  * @retval status
+  */
+USBD_StatusTypeDef USBD_OS_Init(USBD_HandleTypeDef *pdev)
+{
+  if (pdev->os_event_in == NULL)
+  {
+    pdev->os_event_in = osEventFlagsNew(NULL);
+  }
+
+  if (pdev->os_event_out == NULL)
+  {
+    pdev->os_event_out = osEventFlagsNew(NULL);
+  }
+
+  if ((pdev->os_event_in == NULL) || (pdev->os_event_out == NULL))
+  {
+#if (USBD_DEBUG_LEVEL > 1U)
+    USBD_ErrLog("Cannot create the endpoint event flags");
+#endif
+    return USBD_EMEM;
+  }
+
+  if (pdev->os_work == NULL)
+  {
+    pdev->os_work = osMessageQueueNew(USBD_OS_WORK_QUEUE_SIZE,
+                                      sizeof(USBD_OS_JobTypeDef), NULL);
+  }
+
+  if ((pdev->os_work != NULL) && (pdev->os_worker == NULL))
+  {
+    osThreadAttr_t attr = {0};
+
+    attr.name = "usbd_worker";
+    attr.stack_size = USBD_OS_WORKER_STACK_SIZE;
+    attr.priority = USBD_OS_WORKER_PRIORITY;
+
+    pdev->os_worker = osThreadNew(USBD_OS_Worker, pdev, &attr);
+  }
+
+  if (pdev->os_worker == NULL)
+  {
+#if (USBD_DEBUG_LEVEL > 1U)
+    USBD_ErrLog("Cannot create the worker task");
+#endif
+    return USBD_EMEM;
+  }
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_OS_Post
+  *         Queue a job for the worker task, callable from interrupt
+  * @param  pdev: device instance
+  * @param  Work: job to run
+  * @param  arg: argument given to Work
+  * @retval USBD_OK, or USBD_BUSY when the queue is full
+  */
+USBD_StatusTypeDef USBD_OS_Post(USBD_HandleTypeDef *pdev, USBD_OS_WorkTypeDef Work,
+                                void *arg)
+{
+  USBD_OS_JobTypeDef job;
+
+  if (pdev->os_work == NULL)
+  {
+    return USBD_FAIL;
+  }
+
+  job.Work = Work;
+  job.arg = arg;
+
+  if (osMessageQueuePut(pdev->os_work, &job, 0U, 0U) != osOK)
+  {
+    return USBD_BUSY;
+  }
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_OS_Signal
+  *         Wake the tasks blocked on an endpoint, callable from interrupt
+  * @param  pdev: device instance
+  * @param  ep_addr: endpoint address
+  * @retval None
+  */
+void USBD_OS_Signal(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  osEventFlagsId_t ef = USBD_OS_GetEvent(pdev, ep_addr);
+
+  if (ef != NULL)
+  {
+    (void)osEventFlagsSet(ef, 1UL << (ep_addr & 0xFU));
+  }
+}
+
+/**
+  * @brief  USBD_OS_Abort
+  *         Wake every blocked task, they see the link down and return
+  * @param  pdev: device instance
+  * @retval None
+  */
+void USBD_OS_Abort(USBD_HandleTypeDef *pdev)
+{
+  if (pdev->os_event_in != NULL)
+  {
+    (void)osEventFlagsSet(pdev->os_event_in, USBD_OS_ALL_EP_FLAGS);
+  }
+
+  if (pdev->os_event_out != NULL)
+  {
+    (void)osEventFlagsSet(pdev->os_event_out, USBD_OS_ALL_EP_FLAGS);
+  }
+}
+
+/**
+  * @brief  USBD_OS_Wait
+  *         Block the calling task until a condition holds, the condition is
+  *         tested again each time the endpoint completes a transfer
+  * @param  pdev: device instance
+  * @param  ep_addr: endpoint address the condition depends on
+  * @param  Cond: wake-up condition
+  * @param  arg: argument given to Cond
+  * @param  timeout: in, kernel ticks to wait (osWaitForever allowed);
+  *                  out, ticks left so multi step calls share one budget
+  * @retval USBD_OK when Cond holds, USBD_BUSY on timeout,
+  *         USBD_FAIL when the device is not configured
+  */
+USBD_StatusTypeDef USBD_OS_Wait(USBD_HandleTypeDef *pdev, uint8_t ep_addr,
+                                USBD_OS_CondTypeDef Cond, void *arg,
+                                uint32_t *timeout)
+{
+  osEventFlagsId_t ef = USBD_OS_GetEvent(pdev, ep_addr);
+  uint32_t flag = 1UL << (ep_addr & 0xFU);
+  uint32_t start = osKernelGetTickCount();
+  uint32_t elapsed;
+  uint32_t wait;
+  uint32_t flags;
+
+  if (ef == NULL)
+  {
+    return USBD_FAIL;
+  }
+
+  for (;;)
+  {
+    /* Clear before testing, a completion between the test and the wait then
+       leaves the flag set and the wait returns at once */
+    (void)osEventFlagsClear(ef, flag);
+
+    if (Cond(arg) != 0U)
+    {
+      break;
+    }
+
+    if (USBD_OS_IsLinkUp(pdev) == 0U)
+    {
+      return USBD_FAIL;
+    }
+
+    if (*timeout == osWaitForever)
+    {
+      wait = osWaitForever;
+    }
+    else
+    {
+      elapsed = osKernelGetTickCount() - start;
+
+      if (elapsed >= *timeout)
+      {
+        *timeout = 0U;
+        return USBD_BUSY;
+      }
+
+      wait = *timeout - elapsed;
+    }
+
+    /* Keep the flag set, other tasks waiting on the endpoint see it too */
+    flags = osEventFlagsWait(ef, flag, osFlagsWaitAny | osFlagsNoClear, wait);
+
+    if (((flags & osFlagsError) != 0U) && (flags != osFlagsErrorTimeout))
+    {
+      return USBD_FAIL;
+    }
+  }
+
+  if (*timeout != osWaitForever)
+  {
+    elapsed = osKernelGetTickCount() - start;
+    *timeout = (elapsed < *timeout) ? (*timeout - elapsed) : 0U;
+  }
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_OS_GetEvent
+  *         Return the event flags serving an endpoint direction
+  * @param  pdev: device instance
+  * @param  ep_addr: endpoint address
+  * @retval event flags object
+  */
+static osEventFlagsId_t USBD_OS_GetEvent(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  if ((ep_addr & 0x80U) == 0x80U)
+  {
+    return pdev->os_event_in;
+  }
+
+  return pdev->os_event_out;
+}
+
+/**
+  * @brief  USBD_OS_IsLinkUp
+  *         Check whether blocked transfers can still complete, a suspended
+  *         device keeps its configuration
+  * @param  pdev: device instance
+  * @retval 1 when configured, 0 otherwise
+  */
+static uint8_t USBD_OS_IsLinkUp(USBD_HandleTypeDef *pdev)
+{
+  uint8_t state = pdev->dev_state;
+
+  if (state == USBD_STATE_SUSPENDED)
+  {
+    state = pdev->dev_old_state;
+  }
+
+  return (state == USBD_STATE_CONFIGURED) ? 1U : 0U;
+}
+
+/**
+  * @brief  USBD_OS_Worker
+  *         Run the jobs of a device instance in the order they were posted
+  * @param  argument: device instance
+  * @retval None
+  */
+static void USBD_OS_Worker(void *argument)
+{
+  USBD_HandleTypeDef *pdev = (USBD_HandleTypeDef *)argument;
+  USBD_OS_JobTypeDef job;
+
+  for (;;)
+  {
+    if (osMessageQueueGet(pdev->os_work, &job, NULL, osWaitForever) == osOK)
+    {
+      job.Work(pdev, job.arg);
+    }
+  }
+}
+
+/**
+  * @}
+  */
+
+#endif /* (USBD_USE_OS == 1U) */
+
+/**
+  * @}
+  */
+
+
+/**
+  * @}
+  */
+
+/********************************** END OF FILE *******************************/
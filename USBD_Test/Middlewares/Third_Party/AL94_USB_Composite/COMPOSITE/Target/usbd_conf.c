@@ -34,13 +34,70 @@
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
+/* Receive FIFO shared by all the OUT endpoints */
+#define USBD_LL_HS_RX_FIFO_SIZE   1024U
+#define USBD_LL_FS_RX_FIFO_SIZE   512U
+#define USBD_LL_EP0_TX_FIFO_SIZE  64U
+/* Slowest AHB clock of the USB cores: OTG_HS with a ULPI PHY needs 30 MHz,
+   a full speed core 14.2 MHz; the governor stops above it */
+#define USBD_LL_HS_HCLK_MIN       30000000U
+#define USBD_LL_FS_HCLK_MIN       14200000U
+/* Every endpoint of a core, for USBD_LL_TxV_Release */
+#define USBD_LL_TXV_EP_ALL        0xFFU
 /* Private macro -------------------------------------------------------------*/
 
 /* USER CODE BEGIN PV */
 /* Private variables ---------------------------------------------------------*/
 
+/* Scatter-gather transmit context, one per IN endpoint using USBD_LL_TransmitV */
+typedef struct
+{
+  PCD_HandleTypeDef *hpcd;
+  USBD_SegmentTypeDef seg[USBD_LL_TXV_MAX_SEGMENTS];
+  uint32_t offset;
+  uint8_t nseg;
+  uint8_t idx;
+  uint8_t ep_addr;
+  uint32_t stage[USBD_LL_TXV_STAGE_SIZE / 4U]; /* Force 32-bit alignment */
+} USBD_LL_TxVTypeDef;
+
+static USBD_LL_TxVTypeDef USBD_LL_TxV[USBD_LL_TXV_CHANNELS];
+
+/* The second device runs on the OTG_FS core, only parts with both cores
+   declare hpcd_USB_OTG_FS next to hpcd_USB_OTG_HS (the H7B3 has OTG_HS only) */
+#if (USBD_MAX_NUM_DEV > 1U) && ((STM32F1_DEVICE) || !defined(USB_OTG_FS) || !defined(USB_OTG_HS))
+#error "USBD_MAX_NUM_DEV > 1 needs a device with both the OTG_FS and OTG_HS cores"
+#endif
+
+/* USBD_LL_GetTimestamp counts core cycles, its users measure wrong time
+   once the governor divides the core clock */
+#if (USBD_USE_GOVERNOR == 1U) && (USBD_USE_TIMEBASE == 1U) && defined(DWT_BASE)
+#error "The timebase counts core cycles, it cannot follow the clock governor"
+#endif
+
+#if (USBD_USE_GOVERNOR == 1U) && (USBD_ENUM_TRACE == 1U) && defined(DWT_BASE)
+#error "The enumeration trace counts core cycles, it cannot follow the clock governor"
+#endif
+
+#if (USBD_USE_GOVERNOR == 1U) && (USBD_USE_CDC_BENCH == 1U) && defined(DWT_BASE)
+#error "The CDC benchmark counts core cycles, it cannot follow the clock governor"
+#endif
+
+#if (USBD_USE_GOVERNOR == 1U) && (USBD_USE_CDC_FRAME == 1U) && defined(DWT_BASE)
+#error "The CDC frame retransmission timer counts core cycles, it cannot follow the clock governor"
+#endif
+
+/* The UART baud rates are derived from the bus clock the governor divides
+   unless every bridged UART has a kernel clock of its own */
+#if (USBD_USE_GOVERNOR == 1U) && (USBD_USE_CDC_BRIDGE == 1U) && (USBD_GOV_UART_OWN_CLOCK == 0U)
+#error "Give the bridged UARTs a kernel clock other than PCLK and set USBD_GOV_UART_OWN_CLOCK to 1U"
+#endif
+
+#if (USBD_LL_DEDICATED_EP1 == 1U) && ((STM32F1_DEVICE) || !defined(USB_OTG_HS))
+#error "USBD_LL_DEDICATED_EP1 needs the OTG_HS core"
+#endif
 /* USER CODE END PV */
-PCD_HandleTypeDef *hpcd_USB_OTG_PTR;
+PCD_HandleTypeDef *hpcd_USB_OTG_PTR; /* core linked by the last USBD_LL_Init call */
 void Error_Handler(void);
 
 /* External functions --------------------------------------------------------*/
@@ -54,6 +111,20 @@ void Error_Handler(void);
 USBD_StatusTypeDef USBD_Get_USB_Status(HAL_StatusTypeDef hal_status);
 HAL_StatusTypeDef HAL_PCDEx_SetTxFiFoInBytes(PCD_HandleTypeDef *hpcd, uint8_t fifo, uint16_t size);
 HAL_StatusTypeDef HAL_PCDEx_SetRxFiFoInBytes(PCD_HandleTypeDef *hpcd, uint16_t size);
+static USBD_StatusTypeDef USBD_LL_TxV_Next(USBD_LL_TxVTypeDef *ptxv);
+static uint8_t USBD_LL_TxV_DataIn(PCD_HandleTypeDef *hpcd, uint8_t epnum);
+static void USBD_LL_TxV_Release(PCD_HandleTypeDef *hpcd, uint8_t epnum);
+#if (!STM32F1_DEVICE)
+static void USBD_LL_SetFiFos(USBD_HandleTypeDef *pdev, uint16_t rx_size, uint16_t ram_size);
+static void USBD_LL_SetTxFiFos(USBD_HandleTypeDef *pdev, USBD_FiFo_LayoutTypeDef *playout);
+static void USBD_LL_CheckFiFos(PCD_HandleTypeDef *hpcd, uint16_t ram_size);
+#else
+static void USBD_LL_SetPMAs(USBD_HandleTypeDef *pdev, uint16_t pma_track);
+#endif
+#if (USBD_LL_DEDICATED_EP1 == 1U)
+static void USBD_LL_EP1_Route(PCD_HandleTypeDef *hpcd, uint8_t ep_addr);
+static void USBD_LL_EP1_WriteFifo(PCD_HandleTypeDef *hpcd);
+#endif /* (USBD_LL_DEDICATED_EP1 == 1U) */
 /* USER CODE END PFP */
 
 /* Private functions ---------------------------------------------------------*/
@@ -70,6 +141,370 @@ HAL_StatusTypeDef HAL_PCDEx_SetRxFiFoInBytes(PCD_HandleTypeDef *hpcd, uint16_t s
 	return HAL_PCDEx_SetRxFiFo(hpcd, (size/4));
 }
 #endif
+
+#if (!STM32F1_DEVICE)
+/**
+  * @brief  Set up the FIFOs of the core for the configuration the class
+  *         registry describes, the FIFO RAM left once every endpoint has
+  *         its FIFO is shared by the data endpoints.
+  * @param  pdev: Device handle, linked to its PCD handle
+  * @param  rx_size: Receive FIFO size in bytes
+  * @param  ram_size: FIFO RAM of the core in bytes
+  * @retval None
+  */
+static void USBD_LL_SetFiFos(USBD_HandleTypeDef *pdev, uint16_t rx_size, uint16_t ram_size)
+{
+  PCD_HandleTypeDef *hpcd = (PCD_HandleTypeDef *)pdev->pData;
+  USBD_FiFo_LayoutTypeDef layout;
+
+  USBD_FiFo_Init(&layout, ram_size, rx_size);
+  USBD_FiFo_Add(&layout, 0x80U, USBD_LL_EP0_TX_FIFO_SIZE, 0U);
+  USBD_LL_SetTxFiFos(pdev, &layout);
+
+  if (USBD_FiFo_Plan(&layout) != USBD_OK)
+  {
+    USBD_ErrLog("FIFOs of the configuration exceed %u bytes", (unsigned)ram_size);
+  }
+
+  HAL_PCDEx_SetRxFiFoInBytes(hpcd, rx_size); // ALL OUT EP Buffer
+
+  /* The offset of a FIFO follows from the ones below it, so they go in
+     increasing endpoint number whatever the order of the classes; the
+     FIFOs of the endpoints the configuration leaves unused take no room */
+  for (uint8_t fifo = 0U; (fifo < hpcd->Init.dev_endpoints) && (fifo < USBD_FIFO_MAX_TX); fifo++)
+  {
+    HAL_PCDEx_SetTxFiFoInBytes(hpcd, fifo, layout.tx_size[fifo]);
+  }
+
+  USBD_LL_CheckFiFos(hpcd, ram_size);
+}
+
+/**
+  * @brief  Read the FIFO layout back from the core and check that no FIFO
+  *         overlaps another or runs out of the FIFO RAM.
+  * @param  hpcd: PCD handle
+  * @param  ram_size: FIFO RAM of the core in bytes
+  * @retval None
+  */
+static void USBD_LL_CheckFiFos(PCD_HandleTypeDef *hpcd, uint16_t ram_size)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+  USBD_FiFo_LayoutTypeDef layout;
+  uint32_t reg;
+
+  USBD_FiFo_Init(&layout, ram_size, (uint16_t)((USBx->GRXFSIZ & 0xFFFFU) * 4U));
+
+  for (uint8_t fifo = 0U; (fifo < hpcd->Init.dev_endpoints) && (fifo < USBD_FIFO_MAX_TX); fifo++)
+  {
+    reg = (fifo == 0U) ? USBx->DIEPTXF0_HNPTXFSIZ : USBx->DIEPTXF[fifo - 1U];
+    layout.tx_size[fifo] = (uint16_t)((reg >> 16) * 4U);
+    layout.tx_offset[fifo] = (uint16_t)((reg & 0xFFFFU) * 4U);
+  }
+
+  if (USBD_FiFo_Check(&layout) != USBD_OK)
+  {
+    USBD_ErrLog("TX FIFOs overlap");
+  }
+}
+
+/**
+  * @brief  Add the TX FIFOs of the IN endpoints of the mounted classes to
+  *         the layout, in registry order; the layout places them.
+  * @param  pdev: Device handle, linked to its PCD handle
+  * @param  playout: FIFO layout
+  * @retval None
+  */
+static void USBD_LL_SetTxFiFos(USBD_HandleTypeDef *pdev, USBD_FiFo_LayoutTypeDef *playout)
+{
+  uint8_t classId = pdev->classId;
+
+  for (uint8_t idx = 0U; idx < pdev->NumClasses; idx++)
+  {
+    USBD_ClassTypeDef *pclass = pdev->tclass[idx].pClass;
+
+    /* Instances out of the configuration own no endpoint */
+    if (pdev->tclass[idx].ep_in == 0U)
+    {
+      continue;
+    }
+
+    /* The endpoint macros read the map of the selected instance */
+    pdev->classId = idx;
+
+#if (USBD_USE_CDC_RNDIS == 1)
+    if (pclass == &USBD_CDC_RNDIS)
+    {
+      USBD_FiFo_Add(playout, CDC_RNDIS_IN_EP(pdev), 128, 1U);
+      USBD_FiFo_Add(playout, CDC_RNDIS_CMD_EP(pdev), 64, 0U);
+    }
+#endif
+#if (USBD_USE_CDC_ECM == 1)
+    if (pclass == &USBD_CDC_ECM)
+    {
+      USBD_FiFo_Add(playout, CDC_ECM_IN_EP(pdev), 128, 1U);
+      USBD_FiFo_Add(playout, CDC_ECM_CMD_EP(pdev), 64, 0U);
+    }
+#endif
+#if (USBD_USE_HID_MOUSE == 1)
+    if (pclass == &USBD_HID_MOUSE)
+    {
+      USBD_FiFo_Add(playout, HID_MOUSE_IN_EP(pdev), 64, 0U);
+    }
+#endif
+#if (USBD_USE_HID_KEYBOARD == 1)
+    if (pclass == &USBD_HID_KEYBOARD)
+    {
+      USBD_FiFo_Add(playout, HID_KEYBOARD_IN_EP(pdev), 64, 0U);
+    }
+#endif
+#if (USBD_USE_HID_CUSTOM == 1)
+    if (pclass == &USBD_HID_CUSTOM)
+    {
+      USBD_FiFo_Add(playout, CUSTOM_HID_IN_EP(pdev), 64, 0U);
+    }
+#endif
+#if (USBD_USE_UAC_MIC == 1)
+    if (pclass == &USBD_AUDIO_MIC)
+    {
+      USBD_FiFo_Add(playout, AUDIO_MIC_EP(pdev), 128, 1U);
+    }
+#endif
+#if (USBD_USE_UVC == 1)
+    if (pclass == &USBD_VIDEO)
+    {
+      USBD_FiFo_Add(playout, UVC_IN_EP(pdev), 128, 1U);
+    }
+#endif
+#if (USBD_USE_MSC == 1)
+    if (pclass == &USBD_MSC)
+    {
+      USBD_FiFo_Add(playout, MSC_IN_EP(pdev), 128, 1U);
+    }
+#endif
+#if (USBD_USE_PRNTR == 1)
+    if (pclass == &USBD_PRNT)
+    {
+      USBD_FiFo_Add(playout, PRNT_IN_EP(pdev), 128, 1U);
+    }
+#endif
+#if (USBD_USE_CDC_ACM == 1)
+    if (pclass == &USBD_CDC_ACM)
+    {
+      for (uint8_t i = 0; i < USBD_CDC_ACM_COUNT; i++)
+      {
+        USBD_FiFo_Add(playout, CDC_IN_EP(pdev, i), 128, 1U);
+
+        if (CDC_CMD_EP(pdev, i) != 0U)
+        {
+          USBD_FiFo_Add(playout, CDC_CMD_EP(pdev, i), 64, 0U);
+        }
+      }
+    }
+#endif
+  }
+
+  pdev->classId = classId;
+}
+#else
+/**
+  * @brief  Allocate the packet memory of the endpoints of the mounted classes.
+  * @param  pdev: Device handle, linked to its PCD handle
+  * @param  pma_track: first free PMA offset
+  * @retval None
+  */
+static void USBD_LL_SetPMAs(USBD_HandleTypeDef *pdev, uint16_t pma_track)
+{
+  PCD_HandleTypeDef *hpcd = (PCD_HandleTypeDef *)pdev->pData;
+  uint8_t classId = pdev->classId;
+
+  for (uint8_t idx = 0U; idx < pdev->NumClasses; idx++)
+  {
+    USBD_ClassTypeDef *pclass = pdev->tclass[idx].pClass;
+
+    /* Instances out of the configuration own no endpoint */
+    if ((pdev->tclass[idx].ep_in == 0U) && (pdev->tclass[idx].ep_out == 0U))
+    {
+      continue;
+    }
+
+    /* The endpoint macros read the map of the selected instance */
+    pdev->classId = idx;
+
+#if (USBD_USE_CDC_RNDIS == 1)
+    if (pclass == &USBD_CDC_RNDIS)
+    {
+      HAL_PCDEx_PMAConfig(hpcd, CDC_RNDIS_IN_EP(pdev), PCD_SNG_BUF, pma_track);
+      pma_track += 128;
+      HAL_PCDEx_PMAConfig(hpcd, CDC_RNDIS_OUT_EP(pdev), PCD_SNG_BUF, pma_track);
+      pma_track += 128;
+      HAL_PCDEx_PMAConfig(hpcd, CDC_RNDIS_CMD_EP(pdev), PCD_SNG_BUF, pma_track);
+      pma_track += 8;
+    }
+#endif
+#if (USBD_USE_CDC_ECM == 1)
+    if (pclass == &USBD_CDC_ECM)
+    {
+      HAL_PCDEx_PMAConfig(hpcd, CDC_ECM_IN_EP(pdev), PCD_SNG_BUF, pma_track);
+      pma_track += 48;
+      HAL_PCDEx_PMAConfig(hpcd, CDC_ECM_OUT_EP(pdev), PCD_SNG_BUF, pma_track);
+      pma_track += 48;
+      HAL_PCDEx_PMAConfig(hpcd, CDC_ECM_CMD_EP(pdev), PCD_SNG_BUF, pma_track);
+      pma_track += 8;
+    }
+#endif
+#if (USBD_USE_HID_MOUSE == 1)
+    if (pclass == &USBD_HID_MOUSE)
+    {
+      HAL_PCDEx_PMAConfig(hpcd, HID_MOUSE_IN_EP(pdev), PCD_SNG_BUF, pma_track);
+      pma_track += 8;
+    }
+#endif
+#if (USBD_USE_HID_KEYBOARD == 1)
+    if (pclass == &USBD_HID_KEYBOARD)
+    {
+      HAL_PCDEx_PMAConfig(hpcd, HID_KEYBOARD_IN_EP(pdev), PCD_SNG_BUF, pma_track);
+      pma_track += 8;
+    }
+#endif
+#if (USBD_USE_HID_CUSTOM == 1)
+    if (pclass == &USBD_HID_CUSTOM)
+    {
+      HAL_PCDEx_PMAConfig(hpcd, CUSTOM_HID_IN_EP(pdev), PCD_SNG_BUF, pma_track);
+      pma_track += 8;
+      if (CUSTOM_HID_OUT_EP(pdev) != 0U)
+      {
+        HAL_PCDEx_PMAConfig(hpcd, CUSTOM_HID_OUT_EP(pdev), PCD_SNG_BUF, pma_track);
+        pma_track += 8;
+      }
+    }
+#endif
+#if (USBD_USE_UAC_MIC == 1)
+    if (pclass == &USBD_AUDIO_MIC)
+    {
+      HAL_PCDEx_PMAConfig(hpcd, AUDIO_MIC_EP(pdev), PCD_SNG_BUF, pma_track);
+      pma_track += 128;
+    }
+#endif
+#if (USBD_USE_UAC_SPKR == 1)
+    if (pclass == &USBD_AUDIO_SPKR)
+    {
+      HAL_PCDEx_PMAConfig(hpcd, AUDIO_SPKR_EP(pdev), PCD_SNG_BUF, pma_track);
+      pma_track += 128;
+    }
+#endif
+#if (USBD_USE_UVC == 1)
+    if (pclass == &USBD_VIDEO)
+    {
+      HAL_PCDEx_PMAConfig(hpcd, UVC_IN_EP(pdev), PCD_SNG_BUF, pma_track);
+      pma_track += 128;
+    }
+#endif
+#if (USBD_USE_MSC == 1)
+    if (pclass == &USBD_MSC)
+    {
+      HAL_PCDEx_PMAConfig(hpcd, MSC_IN_EP(pdev), PCD_SNG_BUF, pma_track);
+      pma_track += 128;
+      HAL_PCDEx_PMAConfig(hpcd, MSC_OUT_EP(pdev), PCD_SNG_BUF, pma_track);
+      pma_track += 128;
+    }
+#endif
+#if (USBD_USE_PRNTR == 1)
+    if (pclass == &USBD_PRNT)
+    {
+      HAL_PCDEx_PMAConfig(hpcd, PRNT_IN_EP(pdev), PCD_SNG_BUF, pma_track);
+      pma_track += 128;
+      HAL_PCDEx_PMAConfig(hpcd, PRNT_OUT_EP(pdev), PCD_SNG_BUF, pma_track);
+      pma_track += 128;
+    }
+#endif
+#if (USBD_USE_CDC_ACM == 1)
+    if (pclass == &USBD_CDC_ACM)
+    {
+      for (uint8_t i = 0; i < USBD_CDC_ACM_COUNT; i++)
+      {
+        HAL_PCDEx_PMAConfig(hpcd, CDC_IN_EP(pdev, i), PCD_SNG_BUF, pma_track);
+        pma_track += 48;
+
+        HAL_PCDEx_PMAConfig(hpcd, CDC_OUT_EP(pdev, i), PCD_SNG_BUF, pma_track);
+        pma_track += 48;
+
+        if (CDC_CMD_EP(pdev, i) != 0U)
+        {
+          HAL_PCDEx_PMAConfig(hpcd, CDC_CMD_EP(pdev, i), PCD_SNG_BUF, pma_track);
+          pma_track += 8;
+        }
+      }
+    }
+#endif
+  }
+
+  pdev->classId = classId;
+}
+#endif
+
+#if (USBD_LL_DEDICATED_EP1 == 1U)
+/**
+  * @brief  Move the interrupts of an EP1 direction from the shared OTG_HS
+  *         vector to its dedicated one. The HAL reset handler only unmasks
+  *         EP0, EP1 is routed again each time it is opened.
+  * @param  hpcd: PCD handle
+  * @param  ep_addr: EP1 IN or OUT address
+  * @retval None
+  */
+static void USBD_LL_EP1_Route(PCD_HandleTypeDef *hpcd, uint8_t ep_addr)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+  uint32_t USBx_BASE = (uint32_t)USBx;
+
+  /* Only the HS core has the vectors, DMA completions stay with the HAL */
+  if ((USBx != USB_OTG_HS) || (hpcd->Init.dma_enable != 0U))
+  {
+    return;
+  }
+
+  if ((ep_addr & 0x80U) == 0x80U)
+  {
+    USBx_DEVICE->DINEP1MSK = USB_OTG_DIEPMSK_TOM | USB_OTG_DIEPMSK_XFRCM | USB_OTG_DIEPMSK_EPDM;
+    (void)USB_ActivateDedicatedEndpoint(USBx, &hpcd->IN_ep[1]);
+    USBx_DEVICE->DAINTMSK &= ~(0x1UL << 1);
+  }
+  else
+  {
+    USBx_DEVICE->DOUTEP1MSK = USB_OTG_DOEPMSK_XFRCM | USB_OTG_DOEPMSK_EPDM;
+    (void)USB_ActivateDedicatedEndpoint(USBx, &hpcd->OUT_ep[1]);
+    USBx_DEVICE->DAINTMSK &= ~(0x1UL << 17);
+  }
+}
+
+/**
+  * @brief  Refill the EP1 transmit FIFO with the rest of the transfer.
+  * @param  hpcd: PCD handle
+  * @retval None
+  */
+static void USBD_LL_EP1_WriteFifo(PCD_HandleTypeDef *hpcd)
+{
+  USB_OTG_GlobalTypeDef *USBx = hpcd->Instance;
+  uint32_t USBx_BASE = (uint32_t)USBx;
+  USB_OTG_EPTypeDef *ep = &hpcd->IN_ep[1];
+  uint32_t len;
+
+  while (ep->xfer_count < ep->xfer_len)
+  {
+    len = MIN(ep->xfer_len - ep->xfer_count, ep->maxpacket);
+
+    if ((USBx_INEP(1U)->DTXFSTS & USB_OTG_DTXFSTS_INEPTFSAV) < ((len + 3U) / 4U))
+    {
+      return;
+    }
+
+    (void)USB_WritePacket(USBx, ep->xfer_buff, 1U, (uint16_t)len, 0U);
+    ep->xfer_buff += len;
+    ep->xfer_count += len;
+  }
+
+  USBx_DEVICE->DIEPEMPMSK &= ~(0x1UL << 1);
+}
+#endif /* (USBD_LL_DEDICATED_EP1 == 1U) */
 /* USER CODE END 1 */
 
 /*******************************************************************************
@@ -113,6 +548,13 @@ static void PCD_DataOutStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 void HAL_PCD_DataOutStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
+#if (USBD_USE_GOVERNOR == 1U)
+  if (epnum != 0U)
+  {
+    USBD_Gov_Traffic((USBD_HandleTypeDef *)hpcd->pData, hpcd->OUT_ep[epnum].xfer_count);
+  }
+#endif /* (USBD_USE_GOVERNOR == 1U) */
+
   USBD_LL_DataOutStage((USBD_HandleTypeDef *)hpcd->pData, epnum, hpcd->OUT_ep[epnum].xfer_buff);
 }
 
@@ -128,6 +570,19 @@ static void PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 void HAL_PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
+#if (USBD_USE_GOVERNOR == 1U)
+  if (epnum != 0U)
+  {
+    USBD_Gov_Traffic((USBD_HandleTypeDef *)hpcd->pData, hpcd->IN_ep[epnum].xfer_len);
+  }
+#endif /* (USBD_USE_GOVERNOR == 1U) */
+
+  /* Chunks of a scatter-gather transfer are not reported to the stack */
+  if (USBD_LL_TxV_DataIn(hpcd, epnum) != 0U)
+  {
+    return;
+  }
+
   USBD_LL_DataInStage((USBD_HandleTypeDef *)hpcd->pData, epnum, hpcd->IN_ep[epnum].xfer_buff);
 }
 
@@ -172,6 +627,10 @@ void HAL_PCD_ResetCallback(PCD_HandleTypeDef *hpcd)
   {
     Error_Handler();
   }
+
+  /* Scatter-gather transfers in flight are gone with the reset */
+  USBD_LL_TxV_Release(hpcd, USBD_LL_TXV_EP_ALL);
+
   /* Set Speed. */
   USBD_LL_SetSpeed((USBD_HandleTypeDef *)hpcd->pData, speed);
 
@@ -251,6 +710,9 @@ static void PCD_ISOINIncompleteCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 void HAL_PCD_ISOINIncompleteCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
+  /* The frame was dropped, its DataIn never comes */
+  USBD_LL_TxV_Release(hpcd, epnum);
+
   USBD_LL_IsoINIncomplete((USBD_HandleTypeDef *)hpcd->pData, epnum);
 }
 
@@ -279,9 +741,117 @@ static void PCD_DisconnectCallback(PCD_HandleTypeDef *hpcd)
 void HAL_PCD_DisconnectCallback(PCD_HandleTypeDef *hpcd)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
+  USBD_LL_TxV_Release(hpcd, USBD_LL_TXV_EP_ALL);
+
   USBD_LL_DevDisconnected((USBD_HandleTypeDef *)hpcd->pData);
 }
 
+#if (USBD_LPM_ENABLED == 1U)
+/**
+  * @brief  Link Power Management callback.
+  * The PHY clock is only gated in L1 and the system clocks are left running,
+  * so the device resumes within the few microseconds the host allows (BESL).
+  * @param  hpcd: PCD handle
+  * @param  msg: LPM message
+  * @retval None
+  */
+#if (USE_HAL_PCD_REGISTER_CALLBACKS == 1U)
+static void PCD_LPMCallback(PCD_HandleTypeDef *hpcd, PCD_LPM_MsgTypeDef msg)
+#else
+void HAL_PCDEx_LPM_Callback(PCD_HandleTypeDef *hpcd, PCD_LPM_MsgTypeDef msg)
+#endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
+{
+  switch (msg)
+  {
+    case PCD_LPM_L1_ACTIVE:
+      /* Inform USB library that core enters in L1 sleep. */
+      USBD_LL_Suspend((USBD_HandleTypeDef *)hpcd->pData);
+#if (!STM32F1_DEVICE)
+      __HAL_PCD_GATE_PHYCLOCK(hpcd);
+#endif
+      break;
+
+    case PCD_LPM_L0_ACTIVE:
+#if (!STM32F1_DEVICE)
+      __HAL_PCD_UNGATE_PHYCLOCK(hpcd);
+#endif
+      USBD_LL_Resume((USBD_HandleTypeDef *)hpcd->pData);
+      break;
+
+    default:
+      break;
+  }
+}
+#endif /* (USBD_LPM_ENABLED == 1U) */
+
+#if (USBD_LL_DEDICATED_EP1 == 1U)
+/**
+  * @brief  OTG_HS EP1 IN dedicated interrupt, to be called from
+  *         OTG_HS_EP1_IN_IRQHandler. Only the EP1 IN events are read, the
+  *         shared handler no longer scans this endpoint.
+  * @param  hpcd: PCD handle
+  * @retval None
+  */
+void USBD_LL_EP1_IN_IRQHandler(PCD_HandleTypeDef *hpcd)
+{
+  uint32_t USBx_BASE = (uint32_t)hpcd->Instance;
+  uint32_t epint = USBx_INEP(1U)->DIEPINT;
+
+  epint &= USBx_DEVICE->DINEP1MSK |
+           (((USBx_DEVICE->DIEPEMPMSK >> 1) & 0x1U) << 7); /* TXFE */
+
+  if ((epint & USB_OTG_DIEPINT_XFRC) == USB_OTG_DIEPINT_XFRC)
+  {
+    USBx_DEVICE->DIEPEMPMSK &= ~(0x1UL << 1);
+    USBx_INEP(1U)->DIEPINT = USB_OTG_DIEPINT_XFRC;
+
+#if (USE_HAL_PCD_REGISTER_CALLBACKS == 1U)
+    hpcd->DataInStageCallback(hpcd, 1U);
+#else
+    HAL_PCD_DataInStageCallback(hpcd, 1U);
+#endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
+  }
+
+  if ((epint & USB_OTG_DIEPINT_EPDISD) == USB_OTG_DIEPINT_EPDISD)
+  {
+    (void)USB_FlushTxFifo(hpcd->Instance, 1U);
+  }
+
+  USBx_INEP(1U)->DIEPINT = epint & (USB_OTG_DIEPINT_TOC | USB_OTG_DIEPINT_ITTXFE |
+                                    USB_OTG_DIEPINT_INEPNE | USB_OTG_DIEPINT_EPDISD);
+
+  if ((epint & USB_OTG_DIEPINT_TXFE) == USB_OTG_DIEPINT_TXFE)
+  {
+    USBD_LL_EP1_WriteFifo(hpcd);
+  }
+}
+
+/**
+  * @brief  OTG_HS EP1 OUT dedicated interrupt, to be called from
+  *         OTG_HS_EP1_OUT_IRQHandler. The data is still drained from the
+  *         receive FIFO by the shared handler, only the completion is
+  *         served here.
+  * @param  hpcd: PCD handle
+  * @retval None
+  */
+void USBD_LL_EP1_OUT_IRQHandler(PCD_HandleTypeDef *hpcd)
+{
+  uint32_t USBx_BASE = (uint32_t)hpcd->Instance;
+  uint32_t epint = USBx_OUTEP(1U)->DOEPINT & USBx_DEVICE->DOUTEP1MSK;
+
+  USBx_OUTEP(1U)->DOEPINT = epint;
+
+  if ((epint & USB_OTG_DOEPINT_XFRC) == USB_OTG_DOEPINT_XFRC)
+  {
+#if (USE_HAL_PCD_REGISTER_CALLBACKS == 1U)
+    hpcd->DataOutStageCallback(hpcd, 1U);
+#else
+    HAL_PCD_DataOutStageCallback(hpcd, 1U);
+#endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
+  }
+}
+#endif /* (USBD_LL_DEDICATED_EP1 == 1U) */
+
 /*******************************************************************************
                        LL Driver Interface (USB Device Library --> PCD)
 *******************************************************************************/
@@ -293,209 +863,71 @@ void HAL_PCD_DisconnectCallback(PCD_HandleTypeDef *hpcd)
   */
 USBD_StatusTypeDef USBD_LL_Init(USBD_HandleTypeDef *pdev)
 {
-#if (USBD_USE_HS == 1)
-  /** HIGH SPEED USB */
-  hpcd_USB_OTG_PTR = &hpcd_USB_OTG_HS;
-
+#if (USBD_USE_HS == 1) || (USBD_MAX_NUM_DEV > 1U)
   if (pdev->id == DEVICE_HS)
   {
+    /** HIGH SPEED USB */
+    hpcd_USB_OTG_PTR = &hpcd_USB_OTG_HS;
+
     /* Link the driver to the stack. */
     hpcd_USB_OTG_PTR->pData = pdev;
     pdev->pData = hpcd_USB_OTG_PTR;
 
     /* @see HAL_PCD_Init() usb_otg.c generated by cube **/
 
-    HAL_PCDEx_SetRxFiFoInBytes(hpcd_USB_OTG_PTR, 1024);
-
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, 0, 64); // EP0 IN
-
-#if (USBD_USE_CDC_RNDIS == 1)
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (CDC_RNDIS_IN_EP & 0x7F), 128);
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (CDC_RNDIS_CMD_EP & 0x7F), 64);
-#endif
-#if (USBD_USE_CDC_ECM == 1)
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (CDC_ECM_IN_EP & 0x7F), 128);
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (CDC_ECM_CMD_EP & 0x7F), 64);
-#endif
-#if (USBD_USE_HID_MOUSE == 1)
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (HID_MOUSE_IN_EP & 0x7F), 64);
-#endif
-#if (USBD_USE_HID_KEYBOARD == 1)
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (HID_KEYBOARD_IN_EP & 0x7F), 64);
-#endif
-#if (USBD_USE_HID_CUSTOM == 1)
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (CUSTOM_HID_IN_EP & 0x7F), 64);
-#endif
-#if (USBD_USE_UAC_MIC == 1)
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (AUDIO_MIC_EP & 0x7F), 128);
-#endif
-#if (USBD_USE_UAC_SPKR == 1)
-#endif
-#if (USBD_USE_UVC == 1)
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (UVC_IN_EP & 0x7F), 128);
-#endif
-#if (USBD_USE_MSC == 1)
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (MSC_IN_EP & 0x7F), 128);
-#endif
-#if (USBD_USE_DFU == 1)
-#endif
-#if (USBD_USE_PRNTR == 1)
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (PRNT_IN_EP & 0x7F), 128);
-#endif
-#if (USBD_USE_CDC_ACM == 1)
-    for (uint8_t i = 0; i < USBD_CDC_ACM_COUNT; i++)
-    {
-      HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (CDC_IN_EP[i] & 0x7F), 128);
-      HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (CDC_CMD_EP[i] & 0x7F), 64);
-    }
-#endif
+    USBD_LL_SetFiFos(pdev, USBD_LL_HS_RX_FIFO_SIZE, USBD_LL_HS_FIFO_RAM_SIZE);
   }
-#else
-  /**FULL SPEED USB */
-#if (STM32F1_DEVICE) /** for STM32F1 or similar */
-  hpcd_USB_OTG_PTR = &hpcd_USB_FS;  /** hpcd_USB_FS or hpcd_USB_OTG_FS*/
-#else
-  hpcd_USB_OTG_PTR = &hpcd_USB_OTG_FS;  /** hpcd_USB_FS or hpcd_USB_OTG_FS*/
 #endif
 
+#if (USBD_USE_HS == 0) || (USBD_MAX_NUM_DEV > 1U)
   if (pdev->id == DEVICE_FS)
   {
+    /**FULL SPEED USB */
+#if (STM32F1_DEVICE) /** for STM32F1 or similar */
+    hpcd_USB_OTG_PTR = &hpcd_USB_FS;  /** hpcd_USB_FS or hpcd_USB_OTG_FS*/
+#else
+    hpcd_USB_OTG_PTR = &hpcd_USB_OTG_FS;  /** hpcd_USB_FS or hpcd_USB_OTG_FS*/
+#endif
+
     /* Link the driver to the stack. */
     hpcd_USB_OTG_PTR->pData = pdev;
-    pdev->pData = hpcd_USB_OTG_PTR;
-
-    /* @see HAL_PCD_Init() usb_otg.c generated by cube **/
-
-#if (STM32F1_DEVICE)
-    /** Device is F1 or similar or if HAL_PCDEx_PMAConfig() is used by HAL driver */
-    uint16_t pma_track = 0x40; /** PMA offset*/
-
-    HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, 0x00, PCD_SNG_BUF, pma_track);
-    pma_track += 0x40;
-
-    HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, 0x80, PCD_SNG_BUF, pma_track);
-    pma_track += 0x40;
-
-#if (USBD_USE_CDC_RNDIS == 1)
-    HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, CDC_RNDIS_IN_EP, PCD_SNG_BUF, pma_track);
-    pma_track += 128;
-    HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, CDC_RNDIS_OUT_EP, PCD_SNG_BUF, pma_track);
-    pma_track += 128;
-    HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, CDC_RNDIS_CMD_EP, PCD_SNG_BUF, pma_track);
-    pma_track += 8;
-#endif
-#if (USBD_USE_CDC_ECM == 1)
-    HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, CDC_ECM_IN_EP, PCD_SNG_BUF, pma_track);
-    pma_track += 48;
-    HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, CDC_ECM_OUT_EP, PCD_SNG_BUF, pma_track);
-    pma_track += 48;
-    HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, CDC_ECM_CMD_EP, PCD_SNG_BUF, pma_track);
-    pma_track += 8;
-#endif
-#if (USBD_USE_HID_MOUSE == 1)
-    HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, HID_MOUSE_IN_EP, PCD_SNG_BUF, pma_track);
-    pma_track += 8;
-#endif
-#if (USBD_USE_HID_KEYBOARD == 1)
-    HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, HID_KEYBOARD_IN_EP, PCD_SNG_BUF, pma_track);
-    pma_track += 8;
-#endif
-#if (USBD_USE_HID_CUSTOM == 1)
-    HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, CUSTOM_HID_IN_EP, PCD_SNG_BUF, pma_track);
-    pma_track += 8;
-    HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, CUSTOM_HID_OUT_EP, PCD_SNG_BUF, pma_track);
-    pma_track += 8;
-#endif
-#if (USBD_USE_UAC_MIC == 1)
-    HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, AUDIO_MIC_EP, PCD_SNG_BUF, pma_track);
-    pma_track += 128;
-#endif
-#if (USBD_USE_UAC_SPKR == 1)
-    HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, AUDIO_SPKR_EP, PCD_SNG_BUF, pma_track);
-    pma_track += 128;
-#endif
-#if (USBD_USE_UVC == 1)
-    HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, UVC_IN_EP, PCD_SNG_BUF, pma_track);
-    pma_track += 128;
-#endif
-#if (USBD_USE_MSC == 1)
-    HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, MSC_IN_EP, PCD_SNG_BUF, pma_track);
-    pma_track += 128;
-    HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, MSC_OUT_EP, PCD_SNG_BUF, pma_track);
-    pma_track += 128;
-#endif
-#if (USBD_USE_DFU == 1)
-#endif
-#if (USBD_USE_PRNTR == 1)
-    HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, PRNT_IN_EP, PCD_SNG_BUF, pma_track);
-    pma_track += 128;
-    HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, PRNT_OUT_EP, PCD_SNG_BUF, pma_track);
-    pma_track += 128;
-#endif
-#if (USBD_USE_CDC_ACM == 1)
-    for (uint8_t i = 0; i < USBD_CDC_ACM_COUNT; i++)
-    {
-      HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, CDC_IN_EP[i], PCD_SNG_BUF, pma_track);
-      pma_track += 48;
+    pdev->pData = hpcd_USB_OTG_PTR;
 
-      HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, CDC_OUT_EP[i], PCD_SNG_BUF, pma_track);
-      pma_track += 48;
+    /* @see HAL_PCD_Init() usb_otg.c generated by cube **/
 
-      HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, CDC_CMD_EP[i], PCD_SNG_BUF, pma_track);
-      pma_track += 8;
-    }
-#endif
-#else /** if HAL_PCDEx_SetRxFiFo() is used by HAL driver */
+#if (STM32F1_DEVICE)
+    /** Device is F1 or similar or if HAL_PCDEx_PMAConfig() is used by HAL driver */
+    uint16_t pma_track = 0x40; /** PMA offset*/
 
-    HAL_PCDEx_SetRxFiFoInBytes(hpcd_USB_OTG_PTR, 512); // ALL OUT EP Buffer
+    HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, 0x00, PCD_SNG_BUF, pma_track);
+    pma_track += 0x40;
 
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, 0, 64); // EP0 IN
+    HAL_PCDEx_PMAConfig((PCD_HandleTypeDef *)pdev->pData, 0x80, PCD_SNG_BUF, pma_track);
+    pma_track += 0x40;
 
-#if (USBD_USE_CDC_RNDIS == 1)
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (CDC_RNDIS_IN_EP & 0x7F), 128);
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (CDC_RNDIS_CMD_EP & 0x7F), 64);
-#endif
+    USBD_LL_SetPMAs(pdev, pma_track);
+#else /** if HAL_PCDEx_SetRxFiFo() is used by HAL driver */
 
-#if (USBD_USE_CDC_ECM == 1)
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (CDC_ECM_IN_EP & 0x7F), 128);
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (CDC_ECM_CMD_EP & 0x7F), 64);
-#endif
-#if (USBD_USE_HID_MOUSE == 1)
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (HID_MOUSE_IN_EP & 0x7F), 64);
-#endif
-#if (USBD_USE_HID_KEYBOARD == 1)
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (HID_KEYBOARD_IN_EP & 0x7F), 64);
-#endif
-#if (USBD_USE_HID_CUSTOM == 1)
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (CUSTOM_HID_IN_EP & 0x7F), 64);
-#endif
-#if (USBD_USE_UAC_MIC == 1)
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (AUDIO_MIC_EP & 0x7F), 128);
-#endif
-#if (USBD_USE_UAC_SPKR == 1)
-#endif
-#if (USBD_USE_UVC == 1)
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (UVC_IN_EP & 0x7F), 128);
-#endif
-#if (USBD_USE_MSC == 1)
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (MSC_IN_EP & 0x7F), 128);
+    USBD_LL_SetFiFos(pdev, USBD_LL_FS_RX_FIFO_SIZE, USBD_LL_FS_FIFO_RAM_SIZE);
 #endif
-#if (USBD_USE_DFU == 1)
-#endif
-#if (USBD_USE_PRNTR == 1)
-    HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (PRNT_IN_EP & 0x7F), 128);
-#endif
-#if (USBD_USE_CDC_ACM == 1)
-    for (uint8_t i = 0; i < USBD_CDC_ACM_COUNT; i++)
-    {
-      HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (CDC_IN_EP[i] & 0x7F), 128);
-      HAL_PCDEx_SetTxFiFoInBytes(hpcd_USB_OTG_PTR, (CDC_CMD_EP[i] & 0x7F), 64);
-    }
+  }
 #endif
+
+#if ((USBD_USE_TIMEBASE == 1U) || (USBD_ENUM_TRACE == 1U) || (USBD_USE_CDC_BENCH == 1U) || \
+    (USBD_USE_CDC_FRAME == 1U)) && defined(DWT_BASE)
+  /* Start the cycle counter the timestamps are taken from */
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#if (__CORTEX_M == 7U)
+  DWT->LAR = 0xC5ACCE55U;
 #endif
-  }
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 #endif
 
+#if (USBD_LPM_ENABLED == 1U)
+  /* Answer L1 requests, USBD_LL_SetLPMAck turns the answer into NYET while busy */
+  HAL_PCDEx_ActivateLPM(hpcd_USB_OTG_PTR);
+#endif /* (USBD_LPM_ENABLED == 1U) */
+
 #if (USE_HAL_PCD_REGISTER_CALLBACKS == 1U)
   /* Register USB PCD CallBacks */
   HAL_PCD_RegisterCallback(hpcd_USB_OTG_PTR, HAL_PCD_SOF_CB_ID, PCD_SOFCallback);
@@ -510,6 +942,9 @@ USBD_StatusTypeDef USBD_LL_Init(USBD_HandleTypeDef *pdev)
   HAL_PCD_RegisterDataInStageCallback(hpcd_USB_OTG_PTR, PCD_DataInStageCallback);
   HAL_PCD_RegisterIsoOutIncpltCallback(hpcd_USB_OTG_PTR, PCD_ISOOUTIncompleteCallback);
   HAL_PCD_RegisterIsoInIncpltCallback(hpcd_USB_OTG_PTR, PCD_ISOINIncompleteCallback);
+#if (USBD_LPM_ENABLED == 1U)
+  HAL_PCD_RegisterLpmCallback(hpcd_USB_OTG_PTR, PCD_LPMCallback);
+#endif /* (USBD_LPM_ENABLED == 1U) */
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
   return USBD_OK;
 }
@@ -578,8 +1013,24 @@ USBD_StatusTypeDef USBD_LL_OpenEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uin
   HAL_StatusTypeDef hal_status = HAL_OK;
   USBD_StatusTypeDef usb_status = USBD_OK;
 
+#if (USBD_USE_GOVERNOR == 1U)
+  /* The clock is back at full speed before an isochronous stream starts */
+  if (ep_type == USBD_EP_TYPE_ISOC)
+  {
+    USBD_Gov_SetIso(pdev, ep_addr, 1U);
+  }
+#endif /* (USBD_USE_GOVERNOR == 1U) */
+
   hal_status = HAL_PCD_EP_Open(pdev->pData, ep_addr, ep_mps, ep_type);
 
+#if (USBD_LL_DEDICATED_EP1 == 1U)
+  /* The bulk endpoint the composite numbered first gets its own vector */
+  if ((hal_status == HAL_OK) && ((ep_addr & 0x7FU) == 1U) && (ep_type == USBD_EP_TYPE_BULK))
+  {
+    USBD_LL_EP1_Route((PCD_HandleTypeDef *)pdev->pData, ep_addr);
+  }
+#endif /* (USBD_LL_DEDICATED_EP1 == 1U) */
+
   usb_status = USBD_Get_USB_Status(hal_status);
 
   return usb_status;
@@ -598,6 +1049,15 @@ USBD_StatusTypeDef USBD_LL_CloseEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
 
   hal_status = HAL_PCD_EP_Close(pdev->pData, ep_addr);
 
+  if ((ep_addr & 0x80U) == 0x80U)
+  {
+    USBD_LL_TxV_Release(pdev->pData, ep_addr & 0xFU);
+  }
+
+#if (USBD_USE_GOVERNOR == 1U)
+  USBD_Gov_SetIso(pdev, ep_addr, 0U);
+#endif /* (USBD_USE_GOVERNOR == 1U) */
+
   usb_status = USBD_Get_USB_Status(hal_status);
 
   return usb_status;
@@ -616,6 +1076,11 @@ USBD_StatusTypeDef USBD_LL_FlushEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
 
   hal_status = HAL_PCD_EP_Flush(pdev->pData, ep_addr);
 
+  if ((ep_addr & 0x80U) == 0x80U)
+  {
+    USBD_LL_TxV_Release(pdev->pData, ep_addr & 0xFU);
+  }
+
   usb_status = USBD_Get_USB_Status(hal_status);
 
   return usb_status;
@@ -695,6 +1160,42 @@ USBD_StatusTypeDef USBD_LL_SetUSBAddress(USBD_HandleTypeDef *pdev, uint8_t dev_a
   return usb_status;
 }
 
+/**
+  * @brief  Set up the FIFOs (or the packet memory) of the core for the
+  *         configuration selected by the host, before the classes of the
+  *         configuration open their endpoints.
+  * @param  pdev: Device handle
+  * @param  cfgidx: Configuration value
+  * @retval USBD status
+  */
+USBD_StatusTypeDef USBD_LL_SetConfiguration(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
+{
+  PCD_HandleTypeDef *hpcd = (PCD_HandleTypeDef *)pdev->pData;
+
+  UNUSED(cfgidx);
+
+#if (!STM32F1_DEVICE)
+  /* Nothing of the previous configuration is left in the FIFOs */
+  (void)USB_FlushTxFifo(hpcd->Instance, 0x10U);
+
+  if (pdev->id == DEVICE_HS)
+  {
+    USBD_LL_SetFiFos(pdev, USBD_LL_HS_RX_FIFO_SIZE, USBD_LL_HS_FIFO_RAM_SIZE);
+  }
+  else
+  {
+    USBD_LL_SetFiFos(pdev, USBD_LL_FS_RX_FIFO_SIZE, USBD_LL_FS_FIFO_RAM_SIZE);
+  }
+#else
+  UNUSED(hpcd);
+
+  /* Past the 0x40 bytes of the BTABLE and the EP0 buffers */
+  USBD_LL_SetPMAs(pdev, 0xC0);
+#endif
+
+  return USBD_OK;
+}
+
 /**
   * @brief  Transmits data over an endpoint.
   * @param  pdev: Device handle
@@ -715,6 +1216,74 @@ USBD_StatusTypeDef USBD_LL_Transmit(USBD_HandleTypeDef *pdev, uint8_t ep_addr, u
   return usb_status;
 }
 
+/**
+  * @brief  Transmits a list of buffer segments as one transfer over an endpoint.
+  *         The segments are streamed packet by packet: every span that starts
+  *         on a packet boundary goes to the FIFO (or the OTG DMA) straight from
+  *         the caller memory, only a packet straddling two segments is put
+  *         together in a staging buffer. The stack sees a single DataIn event.
+  * @param  pdev: Device handle
+  * @param  ep_addr: Endpoint number
+  * @param  pseg: Segment list, copied so it may live on the caller stack
+  * @param  nseg: Number of segments, up to USBD_LL_TXV_MAX_SEGMENTS
+  * @retval USBD status
+  */
+USBD_StatusTypeDef USBD_LL_TransmitV(USBD_HandleTypeDef *pdev, uint8_t ep_addr, USBD_SegmentTypeDef *pseg, uint8_t nseg)
+{
+  PCD_HandleTypeDef *hpcd = (PCD_HandleTypeDef *)pdev->pData;
+  USBD_LL_TxVTypeDef *ptxv = NULL;
+  USBD_StatusTypeDef usb_status;
+  uint32_t primask;
+
+  if ((nseg == 0U) || (nseg > USBD_LL_TXV_MAX_SEGMENTS) ||
+      (hpcd->IN_ep[ep_addr & 0xFU].maxpacket > USBD_LL_TXV_STAGE_SIZE))
+  {
+    return USBD_FAIL;
+  }
+
+  if (nseg == 1U)
+  {
+    return USBD_LL_Transmit(pdev, ep_addr, pseg[0].pbuf, pseg[0].length);
+  }
+
+  /* A new transfer on the endpoint ends whatever it had in flight */
+  USBD_LL_TxV_Release(hpcd, ep_addr & 0xFU);
+
+  USBD_ENTER_CRITICAL(primask);
+
+  for (uint8_t i = 0U; i < USBD_LL_TXV_CHANNELS; i++)
+  {
+    if (USBD_LL_TxV[i].hpcd == NULL)
+    {
+      ptxv = &USBD_LL_TxV[i];
+      ptxv->hpcd = hpcd;
+      break;
+    }
+  }
+
+  USBD_EXIT_CRITICAL(primask);
+
+  if (ptxv == NULL)
+  {
+    return USBD_BUSY;
+  }
+
+  (void)USBD_memcpy(ptxv->seg, pseg, nseg * sizeof(USBD_SegmentTypeDef));
+  ptxv->nseg = nseg;
+  ptxv->idx = 0U;
+  ptxv->offset = 0U;
+  ptxv->ep_addr = ep_addr | 0x80U;
+
+  usb_status = USBD_LL_TxV_Next(ptxv);
+
+  if (usb_status != USBD_OK)
+  {
+    ptxv->hpcd = NULL;
+  }
+
+  return usb_status;
+}
+
 /**
   * @brief  Prepares an endpoint for reception.
   * @param  pdev: Device handle
@@ -756,6 +1325,320 @@ void USBD_LL_Delay(uint32_t Delay)
   HAL_Delay(Delay);
 }
 
+#if (USBD_LPM_ENABLED == 1U)
+/**
+  * @brief  Accepts or rejects the host L1 requests.
+  * @param  pdev: Device handle
+  * @param  ack: 1 to ACK the LPM token, 0 to answer NYET
+  * @retval USBD status
+  */
+USBD_StatusTypeDef USBD_LL_SetLPMAck(USBD_HandleTypeDef *pdev, uint8_t ack)
+{
+  PCD_HandleTypeDef *hpcd = (PCD_HandleTypeDef *)pdev->pData;
+
+#if (!STM32F1_DEVICE) && defined(USB_OTG_GLPMCFG_LPMACK)
+  if (ack != 0U)
+  {
+    hpcd->Instance->GLPMCFG |= USB_OTG_GLPMCFG_LPMACK;
+  }
+  else
+  {
+    hpcd->Instance->GLPMCFG &= ~USB_OTG_GLPMCFG_LPMACK;
+  }
+#elif defined(USB_LPMCSR_LPMACK)
+  if (ack != 0U)
+  {
+    hpcd->Instance->LPMCSR |= USB_LPMCSR_LPMACK;
+  }
+  else
+  {
+    hpcd->Instance->LPMCSR &= (uint16_t)~USB_LPMCSR_LPMACK;
+  }
+#else
+  UNUSED(hpcd);
+  UNUSED(ack);
+#endif
+
+  return USBD_OK;
+}
+#endif /* (USBD_LPM_ENABLED == 1U) */
+
+#if (USBD_USE_TIMEBASE == 1U)
+/**
+  * @brief  Returns the number of the current (micro)frame.
+  * @param  pdev: Device handle
+  * @retval 14-bit frame number in microframe units, a full speed frame
+  *         counts as 8 microframes
+  */
+uint32_t USBD_LL_GetFrameNumber(USBD_HandleTypeDef *pdev)
+{
+  PCD_HandleTypeDef *hpcd = (PCD_HandleTypeDef *)pdev->pData;
+  uint32_t frame;
+
+#if (STM32F1_DEVICE)
+  frame = (hpcd->Instance->FNR & USB_FNR_FN) << 3;
+#else
+  USB_OTG_DeviceTypeDef *pdevice = (USB_OTG_DeviceTypeDef *)((uint32_t)hpcd->Instance + USB_OTG_DEVICE_BASE);
+
+  frame = (pdevice->DSTS & USB_OTG_DSTS_FNSOF_Msk) >> USB_OTG_DSTS_FNSOF_Pos;
+
+  /* At full speed FNSOF holds the 11-bit frame number, at high speed the
+     frame number followed by the microframe number */
+  if (pdev->dev_speed != USBD_SPEED_HIGH)
+  {
+    frame <<= 3;
+  }
+#endif
+
+  return frame & 0x3FFFU;
+}
+#endif /* (USBD_USE_TIMEBASE == 1U) */
+
+#if (USBD_USE_TIMEBASE == 1U) || (USBD_ENUM_TRACE == 1U) || (USBD_USE_CDC_BENCH == 1U) || \
+    (USBD_USE_CDC_FRAME == 1U)
+/**
+  * @brief  Returns the free running counter the time base and the
+  *         enumeration trace are built on.
+  * @retval Counter value, USBD_LL_GetTimestampFreq ticks per second
+  */
+uint32_t USBD_LL_GetTimestamp(void)
+{
+#if defined(DWT_BASE)
+  return DWT->CYCCNT;
+#else
+  /* No cycle counter on this core, extend the HAL tick with SysTick */
+  uint32_t tick = HAL_GetTick();
+  uint32_t val = SysTick->VAL;
+
+  if (tick != HAL_GetTick())
+  {
+    tick = HAL_GetTick();
+    val = SysTick->VAL;
+  }
+
+  return ((tick / (uint32_t)uwTickFreq) * (SysTick->LOAD + 1U)) + (SysTick->LOAD - val);
+#endif
+}
+
+/**
+  * @brief  Returns the frequency of USBD_LL_GetTimestamp.
+  * @retval Frequency in Hz
+  */
+uint32_t USBD_LL_GetTimestampFreq(void)
+{
+#if defined(DWT_BASE)
+  return SystemCoreClock;
+#else
+  return (SysTick->LOAD + 1U) * (1000U / (uint32_t)uwTickFreq);
+#endif
+}
+#endif /* (USBD_USE_TIMEBASE == 1U) || (USBD_ENUM_TRACE == 1U) || (USBD_USE_CDC_BENCH == 1U) || (USBD_USE_CDC_FRAME == 1U) */
+
+#if (USBD_USE_GOVERNOR == 1U)
+/**
+  * @brief  Set the core clock to a performance level of the governor, each
+  *         level halves the system clock divider output. Flash wait states
+  *         and voltage scaling are set for the full clock and stay valid at
+  *         a lower one. Peripherals clocked from the bus clocks see their
+  *         clock change too, give them a kernel clock of their own. A level
+  *         taking the AHB clock below the minimum of the USB core is refused.
+  * @param  level: 0 for full speed, up to USBD_GOV_MAX_LEVEL
+  * @retval USBD status
+  */
+USBD_StatusTypeDef USBD_LL_SetPerfLevel(uint8_t level)
+{
+#if defined(RCC_D1CFGR_D1CPRE) || defined(RCC_CDCFGR1_CDCPRE)
+  static const uint32_t div[] = {RCC_SYSCLK_DIV1, RCC_SYSCLK_DIV2, RCC_SYSCLK_DIV4, RCC_SYSCLK_DIV8};
+  static uint8_t applied;
+#if defined(USB_OTG_HS)
+  uint32_t hclk_min = USBD_LL_HS_HCLK_MIN;
+#else
+  uint32_t hclk_min = USBD_LL_FS_HCLK_MIN;
+#endif
+
+  if (level >= (sizeof(div) / sizeof(div[0])))
+  {
+    return USBD_FAIL;
+  }
+
+  /* AHB clock at full speed, times the level applied now */
+  if (((HAL_RCC_GetHCLKFreq() << applied) >> level) < hclk_min)
+  {
+    return USBD_FAIL;
+  }
+
+#if defined(RCC_D1CFGR_D1CPRE)
+  MODIFY_REG(RCC->D1CFGR, RCC_D1CFGR_D1CPRE, div[level]);
+#else
+  MODIFY_REG(RCC->CDCFGR1, RCC_CDCFGR1_CDCPRE, div[level]);
+#endif
+
+  applied = level;
+
+  /* HAL_Delay and the HAL time base follow the new clock */
+  SystemCoreClockUpdate();
+
+  return USBD_Get_USB_Status(HAL_InitTick(uwTickPrio));
+#else
+  /* No clock step on this family, the core stays at full speed */
+  return (level == 0U) ? USBD_OK : USBD_FAIL;
+#endif
+}
+#endif /* (USBD_USE_GOVERNOR == 1U) */
+
+/**
+  * @brief  Start the next chunk of a scatter-gather transfer.
+  * @param  ptxv: Scatter-gather context
+  * @retval USBD status
+  */
+static USBD_StatusTypeDef USBD_LL_TxV_Next(USBD_LL_TxVTypeDef *ptxv)
+{
+  PCD_HandleTypeDef *hpcd = ptxv->hpcd;
+  uint32_t mps = hpcd->IN_ep[ptxv->ep_addr & 0xFU].maxpacket;
+  USBD_SegmentTypeDef *pseg;
+  uint8_t *pbuf;
+  uint32_t len;
+  uint32_t rem;
+  uint8_t last = 1U;
+
+  /* Skip consumed and empty segments */
+  while ((ptxv->idx < ptxv->nseg) && (ptxv->offset >= ptxv->seg[ptxv->idx].length))
+  {
+    ptxv->idx++;
+    ptxv->offset = 0U;
+  }
+
+  if (ptxv->idx == ptxv->nseg)
+  {
+    /* Nothing at all to send, terminate the transfer with a ZLP */
+    return USBD_Get_USB_Status(HAL_PCD_EP_Transmit(hpcd, ptxv->ep_addr, NULL, 0U));
+  }
+
+  pseg = &ptxv->seg[ptxv->idx];
+  pbuf = pseg->pbuf + ptxv->offset;
+  rem = pseg->length - ptxv->offset;
+
+  for (uint8_t i = ptxv->idx + 1U; i < ptxv->nseg; i++)
+  {
+    if (ptxv->seg[i].length != 0U)
+    {
+      last = 0U;
+    }
+  }
+
+#if (!STM32F1_DEVICE)
+  /* The OTG internal DMA only reads from word aligned addresses */
+  if ((hpcd->Init.dma_enable == 1U) && (((uint32_t)pbuf & 0x3U) != 0U))
+  {
+    rem = 0U;
+    last = 0U;
+  }
+#endif
+
+  if (last != 0U)
+  {
+    /* Tail of the transfer, short packet included */
+    len = rem;
+    ptxv->offset += len;
+  }
+  else if (rem >= mps)
+  {
+    /* Whole packets straight from the segment */
+    len = rem - (rem % mps);
+    ptxv->offset += len;
+  }
+  else
+  {
+    /* Assemble the packet straddling segment boundaries */
+    uint8_t *pstage = (uint8_t *)ptxv->stage;
+
+    pbuf = pstage;
+    len = 0U;
+
+    while ((len < mps) && (ptxv->idx < ptxv->nseg))
+    {
+      uint32_t n;
+
+      pseg = &ptxv->seg[ptxv->idx];
+      n = MIN(pseg->length - ptxv->offset, mps - len);
+
+      (void)USBD_memcpy(pstage + len, pseg->pbuf + ptxv->offset, n);
+      len += n;
+      ptxv->offset += n;
+
+      if (ptxv->offset >= pseg->length)
+      {
+        ptxv->idx++;
+        ptxv->offset = 0U;
+      }
+    }
+  }
+
+  return USBD_Get_USB_Status(HAL_PCD_EP_Transmit(hpcd, ptxv->ep_addr, pbuf, len));
+}
+
+/**
+  * @brief  Continue a scatter-gather transfer on IN completion.
+  * @param  hpcd: PCD handle
+  * @param  epnum: Endpoint number
+  * @retval 1 when the transfer goes on, 0 when the stack has to be notified
+  */
+static uint8_t USBD_LL_TxV_DataIn(PCD_HandleTypeDef *hpcd, uint8_t epnum)
+{
+  for (uint8_t i = 0U; i < USBD_LL_TXV_CHANNELS; i++)
+  {
+    USBD_LL_TxVTypeDef *ptxv = &USBD_LL_TxV[i];
+
+    if ((ptxv->hpcd == hpcd) && ((ptxv->ep_addr & 0xFU) == epnum))
+    {
+      while ((ptxv->idx < ptxv->nseg) && (ptxv->offset >= ptxv->seg[ptxv->idx].length))
+      {
+        ptxv->idx++;
+        ptxv->offset = 0U;
+      }
+
+      if ((ptxv->idx < ptxv->nseg) && (USBD_LL_TxV_Next(ptxv) == USBD_OK))
+      {
+        return 1U;
+      }
+
+      /* Last chunk sent, or the next one refused: release the context and
+         complete the transfer as it is */
+      ptxv->hpcd = NULL;
+      return 0U;
+    }
+  }
+
+  return 0U;
+}
+
+/**
+  * @brief  Release the scatter-gather contexts of an endpoint, or of every
+  *         endpoint of a core, whose transfer will never complete.
+  * @param  hpcd: PCD handle
+  * @param  epnum: Endpoint number, USBD_LL_TXV_EP_ALL for every endpoint
+  * @retval None
+  */
+static void USBD_LL_TxV_Release(PCD_HandleTypeDef *hpcd, uint8_t epnum)
+{
+  uint32_t primask;
+
+  USBD_ENTER_CRITICAL(primask);
+
+  for (uint8_t i = 0U; i < USBD_LL_TXV_CHANNELS; i++)
+  {
+    USBD_LL_TxVTypeDef *ptxv = &USBD_LL_TxV[i];
+
+    if ((ptxv->hpcd == hpcd) &&
+        ((epnum == USBD_LL_TXV_EP_ALL) || ((ptxv->ep_addr & 0xFU) == epnum)))
+    {
+      ptxv->hpcd = NULL;
+    }
+  }
+
+  USBD_EXIT_CRITICAL(primask);
+}
+
 /**
   * @brief  Retuns the USB status depending on the HAL status:
   * @param  hal_status: HAL status
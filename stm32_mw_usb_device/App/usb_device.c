@@ -26,8 +26,19 @@
 
 /* USER CODE BEGIN Includes */
 #include "usbd_composite.h"
+#include "usbd_ipc_if.h"
 /* USER CODE END Includes */
 
+/* USER CODE BEGIN PD */
+#if (USBD_MAX_NUM_CONFIGURATION > 1U)
+/* Configuration 1 streams audio and video next to a lean bulk set,
+   configuration 2 has no isochronous interface and gives the FIFO memory to
+   the network and storage classes. Classes not listed are in both */
+#define USB_DEVICE_CFG_STREAMING  0x01U
+#define USB_DEVICE_CFG_DATA       0x02U
+#endif
+/* USER CODE END PD */
+
 /* USER CODE BEGIN PV */
 /* Private variables ---------------------------------------------------------*/
 
@@ -40,6 +51,12 @@
 
 /* USB Device Core handle declaration. */
 USBD_HandleTypeDef hUsbDevice;
+#if (USBD_MAX_NUM_DEV > 1U)
+/* Second handle, runs the same class set on the HS core */
+USBD_HandleTypeDef hUsbDeviceHS;
+#endif
+
+static void USB_DEVICE_Start(USBD_HandleTypeDef *pdev, uint8_t id);
 
 /*
  * -- Insert your variables declaration here --
@@ -65,96 +82,200 @@ void MX_USB_DEVICE_Init(void)
 
   /* USER CODE END USB_DEVICE_Init_PreTreatment */
 
+#if (USBD_USE_IPC == 1U)
+  /* The class interfaces run on the other core */
+  USBD_IPC_IF_StackInit(&hUsbDevice);
+#endif
+
   /* Init Device Library, add supported class and start the library. */
-  USBD_COMPOSITE_Mount_Class();
+#if (USBD_MAX_NUM_DEV > 1U)
+  USB_DEVICE_Start(&hUsbDevice, DEVICE_FS);
+  USB_DEVICE_Start(&hUsbDeviceHS, DEVICE_HS);
+#elif (USBD_USE_HS == 1)
+  USB_DEVICE_Start(&hUsbDevice, DEVICE_HS);
+#else
+  USB_DEVICE_Start(&hUsbDevice, DEVICE_FS);
+#endif
+
+  /* USER CODE BEGIN USB_DEVICE_Init_PostTreatment */
 
-#if (USBD_USE_HS == 1)
-  if (USBD_Init(&hUsbDevice, &USBD_Desc, DEVICE_HS) != USBD_OK)
+  /* USER CODE END USB_DEVICE_Init_PostTreatment */
+}
+
+/**
+  * Init one device handle on a core, add supported class and start it
+  * @param  pdev: device handle
+  * @param  id: DEVICE_FS or DEVICE_HS
+  * @retval None
+  */
+static void USB_DEVICE_Start(USBD_HandleTypeDef *pdev, uint8_t id)
+{
+  /* Each class instance is added to the registry then bound to its user
+     interface, the order sets the interfaces and endpoints it gets */
+#if (USBD_USE_CDC_RNDIS == 1)
+  if (USBD_COMPOSITE_AddClass(pdev, &USBD_CDC_RNDIS) != USBD_OK)
   {
     Error_Handler();
   }
+#if (USBD_MAX_NUM_CONFIGURATION > 1U)
+  (void)USBD_COMPOSITE_SetConfigs(pdev, USB_DEVICE_CFG_DATA);
+#endif
+#if (USBD_LL_DEDICATED_EP1 == 1U)
+  (void)USBD_COMPOSITE_SetDedicated(pdev);
+#endif
+#if (USBD_USE_IPC == 1U)
+  if (USBD_CDC_RNDIS_RegisterInterface(pdev, &USBD_IPC_CDC_RNDIS_fops) != USBD_OK)
 #else
-  if (USBD_Init(&hUsbDevice, &USBD_Desc, DEVICE_FS) != USBD_OK)
+  if (USBD_CDC_RNDIS_RegisterInterface(pdev, &USBD_CDC_RNDIS_fops) != USBD_OK)
+#endif
   {
     Error_Handler();
   }
 #endif
-  if (USBD_RegisterClass(&hUsbDevice, &USBD_COMPOSITE) != USBD_OK)
+#if (USBD_USE_CDC_ECM == 1)
+  if (USBD_COMPOSITE_AddClass(pdev, &USBD_CDC_ECM) != USBD_OK)
   {
     Error_Handler();
   }
-#if (USBD_USE_CDC_ACM == 1)
-  if (USBD_CDC_ACM_RegisterInterface(&hUsbDevice, &USBD_CDC_ACM_fops) != USBD_OK)
+#if (USBD_MAX_NUM_CONFIGURATION > 1U)
+  (void)USBD_COMPOSITE_SetConfigs(pdev, USB_DEVICE_CFG_DATA);
+#endif
+  if (USBD_CDC_ECM_RegisterInterface(pdev, &USBD_CDC_ECM_fops) != USBD_OK)
   {
     Error_Handler();
   }
 #endif
-#if (USBD_USE_CDC_RNDIS == 1)
-  if (USBD_CDC_RNDIS_RegisterInterface(&hUsbDevice, &USBD_CDC_RNDIS_fops) != USBD_OK)
+#if (USBD_USE_HID_MOUSE == 1)
+  if (USBD_COMPOSITE_AddClass(pdev, &USBD_HID_MOUSE) != USBD_OK)
   {
     Error_Handler();
   }
 #endif
-#if (USBD_USE_CDC_ECM == 1)
-  if (USBD_CDC_ECM_RegisterInterface(&hUsbDevice, &USBD_CDC_ECM_fops) != USBD_OK)
+#if (USBD_USE_HID_KEYBOARD == 1)
+  if (USBD_COMPOSITE_AddClass(pdev, &USBD_HID_KEYBOARD) != USBD_OK)
   {
     Error_Handler();
   }
 #endif
-#if (USBD_USE_HID_MOUSE == 1)
-#endif
-#if (USBD_USE_HID_KEYBOARD == 1)
-#endif
 #if (USBD_USE_HID_CUSTOM == 1)
-  if (USBD_CUSTOM_HID_RegisterInterface(&hUsbDevice, &USBD_CustomHID_fops) != USBD_OK)
+  if (USBD_COMPOSITE_AddClass(pdev, &USBD_HID_CUSTOM) != USBD_OK)
+  {
+    Error_Handler();
+  }
+  if (USBD_CUSTOM_HID_RegisterInterface(pdev, &USBD_CustomHID_fops) != USBD_OK)
   {
     Error_Handler();
   }
 #endif
 #if (USBD_USE_UAC_MIC == 1)
-  if (USBD_AUDIO_MIC_RegisterInterface(&hUsbDevice, &USBD_AUDIO_MIC_fops_FS) != USBD_OK)
+  if (USBD_COMPOSITE_AddClass(pdev, &USBD_AUDIO_MIC) != USBD_OK)
+  {
+    Error_Handler();
+  }
+#if (USBD_MAX_NUM_CONFIGURATION > 1U)
+  (void)USBD_COMPOSITE_SetConfigs(pdev, USB_DEVICE_CFG_STREAMING);
+#endif
+  if (USBD_AUDIO_MIC_RegisterInterface(pdev, &USBD_AUDIO_MIC_fops_FS) != USBD_OK)
   {
     Error_Handler();
   }
 #endif
 #if (USBD_USE_UAC_SPKR == 1)
-  if (USBD_AUDIO_SPKR_RegisterInterface(&hUsbDevice, &USBD_AUDIO_SPKR_fops) != USBD_OK)
+  if (USBD_COMPOSITE_AddClass(pdev, &USBD_AUDIO_SPKR) != USBD_OK)
+  {
+    Error_Handler();
+  }
+#if (USBD_MAX_NUM_CONFIGURATION > 1U)
+  (void)USBD_COMPOSITE_SetConfigs(pdev, USB_DEVICE_CFG_STREAMING);
+#endif
+  if (USBD_AUDIO_SPKR_RegisterInterface(pdev, &USBD_AUDIO_SPKR_fops) != USBD_OK)
   {
     Error_Handler();
   }
 #endif
 #if (USBD_USE_UVC == 1)
-  if (USBD_VIDEO_RegisterInterface(&hUsbDevice, &USBD_VIDEO_fops_FS) != USBD_OK)
+  if (USBD_COMPOSITE_AddClass(pdev, &USBD_VIDEO) != USBD_OK)
+  {
+    Error_Handler();
+  }
+#if (USBD_MAX_NUM_CONFIGURATION > 1U)
+  (void)USBD_COMPOSITE_SetConfigs(pdev, USB_DEVICE_CFG_STREAMING);
+#endif
+  if (USBD_VIDEO_RegisterInterface(pdev, &USBD_VIDEO_fops_FS) != USBD_OK)
   {
     Error_Handler();
   }
 #endif
 #if (USBD_USE_MSC == 1)
-  if (USBD_MSC_RegisterStorage(&hUsbDevice, &USBD_Storage_Interface_fops) != USBD_OK)
+  if (USBD_COMPOSITE_AddClass(pdev, &USBD_MSC) != USBD_OK)
+  {
+    Error_Handler();
+  }
+#if (USBD_MAX_NUM_CONFIGURATION > 1U)
+  (void)USBD_COMPOSITE_SetConfigs(pdev, USB_DEVICE_CFG_DATA);
+#endif
+#if (USBD_LL_DEDICATED_EP1 == 1U) && (USBD_USE_CDC_RNDIS == 0)
+  /* Storage takes EP1 when there is no network link */
+  (void)USBD_COMPOSITE_SetDedicated(pdev);
+#endif
+#if (USBD_USE_IPC == 1U)
+  if (USBD_MSC_RegisterStorage(pdev, &USBD_IPC_Storage_fops) != USBD_OK)
+#else
+  if (USBD_MSC_RegisterStorage(pdev, &USBD_Storage_Interface_fops) != USBD_OK)
+#endif
   {
     Error_Handler();
   }
 #endif
 #if (USBD_USE_DFU == 1)
-  if (USBD_DFU_RegisterMedia(&hUsbDevice, &USBD_DFU_fops) != USBD_OK)
+  if (USBD_COMPOSITE_AddClass(pdev, &USBD_DFU) != USBD_OK)
+  {
+    Error_Handler();
+  }
+  if (USBD_DFU_RegisterMedia(pdev, &USBD_DFU_fops) != USBD_OK)
   {
     Error_Handler();
   }
 #endif
 #if (USBD_USE_PRNTR == 1)
-  if (USBD_PRNT_RegisterInterface(&hUsbDevice, &USBD_PRNT_fops) != USBD_OK)
+  if (USBD_COMPOSITE_AddClass(pdev, &USBD_PRNT) != USBD_OK)
   {
     Error_Handler();
   }
+  if (USBD_PRNT_RegisterInterface(pdev, &USBD_PRNT_fops) != USBD_OK)
+  {
+    Error_Handler();
+  }
+#endif
+#if (USBD_USE_CDC_ACM == 1)
+  if (USBD_COMPOSITE_AddClass(pdev, &USBD_CDC_ACM) != USBD_OK)
+  {
+    Error_Handler();
+  }
+#if (USBD_USE_IPC == 1U)
+  if (USBD_CDC_ACM_RegisterInterface(pdev, &USBD_IPC_CDC_ACM_fops) != USBD_OK)
+#else
+  if (USBD_CDC_ACM_RegisterInterface(pdev, &USBD_CDC_ACM_fops) != USBD_OK)
 #endif
-  if (USBD_Start(&hUsbDevice) != USBD_OK)
   {
     Error_Handler();
   }
+#endif
 
-  /* USER CODE BEGIN USB_DEVICE_Init_PostTreatment */
+  USBD_COMPOSITE_Mount_Class(pdev, id);
 
-  /* USER CODE END USB_DEVICE_Init_PostTreatment */
+  if (USBD_Init(pdev, &USBD_Desc, id) != USBD_OK)
+  {
+    Error_Handler();
+  }
+  if (USBD_RegisterClass(pdev, &USBD_COMPOSITE) != USBD_OK)
+  {
+    Error_Handler();
+  }
+  if (USBD_Start(pdev) != USBD_OK)
+  {
+    Error_Handler();
+  }
 }
 
 /**
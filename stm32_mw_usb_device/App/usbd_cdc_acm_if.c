@@ -23,8 +23,15 @@
 #include "usbd_cdc_acm_if.h"
 
 /* USER CODE BEGIN INCLUDE */
-//#include "usart.h"
-//#include "tim.h"
+#if (USBD_USE_CDC_BRIDGE == 1U)
+#include "usbd_cdc_bridge.h"
+#endif /* (USBD_USE_CDC_BRIDGE == 1U) */
+#if (USBD_USE_CDC_BENCH == 1U)
+#include "usbd_cdc_bench.h"
+#endif /* (USBD_USE_CDC_BENCH == 1U) */
+#if (USBD_USE_CDC_FRAME == 1U)
+#include "usbd_cdc_frame.h"
+#endif /* (USBD_USE_CDC_FRAME == 1U) */
 /* USER CODE END INCLUDE */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -90,20 +97,8 @@
 
 /* USER CODE BEGIN PRIVATE_VARIABLES */
 
-#define APP_RX_DATA_SIZE 128
-#define APP_TX_DATA_SIZE 128
-
-/** RX buffer for USB */
-uint8_t RX_Buffer[NUMBER_OF_CDC][APP_RX_DATA_SIZE];
-
-/** TX buffer for USB, RX buffer for UART */
-uint8_t TX_Buffer[NUMBER_OF_CDC][APP_TX_DATA_SIZE];
-
 USBD_CDC_ACM_LineCodingTypeDef Line_Coding[NUMBER_OF_CDC];
 
-uint32_t Write_Index[NUMBER_OF_CDC]; /* keep track of received data over UART */
-uint32_t Read_Index[NUMBER_OF_CDC];  /* keep track of sent data to USB */
-
 /* USER CODE END PRIVATE_VARIABLES */
 
 /**
@@ -137,134 +132,7 @@ static int8_t CDC_Receive(uint8_t cdc_ch, uint8_t *pbuf, uint32_t *Len);
 static int8_t CDC_TransmitCplt(uint8_t cdc_ch, uint8_t *Buf, uint32_t *Len, uint8_t epnum);
 
 /* USER CODE BEGIN PRIVATE_FUNCTIONS_DECLARATION */
-//UART_HandleTypeDef *CDC_CH_To_UART_Handle(uint8_t cdc_ch)
-//{
-//  UART_HandleTypeDef *handle = NULL;
-//
-//  if (cdc_ch == 0)
-//  {
-//    handle = &huart1;
-//  }
-//#if (0)
-//  else if (cdc_ch == 1)
-//  {
-//    handle = &huart2;
-//  }
-//  else if (cdc_ch == 2)
-//  {
-//    handle = &huart3;
-//  }
-//#endif
-//  return handle;
-//}
-//
-//uint8_t UART_Handle_TO_CDC_CH(UART_HandleTypeDef *handle)
-//{
-//  uint8_t cdc_ch = 0;
-//
-//  if (handle == &huart1)
-//  {
-//    cdc_ch = 0;
-//  }
-//#if (0)
-//  else if (handle == &huart2)
-//  {
-//    cdc_ch = 1;
-//  }
-//  else if (handle == &huart3)
-//  {
-//    cdc_ch = 2;
-//  }
-//#endif
-//  return cdc_ch;
-//}
-//
-//void Change_UART_Setting(uint8_t cdc_ch)
-//{
-//  UART_HandleTypeDef *handle = CDC_CH_To_UART_Handle(cdc_ch);
-//
-//  if (HAL_UART_DeInit(handle) != HAL_OK)
-//  {
-//    /* Initialization Error */
-//    Error_Handler();
-//  }
-//  /* set the Stop bit */
-//  switch (Line_Coding[cdc_ch].format)
-//  {
-//  case 0:
-//    handle->Init.StopBits = UART_STOPBITS_1;
-//    break;
-//  case 2:
-//    handle->Init.StopBits = UART_STOPBITS_2;
-//    break;
-//  default:
-//    handle->Init.StopBits = UART_STOPBITS_1;
-//    break;
-//  }
-//
-//  /* set the parity bit*/
-//  switch (Line_Coding[cdc_ch].paritytype)
-//  {
-//  case 0:
-//    handle->Init.Parity = UART_PARITY_NONE;
-//    break;
-//  case 1:
-//    handle->Init.Parity = UART_PARITY_ODD;
-//    break;
-//  case 2:
-//    handle->Init.Parity = UART_PARITY_EVEN;
-//    break;
-//  default:
-//    handle->Init.Parity = UART_PARITY_NONE;
-//    break;
-//  }
-//
-//  /*set the data type : only 8bits and 9bits is supported */
-//  switch (Line_Coding[cdc_ch].datatype)
-//  {
-//  case 0x07:
-//    /* With this configuration a parity (Even or Odd) must be set */
-//    handle->Init.WordLength = UART_WORDLENGTH_8B;
-//    break;
-//  case 0x08:
-//    if (handle->Init.Parity == UART_PARITY_NONE)
-//    {
-//      handle->Init.WordLength = UART_WORDLENGTH_8B;
-//    }
-//    else
-//    {
-//      handle->Init.WordLength = UART_WORDLENGTH_9B;
-//    }
-//
-//    break;
-//  default:
-//    handle->Init.WordLength = UART_WORDLENGTH_8B;
-//    break;
-//  }
-//
-//  if (Line_Coding[cdc_ch].bitrate == 0)
-//  {
-//    Line_Coding[cdc_ch].bitrate = 115200;
-//  }
-//
-//  handle->Init.BaudRate = Line_Coding[cdc_ch].bitrate;
-//  handle->Init.HwFlowCtl = UART_HWCONTROL_NONE;
-//  handle->Init.Mode = UART_MODE_TX_RX;
-//  handle->Init.OverSampling = UART_OVERSAMPLING_16;
-//
-//  if (HAL_UART_Init(handle) != HAL_OK)
-//  {
-//    /* Initialization Error */
-//    Error_Handler();
-//  }
-//
-//  /** rx for uart and tx buffer of usb */
-//  if (HAL_UART_Receive_IT(handle, TX_Buffer[cdc_ch], 1) != HAL_OK)
-//  {
-//    /* Transfer error in reception process */
-//    Error_Handler();
-//  }
-//}
+
 /* USER CODE END PRIVATE_FUNCTIONS_DECLARATION */
 
 /**
@@ -286,16 +154,20 @@ static int8_t CDC_Init(uint8_t cdc_ch)
 {
   /* USER CODE BEGIN 3 */
 
-  /* ##-1- Set Application Buffers */
-  USBD_CDC_SetRxBuffer(cdc_ch, &hUsbDevice, RX_Buffer[cdc_ch]);
-
-  //  /*##-2- Start the TIM Base generation in interrupt mode ####################*/
-  //  /* Start Channel1 */
-  //  if (HAL_TIM_Base_Start_IT(&htim4) != HAL_OK)
-  //  {
-  //    /* Starting Error */
-  //    Error_Handler();
-  //  }
+  /* ##-1- Received data comes in the buffers of the class pool */
+#if (USBD_USE_CDC_BRIDGE == 1U)
+  /* ##-2- Start the UART bridge of the channel, if one is attached */
+  USBD_CDC_Bridge_Init(cdc_ch);
+#endif /* (USBD_USE_CDC_BRIDGE == 1U) */
+#if (USBD_USE_CDC_BENCH == 1U)
+  /* ##-3- A benchmark channel waits for the command of the host */
+  USBD_CDC_Bench_Init(cdc_ch);
+#endif /* (USBD_USE_CDC_BENCH == 1U) */
+#if (USBD_USE_CDC_FRAME == 1U)
+  /* ##-4- A framed channel starts from sequence number 0 */
+  USBD_CDC_Frame_Init(cdc_ch);
+#endif /* (USBD_USE_CDC_FRAME == 1U) */
+  UNUSED(cdc_ch);
 
   return (USBD_OK);
   /* USER CODE END 3 */
@@ -308,12 +180,17 @@ static int8_t CDC_Init(uint8_t cdc_ch)
 static int8_t CDC_DeInit(uint8_t cdc_ch)
 {
   /* USER CODE BEGIN 4 */
-  /* DeInitialize the UART peripheral */
-  //  if (HAL_UART_DeInit(CDC_CH_To_UART_Handle(cdc_ch)) != HAL_OK)
-  //  {
-  //    /* Initialization Error */
-  //    Error_Handler();
-  //  }
+#if (USBD_USE_CDC_BRIDGE == 1U)
+  /* Stop the UART bridge, the UART keeps its configuration */
+  USBD_CDC_Bridge_DeInit(cdc_ch);
+#endif /* (USBD_USE_CDC_BRIDGE == 1U) */
+#if (USBD_USE_CDC_BENCH == 1U)
+  USBD_CDC_Bench_DeInit(cdc_ch);
+#endif /* (USBD_USE_CDC_BENCH == 1U) */
+#if (USBD_USE_CDC_FRAME == 1U)
+  USBD_CDC_Frame_DeInit(cdc_ch);
+#endif /* (USBD_USE_CDC_FRAME == 1U) */
+  UNUSED(cdc_ch);
   return (USBD_OK);
   /* USER CODE END 4 */
 }
@@ -374,7 +251,10 @@ static int8_t CDC_Control(uint8_t cdc_ch, uint8_t cmd, uint8_t *pbuf, uint16_t l
     Line_Coding[cdc_ch].paritytype = pbuf[5];
     Line_Coding[cdc_ch].datatype = pbuf[6];
 
-    //Change_UART_Setting(cdc_ch);
+#if (USBD_USE_CDC_BRIDGE == 1U)
+    /* Applied to the UART once the data received before is sent */
+    USBD_CDC_Bridge_SetLineCoding(cdc_ch, &Line_Coding[cdc_ch]);
+#endif /* (USBD_USE_CDC_BRIDGE == 1U) */
     break;
 
   case CDC_GET_LINE_CODING:
@@ -388,7 +268,15 @@ static int8_t CDC_Control(uint8_t cdc_ch, uint8_t cmd, uint8_t *pbuf, uint16_t l
     break;
 
   case CDC_SET_CONTROL_LINE_STATE:
-
+    /* DTR and RTS are kept by the class, see USBD_CDC_GetLineState */
+#if (USBD_USE_CDC_BENCH == 1U)
+    /* A DTR change ends the benchmark mode of the channel */
+    USBD_CDC_Bench_LineState(cdc_ch);
+#endif /* (USBD_USE_CDC_BENCH == 1U) */
+#if (USBD_USE_CDC_FRAME == 1U)
+    /* A DTR change starts a new framed session */
+    USBD_CDC_Frame_LineState(cdc_ch);
+#endif /* (USBD_USE_CDC_FRAME == 1U) */
     break;
 
   case CDC_SEND_BREAK:
@@ -408,11 +296,11 @@ static int8_t CDC_Control(uint8_t cdc_ch, uint8_t cmd, uint8_t *pbuf, uint16_t l
   *         through this function.
   *
   *         @note
-  *         This function will issue a NAK packet on any OUT packet received on
-  *         USB endpoint until exiting this function. If you exit this function
-  *         before transfer is complete on CDC interface (ie. using DMA controller)
-  *         it will result in receiving more data while previous ones are still
-  *         not sent.
+  *         Buf is a buffer of the class pool, the endpoint already receives
+  *         into the next one. Buf stays valid until it is given back with
+  *         USBD_CDC_ReleaseRxBuffer, which can be done once a transfer of
+  *         the data (ie. using DMA controller) is complete. The endpoint
+  *         NAKs only while every pool buffer is held.
   *
   * @param  Buf: Buffer of data to be received
   * @param  Len: Number of data received (in bytes)
@@ -421,11 +309,41 @@ static int8_t CDC_Control(uint8_t cdc_ch, uint8_t cmd, uint8_t *pbuf, uint16_t l
 static int8_t CDC_Receive(uint8_t cdc_ch, uint8_t *Buf, uint32_t *Len)
 {
   /* USER CODE BEGIN 6 */
-  //HAL_UART_Transmit_DMA(CDC_CH_To_UART_Handle(cdc_ch), Buf, *Len);
-  CDC_Transmit(cdc_ch, Buf, *Len); // echo back on same channel
+#if (USBD_USE_OS == 1U)
+  /* Data is taken by the task blocked in USBD_CDC_Read, which arms the
+     endpoint again once the packet is consumed */
+  UNUSED(cdc_ch);
+  UNUSED(Buf);
+  UNUSED(Len);
+#else
+#if (USBD_USE_CDC_BRIDGE == 1U)
+  /* A bridged channel sends Buf on its UART and gives it back when done */
+  if (USBD_CDC_Bridge_Receive(cdc_ch, Buf, *Len) == USBD_OK)
+  {
+    return (USBD_OK);
+  }
+#endif /* (USBD_USE_CDC_BRIDGE == 1U) */
+#if (USBD_USE_CDC_BENCH == 1U)
+  /* A benchmark channel gives Buf back once it is consumed */
+  if (USBD_CDC_Bench_Receive(cdc_ch, Buf, *Len) == USBD_OK)
+  {
+    return (USBD_OK);
+  }
+#endif /* (USBD_USE_CDC_BENCH == 1U) */
+#if (USBD_USE_CDC_FRAME == 1U)
+  /* A framed channel decodes Buf and gives it back at once */
+  if (USBD_CDC_Frame_Receive(cdc_ch, Buf, *Len) == USBD_OK)
+  {
+    return (USBD_OK);
+  }
+#endif /* (USBD_USE_CDC_FRAME == 1U) */
 
-  USBD_CDC_SetRxBuffer(cdc_ch, &hUsbDevice, &Buf[0]);
-  USBD_CDC_ReceivePacket(cdc_ch, &hUsbDevice);
+  /* Echo back on same channel, Buf is given back once it is sent */
+  if (CDC_Transmit(cdc_ch, Buf, *Len) != USBD_OK)
+  {
+    (void)USBD_CDC_ReleaseRxBuffer(cdc_ch, &hUsbDevice, Buf);
+  }
+#endif /* (USBD_USE_OS == 1U) */
   return (USBD_OK);
   /* USER CODE END 6 */
 }
@@ -444,6 +362,14 @@ static int8_t CDC_Receive(uint8_t cdc_ch, uint8_t *Buf, uint32_t *Len)
   */
 static int8_t CDC_TransmitCplt(uint8_t cdc_ch, uint8_t *Buf, uint32_t *Len, uint8_t epnum)
 {
+  /* USER CODE BEGIN 13 */
+  UNUSED(Len);
+  UNUSED(epnum);
+
+  /* An echoed packet returns to the receive pool, other buffers are not
+     part of it and are left alone */
+  (void)USBD_CDC_ReleaseRxBuffer(cdc_ch, &hUsbDevice, Buf);
+  /* USER CODE END 13 */
   return (USBD_OK);
 }
 
@@ -452,7 +378,8 @@ static int8_t CDC_TransmitCplt(uint8_t cdc_ch, uint8_t *Buf, uint32_t *Len, uint
   *         Data to send over USB IN endpoint are sent over CDC interface
   *         through this function.
   *         @note
-  *
+  *         The transfer is queued on the channel IN endpoint, Buf must stay
+  *         valid until CDC_TransmitCplt reports it back.
   *
   * @param  Buf: Buffer of data to be sent
   * @param  Len: Number of data to be sent (in bytes)
@@ -462,75 +389,65 @@ uint8_t CDC_Transmit(uint8_t ch, uint8_t *Buf, uint16_t Len)
 {
   uint8_t result = USBD_OK;
   /* USER CODE BEGIN 7 */
-  extern USBD_CDC_ACM_HandleTypeDef CDC_ACM_Class_Data[];
-  USBD_CDC_ACM_HandleTypeDef *hcdc = NULL;
-  hcdc = &CDC_ACM_Class_Data[ch];
-  if (hcdc->TxState != 0)
-  {
-    return USBD_BUSY;
-  }
   USBD_CDC_SetTxBuffer(ch, &hUsbDevice, Buf, Len);
   result = USBD_CDC_TransmitPacket(ch, &hUsbDevice);
   /* USER CODE END 7 */
   return result;
 }
 
+/**
+  * @brief  CDC_Write
+  *         Data to send over USB IN endpoint are copied into the channel
+  *         transmit ring, small writes are coalesced into full packets.
+  *         @note
+  *         The function never blocks and Buf is free again on return. Data
+  *         short of a packet is sent after CDC_ACM_TX_FLUSH_SOF SOF periods,
+  *         or at once with USBD_CDC_TxFlush.
+  *
+  * @param  Buf: Buffer of data to be sent
+  * @param  Len: Number of data to be sent (in bytes)
+  * @retval Number of bytes taken, less than Len when the ring is full
+  */
+uint32_t CDC_Write(uint8_t ch, const uint8_t *Buf, uint32_t Len)
+{
+  uint32_t result = 0U;
+  /* USER CODE BEGIN 14 */
+  result = USBD_CDC_TxWrite(ch, &hUsbDevice, Buf, Len);
+  /* USER CODE END 14 */
+  return result;
+}
+
 /* USER CODE BEGIN PRIVATE_FUNCTIONS_IMPLEMENTATION */
-//void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
-//{
-//  /* Initiate next USB packet transfer once UART completes transfer (transmitting data over Tx line) */
-//  //USBD_CDC_ReceivePacket(UART_Handle_TO_CDC_CH(huart), &hUsbDevice);
-//}
-
-//void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
-//{
-//  for (uint8_t i = 0; i < NUMBER_OF_CDC; i++)
-//  {
-//    uint32_t buffptr;
-//    uint32_t buffsize;
-//
-//    if (Read_Index[i] != Write_Index[i])
-//    {
-//      if (Read_Index[i] > Write_Index[i]) /* Rollback */
-//      {
-//        buffsize = APP_TX_DATA_SIZE - Read_Index[i];
-//      }
-//      else
-//      {
-//        buffsize = Write_Index[i] - Read_Index[i];
-//      }
-//
-//      buffptr = Read_Index[i];
-//
-//      USBD_CDC_SetTxBuffer(i, &hUsbDevice, &TX_Buffer[i][buffptr], buffsize);
-//
-//      if (USBD_CDC_TransmitPacket(i, &hUsbDevice) == USBD_OK)
-//      {
-//        Read_Index[i] += buffsize;
-//        if (Read_Index[i] == APP_RX_DATA_SIZE)
-//        {
-//          Read_Index[i] = 0;
-//        }
-//      }
-//    }
-//  }
-//}
-
-//void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
-//{
-//  uint8_t cdc_ch = UART_Handle_TO_CDC_CH(huart);
-//  /* Increment Index for buffer writing */
-//  Write_Index[cdc_ch]++;
-//
-//  /* To avoid buffer overflow */
-//  if (Write_Index[cdc_ch] == APP_RX_DATA_SIZE)
-//  {
-//    Write_Index[cdc_ch] = 0;
-//  }
-//
-//  /* Start another reception: provide the buffer pointer with offset and the buffer size */
-//  HAL_UART_Receive_IT(huart, (TX_Buffer[cdc_ch] + Write_Index[cdc_ch]), 1);
-//}
+#if (USBD_USE_CDC_BRIDGE == 1U) && defined(HAL_UART_MODULE_ENABLED) && defined(HAL_DMA_MODULE_ENABLED)
+/* UART events of the channels bridged with USBD_CDC_Bridge_AttachUart */
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+  uint8_t ch = USBD_CDC_Bridge_UartToCh(huart);
+
+  UNUSED(Size);
+
+  if (ch < NUMBER_OF_CDC)
+  {
+    USBD_CDC_Bridge_RxEvent(ch);
+  }
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+  uint8_t ch = USBD_CDC_Bridge_UartToCh(huart);
+
+  if (ch < NUMBER_OF_CDC)
+  {
+    USBD_CDC_Bridge_TxCplt(ch);
+  }
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+  /* Overrun, framing and parity errors reach the host as SERIAL_STATE */
+  USBD_CDC_Bridge_UartError(huart);
+}
+#endif /* (USBD_USE_CDC_BRIDGE == 1U) && defined(HAL_UART_MODULE_ENABLED) && defined(HAL_DMA_MODULE_ENABLED) */
 /* USER CODE END PRIVATE_FUNCTIONS_IMPLEMENTATION */
 
 /**
@@ -104,6 +104,7 @@ extern USBD_CDC_ACM_ItfTypeDef  USBD_CDC_ACM_fops;
   */
 
 uint8_t CDC_Transmit(uint8_t ch, uint8_t* Buf, uint16_t Len);
+uint32_t CDC_Write(uint8_t ch, const uint8_t* Buf, uint32_t Len);
 
 /* USER CODE BEGIN EXPORTED_FUNCTIONS */
 
@@ -0,0 +1,94 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cdc_bench.h
+  * @brief   Header for usbd_cdc_bench.c file.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CDC_BENCH_H
+#define __USBD_CDC_BENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cdc_acm.h"
+
+#if (USBD_USE_CDC_BENCH == 1U)
+
+/* Exported constants --------------------------------------------------------*/
+
+/* Command block a channel waits for after each DTR change, all fields
+   little endian: magic, command, 3 reserved bytes, 2 arguments */
+#define USBD_CDC_BENCH_CMD_SIZE                     16U
+#define USBD_CDC_BENCH_CMD_MAGIC                    0x434E4542U   /* "BENC" */
+
+/* Commands, a mode clears the counters and runs until DTR changes */
+#define USBD_CDC_BENCH_SINK                         1U  /* take the pattern, check it */
+#define USBD_CDC_BENCH_SOURCE                       2U  /* send the pattern, arg0 bytes (0 no limit) */
+#define USBD_CDC_BENCH_ECHO                         3U  /* echo arg0 byte records led by a sequence number */
+#define USBD_CDC_BENCH_ROUNDTRIP                    4U  /* stamp and return 16 byte records */
+#define USBD_CDC_BENCH_STATS                        5U  /* answer with the counters */
+
+/* Round trip record: sequence, host time (returned as is), device ticks at
+   the first byte received and at the reply */
+#define USBD_CDC_BENCH_RT_SIZE                      16U
+
+#define USBD_CDC_BENCH_STATS_MAGIC                  0x41545342U   /* "BSTA" */
+
+/* Exported types ------------------------------------------------------------*/
+
+/* Counters of the last mode of a channel, sent as they are after the magic
+   word in answer to USBD_CDC_BENCH_STATS. Latencies are USBD_LL_GetTimestamp
+   ticks. */
+typedef struct
+{
+  uint32_t Mode;        /* last mode started */
+  uint32_t TickFreq;    /* ticks per second */
+  uint32_t RxBytes;
+  uint32_t TxBytes;
+  uint32_t Elapsed;     /* us from the mode start to the last byte moved */
+  uint32_t Records;     /* echo and round trip records seen */
+  uint32_t Gaps;        /* sequence numbers skipped */
+  uint32_t Errors;      /* pattern bytes or sequence numbers out of order */
+  uint32_t Stalls;      /* times the transmit ring was full */
+  uint32_t LatMin;      /* round trip: first byte received to reply queued */
+  uint32_t LatMax;
+  uint32_t LatSum;
+} USBD_CDC_Bench_StatsTypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+/* Exported functions ------------------------------------------------------- */
+
+USBD_StatusTypeDef USBD_CDC_Bench_Attach(uint8_t ch, USBD_HandleTypeDef *pdev);
+uint8_t USBD_CDC_Bench_GetStats(uint8_t ch, USBD_CDC_Bench_StatsTypeDef *pstats);
+
+/* Called by the CDC ACM interface */
+void USBD_CDC_Bench_Init(uint8_t ch);
+void USBD_CDC_Bench_DeInit(uint8_t ch);
+void USBD_CDC_Bench_LineState(uint8_t ch);
+USBD_StatusTypeDef USBD_CDC_Bench_Receive(uint8_t ch, uint8_t *pbuf, uint32_t length);
+
+/* Called from the main loop */
+void USBD_CDC_Bench_Process(void);
+
+#endif /* (USBD_USE_CDC_BENCH == 1U) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_CDC_BENCH_H */
+
+/********************************** END OF FILE *******************************/
@@ -0,0 +1,780 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cdc_frame.c
+  * @brief   Reliable framed transport over a CDC ACM channel
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cdc_frame.h"
+
+#if (USBD_USE_CDC_FRAME == 1U)
+
+/*
+  Each frame is a body COBS encoded and followed by a 0 byte, so a receiver
+  finds the next frame after any corruption. The body is a type byte, a
+  16-bit sequence number, the payload and the CRC-32 (IEEE 802.3, as zlib)
+  of what precedes it, all little endian.
+
+  Both directions run the same selective repeat protocol: a side sends up
+  to the window of the peer beyond the oldest frame not acknowledged. The
+  receiver delivers frames in order, holds the ones that arrive ahead of a
+  missing one and answers each batch of received data with an ACK frame:
+  the next sequence number it expects, a mask of the 32 frames after it
+  that it holds, and how many frames it takes from there. Frames the
+  application refused count as received but shrink that window, so a busy
+  application holds the host back without stopping its ACK frames. A
+  sender resends a frame once its acknowledgement is late by
+  USBD_CDC_FRAME_RTO_US, or at once when the mask shows a later frame
+  arrived without it.
+
+  Encoded frames are copied to the transmit ring of the channel, which
+  packs the frames in flight into full packets and chained transfers. A DTR
+  change starts both directions again from sequence number 0.
+*/
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Type, next expected, mask, window and CRC */
+#define USBD_CDC_FRAME_ACK_SIZE                     (USBD_CDC_FRAME_HDR_SIZE + 5U + USBD_CDC_FRAME_CRC_SIZE)
+
+/* Private macro -------------------------------------------------------------*/
+#define USBD_CDC_FRAME_SLOT(seq)                    ((uint16_t)(seq) & (USBD_CDC_FRAME_WINDOW - 1U))
+
+/* Private variables ---------------------------------------------------------*/
+static USBD_CDC_Frame_HandleTypeDef *USBD_CDC_Frame[NUMBER_OF_CDC];
+
+/* CRC-32 of each nibble, reflected polynomial 0xEDB88320 */
+static const uint32_t USBD_CDC_Frame_CrcTable[16] =
+{
+  0x00000000U, 0x1DB71064U, 0x3B6E20C8U, 0x26D930ACU,
+  0x76DC4190U, 0x6B6B51F4U, 0x4DB26158U, 0x5005713CU,
+  0xEDB88320U, 0xF00F9344U, 0xD6D6A3E8U, 0xCB61B38CU,
+  0x9B64C2B0U, 0x86D3D2D4U, 0xA00AE278U, 0xBDBDF21CU
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static void USBD_CDC_Frame_Reset(USBD_CDC_Frame_HandleTypeDef *hf);
+static void USBD_CDC_Frame_Pump(USBD_CDC_Frame_HandleTypeDef *hf);
+static uint8_t USBD_CDC_Frame_Emit(USBD_CDC_Frame_HandleTypeDef *hf, const uint8_t *pbody, uint32_t len);
+static uint8_t USBD_CDC_Frame_SendAck(USBD_CDC_Frame_HandleTypeDef *hf);
+static void USBD_CDC_Frame_Dispatch(USBD_CDC_Frame_HandleTypeDef *hf);
+static void USBD_CDC_Frame_Deliver(USBD_CDC_Frame_HandleTypeDef *hf);
+static void USBD_CDC_Frame_RxData(USBD_CDC_Frame_HandleTypeDef *hf, uint16_t seq,
+                                  const uint8_t *pbuf, uint16_t len);
+static void USBD_CDC_Frame_RxAck(USBD_CDC_Frame_HandleTypeDef *hf, uint16_t next,
+                                 uint32_t mask, uint8_t window);
+static uint32_t USBD_CDC_Frame_Cobs(uint8_t *pdst, const uint8_t *psrc, uint32_t len);
+static uint32_t USBD_CDC_Frame_Crc(const uint8_t *pbuf, uint32_t len);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  USBD_CDC_Frame_Attach
+  *         Carry frames on a CDC ACM channel, before the device starts
+  * @param  ch: CDC channel
+  * @param  pdev: device handle
+  * @param  hframe: state of the channel, kept by the application
+  * @param  receive: called with each payload in order, USBD_BUSY to be
+  *         called again with it later
+  * @retval status
+  */
+USBD_StatusTypeDef USBD_CDC_Frame_Attach(uint8_t ch, USBD_HandleTypeDef *pdev,
+                                         USBD_CDC_Frame_HandleTypeDef *hframe,
+                                         USBD_StatusTypeDef (*receive)(uint8_t ch, const uint8_t *pbuf,
+                                                                       uint16_t len))
+{
+  uint32_t freq;
+
+  if ((ch >= NUMBER_OF_CDC) || (pdev == NULL) || (hframe == NULL) || (receive == NULL))
+  {
+    return USBD_FAIL;
+  }
+
+  (void)USBD_memset(hframe, 0, sizeof(USBD_CDC_Frame_HandleTypeDef));
+  hframe->Receive = receive;
+  hframe->pdev = pdev;
+  hframe->Ch = ch;
+
+  freq = USBD_LL_GetTimestampFreq();
+  hframe->RtoTicks = MAX((uint32_t)(((uint64_t)freq * USBD_CDC_FRAME_RTO_US) / 1000000U), 1U);
+
+  USBD_CDC_Frame_Reset(hframe);
+  USBD_CDC_Frame[ch] = hframe;
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_CDC_Frame_Send
+  *         Queue a payload, it is sent again until the host acknowledges it
+  * @param  ch: CDC channel
+  * @param  pbuf: payload, copied
+  * @param  len: up to USBD_CDC_FRAME_MTU bytes
+  * @retval USBD_BUSY while the window of the host is full
+  */
+USBD_StatusTypeDef USBD_CDC_Frame_Send(uint8_t ch, const uint8_t *pbuf, uint16_t len)
+{
+  USBD_CDC_Frame_HandleTypeDef *hf;
+  USBD_CDC_Frame_TxSlotTypeDef *pslot;
+  uint32_t primask;
+  uint32_t crc;
+  uint16_t blen;
+
+  if ((ch >= NUMBER_OF_CDC) || (USBD_CDC_Frame[ch] == NULL) ||
+      (len > USBD_CDC_FRAME_MTU) || ((pbuf == NULL) && (len != 0U)))
+  {
+    return USBD_FAIL;
+  }
+
+  hf = USBD_CDC_Frame[ch];
+
+  USBD_ENTER_CRITICAL(primask);
+
+  if ((uint16_t)(hf->TxNext - hf->TxBase) >= hf->PeerWindow)
+  {
+    USBD_EXIT_CRITICAL(primask);
+    return USBD_BUSY;
+  }
+
+  pslot = &hf->Tx[USBD_CDC_FRAME_SLOT(hf->TxNext)];
+  pslot->Body[0] = USBD_CDC_FRAME_DATA;
+  pslot->Body[1] = LOBYTE(hf->TxNext);
+  pslot->Body[2] = HIBYTE(hf->TxNext);
+  (void)USBD_memcpy(&pslot->Body[USBD_CDC_FRAME_HDR_SIZE], pbuf, len);
+
+  blen = USBD_CDC_FRAME_HDR_SIZE + len;
+  crc = USBD_CDC_Frame_Crc(pslot->Body, blen);
+  pslot->Body[blen] = (uint8_t)crc;
+  pslot->Body[blen + 1U] = (uint8_t)(crc >> 8);
+  pslot->Body[blen + 2U] = (uint8_t)(crc >> 16);
+  pslot->Body[blen + 3U] = (uint8_t)(crc >> 24);
+
+  pslot->Len = blen + USBD_CDC_FRAME_CRC_SIZE;
+  pslot->Queued = 1U;
+  pslot->Acked = 0U;
+  pslot->Fast = 0U;
+  hf->TxNext++;
+
+  USBD_CDC_Frame_Pump(hf);
+
+  USBD_EXIT_CRITICAL(primask);
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_CDC_Frame_TxFree
+  *         Number of payloads USBD_CDC_Frame_Send takes now
+  * @param  ch: CDC channel
+  * @retval number of frames
+  */
+uint32_t USBD_CDC_Frame_TxFree(uint8_t ch)
+{
+  USBD_CDC_Frame_HandleTypeDef *hf;
+  uint16_t used;
+
+  if ((ch >= NUMBER_OF_CDC) || (USBD_CDC_Frame[ch] == NULL))
+  {
+    return 0U;
+  }
+
+  hf = USBD_CDC_Frame[ch];
+  used = (uint16_t)(hf->TxNext - hf->TxBase);
+
+  return (used < hf->PeerWindow) ? ((uint32_t)hf->PeerWindow - used) : 0U;
+}
+
+/**
+  * @brief  USBD_CDC_Frame_GetStats
+  *         Read the counters of a framed channel
+  * @param  ch: CDC channel
+  * @param  pstats: counters out
+  * @retval status
+  */
+uint8_t USBD_CDC_Frame_GetStats(uint8_t ch, USBD_CDC_Frame_StatsTypeDef *pstats)
+{
+  uint32_t primask;
+
+  if ((ch >= NUMBER_OF_CDC) || (USBD_CDC_Frame[ch] == NULL) || (pstats == NULL))
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  USBD_ENTER_CRITICAL(primask);
+  *pstats = USBD_CDC_Frame[ch]->Stats;
+  USBD_EXIT_CRITICAL(primask);
+
+  return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_CDC_Frame_Init
+  *         Start from sequence number 0 on the new configuration
+  * @param  ch: CDC channel
+  * @retval None
+  */
+void USBD_CDC_Frame_Init(uint8_t ch)
+{
+  USBD_CDC_Frame_HandleTypeDef *hf = USBD_CDC_Frame[ch];
+
+  if (hf != NULL)
+  {
+    hf->Dtr = 0U;
+    USBD_CDC_Frame_Reset(hf);
+  }
+}
+
+/**
+  * @brief  USBD_CDC_Frame_DeInit
+  *         Drop the frames in flight
+  * @param  ch: CDC channel
+  * @retval None
+  */
+void USBD_CDC_Frame_DeInit(uint8_t ch)
+{
+  USBD_CDC_Frame_HandleTypeDef *hf = USBD_CDC_Frame[ch];
+
+  if (hf != NULL)
+  {
+    USBD_CDC_Frame_Reset(hf);
+  }
+}
+
+/**
+  * @brief  USBD_CDC_Frame_LineState
+  *         A DTR change means a new host session, the frames in flight are
+  *         dropped and both directions start from sequence number 0
+  * @param  ch: CDC channel
+  * @retval None
+  */
+void USBD_CDC_Frame_LineState(uint8_t ch)
+{
+  USBD_CDC_Frame_HandleTypeDef *hf = USBD_CDC_Frame[ch];
+  uint8_t dtr;
+
+  if (hf == NULL)
+  {
+    return;
+  }
+
+  dtr = ((USBD_CDC_GetLineState(ch, hf->pdev) & CDC_CONTROL_LINE_DTR) != 0U) ? 1U : 0U;
+
+  if (dtr != hf->Dtr)
+  {
+    hf->Dtr = dtr;
+    USBD_CDC_Frame_Reset(hf);
+  }
+}
+
+/**
+  * @brief  USBD_CDC_Frame_Receive
+  *         Decode a received pool buffer of a framed channel and give it back
+  * @param  ch: CDC channel
+  * @param  pbuf: pool buffer
+  * @param  length: number of bytes received
+  * @retval USBD_OK when the channel carries frames
+  */
+USBD_StatusTypeDef USBD_CDC_Frame_Receive(uint8_t ch, uint8_t *pbuf, uint32_t length)
+{
+  USBD_CDC_Frame_HandleTypeDef *hf;
+  uint32_t primask;
+  uint8_t byte;
+
+  if ((ch >= NUMBER_OF_CDC) || (USBD_CDC_Frame[ch] == NULL))
+  {
+    return USBD_FAIL;
+  }
+
+  hf = USBD_CDC_Frame[ch];
+
+  USBD_ENTER_CRITICAL(primask);
+
+  for (uint32_t i = 0U; i < length; i++)
+  {
+    byte = pbuf[i];
+
+    if (byte == 0U)
+    {
+      /* End of frame, a truncated last block or an overflow drops it */
+      if ((hf->DecBad == 0U) && (hf->DecCode == 0U) && (hf->DecLen != 0U))
+      {
+        USBD_CDC_Frame_Dispatch(hf);
+      }
+      else if ((hf->DecBad != 0U) || (hf->DecCode != 0U))
+      {
+        hf->Stats.RxErrors++;
+      }
+      else
+      {
+        /* Empty frame, used by the host to resynchronize */
+      }
+
+      hf->DecLen = 0U;
+      hf->DecCode = 0U;
+      hf->DecZero = 0U;
+      hf->DecBad = 0U;
+      continue;
+    }
+
+    if (hf->DecBad != 0U)
+    {
+      continue;
+    }
+
+    if (hf->DecCode == 0U)
+    {
+      /* Code byte: the previous block ended with a 0 byte unless it was full */
+      if (hf->DecZero != 0U)
+      {
+        if (hf->DecLen == sizeof(hf->Dec))
+        {
+          hf->DecBad = 1U;
+          continue;
+        }
+
+        hf->Dec[hf->DecLen] = 0U;
+        hf->DecLen++;
+      }
+
+      hf->DecCode = (uint8_t)(byte - 1U);
+      hf->DecZero = (byte != 0xFFU) ? 1U : 0U;
+    }
+    else if (hf->DecLen == sizeof(hf->Dec))
+    {
+      hf->DecBad = 1U;
+    }
+    else
+    {
+      hf->Dec[hf->DecLen] = byte;
+      hf->DecLen++;
+      hf->DecCode--;
+    }
+  }
+
+  /* Acknowledge the whole buffer at once */
+  USBD_CDC_Frame_Pump(hf);
+
+  USBD_EXIT_CRITICAL(primask);
+
+  (void)USBD_CDC_ReleaseRxBuffer(ch, hf->pdev, pbuf);
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_CDC_Frame_Process
+  *         Give the held payloads to the application again, send the frames
+  *         and acknowledgements that waited for room in the transmit ring
+  *         and resend the late ones, from the main loop
+  * @retval None
+  */
+void USBD_CDC_Frame_Process(void)
+{
+  uint32_t primask;
+
+  for (uint8_t ch = 0U; ch < NUMBER_OF_CDC; ch++)
+  {
+    if (USBD_CDC_Frame[ch] != NULL)
+    {
+      USBD_ENTER_CRITICAL(primask);
+      USBD_CDC_Frame_Deliver(USBD_CDC_Frame[ch]);
+      USBD_CDC_Frame_Pump(USBD_CDC_Frame[ch]);
+      USBD_EXIT_CRITICAL(primask);
+    }
+  }
+}
+
+/**
+  * @brief  USBD_CDC_Frame_Reset
+  *         Drop the frames in flight and the partial frame received
+  * @param  hf: framed channel
+  * @retval None
+  */
+static void USBD_CDC_Frame_Reset(USBD_CDC_Frame_HandleTypeDef *hf)
+{
+  hf->TxBase = 0U;
+  hf->TxNext = 0U;
+  hf->RxNext = 0U;
+  hf->RxMask = 0U;
+  hf->AckPending = 0U;
+  hf->PeerWindow = USBD_CDC_FRAME_WINDOW;
+  hf->DecLen = 0U;
+  hf->DecCode = 0U;
+  hf->DecZero = 0U;
+  hf->DecBad = 0U;
+}
+
+/**
+  * @brief  USBD_CDC_Frame_Pump
+  *         Write the pending acknowledgement, then the frames queued or late,
+  *         oldest first, while the transmit ring has room. Called with
+  *         interrupts masked.
+  * @param  hf: framed channel
+  * @retval None
+  */
+static void USBD_CDC_Frame_Pump(USBD_CDC_Frame_HandleTypeDef *hf)
+{
+  USBD_CDC_Frame_TxSlotTypeDef *pslot;
+  uint32_t now = USBD_LL_GetTimestamp();
+
+  if ((hf->AckPending != 0U) && (USBD_CDC_Frame_SendAck(hf) == 0U))
+  {
+    return;
+  }
+
+  for (uint16_t seq = hf->TxBase; seq != hf->TxNext; seq++)
+  {
+    pslot = &hf->Tx[USBD_CDC_FRAME_SLOT(seq)];
+
+    if (pslot->Acked != 0U)
+    {
+      continue;
+    }
+
+    if (pslot->Queued == 0U)
+    {
+      if ((now - pslot->Tick) < hf->RtoTicks)
+      {
+        continue;
+      }
+
+      pslot->Queued = 1U;
+      hf->Stats.TxRetries++;
+    }
+
+    if (USBD_CDC_Frame_Emit(hf, pslot->Body, pslot->Len) == 0U)
+    {
+      return;
+    }
+
+    pslot->Queued = 0U;
+    pslot->Tick = now;
+    hf->Stats.TxFrames++;
+  }
+}
+
+/**
+  * @brief  USBD_CDC_Frame_Emit
+  *         Encode a frame into the transmit ring, whole or not at all
+  * @param  hf: framed channel
+  * @param  pbody: frame body
+  * @param  len: length of the body
+  * @retval 1 when written, 0 when the ring is short of room
+  */
+static uint8_t USBD_CDC_Frame_Emit(USBD_CDC_Frame_HandleTypeDef *hf, const uint8_t *pbody, uint32_t len)
+{
+  uint32_t n;
+
+  if (USBD_CDC_TxFree(hf->Ch, hf->pdev) < (len + (len / 254U) + 2U))
+  {
+    return 0U;
+  }
+
+  n = USBD_CDC_Frame_Cobs(hf->Wire, pbody, len);
+  (void)USBD_CDC_TxWrite(hf->Ch, hf->pdev, hf->Wire, n);
+
+  return 1U;
+}
+
+/**
+  * @brief  USBD_CDC_Frame_SendAck
+  *         Acknowledge the frames received so far
+  * @param  hf: framed channel
+  * @retval 1 when written, 0 when the ring is short of room
+  */
+static uint8_t USBD_CDC_Frame_SendAck(USBD_CDC_Frame_HandleTypeDef *hf)
+{
+  uint8_t ack[USBD_CDC_FRAME_ACK_SIZE];
+  uint32_t mask = hf->RxMask;
+  uint32_t crc;
+  uint16_t run = 0U;
+
+  /* Frames held in order are acknowledged, the window shrinks until the
+     application takes them */
+  while ((mask & 1U) != 0U)
+  {
+    mask >>= 1;
+    run++;
+  }
+
+  mask >>= 1;
+
+  ack[0] = USBD_CDC_FRAME_ACK;
+  ack[1] = LOBYTE(hf->RxNext + run);
+  ack[2] = HIBYTE(hf->RxNext + run);
+  ack[3] = (uint8_t)mask;
+  ack[4] = (uint8_t)(mask >> 8);
+  ack[5] = (uint8_t)(mask >> 16);
+  ack[6] = (uint8_t)(mask >> 24);
+  ack[7] = (uint8_t)(USBD_CDC_FRAME_WINDOW - run);
+
+  crc = USBD_CDC_Frame_Crc(ack, 8U);
+  ack[8] = (uint8_t)crc;
+  ack[9] = (uint8_t)(crc >> 8);
+  ack[10] = (uint8_t)(crc >> 16);
+  ack[11] = (uint8_t)(crc >> 24);
+
+  if (USBD_CDC_Frame_Emit(hf, ack, sizeof(ack)) == 0U)
+  {
+    return 0U;
+  }
+
+  hf->AckPending = 0U;
+
+  return 1U;
+}
+
+/**
+  * @brief  USBD_CDC_Frame_Dispatch
+  *         Check a decoded frame and act on it
+  * @param  hf: framed channel
+  * @retval None
+  */
+static void USBD_CDC_Frame_Dispatch(USBD_CDC_Frame_HandleTypeDef *hf)
+{
+  uint8_t *pd = hf->Dec;
+  uint32_t len = hf->DecLen;
+  uint32_t crc;
+  uint16_t val;
+
+  if (len < (USBD_CDC_FRAME_HDR_SIZE + USBD_CDC_FRAME_CRC_SIZE))
+  {
+    hf->Stats.RxErrors++;
+    return;
+  }
+
+  len -= USBD_CDC_FRAME_CRC_SIZE;
+  crc = (uint32_t)pd[len] | ((uint32_t)pd[len + 1U] << 8) |
+        ((uint32_t)pd[len + 2U] << 16) | ((uint32_t)pd[len + 3U] << 24);
+
+  if (crc != USBD_CDC_Frame_Crc(pd, len))
+  {
+    hf->Stats.RxErrors++;
+    return;
+  }
+
+  val = (uint16_t)pd[1] | (uint16_t)((uint16_t)pd[2] << 8);
+
+  if (pd[0] == USBD_CDC_FRAME_DATA)
+  {
+    USBD_CDC_Frame_RxData(hf, val, &pd[USBD_CDC_FRAME_HDR_SIZE],
+                          (uint16_t)(len - USBD_CDC_FRAME_HDR_SIZE));
+  }
+  else if ((pd[0] == USBD_CDC_FRAME_ACK) && (len == (USBD_CDC_FRAME_ACK_SIZE - USBD_CDC_FRAME_CRC_SIZE)))
+  {
+    USBD_CDC_Frame_RxAck(hf, val, (uint32_t)pd[3] | ((uint32_t)pd[4] << 8) |
+                         ((uint32_t)pd[5] << 16) | ((uint32_t)pd[6] << 24), pd[7]);
+  }
+  else
+  {
+    hf->Stats.RxErrors++;
+  }
+}
+
+/**
+  * @brief  USBD_CDC_Frame_RxData
+  *         Deliver a data frame in order, or hold it until the frames
+  *         before it arrive or the application takes it
+  * @param  hf: framed channel
+  * @param  seq: sequence number
+  * @param  pbuf: payload
+  * @param  len: length of the payload
+  * @retval None
+  */
+static void USBD_CDC_Frame_RxData(USBD_CDC_Frame_HandleTypeDef *hf, uint16_t seq,
+                                  const uint8_t *pbuf, uint16_t len)
+{
+  USBD_CDC_Frame_RxSlotTypeDef *pslot;
+  uint16_t dist = (uint16_t)(seq - hf->RxNext);
+
+  if ((dist == 0U) && ((hf->RxMask & 1U) == 0U) &&
+      (hf->Receive(hf->Ch, pbuf, len) == USBD_OK))
+  {
+    hf->Stats.RxFrames++;
+    hf->RxNext++;
+    hf->RxMask >>= 1;
+
+    /* Then the frames held behind it */
+    USBD_CDC_Frame_Deliver(hf);
+  }
+  else if ((dist < USBD_CDC_FRAME_WINDOW) && ((hf->RxMask & (1UL << dist)) == 0U))
+  {
+    pslot = &hf->Rx[USBD_CDC_FRAME_SLOT(seq)];
+    (void)USBD_memcpy(pslot->Payload, pbuf, len);
+    pslot->Len = len;
+    hf->RxMask |= 1UL << dist;
+  }
+  else
+  {
+    /* Held already, delivered already (its ACK was lost) or beyond the window */
+    hf->Stats.RxDuplicates++;
+  }
+
+  hf->AckPending = 1U;
+}
+
+/**
+  * @brief  USBD_CDC_Frame_Deliver
+  *         Give the application the held frames that are next in order
+  * @param  hf: framed channel
+  * @retval None
+  */
+static void USBD_CDC_Frame_Deliver(USBD_CDC_Frame_HandleTypeDef *hf)
+{
+  USBD_CDC_Frame_RxSlotTypeDef *pslot;
+
+  while ((hf->RxMask & 1U) != 0U)
+  {
+    pslot = &hf->Rx[USBD_CDC_FRAME_SLOT(hf->RxNext)];
+
+    if (hf->Receive(hf->Ch, pslot->Payload, pslot->Len) != USBD_OK)
+    {
+      return;
+    }
+
+    hf->Stats.RxFrames++;
+    hf->RxNext++;
+    hf->RxMask >>= 1;
+
+    /* The window opens again */
+    hf->AckPending = 1U;
+  }
+}
+
+/**
+  * @brief  USBD_CDC_Frame_RxAck
+  *         Release the acknowledged frames and resend the ones the host
+  *         skipped
+  * @param  hf: framed channel
+  * @param  next: next sequence number the host expects
+  * @param  mask: bit n set when the host holds frame next + 1 + n
+  * @param  window: frames the host takes from next on
+  * @retval None
+  */
+static void USBD_CDC_Frame_RxAck(USBD_CDC_Frame_HandleTypeDef *hf, uint16_t next,
+                                 uint32_t mask, uint8_t window)
+{
+  USBD_CDC_Frame_TxSlotTypeDef *pslot;
+  uint16_t inflight;
+  uint16_t held;
+
+  /* An old ACK overtaken by a later one, or one for frames never sent */
+  if ((uint16_t)(next - hf->TxBase) > (uint16_t)(hf->TxNext - hf->TxBase))
+  {
+    return;
+  }
+
+  hf->TxBase = next;
+  /* A closed window still lets one frame through, its ACK tells when the
+     window opens again */
+  hf->PeerWindow = (uint8_t)MIN(MAX(window, 1U), USBD_CDC_FRAME_WINDOW);
+  inflight = (uint16_t)(hf->TxNext - hf->TxBase);
+
+  /* Frames up to the last one the host holds */
+  held = 0U;
+
+  for (uint16_t n = 0U; n < 32U; n++)
+  {
+    if ((mask & (1UL << n)) != 0U)
+    {
+      held = n + 2U;
+    }
+  }
+
+  held = MIN(held, inflight);
+
+  for (uint16_t n = 0U; n < held; n++)
+  {
+    pslot = &hf->Tx[USBD_CDC_FRAME_SLOT(next + n)];
+
+    if ((n != 0U) && ((mask & (1UL << (n - 1U))) != 0U))
+    {
+      pslot->Acked = 1U;
+    }
+    else if ((pslot->Acked == 0U) && (pslot->Queued == 0U) && (pslot->Fast == 0U))
+    {
+      /* A later frame arrived without this one, resend it once */
+      pslot->Queued = 1U;
+      pslot->Fast = 1U;
+      hf->Stats.TxRetries++;
+    }
+    else
+    {
+      /* Resent already, the timeout takes over */
+    }
+  }
+}
+
+/**
+  * @brief  USBD_CDC_Frame_Cobs
+  *         COBS encode a body and append the frame delimiter
+  * @param  pdst: destination, len + len / 254 + 2 bytes
+  * @param  psrc: body
+  * @param  len: length of the body
+  * @retval number of bytes written
+  */
+static uint32_t USBD_CDC_Frame_Cobs(uint8_t *pdst, const uint8_t *psrc, uint32_t len)
+{
+  uint32_t code = 0U;
+  uint32_t out = 1U;
+  uint8_t n = 1U;
+
+  for (uint32_t i = 0U; i < len; i++)
+  {
+    if (psrc[i] != 0U)
+    {
+      pdst[out] = psrc[i];
+      out++;
+      n++;
+    }
+
+    /* A 0 byte or a full block closes the block */
+    if ((psrc[i] == 0U) || (n == 0xFFU))
+    {
+      pdst[code] = n;
+      code = out;
+      out++;
+      n = 1U;
+    }
+  }
+
+  pdst[code] = n;
+  pdst[out] = 0U;
+
+  return out + 1U;
+}
+
+/**
+  * @brief  USBD_CDC_Frame_Crc
+  *         CRC-32 as IEEE 802.3 and zlib, a nibble at a time
+  * @param  pbuf: data
+  * @param  len: number of bytes
+  * @retval CRC
+  */
+static uint32_t USBD_CDC_Frame_Crc(const uint8_t *pbuf, uint32_t len)
+{
+  uint32_t crc = 0xFFFFFFFFU;
+
+  for (uint32_t i = 0U; i < len; i++)
+  {
+    crc ^= pbuf[i];
+    crc = (crc >> 4) ^ USBD_CDC_Frame_CrcTable[crc & 0x0FU];
+    crc = (crc >> 4) ^ USBD_CDC_Frame_CrcTable[crc & 0x0FU];
+  }
+
+  return ~crc;
+}
+
+#endif /* (USBD_USE_CDC_FRAME == 1U) */
+
+/********************************** END OF FILE *******************************/
@@ -0,0 +1,159 @@
+/**
+  ******************************************************************************
+  * @file    usbd_cdc_frame.h
+  * @brief   Header for usbd_cdc_frame.c file.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CDC_FRAME_H
+#define __USBD_CDC_FRAME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cdc_acm.h"
+
+#if (USBD_USE_CDC_FRAME == 1U)
+
+/* Exported constants --------------------------------------------------------*/
+
+/* Largest payload of a frame */
+#ifndef USBD_CDC_FRAME_MTU
+#define USBD_CDC_FRAME_MTU                          512U
+#endif /* USBD_CDC_FRAME_MTU */
+
+/* Frames a side may send before the oldest one is acknowledged, a power of
+   two; each one takes a buffer of the MTU on both sides */
+#ifndef USBD_CDC_FRAME_WINDOW
+#define USBD_CDC_FRAME_WINDOW                       8U
+#endif /* USBD_CDC_FRAME_WINDOW */
+
+/* Time a frame waits for its acknowledgement before it is sent again */
+#ifndef USBD_CDC_FRAME_RTO_US
+#define USBD_CDC_FRAME_RTO_US                       20000U
+#endif /* USBD_CDC_FRAME_RTO_US */
+
+/* Frame body: type, sequence number (or acknowledgement), payload, CRC-32 */
+#define USBD_CDC_FRAME_HDR_SIZE                     3U
+#define USBD_CDC_FRAME_CRC_SIZE                     4U
+#define USBD_CDC_FRAME_BODY_MAX                     (USBD_CDC_FRAME_HDR_SIZE + USBD_CDC_FRAME_MTU + \
+                                                     USBD_CDC_FRAME_CRC_SIZE)
+
+/* COBS adds a code byte per 254 bytes and the frame ends with a 0 byte */
+#define USBD_CDC_FRAME_WIRE_MAX                     (USBD_CDC_FRAME_BODY_MAX + \
+                                                     (USBD_CDC_FRAME_BODY_MAX / 254U) + 2U)
+
+#if (USBD_CDC_FRAME_WINDOW == 0U) || (USBD_CDC_FRAME_WINDOW > 32U) || \
+    ((USBD_CDC_FRAME_WINDOW & (USBD_CDC_FRAME_WINDOW - 1U)) != 0U)
+#error "USBD_CDC_FRAME_WINDOW must be a power of two of up to 32, the acknowledgement mask covers 32 frames"
+#endif
+
+#if (USBD_CDC_FRAME_MTU > 65535U) || (USBD_CDC_FRAME_WIRE_MAX > CDC_ACM_TX_RING_SIZE)
+#error "USBD_CDC_FRAME_MTU must let an encoded frame fit in CDC_ACM_TX_RING_SIZE"
+#endif
+
+/* Frame types */
+#define USBD_CDC_FRAME_DATA                         0x01U   /* sequence number, payload */
+#define USBD_CDC_FRAME_ACK                          0x02U   /* next sequence number expected,
+                                                               32-bit mask of the following
+                                                               ones received, frames the
+                                                               receiver takes from there */
+
+/* Exported types ------------------------------------------------------------*/
+
+/* Counters of a framed channel since it was attached */
+typedef struct
+{
+  uint32_t TxFrames;      /* data frames sent, retransmissions included */
+  uint32_t TxRetries;     /* data frames sent again */
+  uint32_t RxFrames;      /* data frames delivered in order */
+  uint32_t RxDuplicates;  /* data frames received again, or out of the window */
+  uint32_t RxErrors;      /* frames with a bad CRC, length or type */
+} USBD_CDC_Frame_StatsTypeDef;
+
+typedef struct
+{
+  uint16_t Len;
+  uint8_t Queued;         /* to be sent, first time or again */
+  uint8_t Acked;          /* selectively acknowledged */
+  uint8_t Fast;           /* sent again for a hole in the acknowledgements */
+  uint32_t Tick;          /* time stamp of the last send */
+  uint8_t Body[USBD_CDC_FRAME_BODY_MAX];
+} USBD_CDC_Frame_TxSlotTypeDef;
+
+typedef struct
+{
+  uint16_t Len;
+  uint8_t Payload[USBD_CDC_FRAME_MTU];
+} USBD_CDC_Frame_RxSlotTypeDef;
+
+/* State of a framed channel, allocated by the application. Payloads are
+   given to Receive in order, from the USB interrupt; one it answers with
+   USBD_BUSY is held and given again from USBD_CDC_Frame_Process, the window
+   announced to the host shrinking meanwhile. */
+typedef struct
+{
+  USBD_StatusTypeDef (*Receive)(uint8_t ch, const uint8_t *pbuf, uint16_t len);
+
+  USBD_HandleTypeDef *pdev;
+  uint8_t Ch;
+  uint8_t Dtr;
+  uint8_t AckPending;               /* an acknowledgement waits for room */
+  uint8_t PeerWindow;               /* receive window announced by the host */
+  uint16_t TxBase;                  /* oldest frame not acknowledged */
+  uint16_t TxNext;                  /* sequence number of the next frame */
+  uint16_t RxNext;                  /* next frame to deliver */
+  uint32_t RxMask;                  /* bit n: frame RxNext + n is held */
+  uint32_t RtoTicks;
+  uint16_t DecLen;                  /* bytes of the frame being decoded */
+  uint8_t DecCode;                  /* bytes left in the COBS block */
+  uint8_t DecZero;                  /* the block ends with a 0 byte */
+  uint8_t DecBad;                   /* dropped until the next delimiter */
+  uint8_t Dec[USBD_CDC_FRAME_BODY_MAX];
+  uint8_t Wire[USBD_CDC_FRAME_WIRE_MAX];
+  USBD_CDC_Frame_TxSlotTypeDef Tx[USBD_CDC_FRAME_WINDOW];
+  USBD_CDC_Frame_RxSlotTypeDef Rx[USBD_CDC_FRAME_WINDOW];
+  USBD_CDC_Frame_StatsTypeDef Stats;
+} USBD_CDC_Frame_HandleTypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+/* Exported functions ------------------------------------------------------- */
+
+USBD_StatusTypeDef USBD_CDC_Frame_Attach(uint8_t ch, USBD_HandleTypeDef *pdev,
+                                         USBD_CDC_Frame_HandleTypeDef *hframe,
+                                         USBD_StatusTypeDef (*receive)(uint8_t ch, const uint8_t *pbuf,
+                                                                       uint16_t len));
+USBD_StatusTypeDef USBD_CDC_Frame_Send(uint8_t ch, const uint8_t *pbuf, uint16_t len);
+uint32_t USBD_CDC_Frame_TxFree(uint8_t ch);
+uint8_t USBD_CDC_Frame_GetStats(uint8_t ch, USBD_CDC_Frame_StatsTypeDef *pstats);
+
+/* Called by the CDC ACM interface */
+void USBD_CDC_Frame_Init(uint8_t ch);
+void USBD_CDC_Frame_DeInit(uint8_t ch);
+void USBD_CDC_Frame_LineState(uint8_t ch);
+USBD_StatusTypeDef USBD_CDC_Frame_Receive(uint8_t ch, uint8_t *pbuf, uint32_t length);
+
+/* Called from the main loop */
+void USBD_CDC_Frame_Process(void);
+
+#endif /* (USBD_USE_CDC_FRAME == 1U) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_CDC_FRAME_H */
+
+/********************************** END OF FILE *******************************/
@@ -124,6 +124,9 @@ uint8_t * USBD_ProductStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
 uint8_t * USBD_SerialStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
 uint8_t * USBD_ConfigStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
 uint8_t * USBD_InterfaceStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
+#if (USBD_LPM_ENABLED == 1)
+uint8_t * USBD_USR_BOSDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
+#endif /* (USBD_LPM_ENABLED == 1) */
 
 /**
   * @}
@@ -143,6 +146,9 @@ USBD_DescriptorsTypeDef USBD_Desc =
 , USBD_SerialStrDescriptor
 , USBD_ConfigStrDescriptor
 , USBD_InterfaceStrDescriptor
+#if (USBD_LPM_ENABLED == 1)
+, USBD_USR_BOSDescriptor
+#endif /* (USBD_LPM_ENABLED == 1) */
 };
 
 #if defined ( __ICCARM__ ) /* IAR Compiler */
@@ -153,7 +159,11 @@ __ALIGN_BEGIN uint8_t USBD_DeviceDesc[USB_LEN_DEV_DESC] __ALIGN_END =
 {
   0x12,                       /*bLength */
   USB_DESC_TYPE_DEVICE,       /*bDescriptorType*/
+#if (USBD_LPM_ENABLED == 1)
+  0x01,                       /*bcdUSB 2.01, the host reads the BOS for LPM*/
+#else
   0x00,                       /*bcdUSB */
+#endif /* (USBD_LPM_ENABLED == 1) */
   0x02,
   0xEF,                       /*bDeviceClass*/
   0x02,                       /*bDeviceSubClass*/
@@ -171,6 +181,30 @@ __ALIGN_BEGIN uint8_t USBD_DeviceDesc[USB_LEN_DEV_DESC] __ALIGN_END =
   USBD_MAX_NUM_CONFIGURATION  /*bNumConfigurations*/
 };
 
+#if (USBD_LPM_ENABLED == 1)
+#if defined ( __ICCARM__ ) /* IAR Compiler */
+  #pragma data_alignment=4
+#endif /* defined ( __ICCARM__ ) */
+/** BOS descriptor. */
+__ALIGN_BEGIN uint8_t USBD_BOSDesc[USB_SIZ_BOS_DESC] __ALIGN_END =
+{
+  0x05,                       /*bLength */
+  USB_DESC_TYPE_BOS,          /*bDescriptorType*/
+  LOBYTE(USB_SIZ_BOS_DESC),   /*wTotalLength*/
+  HIBYTE(USB_SIZ_BOS_DESC),
+  0x01,                       /*bNumDeviceCaps*/
+
+  /* USB 2.0 Extension capability */
+  0x07,                       /*bLength */
+  USB_DEVICE_CAPABITY_TYPE,   /*bDescriptorType*/
+  0x02,                       /*bDevCapabilityType: USB 2.0 Extension*/
+  0x06,                       /*bmAttributes: LPM, BESL*/
+  0x00,
+  0x00,
+  0x00
+};
+#endif /* (USBD_LPM_ENABLED == 1) */
+
 /**
   * @}
   */
@@ -355,8 +389,16 @@ uint8_t * USBD_USR_BOSDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
   */
 static void Get_SerialNum(void)
 {
+  static uint8_t serial_done = 0U;
   uint32_t deviceserial0, deviceserial1, deviceserial2;
 
+  /* The unique ID does not change, build the string on the first request only */
+  if (serial_done != 0U)
+  {
+    return;
+  }
+  serial_done = 1U;
+
   deviceserial0 = *(uint32_t *) DEVICE_ID1;
   deviceserial1 = *(uint32_t *) DEVICE_ID2;
   deviceserial2 = *(uint32_t *) DEVICE_ID3;
@@ -0,0 +1,85 @@
+/**
+  ******************************************************************************
+  * @file    usbd_ipc_if.h
+  * @brief   Header for usbd_ipc_if.c file.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_IPC_IF_H
+#define __USBD_IPC_IF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_composite.h"
+
+#if (USBD_USE_IPC == 1U)
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported constants --------------------------------------------------------*/
+
+/* Hardware semaphores used as doorbells, released by one core to raise the
+   free interrupt of the other */
+#ifndef USBD_IPC_HSEM_SERVICE
+#define USBD_IPC_HSEM_SERVICE                       30U
+#endif /* USBD_IPC_HSEM_SERVICE */
+
+#ifndef USBD_IPC_HSEM_STACK
+#define USBD_IPC_HSEM_STACK                         31U
+#endif /* USBD_IPC_HSEM_STACK */
+
+/* Proxies registered with the classes on the stack side core */
+#if (USBD_USE_MSC == 1)
+extern USBD_StorageTypeDef USBD_IPC_Storage_fops;
+#endif
+#if (USBD_USE_CDC_ACM == 1)
+extern USBD_CDC_ACM_ItfTypeDef USBD_IPC_CDC_ACM_fops;
+#endif
+#if (USBD_USE_CDC_RNDIS == 1)
+extern USBD_CDC_RNDIS_ItfTypeDef USBD_IPC_CDC_RNDIS_fops;
+#endif
+
+/* Exported macro ------------------------------------------------------------*/
+/* Exported functions ------------------------------------------------------- */
+
+/* Stack side core */
+void USBD_IPC_IF_StackInit(USBD_HandleTypeDef *pdev);
+
+/* Service side core */
+void USBD_IPC_IF_ServiceInit(void);
+#if (USBD_USE_MSC == 1)
+void USBD_IPC_RegisterStorage(USBD_StorageTypeDef *fops);
+#endif
+#if (USBD_USE_CDC_ACM == 1)
+void USBD_IPC_RegisterCDC_ACM(USBD_CDC_ACM_ItfTypeDef *fops);
+USBD_StatusTypeDef USBD_IPC_CDC_ACM_Transmit(uint8_t ch, uint8_t *pbuf, uint32_t length);
+#endif
+#if (USBD_USE_CDC_RNDIS == 1)
+void USBD_IPC_RegisterCDC_RNDIS(USBD_CDC_RNDIS_ItfTypeDef *fops);
+USBD_StatusTypeDef USBD_IPC_CDC_RNDIS_Transmit(uint8_t *pbuf, uint32_t length);
+#endif
+
+/* Both cores */
+void USBD_IPC_IF_Process(void);
+
+#endif /* (USBD_USE_IPC == 1U) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_IPC_IF_H */
+
+/********************************** END OF FILE *******************************/
@@ -197,7 +197,9 @@ static int8_t VIDEO_Itf_Control(uint8_t cmd, uint8_t *pbuf, uint16_t length)
   * @brief  TEMPLATE_Data
   *         Manage the UVC data packets
   * @param  pbuf: pointer to the buffer data to be filled
-  * @param  psize: pointer tot he current packet size to be filled
+  * @param  psize: pointer to the current packet size to be filled, holds on
+  *         entry the largest packet the endpoint carries (payload header
+  *         included), a larger size is clamped to it
   * @param  pcktidx: pointer to the current packet index in the current image
   * @retval Result of the operation: USBD_OK if all operations are OK else USBD_FAIL
   */
@@ -125,10 +125,15 @@ typedef struct
 
 extern USBD_ClassTypeDef USBD_AUDIO_MIC;
 
-extern uint8_t AUDIO_MIC_EP;
-extern uint8_t AUDIO_MIC_AC_ITF_NBR;
-extern uint8_t AUDIO_MIC_AS_ITF_NBR;
-extern uint8_t AUDIO_MIC_STR_DESC_IDX;
+/* Instances of the class a device can mount */
+#ifndef USBD_AUDIO_MIC_MAX_INST
+#define USBD_AUDIO_MIC_MAX_INST  1U
+#endif /* USBD_AUDIO_MIC_MAX_INST */
+
+#define AUDIO_MIC_EP(pdev)            (USBD_CLASS_MAP(pdev).in_ep)
+#define AUDIO_MIC_AC_ITF_NBR(pdev)    (USBD_CLASS_MAP(pdev).itf_nbr)
+#define AUDIO_MIC_AS_ITF_NBR(pdev)    ((uint8_t)(USBD_CLASS_MAP(pdev).itf_nbr + 1U))
+#define AUDIO_MIC_STR_DESC_IDX(pdev)  (USBD_CLASS_MAP(pdev).str_idx)
 
 /**
 * @}
@@ -141,7 +146,7 @@ uint8_t USBD_AUDIO_MIC_RegisterInterface(USBD_HandleTypeDef *pdev,
                                          USBD_AUDIO_MIC_ItfTypeDef *fops);
 uint8_t USBD_AUDIO_MIC_Data_Transfer(USBD_HandleTypeDef *pdev, int16_t *audioData, uint16_t dataAmount);
 
-  void USBD_Update_Audio_MIC_DESC(uint8_t *desc,
+  void USBD_Update_Audio_MIC_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc,
                                   uint8_t ac_itf,
                                   uint8_t as_itf,
                                   uint8_t in_ep,
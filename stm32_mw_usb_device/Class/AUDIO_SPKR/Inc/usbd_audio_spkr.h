@@ -101,10 +101,15 @@ extern "C" {
 
   extern USBD_ClassTypeDef USBD_AUDIO_SPKR;
 
-  extern uint8_t AUDIO_SPKR_EP;
-  extern uint8_t AUDIO_SPKR_AC_ITF_NBR;
-  extern uint8_t AUDIO_SPKR_AS_ITF_NBR;
-  extern uint8_t AUDIO_SPKR_STR_DESC_IDX;
+  /* Instances of the class a device can mount */
+  #ifndef USBD_AUDIO_SPKR_MAX_INST
+  #define USBD_AUDIO_SPKR_MAX_INST  1U
+  #endif /* USBD_AUDIO_SPKR_MAX_INST */
+
+  #define AUDIO_SPKR_EP(pdev)            (USBD_CLASS_MAP(pdev).out_ep)
+  #define AUDIO_SPKR_AC_ITF_NBR(pdev)    (USBD_CLASS_MAP(pdev).itf_nbr)
+  #define AUDIO_SPKR_AS_ITF_NBR(pdev)    ((uint8_t)(USBD_CLASS_MAP(pdev).itf_nbr + 1U))
+  #define AUDIO_SPKR_STR_DESC_IDX(pdev)  (USBD_CLASS_MAP(pdev).str_idx)
 
   /**
   * @}
@@ -118,7 +123,7 @@ extern "C" {
 
   void USBD_AUDIO_SPKR_Sync(USBD_HandleTypeDef *pdev, AUDIO_OffsetTypeDef offset);
 
-  void USBD_Update_Audio_SPKR_DESC(uint8_t *desc,
+  void USBD_Update_Audio_SPKR_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc,
                                    uint8_t ac_itf,
                                    uint8_t as_itf,
                                    uint8_t out_ep,
@@ -87,9 +87,9 @@ static uint8_t USBD_BB_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum);
 static uint8_t USBD_BB_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum);
 static uint8_t USBD_BB_EP0_RxReady(USBD_HandleTypeDef *pdev);
 
-static uint8_t *USBD_BB_GetCfgDesc(uint16_t *length);
-static uint8_t *USBD_BB_GetDeviceQualifierDesc(uint16_t *length);
-static uint8_t *USBD_BB_GetOtherSpeedCfgDesc(uint16_t *length);
+static uint8_t *USBD_BB_GetCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_BB_GetDeviceQualifierDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_BB_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
 
 #if (USBD_CLASS_BOS_ENABLED == 1)
 USBD_BB_DescHeader_t *USBD_BB_GetNextDesc(uint8_t *pbuf, uint16_t *ptr);
@@ -355,11 +355,14 @@ static uint8_t USBD_BB_EP0_RxReady(USBD_HandleTypeDef *pdev)
   * @brief  USBD_BB_GetCfgDesc
   *         return configuration descriptor
   * @param  speed : current device speed
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_BB_GetCfgDesc(uint16_t *length)
+static uint8_t *USBD_BB_GetCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_BB_CfgDesc);
   return USBD_BB_CfgDesc;
 }
@@ -367,11 +370,14 @@ static uint8_t *USBD_BB_GetCfgDesc(uint16_t *length)
 /**
   * @brief  USBD_BB_GetOtherSpeedCfgDesc
   *         return other speed configuration descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-uint8_t *USBD_BB_GetOtherSpeedCfgDesc(uint16_t *length)
+uint8_t *USBD_BB_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_BB_OtherSpeedCfgDesc);
   return USBD_BB_OtherSpeedCfgDesc;
 }
@@ -379,11 +385,14 @@ uint8_t *USBD_BB_GetOtherSpeedCfgDesc(uint16_t *length)
 /**
   * @brief  DeviceQualifierDescriptor
   *         return Device Qualifier descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_BB_GetDeviceQualifierDesc(uint16_t *length)
+static uint8_t *USBD_BB_GetDeviceQualifierDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_BB_DeviceQualifierDesc);
   return USBD_BB_DeviceQualifierDesc;
 }
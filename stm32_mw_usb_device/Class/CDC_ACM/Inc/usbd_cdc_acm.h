@@ -59,7 +59,8 @@ extern "C" {
 #define CDC_DATA_FS_MAX_PACKET_SIZE                 64U  /* Endpoint IN & OUT Packet size */
 #define CDC_CMD_PACKET_SIZE                         8U  /* Control Endpoint Packet size */
 
-#define USB_CDC_CONFIG_DESC_SIZ                     (9 + 66 * NUMBER_OF_CDC)
+#define CDC_ACM_PORT_DESC_SIZ                       66U  /* IAD, two interfaces and three endpoints */
+#define USB_CDC_CONFIG_DESC_SIZ                     (9U + (CDC_ACM_PORT_DESC_SIZ * NUMBER_OF_CDC))
 #define CDC_DATA_HS_IN_PACKET_SIZE                  CDC_DATA_HS_MAX_PACKET_SIZE
 #define CDC_DATA_HS_OUT_PACKET_SIZE                 CDC_DATA_HS_MAX_PACKET_SIZE
 
@@ -67,6 +68,116 @@ extern "C" {
 #define CDC_DATA_FS_OUT_PACKET_SIZE                 CDC_DATA_FS_MAX_PACKET_SIZE
 
 #define CDC_REQ_MAX_DATA_SIZE                       0x7U
+
+/* 1 sends the SERIAL_STATE notifications of USBD_CDC_SetSerialState and
+   USBD_CDC_ReportSerialEvent on the interrupt IN endpoint of each channel.
+   0 compiles them out, the state is only kept: the endpoint then carries
+   nothing and the composite planner may leave it out when short of
+   endpoints, at the cost of hosts that require it (Linux cdc_acm) */
+#ifndef CDC_ACM_NOTIFY
+#define CDC_ACM_NOTIFY                              1U
+#endif /* CDC_ACM_NOTIFY */
+
+/* 1 keeps the notification endpoint on channel 0 only, N channels then take
+   N + 1 IN endpoints instead of 2 N. A host driver only takes SERIAL_STATE
+   for its own interface from its own endpoint, so this needs the
+   notifications compiled out (CDC_ACM_NOTIFY 0U) */
+#ifndef CDC_ACM_SHARED_NOTIFY
+#define CDC_ACM_SHARED_NOTIFY                       0U
+#endif /* CDC_ACM_SHARED_NOTIFY */
+
+#if (CDC_ACM_SHARED_NOTIFY == 1U) && (CDC_ACM_NOTIFY == 1U)
+#error "CDC_ACM_SHARED_NOTIFY needs CDC_ACM_NOTIFY 0U, a channel notifies on its own endpoint"
+#endif
+
+/* Number of IN transfers a channel may have queued on its data endpoint */
+#ifndef CDC_ACM_TX_QUEUE_DEPTH
+#define CDC_ACM_TX_QUEUE_DEPTH                      2U
+#endif /* CDC_ACM_TX_QUEUE_DEPTH */
+
+/* Receive buffers of a channel. The OUT endpoint is armed with a free one as
+   soon as a packet lands, the filled one belongs to the application until
+   it gives it back */
+#ifndef CDC_ACM_RX_POOL_DEPTH
+#define CDC_ACM_RX_POOL_DEPTH                       4U
+#endif /* CDC_ACM_RX_POOL_DEPTH */
+
+#if (CDC_ACM_RX_POOL_DEPTH == 0U) || (CDC_ACM_RX_POOL_DEPTH > 32U)
+#error "CDC_ACM_RX_POOL_DEPTH must be between 1 and 32"
+#endif
+
+/* Bytes the OUT endpoint is armed for at once, a multiple of
+   CDC_DATA_HS_OUT_PACKET_SIZE. The transfer ends on a short packet or when
+   the buffer is full, so a stream raises one Receive per buffer instead of
+   one per packet; 0 arms a single packet */
+#ifndef CDC_ACM_RX_XFER_SIZE
+#define CDC_ACM_RX_XFER_SIZE                        0U
+#endif /* CDC_ACM_RX_XFER_SIZE */
+
+#if ((CDC_ACM_RX_XFER_SIZE % CDC_DATA_HS_OUT_PACKET_SIZE) != 0U) || \
+    ((CDC_ACM_RX_XFER_SIZE / CDC_DATA_FS_OUT_PACKET_SIZE) > 1023U)
+#error "CDC_ACM_RX_XFER_SIZE must be a multiple of CDC_DATA_HS_OUT_PACKET_SIZE, of up to 1023 full speed packets"
+#endif
+
+#if (CDC_ACM_RX_XFER_SIZE != 0U)
+#define CDC_ACM_RX_BUFFER_SIZE                      CDC_ACM_RX_XFER_SIZE
+#else
+#define CDC_ACM_RX_BUFFER_SIZE                      CDC_DATA_HS_OUT_PACKET_SIZE
+#endif /* (CDC_ACM_RX_XFER_SIZE != 0U) */
+
+/* Transmit ring of a channel, filled by USBD_CDC_TxWrite and drained by the
+   stack in transfers of whole packets */
+#ifndef CDC_ACM_TX_RING_SIZE
+#define CDC_ACM_TX_RING_SIZE                        1024U
+#endif /* CDC_ACM_TX_RING_SIZE */
+
+/* Default number of max size packets one ring transfer may chain */
+#ifndef CDC_ACM_TX_CHAIN_PACKETS
+#define CDC_ACM_TX_CHAIN_PACKETS                    4U
+#endif /* CDC_ACM_TX_CHAIN_PACKETS */
+
+/* Default number of SOF periods a partial packet waits in the ring for more
+   data before it is sent, 0 sends it at once */
+#ifndef CDC_ACM_TX_FLUSH_SOF
+#define CDC_ACM_TX_FLUSH_SOF                        1U
+#endif /* CDC_ACM_TX_FLUSH_SOF */
+
+#if ((CDC_ACM_TX_RING_SIZE & (CDC_ACM_TX_RING_SIZE - 1U)) != 0U) || \
+    (CDC_ACM_TX_RING_SIZE < CDC_DATA_FS_MAX_PACKET_SIZE)
+#error "CDC_ACM_TX_RING_SIZE must be a power of two of at least CDC_DATA_FS_MAX_PACKET_SIZE"
+#endif
+
+/* 1 sends the data transfers of all channels through a deficit round-robin
+   scheduler, a channel that transmits often cannot starve the others */
+#ifndef CDC_ACM_TX_SCHED
+#define CDC_ACM_TX_SCHED                            0U
+#endif /* CDC_ACM_TX_SCHED */
+
+/* Scheduled transfers of all channels submitted to the endpoints at once */
+#ifndef CDC_ACM_TX_SCHED_SLOTS
+#define CDC_ACM_TX_SCHED_SLOTS                      2U
+#endif /* CDC_ACM_TX_SCHED_SLOTS */
+
+/* Bytes a channel of weight 1 may send per round */
+#ifndef CDC_ACM_TX_SCHED_QUANTUM
+#define CDC_ACM_TX_SCHED_QUANTUM                    2048U
+#endif /* CDC_ACM_TX_SCHED_QUANTUM */
+
+/* Weight of a channel until USBD_CDC_SetTxWeight */
+#ifndef CDC_ACM_TX_SCHED_WEIGHT
+#define CDC_ACM_TX_SCHED_WEIGHT                     1U
+#endif /* CDC_ACM_TX_SCHED_WEIGHT */
+
+#if (CDC_ACM_TX_SCHED_SLOTS == 0U) || (CDC_ACM_TX_SCHED_QUANTUM == 0U) || \
+    (CDC_ACM_TX_SCHED_WEIGHT == 0U) || (CDC_ACM_TX_SCHED_WEIGHT > 255U)
+#error "CDC_ACM_TX_SCHED_SLOTS, _QUANTUM and _WEIGHT must not be 0, the weight fits in 8 bits"
+#endif
+
+/* 1 holds the transmit ring while the host keeps RTS low, for hosts that
+   run hardware flow control on the virtual port */
+#ifndef CDC_ACM_TX_RTS_FLOW
+#define CDC_ACM_TX_RTS_FLOW                         0U
+#endif /* CDC_ACM_TX_RTS_FLOW */
 /*---------------------------------------------------------------------*/
 /*  CDC definitions                                                    */
 /*---------------------------------------------------------------------*/
@@ -80,6 +191,26 @@ extern "C" {
 #define CDC_SET_CONTROL_LINE_STATE                  0x22U
 #define CDC_SEND_BREAK                              0x23U
 
+/* Notification sent on the command endpoint */
+#define CDC_SERIAL_STATE                            0x20U
+#define CDC_SERIAL_STATE_SIZE                       10U
+
+/* SERIAL_STATE bits, DCD and DSR are levels, the others are reported once
+   per event */
+#define CDC_SERIAL_STATE_DCD                        0x0001U
+#define CDC_SERIAL_STATE_DSR                        0x0002U
+#define CDC_SERIAL_STATE_BREAK                      0x0004U
+#define CDC_SERIAL_STATE_RING                       0x0008U
+#define CDC_SERIAL_STATE_FRAMING                    0x0010U
+#define CDC_SERIAL_STATE_PARITY                     0x0020U
+#define CDC_SERIAL_STATE_OVERRUN                    0x0040U
+
+#define CDC_SERIAL_STATE_LEVELS                     (CDC_SERIAL_STATE_DCD | CDC_SERIAL_STATE_DSR)
+
+/* SET_CONTROL_LINE_STATE wValue bits */
+#define CDC_CONTROL_LINE_DTR                        0x0001U
+#define CDC_CONTROL_LINE_RTS                        0x0002U
+
   /**
   * @}
   */
@@ -99,6 +230,16 @@ extern "C" {
     uint8_t datatype;
   } USBD_CDC_ACM_LineCodingTypeDef;
 
+  /* Transmit counters of a scheduled channel, the wait is counted in SOF
+     periods from the transfer being queued to its submission */
+  typedef struct
+  {
+    uint32_t Bytes;
+    uint32_t Transfers;
+    uint32_t WaitSum;
+    uint32_t WaitMax;
+  } USBD_CDC_ACM_TxStatsTypeDef;
+
   typedef struct _USBD_CDC_Itf
   {
     int8_t (*Init)(uint8_t cdc_ch);
@@ -108,18 +249,54 @@ extern "C" {
     int8_t (*TransmitCplt)(uint8_t cdc_ch, uint8_t *Buf, uint32_t *Len, uint8_t epnum);
   } USBD_CDC_ACM_ItfTypeDef;
 
+  /* State of a channel, touched on every transfer. The receive pool, the
+     transmit ring and the notification live apart in the class driver, so
+     the handles of all channels stay packed: about 210 bytes each on a
+     32-bit core, 120 of them the three transmit descriptors the endpoint
+     queues link */
   typedef struct
   {
-    uint32_t data[NUMBER_OF_CDC][CDC_DATA_HS_MAX_PACKET_SIZE / 4U]; /* Force 32bits alignment */
-    uint8_t CmdOpCode;
-    uint8_t CmdLength;
-    uint8_t *RxBuffer;
     uint8_t *TxBuffer;
-    uint32_t RxLength;
     uint32_t TxLength;
 
     __IO uint32_t TxState;
-    __IO uint32_t RxState;
+    __IO uint32_t RxState;      /* 1 while a pool buffer is armed on the OUT endpoint */
+#if (USBD_USE_OS == 1U)
+    uint32_t RxOffset;          /* bytes of the oldest held buffer already read */
+#endif /* (USBD_USE_OS == 1U) */
+
+    uint32_t RxPoolLen[CDC_ACM_RX_POOL_DEPTH];
+    uint32_t RxPoolSeq[CDC_ACM_RX_POOL_DEPTH];  /* fill order of held buffers */
+    uint32_t RxFree;            /* free buffers, one bit each */
+    uint32_t RxHeld;            /* buffers with the application, one bit each */
+    uint32_t RxSeq;
+    uint8_t RxArmed;            /* buffer armed on the OUT endpoint */
+    uint8_t RxThrottle;         /* 1 while the application keeps the OUT endpoint NAKing */
+
+    USBD_XferTypeDef TxXfer[CDC_ACM_TX_QUEUE_DEPTH];
+
+    __IO uint32_t TxHead;       /* ring write index, free running */
+    __IO uint32_t TxTail;       /* ring read index, free running */
+    uint16_t TxAge;             /* SOF periods the ring data has waited */
+    uint16_t TxFlushSof;        /* SOF periods a partial packet may wait */
+    uint16_t TxChain;           /* max size packets per ring transfer */
+    USBD_XferTypeDef TxRingXfer;
+
+    uint16_t LineState;         /* DTR and RTS set by the host */
+    uint16_t SerialLevels;      /* DCD and DSR to report */
+    uint16_t SerialEvents;      /* events not reported yet */
+    uint16_t SerialSent;        /* levels the host last saw */
+
+#if (CDC_ACM_TX_SCHED == 1U)
+    USBD_XferTypeDef *TxPendHead;   /* transfers waiting for the scheduler */
+    USBD_XferTypeDef *TxPendTail;
+    uint32_t TxStamp[CDC_ACM_TX_QUEUE_DEPTH + 1U];  /* SOF period each one was queued in */
+    uint32_t TxDeficit;             /* bytes the channel may still send this round */
+    uint8_t TxStampFirst;
+    uint8_t TxPendCount;
+    uint8_t TxWeight;
+    USBD_CDC_ACM_TxStatsTypeDef TxStats;
+#endif /* (CDC_ACM_TX_SCHED == 1U) */
   } USBD_CDC_ACM_HandleTypeDef;
 
   /** @defgroup USBD_CORE_Exported_Macros
@@ -136,14 +313,15 @@ extern "C" {
 
   extern USBD_ClassTypeDef USBD_CDC_ACM;
 
-  extern uint8_t CDC_IN_EP[NUMBER_OF_CDC];  /* EP1 for data IN */
-  extern uint8_t CDC_OUT_EP[NUMBER_OF_CDC]; /* EP1 for data OUT */
-  extern uint8_t CDC_CMD_EP[NUMBER_OF_CDC]; /* EP2 for CDC commands */
+  extern USBD_ClassMapTypeDef CDC_ACM_Map[USBD_MAX_NUM_DEV][NUMBER_OF_CDC];
 
-  extern uint8_t CDC_CMD_ITF_NBR[NUMBER_OF_CDC]; /* Command Interface Number */
-  extern uint8_t CDC_COM_ITF_NBR[NUMBER_OF_CDC]; /* Communication Interface Number */
+#define CDC_IN_EP(pdev, ch)         (CDC_ACM_Map[USBD_DEV_IDX(pdev)][(ch)].in_ep)
+#define CDC_OUT_EP(pdev, ch)        (CDC_ACM_Map[USBD_DEV_IDX(pdev)][(ch)].out_ep)
+#define CDC_CMD_EP(pdev, ch)        (CDC_ACM_Map[USBD_DEV_IDX(pdev)][(ch)].cmd_ep)
+#define CDC_CMD_ITF_NBR(pdev, ch)   (CDC_ACM_Map[USBD_DEV_IDX(pdev)][(ch)].itf_nbr)
+#define CDC_COM_ITF_NBR(pdev, ch)   ((uint8_t)(CDC_ACM_Map[USBD_DEV_IDX(pdev)][(ch)].itf_nbr + 1U))
+#define CDC_STR_DESC_IDX(pdev, ch)  (CDC_ACM_Map[USBD_DEV_IDX(pdev)][(ch)].str_idx)
 
-  extern uint8_t CDC_STR_DESC_IDX[NUMBER_OF_CDC];
 
   /**
   * @}
@@ -160,9 +338,35 @@ extern "C" {
 
   uint8_t USBD_CDC_SetRxBuffer(uint8_t ch, USBD_HandleTypeDef *pdev, uint8_t *pbuff);
   uint8_t USBD_CDC_ReceivePacket(uint8_t ch, USBD_HandleTypeDef *pdev);
+  uint8_t USBD_CDC_ReleaseRxBuffer(uint8_t ch, USBD_HandleTypeDef *pdev, uint8_t *pbuff);
   uint8_t USBD_CDC_TransmitPacket(uint8_t ch, USBD_HandleTypeDef *pdev);
 
-  void USBD_Update_CDC_ACM_DESC(uint8_t *desc,
+  uint32_t USBD_CDC_TxWrite(uint8_t ch, USBD_HandleTypeDef *pdev, const uint8_t *pbuf,
+                            uint32_t length);
+  uint32_t USBD_CDC_TxFree(uint8_t ch, USBD_HandleTypeDef *pdev);
+  uint8_t USBD_CDC_TxFlush(uint8_t ch, USBD_HandleTypeDef *pdev);
+  uint8_t USBD_CDC_SetTxCoalescing(uint8_t ch, USBD_HandleTypeDef *pdev,
+                                   uint16_t chain, uint16_t flush_sof);
+
+#if (CDC_ACM_TX_SCHED == 1U)
+  uint8_t USBD_CDC_SetTxWeight(uint8_t ch, USBD_HandleTypeDef *pdev, uint8_t weight);
+  uint8_t USBD_CDC_GetTxStats(uint8_t ch, USBD_HandleTypeDef *pdev,
+                              USBD_CDC_ACM_TxStatsTypeDef *pstats, uint8_t clear);
+#endif /* (CDC_ACM_TX_SCHED == 1U) */
+
+  uint8_t USBD_CDC_SetRxThrottle(uint8_t ch, USBD_HandleTypeDef *pdev, uint8_t throttle);
+  uint16_t USBD_CDC_GetLineState(uint8_t ch, USBD_HandleTypeDef *pdev);
+  uint8_t USBD_CDC_SetSerialState(uint8_t ch, USBD_HandleTypeDef *pdev, uint16_t levels);
+  uint8_t USBD_CDC_ReportSerialEvent(uint8_t ch, USBD_HandleTypeDef *pdev, uint16_t events);
+
+#if (USBD_USE_OS == 1U)
+  uint8_t USBD_CDC_Write(uint8_t ch, USBD_HandleTypeDef *pdev, uint8_t *pbuf,
+                         uint32_t length, uint32_t timeout);
+  uint8_t USBD_CDC_Read(uint8_t ch, USBD_HandleTypeDef *pdev, uint8_t *pbuf,
+                        uint32_t *length, uint32_t timeout);
+#endif /* (USBD_USE_OS == 1U) */
+
+  void USBD_Update_CDC_ACM_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc,
                                 uint8_t cmd_itf,
                                 uint8_t com_itf,
                                 uint8_t in_ep,
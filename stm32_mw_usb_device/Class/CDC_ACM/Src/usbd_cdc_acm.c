@@ -59,23 +59,7 @@ EndBSPDependencies */
 #include "usbd_cdc_acm.h"
 #include "usbd_ctlreq.h"
 
-#define _CDC_IN_EP 0x81U  /* EP1 for data IN */
-#define _CDC_OUT_EP 0x01U /* EP1 for data OUT */
-#define _CDC_CMD_EP 0x82U /* EP2 for CDC commands */
-
-#define _CDC_CMD_ITF_NBR 0x00U /* Command Interface Number */
-#define _CDC_COM_ITF_NBR 0x01U /* Communication Interface Number */
-
-#define _CDC_STR_DESC_IDX 0x00
-
-uint8_t CDC_IN_EP[NUMBER_OF_CDC];
-uint8_t CDC_OUT_EP[NUMBER_OF_CDC];
-uint8_t CDC_CMD_EP[NUMBER_OF_CDC];
-
-uint8_t CDC_CMD_ITF_NBR[NUMBER_OF_CDC];
-uint8_t CDC_COM_ITF_NBR[NUMBER_OF_CDC];
-
-uint8_t CDC_STR_DESC_IDX[NUMBER_OF_CDC];
+USBD_ClassMapTypeDef CDC_ACM_Map[USBD_MAX_NUM_DEV][NUMBER_OF_CDC];
 
 /** @addtogroup STM32_USB_DEVICE_LIBRARY
   * @{
@@ -89,6 +73,39 @@ uint8_t CDC_STR_DESC_IDX[NUMBER_OF_CDC];
 /** @defgroup USBD_CDC_Private_TypesDefinitions
   * @{
   */
+
+/* Data stage of a class request, EP0 serves the channels one at a time */
+typedef struct
+{
+  uint32_t data[USB_MAX_EP0_SIZE / 4U]; /* Force 32bits alignment */
+  uint8_t CmdOpCode;
+  uint8_t CmdLength;
+  uint8_t CmdCh;
+} USBD_CDC_ACM_CtrlTypeDef;
+
+/* Memory of a channel the core moves data in and out of, and the serial
+   state notification, kept out of USBD_CDC_ACM_HandleTypeDef */
+typedef struct
+{
+  uint32_t RxPool[CDC_ACM_RX_POOL_DEPTH][CDC_ACM_RX_BUFFER_SIZE / 4U];
+  uint32_t TxRing[CDC_ACM_TX_RING_SIZE / 4U];
+#if (CDC_ACM_NOTIFY == 1U)
+  uint32_t Notify[(CDC_SERIAL_STATE_SIZE + 3U) / 4U];
+  USBD_XferTypeDef NotifyXfer;
+#endif /* (CDC_ACM_NOTIFY == 1U) */
+} USBD_CDC_ACM_BufferTypeDef;
+
+#if (CDC_ACM_TX_SCHED == 1U)
+/* Deficit round-robin over the data IN transfers of the channels */
+typedef struct
+{
+  uint32_t Frame;     /* SOF periods, time base of the wait counters */
+  uint8_t InFlight;   /* scheduled transfers submitted to the endpoints */
+  uint8_t Next;       /* channel the round is at */
+  uint8_t Credited;   /* 1 once Next got its quantum for this visit */
+} USBD_CDC_ACM_SchedTypeDef;
+#endif /* (CDC_ACM_TX_SCHED == 1U) */
+
 /**
   * @}
   */
@@ -104,6 +121,15 @@ uint8_t CDC_STR_DESC_IDX[NUMBER_OF_CDC];
   * @{
   */
 
+/* Transfers of the channel wait for a scheduler slot */
+#if (CDC_ACM_TX_SCHED == 1U)
+#define CDC_TX_WAITING(hcdc)                        ((hcdc)->TxPendHead != NULL)
+#else
+#define CDC_TX_WAITING(hcdc)                        0U
+#endif /* (CDC_ACM_TX_SCHED == 1U) */
+
+#define CDC_BUF(pdev, ch)                           (&CDC_ACM_Buffer[USBD_DEV_IDX(pdev)][(ch)])
+
 /**
   * @}
   */
@@ -118,14 +144,45 @@ static uint8_t USBD_CDC_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *re
 static uint8_t USBD_CDC_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum);
 static uint8_t USBD_CDC_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum);
 static uint8_t USBD_CDC_EP0_RxReady(USBD_HandleTypeDef *pdev);
-
-static uint8_t *USBD_CDC_GetFSCfgDesc(uint16_t *length);
-static uint8_t *USBD_CDC_GetHSCfgDesc(uint16_t *length);
-static uint8_t *USBD_CDC_GetOtherSpeedCfgDesc(uint16_t *length);
-static uint8_t *USBD_CDC_GetOtherSpeedCfgDesc(uint16_t *length);
-static uint8_t *USBD_CDC_GetDeviceQualifierDescriptor(uint16_t *length);
-
-USBD_CDC_ACM_HandleTypeDef CDC_ACM_Class_Data[NUMBER_OF_CDC];
+static uint8_t USBD_CDC_SOF(USBD_HandleTypeDef *pdev);
+static void USBD_CDC_TxCplt(USBD_HandleTypeDef *pdev, USBD_XferTypeDef *xfer);
+static void USBD_CDC_TxRingCplt(USBD_HandleTypeDef *pdev, USBD_XferTypeDef *xfer);
+static void USBD_CDC_TxKick(USBD_HandleTypeDef *pdev, uint8_t ch, uint8_t force);
+static USBD_StatusTypeDef USBD_CDC_TxSubmit(USBD_HandleTypeDef *pdev, uint8_t ch,
+                                            USBD_XferTypeDef *xfer);
+#if (CDC_ACM_TX_SCHED == 1U)
+static void USBD_CDC_TxSchedule(USBD_HandleTypeDef *pdev);
+static void USBD_CDC_TxRetire(USBD_HandleTypeDef *pdev, USBD_XferTypeDef *xfer);
+#endif /* (CDC_ACM_TX_SCHED == 1U) */
+#if (CDC_ACM_NOTIFY == 1U)
+static void USBD_CDC_NotifyCplt(USBD_HandleTypeDef *pdev, USBD_XferTypeDef *xfer);
+#endif /* (CDC_ACM_NOTIFY == 1U) */
+static void USBD_CDC_NotifyKick(USBD_HandleTypeDef *pdev, uint8_t ch);
+static void USBD_CDC_RxArm(USBD_HandleTypeDef *pdev, uint8_t ch);
+static uint8_t USBD_CDC_RxOldest(USBD_CDC_ACM_HandleTypeDef *hcdc);
+static uint8_t USBD_CDC_ItfToCh(USBD_HandleTypeDef *pdev, uint8_t itf);
+static uint8_t USBD_CDC_OutEpToCh(USBD_HandleTypeDef *pdev, uint8_t epnum);
+static void USBD_CDC_SetPortDesc(uint8_t *pdesc, USBD_ClassMapTypeDef *pmap);
+static uint8_t *USBD_CDC_GetCfgDesc(USBD_HandleTypeDef *pdev, uint8_t speed, uint16_t *length);
+static void USBD_CDC_RxRelease(USBD_HandleTypeDef *pdev, uint8_t ch, uint8_t idx);
+#if (USBD_USE_OS == 1U)
+static uint8_t USBD_CDC_OS_TxAlloc(void *arg);
+static uint8_t USBD_CDC_OS_TxDone(void *arg);
+static uint8_t USBD_CDC_OS_RxReady(void *arg);
+#endif /* (USBD_USE_OS == 1U) */
+
+static uint8_t *USBD_CDC_GetFSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_CDC_GetHSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_CDC_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_CDC_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_CDC_GetDeviceQualifierDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length);
+
+USBD_CDC_ACM_HandleTypeDef CDC_ACM_Class_Data[USBD_MAX_NUM_DEV][NUMBER_OF_CDC];
+static USBD_CDC_ACM_CtrlTypeDef CDC_ACM_Ctrl[USBD_MAX_NUM_DEV];
+static USBD_CDC_ACM_BufferTypeDef CDC_ACM_Buffer[USBD_MAX_NUM_DEV][NUMBER_OF_CDC];
+#if (CDC_ACM_TX_SCHED == 1U)
+static USBD_CDC_ACM_SchedTypeDef CDC_ACM_Sched[USBD_MAX_NUM_DEV];
+#endif /* (CDC_ACM_TX_SCHED == 1U) */
 
 /* USB Standard Device Descriptor */
 __ALIGN_BEGIN static uint8_t USBD_CDC_DeviceQualifierDesc[USB_LEN_DEV_QUALIFIER_DESC] __ALIGN_END =
@@ -160,7 +217,7 @@ USBD_ClassTypeDef USBD_CDC_ACM =
         USBD_CDC_EP0_RxReady,
         USBD_CDC_DataIn,
         USBD_CDC_DataOut,
-        NULL,
+        USBD_CDC_SOF,
         NULL,
         NULL,
         USBD_CDC_GetHSCfgDesc,
@@ -169,45 +226,30 @@ USBD_ClassTypeDef USBD_CDC_ACM =
         USBD_CDC_GetDeviceQualifierDescriptor,
 };
 
-/* USB CDC device Configuration Descriptor */
-__ALIGN_BEGIN static uint8_t USBD_CDC_CfgHSDesc[USB_CDC_CONFIG_DESC_SIZ] __ALIGN_END =
+/* Function block of one channel, the interfaces, endpoints and string are
+   filled in from the channel map and the packet sizes from the speed */
+static const uint8_t USBD_CDC_PortDesc[CDC_ACM_PORT_DESC_SIZ] =
     {
-        /* Configuration Descriptor */
-        0x09,                            /* bLength: Configuration Descriptor size */
-        USB_DESC_TYPE_CONFIGURATION,     /* bDescriptorType: Configuration */
-        LOBYTE(USB_CDC_CONFIG_DESC_SIZ), /* wTotalLength:no of returned bytes */
-        HIBYTE(USB_CDC_CONFIG_DESC_SIZ),
-        (2 * NUMBER_OF_CDC), /* bNumInterfaces: 2 interface */
-        0x01,                /* bConfigurationValue: Configuration value */
-        0x00,                /* iConfiguration: Index of string descriptor describing the configuration */
-#if (USBD_SELF_POWERED == 1U)
-        0xC0, /* bmAttributes: Bus Powered according to user configuration */
-#else
-        0x80, /* bmAttributes: Bus Powered according to user configuration */
-#endif
-        USBD_MAX_POWER, /* MaxPower 100 mA */
-
-        /********************  CDC0 block ********************/
         /******** IAD to associate the two CDC interfaces */
-        0x08,             /* bLength */
-        0x0B,             /* bDescriptorType */
-        _CDC_CMD_ITF_NBR, /* bFirstInterface */
-        0x02,             /* bInterfaceCount */
-        0x02,             /* bFunctionClass */
-        0x02,             /* bFunctionSubClass */
-        0x01,             /* bFunctionProtocol */
-        0x00,             /* iFunction (Index of string descriptor describing this function) */
+        0x08, /* bLength */
+        0x0B, /* bDescriptorType */
+        0x00, /* bFirstInterface */
+        0x02, /* bInterfaceCount */
+        0x02, /* bFunctionClass */
+        0x02, /* bFunctionSubClass */
+        0x01, /* bFunctionProtocol */
+        0x00, /* iFunction (Index of string descriptor describing this function) */
 
         /* Interface Descriptor */
         0x09,                    /* bLength: Interface Descriptor size */
         USB_DESC_TYPE_INTERFACE, /* bDescriptorType: Interface */
-        _CDC_CMD_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
+        0x00,                    /* bInterfaceNumber: Number of Interface */
         0x00,                    /* bAlternateSetting: Alternate setting */
         0x01,                    /* bNumEndpoints: One endpoints used */
         0x02,                    /* bInterfaceClass: Communication Interface Class */
         0x02,                    /* bInterfaceSubClass: Abstract Control Model */
         0x01,                    /* bInterfaceProtocol: Common AT commands */
-        _CDC_STR_DESC_IDX,       /* iInterface: */
+        0x00,                    /* iInterface: */
 
         /* Header Functional Descriptor */
         0x05, /* bLength: Endpoint Descriptor size */
@@ -217,11 +259,11 @@ __ALIGN_BEGIN static uint8_t USBD_CDC_CfgHSDesc[USB_CDC_CONFIG_DESC_SIZ] __ALIGN
         0x01,
 
         /* Call Management Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x01,             /* bDescriptorSubtype: Call Management Func Desc */
-        0x00,             /* bmCapabilities: D0+D1 */
-        _CDC_COM_ITF_NBR, /* bDataInterface: 1 */
+        0x05, /* bFunctionLength */
+        0x24, /* bDescriptorType: CS_INTERFACE */
+        0x01, /* bDescriptorSubtype: Call Management Func Desc */
+        0x00, /* bmCapabilities: D0+D1 */
+        0x00, /* bDataInterface */
 
         /* ACM Functional Descriptor */
         0x04, /* bFunctionLength */
@@ -230,16 +272,16 @@ __ALIGN_BEGIN static uint8_t USBD_CDC_CfgHSDesc[USB_CDC_CONFIG_DESC_SIZ] __ALIGN
         0x02, /* bmCapabilities */
 
         /* Union Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x06,             /* bDescriptorSubtype: Union func desc */
-        _CDC_CMD_ITF_NBR, /* bMasterInterface: Communication class interface */
-        _CDC_COM_ITF_NBR, /* bSlaveInterface0: Data Class Interface */
+        0x05, /* bFunctionLength */
+        0x24, /* bDescriptorType: CS_INTERFACE */
+        0x06, /* bDescriptorSubtype: Union func desc */
+        0x00, /* bMasterInterface: Communication class interface */
+        0x00, /* bSlaveInterface0: Data Class Interface */
 
-        /* Endpoint 2 Descriptor */
+        /* Notification Endpoint Descriptor */
         0x07,                        /* bLength: Endpoint Descriptor size */
         USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
-        _CDC_CMD_EP,                 /* bEndpointAddress */
+        0x00,                        /* bEndpointAddress */
         0x03,                        /* bmAttributes: Interrupt */
         LOBYTE(CDC_CMD_PACKET_SIZE), /* wMaxPacketSize: */
         HIBYTE(CDC_CMD_PACKET_SIZE),
@@ -249,7 +291,7 @@ __ALIGN_BEGIN static uint8_t USBD_CDC_CfgHSDesc[USB_CDC_CONFIG_DESC_SIZ] __ALIGN
         /* Data class interface descriptor */
         0x09,                    /* bLength: Endpoint Descriptor size */
         USB_DESC_TYPE_INTERFACE, /* bDescriptorType: */
-        _CDC_COM_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
+        0x00,                    /* bInterfaceNumber: Number of Interface */
         0x00,                    /* bAlternateSetting: Alternate setting */
         0x02,                    /* bNumEndpoints: Two endpoints used */
         0x0A,                    /* bInterfaceClass: CDC */
@@ -260,7 +302,7 @@ __ALIGN_BEGIN static uint8_t USBD_CDC_CfgHSDesc[USB_CDC_CONFIG_DESC_SIZ] __ALIGN
         /* Endpoint OUT Descriptor */
         0x07,                                /* bLength: Endpoint Descriptor size */
         USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_OUT_EP,                         /* bEndpointAddress */
+        0x00,                                /* bEndpointAddress */
         0x02,                                /* bmAttributes: Bulk */
         LOBYTE(CDC_DATA_HS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
         HIBYTE(CDC_DATA_HS_MAX_PACKET_SIZE),
@@ -269,1893 +311,1613 @@ __ALIGN_BEGIN static uint8_t USBD_CDC_CfgHSDesc[USB_CDC_CONFIG_DESC_SIZ] __ALIGN
         /* Endpoint IN Descriptor */
         0x07,                                /* bLength: Endpoint Descriptor size */
         USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_IN_EP,                          /* bEndpointAddress */
+        0x00,                                /* bEndpointAddress */
         0x02,                                /* bmAttributes: Bulk */
         LOBYTE(CDC_DATA_HS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
         HIBYTE(CDC_DATA_HS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
+        0x00 /* bInterval: ignore for Bulk transfer */
+};
 
-#if (NUMBER_OF_CDC > 1)
-        /********************  CDC1 block ********************/
-        /******** IAD to associate the two CDC interfaces */
-        0x08,             /* bLength */
-        0x0B,             /* bDescriptorType */
-        _CDC_CMD_ITF_NBR, /* bFirstInterface */
-        0x02,             /* bInterfaceCount */
-        0x02,             /* bFunctionClass */
-        0x02,             /* bFunctionSubClass */
-        0x01,             /* bFunctionProtocol */
-        0x00,             /* iFunction (Index of string descriptor describing this function) */
+/* USB CDC device Configuration Descriptor, built for the requested speed */
+__ALIGN_BEGIN static uint8_t USBD_CDC_CfgDesc[USB_CDC_CONFIG_DESC_SIZ] __ALIGN_END;
 
-        /* Interface Descriptor */
-        0x09,                    /* bLength: Interface Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: Interface */
-        _CDC_CMD_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x01,                    /* bNumEndpoints: One endpoints used */
-        0x02,                    /* bInterfaceClass: Communication Interface Class */
-        0x02,                    /* bInterfaceSubClass: Abstract Control Model */
-        0x01,                    /* bInterfaceProtocol: Common AT commands */
-        _CDC_STR_DESC_IDX,       /* iInterface: */
+/**
+  * @}
+  */
 
-        /* Header Functional Descriptor */
-        0x05, /* bLength: Endpoint Descriptor size */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x00, /* bDescriptorSubtype: Header Func Desc */
-        0x10, /* bcdCDC: spec release number */
-        0x01,
+/** @defgroup USBD_CDC_Private_Functions
+  * @{
+  */
 
-        /* Call Management Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x01,             /* bDescriptorSubtype: Call Management Func Desc */
-        0x00,             /* bmCapabilities: D0+D1 */
-        _CDC_COM_ITF_NBR, /* bDataInterface: 1 */
+/**
+  * @brief  USBD_CDC_Init
+  *         Initialize the CDC interface
+  * @param  pdev: device instance
+  * @param  cfgidx: Configuration index
+  * @retval status
+  */
+static uint8_t USBD_CDC_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
+{
+  UNUSED(cfgidx);
+  USBD_CDC_ACM_HandleTypeDef *hcdc = NULL;
 
-        /* ACM Functional Descriptor */
-        0x04, /* bFunctionLength */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x02, /* bDescriptorSubtype: Abstract Control Management desc */
-        0x02, /* bmCapabilities */
+  CDC_ACM_Ctrl[USBD_DEV_IDX(pdev)].CmdOpCode = 0xFFU;
 
-        /* Union Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x06,             /* bDescriptorSubtype: Union func desc */
-        _CDC_CMD_ITF_NBR, /* bMasterInterface: Communication class interface */
-        _CDC_COM_ITF_NBR, /* bSlaveInterface0: Data Class Interface */
+  for (uint8_t i = 0; i < NUMBER_OF_CDC; i++)
+  {
+    hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][i];
 
-        /* Endpoint 2 Descriptor */
-        0x07,                        /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
-        _CDC_CMD_EP,                 /* bEndpointAddress */
-        0x03,                        /* bmAttributes: Interrupt */
-        LOBYTE(CDC_CMD_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_CMD_PACKET_SIZE),
-        CDC_HS_BINTERVAL, /* bInterval: */
-        /*---------------------------------------------------------------------------*/
+    if (pdev->dev_speed == USBD_SPEED_HIGH)
+    {
+      /* Open EP IN */
+      (void)USBD_LL_OpenEP(pdev, CDC_IN_EP(pdev, i), USBD_EP_TYPE_BULK,
+                           CDC_DATA_HS_IN_PACKET_SIZE);
 
-        /* Data class interface descriptor */
-        0x09,                    /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: */
-        _CDC_COM_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x02,                    /* bNumEndpoints: Two endpoints used */
-        0x0A,                    /* bInterfaceClass: CDC */
-        0x00,                    /* bInterfaceSubClass: */
-        0x00,                    /* bInterfaceProtocol: */
-        0x00,                    /* iInterface: */
+      pdev->ep_in[CDC_IN_EP(pdev, i) & 0xFU].is_used = 1U;
+      pdev->ep_in[CDC_IN_EP(pdev, i) & 0xFU].maxpacket = CDC_DATA_HS_IN_PACKET_SIZE;
 
-        /* Endpoint OUT Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_OUT_EP,                         /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_HS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_HS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
+      /* Open EP OUT */
+      (void)USBD_LL_OpenEP(pdev, CDC_OUT_EP(pdev, i), USBD_EP_TYPE_BULK,
+                           CDC_DATA_HS_OUT_PACKET_SIZE);
 
-        /* Endpoint IN Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_IN_EP,                          /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_HS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_HS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
-#endif
+      pdev->ep_out[CDC_OUT_EP(pdev, i) & 0xFU].is_used = 1U;
 
-#if (NUMBER_OF_CDC > 2)
-        /********************  CDC2 block ********************/
-        /******** IAD to associate the two CDC interfaces */
-        0x08,             /* bLength */
-        0x0B,             /* bDescriptorType */
-        _CDC_CMD_ITF_NBR, /* bFirstInterface */
-        0x02,             /* bInterfaceCount */
-        0x02,             /* bFunctionClass */
-        0x02,             /* bFunctionSubClass */
-        0x01,             /* bFunctionProtocol */
-        0x00,             /* iFunction (Index of string descriptor describing this function) */
+      /* Set bInterval for CDC CMD Endpoint */
+      if (CDC_CMD_EP(pdev, i) != 0U)
+      {
+        pdev->ep_in[CDC_CMD_EP(pdev, i) & 0xFU].bInterval = CDC_HS_BINTERVAL;
+      }
+    }
+    else
+    {
+      /* Open EP IN */
+      (void)USBD_LL_OpenEP(pdev, CDC_IN_EP(pdev, i), USBD_EP_TYPE_BULK,
+                           CDC_DATA_FS_IN_PACKET_SIZE);
 
-        /* Interface Descriptor */
-        0x09,                    /* bLength: Interface Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: Interface */
-        _CDC_CMD_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x01,                    /* bNumEndpoints: One endpoints used */
-        0x02,                    /* bInterfaceClass: Communication Interface Class */
-        0x02,                    /* bInterfaceSubClass: Abstract Control Model */
-        0x01,                    /* bInterfaceProtocol: Common AT commands */
-        _CDC_STR_DESC_IDX,       /* iInterface: */
+      pdev->ep_in[CDC_IN_EP(pdev, i) & 0xFU].is_used = 1U;
+      pdev->ep_in[CDC_IN_EP(pdev, i) & 0xFU].maxpacket = CDC_DATA_FS_IN_PACKET_SIZE;
 
-        /* Header Functional Descriptor */
-        0x05, /* bLength: Endpoint Descriptor size */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x00, /* bDescriptorSubtype: Header Func Desc */
-        0x10, /* bcdCDC: spec release number */
-        0x01,
+      /* Open EP OUT */
+      (void)USBD_LL_OpenEP(pdev, CDC_OUT_EP(pdev, i), USBD_EP_TYPE_BULK,
+                           CDC_DATA_FS_OUT_PACKET_SIZE);
 
-        /* Call Management Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x01,             /* bDescriptorSubtype: Call Management Func Desc */
-        0x00,             /* bmCapabilities: D0+D1 */
-        _CDC_COM_ITF_NBR, /* bDataInterface: 1 */
+      pdev->ep_out[CDC_OUT_EP(pdev, i) & 0xFU].is_used = 1U;
 
-        /* ACM Functional Descriptor */
-        0x04, /* bFunctionLength */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x02, /* bDescriptorSubtype: Abstract Control Management desc */
-        0x02, /* bmCapabilities */
+      /* Set bInterval for CMD Endpoint */
+      if (CDC_CMD_EP(pdev, i) != 0U)
+      {
+        pdev->ep_in[CDC_CMD_EP(pdev, i) & 0xFU].bInterval = CDC_FS_BINTERVAL;
+      }
+    }
 
-        /* Union Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x06,             /* bDescriptorSubtype: Union func desc */
-        _CDC_CMD_ITF_NBR, /* bMasterInterface: Communication class interface */
-        _CDC_COM_ITF_NBR, /* bSlaveInterface0: Data Class Interface */
+    /* Open Command IN EP, unless the endpoint planner left it out */
+    if (CDC_CMD_EP(pdev, i) != 0U)
+    {
+      (void)USBD_LL_OpenEP(pdev, CDC_CMD_EP(pdev, i), USBD_EP_TYPE_INTR, CDC_CMD_PACKET_SIZE);
+      pdev->ep_in[CDC_CMD_EP(pdev, i) & 0xFU].is_used = 1U;
+      pdev->ep_in[CDC_CMD_EP(pdev, i) & 0xFU].maxpacket = CDC_CMD_PACKET_SIZE;
+    }
 
-        /* Endpoint 2 Descriptor */
-        0x07,                        /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
-        _CDC_CMD_EP,                 /* bEndpointAddress */
-        0x03,                        /* bmAttributes: Interrupt */
-        LOBYTE(CDC_CMD_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_CMD_PACKET_SIZE),
-        CDC_HS_BINTERVAL, /* bInterval: */
-        /*---------------------------------------------------------------------------*/
+    /* Init  physical Interface components */
+    ((USBD_CDC_ACM_ItfTypeDef *)USBD_USER_DATA(pdev))->Init(i);
 
-        /* Data class interface descriptor */
-        0x09,                    /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: */
-        _CDC_COM_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x02,                    /* bNumEndpoints: Two endpoints used */
-        0x0A,                    /* bInterfaceClass: CDC */
-        0x00,                    /* bInterfaceSubClass: */
-        0x00,                    /* bInterfaceProtocol: */
-        0x00,                    /* iInterface: */
+    /* Init Xfer states, every pool buffer is free */
+    hcdc->TxState = 0U;
+    hcdc->RxState = 0U;
+    hcdc->RxFree = (uint32_t)((1ULL << CDC_ACM_RX_POOL_DEPTH) - 1U);
+    hcdc->RxHeld = 0U;
+#if (USBD_USE_OS == 1U)
+    hcdc->RxOffset = 0U;
+#endif /* (USBD_USE_OS == 1U) */
 
-        /* Endpoint OUT Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_OUT_EP,                         /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_HS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_HS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
+    /* Data written to the ring before the configuration is sent from the
+       next SOF, the coalescing set by the application is kept */
+    hcdc->TxAge = 0U;
 
-        /* Endpoint IN Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_IN_EP,                          /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_HS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_HS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
-#endif
+    if (hcdc->TxChain == 0U)
+    {
+      hcdc->TxChain = CDC_ACM_TX_CHAIN_PACKETS;
+      hcdc->TxFlushSof = CDC_ACM_TX_FLUSH_SOF;
+    }
 
-#if (NUMBER_OF_CDC > 3)
-        /********************  CDC3 block ********************/
-        /******** IAD to associate the two CDC interfaces */
-        0x08,             /* bLength */
-        0x0B,             /* bDescriptorType */
-        _CDC_CMD_ITF_NBR, /* bFirstInterface */
-        0x02,             /* bInterfaceCount */
-        0x02,             /* bFunctionClass */
-        0x02,             /* bFunctionSubClass */
-        0x01,             /* bFunctionProtocol */
-        0x00,             /* iFunction (Index of string descriptor describing this function) */
+#if (CDC_ACM_TX_SCHED == 1U)
+    if (hcdc->TxWeight == 0U)
+    {
+      hcdc->TxWeight = CDC_ACM_TX_SCHED_WEIGHT;
+    }
+#endif /* (CDC_ACM_TX_SCHED == 1U) */
 
-        /* Interface Descriptor */
-        0x09,                    /* bLength: Interface Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: Interface */
-        _CDC_CMD_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x01,                    /* bNumEndpoints: One endpoints used */
-        0x02,                    /* bInterfaceClass: Communication Interface Class */
-        0x02,                    /* bInterfaceSubClass: Abstract Control Model */
-        0x01,                    /* bInterfaceProtocol: Common AT commands */
-        _CDC_STR_DESC_IDX,       /* iInterface: */
+    /* The host opens the port with DTR and RTS, the DCD and DSR set by
+       the application are reported on the new configuration */
+    hcdc->LineState = 0U;
+    hcdc->SerialEvents = 0U;
+    hcdc->SerialSent = 0U;
+    USBD_CDC_NotifyKick(pdev, i);
 
-        /* Header Functional Descriptor */
-        0x05, /* bLength: Endpoint Descriptor size */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x00, /* bDescriptorSubtype: Header Func Desc */
-        0x10, /* bcdCDC: spec release number */
-        0x01,
+    /* Prepare Out endpoint to receive next packet */
+    USBD_CDC_RxArm(pdev, i);
+  }
+  return (uint8_t)USBD_OK;
+}
 
-        /* Call Management Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x01,             /* bDescriptorSubtype: Call Management Func Desc */
-        0x00,             /* bmCapabilities: D0+D1 */
-        _CDC_COM_ITF_NBR, /* bDataInterface: 1 */
+/**
+  * @brief  USBD_CDC_Init
+  *         DeInitialize the CDC layer
+  * @param  pdev: device instance
+  * @param  cfgidx: Configuration index
+  * @retval status
+  */
+static uint8_t USBD_CDC_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
+{
+  UNUSED(cfgidx);
+#if (CDC_ACM_TX_SCHED == 1U)
+  USBD_CDC_ACM_HandleTypeDef *hcdc;
 
-        /* ACM Functional Descriptor */
-        0x04, /* bFunctionLength */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x02, /* bDescriptorSubtype: Abstract Control Management desc */
-        0x02, /* bmCapabilities */
+  CDC_ACM_Sched[USBD_DEV_IDX(pdev)].InFlight = 0U;
+  CDC_ACM_Sched[USBD_DEV_IDX(pdev)].Next = 0U;
+  CDC_ACM_Sched[USBD_DEV_IDX(pdev)].Credited = 0U;
+#endif /* (CDC_ACM_TX_SCHED == 1U) */
 
-        /* Union Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x06,             /* bDescriptorSubtype: Union func desc */
-        _CDC_CMD_ITF_NBR, /* bMasterInterface: Communication class interface */
-        _CDC_COM_ITF_NBR, /* bSlaveInterface0: Data Class Interface */
+  for (uint8_t i = 0; i < NUMBER_OF_CDC; i++)
+  {
+    /* Close EP IN */
+    (void)USBD_LL_CloseEP(pdev, CDC_IN_EP(pdev, i));
+    (void)USBD_Xfer_Flush(pdev, CDC_IN_EP(pdev, i));
+    pdev->ep_in[CDC_IN_EP(pdev, i) & 0xFU].is_used = 0U;
+    CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][i].TxState = 0U;
 
-        /* Endpoint 2 Descriptor */
-        0x07,                        /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
-        _CDC_CMD_EP,                 /* bEndpointAddress */
-        0x03,                        /* bmAttributes: Interrupt */
-        LOBYTE(CDC_CMD_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_CMD_PACKET_SIZE),
-        CDC_HS_BINTERVAL, /* bInterval: */
-        /*---------------------------------------------------------------------------*/
+    /* Ring data the host did not read is dropped */
+    CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][i].TxTail = CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][i].TxHead;
 
-        /* Data class interface descriptor */
-        0x09,                    /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: */
-        _CDC_COM_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x02,                    /* bNumEndpoints: Two endpoints used */
-        0x0A,                    /* bInterfaceClass: CDC */
-        0x00,                    /* bInterfaceSubClass: */
-        0x00,                    /* bInterfaceProtocol: */
-        0x00,                    /* iInterface: */
+#if (CDC_ACM_TX_SCHED == 1U)
+    /* So are the transfers waiting for the scheduler, without callbacks as
+       for the flushed queue */
+    hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][i];
 
-        /* Endpoint OUT Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_OUT_EP,                         /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_HS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_HS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
+    while (hcdc->TxPendHead != NULL)
+    {
+      hcdc->TxPendHead->state = USBD_XFER_STATE_IDLE;
+      hcdc->TxPendHead = hcdc->TxPendHead->next;
+    }
 
-        /* Endpoint IN Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_IN_EP,                          /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_HS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_HS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
-#endif
+    hcdc->TxPendTail = NULL;
+    hcdc->TxPendCount = 0U;
+    hcdc->TxDeficit = 0U;
+#endif /* (CDC_ACM_TX_SCHED == 1U) */
 
-#if (NUMBER_OF_CDC > 4)
-        /********************  CDC4 block ********************/
-        /******** IAD to associate the two CDC interfaces */
-        0x08,             /* bLength */
-        0x0B,             /* bDescriptorType */
-        _CDC_CMD_ITF_NBR, /* bFirstInterface */
-        0x02,             /* bInterfaceCount */
-        0x02,             /* bFunctionClass */
-        0x02,             /* bFunctionSubClass */
-        0x01,             /* bFunctionProtocol */
-        0x00,             /* iFunction (Index of string descriptor describing this function) */
+    /* Close EP OUT */
+    (void)USBD_LL_CloseEP(pdev, CDC_OUT_EP(pdev, i));
+    pdev->ep_out[CDC_OUT_EP(pdev, i) & 0xFU].is_used = 0U;
 
-        /* Interface Descriptor */
-        0x09,                    /* bLength: Interface Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: Interface */
-        _CDC_CMD_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x01,                    /* bNumEndpoints: One endpoints used */
-        0x02,                    /* bInterfaceClass: Communication Interface Class */
-        0x02,                    /* bInterfaceSubClass: Abstract Control Model */
-        0x01,                    /* bInterfaceProtocol: Common AT commands */
-        _CDC_STR_DESC_IDX,       /* iInterface: */
-
-        /* Header Functional Descriptor */
-        0x05, /* bLength: Endpoint Descriptor size */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x00, /* bDescriptorSubtype: Header Func Desc */
-        0x10, /* bcdCDC: spec release number */
-        0x01,
-
-        /* Call Management Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x01,             /* bDescriptorSubtype: Call Management Func Desc */
-        0x00,             /* bmCapabilities: D0+D1 */
-        _CDC_COM_ITF_NBR, /* bDataInterface: 1 */
-
-        /* ACM Functional Descriptor */
-        0x04, /* bFunctionLength */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x02, /* bDescriptorSubtype: Abstract Control Management desc */
-        0x02, /* bmCapabilities */
-
-        /* Union Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x06,             /* bDescriptorSubtype: Union func desc */
-        _CDC_CMD_ITF_NBR, /* bMasterInterface: Communication class interface */
-        _CDC_COM_ITF_NBR, /* bSlaveInterface0: Data Class Interface */
-
-        /* Endpoint 2 Descriptor */
-        0x07,                        /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
-        _CDC_CMD_EP,                 /* bEndpointAddress */
-        0x03,                        /* bmAttributes: Interrupt */
-        LOBYTE(CDC_CMD_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_CMD_PACKET_SIZE),
-        CDC_HS_BINTERVAL, /* bInterval: */
-        /*---------------------------------------------------------------------------*/
-
-        /* Data class interface descriptor */
-        0x09,                    /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: */
-        _CDC_COM_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x02,                    /* bNumEndpoints: Two endpoints used */
-        0x0A,                    /* bInterfaceClass: CDC */
-        0x00,                    /* bInterfaceSubClass: */
-        0x00,                    /* bInterfaceProtocol: */
-        0x00,                    /* iInterface: */
-
-        /* Endpoint OUT Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_OUT_EP,                         /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_HS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_HS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
-
-        /* Endpoint IN Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_IN_EP,                          /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_HS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_HS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
-#endif
-
-#if (NUMBER_OF_CDC > 5)
-        /********************  CDC5 block ********************/
-        /******** IAD to associate the two CDC interfaces */
-        0x08,             /* bLength */
-        0x0B,             /* bDescriptorType */
-        _CDC_CMD_ITF_NBR, /* bFirstInterface */
-        0x02,             /* bInterfaceCount */
-        0x02,             /* bFunctionClass */
-        0x02,             /* bFunctionSubClass */
-        0x01,             /* bFunctionProtocol */
-        0x00,             /* iFunction (Index of string descriptor describing this function) */
-
-        /* Interface Descriptor */
-        0x09,                    /* bLength: Interface Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: Interface */
-        _CDC_CMD_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x01,                    /* bNumEndpoints: One endpoints used */
-        0x02,                    /* bInterfaceClass: Communication Interface Class */
-        0x02,                    /* bInterfaceSubClass: Abstract Control Model */
-        0x01,                    /* bInterfaceProtocol: Common AT commands */
-        _CDC_STR_DESC_IDX,       /* iInterface: */
-
-        /* Header Functional Descriptor */
-        0x05, /* bLength: Endpoint Descriptor size */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x00, /* bDescriptorSubtype: Header Func Desc */
-        0x10, /* bcdCDC: spec release number */
-        0x01,
-
-        /* Call Management Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x01,             /* bDescriptorSubtype: Call Management Func Desc */
-        0x00,             /* bmCapabilities: D0+D1 */
-        _CDC_COM_ITF_NBR, /* bDataInterface: 1 */
-
-        /* ACM Functional Descriptor */
-        0x04, /* bFunctionLength */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x02, /* bDescriptorSubtype: Abstract Control Management desc */
-        0x02, /* bmCapabilities */
-
-        /* Union Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x06,             /* bDescriptorSubtype: Union func desc */
-        _CDC_CMD_ITF_NBR, /* bMasterInterface: Communication class interface */
-        _CDC_COM_ITF_NBR, /* bSlaveInterface0: Data Class Interface */
-
-        /* Endpoint 2 Descriptor */
-        0x07,                        /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
-        _CDC_CMD_EP,                 /* bEndpointAddress */
-        0x03,                        /* bmAttributes: Interrupt */
-        LOBYTE(CDC_CMD_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_CMD_PACKET_SIZE),
-        CDC_HS_BINTERVAL, /* bInterval: */
-        /*---------------------------------------------------------------------------*/
-
-        /* Data class interface descriptor */
-        0x09,                    /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: */
-        _CDC_COM_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x02,                    /* bNumEndpoints: Two endpoints used */
-        0x0A,                    /* bInterfaceClass: CDC */
-        0x00,                    /* bInterfaceSubClass: */
-        0x00,                    /* bInterfaceProtocol: */
-        0x00,                    /* iInterface: */
-
-        /* Endpoint OUT Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_OUT_EP,                         /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_HS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_HS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
-
-        /* Endpoint IN Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_IN_EP,                          /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_HS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_HS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
-#endif
-
-#if (NUMBER_OF_CDC > 6)
-        /********************  CDC6 block ********************/
-        /******** IAD to associate the two CDC interfaces */
-        0x08,             /* bLength */
-        0x0B,             /* bDescriptorType */
-        _CDC_CMD_ITF_NBR, /* bFirstInterface */
-        0x02,             /* bInterfaceCount */
-        0x02,             /* bFunctionClass */
-        0x02,             /* bFunctionSubClass */
-        0x01,             /* bFunctionProtocol */
-        0x00,             /* iFunction (Index of string descriptor describing this function) */
-
-        /* Interface Descriptor */
-        0x09,                    /* bLength: Interface Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: Interface */
-        _CDC_CMD_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x01,                    /* bNumEndpoints: One endpoints used */
-        0x02,                    /* bInterfaceClass: Communication Interface Class */
-        0x02,                    /* bInterfaceSubClass: Abstract Control Model */
-        0x01,                    /* bInterfaceProtocol: Common AT commands */
-        _CDC_STR_DESC_IDX,       /* iInterface: */
-
-        /* Header Functional Descriptor */
-        0x05, /* bLength: Endpoint Descriptor size */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x00, /* bDescriptorSubtype: Header Func Desc */
-        0x10, /* bcdCDC: spec release number */
-        0x01,
-
-        /* Call Management Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x01,             /* bDescriptorSubtype: Call Management Func Desc */
-        0x00,             /* bmCapabilities: D0+D1 */
-        _CDC_COM_ITF_NBR, /* bDataInterface: 1 */
-
-        /* ACM Functional Descriptor */
-        0x04, /* bFunctionLength */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x02, /* bDescriptorSubtype: Abstract Control Management desc */
-        0x02, /* bmCapabilities */
-
-        /* Union Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x06,             /* bDescriptorSubtype: Union func desc */
-        _CDC_CMD_ITF_NBR, /* bMasterInterface: Communication class interface */
-        _CDC_COM_ITF_NBR, /* bSlaveInterface0: Data Class Interface */
-
-        /* Endpoint 2 Descriptor */
-        0x07,                        /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
-        _CDC_CMD_EP,                 /* bEndpointAddress */
-        0x03,                        /* bmAttributes: Interrupt */
-        LOBYTE(CDC_CMD_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_CMD_PACKET_SIZE),
-        CDC_HS_BINTERVAL, /* bInterval: */
-        /*---------------------------------------------------------------------------*/
-
-        /* Data class interface descriptor */
-        0x09,                    /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: */
-        _CDC_COM_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x02,                    /* bNumEndpoints: Two endpoints used */
-        0x0A,                    /* bInterfaceClass: CDC */
-        0x00,                    /* bInterfaceSubClass: */
-        0x00,                    /* bInterfaceProtocol: */
-        0x00,                    /* iInterface: */
-
-        /* Endpoint OUT Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_OUT_EP,                         /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_HS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_HS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
-
-        /* Endpoint IN Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_IN_EP,                          /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_HS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_HS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
-#endif
-
-#if (NUMBER_OF_CDC > 7)
-        /********************  CDC7 block ********************/
-        /******** IAD to associate the two CDC interfaces */
-        0x08,             /* bLength */
-        0x0B,             /* bDescriptorType */
-        _CDC_CMD_ITF_NBR, /* bFirstInterface */
-        0x02,             /* bInterfaceCount */
-        0x02,             /* bFunctionClass */
-        0x02,             /* bFunctionSubClass */
-        0x01,             /* bFunctionProtocol */
-        0x00,             /* iFunction (Index of string descriptor describing this function) */
-
-        /* Interface Descriptor */
-        0x09,                    /* bLength: Interface Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: Interface */
-        _CDC_CMD_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x01,                    /* bNumEndpoints: One endpoints used */
-        0x02,                    /* bInterfaceClass: Communication Interface Class */
-        0x02,                    /* bInterfaceSubClass: Abstract Control Model */
-        0x01,                    /* bInterfaceProtocol: Common AT commands */
-        _CDC_STR_DESC_IDX,       /* iInterface: */
+    /* Close Command IN EP */
+    if (CDC_CMD_EP(pdev, i) != 0U)
+    {
+      (void)USBD_LL_CloseEP(pdev, CDC_CMD_EP(pdev, i));
+      (void)USBD_Xfer_Flush(pdev, CDC_CMD_EP(pdev, i));
+      pdev->ep_in[CDC_CMD_EP(pdev, i) & 0xFU].is_used = 0U;
+      pdev->ep_in[CDC_CMD_EP(pdev, i) & 0xFU].bInterval = 0U;
+    }
 
-        /* Header Functional Descriptor */
-        0x05, /* bLength: Endpoint Descriptor size */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x00, /* bDescriptorSubtype: Header Func Desc */
-        0x10, /* bcdCDC: spec release number */
-        0x01,
+    /* DeInit  physical Interface components */
+    ((USBD_CDC_ACM_ItfTypeDef *)USBD_USER_DATA(pdev))->DeInit(i);
+  }
+  return (uint8_t)USBD_OK;
+}
 
-        /* Call Management Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x01,             /* bDescriptorSubtype: Call Management Func Desc */
-        0x00,             /* bmCapabilities: D0+D1 */
-        _CDC_COM_ITF_NBR, /* bDataInterface: 1 */
+/**
+  * @brief  USBD_CDC_Setup
+  *         Handle the CDC specific requests
+  * @param  pdev: instance
+  * @param  req: usb requests
+  * @retval status
+  */
+static uint8_t USBD_CDC_Setup(USBD_HandleTypeDef *pdev,
+                              USBD_SetupReqTypedef *req)
+{
+  USBD_CDC_ACM_HandleTypeDef *hcdc = NULL;
+  USBD_CDC_ACM_CtrlTypeDef *pctrl = &CDC_ACM_Ctrl[USBD_DEV_IDX(pdev)];
+  uint16_t len;
+  uint8_t ifalt = 0U;
+  uint16_t status_info = 0U;
+  USBD_StatusTypeDef ret = USBD_OK;
 
-        /* ACM Functional Descriptor */
-        0x04, /* bFunctionLength */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x02, /* bDescriptorSubtype: Abstract Control Management desc */
-        0x02, /* bmCapabilities */
+  uint8_t windex_to_ch = USBD_CDC_ItfToCh(pdev, LOBYTE(req->wIndex));
 
-        /* Union Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x06,             /* bDescriptorSubtype: Union func desc */
-        _CDC_CMD_ITF_NBR, /* bMasterInterface: Communication class interface */
-        _CDC_COM_ITF_NBR, /* bSlaveInterface0: Data Class Interface */
+  /* Standard requests to an endpoint do not name a channel */
+  if (windex_to_ch >= NUMBER_OF_CDC)
+  {
+    if ((req->bmRequest & USB_REQ_TYPE_MASK) == USB_REQ_TYPE_CLASS)
+    {
+      USBD_CtlError(pdev, req);
+      return (uint8_t)USBD_FAIL;
+    }
 
-        /* Endpoint 2 Descriptor */
-        0x07,                        /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
-        _CDC_CMD_EP,                 /* bEndpointAddress */
-        0x03,                        /* bmAttributes: Interrupt */
-        LOBYTE(CDC_CMD_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_CMD_PACKET_SIZE),
-        CDC_HS_BINTERVAL, /* bInterval: */
-        /*---------------------------------------------------------------------------*/
+    windex_to_ch = 0U;
+  }
 
-        /* Data class interface descriptor */
-        0x09,                    /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: */
-        _CDC_COM_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x02,                    /* bNumEndpoints: Two endpoints used */
-        0x0A,                    /* bInterfaceClass: CDC */
-        0x00,                    /* bInterfaceSubClass: */
-        0x00,                    /* bInterfaceProtocol: */
-        0x00,                    /* iInterface: */
+  hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][windex_to_ch];
 
-        /* Endpoint OUT Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_OUT_EP,                         /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_HS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_HS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
+  switch (req->bmRequest & USB_REQ_TYPE_MASK)
+  {
+  case USB_REQ_TYPE_CLASS:
+    if (req->wLength != 0U)
+    {
+      if ((req->bmRequest & 0x80U) != 0U)
+      {
+        ((USBD_CDC_ACM_ItfTypeDef *)USBD_USER_DATA(pdev))->Control(windex_to_ch, req->bRequest, (uint8_t *)pctrl->data, req->wLength);
 
-        /* Endpoint IN Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_IN_EP,                          /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_HS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_HS_MAX_PACKET_SIZE),
-        0x00 /* bInterval: ignore for Bulk transfer */
-#endif
-};
+        len = MIN(CDC_REQ_MAX_DATA_SIZE, req->wLength);
+        (void)USBD_CtlSendData(pdev, (uint8_t *)pctrl->data, len);
+      }
+      else if (req->wLength <= sizeof(pctrl->data))
+      {
+        pctrl->CmdOpCode = req->bRequest;
+        pctrl->CmdLength = (uint8_t)req->wLength;
+        pctrl->CmdCh = windex_to_ch;
 
-/* USB CDC device Configuration Descriptor */
-__ALIGN_BEGIN static uint8_t USBD_CDC_CfgFSDesc[USB_CDC_CONFIG_DESC_SIZ] __ALIGN_END =
+        (void)USBD_CtlPrepareRx(pdev, (uint8_t *)pctrl->data, req->wLength);
+      }
+      else
+      {
+        USBD_CtlError(pdev, req);
+        ret = USBD_FAIL;
+      }
+    }
+    else
     {
-        /* Configuration Descriptor */
-        0x09,                            /* bLength: Configuration Descriptor size */
-        USB_DESC_TYPE_CONFIGURATION,     /* bDescriptorType: Configuration */
-        LOBYTE(USB_CDC_CONFIG_DESC_SIZ), /* wTotalLength:no of returned bytes */
-        HIBYTE(USB_CDC_CONFIG_DESC_SIZ),
-        0x02, /* bNumInterfaces: 2 interface */
-        0x01, /* bConfigurationValue: Configuration value */
-        0x00, /* iConfiguration: Index of string descriptor describing the configuration */
-#if (USBD_SELF_POWERED == 1U)
-        0xC0, /* bmAttributes: Bus Powered according to user configuration */
-#else
-        0x80, /* bmAttributes: Bus Powered according to user configuration */
-#endif
-        USBD_MAX_POWER, /* MaxPower 100 mA */
+      if (req->bRequest == CDC_SET_CONTROL_LINE_STATE)
+      {
+        hcdc->LineState = req->wValue & (CDC_CONTROL_LINE_DTR | CDC_CONTROL_LINE_RTS);
 
-        /*---------------------------------------------------------------------------*/
-        /********************  CDC0 block ********************/
-        /******** IAD to associate the two CDC interfaces */
-        0x08,             /* bLength */
-        0x0B,             /* bDescriptorType */
-        _CDC_CMD_ITF_NBR, /* bFirstInterface */
-        0x02,             /* bInterfaceCount */
-        0x02,             /* bFunctionClass */
-        0x02,             /* bFunctionSubClass */
-        0x01,             /* bFunctionProtocol */
-        0x00,             /* iFunction (Index of string descriptor describing this function) */
+        /* Data held back while RTS was low leaves now */
+        USBD_CDC_TxKick(pdev, windex_to_ch, 0U);
+      }
 
-        /* Interface Descriptor */
-        0x09,                    /* bLength: Interface Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: Interface */
-        /* Interface descriptor type */
-        _CDC_CMD_ITF_NBR, /* bInterfaceNumber: Number of Interface */
-        0x00,             /* bAlternateSetting: Alternate setting */
-        0x01,             /* bNumEndpoints: One endpoints used */
-        0x02,             /* bInterfaceClass: Communication Interface Class */
-        0x02,             /* bInterfaceSubClass: Abstract Control Model */
-        0x01,             /* bInterfaceProtocol: Common AT commands */
-        _CDC_STR_DESC_IDX,/* iInterface: */
+      ((USBD_CDC_ACM_ItfTypeDef *)USBD_USER_DATA(pdev))->Control(windex_to_ch, req->bRequest, (uint8_t *)req, 0U);
+    }
+    break;
 
-        /* Header Functional Descriptor */
-        0x05, /* bLength: Endpoint Descriptor size */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x00, /* bDescriptorSubtype: Header Func Desc */
-        0x10, /* bcdCDC: spec release number */
-        0x01,
+  case USB_REQ_TYPE_STANDARD:
+    switch (req->bRequest)
+    {
+    case USB_REQ_GET_STATUS:
+      if (pdev->dev_state == USBD_STATE_CONFIGURED)
+      {
+        (void)USBD_CtlSendData(pdev, (uint8_t *)&status_info, 2U);
+      }
+      else
+      {
+        USBD_CtlError(pdev, req);
+        ret = USBD_FAIL;
+      }
+      break;
 
-        /* Call Management Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x01,             /* bDescriptorSubtype: Call Management Func Desc */
-        0x00,             /* bmCapabilities: D0+D1 */
-        _CDC_COM_ITF_NBR, /* bDataInterface: 1 */
+    case USB_REQ_GET_INTERFACE:
+      if (pdev->dev_state == USBD_STATE_CONFIGURED)
+      {
+        (void)USBD_CtlSendData(pdev, &ifalt, 1U);
+      }
+      else
+      {
+        USBD_CtlError(pdev, req);
+        ret = USBD_FAIL;
+      }
+      break;
 
-        /* ACM Functional Descriptor */
-        0x04, /* bFunctionLength */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x02, /* bDescriptorSubtype: Abstract Control Management desc */
-        0x02, /* bmCapabilities */
+    case USB_REQ_SET_INTERFACE:
+      if (pdev->dev_state != USBD_STATE_CONFIGURED)
+      {
+        USBD_CtlError(pdev, req);
+        ret = USBD_FAIL;
+      }
+      break;
 
-        /* Union Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x06,             /* bDescriptorSubtype: Union func desc */
-        _CDC_CMD_ITF_NBR, /* bMasterInterface: Communication class interface */
-        _CDC_COM_ITF_NBR, /* bSlaveInterface0: Data Class Interface */
+    case USB_REQ_CLEAR_FEATURE:
+      break;
 
-        /* Endpoint 2 Descriptor */
-        0x07,                        /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
-        _CDC_CMD_EP,                 /* bEndpointAddress */
-        0x03,                        /* bmAttributes: Interrupt */
-        LOBYTE(CDC_CMD_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_CMD_PACKET_SIZE),
-        CDC_FS_BINTERVAL, /* bInterval: */
-        /*---------------------------------------------------------------------------*/
+    default:
+      USBD_CtlError(pdev, req);
+      ret = USBD_FAIL;
+      break;
+    }
+    break;
 
-        /* Data class interface descriptor */
-        0x09,                    /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: */
-        _CDC_COM_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x02,                    /* bNumEndpoints: Two endpoints used */
-        0x0A,                    /* bInterfaceClass: CDC */
-        0x00,                    /* bInterfaceSubClass: */
-        0x00,                    /* bInterfaceProtocol: */
-        0x00,                    /* iInterface: */
+  default:
+    USBD_CtlError(pdev, req);
+    ret = USBD_FAIL;
+    break;
+  }
 
-        /* Endpoint OUT Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_OUT_EP,                         /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
+  return (uint8_t)ret;
+}
 
-        /* Endpoint IN Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_IN_EP,                          /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
+/**
+  * @brief  USBD_CDC_DataIn
+  *         Data sent on non-control IN endpoint
+  * @param  pdev: device instance
+  * @param  epnum: endpoint number
+  * @retval status
+  */
+static uint8_t USBD_CDC_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  UNUSED(pdev);
+  UNUSED(epnum);
 
-#if (NUMBER_OF_CDC > 1)
-        /********************  CDC1 block ********************/
-        /******** IAD to associate the two CDC interfaces */
-        0x08,             /* bLength */
-        0x0B,             /* bDescriptorType */
-        _CDC_CMD_ITF_NBR, /* bFirstInterface */
-        0x02,             /* bInterfaceCount */
-        0x02,             /* bFunctionClass */
-        0x02,             /* bFunctionSubClass */
-        0x01,             /* bFunctionProtocol */
-        0x00,             /* iFunction (Index of string descriptor describing this function) */
+  /* Data IN endpoints complete through their transfer queue (USBD_CDC_TxCplt),
+     the command endpoint through USBD_CDC_NotifyCplt */
 
-        /* Interface Descriptor */
-        0x09,                    /* bLength: Interface Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: Interface */
-        /* Interface descriptor type */
-        _CDC_CMD_ITF_NBR, /* bInterfaceNumber: Number of Interface */
-        0x00,             /* bAlternateSetting: Alternate setting */
-        0x01,             /* bNumEndpoints: One endpoints used */
-        0x02,             /* bInterfaceClass: Communication Interface Class */
-        0x02,             /* bInterfaceSubClass: Abstract Control Model */
-        0x01,             /* bInterfaceProtocol: Common AT commands */
-        _CDC_STR_DESC_IDX,/* iInterface: */
+  return (uint8_t)USBD_OK;
+}
 
-        /* Header Functional Descriptor */
-        0x05, /* bLength: Endpoint Descriptor size */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x00, /* bDescriptorSubtype: Header Func Desc */
-        0x10, /* bcdCDC: spec release number */
-        0x01,
+/**
+  * @brief  USBD_CDC_TxCplt
+  *         Transfer queue completion of a data IN transfer
+  * @param  pdev: device instance
+  * @param  xfer: completed transfer descriptor
+  * @retval None
+  */
+static void USBD_CDC_TxCplt(USBD_HandleTypeDef *pdev, USBD_XferTypeDef *xfer)
+{
+  USBD_CDC_ACM_HandleTypeDef *hcdc = (USBD_CDC_ACM_HandleTypeDef *)xfer->pOwner;
+  uint8_t ch = (uint8_t)(hcdc - CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)]);
 
-        /* Call Management Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x01,             /* bDescriptorSubtype: Call Management Func Desc */
-        0x00,             /* bmCapabilities: D0+D1 */
-        _CDC_COM_ITF_NBR, /* bDataInterface: 1 */
+#if (CDC_ACM_TX_SCHED == 1U)
+  USBD_CDC_TxRetire(pdev, xfer);
+#endif /* (CDC_ACM_TX_SCHED == 1U) */
 
-        /* ACM Functional Descriptor */
-        0x04, /* bFunctionLength */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x02, /* bDescriptorSubtype: Abstract Control Management desc */
-        0x02, /* bmCapabilities */
+  if ((USBD_Xfer_IsIdle(pdev, xfer->ep_addr) != 0U) && (CDC_TX_WAITING(hcdc) == 0U))
+  {
+    hcdc->TxState = 0U;
+  }
 
-        /* Union Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x06,             /* bDescriptorSubtype: Union func desc */
-        _CDC_CMD_ITF_NBR, /* bMasterInterface: Communication class interface */
-        _CDC_COM_ITF_NBR, /* bSlaveInterface0: Data Class Interface */
+  if (((USBD_CDC_ACM_ItfTypeDef *)USBD_USER_DATA(pdev))->TransmitCplt != NULL)
+  {
+    ((USBD_CDC_ACM_ItfTypeDef *)USBD_USER_DATA(pdev))->TransmitCplt(ch, xfer->pbuf, &xfer->length, xfer->ep_addr & 0x7FU);
+  }
+}
 
-        /* Endpoint 2 Descriptor */
-        0x07,                        /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
-        _CDC_CMD_EP,                 /* bEndpointAddress */
-        0x03,                        /* bmAttributes: Interrupt */
-        LOBYTE(CDC_CMD_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_CMD_PACKET_SIZE),
-        CDC_FS_BINTERVAL, /* bInterval: */
-        /*---------------------------------------------------------------------------*/
+/**
+  * @brief  USBD_CDC_TxRingCplt
+  *         Transfer queue completion of a transmit ring transfer, the next
+  *         span is chained at once
+  * @param  pdev: device instance
+  * @param  xfer: completed transfer descriptor
+  * @retval None
+  */
+static void USBD_CDC_TxRingCplt(USBD_HandleTypeDef *pdev, USBD_XferTypeDef *xfer)
+{
+  USBD_CDC_ACM_HandleTypeDef *hcdc = (USBD_CDC_ACM_HandleTypeDef *)xfer->pOwner;
+  uint8_t ch = (uint8_t)(hcdc - CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)]);
 
-        /* Data class interface descriptor */
-        0x09,                    /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: */
-        _CDC_COM_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x02,                    /* bNumEndpoints: Two endpoints used */
-        0x0A,                    /* bInterfaceClass: CDC */
-        0x00,                    /* bInterfaceSubClass: */
-        0x00,                    /* bInterfaceProtocol: */
-        0x00,                    /* iInterface: */
+  /* A span the LL refused to start is sent again by the kick below */
+  if (xfer->status == (uint8_t)USBD_OK)
+  {
+    hcdc->TxTail += xfer->length;
+  }
 
-        /* Endpoint OUT Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_OUT_EP,                         /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
+#if (CDC_ACM_TX_SCHED == 1U)
+  USBD_CDC_TxRetire(pdev, xfer);
+#endif /* (CDC_ACM_TX_SCHED == 1U) */
 
-        /* Endpoint IN Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_IN_EP,                          /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
-#endif
+  if ((USBD_Xfer_IsIdle(pdev, xfer->ep_addr) != 0U) && (CDC_TX_WAITING(hcdc) == 0U))
+  {
+    hcdc->TxState = 0U;
+  }
 
-#if (NUMBER_OF_CDC > 2)
-        /********************  CDC2 block ********************/
-        /******** IAD to associate the two CDC interfaces */
-        0x08,             /* bLength */
-        0x0B,             /* bDescriptorType */
-        _CDC_CMD_ITF_NBR, /* bFirstInterface */
-        0x02,             /* bInterfaceCount */
-        0x02,             /* bFunctionClass */
-        0x02,             /* bFunctionSubClass */
-        0x01,             /* bFunctionProtocol */
-        0x00,             /* iFunction (Index of string descriptor describing this function) */
+  USBD_CDC_TxKick(pdev, ch, 0U);
+}
 
-        /* Interface Descriptor */
-        0x09,                    /* bLength: Interface Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: Interface */
-        /* Interface descriptor type */
-        _CDC_CMD_ITF_NBR, /* bInterfaceNumber: Number of Interface */
-        0x00,             /* bAlternateSetting: Alternate setting */
-        0x01,             /* bNumEndpoints: One endpoints used */
-        0x02,             /* bInterfaceClass: Communication Interface Class */
-        0x02,             /* bInterfaceSubClass: Abstract Control Model */
-        0x01,             /* bInterfaceProtocol: Common AT commands */
-        _CDC_STR_DESC_IDX,/* iInterface: */
+/**
+  * @brief  USBD_CDC_SOF
+  *         Age the data waiting in the transmit rings, a partial packet is
+  *         sent once it has waited its flush deadline
+  * @param  pdev: device instance
+  * @retval status
+  */
+static uint8_t USBD_CDC_SOF(USBD_HandleTypeDef *pdev)
+{
+  USBD_CDC_ACM_HandleTypeDef *hcdc = NULL;
 
-        /* Header Functional Descriptor */
-        0x05, /* bLength: Endpoint Descriptor size */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x00, /* bDescriptorSubtype: Header Func Desc */
-        0x10, /* bcdCDC: spec release number */
-        0x01,
+#if (CDC_ACM_TX_SCHED == 1U)
+  CDC_ACM_Sched[USBD_DEV_IDX(pdev)].Frame++;
+#endif /* (CDC_ACM_TX_SCHED == 1U) */
 
-        /* Call Management Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x01,             /* bDescriptorSubtype: Call Management Func Desc */
-        0x00,             /* bmCapabilities: D0+D1 */
-        _CDC_COM_ITF_NBR, /* bDataInterface: 1 */
+  for (uint8_t i = 0U; i < NUMBER_OF_CDC; i++)
+  {
+    hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][i];
 
-        /* ACM Functional Descriptor */
-        0x04, /* bFunctionLength */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x02, /* bDescriptorSubtype: Abstract Control Management desc */
-        0x02, /* bmCapabilities */
+    if (hcdc->TxHead != hcdc->TxTail)
+    {
+      if (hcdc->TxAge < hcdc->TxFlushSof)
+      {
+        hcdc->TxAge++;
+      }
 
-        /* Union Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x06,             /* bDescriptorSubtype: Union func desc */
-        _CDC_CMD_ITF_NBR, /* bMasterInterface: Communication class interface */
-        _CDC_COM_ITF_NBR, /* bSlaveInterface0: Data Class Interface */
+      USBD_CDC_TxKick(pdev, i, 0U);
+    }
+  }
 
-        /* Endpoint 2 Descriptor */
-        0x07,                        /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
-        _CDC_CMD_EP,                 /* bEndpointAddress */
-        0x03,                        /* bmAttributes: Interrupt */
-        LOBYTE(CDC_CMD_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_CMD_PACKET_SIZE),
-        CDC_FS_BINTERVAL, /* bInterval: */
-        /*---------------------------------------------------------------------------*/
+  return (uint8_t)USBD_OK;
+}
 
-        /* Data class interface descriptor */
-        0x09,                    /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: */
-        _CDC_COM_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x02,                    /* bNumEndpoints: Two endpoints used */
-        0x0A,                    /* bInterfaceClass: CDC */
-        0x00,                    /* bInterfaceSubClass: */
-        0x00,                    /* bInterfaceProtocol: */
-        0x00,                    /* iInterface: */
+/**
+  * @brief  USBD_CDC_DataOut
+  *         Data received on non-control Out endpoint
+  * @param  pdev: device instance
+  * @param  epnum: endpoint number
+  * @retval status
+  */
+static uint8_t USBD_CDC_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  USBD_CDC_ACM_HandleTypeDef *hcdc = NULL;
+  uint8_t ep_to_ch = USBD_CDC_OutEpToCh(pdev, epnum);
+  uint8_t idx;
 
-        /* Endpoint OUT Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_OUT_EP,                         /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
+  if (ep_to_ch >= NUMBER_OF_CDC)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
 
-        /* Endpoint IN Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_IN_EP,                          /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
-#endif
+  hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][ep_to_ch];
+  idx = hcdc->RxArmed;
 
-#if (NUMBER_OF_CDC > 3)
-        /********************  CDC3 block ********************/
-        /******** IAD to associate the two CDC interfaces */
-        0x08,             /* bLength */
-        0x0B,             /* bDescriptorType */
-        _CDC_CMD_ITF_NBR, /* bFirstInterface */
-        0x02,             /* bInterfaceCount */
-        0x02,             /* bFunctionClass */
-        0x02,             /* bFunctionSubClass */
-        0x01,             /* bFunctionProtocol */
-        0x00,             /* iFunction (Index of string descriptor describing this function) */
+  /* The filled buffer goes to the application */
+  hcdc->RxPoolLen[idx] = USBD_LL_GetRxDataSize(pdev, epnum);
+  hcdc->RxPoolSeq[idx] = hcdc->RxSeq++;
+  hcdc->RxHeld |= (1UL << idx);
+  hcdc->RxState = 0U;
 
-        /* Interface Descriptor */
-        0x09,                    /* bLength: Interface Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: Interface */
-        /* Interface descriptor type */
-        _CDC_CMD_ITF_NBR, /* bInterfaceNumber: Number of Interface */
-        0x00,             /* bAlternateSetting: Alternate setting */
-        0x01,             /* bNumEndpoints: One endpoints used */
-        0x02,             /* bInterfaceClass: Communication Interface Class */
-        0x02,             /* bInterfaceSubClass: Abstract Control Model */
-        0x01,             /* bInterfaceProtocol: Common AT commands */
-        _CDC_STR_DESC_IDX,/* iInterface: */
+  /* Take the next packet into a free buffer while this one is processed,
+     the endpoint NAKs only when the application holds them all */
+  USBD_CDC_RxArm(pdev, ep_to_ch);
 
-        /* Header Functional Descriptor */
-        0x05, /* bLength: Endpoint Descriptor size */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x00, /* bDescriptorSubtype: Header Func Desc */
-        0x10, /* bcdCDC: spec release number */
-        0x01,
+  ((USBD_CDC_ACM_ItfTypeDef *)USBD_USER_DATA(pdev))->Receive(ep_to_ch, (uint8_t *)CDC_BUF(pdev, ep_to_ch)->RxPool[idx],
+                                                             &hcdc->RxPoolLen[idx]);
 
-        /* Call Management Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x01,             /* bDescriptorSubtype: Call Management Func Desc */
-        0x00,             /* bmCapabilities: D0+D1 */
-        _CDC_COM_ITF_NBR, /* bDataInterface: 1 */
+  return (uint8_t)USBD_OK;
+}
 
-        /* ACM Functional Descriptor */
-        0x04, /* bFunctionLength */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x02, /* bDescriptorSubtype: Abstract Control Management desc */
-        0x02, /* bmCapabilities */
+/**
+  * @brief  USBD_CDC_EP0_RxReady
+  *         Handle EP0 Rx Ready event
+  * @param  pdev: device instance
+  * @retval status
+  */
+static uint8_t USBD_CDC_EP0_RxReady(USBD_HandleTypeDef *pdev)
+{
+  USBD_CDC_ACM_CtrlTypeDef *pctrl = &CDC_ACM_Ctrl[USBD_DEV_IDX(pdev)];
 
-        /* Union Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x06,             /* bDescriptorSubtype: Union func desc */
-        _CDC_CMD_ITF_NBR, /* bMasterInterface: Communication class interface */
-        _CDC_COM_ITF_NBR, /* bSlaveInterface0: Data Class Interface */
+  if ((USBD_USER_DATA(pdev) != NULL) && (pctrl->CmdOpCode != 0xFFU))
+  {
+    ((USBD_CDC_ACM_ItfTypeDef *)USBD_USER_DATA(pdev))->Control(pctrl->CmdCh, pctrl->CmdOpCode, (uint8_t *)pctrl->data, (uint16_t)pctrl->CmdLength);
+    pctrl->CmdOpCode = 0xFFU;
+  }
 
-        /* Endpoint 2 Descriptor */
-        0x07,                        /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
-        _CDC_CMD_EP,                 /* bEndpointAddress */
-        0x03,                        /* bmAttributes: Interrupt */
-        LOBYTE(CDC_CMD_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_CMD_PACKET_SIZE),
-        CDC_FS_BINTERVAL, /* bInterval: */
-        /*---------------------------------------------------------------------------*/
+  return (uint8_t)USBD_OK;
+}
 
-        /* Data class interface descriptor */
-        0x09,                    /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: */
-        _CDC_COM_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x02,                    /* bNumEndpoints: Two endpoints used */
-        0x0A,                    /* bInterfaceClass: CDC */
-        0x00,                    /* bInterfaceSubClass: */
-        0x00,                    /* bInterfaceProtocol: */
-        0x00,                    /* iInterface: */
+/**
+  * @brief  USBD_CDC_GetFSCfgDesc
+  *         Return configuration descriptor
+  * @param  speed : current device speed
+  * @param  pdev: device instance
+  * @param  length : pointer data length
+  * @retval pointer to descriptor buffer
+  */
+static uint8_t *USBD_CDC_GetFSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
+{
+  return USBD_CDC_GetCfgDesc(pdev, (uint8_t)USBD_SPEED_FULL, length);
+}
 
-        /* Endpoint OUT Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_OUT_EP,                         /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
+/**
+  * @brief  USBD_CDC_GetHSCfgDesc
+  *         Return configuration descriptor
+  * @param  speed : current device speed
+  * @param  pdev: device instance
+  * @param  length : pointer data length
+  * @retval pointer to descriptor buffer
+  */
+static uint8_t *USBD_CDC_GetHSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
+{
+  return USBD_CDC_GetCfgDesc(pdev, (uint8_t)USBD_SPEED_HIGH, length);
+}
 
-        /* Endpoint IN Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_IN_EP,                          /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
+/**
+  * @brief  USBD_CDC_GetOtherSpeedCfgDesc
+  *         Return configuration descriptor
+  * @param  speed : current device speed
+  * @param  pdev: device instance
+  * @param  length : pointer data length
+  * @retval pointer to descriptor buffer
+  */
+static uint8_t *USBD_CDC_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
+{
+  return USBD_CDC_GetCfgDesc(pdev, (uint8_t)USBD_SPEED_FULL, length);
+}
+
+/**
+  * @brief  USBD_CDC_GetCfgDesc
+  *         Build the configuration descriptor from the function block of a
+  *         channel, repeated for every channel with its map
+  * @param  pdev: device instance
+  * @param  speed: USBD_SPEED_HIGH or USBD_SPEED_FULL
+  * @param  length : pointer data length
+  * @retval pointer to descriptor buffer
+  */
+static uint8_t *USBD_CDC_GetCfgDesc(USBD_HandleTypeDef *pdev, uint8_t speed, uint16_t *length)
+{
+  uint8_t *pdesc = USBD_CDC_CfgDesc;
+  uint8_t *pport;
+  uint16_t mps = (speed == (uint8_t)USBD_SPEED_HIGH) ? CDC_DATA_HS_MAX_PACKET_SIZE : CDC_DATA_FS_MAX_PACKET_SIZE;
+
+  pdesc[0] = 0x09U;                                 /* bLength: Configuration Descriptor size */
+  pdesc[1] = USB_DESC_TYPE_CONFIGURATION;           /* bDescriptorType: Configuration */
+  pdesc[2] = LOBYTE(USB_CDC_CONFIG_DESC_SIZ);       /* wTotalLength:no of returned bytes */
+  pdesc[3] = HIBYTE(USB_CDC_CONFIG_DESC_SIZ);
+  pdesc[4] = (uint8_t)(2U * NUMBER_OF_CDC);         /* bNumInterfaces */
+  pdesc[5] = 0x01U;                                 /* bConfigurationValue: Configuration value */
+  pdesc[6] = 0x00U;                                 /* iConfiguration */
+#if (USBD_SELF_POWERED == 1U)
+  pdesc[7] = 0xC0U;                                 /* bmAttributes: Bus Powered according to user configuration */
+#else
+  pdesc[7] = 0x80U;                                 /* bmAttributes: Bus Powered according to user configuration */
 #endif
+  pdesc[8] = USBD_MAX_POWER;
 
-#if (NUMBER_OF_CDC > 4)
-        /********************  CDC4 block ********************/
-        /******** IAD to associate the two CDC interfaces */
-        0x08,             /* bLength */
-        0x0B,             /* bDescriptorType */
-        _CDC_CMD_ITF_NBR, /* bFirstInterface */
-        0x02,             /* bInterfaceCount */
-        0x02,             /* bFunctionClass */
-        0x02,             /* bFunctionSubClass */
-        0x01,             /* bFunctionProtocol */
-        0x00,             /* iFunction (Index of string descriptor describing this function) */
+  for (uint8_t i = 0U; i < NUMBER_OF_CDC; i++)
+  {
+    pport = &pdesc[USB_CONF_DESC_SIZE + (i * CDC_ACM_PORT_DESC_SIZ)];
 
-        /* Interface Descriptor */
-        0x09,                    /* bLength: Interface Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: Interface */
-        /* Interface descriptor type */
-        _CDC_CMD_ITF_NBR, /* bInterfaceNumber: Number of Interface */
-        0x00,             /* bAlternateSetting: Alternate setting */
-        0x01,             /* bNumEndpoints: One endpoints used */
-        0x02,             /* bInterfaceClass: Communication Interface Class */
-        0x02,             /* bInterfaceSubClass: Abstract Control Model */
-        0x01,             /* bInterfaceProtocol: Common AT commands */
-        _CDC_STR_DESC_IDX,/* iInterface: */
+    (void)USBD_memcpy(pport, USBD_CDC_PortDesc, CDC_ACM_PORT_DESC_SIZ);
+    USBD_CDC_SetPortDesc(pport, &CDC_ACM_Map[USBD_DEV_IDX(pdev)][i]);
 
-        /* Header Functional Descriptor */
-        0x05, /* bLength: Endpoint Descriptor size */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x00, /* bDescriptorSubtype: Header Func Desc */
-        0x10, /* bcdCDC: spec release number */
-        0x01,
+    if (speed != (uint8_t)USBD_SPEED_HIGH)
+    {
+      pport[42] = CDC_FS_BINTERVAL;
+    }
 
-        /* Call Management Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x01,             /* bDescriptorSubtype: Call Management Func Desc */
-        0x00,             /* bmCapabilities: D0+D1 */
-        _CDC_COM_ITF_NBR, /* bDataInterface: 1 */
+    pport[56] = LOBYTE(mps);
+    pport[57] = HIBYTE(mps);
+    pport[63] = LOBYTE(mps);
+    pport[64] = HIBYTE(mps);
+  }
 
-        /* ACM Functional Descriptor */
-        0x04, /* bFunctionLength */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x02, /* bDescriptorSubtype: Abstract Control Management desc */
-        0x02, /* bmCapabilities */
+  *length = (uint16_t)USB_CDC_CONFIG_DESC_SIZ;
 
-        /* Union Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x06,             /* bDescriptorSubtype: Union func desc */
-        _CDC_CMD_ITF_NBR, /* bMasterInterface: Communication class interface */
-        _CDC_COM_ITF_NBR, /* bSlaveInterface0: Data Class Interface */
+  return pdesc;
+}
 
-        /* Endpoint 2 Descriptor */
-        0x07,                        /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
-        _CDC_CMD_EP,                 /* bEndpointAddress */
-        0x03,                        /* bmAttributes: Interrupt */
-        LOBYTE(CDC_CMD_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_CMD_PACKET_SIZE),
-        CDC_FS_BINTERVAL, /* bInterval: */
-        /*---------------------------------------------------------------------------*/
+/**
+  * @brief  USBD_CDC_SetPortDesc
+  *         Write the interfaces, endpoints and string of a channel into its
+  *         function block
+  * @param  pdesc: function block of the channel
+  * @param  pmap: channel map
+  * @retval None
+  */
+static void USBD_CDC_SetPortDesc(uint8_t *pdesc, USBD_ClassMapTypeDef *pmap)
+{
+  uint8_t cmd_itf = pmap->itf_nbr;
+  uint8_t com_itf = (uint8_t)(pmap->itf_nbr + 1U);
+
+  pdesc[2] = cmd_itf;        /* IAD bFirstInterface */
+  pdesc[10] = cmd_itf;       /* bInterfaceNumber */
+  pdesc[16] = pmap->str_idx; /* iInterface */
+  pdesc[26] = com_itf;       /* bDataInterface */
+  pdesc[34] = cmd_itf;       /* bMasterInterface */
+  pdesc[35] = com_itf;       /* bSlaveInterface0 */
+  pdesc[38] = pmap->cmd_ep;  /* 0 leaves the notification endpoint out */
+  pdesc[45] = com_itf;
+  pdesc[54] = pmap->out_ep;
+  pdesc[61] = pmap->in_ep;
+}
 
-        /* Data class interface descriptor */
-        0x09,                    /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: */
-        _CDC_COM_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x02,                    /* bNumEndpoints: Two endpoints used */
-        0x0A,                    /* bInterfaceClass: CDC */
-        0x00,                    /* bInterfaceSubClass: */
-        0x00,                    /* bInterfaceProtocol: */
-        0x00,                    /* iInterface: */
+/**
+  * @brief  USBD_CDC_ItfToCh
+  *         The channels take consecutive interface pairs
+  * @param  pdev: device instance
+  * @param  itf: interface number
+  * @retval CDC channel, NUMBER_OF_CDC when the interface is not a channel
+  */
+static uint8_t USBD_CDC_ItfToCh(USBD_HandleTypeDef *pdev, uint8_t itf)
+{
+  uint8_t first = CDC_CMD_ITF_NBR(pdev, 0U);
 
-        /* Endpoint OUT Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_OUT_EP,                         /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
+  if ((itf < first) || (((uint32_t)itf - first) >= (2U * NUMBER_OF_CDC)))
+  {
+    return NUMBER_OF_CDC;
+  }
 
-        /* Endpoint IN Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_IN_EP,                          /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
-#endif
+  return (uint8_t)((itf - first) / 2U);
+}
 
-#if (NUMBER_OF_CDC > 5)
-        /********************  CDC5 block ********************/
-        /******** IAD to associate the two CDC interfaces */
-        0x08,             /* bLength */
-        0x0B,             /* bDescriptorType */
-        _CDC_CMD_ITF_NBR, /* bFirstInterface */
-        0x02,             /* bInterfaceCount */
-        0x02,             /* bFunctionClass */
-        0x02,             /* bFunctionSubClass */
-        0x01,             /* bFunctionProtocol */
-        0x00,             /* iFunction (Index of string descriptor describing this function) */
+/**
+  * @brief  USBD_CDC_OutEpToCh
+  *         The channels take consecutive OUT endpoints
+  * @param  pdev: device instance
+  * @param  epnum: endpoint number
+  * @retval CDC channel, NUMBER_OF_CDC when the endpoint is not a channel
+  */
+static uint8_t USBD_CDC_OutEpToCh(USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  uint8_t first = CDC_OUT_EP(pdev, 0U) & 0x7FU;
 
-        /* Interface Descriptor */
-        0x09,                    /* bLength: Interface Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: Interface */
-        /* Interface descriptor type */
-        _CDC_CMD_ITF_NBR, /* bInterfaceNumber: Number of Interface */
-        0x00,             /* bAlternateSetting: Alternate setting */
-        0x01,             /* bNumEndpoints: One endpoints used */
-        0x02,             /* bInterfaceClass: Communication Interface Class */
-        0x02,             /* bInterfaceSubClass: Abstract Control Model */
-        0x01,             /* bInterfaceProtocol: Common AT commands */
-        _CDC_STR_DESC_IDX,/* iInterface: */
+  epnum &= 0x7FU;
 
-        /* Header Functional Descriptor */
-        0x05, /* bLength: Endpoint Descriptor size */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x00, /* bDescriptorSubtype: Header Func Desc */
-        0x10, /* bcdCDC: spec release number */
-        0x01,
+  if ((epnum < first) || (((uint32_t)epnum - first) >= NUMBER_OF_CDC))
+  {
+    return NUMBER_OF_CDC;
+  }
 
-        /* Call Management Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x01,             /* bDescriptorSubtype: Call Management Func Desc */
-        0x00,             /* bmCapabilities: D0+D1 */
-        _CDC_COM_ITF_NBR, /* bDataInterface: 1 */
+  return (uint8_t)(epnum - first);
+}
 
-        /* ACM Functional Descriptor */
-        0x04, /* bFunctionLength */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x02, /* bDescriptorSubtype: Abstract Control Management desc */
-        0x02, /* bmCapabilities */
+/**
+  * @brief  USBD_CDC_GetDeviceQualifierDescriptor
+  *         return Device Qualifier descriptor
+  * @param  pdev: device instance
+  * @param  length : pointer data length
+  * @retval pointer to descriptor buffer
+  */
+uint8_t *USBD_CDC_GetDeviceQualifierDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length)
+{
+  UNUSED(pdev);
 
-        /* Union Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x06,             /* bDescriptorSubtype: Union func desc */
-        _CDC_CMD_ITF_NBR, /* bMasterInterface: Communication class interface */
-        _CDC_COM_ITF_NBR, /* bSlaveInterface0: Data Class Interface */
+  *length = (uint16_t)sizeof(USBD_CDC_DeviceQualifierDesc);
 
-        /* Endpoint 2 Descriptor */
-        0x07,                        /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
-        _CDC_CMD_EP,                 /* bEndpointAddress */
-        0x03,                        /* bmAttributes: Interrupt */
-        LOBYTE(CDC_CMD_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_CMD_PACKET_SIZE),
-        CDC_FS_BINTERVAL, /* bInterval: */
-        /*---------------------------------------------------------------------------*/
+  return USBD_CDC_DeviceQualifierDesc;
+}
 
-        /* Data class interface descriptor */
-        0x09,                    /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: */
-        _CDC_COM_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x02,                    /* bNumEndpoints: Two endpoints used */
-        0x0A,                    /* bInterfaceClass: CDC */
-        0x00,                    /* bInterfaceSubClass: */
-        0x00,                    /* bInterfaceProtocol: */
-        0x00,                    /* iInterface: */
+/**
+  * @brief  USBD_CDC_RegisterInterface
+  * @param  pdev: device instance
+  * @param  fops: CD  Interface callback
+  * @retval status
+  */
+uint8_t USBD_CDC_ACM_RegisterInterface(USBD_HandleTypeDef *pdev,
+                                       USBD_CDC_ACM_ItfTypeDef *fops)
+{
+  if (USBD_CoreFindClass(pdev, &USBD_CDC_ACM) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
 
-        /* Endpoint OUT Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_OUT_EP,                         /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
+  if (fops == NULL)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
 
-        /* Endpoint IN Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_IN_EP,                          /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
-#endif
+  USBD_USER_DATA(pdev) = fops;
 
-#if (NUMBER_OF_CDC > 6)
-        /********************  CDC6 block ********************/
-        /******** IAD to associate the two CDC interfaces */
-        0x08,             /* bLength */
-        0x0B,             /* bDescriptorType */
-        _CDC_CMD_ITF_NBR, /* bFirstInterface */
-        0x02,             /* bInterfaceCount */
-        0x02,             /* bFunctionClass */
-        0x02,             /* bFunctionSubClass */
-        0x01,             /* bFunctionProtocol */
-        0x00,             /* iFunction (Index of string descriptor describing this function) */
+  return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_CDC_SetTxBuffer
+  * @param  pdev: device instance
+  * @param  pbuff: Tx Buffer
+  * @retval status
+  */
+uint8_t USBD_CDC_SetTxBuffer(uint8_t ch, USBD_HandleTypeDef *pdev,
+                             uint8_t *pbuff, uint32_t length)
+{
+  USBD_CDC_ACM_HandleTypeDef *hcdc = NULL;
+
+  hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][ch];
 
-        /* Interface Descriptor */
-        0x09,                    /* bLength: Interface Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: Interface */
-        /* Interface descriptor type */
-        _CDC_CMD_ITF_NBR, /* bInterfaceNumber: Number of Interface */
-        0x00,             /* bAlternateSetting: Alternate setting */
-        0x01,             /* bNumEndpoints: One endpoints used */
-        0x02,             /* bInterfaceClass: Communication Interface Class */
-        0x02,             /* bInterfaceSubClass: Abstract Control Model */
-        0x01,             /* bInterfaceProtocol: Common AT commands */
-        _CDC_STR_DESC_IDX,/* iInterface: */
+  hcdc->TxBuffer = pbuff;
+  hcdc->TxLength = length;
 
-        /* Header Functional Descriptor */
-        0x05, /* bLength: Endpoint Descriptor size */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x00, /* bDescriptorSubtype: Header Func Desc */
-        0x10, /* bcdCDC: spec release number */
-        0x01,
+  return (uint8_t)USBD_OK;
+}
 
-        /* Call Management Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x01,             /* bDescriptorSubtype: Call Management Func Desc */
-        0x00,             /* bmCapabilities: D0+D1 */
-        _CDC_COM_ITF_NBR, /* bDataInterface: 1 */
+/**
+  * @brief  USBD_CDC_SetRxBuffer
+  *         Kept for existing interfaces, the channel receives into the
+  *         buffers of its pool
+  * @param  pdev: device instance
+  * @param  pbuff: Rx Buffer, not used
+  * @retval status
+  */
+uint8_t USBD_CDC_SetRxBuffer(uint8_t ch, USBD_HandleTypeDef *pdev, uint8_t *pbuff)
+{
+  UNUSED(ch);
+  UNUSED(pdev);
+  UNUSED(pbuff);
 
-        /* ACM Functional Descriptor */
-        0x04, /* bFunctionLength */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x02, /* bDescriptorSubtype: Abstract Control Management desc */
-        0x02, /* bmCapabilities */
+  return (uint8_t)USBD_OK;
+}
 
-        /* Union Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x06,             /* bDescriptorSubtype: Union func desc */
-        _CDC_CMD_ITF_NBR, /* bMasterInterface: Communication class interface */
-        _CDC_COM_ITF_NBR, /* bSlaveInterface0: Data Class Interface */
+/**
+  * @brief  USBD_CDC_TransmitPacket
+  *         Queue the current Tx buffer on the IN endpoint, the buffer must stay
+  *         valid until TransmitCplt reports it back
+  * @param  pdev: device instance
+  * @retval status: USBD_BUSY when CDC_ACM_TX_QUEUE_DEPTH transfers are pending
+  */
+uint8_t USBD_CDC_TransmitPacket(uint8_t ch, USBD_HandleTypeDef *pdev)
+{
+  USBD_CDC_ACM_HandleTypeDef *hcdc = NULL;
+  USBD_XferTypeDef *xfer;
 
-        /* Endpoint 2 Descriptor */
-        0x07,                        /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
-        _CDC_CMD_EP,                 /* bEndpointAddress */
-        0x03,                        /* bmAttributes: Interrupt */
-        LOBYTE(CDC_CMD_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_CMD_PACKET_SIZE),
-        CDC_FS_BINTERVAL, /* bInterval: */
-        /*---------------------------------------------------------------------------*/
+  hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][ch];
 
-        /* Data class interface descriptor */
-        0x09,                    /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: */
-        _CDC_COM_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x02,                    /* bNumEndpoints: Two endpoints used */
-        0x0A,                    /* bInterfaceClass: CDC */
-        0x00,                    /* bInterfaceSubClass: */
-        0x00,                    /* bInterfaceProtocol: */
-        0x00,                    /* iInterface: */
+  xfer = USBD_Xfer_Alloc(hcdc->TxXfer, CDC_ACM_TX_QUEUE_DEPTH);
 
-        /* Endpoint OUT Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_OUT_EP,                         /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
+  if (xfer == NULL)
+  {
+    return (uint8_t)USBD_BUSY;
+  }
 
-        /* Endpoint IN Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_IN_EP,                          /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
-#endif
+  xfer->ep_addr = CDC_IN_EP(pdev, ch);
+  xfer->pbuf = hcdc->TxBuffer;
+  xfer->length = hcdc->TxLength;
+  xfer->nseg = 0U;
+  xfer->flags = USBD_XFER_FLAG_ZLP;
+  xfer->Cplt = USBD_CDC_TxCplt;
+  xfer->pOwner = hcdc;
 
-#if (NUMBER_OF_CDC > 7)
-        /********************  CDC7 block ********************/
-        /******** IAD to associate the two CDC interfaces */
-        0x08,             /* bLength */
-        0x0B,             /* bDescriptorType */
-        _CDC_CMD_ITF_NBR, /* bFirstInterface */
-        0x02,             /* bInterfaceCount */
-        0x02,             /* bFunctionClass */
-        0x02,             /* bFunctionSubClass */
-        0x01,             /* bFunctionProtocol */
-        0x00,             /* iFunction (Index of string descriptor describing this function) */
+  /* Tx Transfer in progress */
+  hcdc->TxState = 1U;
 
-        /* Interface Descriptor */
-        0x09,                    /* bLength: Interface Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: Interface */
-        /* Interface descriptor type */
-        _CDC_CMD_ITF_NBR, /* bInterfaceNumber: Number of Interface */
-        0x00,             /* bAlternateSetting: Alternate setting */
-        0x01,             /* bNumEndpoints: One endpoints used */
-        0x02,             /* bInterfaceClass: Communication Interface Class */
-        0x02,             /* bInterfaceSubClass: Abstract Control Model */
-        0x01,             /* bInterfaceProtocol: Common AT commands */
-        _CDC_STR_DESC_IDX,/* iInterface: */
+  return (uint8_t)USBD_CDC_TxSubmit(pdev, ch, xfer);
+}
 
-        /* Header Functional Descriptor */
-        0x05, /* bLength: Endpoint Descriptor size */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x00, /* bDescriptorSubtype: Header Func Desc */
-        0x10, /* bcdCDC: spec release number */
-        0x01,
+/**
+  * @brief  USBD_CDC_ACM_ReceivePacket
+  *         Give the oldest buffer passed to Receive back to the pool, the
+  *         OUT endpoint is armed again if it was waiting for one
+  * @param  pdev: device instance
+  * @retval status
+  */
+uint8_t USBD_CDC_ReceivePacket(uint8_t ch, USBD_HandleTypeDef *pdev)
+{
+  USBD_CDC_ACM_HandleTypeDef *hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][ch];
+  uint32_t primask;
 
-        /* Call Management Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x01,             /* bDescriptorSubtype: Call Management Func Desc */
-        0x00,             /* bmCapabilities: D0+D1 */
-        _CDC_COM_ITF_NBR, /* bDataInterface: 1 */
+  USBD_ENTER_CRITICAL(primask);
+  USBD_CDC_RxRelease(pdev, ch, USBD_CDC_RxOldest(hcdc));
+  USBD_EXIT_CRITICAL(primask);
 
-        /* ACM Functional Descriptor */
-        0x04, /* bFunctionLength */
-        0x24, /* bDescriptorType: CS_INTERFACE */
-        0x02, /* bDescriptorSubtype: Abstract Control Management desc */
-        0x02, /* bmCapabilities */
+  return (uint8_t)USBD_OK;
+}
 
-        /* Union Functional Descriptor */
-        0x05,             /* bFunctionLength */
-        0x24,             /* bDescriptorType: CS_INTERFACE */
-        0x06,             /* bDescriptorSubtype: Union func desc */
-        _CDC_CMD_ITF_NBR, /* bMasterInterface: Communication class interface */
-        _CDC_COM_ITF_NBR, /* bSlaveInterface0: Data Class Interface */
+/**
+  * @brief  USBD_CDC_ReleaseRxBuffer
+  *         Give a buffer passed to Receive back to the pool, buffers may be
+  *         given back in any order
+  * @param  pdev: device instance
+  * @param  pbuff: buffer passed to Receive
+  * @retval status: USBD_FAIL when pbuff is not held by the application
+  */
+uint8_t USBD_CDC_ReleaseRxBuffer(uint8_t ch, USBD_HandleTypeDef *pdev, uint8_t *pbuff)
+{
+  USBD_CDC_ACM_HandleTypeDef *hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][ch];
+  uint8_t ret = (uint8_t)USBD_FAIL;
+  uint32_t primask;
 
-        /* Endpoint 2 Descriptor */
-        0x07,                        /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType: Endpoint */
-        _CDC_CMD_EP,                 /* bEndpointAddress */
-        0x03,                        /* bmAttributes: Interrupt */
-        LOBYTE(CDC_CMD_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_CMD_PACKET_SIZE),
-        CDC_FS_BINTERVAL, /* bInterval: */
-        /*---------------------------------------------------------------------------*/
+  USBD_ENTER_CRITICAL(primask);
 
-        /* Data class interface descriptor */
-        0x09,                    /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_INTERFACE, /* bDescriptorType: */
-        _CDC_COM_ITF_NBR,        /* bInterfaceNumber: Number of Interface */
-        0x00,                    /* bAlternateSetting: Alternate setting */
-        0x02,                    /* bNumEndpoints: Two endpoints used */
-        0x0A,                    /* bInterfaceClass: CDC */
-        0x00,                    /* bInterfaceSubClass: */
-        0x00,                    /* bInterfaceProtocol: */
-        0x00,                    /* iInterface: */
+  for (uint8_t idx = 0U; idx < CDC_ACM_RX_POOL_DEPTH; idx++)
+  {
+    if ((pbuff == (uint8_t *)CDC_BUF(pdev, ch)->RxPool[idx]) && ((hcdc->RxHeld & (1UL << idx)) != 0U))
+    {
+      USBD_CDC_RxRelease(pdev, ch, idx);
+      ret = (uint8_t)USBD_OK;
+      break;
+    }
+  }
 
-        /* Endpoint OUT Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_OUT_EP,                         /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
-        0x00, /* bInterval: ignore for Bulk transfer */
+  USBD_EXIT_CRITICAL(primask);
 
-        /* Endpoint IN Descriptor */
-        0x07,                                /* bLength: Endpoint Descriptor size */
-        USB_DESC_TYPE_ENDPOINT,              /* bDescriptorType: Endpoint */
-        _CDC_IN_EP,                          /* bEndpointAddress */
-        0x02,                                /* bmAttributes: Bulk */
-        LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE), /* wMaxPacketSize: */
-        HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
-        0x00 /* bInterval: ignore for Bulk transfer */
-#endif
-};
+  return ret;
+}
 
 /**
-  * @}
+  * @brief  USBD_CDC_RxArm
+  *         Arm the OUT endpoint of a channel with a free pool buffer, it is
+  *         left NAKing when the application holds them all
+  * @param  pdev: device instance
+  * @param  ch: CDC channel
+  * @retval None
   */
+static void USBD_CDC_RxArm(USBD_HandleTypeDef *pdev, uint8_t ch)
+{
+  USBD_CDC_ACM_HandleTypeDef *hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][ch];
+  uint8_t idx = 0U;
 
-/** @defgroup USBD_CDC_Private_Functions
-  * @{
-  */
+  if ((hcdc->RxState != 0U) || (hcdc->RxFree == 0U) || (hcdc->RxThrottle != 0U))
+  {
+    return;
+  }
+
+  while ((hcdc->RxFree & (1UL << idx)) == 0U)
+  {
+    idx++;
+  }
+
+  hcdc->RxFree &= ~(1UL << idx);
+  hcdc->RxArmed = idx;
+  hcdc->RxState = 1U;
+
+#if (CDC_ACM_RX_XFER_SIZE != 0U)
+  /* Prepare Out endpoint to receive packets until a short one or a full
+     buffer, at either speed */
+  (void)USBD_LL_PrepareReceive(pdev, CDC_OUT_EP(pdev, ch), (uint8_t *)CDC_BUF(pdev, ch)->RxPool[idx],
+                               CDC_ACM_RX_XFER_SIZE);
+#else
+  if (pdev->dev_speed == USBD_SPEED_HIGH)
+  {
+    /* Prepare Out endpoint to receive next packet */
+    (void)USBD_LL_PrepareReceive(pdev, CDC_OUT_EP(pdev, ch), (uint8_t *)CDC_BUF(pdev, ch)->RxPool[idx],
+                                 CDC_DATA_HS_OUT_PACKET_SIZE);
+  }
+  else
+  {
+    /* Prepare Out endpoint to receive next packet */
+    (void)USBD_LL_PrepareReceive(pdev, CDC_OUT_EP(pdev, ch), (uint8_t *)CDC_BUF(pdev, ch)->RxPool[idx],
+                                 CDC_DATA_FS_OUT_PACKET_SIZE);
+  }
+#endif /* (CDC_ACM_RX_XFER_SIZE != 0U) */
+}
 
 /**
-  * @brief  USBD_CDC_Init
-  *         Initialize the CDC interface
-  * @param  pdev: device instance
-  * @param  cfgidx: Configuration index
-  * @retval status
+  * @brief  USBD_CDC_RxOldest
+  *         Find the buffer the application has held the longest
+  * @param  hcdc: channel handle
+  * @retval pool index, CDC_ACM_RX_POOL_DEPTH when none is held
   */
-static uint8_t USBD_CDC_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
+static uint8_t USBD_CDC_RxOldest(USBD_CDC_ACM_HandleTypeDef *hcdc)
 {
-  UNUSED(cfgidx);
-  USBD_CDC_ACM_HandleTypeDef *hcdc = NULL;
+  uint8_t oldest = CDC_ACM_RX_POOL_DEPTH;
 
-  for (uint8_t i = 0; i < NUMBER_OF_CDC; i++)
+  for (uint8_t idx = 0U; idx < CDC_ACM_RX_POOL_DEPTH; idx++)
   {
-    hcdc = &CDC_ACM_Class_Data[i];
-
-    if (pdev->dev_speed == USBD_SPEED_HIGH)
+    if (((hcdc->RxHeld & (1UL << idx)) != 0U) &&
+        ((oldest == CDC_ACM_RX_POOL_DEPTH) ||
+         ((int32_t)(hcdc->RxPoolSeq[idx] - hcdc->RxPoolSeq[oldest]) < 0)))
     {
-      /* Open EP IN */
-      (void)USBD_LL_OpenEP(pdev, CDC_IN_EP[i], USBD_EP_TYPE_BULK,
-                           CDC_DATA_HS_IN_PACKET_SIZE);
+      oldest = idx;
+    }
+  }
 
-      pdev->ep_in[CDC_IN_EP[i] & 0xFU].is_used = 1U;
+  return oldest;
+}
 
-      /* Open EP OUT */
-      (void)USBD_LL_OpenEP(pdev, CDC_OUT_EP[i], USBD_EP_TYPE_BULK,
-                           CDC_DATA_HS_OUT_PACKET_SIZE);
+/**
+  * @brief  USBD_CDC_RxRelease
+  *         Return a held buffer to the pool and arm the OUT endpoint if it
+  *         was starved, called with interrupts masked
+  * @param  pdev: device instance
+  * @param  ch: CDC channel
+  * @param  idx: pool index, CDC_ACM_RX_POOL_DEPTH to only arm the endpoint
+  * @retval None
+  */
+static void USBD_CDC_RxRelease(USBD_HandleTypeDef *pdev, uint8_t ch, uint8_t idx)
+{
+  USBD_CDC_ACM_HandleTypeDef *hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][ch];
 
-      pdev->ep_out[CDC_OUT_EP[i] & 0xFU].is_used = 1U;
+  if (idx < CDC_ACM_RX_POOL_DEPTH)
+  {
+    hcdc->RxHeld &= ~(1UL << idx);
+    hcdc->RxFree |= (1UL << idx);
+  }
 
-      /* Set bInterval for CDC CMD Endpoint */
-      pdev->ep_in[CDC_CMD_EP[i] & 0xFU].bInterval = CDC_HS_BINTERVAL;
-    }
-    else
-    {
-      /* Open EP IN */
-      (void)USBD_LL_OpenEP(pdev, CDC_IN_EP[i], USBD_EP_TYPE_BULK,
-                           CDC_DATA_FS_IN_PACKET_SIZE);
+  if (pdev->dev_state == USBD_STATE_CONFIGURED)
+  {
+    USBD_CDC_RxArm(pdev, ch);
+  }
+}
 
-      pdev->ep_in[CDC_IN_EP[i] & 0xFU].is_used = 1U;
+/**
+  * @brief  USBD_CDC_TxWrite
+  *         Copy data into the transmit ring of a channel without blocking,
+  *         whole packets leave at once and a partial one waits for more
+  *         data until its flush deadline. One writer per channel.
+  * @param  ch: CDC channel
+  * @param  pdev: device instance
+  * @param  pbuf: data to send, free again on return
+  * @param  length: number of bytes to send
+  * @retval number of bytes taken, less than length when the ring is full
+  */
+uint32_t USBD_CDC_TxWrite(uint8_t ch, USBD_HandleTypeDef *pdev, const uint8_t *pbuf,
+                          uint32_t length)
+{
+  USBD_CDC_ACM_HandleTypeDef *hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][ch];
+  uint8_t *ring = (uint8_t *)CDC_BUF(pdev, ch)->TxRing;
+  uint32_t head = hcdc->TxHead;
+  uint32_t off = head & (CDC_ACM_TX_RING_SIZE - 1U);
+  uint32_t len;
+  uint32_t part;
+  uint32_t primask;
+
+  len = MIN(length, CDC_ACM_TX_RING_SIZE - (head - hcdc->TxTail));
+  part = MIN(len, CDC_ACM_TX_RING_SIZE - off);
+
+  (void)USBD_memcpy(&ring[off], pbuf, part);
+  (void)USBD_memcpy(ring, &pbuf[part], len - part);
+
+  /* The stack sees the data once the head moves */
+  USBD_ENTER_CRITICAL(primask);
+  hcdc->TxHead = head + len;
+  USBD_CDC_TxKick(pdev, ch, 0U);
+  USBD_EXIT_CRITICAL(primask);
+
+  return len;
+}
 
-      /* Open EP OUT */
-      (void)USBD_LL_OpenEP(pdev, CDC_OUT_EP[i], USBD_EP_TYPE_BULK,
-                           CDC_DATA_FS_OUT_PACKET_SIZE);
+/**
+  * @brief  USBD_CDC_TxFree
+  *         Room left in the transmit ring of a channel, for a writer that
+  *         must not cut its records
+  * @param  ch: CDC channel
+  * @param  pdev: device instance
+  * @retval number of bytes USBD_CDC_TxWrite takes at once
+  */
+uint32_t USBD_CDC_TxFree(uint8_t ch, USBD_HandleTypeDef *pdev)
+{
+  USBD_CDC_ACM_HandleTypeDef *hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][ch];
 
-      pdev->ep_out[CDC_OUT_EP[i] & 0xFU].is_used = 1U;
+  return CDC_ACM_TX_RING_SIZE - (hcdc->TxHead - hcdc->TxTail);
+}
 
-      /* Set bInterval for CMD Endpoint */
-      pdev->ep_in[CDC_CMD_EP[i] & 0xFU].bInterval = CDC_FS_BINTERVAL;
-    }
+/**
+  * @brief  USBD_CDC_TxFlush
+  *         Send the data waiting in the transmit ring of a channel without
+  *         waiting for its deadline, for a timer driven flush or the end of
+  *         a message
+  * @param  ch: CDC channel
+  * @param  pdev: device instance
+  * @retval status
+  */
+uint8_t USBD_CDC_TxFlush(uint8_t ch, USBD_HandleTypeDef *pdev)
+{
+  uint32_t primask;
 
-    /* Open Command IN EP */
-    (void)USBD_LL_OpenEP(pdev, CDC_CMD_EP[i], USBD_EP_TYPE_INTR, CDC_CMD_PACKET_SIZE);
-    pdev->ep_in[CDC_CMD_EP[i] & 0xFU].is_used = 1U;
+  USBD_ENTER_CRITICAL(primask);
+  USBD_CDC_TxKick(pdev, ch, 1U);
+  USBD_EXIT_CRITICAL(primask);
 
-    /* Init  physical Interface components */
-    ((USBD_CDC_ACM_ItfTypeDef *)pdev->pUserData_CDC_ACM)->Init(i);
+  return (uint8_t)USBD_OK;
+}
 
-    /* Init Xfer states */
-    hcdc->TxState = 0U;
-    hcdc->RxState = 0U;
+/**
+  * @brief  USBD_CDC_SetTxCoalescing
+  *         Tune the transmit ring of a channel between throughput and
+  *         latency, the setting survives a reconfiguration
+  * @param  ch: CDC channel
+  * @param  pdev: device instance
+  * @param  chain: max size packets one transfer may carry, from 1
+  * @param  flush_sof: SOF periods a partial packet may wait, 0 sends at once
+  * @retval status
+  */
+uint8_t USBD_CDC_SetTxCoalescing(uint8_t ch, USBD_HandleTypeDef *pdev,
+                                 uint16_t chain, uint16_t flush_sof)
+{
+  USBD_CDC_ACM_HandleTypeDef *hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][ch];
+  uint32_t primask;
 
-    if (pdev->dev_speed == USBD_SPEED_HIGH)
-    {
-      /* Prepare Out endpoint to receive next packet */
-      (void)USBD_LL_PrepareReceive(pdev, CDC_OUT_EP[i], hcdc->RxBuffer,
-                                   CDC_DATA_HS_OUT_PACKET_SIZE);
-    }
-    else
-    {
-      /* Prepare Out endpoint to receive next packet */
-      (void)USBD_LL_PrepareReceive(pdev, CDC_OUT_EP[i], hcdc->RxBuffer,
-                                   CDC_DATA_FS_OUT_PACKET_SIZE);
-    }
+  if (chain == 0U)
+  {
+    return (uint8_t)USBD_FAIL;
   }
+
+  USBD_ENTER_CRITICAL(primask);
+  hcdc->TxChain = chain;
+  hcdc->TxFlushSof = flush_sof;
+  hcdc->TxAge = MIN(hcdc->TxAge, flush_sof);
+  USBD_EXIT_CRITICAL(primask);
+
   return (uint8_t)USBD_OK;
 }
 
 /**
-  * @brief  USBD_CDC_Init
-  *         DeInitialize the CDC layer
+  * @brief  USBD_CDC_TxKick
+  *         Start the next transmit ring transfer of a channel: the next
+  *         contiguous span, cut to whole packets while more data follows and
+  *         to the chain limit. A partial packet alone waits for its deadline
+  *         unless forced. Called with interrupts masked.
   * @param  pdev: device instance
-  * @param  cfgidx: Configuration index
-  * @retval status
+  * @param  ch: CDC channel
+  * @param  force: 1 to send a partial packet before its deadline
+  * @retval None
   */
-static uint8_t USBD_CDC_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
+static void USBD_CDC_TxKick(USBD_HandleTypeDef *pdev, uint8_t ch, uint8_t force)
 {
-  UNUSED(cfgidx);
-  for (uint8_t i = 0; i < NUMBER_OF_CDC; i++)
+  USBD_CDC_ACM_HandleTypeDef *hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][ch];
+  USBD_XferTypeDef *xfer = &hcdc->TxRingXfer;
+  uint8_t ep_addr = CDC_IN_EP(pdev, ch);
+  uint32_t avail = hcdc->TxHead - hcdc->TxTail;
+  uint32_t off = hcdc->TxTail & (CDC_ACM_TX_RING_SIZE - 1U);
+  uint32_t mps = pdev->ep_in[ep_addr & 0xFU].maxpacket;
+  uint32_t len;
+
+  if ((avail == 0U) || (xfer->state != USBD_XFER_STATE_IDLE) ||
+      (pdev->ep_in[ep_addr & 0xFU].is_used == 0U) || (mps == 0U))
   {
-    /* Close EP IN */
-    (void)USBD_LL_CloseEP(pdev, CDC_IN_EP[i]);
-    pdev->ep_in[CDC_IN_EP[i] & 0xFU].is_used = 0U;
+    return;
+  }
 
-    /* Close EP OUT */
-    (void)USBD_LL_CloseEP(pdev, CDC_OUT_EP[i]);
-    pdev->ep_out[CDC_OUT_EP[i] & 0xFU].is_used = 0U;
+#if (CDC_ACM_TX_RTS_FLOW == 1U)
+  /* The host cannot take more, the ring fills and TxWrite pushes back */
+  if ((hcdc->LineState & CDC_CONTROL_LINE_RTS) == 0U)
+  {
+    return;
+  }
+#endif /* (CDC_ACM_TX_RTS_FLOW == 1U) */
 
-    /* Close Command IN EP */
-    (void)USBD_LL_CloseEP(pdev, CDC_CMD_EP[i]);
-    pdev->ep_in[CDC_CMD_EP[i] & 0xFU].is_used = 0U;
-    pdev->ep_in[CDC_CMD_EP[i] & 0xFU].bInterval = 0U;
+  if ((avail < mps) && (force == 0U) && (hcdc->TxAge < hcdc->TxFlushSof))
+  {
+    return;
+  }
 
-    /* DeInit  physical Interface components */
-    ((USBD_CDC_ACM_ItfTypeDef *)pdev->pUserData_CDC_ACM)->DeInit(i);
+  len = MIN(avail, CDC_ACM_TX_RING_SIZE - off);
+  len = MIN(len, (uint32_t)hcdc->TxChain * mps);
+
+  /* A short packet would end the host read, keep the remainder back to be
+     coalesced with the data that follows */
+  if ((len < avail) && (len > mps))
+  {
+    len -= len % mps;
+  }
+
+  xfer->ep_addr = ep_addr;
+  xfer->pbuf = &((uint8_t *)CDC_BUF(pdev, ch)->TxRing)[off];
+  xfer->length = len;
+  xfer->nseg = 0U;
+  xfer->Cplt = USBD_CDC_TxRingCplt;
+  xfer->pOwner = hcdc;
+
+  /* Only the transfer that empties the ring ends with a ZLP, the deadline
+     restarts with the data written after it */
+  if (len == avail)
+  {
+    xfer->flags = USBD_XFER_FLAG_ZLP;
+    hcdc->TxAge = 0U;
+  }
+  else
+  {
+    xfer->flags = USBD_XFER_FLAG_NONE;
+  }
+
+  /* Tx Transfer in progress */
+  hcdc->TxState = 1U;
+
+  if ((USBD_CDC_TxSubmit(pdev, ch, xfer) != USBD_OK) &&
+      (USBD_Xfer_IsIdle(pdev, ep_addr) != 0U) && (CDC_TX_WAITING(hcdc) == 0U))
+  {
+    hcdc->TxState = 0U;
   }
-  return (uint8_t)USBD_OK;
 }
 
 /**
-  * @brief  USBD_CDC_Setup
-  *         Handle the CDC specific requests
-  * @param  pdev: instance
-  * @param  req: usb requests
+  * @brief  USBD_CDC_TxSubmit
+  *         Submit a data IN transfer of a channel, through the scheduler
+  *         when CDC_ACM_TX_SCHED is set
+  * @param  pdev: device instance
+  * @param  ch: CDC channel
+  * @param  xfer: idle or reserved transfer descriptor
   * @retval status
   */
-static uint8_t USBD_CDC_Setup(USBD_HandleTypeDef *pdev,
-                              USBD_SetupReqTypedef *req)
+static USBD_StatusTypeDef USBD_CDC_TxSubmit(USBD_HandleTypeDef *pdev, uint8_t ch,
+                                            USBD_XferTypeDef *xfer)
 {
-  USBD_CDC_ACM_HandleTypeDef *hcdc = NULL;
-  uint16_t len;
-  uint8_t ifalt = 0U;
-  uint16_t status_info = 0U;
-  USBD_StatusTypeDef ret = USBD_OK;
+#if (CDC_ACM_TX_SCHED == 1U)
+  USBD_CDC_ACM_HandleTypeDef *hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][ch];
+  uint32_t primask;
+  uint8_t idx;
 
-  uint8_t windex_to_ch = 0;
+  if ((xfer->state != USBD_XFER_STATE_IDLE) &&
+      (xfer->state != USBD_XFER_STATE_RESERVED))
+  {
+    return USBD_BUSY;
+  }
 
-  for (uint8_t i = 0; i < NUMBER_OF_CDC; i++)
+  /* The descriptor is the channel's until the scheduler submits it, with
+     the class that queued it */
+  xfer->state = USBD_XFER_STATE_RESERVED;
+  xfer->classId = pdev->classId;
+  xfer->next = NULL;
+
+  USBD_ENTER_CRITICAL(primask);
+
+  if (hcdc->TxPendTail == NULL)
   {
-    if (LOBYTE(req->wIndex) == CDC_CMD_ITF_NBR[i] || LOBYTE(req->wIndex) == CDC_COM_ITF_NBR[i])
-    {
-      windex_to_ch = i;
-      break;
-    }
+    hcdc->TxPendHead = xfer;
+  }
+  else
+  {
+    hcdc->TxPendTail->next = xfer;
   }
 
-  hcdc = &CDC_ACM_Class_Data[windex_to_ch];
+  hcdc->TxPendTail = xfer;
 
-  switch (req->bmRequest & USB_REQ_TYPE_MASK)
+  idx = (uint8_t)((hcdc->TxStampFirst + hcdc->TxPendCount) % (CDC_ACM_TX_QUEUE_DEPTH + 1U));
+  hcdc->TxStamp[idx] = CDC_ACM_Sched[USBD_DEV_IDX(pdev)].Frame;
+  hcdc->TxPendCount++;
+
+  USBD_CDC_TxSchedule(pdev);
+
+  USBD_EXIT_CRITICAL(primask);
+
+  return USBD_OK;
+#else
+  UNUSED(ch);
+
+  return USBD_Xfer_Submit(pdev, xfer);
+#endif /* (CDC_ACM_TX_SCHED == 1U) */
+}
+
+#if (CDC_ACM_TX_SCHED == 1U)
+/**
+  * @brief  USBD_CDC_TxSchedule
+  *         Fill the free slots with waiting transfers, deficit round-robin:
+  *         each visit credits a channel its weight in quanta and sends its
+  *         transfers while they fit in the credit. A channel with nothing
+  *         waiting loses its credit. Called with interrupts masked.
+  * @param  pdev: device instance
+  * @retval None
+  */
+static void USBD_CDC_TxSchedule(USBD_HandleTypeDef *pdev)
+{
+  USBD_CDC_ACM_SchedTypeDef *psched = &CDC_ACM_Sched[USBD_DEV_IDX(pdev)];
+  USBD_CDC_ACM_HandleTypeDef *hcdc;
+  USBD_XferTypeDef *xfer;
+  uint32_t wait;
+  uint8_t class_id;
+  uint8_t idle = 0U;
+
+  /* Stops once every channel was seen without a waiting transfer */
+  while ((psched->InFlight < CDC_ACM_TX_SCHED_SLOTS) && (idle < NUMBER_OF_CDC))
   {
-  case USB_REQ_TYPE_CLASS:
-    if (req->wLength != 0U)
+    hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][psched->Next];
+    xfer = hcdc->TxPendHead;
+
+    if (xfer == NULL)
     {
-      if ((req->bmRequest & 0x80U) != 0U)
-      {
-        ((USBD_CDC_ACM_ItfTypeDef *)pdev->pUserData_CDC_ACM)->Control(windex_to_ch, req->bRequest, (uint8_t *)hcdc->data[windex_to_ch], req->wLength);
+      hcdc->TxDeficit = 0U;
+      psched->Next = (uint8_t)((psched->Next + 1U) % NUMBER_OF_CDC);
+      psched->Credited = 0U;
+      idle++;
+      continue;
+    }
 
-        len = MIN(CDC_REQ_MAX_DATA_SIZE, req->wLength);
-        (void)USBD_CtlSendData(pdev, (uint8_t *)hcdc->data[windex_to_ch], len);
-      }
-      else
-      {
-        hcdc->CmdOpCode = req->bRequest;
-        hcdc->CmdLength = (uint8_t)req->wLength;
+    idle = 0U;
 
-        (void)USBD_CtlPrepareRx(pdev, (uint8_t *)hcdc->data[windex_to_ch], req->wLength);
-      }
+    if (psched->Credited == 0U)
+    {
+      hcdc->TxDeficit += (uint32_t)CDC_ACM_TX_SCHED_QUANTUM * hcdc->TxWeight;
+      psched->Credited = 1U;
     }
-    else
+
+    /* A transfer larger than the credit waits for the next rounds */
+    if (xfer->length > hcdc->TxDeficit)
     {
-      ((USBD_CDC_ACM_ItfTypeDef *)pdev->pUserData_CDC_ACM)->Control(windex_to_ch, req->bRequest, (uint8_t *)req, 0U);
+      psched->Next = (uint8_t)((psched->Next + 1U) % NUMBER_OF_CDC);
+      psched->Credited = 0U;
+      continue;
     }
-    break;
 
-  case USB_REQ_TYPE_STANDARD:
-    switch (req->bRequest)
+    hcdc->TxDeficit -= xfer->length;
+    hcdc->TxPendHead = xfer->next;
+
+    if (hcdc->TxPendHead == NULL)
     {
-    case USB_REQ_GET_STATUS:
-      if (pdev->dev_state == USBD_STATE_CONFIGURED)
-      {
-        (void)USBD_CtlSendData(pdev, (uint8_t *)&status_info, 2U);
-      }
-      else
-      {
-        USBD_CtlError(pdev, req);
-        ret = USBD_FAIL;
-      }
-      break;
+      hcdc->TxPendTail = NULL;
+    }
 
-    case USB_REQ_GET_INTERFACE:
-      if (pdev->dev_state == USBD_STATE_CONFIGURED)
-      {
-        (void)USBD_CtlSendData(pdev, &ifalt, 1U);
-      }
-      else
-      {
-        USBD_CtlError(pdev, req);
-        ret = USBD_FAIL;
-      }
-      break;
+    wait = psched->Frame - hcdc->TxStamp[hcdc->TxStampFirst];
+    hcdc->TxStampFirst = (uint8_t)((hcdc->TxStampFirst + 1U) % (CDC_ACM_TX_QUEUE_DEPTH + 1U));
+    hcdc->TxPendCount--;
 
-    case USB_REQ_SET_INTERFACE:
-      if (pdev->dev_state != USBD_STATE_CONFIGURED)
-      {
-        USBD_CtlError(pdev, req);
-        ret = USBD_FAIL;
-      }
-      break;
+    hcdc->TxStats.WaitSum += wait;
+    hcdc->TxStats.WaitMax = MAX(hcdc->TxStats.WaitMax, wait);
 
-    case USB_REQ_CLEAR_FEATURE:
-      break;
+    psched->InFlight++;
 
-    default:
-      USBD_CtlError(pdev, req);
-      ret = USBD_FAIL;
-      break;
+    /* Submitted on behalf of the class that queued it */
+    class_id = pdev->classId;
+    pdev->classId = xfer->classId;
+
+    /* Refused by the LL, the slot stays free and the transfer is dropped */
+    if (USBD_Xfer_Submit(pdev, xfer) != USBD_OK)
+    {
+      psched->InFlight--;
     }
-    break;
 
-  default:
-    USBD_CtlError(pdev, req);
-    ret = USBD_FAIL;
-    break;
+    pdev->classId = class_id;
   }
-
-  return (uint8_t)ret;
 }
 
 /**
-  * @brief  USBD_CDC_DataIn
-  *         Data sent on non-control IN endpoint
+  * @brief  USBD_CDC_TxRetire
+  *         Count a completed scheduled transfer and give its slot to the
+  *         next waiting one. Called from the transfer completion.
   * @param  pdev: device instance
-  * @param  epnum: endpoint number
-  * @retval status
+  * @param  xfer: completed transfer descriptor
+  * @retval None
   */
-static uint8_t USBD_CDC_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
+static void USBD_CDC_TxRetire(USBD_HandleTypeDef *pdev, USBD_XferTypeDef *xfer)
 {
-  USBD_CDC_ACM_HandleTypeDef *hcdc = NULL;
-  PCD_HandleTypeDef *hpcd = pdev->pData;
-  uint8_t ep_to_ch = 0;
+  USBD_CDC_ACM_HandleTypeDef *hcdc = (USBD_CDC_ACM_HandleTypeDef *)xfer->pOwner;
+  USBD_CDC_ACM_SchedTypeDef *psched = &CDC_ACM_Sched[USBD_DEV_IDX(pdev)];
+  uint32_t primask;
 
-  for (uint8_t i = 0; i < NUMBER_OF_CDC; i++)
+  USBD_ENTER_CRITICAL(primask);
+
+  hcdc->TxStats.Bytes += xfer->length;
+  hcdc->TxStats.Transfers++;
+
+  if (psched->InFlight != 0U)
   {
-    if (epnum == (CDC_IN_EP[i] & 0x0F))
-    {
-      ep_to_ch = i;
-      break;
-    }
+    psched->InFlight--;
   }
 
-  hcdc = &CDC_ACM_Class_Data[ep_to_ch];
+  USBD_CDC_TxSchedule(pdev);
 
-  if ((pdev->ep_in[epnum].total_length > 0U) &&
-      ((pdev->ep_in[epnum].total_length % hpcd->IN_ep[epnum].maxpacket) == 0U))
-  {
-    /* Update the packet total length */
-    pdev->ep_in[epnum].total_length = 0U;
+  USBD_EXIT_CRITICAL(primask);
+}
 
-    /* Send ZLP */
-    (void)USBD_LL_Transmit(pdev, epnum, NULL, 0U);
-  }
-  else
+/**
+  * @brief  USBD_CDC_SetTxWeight
+  *         Share of the IN bandwidth a channel gets while others transmit,
+  *         the setting survives a reconfiguration
+  * @param  ch: CDC channel
+  * @param  pdev: device instance
+  * @param  weight: quanta per round, from 1
+  * @retval status
+  */
+uint8_t USBD_CDC_SetTxWeight(uint8_t ch, USBD_HandleTypeDef *pdev, uint8_t weight)
+{
+  if (weight == 0U)
   {
-    hcdc->TxState = 0U;
-
-    if (((USBD_CDC_ACM_ItfTypeDef *)pdev->pUserData_CDC_ACM)->TransmitCplt != NULL)
-    {
-      ((USBD_CDC_ACM_ItfTypeDef *)pdev->pUserData_CDC_ACM)->TransmitCplt(ep_to_ch, hcdc->TxBuffer, &hcdc->TxLength, epnum);
-    }
+    return (uint8_t)USBD_FAIL;
   }
 
+  CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][ch].TxWeight = weight;
+
   return (uint8_t)USBD_OK;
 }
 
 /**
-  * @brief  USBD_CDC_DataOut
-  *         Data received on non-control Out endpoint
+  * @brief  USBD_CDC_GetTxStats
+  *         Read the transmit counters of a channel: bytes and transfers
+  *         completed, SOF periods transfers waited for the scheduler
+  * @param  ch: CDC channel
   * @param  pdev: device instance
-  * @param  epnum: endpoint number
+  * @param  pstats: counters out
+  * @param  clear: 1 to restart the counters
   * @retval status
   */
-static uint8_t USBD_CDC_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
+uint8_t USBD_CDC_GetTxStats(uint8_t ch, USBD_HandleTypeDef *pdev,
+                            USBD_CDC_ACM_TxStatsTypeDef *pstats, uint8_t clear)
 {
-  USBD_CDC_ACM_HandleTypeDef *hcdc = NULL;
-  uint8_t ep_to_ch = 0;
+  USBD_CDC_ACM_HandleTypeDef *hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][ch];
+  uint32_t primask;
 
-  for (uint8_t i = 0; i < NUMBER_OF_CDC; i++)
+  if (pstats == NULL)
   {
-    if (epnum == CDC_OUT_EP[i])
-    {
-      ep_to_ch = i;
-      break;
-    }
+    return (uint8_t)USBD_FAIL;
   }
 
-  hcdc = &CDC_ACM_Class_Data[ep_to_ch];
+  USBD_ENTER_CRITICAL(primask);
 
-  /* Get the received data length */
-  hcdc->RxLength = USBD_LL_GetRxDataSize(pdev, epnum);
+  *pstats = hcdc->TxStats;
 
-  /* USB data will be immediately processed, this allow next USB traffic being
-  NAKed till the end of the application Xfer */
+  if (clear != 0U)
+  {
+    (void)USBD_memset(&hcdc->TxStats, 0, sizeof(hcdc->TxStats));
+  }
 
-  ((USBD_CDC_ACM_ItfTypeDef *)pdev->pUserData_CDC_ACM)->Receive(ep_to_ch, hcdc->RxBuffer, &hcdc->RxLength);
+  USBD_EXIT_CRITICAL(primask);
 
   return (uint8_t)USBD_OK;
 }
+#endif /* (CDC_ACM_TX_SCHED == 1U) */
 
 /**
-  * @brief  USBD_CDC_EP0_RxReady
-  *         Handle EP0 Rx Ready event
+  * @brief  USBD_CDC_SetRxThrottle
+  *         Keep the OUT endpoint of a channel NAKing while the application
+  *         cannot take more data, whatever the free pool buffers. A buffer
+  *         already armed may still be filled once.
+  * @param  ch: CDC channel
   * @param  pdev: device instance
+  * @param  throttle: 1 to hold the host back, 0 to let it send again
   * @retval status
   */
-static uint8_t USBD_CDC_EP0_RxReady(USBD_HandleTypeDef *pdev)
+uint8_t USBD_CDC_SetRxThrottle(uint8_t ch, USBD_HandleTypeDef *pdev, uint8_t throttle)
 {
-  USBD_CDC_ACM_HandleTypeDef *hcdc = NULL;
-
-  for (uint8_t i = 0; i < NUMBER_OF_CDC; i++)
-  {
-    hcdc = &CDC_ACM_Class_Data[i];
+  USBD_CDC_ACM_HandleTypeDef *hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][ch];
+  uint32_t primask;
 
-    if (hcdc == NULL)
-    {
-      return (uint8_t)USBD_FAIL;
-    }
+  USBD_ENTER_CRITICAL(primask);
+  hcdc->RxThrottle = (throttle != 0U) ? 1U : 0U;
 
-    if ((pdev->pUserData_CDC_ACM != NULL) && (hcdc->CmdOpCode != 0xFFU))
-    {
-      ((USBD_CDC_ACM_ItfTypeDef *)pdev->pUserData_CDC_ACM)->Control(i, hcdc->CmdOpCode, (uint8_t *)hcdc->data[i], (uint16_t)hcdc->CmdLength);
-      hcdc->CmdOpCode = 0xFFU;
-    }
+  if (throttle == 0U)
+  {
+    USBD_CDC_RxRelease(pdev, ch, CDC_ACM_RX_POOL_DEPTH);
   }
+  USBD_EXIT_CRITICAL(primask);
 
   return (uint8_t)USBD_OK;
 }
 
 /**
-  * @brief  USBD_CDC_GetFSCfgDesc
-  *         Return configuration descriptor
-  * @param  speed : current device speed
-  * @param  length : pointer data length
-  * @retval pointer to descriptor buffer
+  * @brief  USBD_CDC_GetLineState
+  *         Control lines last set by the host, DTR is usually raised while
+  *         a terminal has the port open
+  * @param  ch: CDC channel
+  * @param  pdev: device instance
+  * @retval CDC_CONTROL_LINE_DTR and CDC_CONTROL_LINE_RTS bits
   */
-static uint8_t *USBD_CDC_GetFSCfgDesc(uint16_t *length)
+uint16_t USBD_CDC_GetLineState(uint8_t ch, USBD_HandleTypeDef *pdev)
 {
-  *length = (uint16_t)sizeof(USBD_CDC_CfgFSDesc);
-
-  return USBD_CDC_CfgFSDesc;
+  return CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][ch].LineState;
 }
 
 /**
-  * @brief  USBD_CDC_GetHSCfgDesc
-  *         Return configuration descriptor
-  * @param  speed : current device speed
-  * @param  length : pointer data length
-  * @retval pointer to descriptor buffer
+  * @brief  USBD_CDC_SetSerialState
+  *         Set the DCD and DSR levels of a channel, the host is notified
+  *         when they change
+  * @param  ch: CDC channel
+  * @param  pdev: device instance
+  * @param  levels: CDC_SERIAL_STATE_DCD and CDC_SERIAL_STATE_DSR bits
+  * @retval status: USBD_FAIL when the host is not notified, CDC_ACM_NOTIFY
+  *         is 0 or the channel has no command endpoint
   */
-static uint8_t *USBD_CDC_GetHSCfgDesc(uint16_t *length)
+uint8_t USBD_CDC_SetSerialState(uint8_t ch, USBD_HandleTypeDef *pdev, uint16_t levels)
 {
-  *length = (uint16_t)sizeof(USBD_CDC_CfgHSDesc);
+  USBD_CDC_ACM_HandleTypeDef *hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][ch];
+  uint32_t primask;
+
+  USBD_ENTER_CRITICAL(primask);
+  hcdc->SerialLevels = levels & CDC_SERIAL_STATE_LEVELS;
+  USBD_CDC_NotifyKick(pdev, ch);
+  USBD_EXIT_CRITICAL(primask);
 
-  return USBD_CDC_CfgHSDesc;
+  return ((CDC_ACM_NOTIFY == 1U) && (CDC_CMD_EP(pdev, ch) != 0U)) ? (uint8_t)USBD_OK : (uint8_t)USBD_FAIL;
 }
 
 /**
-  * @brief  USBD_CDC_GetOtherSpeedCfgDesc
-  *         Return configuration descriptor
-  * @param  speed : current device speed
-  * @param  length : pointer data length
-  * @retval pointer to descriptor buffer
+  * @brief  USBD_CDC_ReportSerialEvent
+  *         Report a break, ring, framing, parity or overrun event of a
+  *         channel. Events raised while a notification is on its way are
+  *         merged into the next one.
+  * @param  ch: CDC channel
+  * @param  pdev: device instance
+  * @param  events: CDC_SERIAL_STATE_BREAK to CDC_SERIAL_STATE_OVERRUN bits
+  * @retval status: USBD_FAIL when the host is not notified, CDC_ACM_NOTIFY
+  *         is 0 or the channel has no command endpoint
   */
-static uint8_t *USBD_CDC_GetOtherSpeedCfgDesc(uint16_t *length)
+uint8_t USBD_CDC_ReportSerialEvent(uint8_t ch, USBD_HandleTypeDef *pdev, uint16_t events)
 {
-  *length = (uint16_t)sizeof(USBD_CDC_CfgFSDesc);
+  USBD_CDC_ACM_HandleTypeDef *hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][ch];
+  uint32_t primask;
 
-  return USBD_CDC_CfgFSDesc;
+  USBD_ENTER_CRITICAL(primask);
+  hcdc->SerialEvents |= events & (uint16_t)~CDC_SERIAL_STATE_LEVELS;
+  USBD_CDC_NotifyKick(pdev, ch);
+  USBD_EXIT_CRITICAL(primask);
+
+  return ((CDC_ACM_NOTIFY == 1U) && (CDC_CMD_EP(pdev, ch) != 0U)) ? (uint8_t)USBD_OK : (uint8_t)USBD_FAIL;
 }
 
+#if (CDC_ACM_NOTIFY == 1U)
 /**
-  * @brief  USBD_CDC_GetDeviceQualifierDescriptor
-  *         return Device Qualifier descriptor
-  * @param  length : pointer data length
-  * @retval pointer to descriptor buffer
+  * @brief  USBD_CDC_NotifyCplt
+  *         Transfer queue completion of a SERIAL_STATE notification, what
+  *         changed meanwhile is sent next
+  * @param  pdev: device instance
+  * @param  xfer: completed transfer descriptor
+  * @retval None
   */
-uint8_t *USBD_CDC_GetDeviceQualifierDescriptor(uint16_t *length)
+static void USBD_CDC_NotifyCplt(USBD_HandleTypeDef *pdev, USBD_XferTypeDef *xfer)
 {
-  *length = (uint16_t)sizeof(USBD_CDC_DeviceQualifierDesc);
+  USBD_CDC_ACM_HandleTypeDef *hcdc = (USBD_CDC_ACM_HandleTypeDef *)xfer->pOwner;
 
-  return USBD_CDC_DeviceQualifierDesc;
+  USBD_CDC_NotifyKick(pdev, (uint8_t)(hcdc - CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)]));
 }
+#endif /* (CDC_ACM_NOTIFY == 1U) */
 
 /**
-  * @brief  USBD_CDC_RegisterInterface
+  * @brief  USBD_CDC_NotifyKick
+  *         Send a SERIAL_STATE notification when the levels changed or an
+  *         event is pending. The event bits are cleared once sent, as the
+  *         host expects. Called with interrupts masked.
   * @param  pdev: device instance
-  * @param  fops: CD  Interface callback
-  * @retval status
+  * @param  ch: CDC channel
+  * @retval None
   */
-uint8_t USBD_CDC_ACM_RegisterInterface(USBD_HandleTypeDef *pdev,
-                                       USBD_CDC_ACM_ItfTypeDef *fops)
+static void USBD_CDC_NotifyKick(USBD_HandleTypeDef *pdev, uint8_t ch)
 {
-  if (fops == NULL)
+#if (CDC_ACM_NOTIFY == 1U)
+  USBD_CDC_ACM_HandleTypeDef *hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][ch];
+  USBD_XferTypeDef *xfer = &CDC_BUF(pdev, ch)->NotifyXfer;
+  uint8_t *pnotify = (uint8_t *)CDC_BUF(pdev, ch)->Notify;
+  uint8_t ep_addr = CDC_CMD_EP(pdev, ch);
+  uint16_t state;
+
+  /* Without a command endpoint the state is only kept */
+  if ((ep_addr == 0U) || (pdev->ep_in[ep_addr & 0xFU].is_used == 0U) ||
+      (xfer->state != USBD_XFER_STATE_IDLE))
   {
-    return (uint8_t)USBD_FAIL;
+    return;
   }
 
-  pdev->pUserData_CDC_ACM = fops;
+  if ((hcdc->SerialLevels == hcdc->SerialSent) && (hcdc->SerialEvents == 0U))
+  {
+    return;
+  }
 
-  return (uint8_t)USBD_OK;
+  state = hcdc->SerialLevels | hcdc->SerialEvents;
+  hcdc->SerialSent = hcdc->SerialLevels;
+  hcdc->SerialEvents = 0U;
+
+  pnotify[0] = 0xA1U;  /* device to host, class, interface */
+  pnotify[1] = CDC_SERIAL_STATE;
+  pnotify[2] = 0U;
+  pnotify[3] = 0U;
+  pnotify[4] = CDC_CMD_ITF_NBR(pdev, ch);
+  pnotify[5] = 0U;
+  pnotify[6] = 2U;
+  pnotify[7] = 0U;
+  pnotify[8] = LOBYTE(state);
+  pnotify[9] = HIBYTE(state);
+
+  xfer->ep_addr = ep_addr;
+  xfer->pbuf = pnotify;
+  xfer->length = CDC_SERIAL_STATE_SIZE;
+  xfer->nseg = 0U;
+  xfer->flags = USBD_XFER_FLAG_NONE;
+  xfer->Cplt = USBD_CDC_NotifyCplt;
+  xfer->pOwner = hcdc;
+
+  (void)USBD_Xfer_Submit(pdev, xfer);
+#else
+  /* Notifications compiled out, the state is only kept */
+  UNUSED(pdev);
+  UNUSED(ch);
+#endif /* (CDC_ACM_NOTIFY == 1U) */
 }
 
+#if (USBD_USE_OS == 1U)
 /**
-  * @brief  USBD_CDC_SetTxBuffer
+  * @brief  USBD_CDC_Write
+  *         Send a buffer on a channel and block until the host has read it
+  * @param  ch: CDC channel
   * @param  pdev: device instance
-  * @param  pbuff: Tx Buffer
-  * @retval status
+  * @param  pbuf: data to send
+  * @param  length: number of bytes to send
+  * @param  timeout: kernel ticks to wait, osWaitForever allowed
+  * @retval status: USBD_BUSY on timeout, pbuf is then still in use until the
+  *         TransmitCplt callback reports it back if the transfer was queued
   */
-uint8_t USBD_CDC_SetTxBuffer(uint8_t ch, USBD_HandleTypeDef *pdev,
-                             uint8_t *pbuff, uint32_t length)
+uint8_t USBD_CDC_Write(uint8_t ch, USBD_HandleTypeDef *pdev, uint8_t *pbuf,
+                       uint32_t length, uint32_t timeout)
 {
-  USBD_CDC_ACM_HandleTypeDef *hcdc = NULL;
+  USBD_CDC_ACM_HandleTypeDef *hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][ch];
+  uint8_t ep_addr = CDC_IN_EP(pdev, ch);
+  USBD_XferTypeDef *xfer = NULL;
+  void *alloc[2];
+  USBD_StatusTypeDef ret;
 
-  hcdc = &CDC_ACM_Class_Data[ch];
+  /* Sleep until a descriptor of the channel queue is free */
+  alloc[0] = hcdc;
+  alloc[1] = NULL;
 
-  hcdc->TxBuffer = pbuff;
-  hcdc->TxLength = length;
+  ret = USBD_OS_Wait(pdev, ep_addr, USBD_CDC_OS_TxAlloc, alloc, &timeout);
 
-  return (uint8_t)USBD_OK;
-}
+  if (ret != USBD_OK)
+  {
+    return (uint8_t)ret;
+  }
 
-/**
-  * @brief  USBD_CDC_SetRxBuffer
-  * @param  pdev: device instance
-  * @param  pbuff: Rx Buffer
-  * @retval status
-  */
-uint8_t USBD_CDC_SetRxBuffer(uint8_t ch, USBD_HandleTypeDef *pdev, uint8_t *pbuff)
-{
-  USBD_CDC_ACM_HandleTypeDef *hcdc = NULL;
+  xfer = (USBD_XferTypeDef *)alloc[1];
+  xfer->ep_addr = ep_addr;
+  xfer->pbuf = pbuf;
+  xfer->length = length;
+  xfer->nseg = 0U;
+  xfer->flags = USBD_XFER_FLAG_ZLP;
+  xfer->Cplt = USBD_CDC_TxCplt;
+  xfer->pOwner = hcdc;
 
-  hcdc = &CDC_ACM_Class_Data[ch];
+  /* Tx Transfer in progress */
+  hcdc->TxState = 1U;
 
-  hcdc->RxBuffer = pbuff;
+  ret = USBD_CDC_TxSubmit(pdev, ch, xfer);
 
-  return (uint8_t)USBD_OK;
+  if (ret != USBD_OK)
+  {
+    return (uint8_t)ret;
+  }
+
+  /* Sleep until the descriptor is retired, pbuf is free again */
+  return (uint8_t)USBD_OS_Wait(pdev, ep_addr, USBD_CDC_OS_TxDone, xfer, &timeout);
 }
 
 /**
-  * @brief  USBD_CDC_TransmitPacket
-  *         Transmit packet on IN endpoint
+  * @brief  USBD_CDC_Read
+  *         Copy received data of a channel, blocking until a packet arrives;
+  *         a pool buffer goes back to the endpoint once it is fully read
+  * @param  ch: CDC channel
   * @param  pdev: device instance
-  * @retval status
+  * @param  pbuf: destination buffer
+  * @param  length: in, size of pbuf; out, number of bytes copied
+  * @param  timeout: kernel ticks to wait, osWaitForever allowed
+  * @retval status: USBD_BUSY on timeout
   */
-uint8_t USBD_CDC_TransmitPacket(uint8_t ch, USBD_HandleTypeDef *pdev)
+uint8_t USBD_CDC_Read(uint8_t ch, USBD_HandleTypeDef *pdev, uint8_t *pbuf,
+                      uint32_t *length, uint32_t timeout)
 {
-  USBD_CDC_ACM_HandleTypeDef *hcdc = NULL;
-  USBD_StatusTypeDef ret = USBD_BUSY;
+  USBD_CDC_ACM_HandleTypeDef *hcdc = &CDC_ACM_Class_Data[USBD_DEV_IDX(pdev)][ch];
+  USBD_StatusTypeDef ret;
+  uint32_t len;
+  uint8_t idx;
 
-  hcdc = &CDC_ACM_Class_Data[ch];
+  ret = USBD_OS_Wait(pdev, CDC_OUT_EP(pdev, ch), USBD_CDC_OS_RxReady, hcdc, &timeout);
 
-  if (hcdc->TxState == 0U)
+  if (ret != USBD_OK)
   {
-    /* Tx Transfer in progress */
-    hcdc->TxState = 1U;
-
-    /* Update the packet total length */
-    pdev->ep_in[CDC_IN_EP[ch] & 0xFU].total_length = hcdc->TxLength;
+    *length = 0U;
+    return (uint8_t)ret;
+  }
 
-    /* Transmit next packet */
-    (void)USBD_LL_Transmit(pdev, CDC_IN_EP[ch], hcdc->TxBuffer, hcdc->TxLength);
+  /* Packets are read in the order they arrived */
+  idx = USBD_CDC_RxOldest(hcdc);
+  len = MIN(*length, hcdc->RxPoolLen[idx] - hcdc->RxOffset);
+  (void)USBD_memcpy(pbuf, &((uint8_t *)CDC_BUF(pdev, ch)->RxPool[idx])[hcdc->RxOffset], len);
+  hcdc->RxOffset += len;
+  *length = len;
 
-    ret = USBD_OK;
+  if (hcdc->RxOffset >= hcdc->RxPoolLen[idx])
+  {
+    hcdc->RxOffset = 0U;
+    (void)USBD_CDC_ReceivePacket(ch, pdev);
   }
 
-  return (uint8_t)ret;
+  return (uint8_t)USBD_OK;
 }
 
 /**
-  * @brief  USBD_CDC_ACM_ReceivePacket
-  *         prepare OUT Endpoint for reception
-  * @param  pdev: device instance
-  * @retval status
+  * @brief  USBD_CDC_OS_TxAlloc
+  *         Wake-up condition of USBD_CDC_Write, reserves a Tx descriptor
+  * @param  arg: channel handle in, reserved descriptor out
+  * @retval 1 once a descriptor is reserved
   */
-uint8_t USBD_CDC_ReceivePacket(uint8_t ch, USBD_HandleTypeDef *pdev)
+static uint8_t USBD_CDC_OS_TxAlloc(void *arg)
 {
-  USBD_CDC_ACM_HandleTypeDef *hcdc = NULL;
+  void **alloc = (void **)arg;
+  USBD_CDC_ACM_HandleTypeDef *hcdc = (USBD_CDC_ACM_HandleTypeDef *)alloc[0];
 
-  hcdc = &CDC_ACM_Class_Data[ch];
+  alloc[1] = USBD_Xfer_Alloc(hcdc->TxXfer, CDC_ACM_TX_QUEUE_DEPTH);
 
-  if (pdev->dev_speed == USBD_SPEED_HIGH)
-  {
-    /* Prepare Out endpoint to receive next packet */
-    (void)USBD_LL_PrepareReceive(pdev, CDC_OUT_EP[ch], hcdc->RxBuffer,
-                                 CDC_DATA_HS_OUT_PACKET_SIZE);
-  }
-  else
-  {
-    /* Prepare Out endpoint to receive next packet */
-    (void)USBD_LL_PrepareReceive(pdev, CDC_OUT_EP[ch], hcdc->RxBuffer,
-                                 CDC_DATA_FS_OUT_PACKET_SIZE);
-  }
+  return (alloc[1] != NULL) ? 1U : 0U;
+}
 
-  return (uint8_t)USBD_OK;
+/**
+  * @brief  USBD_CDC_OS_TxDone
+  *         Wake-up condition of USBD_CDC_Write, the transfer is retired
+  * @param  arg: transfer descriptor
+  * @retval 1 once the descriptor is idle
+  */
+static uint8_t USBD_CDC_OS_TxDone(void *arg)
+{
+  return (((USBD_XferTypeDef *)arg)->state == USBD_XFER_STATE_IDLE) ? 1U : 0U;
+}
+
+/**
+  * @brief  USBD_CDC_OS_RxReady
+  *         Wake-up condition of USBD_CDC_Read, a packet is waiting
+  * @param  arg: channel handle
+  * @retval 1 when a pool buffer holds unread data
+  */
+static uint8_t USBD_CDC_OS_RxReady(void *arg)
+{
+  return (((USBD_CDC_ACM_HandleTypeDef *)arg)->RxHeld != 0U) ? 1U : 0U;
 }
+#endif /* (USBD_USE_OS == 1U) */
 
-void USBD_Update_CDC_ACM_DESC(uint8_t *desc,
+void USBD_Update_CDC_ACM_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc,
                               uint8_t cmd_itf,
                               uint8_t com_itf,
                               uint8_t in_ep,
@@ -2163,35 +1925,44 @@ void USBD_Update_CDC_ACM_DESC(uint8_t *desc,
                               uint8_t out_ep,
                               uint8_t str_idx)
 {
-  desc += 9;
+  USBD_ClassMapTypeDef *pmap;
+
+  UNUSED(com_itf);
+
+  desc += USB_CONF_DESC_SIZE;
   for (uint8_t i = 0; i < NUMBER_OF_CDC; i++)
   {
-    desc[2] = cmd_itf;
-    desc[16] = str_idx;
-    desc[10] = cmd_itf;
-    desc[26] = com_itf;
-    desc[34] = cmd_itf;
-    desc[35] = com_itf;
-    desc[38] = cmd_ep;
-    desc[45] = com_itf;
-    desc[54] = out_ep;
-    desc[61] = in_ep;
-
-    desc += 66;
-    CDC_IN_EP[i] = in_ep;
-    CDC_OUT_EP[i] = out_ep;
-    CDC_CMD_EP[i] = cmd_ep;
-    CDC_CMD_ITF_NBR[i] = cmd_itf;
-    CDC_COM_ITF_NBR[i] = com_itf;
-    CDC_STR_DESC_IDX[i] = str_idx;
-
-    in_ep += 2;
-    cmd_ep = in_ep + 1;
+    pmap = &CDC_ACM_Map[USBD_DEV_IDX(pdev)][i];
+    pmap->in_ep = in_ep;
+    pmap->out_ep = out_ep;
+    pmap->cmd_ep = cmd_ep;
+    pmap->itf_nbr = cmd_itf;
+    pmap->itf_num = 2U;
+    pmap->str_idx = str_idx;
+
+    USBD_CDC_SetPortDesc(desc, pmap);
+    desc += CDC_ACM_PORT_DESC_SIZ;
+
+    /* A channel without notification endpoint uses one IN endpoint */
+    if (cmd_ep != 0U)
+    {
+      in_ep += 2;
+      cmd_ep = in_ep + 1;
+    }
+    else
+    {
+      in_ep++;
+    }
+
+#if (CDC_ACM_SHARED_NOTIFY == 1U)
+    /* Only channel 0 keeps its (silent) notification endpoint */
+    cmd_ep = 0U;
+#endif /* (CDC_ACM_SHARED_NOTIFY == 1U) */
+
     out_ep++;
     str_idx++;
 
     cmd_itf += 2;
-    com_itf = cmd_itf + 1;
   }
 }
 /**
@@ -66,6 +66,11 @@ extern "C"
 #define CDC_RNDIS_DATA_FS_IN_PACKET_SIZE                  CDC_RNDIS_DATA_FS_MAX_PACKET_SIZE
 #define CDC_RNDIS_DATA_FS_OUT_PACKET_SIZE                 CDC_RNDIS_DATA_FS_MAX_PACKET_SIZE
 
+/* Number of IN transfers that may be queued on the data endpoint */
+#ifndef CDC_RNDIS_TX_QUEUE_DEPTH
+#define CDC_RNDIS_TX_QUEUE_DEPTH        2U
+#endif /* CDC_RNDIS_TX_QUEUE_DEPTH */
+
 /*---------------------------------------------------------------------*/
 /*  CDC_RNDIS definitions                                                    */
 /*---------------------------------------------------------------------*/
@@ -231,6 +236,23 @@ extern "C"
     uint8_t data[8];
   } USBD_CDC_RNDIS_NotifTypeDef;
 
+  /* Type define for a CDC_RNDIS packet message, used to encapsulate
+   Ethernet packets sent to and from the adapter */
+  typedef struct
+  {
+    uint32_t MsgType;
+    uint32_t MsgLength;
+    uint32_t DataOffset;
+    uint32_t DataLength;
+    uint32_t OOBDataOffset;
+    uint32_t OOBDataLength;
+    uint32_t NumOOBDataElements;
+    uint32_t PerPacketInfoOffset;
+    uint32_t PerPacketInfoLength;
+    uint32_t VcHandle;
+    uint32_t Reserved;
+  } USBD_CDC_RNDIS_PacketMsgTypeDef;
+
   typedef struct
   {
     uint32_t data[CDC_RNDIS_MAX_DATA_SZE / 4U]; /* Force 32-bit alignment */
@@ -249,6 +271,11 @@ extern "C"
     __IO uint32_t TxState;
     __IO uint32_t RxState;
 
+
+    USBD_XferTypeDef TxXfer[CDC_RNDIS_TX_QUEUE_DEPTH];
+    USBD_CDC_RNDIS_PacketMsgTypeDef TxHeader[CDC_RNDIS_TX_QUEUE_DEPTH]; /* Sent ahead of the frame */
+    USBD_SegmentTypeDef TxSeg[CDC_RNDIS_TX_QUEUE_DEPTH][2];
+
     __IO uint32_t MaxPcktLen;
     __IO uint32_t LinkStatus;
     __IO uint32_t NotificationStatus;
@@ -397,22 +424,7 @@ extern "C"
 
   /* Messages Sent by both Host and Device ---------------------*/
 
-  /* Type define for a CDC_RNDIS packet message, used to encapsulate
-   Ethernet packets sent to and from the adapter */
-  typedef struct
-  {
-    uint32_t MsgType;
-    uint32_t MsgLength;
-    uint32_t DataOffset;
-    uint32_t DataLength;
-    uint32_t OOBDataOffset;
-    uint32_t OOBDataLength;
-    uint32_t NumOOBDataElements;
-    uint32_t PerPacketInfoOffset;
-    uint32_t PerPacketInfoLength;
-    uint32_t VcHandle;
-    uint32_t Reserved;
-  } USBD_CDC_RNDIS_PacketMsgTypeDef;
+  /* USBD_CDC_RNDIS_PacketMsgTypeDef is declared ahead of the class handle */
 
   /* Miscellaneous types used for parsing ---------------------*/
 
@@ -473,13 +485,17 @@ extern "C"
 
   extern USBD_ClassTypeDef USBD_CDC_RNDIS;
 
-  extern uint8_t CDC_RNDIS_IN_EP;
-  extern uint8_t CDC_RNDIS_OUT_EP;
-  extern uint8_t CDC_RNDIS_CMD_EP;
+  /* Instances of the class a device can mount */
+  #ifndef USBD_CDC_RNDIS_MAX_INST
+  #define USBD_CDC_RNDIS_MAX_INST  1U
+  #endif /* USBD_CDC_RNDIS_MAX_INST */
 
-  extern uint8_t CDC_RNDIS_CMD_ITF_NBR;
-  extern uint8_t CDC_RNDIS_COM_ITF_NBR;
-  extern uint8_t CDC_RNDIS_STR_DESC_IDX;
+  #define CDC_RNDIS_IN_EP(pdev)         (USBD_CLASS_MAP(pdev).in_ep)
+  #define CDC_RNDIS_OUT_EP(pdev)        (USBD_CLASS_MAP(pdev).out_ep)
+  #define CDC_RNDIS_CMD_EP(pdev)        (USBD_CLASS_MAP(pdev).cmd_ep)
+  #define CDC_RNDIS_CMD_ITF_NBR(pdev)   (USBD_CLASS_MAP(pdev).itf_nbr)
+  #define CDC_RNDIS_COM_ITF_NBR(pdev)   ((uint8_t)(USBD_CLASS_MAP(pdev).itf_nbr + 1U))
+  #define CDC_RNDIS_STR_DESC_IDX(pdev)  (USBD_CLASS_MAP(pdev).str_idx)
 
   /**
   * @}
@@ -502,7 +518,7 @@ extern "C"
                                           USBD_CDC_RNDIS_NotifCodeTypeDef Notif,
                                           uint16_t bVal, uint8_t *pData);
 
-  void USBD_Update_CDC_RNDIS_DESC(uint8_t *desc,
+  void USBD_Update_CDC_RNDIS_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc,
                                   uint8_t cmd_itf,
                                   uint8_t com_itf,
                                   uint8_t in_ep,
@@ -63,13 +63,6 @@
 #define _CDC_RNDIS_COM_ITF_NBR 0x01U /* Communication Interface Number 0 */
 #define _CDC_RNDIS_STR_DESC_IDX 0x00U
 
-uint8_t CDC_RNDIS_IN_EP = _CDC_RNDIS_IN_EP;
-uint8_t CDC_RNDIS_OUT_EP = _CDC_RNDIS_OUT_EP;
-uint8_t CDC_RNDIS_CMD_EP = _CDC_RNDIS_CMD_EP;
-uint8_t CDC_RNDIS_CMD_ITF_NBR = _CDC_RNDIS_CMD_ITF_NBR;
-uint8_t CDC_RNDIS_COM_ITF_NBR = _CDC_RNDIS_COM_ITF_NBR;
-uint8_t CDC_RNDIS_STR_DESC_IDX = _CDC_RNDIS_STR_DESC_IDX;
-
 /** @addtogroup STM32_USB_DEVICE_LIBRARY
   * @{
   */
@@ -113,17 +106,18 @@ static uint8_t USBD_CDC_RNDIS_Setup(USBD_HandleTypeDef *pdev,
 
 static uint8_t USBD_CDC_RNDIS_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum);
 static uint8_t USBD_CDC_RNDIS_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum);
+static void USBD_CDC_RNDIS_TxCplt(USBD_HandleTypeDef *pdev, USBD_XferTypeDef *xfer);
 static uint8_t USBD_CDC_RNDIS_EP0_RxReady(USBD_HandleTypeDef *pdev);
-static uint8_t *USBD_CDC_RNDIS_GetFSCfgDesc(uint16_t *length);
-static uint8_t *USBD_CDC_RNDIS_GetHSCfgDesc(uint16_t *length);
-static uint8_t *USBD_CDC_RNDIS_GetOtherSpeedCfgDesc(uint16_t *length);
-static uint8_t *USBD_CDC_RNDIS_GetOtherSpeedCfgDesc(uint16_t *length);
+static uint8_t *USBD_CDC_RNDIS_GetFSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_CDC_RNDIS_GetHSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_CDC_RNDIS_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_CDC_RNDIS_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
 
 #if (USBD_SUPPORT_USER_STRING_DESC == 1U)
 static uint8_t *USBD_CDC_RNDIS_USRStringDescriptor(USBD_HandleTypeDef *pdev, uint8_t index, uint16_t *length);
 #endif
 
-uint8_t *USBD_CDC_RNDIS_GetDeviceQualifierDescriptor(uint16_t *length);
+uint8_t *USBD_CDC_RNDIS_GetDeviceQualifierDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length);
 
 /* CDC_RNDIS Internal messages parsing and construction functions */
 static uint8_t USBD_CDC_RNDIS_MsgParsing(USBD_HandleTypeDef *pdev, uint8_t *RxBuff);
@@ -167,7 +161,7 @@ static uint8_t EmptyResponse = 0x00U;
   * @{
   */
 
-static USBD_CDC_RNDIS_HandleTypeDef CDC_RNDIS_Instance;
+static USBD_CDC_RNDIS_HandleTypeDef CDC_RNDIS_Instance[USBD_MAX_NUM_DEV][USBD_CDC_RNDIS_MAX_INST];
 
 /* CDC_RNDIS interface class callbacks structure */
 USBD_ClassTypeDef USBD_CDC_RNDIS =
@@ -559,57 +553,59 @@ static uint8_t USBD_CDC_RNDIS_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   UNUSED(cfgidx);
   USBD_CDC_RNDIS_HandleTypeDef *hcdc;
 
-  hcdc = &CDC_RNDIS_Instance;
+  hcdc = &CDC_RNDIS_Instance[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)];
 
   if (hcdc == NULL)
   {
-    pdev->pClassData_CDC_RNDIS = NULL;
+    USBD_CLASS_DATA(pdev) = NULL;
     return (uint8_t)USBD_EMEM;
   }
 
-  pdev->pClassData_CDC_RNDIS = (void *)hcdc;
+  USBD_CLASS_DATA(pdev) = (void *)hcdc;
 
   if (pdev->dev_speed == USBD_SPEED_HIGH)
   {
     /* Open EP IN */
-    (void)USBD_LL_OpenEP(pdev, CDC_RNDIS_IN_EP, USBD_EP_TYPE_BULK,
+    (void)USBD_LL_OpenEP(pdev, CDC_RNDIS_IN_EP(pdev), USBD_EP_TYPE_BULK,
                          CDC_RNDIS_DATA_HS_IN_PACKET_SIZE);
 
-    pdev->ep_in[CDC_RNDIS_IN_EP & 0xFU].is_used = 1U;
+    pdev->ep_in[CDC_RNDIS_IN_EP(pdev) & 0xFU].is_used = 1U;
+    pdev->ep_in[CDC_RNDIS_IN_EP(pdev) & 0xFU].maxpacket = CDC_RNDIS_DATA_HS_IN_PACKET_SIZE;
 
     /* Open EP OUT */
-    (void)USBD_LL_OpenEP(pdev, CDC_RNDIS_OUT_EP, USBD_EP_TYPE_BULK,
+    (void)USBD_LL_OpenEP(pdev, CDC_RNDIS_OUT_EP(pdev), USBD_EP_TYPE_BULK,
                          CDC_RNDIS_DATA_HS_OUT_PACKET_SIZE);
 
-    pdev->ep_out[CDC_RNDIS_OUT_EP & 0xFU].is_used = 1U;
+    pdev->ep_out[CDC_RNDIS_OUT_EP(pdev) & 0xFU].is_used = 1U;
 
     /* Set bInterval for CDC RNDIS CMD Endpoint */
-    pdev->ep_in[CDC_RNDIS_CMD_EP & 0xFU].bInterval = CDC_RNDIS_HS_BINTERVAL;
+    pdev->ep_in[CDC_RNDIS_CMD_EP(pdev) & 0xFU].bInterval = CDC_RNDIS_HS_BINTERVAL;
   }
   else
   {
     /* Open EP IN */
-    (void)USBD_LL_OpenEP(pdev, CDC_RNDIS_IN_EP, USBD_EP_TYPE_BULK,
+    (void)USBD_LL_OpenEP(pdev, CDC_RNDIS_IN_EP(pdev), USBD_EP_TYPE_BULK,
                          CDC_RNDIS_DATA_FS_IN_PACKET_SIZE);
 
-    pdev->ep_in[CDC_RNDIS_IN_EP & 0xFU].is_used = 1U;
+    pdev->ep_in[CDC_RNDIS_IN_EP(pdev) & 0xFU].is_used = 1U;
+    pdev->ep_in[CDC_RNDIS_IN_EP(pdev) & 0xFU].maxpacket = CDC_RNDIS_DATA_FS_IN_PACKET_SIZE;
 
     /* Open EP OUT */
-    (void)USBD_LL_OpenEP(pdev, CDC_RNDIS_OUT_EP, USBD_EP_TYPE_BULK,
+    (void)USBD_LL_OpenEP(pdev, CDC_RNDIS_OUT_EP(pdev), USBD_EP_TYPE_BULK,
                          CDC_RNDIS_DATA_FS_OUT_PACKET_SIZE);
 
-    pdev->ep_out[CDC_RNDIS_OUT_EP & 0xFU].is_used = 1U;
+    pdev->ep_out[CDC_RNDIS_OUT_EP(pdev) & 0xFU].is_used = 1U;
 
     /* Set bInterval for CDC RNDIS CMD Endpoint */
-    pdev->ep_in[CDC_RNDIS_CMD_EP & 0xFU].bInterval = CDC_RNDIS_FS_BINTERVAL;
+    pdev->ep_in[CDC_RNDIS_CMD_EP(pdev) & 0xFU].bInterval = CDC_RNDIS_FS_BINTERVAL;
   }
 
   /* Open Command IN EP */
-  (void)USBD_LL_OpenEP(pdev, CDC_RNDIS_CMD_EP, USBD_EP_TYPE_INTR, CDC_RNDIS_CMD_PACKET_SIZE);
-  pdev->ep_in[CDC_RNDIS_CMD_EP & 0xFU].is_used = 1U;
+  (void)USBD_LL_OpenEP(pdev, CDC_RNDIS_CMD_EP(pdev), USBD_EP_TYPE_INTR, CDC_RNDIS_CMD_PACKET_SIZE);
+  pdev->ep_in[CDC_RNDIS_CMD_EP(pdev) & 0xFU].is_used = 1U;
 
   /* Init  physical Interface components */
-  ((USBD_CDC_RNDIS_ItfTypeDef *)pdev->pUserData_CDC_RNDIS)->Init();
+  ((USBD_CDC_RNDIS_ItfTypeDef *)USBD_USER_DATA(pdev))->Init();
 
   /* Init the CDC_RNDIS state */
   hcdc->State = CDC_RNDIS_STATE_BUS_INITIALIZED;
@@ -624,7 +620,7 @@ static uint8_t USBD_CDC_RNDIS_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   hcdc->MaxPcktLen = (pdev->dev_speed == USBD_SPEED_HIGH) ? CDC_RNDIS_DATA_HS_MAX_PACKET_SIZE : CDC_RNDIS_DATA_FS_MAX_PACKET_SIZE;
 
   /* Prepare Out endpoint to receive next packet */
-  (void)USBD_LL_PrepareReceive(pdev, CDC_RNDIS_OUT_EP,
+  (void)USBD_LL_PrepareReceive(pdev, CDC_RNDIS_OUT_EP(pdev),
                                hcdc->RxBuffer, hcdc->MaxPcktLen);
 
   return (uint8_t)USBD_OK;
@@ -642,26 +638,27 @@ static uint8_t USBD_CDC_RNDIS_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   UNUSED(cfgidx);
 
   /* Close EP IN */
-  (void)USBD_LL_CloseEP(pdev, CDC_RNDIS_IN_EP);
-  pdev->ep_in[CDC_RNDIS_IN_EP & 0xFU].is_used = 0U;
+  (void)USBD_LL_CloseEP(pdev, CDC_RNDIS_IN_EP(pdev));
+  (void)USBD_Xfer_Flush(pdev, CDC_RNDIS_IN_EP(pdev));
+  pdev->ep_in[CDC_RNDIS_IN_EP(pdev) & 0xFU].is_used = 0U;
 
   /* Close EP OUT */
-  (void)USBD_LL_CloseEP(pdev, CDC_RNDIS_OUT_EP);
-  pdev->ep_out[CDC_RNDIS_OUT_EP & 0xFU].is_used = 0U;
+  (void)USBD_LL_CloseEP(pdev, CDC_RNDIS_OUT_EP(pdev));
+  pdev->ep_out[CDC_RNDIS_OUT_EP(pdev) & 0xFU].is_used = 0U;
 
   /* Close Command IN EP */
-  (void)USBD_LL_CloseEP(pdev, CDC_RNDIS_CMD_EP);
-  pdev->ep_in[CDC_RNDIS_CMD_EP & 0xFU].is_used = 0U;
-  pdev->ep_in[CDC_RNDIS_CMD_EP & 0xFU].bInterval = 0U;
+  (void)USBD_LL_CloseEP(pdev, CDC_RNDIS_CMD_EP(pdev));
+  pdev->ep_in[CDC_RNDIS_CMD_EP(pdev) & 0xFU].is_used = 0U;
+  pdev->ep_in[CDC_RNDIS_CMD_EP(pdev) & 0xFU].bInterval = 0U;
 
   /* DeInit  physical Interface components */
-  if (pdev->pClassData_CDC_RNDIS != NULL)
+  if (USBD_CLASS_DATA(pdev) != NULL)
   {
-    ((USBD_CDC_RNDIS_ItfTypeDef *)pdev->pUserData_CDC_RNDIS)->DeInit();
+    ((USBD_CDC_RNDIS_ItfTypeDef *)USBD_USER_DATA(pdev))->DeInit();
 #if (0)
-    USBD_free(pdev->pClassData_CDC_RNDIS);
+    USBD_free(USBD_CLASS_DATA(pdev));
 #endif
-    pdev->pClassData_CDC_RNDIS = NULL;
+    USBD_CLASS_DATA(pdev) = NULL;
   }
 
   return (uint8_t)USBD_OK;
@@ -677,7 +674,7 @@ static uint8_t USBD_CDC_RNDIS_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
 static uint8_t USBD_CDC_RNDIS_Setup(USBD_HandleTypeDef *pdev,
                                     USBD_SetupReqTypedef *req)
 {
-  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)pdev->pClassData_CDC_RNDIS;
+  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)USBD_CLASS_DATA(pdev);
   USBD_CDC_RNDIS_CtrlMsgTypeDef *Msg = (USBD_CDC_RNDIS_CtrlMsgTypeDef *)(void *)hcdc->data;
   uint8_t ifalt = 0U;
   uint16_t status_info = 0U;
@@ -710,7 +707,7 @@ static uint8_t USBD_CDC_RNDIS_Setup(USBD_HandleTypeDef *pdev,
         }
 
         /* Allow application layer to pre-process data or add own processing before sending response */
-        ((USBD_CDC_RNDIS_ItfTypeDef *)pdev->pUserData_CDC_RNDIS)->Control(req->bRequest, (uint8_t *)hcdc->data, req->wLength);
+        ((USBD_CDC_RNDIS_ItfTypeDef *)USBD_USER_DATA(pdev))->Control(req->bRequest, (uint8_t *)hcdc->data, req->wLength);
         /* Check if Response is ready */
         if (hcdc->ResponseRdy != 0U)
         {
@@ -743,7 +740,7 @@ static uint8_t USBD_CDC_RNDIS_Setup(USBD_HandleTypeDef *pdev,
       so let application layer manage this case */
     else
     {
-      ((USBD_CDC_RNDIS_ItfTypeDef *)pdev->pUserData_CDC_RNDIS)->Control(req->bRequest, (uint8_t *)req, 0U);
+      ((USBD_CDC_RNDIS_ItfTypeDef *)USBD_USER_DATA(pdev))->Control(req->bRequest, (uint8_t *)req, 0U);
     }
     break;
 
@@ -811,37 +808,16 @@ static uint8_t USBD_CDC_RNDIS_Setup(USBD_HandleTypeDef *pdev,
 static uint8_t USBD_CDC_RNDIS_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
 {
   USBD_CDC_RNDIS_HandleTypeDef *hcdc;
-  PCD_HandleTypeDef *hpcd = pdev->pData;
 
-  if (pdev->pClassData_CDC_RNDIS == NULL)
+  if (USBD_CLASS_DATA(pdev) == NULL)
   {
     return (uint8_t)USBD_FAIL;
   }
 
-  hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)pdev->pClassData_CDC_RNDIS;
+  hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
-  if (epnum == (CDC_RNDIS_IN_EP & 0x7FU))
-  {
-    if ((pdev->ep_in[epnum & 0xFU].total_length > 0U) &&
-        ((pdev->ep_in[epnum & 0xFU].total_length % hpcd->IN_ep[epnum & 0xFU].maxpacket) == 0U))
-    {
-      /* Update the packet total length */
-      pdev->ep_in[epnum & 0xFU].total_length = 0U;
-
-      /* Send ZLP */
-      (void)USBD_LL_Transmit(pdev, epnum, NULL, 0U);
-    }
-    else
-    {
-      hcdc->TxState = 0U;
-
-      if (((USBD_CDC_RNDIS_ItfTypeDef *)pdev->pUserData_CDC_RNDIS)->TransmitCplt != NULL)
-      {
-        ((USBD_CDC_RNDIS_ItfTypeDef *)pdev->pUserData_CDC_RNDIS)->TransmitCplt(hcdc->TxBuffer, &hcdc->TxLength, epnum);
-      }
-    }
-  }
-  else if (epnum == (CDC_RNDIS_CMD_EP & 0x7FU))
+  /* The data IN endpoint completes through its transfer queue */
+  if (epnum == (CDC_RNDIS_CMD_EP(pdev) & 0x7FU))
   {
     if (hcdc->NotificationStatus != 0U)
     {
@@ -859,6 +835,30 @@ static uint8_t USBD_CDC_RNDIS_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
   return (uint8_t)USBD_OK;
 }
 
+/**
+  * @brief  USBD_CDC_RNDIS_TxCplt
+  *         Transfer queue completion of a data IN transfer
+  * @param  pdev: device instance
+  * @param  xfer: completed transfer descriptor
+  * @retval None
+  */
+static void USBD_CDC_RNDIS_TxCplt(USBD_HandleTypeDef *pdev, USBD_XferTypeDef *xfer)
+{
+  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)xfer->pOwner;
+  USBD_SegmentTypeDef *pframe = &xfer->pSeg[1];
+
+  if (USBD_Xfer_IsIdle(pdev, xfer->ep_addr) != 0U)
+  {
+    hcdc->TxState = 0U;
+  }
+
+  /* Report the Ethernet frame only, the packet header belongs to the class */
+  if (((USBD_CDC_RNDIS_ItfTypeDef *)USBD_USER_DATA(pdev))->TransmitCplt != NULL)
+  {
+    ((USBD_CDC_RNDIS_ItfTypeDef *)USBD_USER_DATA(pdev))->TransmitCplt(pframe->pbuf, &pframe->length, xfer->ep_addr & 0x7FU);
+  }
+}
+
 /**
   * @brief  USBD_CDC_RNDIS_DataOut
   *         Data received on non-control Out endpoint
@@ -871,14 +871,14 @@ static uint8_t USBD_CDC_RNDIS_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
   USBD_CDC_RNDIS_HandleTypeDef *hcdc;
   uint32_t CurrPcktLen;
 
-  if (pdev->pClassData_CDC_RNDIS == NULL)
+  if (USBD_CLASS_DATA(pdev) == NULL)
   {
     return (uint8_t)USBD_FAIL;
   }
 
-  hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)pdev->pClassData_CDC_RNDIS;
+  hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
-  if (epnum == CDC_RNDIS_OUT_EP)
+  if (epnum == CDC_RNDIS_OUT_EP(pdev))
   {
     /* Get the received data length */
     CurrPcktLen = USBD_LL_GetRxDataSize(pdev, epnum);
@@ -899,7 +899,7 @@ static uint8_t USBD_CDC_RNDIS_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
     else
     {
       /* Prepare Out endpoint to receive next packet in current/new frame */
-      (void)USBD_LL_PrepareReceive(pdev, CDC_RNDIS_OUT_EP,
+      (void)USBD_LL_PrepareReceive(pdev, CDC_RNDIS_OUT_EP(pdev),
                                    (uint8_t *)(hcdc->RxBuffer + hcdc->RxLength),
                                    hcdc->MaxPcktLen);
     }
@@ -920,14 +920,14 @@ static uint8_t USBD_CDC_RNDIS_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
   */
 static uint8_t USBD_CDC_RNDIS_EP0_RxReady(USBD_HandleTypeDef *pdev)
 {
-  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)pdev->pClassData_CDC_RNDIS;
+  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hcdc == NULL)
   {
     return (uint8_t)USBD_FAIL;
   }
 
-  if ((pdev->pUserData_CDC_RNDIS != NULL) && (hcdc->CmdOpCode != 0xFFU))
+  if ((USBD_USER_DATA(pdev) != NULL) && (hcdc->CmdOpCode != 0xFFU))
   {
     /* Check if the received command is SendEncapsulated command */
     if (hcdc->CmdOpCode == CDC_RNDIS_SEND_ENCAPSULATED_COMMAND)
@@ -955,11 +955,14 @@ static uint8_t USBD_CDC_RNDIS_EP0_RxReady(USBD_HandleTypeDef *pdev)
   * @brief  USBD_CDC_RNDIS_GetFSCfgDesc
   *         Return configuration descriptor
   * @param  speed : current device speed
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_CDC_RNDIS_GetFSCfgDesc(uint16_t *length)
+static uint8_t *USBD_CDC_RNDIS_GetFSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)(sizeof(USBD_CDC_RNDIS_CfgFSDesc));
 
   return USBD_CDC_RNDIS_CfgFSDesc;
@@ -969,11 +972,14 @@ static uint8_t *USBD_CDC_RNDIS_GetFSCfgDesc(uint16_t *length)
   * @brief  USBD_CDC_RNDIS_GetHSCfgDesc
   *         Return configuration descriptor
   * @param  speed : current device speed
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_CDC_RNDIS_GetHSCfgDesc(uint16_t *length)
+static uint8_t *USBD_CDC_RNDIS_GetHSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)(sizeof(USBD_CDC_RNDIS_CfgHSDesc));
 
   return USBD_CDC_RNDIS_CfgHSDesc;
@@ -983,11 +989,14 @@ static uint8_t *USBD_CDC_RNDIS_GetHSCfgDesc(uint16_t *length)
   * @brief  USBD_CDC_RNDIS_GetOtherSpeedCfgDesc
   *         Return configuration descriptor
   * @param  speed : current device speed
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_CDC_RNDIS_GetOtherSpeedCfgDesc(uint16_t *length)
+static uint8_t *USBD_CDC_RNDIS_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)(sizeof(USBD_CDC_RNDIS_OtherSpeedCfgDesc));
 
   return USBD_CDC_RNDIS_OtherSpeedCfgDesc;
@@ -996,11 +1005,14 @@ static uint8_t *USBD_CDC_RNDIS_GetOtherSpeedCfgDesc(uint16_t *length)
 /**
   * @brief  DeviceQualifierDescriptor
   *         return Device Qualifier descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-uint8_t *USBD_CDC_RNDIS_GetDeviceQualifierDescriptor(uint16_t *length)
+uint8_t *USBD_CDC_RNDIS_GetDeviceQualifierDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)(sizeof(USBD_CDC_RNDIS_DeviceQualifierDesc));
 
   return USBD_CDC_RNDIS_DeviceQualifierDesc;
@@ -1015,12 +1027,17 @@ uint8_t *USBD_CDC_RNDIS_GetDeviceQualifierDescriptor(uint16_t *length)
 uint8_t USBD_CDC_RNDIS_RegisterInterface(USBD_HandleTypeDef *pdev,
                                          USBD_CDC_RNDIS_ItfTypeDef *fops)
 {
+  if (USBD_CoreFindClass(pdev, &USBD_CDC_RNDIS) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
   if (fops == NULL)
   {
     return (uint8_t)USBD_FAIL;
   }
 
-  pdev->pUserData_CDC_RNDIS = fops;
+  USBD_USER_DATA(pdev) = fops;
 
   return (uint8_t)USBD_OK;
 }
@@ -1041,7 +1058,7 @@ static uint8_t *USBD_CDC_RNDIS_USRStringDescriptor(USBD_HandleTypeDef *pdev, uin
   /* Check if the requested string interface is supported */
   if (index == CDC_RNDIS_MAC_STRING_INDEX)
   {
-    USBD_GetString((uint8_t *)((USBD_CDC_RNDIS_ItfTypeDef *)pdev->pUserData_CDC_RNDIS)->pStrDesc, USBD_StrDesc, length);
+    USBD_GetString((uint8_t *)((USBD_CDC_RNDIS_ItfTypeDef *)USBD_USER_DATA(pdev))->pStrDesc, USBD_StrDesc, length);
     return USBD_StrDesc;
   }
   /* Not supported Interface Descriptor index */
@@ -1055,12 +1072,20 @@ static uint8_t *USBD_CDC_RNDIS_USRStringDescriptor(USBD_HandleTypeDef *pdev, uin
 /**
   * @brief  USBD_CDC_RNDIS_SetTxBuffer
   * @param  pdev: device instance
-  * @param  pbuff: Tx Buffer
+  * @param  pbuff: Tx Buffer, Ethernet frame without RNDIS packet header
+  * @param  length: Ethernet frame length
   * @retval status
   */
 uint8_t USBD_CDC_RNDIS_SetTxBuffer(USBD_HandleTypeDef *pdev, uint8_t *pbuff, uint32_t length)
 {
-  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)pdev->pClassData_CDC_RNDIS;
+  USBD_CDC_RNDIS_HandleTypeDef *hcdc;
+
+  if (USBD_CoreFindClass(pdev, &USBD_CDC_RNDIS) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hcdc == NULL)
   {
@@ -1081,7 +1106,14 @@ uint8_t USBD_CDC_RNDIS_SetTxBuffer(USBD_HandleTypeDef *pdev, uint8_t *pbuff, uin
   */
 uint8_t USBD_CDC_RNDIS_SetRxBuffer(USBD_HandleTypeDef *pdev, uint8_t *pbuff)
 {
-  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)pdev->pClassData_CDC_RNDIS;
+  USBD_CDC_RNDIS_HandleTypeDef *hcdc;
+
+  if (USBD_CoreFindClass(pdev, &USBD_CDC_RNDIS) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hcdc == NULL)
   {
@@ -1095,49 +1127,79 @@ uint8_t USBD_CDC_RNDIS_SetRxBuffer(USBD_HandleTypeDef *pdev, uint8_t *pbuff)
 
 /**
   * @brief  USBD_CDC_RNDIS_TransmitPacket
-  *         Transmit packet on IN endpoint
+  *         Queue the current Tx buffer on the IN endpoint. The Tx buffer holds
+  *         the Ethernet frame only: the REMOTE_NDIS_PACKET_MSG header is built
+  *         in the class handle and gathered in front of it by the LL driver
   * @param  pdev: device instance
-  * @retval status
+  * @retval status: USBD_BUSY when CDC_RNDIS_TX_QUEUE_DEPTH transfers are pending
   */
 uint8_t USBD_CDC_RNDIS_TransmitPacket(USBD_HandleTypeDef *pdev)
 {
   USBD_CDC_RNDIS_HandleTypeDef *hcdc;
   USBD_CDC_RNDIS_PacketMsgTypeDef *PacketMsg;
-  USBD_StatusTypeDef ret = USBD_BUSY;
+  USBD_SegmentTypeDef *pseg;
+  USBD_XferTypeDef *xfer;
+  USBD_StatusTypeDef ret;
+  uint32_t idx;
 
-  if (pdev->pClassData_CDC_RNDIS == NULL)
+  if (USBD_CoreFindClass(pdev, &USBD_CDC_RNDIS) != USBD_OK)
   {
     return (uint8_t)USBD_FAIL;
   }
 
-  hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)pdev->pClassData_CDC_RNDIS;
-  PacketMsg = (USBD_CDC_RNDIS_PacketMsgTypeDef *)(void *)hcdc->TxBuffer;
+  if (USBD_CLASS_DATA(pdev) == NULL)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)USBD_CLASS_DATA(pdev);
+
+  xfer = USBD_Xfer_Alloc(hcdc->TxXfer, CDC_RNDIS_TX_QUEUE_DEPTH);
+
+  if (xfer == NULL)
+  {
+    return (uint8_t)USBD_BUSY;
+  }
 
-  if (hcdc->TxState == 0U)
+  idx = (uint32_t)(xfer - hcdc->TxXfer);
+  PacketMsg = &hcdc->TxHeader[idx];
+  pseg = hcdc->TxSeg[idx];
+
+  /* Format the packet information */
+  PacketMsg->MsgType = CDC_RNDIS_PACKET_MSG_ID;
+  PacketMsg->MsgLength = sizeof(USBD_CDC_RNDIS_PacketMsgTypeDef) + hcdc->TxLength;
+  PacketMsg->DataOffset = sizeof(USBD_CDC_RNDIS_PacketMsgTypeDef) - CDC_RNDIS_PCKTMSG_DATAOFFSET_OFFSET;
+  PacketMsg->DataLength = hcdc->TxLength;
+  PacketMsg->OOBDataOffset = 0U;
+  PacketMsg->OOBDataLength = 0U;
+  PacketMsg->NumOOBDataElements = 0U;
+  PacketMsg->PerPacketInfoOffset = 0U;
+  PacketMsg->PerPacketInfoLength = 0U;
+  PacketMsg->VcHandle = 0U;
+  PacketMsg->Reserved = 0U;
+
+  pseg[0].pbuf = (uint8_t *)PacketMsg;
+  pseg[0].length = sizeof(USBD_CDC_RNDIS_PacketMsgTypeDef);
+  pseg[1].pbuf = hcdc->TxBuffer;
+  pseg[1].length = hcdc->TxLength;
+
+  xfer->ep_addr = CDC_RNDIS_IN_EP(pdev);
+  xfer->pbuf = hcdc->TxBuffer;
+  xfer->pSeg = pseg;
+  xfer->nseg = 2U;
+  xfer->flags = USBD_XFER_FLAG_ZLP;
+  xfer->Cplt = USBD_CDC_RNDIS_TxCplt;
+  xfer->pOwner = hcdc;
+
+  /* Tx Transfer in progress */
+  hcdc->TxState = 1U;
+
+  ret = USBD_Xfer_Submit(pdev, xfer);
+
+  /* Not started, nothing else is on the endpoint */
+  if ((ret != USBD_OK) && (USBD_Xfer_IsIdle(pdev, xfer->ep_addr) != 0U))
   {
-    /* Tx Transfer in progress */
-    hcdc->TxState = 1U;
-
-    /* Format the packet information */
-    PacketMsg->MsgType = CDC_RNDIS_PACKET_MSG_ID;
-    PacketMsg->MsgLength = hcdc->TxLength;
-    PacketMsg->DataOffset = sizeof(USBD_CDC_RNDIS_PacketMsgTypeDef) - CDC_RNDIS_PCKTMSG_DATAOFFSET_OFFSET;
-    PacketMsg->DataLength = hcdc->TxLength - sizeof(USBD_CDC_RNDIS_PacketMsgTypeDef);
-    PacketMsg->OOBDataOffset = 0U;
-    PacketMsg->OOBDataLength = 0U;
-    PacketMsg->NumOOBDataElements = 0U;
-    PacketMsg->PerPacketInfoOffset = 0U;
-    PacketMsg->PerPacketInfoLength = 0U;
-    PacketMsg->VcHandle = 0U;
-    PacketMsg->Reserved = 0U;
-
-    /* Update the packet total length */
-    pdev->ep_in[CDC_RNDIS_IN_EP & 0xFU].total_length = hcdc->TxLength;
-
-    /* Transmit next packet */
-    (void)USBD_LL_Transmit(pdev, CDC_RNDIS_IN_EP, hcdc->TxBuffer, hcdc->TxLength);
-
-    ret = USBD_OK;
+    hcdc->TxState = 0U;
   }
 
   return (uint8_t)ret;
@@ -1153,15 +1215,20 @@ uint8_t USBD_CDC_RNDIS_ReceivePacket(USBD_HandleTypeDef *pdev)
 {
   USBD_CDC_RNDIS_HandleTypeDef *hcdc;
 
-  if (pdev->pClassData_CDC_RNDIS == NULL)
+  if (USBD_CoreFindClass(pdev, &USBD_CDC_RNDIS) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  if (USBD_CLASS_DATA(pdev) == NULL)
   {
     return (uint8_t)USBD_FAIL;
   }
 
-  hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)pdev->pClassData_CDC_RNDIS;
+  hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   /* Prepare Out endpoint to receive next packet */
-  (void)USBD_LL_PrepareReceive(pdev, CDC_RNDIS_OUT_EP,
+  (void)USBD_LL_PrepareReceive(pdev, CDC_RNDIS_OUT_EP(pdev),
                                hcdc->RxBuffer, hcdc->MaxPcktLen);
 
   return (uint8_t)USBD_OK;
@@ -1182,9 +1249,16 @@ uint8_t USBD_CDC_RNDIS_SendNotification(USBD_HandleTypeDef *pdev,
 {
   uint32_t Idx;
   uint16_t ReqSize = 0U;
-  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)pdev->pClassData_CDC_RNDIS;
+  USBD_CDC_RNDIS_HandleTypeDef *hcdc;
   USBD_StatusTypeDef ret = USBD_OK;
 
+  if (USBD_CoreFindClass(pdev, &USBD_CDC_RNDIS) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)USBD_CLASS_DATA(pdev);
+
   UNUSED(bVal);
   UNUSED(pData);
 
@@ -1201,7 +1275,7 @@ uint8_t USBD_CDC_RNDIS_SendNotification(USBD_HandleTypeDef *pdev,
   {
   case RNDIS_RESPONSE_AVAILABLE:
     (hcdc->Req).wValue = 0U;
-    (hcdc->Req).wIndex = CDC_RNDIS_CMD_ITF_NBR;
+    (hcdc->Req).wIndex = CDC_RNDIS_CMD_ITF_NBR(pdev);
     (hcdc->Req).wLength = 0U;
 
     for (Idx = 0U; Idx < 8U; Idx++)
@@ -1220,7 +1294,7 @@ uint8_t USBD_CDC_RNDIS_SendNotification(USBD_HandleTypeDef *pdev,
   /* Transmit notification packet */
   if (ReqSize != 0U)
   {
-    (void)USBD_LL_Transmit(pdev, CDC_RNDIS_CMD_EP, (uint8_t *)&(hcdc->Req), ReqSize);
+    (void)USBD_LL_Transmit(pdev, CDC_RNDIS_CMD_EP(pdev), (uint8_t *)&(hcdc->Req), ReqSize);
   }
 
   return (uint8_t)ret;
@@ -1292,7 +1366,7 @@ static uint8_t USBD_CDC_RNDIS_ProcessInitMsg(USBD_HandleTypeDef *pdev,
                                              USBD_CDC_RNDIS_InitMsgTypeDef *Msg)
 {
   /* Get the CDC_RNDIS handle pointer */
-  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)pdev->pClassData_CDC_RNDIS;
+  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   /* Get and format the Msg input */
   USBD_CDC_RNDIS_InitMsgTypeDef *InitMessage = (USBD_CDC_RNDIS_InitMsgTypeDef *)Msg;
@@ -1356,7 +1430,7 @@ static uint8_t USBD_CDC_RNDIS_ProcessHaltMsg(USBD_HandleTypeDef *pdev,
                                              USBD_CDC_RNDIS_HaltMsgTypeDef *Msg)
 {
   /* Get the CDC_RNDIS handle pointer */
-  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)pdev->pClassData_CDC_RNDIS;
+  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hcdc == NULL)
   {
@@ -1384,7 +1458,7 @@ static uint8_t USBD_CDC_RNDIS_ProcessKeepAliveMsg(USBD_HandleTypeDef *pdev,
                                                   USBD_CDC_RNDIS_KpAliveMsgTypeDef *Msg)
 {
   /* Get the CDC_RNDIS handle pointer */
-  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)pdev->pClassData_CDC_RNDIS;
+  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   /* Use same Msg input buffer as response buffer */
   USBD_CDC_RNDIS_KpAliveCpltMsgTypeDef *InitResponse = (USBD_CDC_RNDIS_KpAliveCpltMsgTypeDef *)(void *)Msg;
@@ -1433,7 +1507,7 @@ static uint8_t USBD_CDC_RNDIS_ProcessQueryMsg(USBD_HandleTypeDef *pdev,
                                               USBD_CDC_RNDIS_QueryMsgTypeDef *Msg)
 {
   /* Get the CDC_RNDIS handle pointer */
-  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)pdev->pClassData_CDC_RNDIS;
+  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   /* Use same Msg input buffer as response buffer */
   USBD_CDC_RNDIS_QueryCpltMsgTypeDef *QueryResponse = (USBD_CDC_RNDIS_QueryCpltMsgTypeDef *)(void *)Msg;
@@ -1577,7 +1651,7 @@ static uint8_t USBD_CDC_RNDIS_ProcessSetMsg(USBD_HandleTypeDef *pdev,
                                             USBD_CDC_RNDIS_SetMsgTypeDef *Msg)
 {
   /* Get the CDC_RNDIS handle pointer */
-  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)pdev->pClassData_CDC_RNDIS;
+  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   /* Get and format the Msg input */
   USBD_CDC_RNDIS_SetMsgTypeDef *SetMessage = (USBD_CDC_RNDIS_SetMsgTypeDef *)Msg;
@@ -1639,7 +1713,7 @@ static uint8_t USBD_CDC_RNDIS_ProcessResetMsg(USBD_HandleTypeDef *pdev,
   /* Get and format the Msg input */
   USBD_CDC_RNDIS_ResetMsgTypeDef *ResetMessage = (USBD_CDC_RNDIS_ResetMsgTypeDef *)Msg;
   /* Get the CDC_RNDIS handle pointer */
-  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)pdev->pClassData_CDC_RNDIS;
+  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)USBD_CLASS_DATA(pdev);
   /* Use same Msg input buffer as response buffer */
   USBD_CDC_RNDIS_ResetCpltMsgTypeDef *ResetResponse = (USBD_CDC_RNDIS_ResetCpltMsgTypeDef *)(void *)Msg;
 
@@ -1689,7 +1763,7 @@ static uint8_t USBD_CDC_RNDIS_ProcessPacketMsg(USBD_HandleTypeDef *pdev,
   uint32_t tmp1, tmp2;
 
   /* Get the CDC_RNDIS handle pointer */
-  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)pdev->pClassData_CDC_RNDIS;
+  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   /* Get and format the Msg input */
   USBD_CDC_RNDIS_PacketMsgTypeDef *PacketMsg = (USBD_CDC_RNDIS_PacketMsgTypeDef *)Msg;
@@ -1714,7 +1788,7 @@ static uint8_t USBD_CDC_RNDIS_ProcessPacketMsg(USBD_HandleTypeDef *pdev,
   hcdc->RxLength = PacketMsg->DataLength;
 
   /* Process data by application */
-  ((USBD_CDC_RNDIS_ItfTypeDef *)pdev->pUserData_CDC_RNDIS)->Receive(hcdc->RxBuffer, &hcdc->RxLength);
+  ((USBD_CDC_RNDIS_ItfTypeDef *)USBD_USER_DATA(pdev))->Receive(hcdc->RxBuffer, &hcdc->RxLength);
 
   return (uint8_t)USBD_OK;
 }
@@ -1730,7 +1804,7 @@ static uint8_t USBD_CDC_RNDIS_ProcessUnsupportedMsg(USBD_HandleTypeDef *pdev,
                                                     USBD_CDC_RNDIS_CtrlMsgTypeDef *Msg)
 {
   /* Get the CDC_RNDIS handle pointer */
-  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)pdev->pClassData_CDC_RNDIS;
+  USBD_CDC_RNDIS_HandleTypeDef *hcdc = (USBD_CDC_RNDIS_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   /* Use same Msg input buffer as response buffer */
   USBD_CDC_RNDIS_StsChangeMsgTypeDef *Response = (USBD_CDC_RNDIS_StsChangeMsgTypeDef *)(void *)Msg;
@@ -1758,7 +1832,7 @@ static uint8_t USBD_CDC_RNDIS_ProcessUnsupportedMsg(USBD_HandleTypeDef *pdev,
   return (uint8_t)USBD_OK;
 }
 
-void USBD_Update_CDC_RNDIS_DESC(uint8_t *desc,
+void USBD_Update_CDC_RNDIS_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc,
                                 uint8_t cmd_itf,
                                 uint8_t com_itf,
                                 uint8_t in_ep,
@@ -1777,12 +1851,12 @@ void USBD_Update_CDC_RNDIS_DESC(uint8_t *desc,
   desc[63] = out_ep;
   desc[70] = in_ep;
 
-  CDC_RNDIS_IN_EP = in_ep;
-  CDC_RNDIS_OUT_EP = out_ep;
-  CDC_RNDIS_CMD_EP = cmd_ep;
-  CDC_RNDIS_CMD_ITF_NBR = cmd_itf;
-  CDC_RNDIS_COM_ITF_NBR = com_itf;
-  CDC_RNDIS_STR_DESC_IDX = str_idx;
+  USBD_CLASS_MAP(pdev).in_ep = in_ep;
+  USBD_CLASS_MAP(pdev).out_ep = out_ep;
+  USBD_CLASS_MAP(pdev).cmd_ep = cmd_ep;
+  USBD_CLASS_MAP(pdev).itf_nbr = cmd_itf;
+  USBD_CLASS_MAP(pdev).itf_num = 2U;
+  USBD_CLASS_MAP(pdev).str_idx = str_idx;
 }
 
 /**
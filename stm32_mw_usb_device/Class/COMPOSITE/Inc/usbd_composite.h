@@ -107,6 +107,24 @@ extern "C" {
   * @{
   */
 
+/* Worst case periodic bandwidth of the configuration, in bytes per frame at
+   full speed and per microframe at high speed */
+typedef struct
+{
+  uint32_t fs_load;
+  uint32_t fs_limit;
+  uint32_t hs_load;
+  uint32_t hs_limit;
+} USBD_COMPOSITE_PeriodicTypeDef;
+
+/* Timing of the last personality switch, in microseconds from its start */
+typedef struct
+{
+  uint32_t detach_us;   /* device detached, old instances released */
+  uint32_t rebuild_us;  /* descriptors, endpoint maps and FIFO memory rebuilt */
+  uint32_t total_us;    /* device attached again, the host enumerates from here */
+} USBD_COMPOSITE_SwitchTypeDef;
+
 /**
   * @}
   */
@@ -133,7 +151,13 @@ extern USBD_ClassTypeDef USBD_COMPOSITE;
 /** @defgroup USB_CORE_Exported_Functions
   * @{
   */
-void USBD_COMPOSITE_Mount_Class(void);
+USBD_StatusTypeDef USBD_COMPOSITE_AddClass(USBD_HandleTypeDef *pdev, USBD_ClassTypeDef *pclass);
+void USBD_COMPOSITE_Mount_Class(USBD_HandleTypeDef *pdev, uint8_t id);
+USBD_StatusTypeDef USBD_COMPOSITE_SetConfigs(USBD_HandleTypeDef *pdev, uint8_t cfg_mask);
+USBD_StatusTypeDef USBD_COMPOSITE_SetDedicated(USBD_HandleTypeDef *pdev);
+const USBD_COMPOSITE_PeriodicTypeDef *USBD_COMPOSITE_GetPeriodic(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
+USBD_StatusTypeDef USBD_COMPOSITE_SetPersonality(USBD_HandleTypeDef *pdev, uint32_t class_mask);
+const USBD_COMPOSITE_SwitchTypeDef *USBD_COMPOSITE_GetSwitch(USBD_HandleTypeDef *pdev);
 /**
   * @}
   */
@@ -51,6 +51,77 @@
 /** @defgroup USBD_COMPOSITE_Private_TypesDefinitions
   * @{
   */
+
+/* Composite view of a class driver: how many instances a device can mount,
+   how many interface strings an instance uses and how its descriptor
+   template is patched with the interfaces, endpoints and strings given by
+   the composite */
+typedef struct
+{
+  USBD_ClassTypeDef *pClass;
+  uint8_t max_inst;
+  uint8_t str_num;
+  const char *str_desc;
+  void (*Update)(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                 uint8_t in_ep, uint8_t out_ep, uint8_t str_idx);
+} USBD_COMPOSITE_DriverTypeDef;
+
+/* Configuration with one instance of each enabled class, sets the default
+   size of the configuration descriptor buffers */
+typedef struct USBD_COMPOSITE_CFG_DESC_t
+{
+  uint8_t CONFIG_DESC[USB_CONF_DESC_SIZE];
+#if (USBD_USE_CDC_RNDIS == 1)
+  uint8_t USBD_CDC_RNDIS_DESC[CDC_RNDIS_CONFIG_DESC_SIZE - 0x09];
+#endif
+#if (USBD_USE_CDC_ECM == 1)
+  uint8_t USBD_CDC_ECM_DESC[CDC_ECM_CONFIG_DESC_SIZE - 0x09];
+#endif
+#if (USBD_USE_HID_MOUSE == 1)
+  uint8_t USBD_HID_MOUSE_DESC[USB_HID_CONFIG_DESC_SIZ - 0x09];
+#endif
+#if (USBD_USE_HID_KEYBOARD == 1)
+  uint8_t USBD_HID_KEYBOARD_DESC[HID_KEYBOARD_CONFIG_DESC_SIZE - 0x09];
+#endif
+#if (USBD_USE_HID_CUSTOM == 1)
+  uint8_t USBD_HID_CUSTOM_DESC[USB_CUSTOM_HID_CONFIG_DESC_SIZ - 0x09];
+#endif
+#if (USBD_USE_UAC_MIC == 1)
+  uint8_t USBD_UAC_MIC_DESC[USBD_AUDIO_MIC_CONFIG_DESC_SIZE - 0x09];
+#endif
+#if (USBD_USE_UAC_SPKR == 1)
+  uint8_t USBD_AUDIO_SPKR_DESC[USBD_AUDIO_SPKR_CONFIG_DESC_SIZE - 0x09];
+#endif
+#if (USBD_USE_UVC == 1)
+  uint8_t USBD_UVC_DESC[UVC_CONFIG_DESC_SIZE - 0x09];
+#endif
+#if (USBD_USE_MSC == 1)
+  uint8_t USBD_MSC_DESC[USB_MSC_CONFIG_DESC_SIZ - 0x09];
+#endif
+#if (USBD_USE_DFU == 1)
+  uint8_t USBD_DFU_DESC[USB_DFU_CONFIG_DESC_SIZ - 0x09];
+#endif
+#if (USBD_USE_PRNTR == 1)
+  uint8_t USBD_PRNTR_DESC[USB_PRNT_CONFIG_DESC_SIZE - 0x09];
+#endif
+#if (USBD_USE_CDC_ACM == 1)
+  uint8_t USBD_CDC_ACM_DESC[USB_CDC_CONFIG_DESC_SIZ - 0x09];
+#endif
+
+} __PACKED USBD_COMPOSITE_CFG_DESC_t;
+
+/* Choices made for one configuration of a device when it was built */
+typedef struct
+{
+  uint16_t fs_len;
+  uint16_t hs_len;
+  uint8_t reduce;
+#if (USBD_USE_UVC == 1)
+  uint16_t uvc_fs_mps;
+  uint16_t uvc_hs_mps;
+#endif
+} USBD_COMPOSITE_ConfigTypeDef;
+
 /**
   * @}
   */
@@ -59,6 +130,51 @@
   * @{
   */
 
+/* Size of the configuration descriptor buffers, to be raised when several
+   instances of a class are mounted */
+#ifndef USBD_COMPOSITE_CFG_DESC_SIZE
+#define USBD_COMPOSITE_CFG_DESC_SIZE      sizeof(USBD_COMPOSITE_CFG_DESC_t)
+#endif /* USBD_COMPOSITE_CFG_DESC_SIZE */
+
+#define USBD_COMPOSITE_NO_CLASS           0xFFU
+
+/* Configurations an instance belongs to unless told otherwise */
+#define USBD_COMPOSITE_ALL_CFG            ((uint8_t)((1U << USBD_MAX_NUM_CONFIGURATION) - 1U))
+
+#if (USBD_MAX_NUM_CONFIGURATION > 8U)
+#error "The composite supports up to 8 configurations"
+#endif
+
+#if (USBD_MAX_CLASS_NUM > 32U)
+#error "The composite personality mask covers up to 32 class instances"
+#endif
+
+/* Time the device stays detached on a personality switch, long enough for
+   the hub to latch the disconnect */
+#ifndef USBD_COMPOSITE_DETACH_MS
+#define USBD_COMPOSITE_DETACH_MS          20U
+#endif /* USBD_COMPOSITE_DETACH_MS */
+
+/* A personality switch longer than this is reported */
+#define USBD_COMPOSITE_SWITCH_BUDGET_US   100000U
+
+/* Endpoint reductions of the planner, applied in the order of
+   USBD_COMPOSITE_ReduceOrder until the endpoints of the configuration fit in
+   USBD_MAX_EP_NUM */
+#define USBD_COMPOSITE_REDUCE_NONE        0x00U
+#define USBD_COMPOSITE_REDUCE_CDC_NOTIFY  0x01U  /* CDC ACM notification endpoints */
+#define USBD_COMPOSITE_REDUCE_HID_OUT     0x02U  /* HID custom OUT endpoint, SET_REPORT on EP0 */
+
+/* Share of a (micro)frame the host gives to the periodic endpoints */
+#define USBD_COMPOSITE_FS_PERIODIC_LIMIT  1350U  /* 90% of 1500 bytes per frame */
+#define USBD_COMPOSITE_HS_PERIODIC_LIMIT  6000U  /* 80% of 7500 bytes per microframe */
+
+/* Protocol overhead of one periodic transaction, USB 2.0 section 5.11.3 */
+#define USBD_COMPOSITE_FS_ISOC_OVERHEAD   9U
+#define USBD_COMPOSITE_FS_INTR_OVERHEAD   13U
+#define USBD_COMPOSITE_HS_ISOC_OVERHEAD   38U
+#define USBD_COMPOSITE_HS_INTR_OVERHEAD   55U
+
 /**
   * @}
   */
@@ -67,6 +183,9 @@
   * @{
   */
 
+/* Configuration the registry maps of a device currently describe */
+#define USBD_COMPOSITE_CFG(pdev)          (&USBD_COMPOSITE_Config[USBD_DEV_IDX(pdev)][USBD_COMPOSITE_CfgIdx[USBD_DEV_IDX(pdev)]])
+
 /**
   * @}
   */
@@ -86,12 +205,75 @@ static uint8_t USBD_COMPOSITE_SOF(USBD_HandleTypeDef *pdev);
 static uint8_t USBD_COMPOSITE_IsoINIncomplete(USBD_HandleTypeDef *pdev, uint8_t epnum);
 static uint8_t USBD_COMPOSITE_IsoOutIncomplete(USBD_HandleTypeDef *pdev, uint8_t epnum);
 
-static uint8_t *USBD_COMPOSITE_GetHSCfgDesc(uint16_t *length);
-static uint8_t *USBD_COMPOSITE_GetFSCfgDesc(uint16_t *length);
-static uint8_t *USBD_COMPOSITE_GetOtherSpeedCfgDesc(uint16_t *length);
-static uint8_t *USBD_COMPOSITE_GetDeviceQualifierDesc(uint16_t *length);
+static uint8_t *USBD_COMPOSITE_GetHSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_COMPOSITE_GetFSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_COMPOSITE_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_COMPOSITE_GetDeviceQualifierDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
 static uint8_t *USBD_COMPOSITE_GetUsrStringDesc(USBD_HandleTypeDef *pdev, uint8_t index, uint16_t *length);
 
+static const USBD_COMPOSITE_DriverTypeDef *USBD_COMPOSITE_GetDriver(USBD_ClassTypeDef *pclass);
+static uint8_t USBD_COMPOSITE_FindItf(USBD_HandleTypeDef *pdev, uint8_t itf);
+static uint8_t USBD_COMPOSITE_FindEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr);
+static uint8_t USBD_COMPOSITE_Build(USBD_HandleTypeDef *pdev, uint8_t cfg);
+static uint8_t USBD_COMPOSITE_InCfg(USBD_HandleTypeDef *pdev, uint8_t idx);
+static uint8_t USBD_COMPOSITE_BuildOrder(USBD_HandleTypeDef *pdev, uint8_t n);
+static void USBD_COMPOSITE_Layout(USBD_HandleTypeDef *pdev);
+static uint8_t USBD_COMPOSITE_DescIdx(USBD_HandleTypeDef *pdev);
+static uint16_t USBD_COMPOSITE_DropEP(uint8_t *pdesc, uint16_t len);
+static void USBD_COMPOSITE_Plan(USBD_HandleTypeDef *pdev);
+static uint32_t USBD_COMPOSITE_PeriodicLoad(uint8_t *pdesc, uint16_t len, uint8_t speed);
+static void USBD_COMPOSITE_ParseDesc(USBD_ClassEntryTypeDef *pentry, uint8_t *pdesc, uint16_t len);
+static void USBD_COMPOSITE_SetCfgHeader(uint8_t *pdesc, uint16_t len, uint8_t itf_num, uint8_t cfg_value);
+
+#if (USBD_USE_CDC_RNDIS == 1)
+static void USBD_COMPOSITE_Update_CDC_RNDIS(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                            uint8_t in_ep, uint8_t out_ep, uint8_t str_idx);
+#endif
+#if (USBD_USE_CDC_ECM == 1)
+static void USBD_COMPOSITE_Update_CDC_ECM(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                          uint8_t in_ep, uint8_t out_ep, uint8_t str_idx);
+#endif
+#if (USBD_USE_HID_MOUSE == 1)
+static void USBD_COMPOSITE_Update_HID_MOUSE(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                            uint8_t in_ep, uint8_t out_ep, uint8_t str_idx);
+#endif
+#if (USBD_USE_HID_KEYBOARD == 1)
+static void USBD_COMPOSITE_Update_HID_KEYBOARD(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                               uint8_t in_ep, uint8_t out_ep, uint8_t str_idx);
+#endif
+#if (USBD_USE_HID_CUSTOM == 1)
+static void USBD_COMPOSITE_Update_HID_CUSTOM(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                             uint8_t in_ep, uint8_t out_ep, uint8_t str_idx);
+#endif
+#if (USBD_USE_UAC_MIC == 1)
+static void USBD_COMPOSITE_Update_AUDIO_MIC(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                            uint8_t in_ep, uint8_t out_ep, uint8_t str_idx);
+#endif
+#if (USBD_USE_UAC_SPKR == 1)
+static void USBD_COMPOSITE_Update_AUDIO_SPKR(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                             uint8_t in_ep, uint8_t out_ep, uint8_t str_idx);
+#endif
+#if (USBD_USE_UVC == 1)
+static void USBD_COMPOSITE_Update_VIDEO(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                        uint8_t in_ep, uint8_t out_ep, uint8_t str_idx);
+#endif
+#if (USBD_USE_MSC == 1)
+static void USBD_COMPOSITE_Update_MSC(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                      uint8_t in_ep, uint8_t out_ep, uint8_t str_idx);
+#endif
+#if (USBD_USE_DFU == 1)
+static void USBD_COMPOSITE_Update_DFU(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                      uint8_t in_ep, uint8_t out_ep, uint8_t str_idx);
+#endif
+#if (USBD_USE_PRNTR == 1)
+static void USBD_COMPOSITE_Update_PRNT(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                       uint8_t in_ep, uint8_t out_ep, uint8_t str_idx);
+#endif
+#if (USBD_USE_CDC_ACM == 1)
+static void USBD_COMPOSITE_Update_CDC_ACM(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                          uint8_t in_ep, uint8_t out_ep, uint8_t str_idx);
+#endif
+
 /**
   * @}
   */
@@ -118,53 +300,75 @@ USBD_ClassTypeDef USBD_COMPOSITE =
         USBD_COMPOSITE_GetDeviceQualifierDesc,
         USBD_COMPOSITE_GetUsrStringDesc};
 
-typedef struct USBD_COMPOSITE_CFG_DESC_t
-{
-  uint8_t CONFIG_DESC[USB_CONF_DESC_SIZE];
+/* Optional endpoints the planner may leave out, in order. The CDC ACM
+   notification endpoints only go when CDC_ACM_NOTIFY compiles the
+   notifications out, a communication interface without its interrupt
+   endpoint is refused by the host drivers otherwise */
+static const uint8_t USBD_COMPOSITE_ReduceOrder[] =
+    {
+#if (USBD_USE_CDC_ACM == 1) && (CDC_ACM_NOTIFY == 0U)
+        USBD_COMPOSITE_REDUCE_CDC_NOTIFY,
+#endif
+        USBD_COMPOSITE_REDUCE_HID_OUT};
+
+/* Class drivers the composite can mount */
+static const USBD_COMPOSITE_DriverTypeDef USBD_COMPOSITE_Drivers[] =
+    {
 #if (USBD_USE_CDC_RNDIS == 1)
-  uint8_t USBD_CDC_RNDIS_DESC[CDC_RNDIS_CONFIG_DESC_SIZE - 0x09];
+        {&USBD_CDC_RNDIS, USBD_CDC_RNDIS_MAX_INST, 1U, CDC_RNDIS_STR_DESC, USBD_COMPOSITE_Update_CDC_RNDIS},
 #endif
 #if (USBD_USE_CDC_ECM == 1)
-  uint8_t USBD_CDC_ECM_DESC[CDC_ECM_CONFIG_DESC_SIZE - 0x09];
+        {&USBD_CDC_ECM, USBD_CDC_ECM_MAX_INST, 1U, CDC_ECM_STR_DESC, USBD_COMPOSITE_Update_CDC_ECM},
 #endif
 #if (USBD_USE_HID_MOUSE == 1)
-  uint8_t USBD_HID_MOUSE_DESC[USB_HID_CONFIG_DESC_SIZ - 0x09];
+        {&USBD_HID_MOUSE, USBD_HID_MOUSE_MAX_INST, 1U, HID_MOUSE_STR_DESC, USBD_COMPOSITE_Update_HID_MOUSE},
 #endif
 #if (USBD_USE_HID_KEYBOARD == 1)
-  uint8_t USBD_HID_KEYBOARD_DESC[HID_KEYBOARD_CONFIG_DESC_SIZE - 0x09];
+        {&USBD_HID_KEYBOARD, USBD_HID_KEYBOARD_MAX_INST, 1U, HID_KEYBOARD_STR_DESC, USBD_COMPOSITE_Update_HID_KEYBOARD},
 #endif
 #if (USBD_USE_HID_CUSTOM == 1)
-  uint8_t USBD_HID_CUSTOM_DESC[USB_CUSTOM_HID_CONFIG_DESC_SIZ - 0x09];
+        {&USBD_HID_CUSTOM, USBD_CUSTOM_HID_MAX_INST, 1U, CUSTOM_HID_STR_DESC, USBD_COMPOSITE_Update_HID_CUSTOM},
 #endif
 #if (USBD_USE_UAC_MIC == 1)
-  uint8_t USBD_UAC_MIC_DESC[USBD_AUDIO_MIC_CONFIG_DESC_SIZE - 0x09];
+        {&USBD_AUDIO_MIC, USBD_AUDIO_MIC_MAX_INST, 1U, AUDIO_MIC_STR_DESC, USBD_COMPOSITE_Update_AUDIO_MIC},
 #endif
 #if (USBD_USE_UAC_SPKR == 1)
-  uint8_t USBD_AUDIO_SPKR_DESC[USBD_AUDIO_SPKR_CONFIG_DESC_SIZE - 0x09];
+        {&USBD_AUDIO_SPKR, USBD_AUDIO_SPKR_MAX_INST, 1U, AUDIO_SPKR_STR_DESC, USBD_COMPOSITE_Update_AUDIO_SPKR},
 #endif
 #if (USBD_USE_UVC == 1)
-  uint8_t USBD_UVC_DESC[UVC_CONFIG_DESC_SIZE - 0x09];
+        {&USBD_VIDEO, USBD_UVC_MAX_INST, 1U, UVC_STR_DESC, USBD_COMPOSITE_Update_VIDEO},
 #endif
 #if (USBD_USE_MSC == 1)
-  uint8_t USBD_MSC_DESC[USB_MSC_CONFIG_DESC_SIZ - 0x09];
+        {&USBD_MSC, USBD_MSC_MAX_INST, 1U, MSC_BOT_STR_DESC, USBD_COMPOSITE_Update_MSC},
 #endif
 #if (USBD_USE_DFU == 1)
-  uint8_t USBD_DFU_DESC[USB_DFU_CONFIG_DESC_SIZ - 0x09];
+        {&USBD_DFU, USBD_DFU_MAX_INST, USBD_DFU_MAX_ITF_NUM, DFU_STR_DESC, USBD_COMPOSITE_Update_DFU},
 #endif
 #if (USBD_USE_PRNTR == 1)
-  uint8_t USBD_PRNTR_DESC[USB_PRNT_CONFIG_DESC_SIZE - 0x09];
+        {&USBD_PRNT, USBD_PRNT_MAX_INST, 1U, PRNT_STR_DESC, USBD_COMPOSITE_Update_PRNT},
 #endif
 #if (USBD_USE_CDC_ACM == 1)
-  uint8_t USBD_CDC_ACM_DESC[USB_CDC_CONFIG_DESC_SIZ - 0x09];
+        /* The CDC ACM channels share one entry, the string carries the channel */
+        {&USBD_CDC_ACM, 1U, USBD_CDC_ACM_COUNT, CDC_ACM_STR_DESC, USBD_COMPOSITE_Update_CDC_ACM},
 #endif
+        {NULL, 0U, 0U, NULL, NULL}};
 
-} __PACKED USBD_COMPOSITE_CFG_DESC_t;
+#if defined(__ICCARM__) /*!< IAR Compiler */
+#pragma data_alignment = 4
+#endif
+__ALIGN_BEGIN static uint8_t USBD_COMPOSITE_FSCfgDesc[USBD_MAX_NUM_DEV][USBD_MAX_NUM_CONFIGURATION][USBD_COMPOSITE_CFG_DESC_SIZE] __ALIGN_END;
 
 #if defined(__ICCARM__) /*!< IAR Compiler */
 #pragma data_alignment = 4
 #endif
-__ALIGN_BEGIN USBD_COMPOSITE_CFG_DESC_t USBD_COMPOSITE_FSCfgDesc, USBD_COMPOSITE_HSCfgDesc __ALIGN_END;
-uint8_t USBD_Track_String_Index = (USBD_IDX_INTERFACE_STR + 1);
+__ALIGN_BEGIN static uint8_t USBD_COMPOSITE_HSCfgDesc[USBD_MAX_NUM_DEV][USBD_MAX_NUM_CONFIGURATION][USBD_COMPOSITE_CFG_DESC_SIZE] __ALIGN_END;
+
+static USBD_COMPOSITE_ConfigTypeDef USBD_COMPOSITE_Config[USBD_MAX_NUM_DEV][USBD_MAX_NUM_CONFIGURATION];
+static USBD_COMPOSITE_PeriodicTypeDef USBD_COMPOSITE_Periodic[USBD_MAX_NUM_DEV][USBD_MAX_NUM_CONFIGURATION];
+static uint8_t USBD_COMPOSITE_CfgIdx[USBD_MAX_NUM_DEV];
+static uint32_t USBD_COMPOSITE_Active[USBD_MAX_NUM_DEV];
+static uint8_t USBD_COMPOSITE_Dedicated[USBD_MAX_NUM_DEV];   /* entry index + 1, 0 for none */
+static USBD_COMPOSITE_SwitchTypeDef USBD_COMPOSITE_Switch[USBD_MAX_NUM_DEV];
 
 #if defined(__ICCARM__) /*!< IAR Compiler */
 #pragma data_alignment = 4
@@ -201,42 +405,29 @@ __ALIGN_BEGIN static uint8_t USBD_COMPOSITE_DeviceQualifierDesc[USB_LEN_DEV_QUAL
   */
 static uint8_t USBD_COMPOSITE_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
 {
-#if (USBD_USE_CDC_ACM == 1)
-  USBD_CDC_ACM.Init(pdev, cfgidx);
-#endif
-#if (USBD_USE_CDC_ECM == 1)
-  USBD_CDC_ECM.Init(pdev, cfgidx);
-#endif
-#if (USBD_USE_CDC_RNDIS == 1)
-  USBD_CDC_RNDIS.Init(pdev, cfgidx);
-#endif
-#if (USBD_USE_HID_MOUSE == 1)
-  USBD_HID_MOUSE.Init(pdev, cfgidx);
-#endif
-#if (USBD_USE_HID_KEYBOARD == 1)
-  USBD_HID_KEYBOARD.Init(pdev, cfgidx);
-#endif
-#if (USBD_USE_HID_CUSTOM == 1)
-  USBD_HID_CUSTOM.Init(pdev, cfgidx);
-#endif
-#if (USBD_USE_UAC_MIC == 1)
-  USBD_AUDIO_MIC.Init(pdev, cfgidx);
-#endif
-#if (USBD_USE_UAC_SPKR == 1)
-  USBD_AUDIO_SPKR.Init(pdev, cfgidx);
-#endif
-#if (USBD_USE_UVC == 1)
-  USBD_VIDEO.Init(pdev, cfgidx);
-#endif
-#if (USBD_USE_MSC == 1)
-  USBD_MSC.Init(pdev, cfgidx);
-#endif
-#if (USBD_USE_DFU == 1)
-  USBD_DFU.Init(pdev, cfgidx);
-#endif
-#if (USBD_USE_PRNTR == 1)
-  USBD_PRNT.Init(pdev, cfgidx);
-#endif
+  uint8_t classId = pdev->classId;
+
+  /* Load the interfaces and endpoints of the selected configuration */
+  if (USBD_COMPOSITE_CfgIdx[USBD_DEV_IDX(pdev)] != (uint8_t)(cfgidx - 1U))
+  {
+    (void)USBD_COMPOSITE_Build(pdev, (uint8_t)(cfgidx - 1U));
+  }
+
+  /* The FIFO memory goes to the endpoints of this configuration */
+  (void)USBD_LL_SetConfiguration(pdev, cfgidx);
+
+  for (uint8_t idx = 0U; idx < pdev->NumClasses; idx++)
+  {
+    if (USBD_COMPOSITE_InCfg(pdev, idx) == 0U)
+    {
+      continue;
+    }
+
+    pdev->classId = idx;
+    (void)pdev->tclass[idx].pClass->Init(pdev, cfgidx);
+  }
+
+  pdev->classId = classId;
 
   return (uint8_t)USBD_OK;
 }
@@ -250,42 +441,24 @@ static uint8_t USBD_COMPOSITE_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   */
 static uint8_t USBD_COMPOSITE_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
 {
-#if (USBD_USE_CDC_ACM == 1)
-  USBD_CDC_ACM.DeInit(pdev, cfgidx);
-#endif
-#if (USBD_USE_CDC_ECM == 1)
-  USBD_CDC_ECM.DeInit(pdev, cfgidx);
-#endif
-#if (USBD_USE_CDC_RNDIS == 1)
-  USBD_CDC_RNDIS.DeInit(pdev, cfgidx);
-#endif
-#if (USBD_USE_HID_MOUSE == 1)
-  USBD_HID_MOUSE.DeInit(pdev, cfgidx);
-#endif
-#if (USBD_USE_HID_KEYBOARD == 1)
-  USBD_HID_KEYBOARD.DeInit(pdev, cfgidx);
-#endif
-#if (USBD_USE_HID_CUSTOM == 1)
-  USBD_HID_CUSTOM.DeInit(pdev, cfgidx);
-#endif
-#if (USBD_USE_UAC_MIC == 1)
-  USBD_AUDIO_MIC.DeInit(pdev, cfgidx);
-#endif
-#if (USBD_USE_UAC_SPKR == 1)
-  USBD_AUDIO_SPKR.DeInit(pdev, cfgidx);
-#endif
-#if (USBD_USE_UVC == 1)
-  USBD_VIDEO.DeInit(pdev, cfgidx);
-#endif
-#if (USBD_USE_MSC == 1)
-  USBD_MSC.DeInit(pdev, cfgidx);
-#endif
-#if (USBD_USE_DFU == 1)
-  USBD_DFU.DeInit(pdev, cfgidx);
-#endif
-#if (USBD_USE_PRNTR == 1)
-  USBD_PRNT.DeInit(pdev, cfgidx);
-#endif
+  uint8_t classId = pdev->classId;
+
+  for (uint8_t idx = 0U; idx < pdev->NumClasses; idx++)
+  {
+    if (USBD_COMPOSITE_InCfg(pdev, idx) == 0U)
+    {
+      continue;
+    }
+
+    pdev->classId = idx;
+#if (USBD_DEFER_CLASS_INIT == 1U)
+    /* Work never started needs no undoing */
+    pdev->tclass[idx].DeferredInit = NULL;
+#endif /* (USBD_DEFER_CLASS_INIT == 1U) */
+    (void)pdev->tclass[idx].pClass->DeInit(pdev, cfgidx);
+  }
+
+  pdev->classId = classId;
 
   return (uint8_t)USBD_OK;
 }
@@ -300,83 +473,34 @@ static uint8_t USBD_COMPOSITE_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
 static uint8_t USBD_COMPOSITE_Setup(USBD_HandleTypeDef *pdev,
                                     USBD_SetupReqTypedef *req)
 {
-#if (USBD_USE_CDC_ACM == 1)
-  for (uint8_t i = 0; i < USBD_CDC_ACM_COUNT; i++)
-  {
-    if (LOBYTE(req->wIndex) == CDC_CMD_ITF_NBR[i] || LOBYTE(req->wIndex) == CDC_COM_ITF_NBR[i])
-    {
-      return USBD_CDC_ACM.Setup(pdev, req);
-    }
-  }
-#endif
-#if (USBD_USE_CDC_ECM == 1)
-  if (LOBYTE(req->wIndex) == CDC_ECM_CMD_ITF_NBR || LOBYTE(req->wIndex) == CDC_ECM_COM_ITF_NBR)
-  {
-    return USBD_CDC_ECM.Setup(pdev, req);
-  }
-#endif
-#if (USBD_USE_CDC_RNDIS == 1)
-  if (LOBYTE(req->wIndex) == CDC_RNDIS_CMD_ITF_NBR || LOBYTE(req->wIndex) == CDC_RNDIS_COM_ITF_NBR)
-  {
-    return USBD_CDC_RNDIS.Setup(pdev, req);
-  }
-#endif
-#if (USBD_USE_HID_MOUSE == 1)
-  if (LOBYTE(req->wIndex) == HID_MOUSE_ITF_NBR)
-  {
-    return USBD_HID_MOUSE.Setup(pdev, req);
-  }
-#endif
-#if (USBD_USE_HID_KEYBOARD == 1)
-  if (LOBYTE(req->wIndex) == HID_KEYBOARD_ITF_NBR)
-  {
-    return USBD_HID_KEYBOARD.Setup(pdev, req);
-  }
-#endif
-#if (USBD_USE_HID_CUSTOM == 1)
-  if (LOBYTE(req->wIndex) == CUSTOM_HID_ITF_NBR)
-  {
-    return USBD_HID_CUSTOM.Setup(pdev, req);
-  }
-#endif
-#if (USBD_USE_UAC_MIC == 1)
-  if (LOBYTE(req->wIndex) == AUDIO_MIC_AC_ITF_NBR || LOBYTE(req->wIndex) == AUDIO_MIC_AS_ITF_NBR)
-  {
-    return USBD_AUDIO_MIC.Setup(pdev, req);
-  }
-#endif
-#if (USBD_USE_UAC_SPKR == 1)
-  if (LOBYTE(req->wIndex) == AUDIO_SPKR_AC_ITF_NBR || LOBYTE(req->wIndex) == AUDIO_SPKR_AS_ITF_NBR)
-  {
-    return USBD_AUDIO_SPKR.Setup(pdev, req);
-  }
-#endif
-#if (USBD_USE_UVC == 1)
-  if (LOBYTE(req->wIndex) == UVC_VC_IF_NUM || LOBYTE(req->wIndex) == UVC_VS_IF_NUM)
-  {
-    return USBD_VIDEO.Setup(pdev, req);
-  }
-#endif
-#if (USBD_USE_MSC == 1)
-  if (LOBYTE(req->wIndex) == MSC_ITF_NBR)
+  uint8_t classId = pdev->classId;
+  uint8_t idx;
+  uint8_t ret;
+
+  /* Endpoint requests go to the owner of the endpoint, the others to the
+     owner of the interface */
+  if ((req->bmRequest & USB_REQ_RECIPIENT_MASK) == USB_REQ_RECIPIENT_ENDPOINT)
   {
-    return USBD_MSC.Setup(pdev, req);
+    idx = USBD_COMPOSITE_FindEP(pdev, LOBYTE(req->wIndex));
   }
-#endif
-#if (USBD_USE_DFU == 1)
-  if (LOBYTE(req->wIndex) == DFU_ITF_NBR)
+  else
   {
-    return USBD_DFU.Setup(pdev, req);
+    idx = USBD_COMPOSITE_FindItf(pdev, LOBYTE(req->wIndex));
   }
-#endif
-#if (USBD_USE_PRNTR == 1)
-  if (LOBYTE(req->wIndex) == PRNT_ITF_NBR)
+
+  if (idx == USBD_COMPOSITE_NO_CLASS)
   {
-    USBD_PRNT.Setup(pdev, req);
+    return (uint8_t)USBD_FAIL;
   }
-#endif
 
-  return USBD_FAIL;
+  pdev->classId = idx;
+#if (USBD_DEFER_CLASS_INIT == 1U)
+  USBD_CoreRunDeferredInit(pdev);
+#endif /* (USBD_DEFER_CLASS_INIT == 1U) */
+  ret = pdev->tclass[idx].pClass->Setup(pdev, req);
+  pdev->classId = classId;
+
+  return ret;
 }
 
 /**
@@ -388,116 +512,45 @@ static uint8_t USBD_COMPOSITE_Setup(USBD_HandleTypeDef *pdev,
   */
 static uint8_t USBD_COMPOSITE_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
 {
-#if (USBD_USE_CDC_ACM == 1)
-  for (uint8_t i = 0; i < USBD_CDC_ACM_COUNT; i++)
-  {
-    if (epnum == (CDC_IN_EP[i] & 0x7F) || epnum == (CDC_CMD_EP[i] & 0x7F))
-    {
-      return USBD_CDC_ACM.DataIn(pdev, epnum);
-    }
-  }
-#endif
-#if (USBD_USE_CDC_ECM == 1)
-  if (epnum == (CDC_ECM_IN_EP & 0x7F) || epnum == (CDC_ECM_CMD_EP & 0x7F))
-  {
-    return USBD_CDC_ECM.DataIn(pdev, epnum);
-  }
-#endif
-#if (USBD_USE_CDC_RNDIS == 1)
-  if (epnum == (CDC_RNDIS_IN_EP & 0x7F) || epnum == (CDC_RNDIS_CMD_EP & 0x7F))
+  uint8_t classId = pdev->classId;
+  uint8_t idx = USBD_COMPOSITE_FindEP(pdev, epnum | 0x80U);
+  uint8_t ret;
+
+  if ((idx == USBD_COMPOSITE_NO_CLASS) || (pdev->tclass[idx].pClass->DataIn == NULL))
   {
-    return USBD_CDC_RNDIS.DataIn(pdev, epnum);
+    return (uint8_t)USBD_FAIL;
   }
-#endif
-#if (USBD_USE_HID_MOUSE == 1)
-  if (epnum == (HID_MOUSE_IN_EP & 0x7F))
+
+  pdev->classId = idx;
+#if (USBD_DEFER_CLASS_INIT == 1U)
+  USBD_CoreRunDeferredInit(pdev);
+#endif /* (USBD_DEFER_CLASS_INIT == 1U) */
+  ret = pdev->tclass[idx].pClass->DataIn(pdev, epnum);
+  pdev->classId = classId;
+
+  return ret;
+}
+
+/**
+  * @brief  USBD_COMPOSITE_EP0_RxReady
+  *         handle EP0 Rx Ready event
+  * @param  pdev: device instance
+  * @retval status
+  */
+static uint8_t USBD_COMPOSITE_EP0_RxReady(USBD_HandleTypeDef *pdev)
+{
+  uint8_t classId = pdev->classId;
+
+  for (uint8_t idx = 0U; idx < pdev->NumClasses; idx++)
   {
-    return USBD_HID_MOUSE.DataIn(pdev, epnum);
+    if ((pdev->tclass[idx].pClass->EP0_RxReady != NULL) && (USBD_COMPOSITE_InCfg(pdev, idx) != 0U))
+    {
+      pdev->classId = idx;
+      (void)pdev->tclass[idx].pClass->EP0_RxReady(pdev);
+    }
   }
-#endif
-#if (USBD_USE_HID_KEYBOARD == 1)
-  if (epnum == (HID_KEYBOARD_IN_EP & 0x7F))
-  {
-    return USBD_HID_KEYBOARD.DataIn(pdev, epnum);
-  }
-#endif
-#if (USBD_USE_HID_CUSTOM == 1)
-  if (epnum == (CUSTOM_HID_IN_EP & 0x7F))
-  {
-    return USBD_HID_CUSTOM.DataIn(pdev, epnum);
-  }
-#endif
-#if (USBD_USE_UAC_MIC == 1)
-  if (epnum == (AUDIO_MIC_EP & 0x7F))
-  {
-    return USBD_AUDIO_MIC.DataIn(pdev, epnum);
-  }
-#endif
-#if (USBD_USE_UAC_SPKR == 1)
-#endif
-#if (USBD_USE_UVC == 1)
-  if (epnum == (UVC_IN_EP & 0x7F))
-  {
-    return USBD_VIDEO.DataIn(pdev, epnum);
-  }
-#endif
-#if (USBD_USE_MSC == 1)
-  if (epnum == (MSC_IN_EP & 0x7F))
-  {
-    return USBD_MSC.DataIn(pdev, epnum);
-  }
-#endif
-#if (USBD_USE_DFU == 1)
-#endif
-#if (USBD_USE_PRNTR == 1)
-  if (epnum == (PRNT_IN_EP & 0x7F))
-  {
-    USBD_PRNT.DataIn(pdev, epnum);
-  }
-#endif
-
-  return USBD_FAIL;
-}
 
-/**
-  * @brief  USBD_COMPOSITE_EP0_RxReady
-  *         handle EP0 Rx Ready event
-  * @param  pdev: device instance
-  * @retval status
-  */
-static uint8_t USBD_COMPOSITE_EP0_RxReady(USBD_HandleTypeDef *pdev)
-{
-#if (USBD_USE_CDC_ACM == 1)
-  USBD_CDC_ACM.EP0_RxReady(pdev);
-#endif
-#if (USBD_USE_CDC_ECM == 1)
-  USBD_CDC_ECM.EP0_RxReady(pdev);
-#endif
-#if (USBD_USE_CDC_RNDIS == 1)
-  USBD_CDC_RNDIS.EP0_RxReady(pdev);
-#endif
-#if (USBD_USE_HID_MOUSE == 1)
-#endif
-#if (USBD_USE_HID_KEYBOARD == 1)
-#endif
-#if (USBD_USE_HID_CUSTOM == 1)
-  USBD_HID_CUSTOM.EP0_RxReady(pdev);
-#endif
-#if (USBD_USE_UAC_MIC == 1)
-  USBD_AUDIO_MIC.EP0_RxReady(pdev);
-#endif
-#if (USBD_USE_UAC_SPKR == 1)
-  USBD_AUDIO_SPKR.EP0_RxReady(pdev);
-#endif
-#if (USBD_USE_UVC == 1)
-#endif
-#if (USBD_USE_MSC == 1)
-#endif
-#if (USBD_USE_DFU == 1)
-  USBD_DFU.EP0_RxReady(pdev);
-#endif
-#if (USBD_USE_PRNTR == 1)
-#endif
+  pdev->classId = classId;
 
   return (uint8_t)USBD_OK;
 }
@@ -510,33 +563,18 @@ static uint8_t USBD_COMPOSITE_EP0_RxReady(USBD_HandleTypeDef *pdev)
   */
 static uint8_t USBD_COMPOSITE_EP0_TxReady(USBD_HandleTypeDef *pdev)
 {
-#if (USBD_USE_CDC_ACM == 1)
-#endif
-#if (USBD_USE_CDC_ECM == 1)
-#endif
-#if (USBD_USE_CDC_RNDIS == 1)
-#endif
-#if (USBD_USE_HID_MOUSE == 1)
-#endif
-#if (USBD_USE_HID_KEYBOARD == 1)
-#endif
-#if (USBD_USE_HID_CUSTOM == 1)
-#endif
-#if (USBD_USE_UAC_MIC == 1)
-  USBD_AUDIO_MIC.EP0_TxSent(pdev);
-#endif
-#if (USBD_USE_UAC_SPKR == 1)
-  USBD_AUDIO_SPKR.EP0_TxSent(pdev);
-#endif
-#if (USBD_USE_UVC == 1)
-#endif
-#if (USBD_USE_MSC == 1)
-#endif
-#if (USBD_USE_DFU == 1)
-  USBD_DFU.EP0_TxSent(pdev);
-#endif
-#if (USBD_USE_PRNTR == 1)
-#endif
+  uint8_t classId = pdev->classId;
+
+  for (uint8_t idx = 0U; idx < pdev->NumClasses; idx++)
+  {
+    if ((pdev->tclass[idx].pClass->EP0_TxSent != NULL) && (USBD_COMPOSITE_InCfg(pdev, idx) != 0U))
+    {
+      pdev->classId = idx;
+      (void)pdev->tclass[idx].pClass->EP0_TxSent(pdev);
+    }
+  }
+
+  pdev->classId = classId;
 
   return (uint8_t)USBD_OK;
 }
@@ -549,34 +587,18 @@ static uint8_t USBD_COMPOSITE_EP0_TxReady(USBD_HandleTypeDef *pdev)
   */
 static uint8_t USBD_COMPOSITE_SOF(USBD_HandleTypeDef *pdev)
 {
-#if (USBD_USE_CDC_ACM == 1)
-#endif
-#if (USBD_USE_CDC_ECM == 1)
-#endif
-#if (USBD_USE_CDC_RNDIS == 1)
-#endif
-#if (USBD_USE_HID_MOUSE == 1)
-#endif
-#if (USBD_USE_HID_KEYBOARD == 1)
-#endif
-#if (USBD_USE_HID_CUSTOM == 1)
-#endif
-#if (USBD_USE_UAC_MIC == 1)
-  USBD_AUDIO_MIC.SOF(pdev);
-#endif
-#if (USBD_USE_UAC_SPKR == 1)
-  USBD_AUDIO_SPKR.SOF(pdev);
-#endif
-#if (USBD_USE_UVC == 1)
-  USBD_VIDEO.SOF(pdev);
-#endif
-#if (USBD_USE_MSC == 1)
-#endif
-#if (USBD_USE_DFU == 1)
-  USBD_DFU.SOF(pdev);
-#endif
-#if (USBD_USE_PRNTR == 1)
-#endif
+  uint8_t classId = pdev->classId;
+
+  for (uint8_t idx = 0U; idx < pdev->NumClasses; idx++)
+  {
+    if ((pdev->tclass[idx].pClass->SOF != NULL) && (USBD_COMPOSITE_InCfg(pdev, idx) != 0U))
+    {
+      pdev->classId = idx;
+      (void)pdev->tclass[idx].pClass->SOF(pdev);
+    }
+  }
+
+  pdev->classId = classId;
 
   return (uint8_t)USBD_OK;
 }
@@ -590,38 +612,15 @@ static uint8_t USBD_COMPOSITE_SOF(USBD_HandleTypeDef *pdev)
   */
 static uint8_t USBD_COMPOSITE_IsoINIncomplete(USBD_HandleTypeDef *pdev, uint8_t epnum)
 {
-#if (USBD_USE_CDC_ACM == 1)
-#endif
-#if (USBD_USE_CDC_ECM == 1)
-#endif
-#if (USBD_USE_CDC_RNDIS == 1)
-#endif
-#if (USBD_USE_HID_MOUSE == 1)
-#endif
-#if (USBD_USE_HID_KEYBOARD == 1)
-#endif
-#if (USBD_USE_HID_CUSTOM == 1)
-#endif
-#if (USBD_USE_UAC_MIC == 1)
-  if (epnum == (AUDIO_MIC_EP & 0x7F))
-  {
-    USBD_AUDIO_MIC.IsoINIncomplete(pdev, epnum);
-  }
-#endif
-#if (USBD_USE_UAC_SPKR == 1)
-#endif
-#if (USBD_USE_UVC == 1)
-  if (epnum == (UVC_IN_EP & 0x7F))
+  uint8_t classId = pdev->classId;
+  uint8_t idx = USBD_COMPOSITE_FindEP(pdev, epnum | 0x80U);
+
+  if ((idx != USBD_COMPOSITE_NO_CLASS) && (pdev->tclass[idx].pClass->IsoINIncomplete != NULL))
   {
-    USBD_VIDEO.IsoINIncomplete(pdev, epnum);
+    pdev->classId = idx;
+    (void)pdev->tclass[idx].pClass->IsoINIncomplete(pdev, epnum);
+    pdev->classId = classId;
   }
-#endif
-#if (USBD_USE_MSC == 1)
-#endif
-#if (USBD_USE_DFU == 1)
-#endif
-#if (USBD_USE_PRNTR == 1)
-#endif
 
   return (uint8_t)USBD_OK;
 }
@@ -635,37 +634,19 @@ static uint8_t USBD_COMPOSITE_IsoINIncomplete(USBD_HandleTypeDef *pdev, uint8_t
   */
 static uint8_t USBD_COMPOSITE_IsoOutIncomplete(USBD_HandleTypeDef *pdev, uint8_t epnum)
 {
-#if (USBD_USE_CDC_ACM == 1)
-#endif
-#if (USBD_USE_CDC_ECM == 1)
-#endif
-#if (USBD_USE_CDC_RNDIS == 1)
-#endif
-#if (USBD_USE_HID_MOUSE == 1)
-#endif
-#if (USBD_USE_HID_KEYBOARD == 1)
-#endif
-#if (USBD_USE_HID_CUSTOM == 1)
-#endif
-#if (USBD_USE_UAC_MIC == 1)
-#endif
-#if (USBD_USE_UAC_SPKR == 1)
-  if (epnum == AUDIO_SPKR_EP)
+  uint8_t classId = pdev->classId;
+  uint8_t idx = USBD_COMPOSITE_FindEP(pdev, epnum & 0x7FU);
+
+  if ((idx != USBD_COMPOSITE_NO_CLASS) && (pdev->tclass[idx].pClass->IsoOUTIncomplete != NULL))
   {
-    USBD_AUDIO_SPKR.IsoOUTIncomplete(pdev, epnum);
+    pdev->classId = idx;
+    (void)pdev->tclass[idx].pClass->IsoOUTIncomplete(pdev, epnum);
+    pdev->classId = classId;
   }
-#endif
-#if (USBD_USE_UVC == 1)
-#endif
-#if (USBD_USE_MSC == 1)
-#endif
-#if (USBD_USE_DFU == 1)
-#endif
-#if (USBD_USE_PRNTR == 1)
-#endif
 
   return (uint8_t)USBD_OK;
 }
+
 /**
   * @brief  USBD_COMPOSITE_DataOut
   *         handle data OUT Stage
@@ -675,114 +656,83 @@ static uint8_t USBD_COMPOSITE_IsoOutIncomplete(USBD_HandleTypeDef *pdev, uint8_t
   */
 static uint8_t USBD_COMPOSITE_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
 {
-#if (USBD_USE_CDC_ACM == 1)
-  for (uint8_t i = 0; i < USBD_CDC_ACM_COUNT; i++)
-  {
-    if (epnum == CDC_OUT_EP[i])
-    {
-      return USBD_CDC_ACM.DataOut(pdev, epnum);
-    }
-  }
-#endif
-#if (USBD_USE_CDC_ECM == 1)
-  if (epnum == CDC_ECM_OUT_EP)
-  {
-    return USBD_CDC_ECM.DataOut(pdev, epnum);
-  }
-#endif
-#if (USBD_USE_CDC_RNDIS == 1)
-  if (epnum == CDC_RNDIS_OUT_EP)
-  {
-    return USBD_CDC_RNDIS.DataOut(pdev, epnum);
-  }
-#endif
-#if (USBD_USE_HID_MOUSE == 1)
-#endif
-#if (USBD_USE_HID_KEYBOARD == 1)
-#endif
-#if (USBD_USE_HID_CUSTOM == 1)
-  if (epnum == CUSTOM_HID_OUT_EP)
-  {
-    return USBD_HID_CUSTOM.DataOut(pdev, epnum);
-  }
-#endif
-#if (USBD_USE_UAC_MIC == 1)
-#endif
-#if (USBD_USE_UAC_SPKR == 1)
-  if (epnum == AUDIO_SPKR_EP)
-  {
-    return USBD_AUDIO_SPKR.DataOut(pdev, epnum);
-  }
-#endif
-#if (USBD_USE_UVC == 1)
-#endif
-#if (USBD_USE_MSC == 1)
-  if (epnum == MSC_OUT_EP)
-  {
-    return USBD_MSC.DataOut(pdev, epnum);
-  }
-#endif
-#if (USBD_USE_DFU == 1)
-#endif
-#if (USBD_USE_PRNTR == 1)
-  if (epnum == PRNT_OUT_EP)
+  uint8_t classId = pdev->classId;
+  uint8_t idx = USBD_COMPOSITE_FindEP(pdev, epnum & 0x7FU);
+  uint8_t ret;
+
+  if ((idx == USBD_COMPOSITE_NO_CLASS) || (pdev->tclass[idx].pClass->DataOut == NULL))
   {
-    USBD_PRNT.DataOut(pdev, epnum);
+    return (uint8_t)USBD_FAIL;
   }
-#endif
 
-  return USBD_FAIL;
+  pdev->classId = idx;
+#if (USBD_DEFER_CLASS_INIT == 1U)
+  USBD_CoreRunDeferredInit(pdev);
+#endif /* (USBD_DEFER_CLASS_INIT == 1U) */
+  ret = pdev->tclass[idx].pClass->DataOut(pdev, epnum);
+  pdev->classId = classId;
+
+  return ret;
 }
 
 /**
   * @brief  USBD_COMPOSITE_GetHSCfgDesc
   *         return configuration descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_COMPOSITE_GetHSCfgDesc(uint16_t *length)
+static uint8_t *USBD_COMPOSITE_GetHSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
-  *length = (uint16_t)sizeof(USBD_COMPOSITE_HSCfgDesc);
-  return (uint8_t *)&USBD_COMPOSITE_HSCfgDesc;
+  uint8_t cfg = USBD_COMPOSITE_DescIdx(pdev);
+
+  *length = USBD_COMPOSITE_Config[USBD_DEV_IDX(pdev)][cfg].hs_len;
+  return USBD_COMPOSITE_HSCfgDesc[USBD_DEV_IDX(pdev)][cfg];
 }
 
 /**
   * @brief  USBD_COMPOSITE_GetFSCfgDesc
   *         return configuration descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_COMPOSITE_GetFSCfgDesc(uint16_t *length)
+static uint8_t *USBD_COMPOSITE_GetFSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
-  *length = (uint16_t)sizeof(USBD_COMPOSITE_FSCfgDesc);
-  return (uint8_t *)&USBD_COMPOSITE_FSCfgDesc;
+  uint8_t cfg = USBD_COMPOSITE_DescIdx(pdev);
+
+  *length = USBD_COMPOSITE_Config[USBD_DEV_IDX(pdev)][cfg].fs_len;
+  return USBD_COMPOSITE_FSCfgDesc[USBD_DEV_IDX(pdev)][cfg];
 }
 
 /**
   * @brief  USBD_COMPOSITE_GetOtherSpeedCfgDesc
   *         return configuration descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_COMPOSITE_GetOtherSpeedCfgDesc(uint16_t *length)
+static uint8_t *USBD_COMPOSITE_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
-#if (USBD_USE_HS == 1)
-  *length = (uint16_t)sizeof(USBD_COMPOSITE_FSCfgDesc);
-  return (uint8_t *)&USBD_COMPOSITE_FSCfgDesc;
-#else
-  *length = (uint16_t)sizeof(USBD_COMPOSITE_HSCfgDesc);
-  return (uint8_t *)&USBD_COMPOSITE_HSCfgDesc;
-#endif
+  if (pdev->id == DEVICE_HS)
+  {
+    return USBD_COMPOSITE_GetFSCfgDesc(pdev, length);
+  }
+
+  return USBD_COMPOSITE_GetHSCfgDesc(pdev, length);
 }
 
 /**
   * @brief  DeviceQualifierDescriptor
   *         return Device Qualifier descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-uint8_t *USBD_COMPOSITE_GetDeviceQualifierDesc(uint16_t *length)
+uint8_t *USBD_COMPOSITE_GetDeviceQualifierDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_COMPOSITE_DeviceQualifierDesc);
   return USBD_COMPOSITE_DeviceQualifierDesc;
 }
@@ -799,359 +749,994 @@ uint8_t *USBD_COMPOSITE_GetDeviceQualifierDesc(uint16_t *length)
 static uint8_t *USBD_COMPOSITE_GetUsrStringDesc(USBD_HandleTypeDef *pdev, uint8_t index, uint16_t *length)
 {
   static uint8_t USBD_StrDesc[64];
+  char str_buffer[32] = "";
 
-  /* Check if the requested string interface is supported */
-  if (index <= USBD_Track_String_Index)
+  for (uint8_t idx = 0U; idx < pdev->NumClasses; idx++)
   {
-#if (USBD_USE_CDC_ACM == 1)
-    char str_buffer[16] = "";
-    for (uint8_t i = 0; i < USBD_CDC_ACM_COUNT; i++)
-    {
-      if (index == CDC_STR_DESC_IDX[i])
-      {
-        snprintf(str_buffer, sizeof(str_buffer), CDC_ACM_STR_DESC, i);
-        USBD_GetString((uint8_t *)str_buffer, USBD_StrDesc, length);
-      }
-    }
-#endif
-#if (USBD_USE_CDC_ECM == 1)
-    if (index == CDC_ECM_STR_DESC_IDX)
+    USBD_ClassEntryTypeDef *pentry = &pdev->tclass[idx];
+    const USBD_COMPOSITE_DriverTypeDef *pdrv;
+
+    /* Check if the requested string interface is supported */
+    if ((index < pentry->map.str_idx) || (index >= (pentry->map.str_idx + pentry->str_num)))
     {
-      USBD_GetString((uint8_t *)CDC_ECM_STR_DESC, USBD_StrDesc, length);
+      continue;
     }
-#endif
-#if (USBD_USE_CDC_RNDIS == 1)
-    if (index == CDC_RNDIS_STR_DESC_IDX)
+
+    pdrv = USBD_COMPOSITE_GetDriver(pentry->pClass);
+
+    if (pdrv == NULL)
     {
-      USBD_GetString((uint8_t *)CDC_RNDIS_STR_DESC, USBD_StrDesc, length);
+      break;
     }
+
+    /* Classes with several strings number them */
+    (void)snprintf(str_buffer, sizeof(str_buffer), pdrv->str_desc, index - pentry->map.str_idx);
+    USBD_GetString((uint8_t *)str_buffer, USBD_StrDesc, length);
+
+    return USBD_StrDesc;
+  }
+
+  /* Not supported Interface Descriptor index */
+  return NULL;
+}
 #endif
-#if (USBD_USE_HID_MOUSE == 1)
-    if (index == HID_MOUSE_STR_DESC_IDX)
+
+/**
+  * @brief  USBD_COMPOSITE_AddClass
+  *         Append a class instance to the registry of a device, the
+  *         instance is selected so the class Register function called
+  *         next binds its user interface to it
+  * @param  pdev: device instance
+  * @param  pclass: class driver
+  * @retval status
+  */
+USBD_StatusTypeDef USBD_COMPOSITE_AddClass(USBD_HandleTypeDef *pdev, USBD_ClassTypeDef *pclass)
+{
+  const USBD_COMPOSITE_DriverTypeDef *pdrv = USBD_COMPOSITE_GetDriver(pclass);
+  USBD_ClassEntryTypeDef *pentry;
+  uint8_t inst = 0U;
+
+  if ((pdrv == NULL) || (pdev->NumClasses >= USBD_MAX_CLASS_NUM))
+  {
+    return USBD_FAIL;
+  }
+
+  for (uint8_t idx = 0U; idx < pdev->NumClasses; idx++)
+  {
+    if (pdev->tclass[idx].pClass == pclass)
     {
-      USBD_GetString((uint8_t *)HID_MOUSE_STR_DESC, USBD_StrDesc, length);
+      inst++;
     }
+  }
+
+  /* The per instance state of the class is sized by its instance count */
+  if (inst >= pdrv->max_inst)
+  {
+    return USBD_FAIL;
+  }
+
+  pentry = &pdev->tclass[pdev->NumClasses];
+  (void)USBD_memset(pentry, 0, sizeof(USBD_ClassEntryTypeDef));
+  pentry->pClass = pclass;
+  pentry->inst = inst;
+  pentry->str_num = pdrv->str_num;
+  pentry->cfg_mask = USBD_COMPOSITE_ALL_CFG;
+
+  pdev->classId = pdev->NumClasses;
+  pdev->NumClasses++;
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_COMPOSITE_SetConfigs
+  *         Select the configurations the class instance added last is part
+  *         of, by default it is part of all of them
+  * @param  pdev: device instance
+  * @param  cfg_mask: bit n set for configuration n + 1
+  * @retval status
+  */
+USBD_StatusTypeDef USBD_COMPOSITE_SetConfigs(USBD_HandleTypeDef *pdev, uint8_t cfg_mask)
+{
+  if ((pdev->classId >= pdev->NumClasses) || (cfg_mask == 0U) ||
+      ((cfg_mask & (uint8_t)~USBD_COMPOSITE_ALL_CFG) != 0U))
+  {
+    return USBD_FAIL;
+  }
+
+  pdev->tclass[pdev->classId].cfg_mask = cfg_mask;
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_COMPOSITE_SetDedicated
+  *         Give the class instance added last the first endpoints, EP1 IN
+  *         and EP1 OUT, ahead of the registry order. Meant for the busiest
+  *         bulk class so it can be served by the OTG_HS EP1 vectors
+  * @param  pdev: device instance
+  * @retval status
+  */
+USBD_StatusTypeDef USBD_COMPOSITE_SetDedicated(USBD_HandleTypeDef *pdev)
+{
+  if (pdev->classId >= pdev->NumClasses)
+  {
+    return USBD_FAIL;
+  }
+
+  USBD_COMPOSITE_Dedicated[USBD_DEV_IDX(pdev)] = pdev->classId + 1U;
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_COMPOSITE_Mount_Class
+  *         Build the composite configuration descriptors of a device and
+  *         assign the endpoints and interfaces of each class
+  * @param  pdev: device instance
+  * @param  id: Low level core index, selects the per device class tables
+  * @retval None
+  */
+void USBD_COMPOSITE_Mount_Class(USBD_HandleTypeDef *pdev, uint8_t id)
+{
+  /* Class tables are indexed by the core, set it before USBD_Init */
+  pdev->id = id;
+
+  /* Every instance of the registry is active until a personality is chosen */
+  USBD_COMPOSITE_Active[USBD_DEV_IDX(pdev)] = (uint32_t)((1ULL << pdev->NumClasses) - 1U);
+
+  USBD_COMPOSITE_Layout(pdev);
+}
+
+/**
+  * @brief  USBD_COMPOSITE_SetPersonality
+  *         Switch the set of active class instances of a running device.
+  *         The device is detached, the descriptors, endpoint maps and FIFO
+  *         memory are rebuilt for the new set and the device is attached
+  *         again so the host enumerates it afresh; the MCU keeps running.
+  *         Blocks for about USBD_COMPOSITE_DETACH_MS, call it from thread
+  *         context, never from a USB callback.
+  * @param  pdev: device instance
+  * @param  class_mask: bit n set for registry entry n, in AddClass order
+  * @retval status
+  */
+USBD_StatusTypeDef USBD_COMPOSITE_SetPersonality(USBD_HandleTypeDef *pdev, uint32_t class_mask)
+{
+  uint8_t dev = USBD_DEV_IDX(pdev);
+  USBD_COMPOSITE_SwitchTypeDef *psw = &USBD_COMPOSITE_Switch[dev];
+#if (USBD_USE_TIMEBASE == 1U) || (USBD_ENUM_TRACE == 1U)
+  uint32_t freq = USBD_LL_GetTimestampFreq();
+  uint32_t t0 = USBD_LL_GetTimestamp();
+#endif /* (USBD_USE_TIMEBASE == 1U) || (USBD_ENUM_TRACE == 1U) */
+
+  if ((class_mask == 0U) ||
+      ((class_mask & ~(uint32_t)((1ULL << pdev->NumClasses) - 1U)) != 0U))
+  {
+    return USBD_FAIL;
+  }
+
+  (void)USBD_memset(psw, 0, sizeof(USBD_COMPOSITE_SwitchTypeDef));
+
+  /* Disconnect and release the instances of the current personality */
+  (void)USBD_Stop(pdev);
+
+  /* The next bus reset must not release them a second time */
+  pdev->dev_config = 0U;
+  pdev->dev_state = USBD_STATE_DEFAULT;
+
+#if (USBD_USE_TIMEBASE == 1U) || (USBD_ENUM_TRACE == 1U)
+  psw->detach_us = (uint32_t)(((uint64_t)(USBD_LL_GetTimestamp() - t0) * 1000000U) / freq);
+#endif /* (USBD_USE_TIMEBASE == 1U) || (USBD_ENUM_TRACE == 1U) */
+
+  /* Rebuild while detached, the FIFO memory follows the first configuration
+     until the host selects one */
+  USBD_COMPOSITE_Active[dev] = class_mask;
+  USBD_COMPOSITE_Layout(pdev);
+  (void)USBD_LL_SetConfiguration(pdev, 1U);
+
+#if (USBD_USE_TIMEBASE == 1U) || (USBD_ENUM_TRACE == 1U)
+  psw->rebuild_us = (uint32_t)(((uint64_t)(USBD_LL_GetTimestamp() - t0) * 1000000U) / freq) -
+                    psw->detach_us;
+#endif /* (USBD_USE_TIMEBASE == 1U) || (USBD_ENUM_TRACE == 1U) */
+
+  USBD_LL_Delay(USBD_COMPOSITE_DETACH_MS);
+
+  if (USBD_Start(pdev) != USBD_OK)
+  {
+    return USBD_FAIL;
+  }
+
+#if (USBD_USE_TIMEBASE == 1U) || (USBD_ENUM_TRACE == 1U)
+  psw->total_us = (uint32_t)(((uint64_t)(USBD_LL_GetTimestamp() - t0) * 1000000U) / freq);
+
+  if (psw->total_us > USBD_COMPOSITE_SWITCH_BUDGET_US)
+  {
+    USBD_ErrLog("Personality switch took %d us", (int)psw->total_us);
+  }
+#endif /* (USBD_USE_TIMEBASE == 1U) || (USBD_ENUM_TRACE == 1U) */
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_COMPOSITE_GetSwitch
+  *         Return the timing of the last personality switch of a device,
+  *         left at zero when the low level driver has no timestamp source
+  * @param  pdev: device instance
+  * @retval switch timing
+  */
+const USBD_COMPOSITE_SwitchTypeDef *USBD_COMPOSITE_GetSwitch(USBD_HandleTypeDef *pdev)
+{
+  return &USBD_COMPOSITE_Switch[USBD_DEV_IDX(pdev)];
+}
+
+/**
+  * @brief  USBD_COMPOSITE_GetPeriodic
+  *         Return the periodic bandwidth a configuration of a device
+  *         reserves, as planned when its classes were mounted
+  * @param  pdev: device instance
+  * @param  cfgidx: configuration value, 1 to USBD_MAX_NUM_CONFIGURATION
+  * @retval periodic bandwidth of each speed, NULL for an unknown configuration
+  */
+const USBD_COMPOSITE_PeriodicTypeDef *USBD_COMPOSITE_GetPeriodic(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
+{
+  if ((cfgidx == 0U) || (cfgidx > USBD_MAX_NUM_CONFIGURATION))
+  {
+    return NULL;
+  }
+
+  return &USBD_COMPOSITE_Periodic[USBD_DEV_IDX(pdev)][cfgidx - 1U];
+}
+
+/**
+  * @brief  USBD_COMPOSITE_Plan
+  *         Fit the periodic endpoints of the configuration last built in
+  *         the periodic share of a (micro)frame. The audio and HID packet sizes follow
+  *         from the sample rates and the reports so they are kept, the
+  *         video packet size is lowered down to UVC_ISO_xS_MPS_MIN
+  * @param  pdev: device instance
+  * @retval None
+  */
+static void USBD_COMPOSITE_Plan(USBD_HandleTypeDef *pdev)
+{
+  uint8_t dev = USBD_DEV_IDX(pdev);
+  uint8_t cfg = USBD_COMPOSITE_CfgIdx[dev];
+  USBD_COMPOSITE_ConfigTypeDef *pcfg = &USBD_COMPOSITE_Config[dev][cfg];
+  USBD_COMPOSITE_PeriodicTypeDef *pplan = &USBD_COMPOSITE_Periodic[dev][cfg];
+#if (USBD_USE_UVC == 1)
+  uint16_t fs_mps = UVC_ISO_FS_MPS;
+  uint16_t hs_mps = UVC_ISO_HS_MPS;
+  uint8_t lowered;
 #endif
-#if (USBD_USE_HID_KEYBOARD == 1)
-    if (index == HID_KEYBOARD_STR_DESC_IDX)
+
+  pplan->fs_limit = USBD_COMPOSITE_FS_PERIODIC_LIMIT;
+  pplan->hs_limit = USBD_COMPOSITE_HS_PERIODIC_LIMIT;
+
+  for (;;)
+  {
+    pplan->fs_load = USBD_COMPOSITE_PeriodicLoad(USBD_COMPOSITE_FSCfgDesc[dev][cfg], pcfg->fs_len,
+                                                 (uint8_t)USBD_SPEED_FULL);
+    pplan->hs_load = USBD_COMPOSITE_PeriodicLoad(USBD_COMPOSITE_HSCfgDesc[dev][cfg], pcfg->hs_len,
+                                                 (uint8_t)USBD_SPEED_HIGH);
+
+#if (USBD_USE_UVC == 1)
+    lowered = 0U;
+
+    if ((pplan->fs_load > pplan->fs_limit) && (fs_mps > UVC_ISO_FS_MPS_MIN))
     {
-      USBD_GetString((uint8_t *)HID_KEYBOARD_STR_DESC, USBD_StrDesc, length);
+      fs_mps = MAX(fs_mps / 2U, UVC_ISO_FS_MPS_MIN);
+      lowered = 1U;
     }
-#endif
-#if (USBD_USE_HID_CUSTOM == 1)
-    if (index == CUSTOM_HID_STR_DESC_IDX)
+
+    if ((pplan->hs_load > pplan->hs_limit) && (hs_mps > UVC_ISO_HS_MPS_MIN))
     {
-      USBD_GetString((uint8_t *)CUSTOM_HID_STR_DESC, USBD_StrDesc, length);
+      hs_mps = MAX(hs_mps / 2U, UVC_ISO_HS_MPS_MIN);
+      lowered = 1U;
     }
-#endif
-#if (USBD_USE_UAC_MIC == 1)
-    if (index == AUDIO_MIC_STR_DESC_IDX)
+
+    if (lowered != 0U)
     {
-      USBD_GetString((uint8_t *)AUDIO_MIC_STR_DESC, USBD_StrDesc, length);
+      /* Descriptors are built again with the smaller video packets */
+      pcfg->uvc_fs_mps = fs_mps;
+      pcfg->uvc_hs_mps = hs_mps;
+      (void)USBD_COMPOSITE_Build(pdev, cfg);
+      continue;
     }
 #endif
-#if (USBD_USE_UAC_SPKR == 1)
-    if (index == AUDIO_SPKR_STR_DESC_IDX)
+
+    break;
+  }
+
+  if (pplan->fs_load > pplan->fs_limit)
+  {
+    USBD_ErrLog("Periodic endpoints of configuration %d exceed the full speed frame budget", (int)cfg + 1);
+  }
+
+  if (pplan->hs_load > pplan->hs_limit)
+  {
+    USBD_ErrLog("Periodic endpoints of configuration %d exceed the high speed microframe budget", (int)cfg + 1);
+  }
+}
+
+/**
+  * @brief  USBD_COMPOSITE_PeriodicLoad
+  *         Worst case bytes of a (micro)frame taken by the periodic
+  *         endpoints of a configuration, when they are all served in the
+  *         same (micro)frame. An interface counts with its largest
+  *         alternate setting
+  * @param  pdesc: configuration descriptor
+  * @param  len: length of the configuration descriptor
+  * @param  speed: USBD_SPEED_HIGH or USBD_SPEED_FULL
+  * @retval bytes per (micro)frame, bit stuffing and protocol overhead included
+  */
+static uint32_t USBD_COMPOSITE_PeriodicLoad(uint8_t *pdesc, uint16_t len, uint8_t speed)
+{
+  uint16_t ptr = 0U;
+  uint8_t itf = 0xFFU;
+  uint32_t total = 0U;
+  uint32_t itf_max = 0U;
+  uint32_t alt = 0U;
+
+  while (((ptr + 5U) < len) && (pdesc[ptr] != 0U))
+  {
+    if (pdesc[ptr + 1U] == USB_DESC_TYPE_INTERFACE)
     {
-      USBD_GetString((uint8_t *)AUDIO_SPKR_STR_DESC, USBD_StrDesc, length);
+      itf_max = MAX(itf_max, alt);
+      alt = 0U;
+
+      if (pdesc[ptr + 2U] != itf)
+      {
+        total += itf_max;
+        itf_max = 0U;
+        itf = pdesc[ptr + 2U];
+      }
     }
-#endif
-#if (USBD_USE_UVC == 1)
-    if (index == UVC_STR_DESC_IDX)
+    else if ((pdesc[ptr + 1U] == USB_DESC_TYPE_ENDPOINT) && ((pdesc[ptr + 3U] & 0x01U) == 0x01U))
     {
-      USBD_GetString((uint8_t *)UVC_STR_DESC, USBD_StrDesc, length);
+      /* Isochronous (01b) or interrupt (11b) endpoint */
+      uint16_t mps = (uint16_t)pdesc[ptr + 4U] | ((uint16_t)pdesc[ptr + 5U] << 8);
+      uint8_t isoc = ((pdesc[ptr + 3U] & 0x03U) == USBD_EP_TYPE_ISOC) ? 1U : 0U;
+      uint32_t payload;
+
+      if (speed == (uint8_t)USBD_SPEED_HIGH)
+      {
+        /* High bandwidth endpoints add transactions in bits 12:11 */
+        payload = (uint32_t)(mps & 0x7FFU) * (((uint32_t)mps >> 11) & 0x03U) + (mps & 0x7FFU);
+        alt += (isoc != 0U) ? USBD_COMPOSITE_HS_ISOC_OVERHEAD : USBD_COMPOSITE_HS_INTR_OVERHEAD;
+      }
+      else
+      {
+        payload = (uint32_t)mps & 0x3FFU;
+        alt += (isoc != 0U) ? USBD_COMPOSITE_FS_ISOC_OVERHEAD : USBD_COMPOSITE_FS_INTR_OVERHEAD;
+      }
+
+      /* Worst case bit stuffing adds one bit every six */
+      alt += ((payload * 7U) + 5U) / 6U;
     }
-#endif
-#if (USBD_USE_MSC == 1)
-    if (index == MSC_BOT_STR_DESC_IDX)
+    else
     {
-      USBD_GetString((uint8_t *)MSC_BOT_STR_DESC, USBD_StrDesc, length);
+      /* not a periodic endpoint */
     }
+
+    ptr += pdesc[ptr];
+  }
+
+  return total + MAX(itf_max, alt);
+}
+
+/**
+  * @brief  USBD_COMPOSITE_Build
+  *         Build the configuration descriptors of a configuration of a
+  *         device with the choices made for it, the registry maps are left
+  *         describing that configuration
+  * @param  pdev: device instance
+  * @param  cfg: configuration index, from 0
+  * @retval number of endpoints needed in each direction, EP0 included
+  */
+static uint8_t USBD_COMPOSITE_Build(USBD_HandleTypeDef *pdev, uint8_t cfg)
+{
+  uint16_t len = 0U;
+  uint8_t *ptr = NULL;
+  uint8_t dev = USBD_DEV_IDX(pdev);
+  uint8_t classId = pdev->classId;
+  USBD_COMPOSITE_ConfigTypeDef *pcfg = &USBD_COMPOSITE_Config[dev][cfg];
+  uint8_t *pfs = USBD_COMPOSITE_FSCfgDesc[dev][cfg];
+  uint8_t *phs = USBD_COMPOSITE_HSCfgDesc[dev][cfg];
+
+  uint8_t in_ep_track = 0x81U;
+  uint8_t out_ep_track = 0x01U;
+  uint8_t interface_no_track = 0x00U;
+  uint8_t str_idx_track = USBD_IDX_INTERFACE_STR + 1U;
+
+  USBD_COMPOSITE_CfgIdx[dev] = cfg;
+  pcfg->fs_len = USB_CONF_DESC_SIZE;
+  pcfg->hs_len = USB_CONF_DESC_SIZE;
+
+#if (USBD_USE_UVC == 1)
+  (void)USBD_VIDEO_SetIsoMPS(pdev, pcfg->uvc_fs_mps, pcfg->uvc_hs_mps);
 #endif
-#if (USBD_USE_DFU == 1)
-    if (index == DFU_STR_DESC_IDX)
+
+  for (uint8_t n = 0U; n < pdev->NumClasses; n++)
+  {
+    uint8_t idx = USBD_COMPOSITE_BuildOrder(pdev, n);
+    USBD_ClassEntryTypeDef *pentry = &pdev->tclass[idx];
+    const USBD_COMPOSITE_DriverTypeDef *pdrv = USBD_COMPOSITE_GetDriver(pentry->pClass);
+    uint16_t fs_len = pcfg->fs_len;
+    uint16_t hs_len = pcfg->hs_len;
+    uint16_t fs_add = 0U;
+    uint16_t hs_add = 0U;
+
+    if (pdrv == NULL)
     {
-      USBD_GetString((uint8_t *)DFU_STR_DESC, USBD_StrDesc, length);
+      continue;
     }
-#endif
-#if (USBD_USE_PRNTR == 1)
-    if (index == PRINTER_STR_DESC_IDX)
+
+    /* An instance out of the configuration owns nothing in it, its strings
+       keep their index so they read the same in every configuration */
+    if (USBD_COMPOSITE_InCfg(pdev, idx) == 0U)
     {
-      USBD_GetString((uint8_t *)PRNT_STR_DESC, USBD_StrDesc, length);
+      (void)USBD_memset(&pentry->map, 0, sizeof(USBD_ClassMapTypeDef));
+      pentry->ep_in = 0U;
+      pentry->ep_out = 0U;
+      pentry->map.str_idx = str_idx_track;
+      str_idx_track += pentry->str_num;
+      continue;
     }
-#endif
-    return USBD_StrDesc;
+
+    pdev->classId = idx;
+
+    /* Skip a class whose descriptors do not fit in the buffers */
+    (void)pentry->pClass->GetFSConfigDescriptor(pdev, &fs_add);
+    (void)pentry->pClass->GetHSConfigDescriptor(pdev, &hs_add);
+
+    if ((fs_add <= USB_CONF_DESC_SIZE) || (hs_add <= USB_CONF_DESC_SIZE) ||
+        ((fs_len + fs_add - USB_CONF_DESC_SIZE) > USBD_COMPOSITE_CFG_DESC_SIZE) ||
+        ((hs_len + hs_add - USB_CONF_DESC_SIZE) > USBD_COMPOSITE_CFG_DESC_SIZE))
+    {
+      USBD_ErrLog("Configuration descriptor buffer overflow");
+      continue;
+    }
+
+    /* Endpoints a class leaves out are given address 0 by its Update */
+    ptr = pentry->pClass->GetFSConfigDescriptor(pdev, &len);
+    pdrv->Update(pdev, ptr, interface_no_track, in_ep_track, out_ep_track, str_idx_track);
+    (void)USBD_memcpy(&pfs[fs_len], ptr + USB_CONF_DESC_SIZE, len - USB_CONF_DESC_SIZE);
+    fs_len += USBD_COMPOSITE_DropEP(&pfs[fs_len], len - USB_CONF_DESC_SIZE);
+
+    ptr = pentry->pClass->GetHSConfigDescriptor(pdev, &len);
+    pdrv->Update(pdev, ptr, interface_no_track, in_ep_track, out_ep_track, str_idx_track);
+    (void)USBD_memcpy(&phs[hs_len], ptr + USB_CONF_DESC_SIZE, len - USB_CONF_DESC_SIZE);
+    hs_len += USBD_COMPOSITE_DropEP(&phs[hs_len], len - USB_CONF_DESC_SIZE);
+
+    /* The interfaces and endpoints the class took are read back from its
+       descriptors, the next class starts after them */
+    USBD_COMPOSITE_ParseDesc(pentry, &pfs[pcfg->fs_len], fs_len - pcfg->fs_len);
+    pentry->map.str_idx = str_idx_track;
+
+    pcfg->fs_len = fs_len;
+    pcfg->hs_len = hs_len;
+
+    if (pentry->map.itf_num != 0U)
+    {
+      interface_no_track = pentry->map.itf_nbr + pentry->map.itf_num;
+    }
+
+    for (uint8_t ep = 1U; ep < 16U; ep++)
+    {
+      if ((pentry->ep_in & (1U << ep)) != 0U)
+      {
+        in_ep_track = (ep + 1U) | 0x80U;
+      }
+
+      if ((pentry->ep_out & (1U << ep)) != 0U)
+      {
+        out_ep_track = ep + 1U;
+      }
+    }
+
+    str_idx_track += pentry->str_num;
   }
-  else
+
+  USBD_COMPOSITE_SetCfgHeader(phs, pcfg->hs_len, interface_no_track, cfg + 1U);
+  USBD_COMPOSITE_SetCfgHeader(pfs, pcfg->fs_len, interface_no_track, cfg + 1U);
+
+  pdev->classId = classId;
+
+  return MAX(in_ep_track & 0x7FU, out_ep_track);
+}
+
+/**
+  * @brief  USBD_COMPOSITE_Layout
+  *         Build every configuration of a device from the active instances
+  *         of its registry and plan their endpoints and periodic bandwidth
+  * @param  pdev: device instance
+  * @retval None
+  */
+static void USBD_COMPOSITE_Layout(USBD_HandleTypeDef *pdev)
+{
+  uint8_t dev = USBD_DEV_IDX(pdev);
+
+  /* Start from the full video bandwidth and every endpoint */
+  (void)USBD_memset(USBD_COMPOSITE_Config[dev], 0, sizeof(USBD_COMPOSITE_Config[dev]));
+
+  /* The last configuration is built first so the registry is left with the
+     maps of the first one, which the low level driver is set up for */
+  for (uint8_t cfg = USBD_MAX_NUM_CONFIGURATION; cfg > 0U; cfg--)
   {
-    /* Not supported Interface Descriptor index */
-    return NULL;
+    USBD_COMPOSITE_ConfigTypeDef *pcfg = &USBD_COMPOSITE_Config[dev][cfg - 1U];
+
+    uint8_t step = 0U;
+
+    /* Leave out the optional endpoints, one kind after the other, while the
+       configuration needs more endpoints than the core has */
+    while (USBD_COMPOSITE_Build(pdev, cfg - 1U) > USBD_MAX_EP_NUM)
+    {
+      if (step == (uint8_t)sizeof(USBD_COMPOSITE_ReduceOrder))
+      {
+        USBD_ErrLog("Not enough endpoints for configuration %d", (int)cfg);
+        break;
+      }
+
+      pcfg->reduce |= USBD_COMPOSITE_ReduceOrder[step];
+      step++;
+    }
+
+    USBD_COMPOSITE_Plan(pdev);
   }
 }
-#endif
 
-void USBD_COMPOSITE_Mount_Class(void)
+/**
+  * @brief  USBD_COMPOSITE_BuildOrder
+  *         Return the entry built at a given position: the instance set by
+  *         USBD_COMPOSITE_SetDedicated first, then the registry order
+  * @param  pdev: device instance
+  * @param  n: build position
+  * @retval entry index
+  */
+static uint8_t USBD_COMPOSITE_BuildOrder(USBD_HandleTypeDef *pdev, uint8_t n)
+{
+  uint8_t first = USBD_COMPOSITE_Dedicated[USBD_DEV_IDX(pdev)];
+
+  if ((first == 0U) || (first > pdev->NumClasses))
+  {
+    return n;
+  }
+
+  if (n == 0U)
+  {
+    return first - 1U;
+  }
+
+  return (n < first) ? (n - 1U) : n;
+}
+
+/**
+  * @brief  USBD_COMPOSITE_InCfg
+  *         Check whether a registry entry is active and part of the
+  *         configuration the registry maps describe
+  * @param  pdev: device instance
+  * @param  idx: entry index
+  * @retval 1 when the entry is part of the configuration, 0 otherwise
+  */
+static uint8_t USBD_COMPOSITE_InCfg(USBD_HandleTypeDef *pdev, uint8_t idx)
 {
-  uint16_t len = 0;
-  uint8_t *ptr = NULL;
+  uint8_t dev = USBD_DEV_IDX(pdev);
+
+  if (((USBD_COMPOSITE_Active[dev] >> idx) & 1U) == 0U)
+  {
+    return 0U;
+  }
+
+  return (uint8_t)((pdev->tclass[idx].cfg_mask >> USBD_COMPOSITE_CfgIdx[dev]) & 1U);
+}
+
+/**
+  * @brief  USBD_COMPOSITE_DescIdx
+  *         Return the configuration a configuration descriptor is read
+  *         for: the one a GET_DESCRIPTOR request names, otherwise the one
+  *         the registry maps describe
+  * @param  pdev: device instance
+  * @retval configuration index, from 0
+  */
+static uint8_t USBD_COMPOSITE_DescIdx(USBD_HandleTypeDef *pdev)
+{
+  USBD_SetupReqTypedef *req = &pdev->request;
 
-  uint8_t in_ep_track = 0x81;
-  uint8_t out_ep_track = 0x01;
-  uint8_t interface_no_track = 0x00;
+  if ((req->bRequest == USB_REQ_GET_DESCRIPTOR) &&
+      ((HIBYTE(req->wValue) == USB_DESC_TYPE_CONFIGURATION) ||
+       (HIBYTE(req->wValue) == USB_DESC_TYPE_OTHER_SPEED_CONFIGURATION)) &&
+      (LOBYTE(req->wValue) < USBD_MAX_NUM_CONFIGURATION))
+  {
+    return LOBYTE(req->wValue);
+  }
+
+  return USBD_COMPOSITE_CfgIdx[USBD_DEV_IDX(pdev)];
+}
+
+/**
+  * @brief  USBD_COMPOSITE_GetDriver
+  *         Return the composite driver of a class
+  * @param  pclass: class driver
+  * @retval driver, NULL when the class is not enabled
+  */
+static const USBD_COMPOSITE_DriverTypeDef *USBD_COMPOSITE_GetDriver(USBD_ClassTypeDef *pclass)
+{
+  for (uint8_t i = 0U; USBD_COMPOSITE_Drivers[i].pClass != NULL; i++)
+  {
+    if (USBD_COMPOSITE_Drivers[i].pClass == pclass)
+    {
+      return &USBD_COMPOSITE_Drivers[i];
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  * @brief  USBD_COMPOSITE_FindItf
+  *         Return the registry entry owning an interface
+  * @param  pdev: device instance
+  * @param  itf: interface number
+  * @retval entry index, USBD_COMPOSITE_NO_CLASS when not found
+  */
+static uint8_t USBD_COMPOSITE_FindItf(USBD_HandleTypeDef *pdev, uint8_t itf)
+{
+  for (uint8_t idx = 0U; idx < pdev->NumClasses; idx++)
+  {
+    USBD_ClassMapTypeDef *pmap = &pdev->tclass[idx].map;
+
+    if ((itf >= pmap->itf_nbr) && (itf < (pmap->itf_nbr + pmap->itf_num)))
+    {
+      return idx;
+    }
+  }
+
+  return USBD_COMPOSITE_NO_CLASS;
+}
+
+/**
+  * @brief  USBD_COMPOSITE_FindEP
+  *         Return the registry entry owning an endpoint
+  * @param  pdev: device instance
+  * @param  ep_addr: endpoint address
+  * @retval entry index, USBD_COMPOSITE_NO_CLASS when not found
+  */
+static uint8_t USBD_COMPOSITE_FindEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  uint16_t mask = (uint16_t)(1U << (ep_addr & 0x0FU));
+
+  for (uint8_t idx = 0U; idx < pdev->NumClasses; idx++)
+  {
+    if ((ep_addr & 0x80U) == 0x80U)
+    {
+      if ((pdev->tclass[idx].ep_in & mask) != 0U)
+      {
+        return idx;
+      }
+    }
+    else if ((pdev->tclass[idx].ep_out & mask) != 0U)
+    {
+      return idx;
+    }
+    else
+    {
+      /* not owned by this entry */
+    }
+  }
+
+  return USBD_COMPOSITE_NO_CLASS;
+}
+
+/**
+  * @brief  USBD_COMPOSITE_DropEP
+  *         Remove the endpoint descriptors with address 0 from the
+  *         descriptors of a class and fix the endpoint count of their
+  *         interface
+  * @param  pdesc: first descriptor of the class
+  * @param  len: length of the class descriptors
+  * @retval length of the class descriptors once the endpoints are removed
+  */
+static uint16_t USBD_COMPOSITE_DropEP(uint8_t *pdesc, uint16_t len)
+{
+  uint16_t ptr = 0U;
+  uint16_t itf = 0xFFFFU;
+
+  while (((ptr + 2U) < len) && (pdesc[ptr] != 0U))
+  {
+    uint8_t size = pdesc[ptr];
+
+    if (pdesc[ptr + 1U] == USB_DESC_TYPE_INTERFACE)
+    {
+      itf = ptr;
+    }
+    else if ((pdesc[ptr + 1U] == USB_DESC_TYPE_ENDPOINT) && ((pdesc[ptr + 2U] & 0x7FU) == 0U))
+    {
+      (void)memmove(&pdesc[ptr], &pdesc[ptr + size], (size_t)len - ptr - size);
+      len -= size;
+
+      if (itf != 0xFFFFU)
+      {
+        pdesc[itf + 4U]--; /* bNumEndpoints */
+      }
+      continue;
+    }
+    else
+    {
+      /* kept as is */
+    }
+
+    ptr += size;
+  }
+
+  return len;
+}
+
+/**
+  * @brief  USBD_COMPOSITE_ParseDesc
+  *         Collect the interfaces and endpoints of a class from its part of
+  *         the configuration descriptor
+  * @param  pentry: registry entry
+  * @param  pdesc: first descriptor of the class
+  * @param  len: length of the class descriptors
+  * @retval None
+  */
+static void USBD_COMPOSITE_ParseDesc(USBD_ClassEntryTypeDef *pentry, uint8_t *pdesc, uint16_t len)
+{
+  uint16_t ptr = 0U;
+  uint8_t itf_min = 0xFFU;
+  uint8_t itf_max = 0U;
+
+  pentry->ep_in = 0U;
+  pentry->ep_out = 0U;
+
+  while (((ptr + 2U) < len) && (pdesc[ptr] != 0U))
+  {
+    if (pdesc[ptr + 1U] == USB_DESC_TYPE_INTERFACE)
+    {
+      /* Alternate settings repeat the interface number */
+      itf_min = MIN(itf_min, pdesc[ptr + 2U]);
+      itf_max = MAX(itf_max, pdesc[ptr + 2U]);
+    }
+    else if (pdesc[ptr + 1U] == USB_DESC_TYPE_ENDPOINT)
+    {
+      if ((pdesc[ptr + 2U] & 0x80U) == 0x80U)
+      {
+        pentry->ep_in |= (uint16_t)(1U << (pdesc[ptr + 2U] & 0x0FU));
+      }
+      else
+      {
+        pentry->ep_out |= (uint16_t)(1U << (pdesc[ptr + 2U] & 0x0FU));
+      }
+    }
+    else
+    {
+      /* class specific descriptor */
+    }
+
+    ptr += pdesc[ptr];
+  }
+
+  if (itf_min == 0xFFU)
+  {
+    pentry->map.itf_nbr = 0U;
+    pentry->map.itf_num = 0U;
+  }
+  else
+  {
+    pentry->map.itf_nbr = itf_min;
+    pentry->map.itf_num = itf_max - itf_min + 1U;
+  }
+}
+
+/**
+  * @brief  USBD_COMPOSITE_SetCfgHeader
+  *         Write the configuration descriptor header
+  * @param  pdesc: configuration descriptor buffer
+  * @param  len: total length of the configuration
+  * @param  itf_num: number of interfaces
+  * @param  cfg_value: configuration value
+  * @retval None
+  */
+static void USBD_COMPOSITE_SetCfgHeader(uint8_t *pdesc, uint16_t len, uint8_t itf_num, uint8_t cfg_value)
+{
+  /* Configuration Descriptor */
+  pdesc[0] = 0x09;                        /* bLength: Configuration Descriptor size */
+  pdesc[1] = USB_DESC_TYPE_CONFIGURATION; /* bDescriptorType: Configuration */
+  pdesc[2] = LOBYTE(len);                 /* wTotalLength:no of returned bytes */
+  pdesc[3] = HIBYTE(len);
+  pdesc[4] = itf_num; /* bNumInterfaces */
+  pdesc[5] = cfg_value; /* bConfigurationValue: Configuration value */
+  pdesc[6] = 0x00;    /* iConfiguration: Index of string descriptor describing the configuration */
+#if (USBD_SELF_POWERED == 1U)
+  pdesc[7] = 0xC0; /* bmAttributes: Bus Powered according to user configuration */
+#else
+  pdesc[7] = 0x80; /* bmAttributes: Bus Powered according to user configuration */
+#endif
+  pdesc[8] = USBD_MAX_POWER; /* MaxPower 100 mA */
+}
 
 #if (USBD_USE_CDC_RNDIS == 1)
-  ptr = USBD_CDC_RNDIS.GetFSConfigDescriptor(&len);
-  USBD_Update_CDC_RNDIS_DESC(ptr,
-                             interface_no_track,
-                             interface_no_track + 1,
-                             in_ep_track,
-                             in_ep_track + 1,
-                             out_ep_track,
-                             USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_FSCfgDesc.USBD_CDC_RNDIS_DESC, ptr + 0x09, len - 0x09);
-
-  ptr = USBD_CDC_RNDIS.GetHSConfigDescriptor(&len);
-  USBD_Update_CDC_RNDIS_DESC(ptr,
-                             interface_no_track,
-                             interface_no_track + 1,
-                             in_ep_track,
-                             in_ep_track + 1,
-                             out_ep_track,
-                             USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_HSCfgDesc.USBD_CDC_RNDIS_DESC, ptr + 0x09, len - 0x09);
-
-  in_ep_track += 2;
-  out_ep_track += 1;
-  interface_no_track += 2;
-  USBD_Track_String_Index += 1;
+/**
+  * @brief  USBD_COMPOSITE_Update_CDC_RNDIS
+  *         Place a CDC RNDIS instance in the configuration
+  * @retval None
+  */
+static void USBD_COMPOSITE_Update_CDC_RNDIS(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                            uint8_t in_ep, uint8_t out_ep, uint8_t str_idx)
+{
+  USBD_Update_CDC_RNDIS_DESC(pdev, desc, itf_no, itf_no + 1U, in_ep, in_ep + 1U, out_ep, str_idx);
+}
 #endif
 
 #if (USBD_USE_CDC_ECM == 1)
-  ptr = USBD_CDC_ECM.GetFSConfigDescriptor(&len);
-  USBD_Update_CDC_ECM_DESC(ptr,
-                           interface_no_track,
-                           interface_no_track + 1,
-                           in_ep_track,
-                           in_ep_track + 1,
-                           out_ep_track,
-                           USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_FSCfgDesc.USBD_CDC_ECM_DESC, ptr + 0x09, len - 0x09);
-
-  ptr = USBD_CDC_ECM.GetHSConfigDescriptor(&len);
-  USBD_Update_CDC_ECM_DESC(ptr,
-                           interface_no_track,
-                           interface_no_track + 1,
-                           in_ep_track,
-                           in_ep_track + 1,
-                           out_ep_track,
-                           USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_HSCfgDesc.USBD_CDC_ECM_DESC, ptr + 0x09, len - 0x09);
-
-  in_ep_track += 2;
-  out_ep_track += 1;
-  interface_no_track += 2;
-  USBD_Track_String_Index += 1;
+/**
+  * @brief  USBD_COMPOSITE_Update_CDC_ECM
+  *         Place a CDC ECM instance in the configuration
+  * @retval None
+  */
+static void USBD_COMPOSITE_Update_CDC_ECM(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                          uint8_t in_ep, uint8_t out_ep, uint8_t str_idx)
+{
+  USBD_Update_CDC_ECM_DESC(pdev, desc, itf_no, itf_no + 1U, in_ep, in_ep + 1U, out_ep, str_idx);
+}
 #endif
 
 #if (USBD_USE_HID_MOUSE == 1)
-  ptr = USBD_HID_MOUSE.GetFSConfigDescriptor(&len);
-  USBD_Update_HID_Mouse_DESC(ptr, interface_no_track, in_ep_track, USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_FSCfgDesc.USBD_HID_MOUSE_DESC, ptr + 0x09, len - 0x09);
-
-  ptr = USBD_HID_MOUSE.GetHSConfigDescriptor(&len);
-  USBD_Update_HID_Mouse_DESC(ptr, interface_no_track, in_ep_track, USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_HSCfgDesc.USBD_HID_MOUSE_DESC, ptr + 0x09, len - 0x09);
+/**
+  * @brief  USBD_COMPOSITE_Update_HID_MOUSE
+  *         Place a HID mouse instance in the configuration
+  * @retval None
+  */
+static void USBD_COMPOSITE_Update_HID_MOUSE(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                            uint8_t in_ep, uint8_t out_ep, uint8_t str_idx)
+{
+  UNUSED(out_ep);
 
-  in_ep_track += 1;
-  interface_no_track += 1;
-  USBD_Track_String_Index += 1;
+  USBD_Update_HID_Mouse_DESC(pdev, desc, itf_no, in_ep, str_idx);
+}
 #endif
 
 #if (USBD_USE_HID_KEYBOARD == 1)
-  ptr = USBD_HID_KEYBOARD.GetFSConfigDescriptor(&len);
-  USBD_Update_HID_KBD_DESC(ptr, interface_no_track, in_ep_track, USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_FSCfgDesc.USBD_HID_KEYBOARD_DESC, ptr + 0x09, len - 0x09);
-
-  ptr = USBD_HID_KEYBOARD.GetHSConfigDescriptor(&len);
-  USBD_Update_HID_KBD_DESC(ptr, interface_no_track, in_ep_track, USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_HSCfgDesc.USBD_HID_KEYBOARD_DESC, ptr + 0x09, len - 0x09);
+/**
+  * @brief  USBD_COMPOSITE_Update_HID_KEYBOARD
+  *         Place a HID keyboard instance in the configuration
+  * @retval None
+  */
+static void USBD_COMPOSITE_Update_HID_KEYBOARD(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                               uint8_t in_ep, uint8_t out_ep, uint8_t str_idx)
+{
+  UNUSED(out_ep);
 
-  in_ep_track += 1;
-  interface_no_track += 1;
-  USBD_Track_String_Index += 1;
+  USBD_Update_HID_KBD_DESC(pdev, desc, itf_no, in_ep, str_idx);
+}
 #endif
 
 #if (USBD_USE_HID_CUSTOM == 1)
-  ptr = USBD_HID_CUSTOM.GetFSConfigDescriptor(&len);
-  USBD_Update_HID_Custom_DESC(ptr, interface_no_track, in_ep_track, out_ep_track, USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_FSCfgDesc.USBD_HID_CUSTOM_DESC, ptr + 0x09, len - 0x09);
-
-  ptr = USBD_HID_CUSTOM.GetHSConfigDescriptor(&len);
-  USBD_Update_HID_Custom_DESC(ptr, interface_no_track, in_ep_track, out_ep_track, USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_HSCfgDesc.USBD_HID_CUSTOM_DESC, ptr + 0x09, len - 0x09);
-
-  in_ep_track += 1;
-  out_ep_track += 1;
-  interface_no_track += 1;
-  USBD_Track_String_Index += 1;
+/**
+  * @brief  USBD_COMPOSITE_Update_HID_CUSTOM
+  *         Place a HID custom instance in the configuration
+  * @retval None
+  */
+static void USBD_COMPOSITE_Update_HID_CUSTOM(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                             uint8_t in_ep, uint8_t out_ep, uint8_t str_idx)
+{
+  /* OUT reports then come with SET_REPORT on the control endpoint */
+  if ((USBD_COMPOSITE_CFG(pdev)->reduce & USBD_COMPOSITE_REDUCE_HID_OUT) != 0U)
+  {
+    out_ep = 0U;
+  }
+
+  USBD_Update_HID_Custom_DESC(pdev, desc, itf_no, in_ep, out_ep, str_idx);
+}
 #endif
 
 #if (USBD_USE_UAC_MIC == 1)
-  ptr = USBD_AUDIO_MIC.GetFSConfigDescriptor(&len);
-  USBD_Update_Audio_MIC_DESC(ptr,
-                             interface_no_track,
-                             interface_no_track + 1,
-                             in_ep_track,
-                             USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_FSCfgDesc.USBD_UAC_MIC_DESC, ptr + 0x09, len - 0x09);
-
-  ptr = USBD_AUDIO_MIC.GetHSConfigDescriptor(&len);
-  USBD_Update_Audio_MIC_DESC(ptr,
-                             interface_no_track,
-                             interface_no_track + 1,
-                             in_ep_track,
-                             USBD_Track_String_Index);
-
-  memcpy(USBD_COMPOSITE_HSCfgDesc.USBD_UAC_MIC_DESC, ptr + 0x09, len - 0x09);
-  in_ep_track += 1;
-  interface_no_track += 2;
-  USBD_Track_String_Index += 1;
+/**
+  * @brief  USBD_COMPOSITE_Update_AUDIO_MIC
+  *         Place a microphone instance in the configuration
+  * @retval None
+  */
+static void USBD_COMPOSITE_Update_AUDIO_MIC(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                            uint8_t in_ep, uint8_t out_ep, uint8_t str_idx)
+{
+  UNUSED(out_ep);
+
+  USBD_Update_Audio_MIC_DESC(pdev, desc, itf_no, itf_no + 1U, in_ep, str_idx);
+}
 #endif
 
 #if (USBD_USE_UAC_SPKR == 1)
-  ptr = USBD_AUDIO_SPKR.GetFSConfigDescriptor(&len);
-  USBD_Update_Audio_SPKR_DESC(ptr, interface_no_track, interface_no_track + 1, out_ep_track, USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_FSCfgDesc.USBD_AUDIO_SPKR_DESC, ptr + 0x09, len - 0x09);
-
-  ptr = USBD_AUDIO_SPKR.GetHSConfigDescriptor(&len);
-  USBD_Update_Audio_SPKR_DESC(ptr, interface_no_track, interface_no_track + 1, out_ep_track, USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_HSCfgDesc.USBD_AUDIO_SPKR_DESC, ptr + 0x09, len - 0x09);
+/**
+  * @brief  USBD_COMPOSITE_Update_AUDIO_SPKR
+  *         Place a speaker instance in the configuration
+  * @retval None
+  */
+static void USBD_COMPOSITE_Update_AUDIO_SPKR(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                             uint8_t in_ep, uint8_t out_ep, uint8_t str_idx)
+{
+  UNUSED(in_ep);
 
-  out_ep_track += 1;
-  interface_no_track += 2;
-  USBD_Track_String_Index += 1;
+  USBD_Update_Audio_SPKR_DESC(pdev, desc, itf_no, itf_no + 1U, out_ep, str_idx);
+}
 #endif
 
 #if (USBD_USE_UVC == 1)
-  ptr = USBD_VIDEO.GetFSConfigDescriptor(&len);
-  USBD_Update_UVC_DESC(ptr, interface_no_track, interface_no_track + 1, in_ep_track, USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_FSCfgDesc.USBD_UVC_DESC, ptr + 0x09, len - 0x09);
-
-  ptr = USBD_VIDEO.GetHSConfigDescriptor(&len);
-  USBD_Update_UVC_DESC(ptr, interface_no_track, interface_no_track + 1, in_ep_track, USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_HSCfgDesc.USBD_UVC_DESC, ptr + 0x09, len - 0x09);
+/**
+  * @brief  USBD_COMPOSITE_Update_VIDEO
+  *         Place a video instance in the configuration
+  * @retval None
+  */
+static void USBD_COMPOSITE_Update_VIDEO(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                        uint8_t in_ep, uint8_t out_ep, uint8_t str_idx)
+{
+  UNUSED(out_ep);
 
-  in_ep_track += 1;
-  interface_no_track += 2;
-  USBD_Track_String_Index += 1;
+  USBD_Update_UVC_DESC(pdev, desc, itf_no, itf_no + 1U, in_ep, str_idx);
+}
 #endif
 
 #if (USBD_USE_MSC == 1)
-  ptr = USBD_MSC.GetFSConfigDescriptor(&len);
-  USBD_Update_MSC_DESC(ptr, interface_no_track, in_ep_track, out_ep_track, USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_FSCfgDesc.USBD_MSC_DESC, ptr + 0x09, len - 0x09);
-
-  ptr = USBD_MSC.GetHSConfigDescriptor(&len);
-  USBD_Update_MSC_DESC(ptr, interface_no_track, in_ep_track, out_ep_track, USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_HSCfgDesc.USBD_MSC_DESC, ptr + 0x09, len - 0x09);
-
-  in_ep_track += 1;
-  out_ep_track += 1;
-  interface_no_track += 1;
-  USBD_Track_String_Index += 1;
+/**
+  * @brief  USBD_COMPOSITE_Update_MSC
+  *         Place a mass storage instance in the configuration
+  * @retval None
+  */
+static void USBD_COMPOSITE_Update_MSC(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                      uint8_t in_ep, uint8_t out_ep, uint8_t str_idx)
+{
+  USBD_Update_MSC_DESC(pdev, desc, itf_no, in_ep, out_ep, str_idx);
+}
 #endif
 
 #if (USBD_USE_DFU == 1)
-  ptr = USBD_DFU.GetFSConfigDescriptor(&len);
-  USBD_Update_DFU_DESC(ptr, interface_no_track, USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_FSCfgDesc.USBD_DFU_DESC, ptr + 0x09, len - 0x09);
-
-  ptr = USBD_DFU.GetHSConfigDescriptor(&len);
-  USBD_Update_DFU_DESC(ptr, interface_no_track, USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_HSCfgDesc.USBD_DFU_DESC, ptr + 0x09, len - 0x09);
+/**
+  * @brief  USBD_COMPOSITE_Update_DFU
+  *         Place a DFU instance in the configuration
+  * @retval None
+  */
+static void USBD_COMPOSITE_Update_DFU(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                      uint8_t in_ep, uint8_t out_ep, uint8_t str_idx)
+{
+  UNUSED(in_ep);
+  UNUSED(out_ep);
 
-  interface_no_track += USBD_DFU_MAX_ITF_NUM;
-  USBD_Track_String_Index += USBD_DFU_MAX_ITF_NUM;
+  USBD_Update_DFU_DESC(pdev, desc, itf_no, str_idx);
+}
 #endif
 
 #if (USBD_USE_PRNTR == 1)
-  ptr = USBD_PRNT.GetFSConfigDescriptor(&len);
-  USBD_Update_PRNT_DESC(ptr, interface_no_track, in_ep_track, out_ep_track, USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_FSCfgDesc.USBD_PRNTR_DESC, ptr + 0x09, len - 0x09);
-
-  ptr = USBD_PRNT.GetHSConfigDescriptor(&len);
-  USBD_Update_PRNT_DESC(ptr, interface_no_track, in_ep_track, out_ep_track, USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_HSCfgDesc.USBD_PRNTR_DESC, ptr + 0x09, len - 0x09);
-  
-  in_ep_track += 1;
-  out_ep_track += 1;
-  interface_no_track += 1;
-  USBD_Track_String_Index += 1;
+/**
+  * @brief  USBD_COMPOSITE_Update_PRNT
+  *         Place a printer instance in the configuration
+  * @retval None
+  */
+static void USBD_COMPOSITE_Update_PRNT(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                       uint8_t in_ep, uint8_t out_ep, uint8_t str_idx)
+{
+  USBD_Update_PRNT_DESC(pdev, desc, itf_no, in_ep, out_ep, str_idx);
+}
 #endif
 
 #if (USBD_USE_CDC_ACM == 1)
-  ptr = USBD_CDC_ACM.GetFSConfigDescriptor(&len);
-  USBD_Update_CDC_ACM_DESC(ptr,
-                           interface_no_track,
-                           interface_no_track + 1,
-                           in_ep_track,
-                           in_ep_track + 1,
-                           out_ep_track,
-                           USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_FSCfgDesc.USBD_CDC_ACM_DESC, ptr + 0x09, len - 0x09);
-
-  ptr = USBD_CDC_ACM.GetHSConfigDescriptor(&len);
-  USBD_Update_CDC_ACM_DESC(ptr,
-                           interface_no_track,
-                           interface_no_track + 1,
-                           in_ep_track,
-                           in_ep_track + 1,
-                           out_ep_track,
-                           USBD_Track_String_Index);
-  memcpy(USBD_COMPOSITE_HSCfgDesc.USBD_CDC_ACM_DESC, ptr + 0x09, len - 0x09);
-
-  in_ep_track += 2 * USBD_CDC_ACM_COUNT;
-  out_ep_track += 1 * USBD_CDC_ACM_COUNT;
-  interface_no_track += 2 * USBD_CDC_ACM_COUNT;
-  USBD_Track_String_Index += USBD_CDC_ACM_COUNT;
-#endif
-
-  uint16_t CFG_SIZE = sizeof(USBD_COMPOSITE_CFG_DESC_t);
-  ptr = USBD_COMPOSITE_HSCfgDesc.CONFIG_DESC;
-  /* Configuration Descriptor */
-  ptr[0] = 0x09;                        /* bLength: Configuration Descriptor size */
-  ptr[1] = USB_DESC_TYPE_CONFIGURATION; /* bDescriptorType: Configuration */
-  ptr[2] = LOBYTE(CFG_SIZE);            /* wTotalLength:no of returned bytes */
-  ptr[3] = HIBYTE(CFG_SIZE);
-  ptr[4] = interface_no_track; /* bNumInterfaces: 2 interface */
-  ptr[5] = 0x01;               /* bConfigurationValue: Configuration value */
-  ptr[6] = 0x00;               /* iConfiguration: Index of string descriptor describing the configuration */
-#if (USBD_SELF_POWERED == 1U)
-  ptr[7] = 0xC0; /* bmAttributes: Bus Powered according to user configuration */
-#else
-  ptr[7] = 0x80; /* bmAttributes: Bus Powered according to user configuration */
-#endif
-  ptr[8] = USBD_MAX_POWER; /* MaxPower 100 mA */
+/**
+  * @brief  USBD_COMPOSITE_Update_CDC_ACM
+  *         Place the CDC ACM channels in the configuration
+  * @retval None
+  */
+static void USBD_COMPOSITE_Update_CDC_ACM(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no,
+                                          uint8_t in_ep, uint8_t out_ep, uint8_t str_idx)
+{
+  uint8_t cmd_ep = in_ep + 1U;
 
-  ptr = USBD_COMPOSITE_FSCfgDesc.CONFIG_DESC;
-  /* Configuration Descriptor */
-  ptr[0] = 0x09;                        /* bLength: Configuration Descriptor size */
-  ptr[1] = USB_DESC_TYPE_CONFIGURATION; /* bDescriptorType: Configuration */
-  ptr[2] = LOBYTE(CFG_SIZE);            /* wTotalLength:no of returned bytes */
-  ptr[3] = HIBYTE(CFG_SIZE);
-  ptr[4] = interface_no_track; /* bNumInterfaces: 2 interface */
-  ptr[5] = 0x01;               /* bConfigurationValue: Configuration value */
-  ptr[6] = 0x00;               /* iConfiguration: Index of string descriptor describing the configuration */
-#if (USBD_SELF_POWERED == 1U)
-  ptr[7] = 0xC0; /* bmAttributes: Bus Powered according to user configuration */
-#else
-  ptr[7] = 0x80; /* bmAttributes: Bus Powered according to user configuration */
-#endif
-  ptr[8] = USBD_MAX_POWER; /* MaxPower 100 mA */
+  /* Only left out with the notifications compiled out */
+  if ((USBD_COMPOSITE_CFG(pdev)->reduce & USBD_COMPOSITE_REDUCE_CDC_NOTIFY) != 0U)
+  {
+    cmd_ep = 0U;
+  }
 
-  (void)out_ep_track;
-  (void)in_ep_track;
+  USBD_Update_CDC_ACM_DESC(pdev, desc, itf_no, itf_no + 1U, in_ep, cmd_ep, out_ep, str_idx);
 }
+#endif
 
 /**
   * @}
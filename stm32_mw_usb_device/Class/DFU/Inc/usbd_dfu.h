@@ -206,8 +206,13 @@ typedef struct
 
 extern USBD_ClassTypeDef USBD_DFU;
 
-extern uint8_t DFU_ITF_NBR;
-extern uint8_t DFU_STR_DESC_IDX;
+/* Instances of the class a device can mount */
+#ifndef USBD_DFU_MAX_INST
+#define USBD_DFU_MAX_INST  1U
+#endif /* USBD_DFU_MAX_INST */
+
+#define DFU_ITF_NBR(pdev)       (USBD_CLASS_MAP(pdev).itf_nbr)
+#define DFU_STR_DESC_IDX(pdev)  (USBD_CLASS_MAP(pdev).str_idx)
 
 /**
   * @}
@@ -219,7 +224,7 @@ extern uint8_t DFU_STR_DESC_IDX;
 uint8_t USBD_DFU_RegisterMedia(USBD_HandleTypeDef *pdev,
                                USBD_DFU_MediaTypeDef *fops);
 
-void USBD_Update_DFU_DESC(uint8_t *desc, uint8_t itf_no, uint8_t str_idx);
+void USBD_Update_DFU_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no, uint8_t str_idx);
 /**
   * @}
   */
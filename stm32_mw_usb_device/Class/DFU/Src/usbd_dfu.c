@@ -59,9 +59,6 @@ EndBSPDependencies */
 #define _DFU_ITF_NBR 0x00
 #define _DFU_STR_DESC_IDX 0x01
 
-uint8_t DFU_ITF_NBR = _DFU_ITF_NBR;
-uint8_t DFU_STR_DESC_IDX = _DFU_STR_DESC_IDX;
-
 /** @addtogroup STM32_USB_DEVICE_LIBRARY
   * @{
   */
@@ -105,8 +102,8 @@ static uint8_t USBD_DFU_EP0_RxReady(USBD_HandleTypeDef *pdev);
 static uint8_t USBD_DFU_EP0_TxReady(USBD_HandleTypeDef *pdev);
 static uint8_t USBD_DFU_SOF(USBD_HandleTypeDef *pdev);
 
-static uint8_t *USBD_DFU_GetCfgDesc(uint16_t *length);
-static uint8_t *USBD_DFU_GetDeviceQualifierDesc(uint16_t *length);
+static uint8_t *USBD_DFU_GetCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_DFU_GetDeviceQualifierDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
 
 #if (USBD_SUPPORT_USER_STRING_DESC == 1U)
 static uint8_t *USBD_DFU_GetUsrStringDesc(USBD_HandleTypeDef *pdev,
@@ -130,7 +127,7 @@ static void DFU_Leave(USBD_HandleTypeDef *pdev);
   * @{
   */
 
-static USBD_DFU_HandleTypeDef DFU_Instance;
+static USBD_DFU_HandleTypeDef DFU_Instance[USBD_MAX_NUM_DEV][USBD_DFU_MAX_INST];
 
 USBD_ClassTypeDef USBD_DFU =
     {
@@ -260,15 +257,15 @@ static uint8_t USBD_DFU_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   USBD_DFU_HandleTypeDef *hdfu;
 
   /* Allocate Audio structure */
-  hdfu = &DFU_Instance;
+  hdfu = &DFU_Instance[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)];
 
   if (hdfu == NULL)
   {
-    pdev->pClassData_DFU = NULL;
+    USBD_CLASS_DATA(pdev) = NULL;
     return (uint8_t)USBD_EMEM;
   }
 
-  pdev->pClassData_DFU = (void *)hdfu;
+  USBD_CLASS_DATA(pdev) = (void *)hdfu;
 
   hdfu->alt_setting = 0U;
   hdfu->data_ptr = USBD_DFU_APP_DEFAULT_ADD;
@@ -286,7 +283,7 @@ static uint8_t USBD_DFU_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   hdfu->dev_status[5] = 0U;
 
   /* Initialize Hardware layer */
-  if (((USBD_DFU_MediaTypeDef *)pdev->pUserData_DFU)->Init() != USBD_OK)
+  if (((USBD_DFU_MediaTypeDef *)USBD_USER_DATA(pdev))->Init() != USBD_OK)
   {
     return (uint8_t)USBD_FAIL;
   }
@@ -306,12 +303,12 @@ static uint8_t USBD_DFU_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   UNUSED(cfgidx);
   USBD_DFU_HandleTypeDef *hdfu;
 
-  if (pdev->pClassData_DFU == NULL)
+  if (USBD_CLASS_DATA(pdev) == NULL)
   {
     return (uint8_t)USBD_EMEM;
   }
 
-  hdfu = (USBD_DFU_HandleTypeDef *)pdev->pClassData_DFU;
+  hdfu = (USBD_DFU_HandleTypeDef *)USBD_CLASS_DATA(pdev);
   hdfu->wblock_num = 0U;
   hdfu->wlength = 0U;
 
@@ -320,11 +317,11 @@ static uint8_t USBD_DFU_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   hdfu->dev_status[4] = DFU_STATE_IDLE;
 
   /* DeInit  physical Interface components and Hardware Layer */
-  ((USBD_DFU_MediaTypeDef *)pdev->pUserData_DFU)->DeInit();
+  ((USBD_DFU_MediaTypeDef *)USBD_USER_DATA(pdev))->DeInit();
 #if (0)
-  USBD_free(pdev->pClassData_DFU);
+  USBD_free(USBD_CLASS_DATA(pdev));
 #endif
-  pdev->pClassData_DFU = NULL;
+  USBD_CLASS_DATA(pdev) = NULL;
 
   return (uint8_t)USBD_OK;
 }
@@ -338,7 +335,7 @@ static uint8_t USBD_DFU_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   */
 static uint8_t USBD_DFU_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
-  USBD_DFU_HandleTypeDef *hdfu = (USBD_DFU_HandleTypeDef *)pdev->pClassData_DFU;
+  USBD_DFU_HandleTypeDef *hdfu = (USBD_DFU_HandleTypeDef *)USBD_CLASS_DATA(pdev);
   USBD_StatusTypeDef ret = USBD_OK;
   uint8_t *pbuf = NULL;
   uint16_t len = 0U;
@@ -470,11 +467,14 @@ static uint8_t USBD_DFU_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *re
   * @brief  USBD_DFU_GetCfgDesc
   *         return configuration descriptor
   * @param  speed : current device speed
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_DFU_GetCfgDesc(uint16_t *length)
+static uint8_t *USBD_DFU_GetCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_DFU_CfgDesc);
 
   return USBD_DFU_CfgDesc;
@@ -502,8 +502,8 @@ static uint8_t USBD_DFU_EP0_TxReady(USBD_HandleTypeDef *pdev)
 {
   USBD_SetupReqTypedef req;
   uint32_t addr;
-  USBD_DFU_HandleTypeDef *hdfu = (USBD_DFU_HandleTypeDef *)pdev->pClassData_DFU;
-  USBD_DFU_MediaTypeDef *DfuInterface = (USBD_DFU_MediaTypeDef *)pdev->pUserData_DFU;
+  USBD_DFU_HandleTypeDef *hdfu = (USBD_DFU_HandleTypeDef *)USBD_CLASS_DATA(pdev);
+  USBD_DFU_MediaTypeDef *DfuInterface = (USBD_DFU_MediaTypeDef *)USBD_USER_DATA(pdev);
 
   if (hdfu == NULL)
   {
@@ -615,11 +615,14 @@ static uint8_t USBD_DFU_SOF(USBD_HandleTypeDef *pdev)
 /**
   * @brief  DeviceQualifierDescriptor
   *         return Device Qualifier descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_DFU_GetDeviceQualifierDesc(uint16_t *length)
+static uint8_t *USBD_DFU_GetDeviceQualifierDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_DFU_DeviceQualifierDesc);
 
   return USBD_DFU_DeviceQualifierDesc;
@@ -637,7 +640,7 @@ static uint8_t *USBD_DFU_GetDeviceQualifierDesc(uint16_t *length)
 static uint8_t *USBD_DFU_GetUsrStringDesc(USBD_HandleTypeDef *pdev, uint8_t index, uint16_t *length)
 {
   static uint8_t USBD_StrDesc[255];
-  USBD_DFU_MediaTypeDef *DfuInterface = (USBD_DFU_MediaTypeDef *)pdev->pUserData_DFU;
+  USBD_DFU_MediaTypeDef *DfuInterface = (USBD_DFU_MediaTypeDef *)USBD_USER_DATA(pdev);
 
   /* Check if the requested string interface is supported */
   if (index <= (USBD_IDX_INTERFACE_STR + USBD_DFU_MAX_ITF_NUM))
@@ -661,12 +664,17 @@ static uint8_t *USBD_DFU_GetUsrStringDesc(USBD_HandleTypeDef *pdev, uint8_t inde
 uint8_t USBD_DFU_RegisterMedia(USBD_HandleTypeDef *pdev,
                                USBD_DFU_MediaTypeDef *fops)
 {
+  if (USBD_CoreFindClass(pdev, &USBD_DFU) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
   if (fops == NULL)
   {
     return (uint8_t)USBD_FAIL;
   }
 
-  pdev->pUserData_DFU = fops;
+  USBD_USER_DATA(pdev) = fops;
 
   return (uint8_t)USBD_OK;
 }
@@ -683,7 +691,7 @@ uint8_t USBD_DFU_RegisterMedia(USBD_HandleTypeDef *pdev,
   */
 static void DFU_Detach(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
-  USBD_DFU_HandleTypeDef *hdfu = (USBD_DFU_HandleTypeDef *)pdev->pClassData_DFU;
+  USBD_DFU_HandleTypeDef *hdfu = (USBD_DFU_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hdfu == NULL)
   {
@@ -731,7 +739,7 @@ static void DFU_Detach(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
   */
 static void DFU_Download(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
-  USBD_DFU_HandleTypeDef *hdfu = (USBD_DFU_HandleTypeDef *)pdev->pClassData_DFU;
+  USBD_DFU_HandleTypeDef *hdfu = (USBD_DFU_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hdfu == NULL)
   {
@@ -791,8 +799,8 @@ static void DFU_Download(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
   */
 static void DFU_Upload(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
-  USBD_DFU_HandleTypeDef *hdfu = (USBD_DFU_HandleTypeDef *)pdev->pClassData_DFU;
-  USBD_DFU_MediaTypeDef *DfuInterface = (USBD_DFU_MediaTypeDef *)pdev->pUserData_DFU;
+  USBD_DFU_HandleTypeDef *hdfu = (USBD_DFU_HandleTypeDef *)USBD_CLASS_DATA(pdev);
+  USBD_DFU_MediaTypeDef *DfuInterface = (USBD_DFU_MediaTypeDef *)USBD_USER_DATA(pdev);
   uint8_t *phaddr;
   uint32_t addr;
 
@@ -889,8 +897,8 @@ static void DFU_Upload(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
   */
 static void DFU_GetStatus(USBD_HandleTypeDef *pdev)
 {
-  USBD_DFU_HandleTypeDef *hdfu = (USBD_DFU_HandleTypeDef *)pdev->pClassData_DFU;
-  USBD_DFU_MediaTypeDef *DfuInterface = (USBD_DFU_MediaTypeDef *)pdev->pUserData_DFU;
+  USBD_DFU_HandleTypeDef *hdfu = (USBD_DFU_HandleTypeDef *)USBD_CLASS_DATA(pdev);
+  USBD_DFU_MediaTypeDef *DfuInterface = (USBD_DFU_MediaTypeDef *)USBD_USER_DATA(pdev);
 
   if (hdfu == NULL)
   {
@@ -970,7 +978,7 @@ static void DFU_GetStatus(USBD_HandleTypeDef *pdev)
   */
 static void DFU_ClearStatus(USBD_HandleTypeDef *pdev)
 {
-  USBD_DFU_HandleTypeDef *hdfu = (USBD_DFU_HandleTypeDef *)pdev->pClassData_DFU;
+  USBD_DFU_HandleTypeDef *hdfu = (USBD_DFU_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hdfu == NULL)
   {
@@ -1008,7 +1016,7 @@ static void DFU_ClearStatus(USBD_HandleTypeDef *pdev)
   */
 static void DFU_GetState(USBD_HandleTypeDef *pdev)
 {
-  USBD_DFU_HandleTypeDef *hdfu = (USBD_DFU_HandleTypeDef *)pdev->pClassData_DFU;
+  USBD_DFU_HandleTypeDef *hdfu = (USBD_DFU_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hdfu == NULL)
   {
@@ -1027,7 +1035,7 @@ static void DFU_GetState(USBD_HandleTypeDef *pdev)
   */
 static void DFU_Abort(USBD_HandleTypeDef *pdev)
 {
-  USBD_DFU_HandleTypeDef *hdfu = (USBD_DFU_HandleTypeDef *)pdev->pClassData_DFU;
+  USBD_DFU_HandleTypeDef *hdfu = (USBD_DFU_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hdfu == NULL)
   {
@@ -1061,7 +1069,7 @@ static void DFU_Abort(USBD_HandleTypeDef *pdev)
   */
 static void DFU_Leave(USBD_HandleTypeDef *pdev)
 {
-  USBD_DFU_HandleTypeDef *hdfu = (USBD_DFU_HandleTypeDef *)pdev->pClassData_DFU;
+  USBD_DFU_HandleTypeDef *hdfu = (USBD_DFU_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hdfu == NULL)
   {
@@ -1099,7 +1107,7 @@ static void DFU_Leave(USBD_HandleTypeDef *pdev)
   }
 }
 
-void USBD_Update_DFU_DESC(uint8_t *desc, uint8_t itf_no, uint8_t str_idx)
+void USBD_Update_DFU_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no, uint8_t str_idx)
 {
   desc[11] = itf_no;
   desc[17] = str_idx;
@@ -1124,8 +1132,9 @@ void USBD_Update_DFU_DESC(uint8_t *desc, uint8_t itf_no, uint8_t str_idx)
   desc[56] = itf_no;
 #endif /* (USBD_DFU_MAX_ITF_NUM > 5) */
 
-  DFU_ITF_NBR = itf_no;
-  DFU_STR_DESC_IDX = str_idx;
+  USBD_CLASS_MAP(pdev).itf_nbr = itf_no;
+  USBD_CLASS_MAP(pdev).itf_num = 1U;
+  USBD_CLASS_MAP(pdev).str_idx = str_idx;
 }
 
 /**
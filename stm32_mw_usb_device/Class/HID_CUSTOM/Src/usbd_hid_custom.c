@@ -51,11 +51,6 @@ EndBSPDependencies */
 #define _CUSTOM_HID_ITF_NBR 0x00U
 #define _CUSTOM_HID_STR_DESC_IDX 0x00U
 
-uint8_t CUSTOM_HID_IN_EP = _CUSTOM_HID_IN_EP;
-uint8_t CUSTOM_HID_OUT_EP = _CUSTOM_HID_OUT_EP;
-uint8_t CUSTOM_HID_ITF_NBR = _CUSTOM_HID_ITF_NBR;
-uint8_t CUSTOM_HID_STR_DESC_IDX = _CUSTOM_HID_STR_DESC_IDX;
-
 /** @addtogroup STM32_USB_DEVICE_LIBRARY
   * @{
   */
@@ -98,10 +93,15 @@ static uint8_t USBD_CUSTOM_HID_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum);
 static uint8_t USBD_CUSTOM_HID_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum);
 static uint8_t USBD_CUSTOM_HID_EP0_RxReady(USBD_HandleTypeDef *pdev);
 
-static uint8_t *USBD_CUSTOM_HID_GetFSCfgDesc(uint16_t *length);
-static uint8_t *USBD_CUSTOM_HID_GetHSCfgDesc(uint16_t *length);
-static uint8_t *USBD_CUSTOM_HID_GetOtherSpeedCfgDesc(uint16_t *length);
-static uint8_t *USBD_CUSTOM_HID_GetDeviceQualifierDesc(uint16_t *length);
+static uint8_t *USBD_CUSTOM_HID_GetFSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_CUSTOM_HID_GetHSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_CUSTOM_HID_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_CUSTOM_HID_GetDeviceQualifierDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+
+#if (USBD_USE_OS == 1U)
+static uint8_t USBD_CUSTOM_HID_OS_Claim(void *arg);
+static uint8_t USBD_CUSTOM_HID_OS_IsIdle(void *arg);
+#endif /* (USBD_USE_OS == 1U) */
 
 /**
   * @}
@@ -111,7 +111,7 @@ static uint8_t *USBD_CUSTOM_HID_GetDeviceQualifierDesc(uint16_t *length);
   * @{
   */
 
-static USBD_CUSTOM_HID_HandleTypeDef CUSTOM_HID_Instance;
+static USBD_CUSTOM_HID_HandleTypeDef CUSTOM_HID_Instance[USBD_MAX_NUM_DEV][USBD_CUSTOM_HID_MAX_INST];
 
 USBD_ClassTypeDef USBD_HID_CUSTOM =
     {
@@ -362,46 +362,52 @@ static uint8_t USBD_CUSTOM_HID_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   UNUSED(cfgidx);
   USBD_CUSTOM_HID_HandleTypeDef *hhid;
 
-  hhid = &CUSTOM_HID_Instance;
+  hhid = &CUSTOM_HID_Instance[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)];
 
   if (hhid == NULL)
   {
-    pdev->pClassData_HID_Custom = NULL;
+    USBD_CLASS_DATA(pdev) = NULL;
     return (uint8_t)USBD_EMEM;
   }
 
-  pdev->pClassData_HID_Custom = (void *)hhid;
+  USBD_CLASS_DATA(pdev) = (void *)hhid;
 
   if (pdev->dev_speed == USBD_SPEED_HIGH)
   {
-    pdev->ep_in[CUSTOM_HID_IN_EP & 0xFU].bInterval = CUSTOM_HID_HS_BINTERVAL;
-    pdev->ep_out[CUSTOM_HID_OUT_EP & 0xFU].bInterval = CUSTOM_HID_HS_BINTERVAL;
+    pdev->ep_in[CUSTOM_HID_IN_EP(pdev) & 0xFU].bInterval = CUSTOM_HID_HS_BINTERVAL;
+    pdev->ep_out[CUSTOM_HID_OUT_EP(pdev) & 0xFU].bInterval = CUSTOM_HID_HS_BINTERVAL;
   }
   else /* LOW and FULL-speed endpoints */
   {
-    pdev->ep_in[CUSTOM_HID_IN_EP & 0xFU].bInterval = CUSTOM_HID_FS_BINTERVAL;
-    pdev->ep_out[CUSTOM_HID_OUT_EP & 0xFU].bInterval = CUSTOM_HID_FS_BINTERVAL;
+    pdev->ep_in[CUSTOM_HID_IN_EP(pdev) & 0xFU].bInterval = CUSTOM_HID_FS_BINTERVAL;
+    pdev->ep_out[CUSTOM_HID_OUT_EP(pdev) & 0xFU].bInterval = CUSTOM_HID_FS_BINTERVAL;
   }
 
   /* Open EP IN */
-  (void)USBD_LL_OpenEP(pdev, CUSTOM_HID_IN_EP, USBD_EP_TYPE_INTR,
+  (void)USBD_LL_OpenEP(pdev, CUSTOM_HID_IN_EP(pdev), USBD_EP_TYPE_INTR,
                        CUSTOM_HID_EPIN_SIZE);
 
-  pdev->ep_in[CUSTOM_HID_IN_EP & 0xFU].is_used = 1U;
+  pdev->ep_in[CUSTOM_HID_IN_EP(pdev) & 0xFU].is_used = 1U;
 
-  /* Open EP OUT */
-  (void)USBD_LL_OpenEP(pdev, CUSTOM_HID_OUT_EP, USBD_EP_TYPE_INTR,
-                       CUSTOM_HID_EPOUT_SIZE);
+  /* Open EP OUT, without it OUT reports come with SET_REPORT on EP0 */
+  if (CUSTOM_HID_OUT_EP(pdev) != 0U)
+  {
+    (void)USBD_LL_OpenEP(pdev, CUSTOM_HID_OUT_EP(pdev), USBD_EP_TYPE_INTR,
+                         CUSTOM_HID_EPOUT_SIZE);
 
-  pdev->ep_out[CUSTOM_HID_OUT_EP & 0xFU].is_used = 1U;
+    pdev->ep_out[CUSTOM_HID_OUT_EP(pdev) & 0xFU].is_used = 1U;
+  }
 
   hhid->state = CUSTOM_HID_IDLE;
 
-  ((USBD_CUSTOM_HID_ItfTypeDef *)pdev->pUserData_HID_Custom)->Init();
+  ((USBD_CUSTOM_HID_ItfTypeDef *)USBD_USER_DATA(pdev))->Init();
 
   /* Prepare Out endpoint to receive 1st packet */
-  (void)USBD_LL_PrepareReceive(pdev, CUSTOM_HID_OUT_EP, hhid->Report_buf,
-                               USBD_CUSTOMHID_OUTREPORT_BUF_SIZE);
+  if (CUSTOM_HID_OUT_EP(pdev) != 0U)
+  {
+    (void)USBD_LL_PrepareReceive(pdev, CUSTOM_HID_OUT_EP(pdev), hhid->Report_buf,
+                                 USBD_CUSTOMHID_OUTREPORT_BUF_SIZE);
+  }
 
   return (uint8_t)USBD_OK;
 }
@@ -418,23 +424,26 @@ static uint8_t USBD_CUSTOM_HID_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   UNUSED(cfgidx);
 
   /* Close CUSTOM_HID EP IN */
-  (void)USBD_LL_CloseEP(pdev, CUSTOM_HID_IN_EP);
-  pdev->ep_in[CUSTOM_HID_IN_EP & 0xFU].is_used = 0U;
-  pdev->ep_in[CUSTOM_HID_IN_EP & 0xFU].bInterval = 0U;
+  (void)USBD_LL_CloseEP(pdev, CUSTOM_HID_IN_EP(pdev));
+  pdev->ep_in[CUSTOM_HID_IN_EP(pdev) & 0xFU].is_used = 0U;
+  pdev->ep_in[CUSTOM_HID_IN_EP(pdev) & 0xFU].bInterval = 0U;
 
   /* Close CUSTOM_HID EP OUT */
-  (void)USBD_LL_CloseEP(pdev, CUSTOM_HID_OUT_EP);
-  pdev->ep_out[CUSTOM_HID_OUT_EP & 0xFU].is_used = 0U;
-  pdev->ep_out[CUSTOM_HID_OUT_EP & 0xFU].bInterval = 0U;
+  if (CUSTOM_HID_OUT_EP(pdev) != 0U)
+  {
+    (void)USBD_LL_CloseEP(pdev, CUSTOM_HID_OUT_EP(pdev));
+    pdev->ep_out[CUSTOM_HID_OUT_EP(pdev) & 0xFU].is_used = 0U;
+    pdev->ep_out[CUSTOM_HID_OUT_EP(pdev) & 0xFU].bInterval = 0U;
+  }
 
   /* Free allocated memory */
-  if (pdev->pClassData_HID_Custom != NULL)
+  if (USBD_CLASS_DATA(pdev) != NULL)
   {
-    ((USBD_CUSTOM_HID_ItfTypeDef *)pdev->pUserData_HID_Custom)->DeInit();
+    ((USBD_CUSTOM_HID_ItfTypeDef *)USBD_USER_DATA(pdev))->DeInit();
 #if (0)
-    USBD_free(pdev->pClassData_HID_Custom);
+    USBD_free(USBD_CLASS_DATA(pdev));
 #endif
-    pdev->pClassData_HID_Custom = NULL;
+    USBD_CLASS_DATA(pdev) = NULL;
   }
 
   return (uint8_t)USBD_OK;
@@ -450,7 +459,7 @@ static uint8_t USBD_CUSTOM_HID_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
 static uint8_t USBD_CUSTOM_HID_Setup(USBD_HandleTypeDef *pdev,
                                      USBD_SetupReqTypedef *req)
 {
-  USBD_CUSTOM_HID_HandleTypeDef *hhid = (USBD_CUSTOM_HID_HandleTypeDef *)pdev->pClassData_HID_Custom;
+  USBD_CUSTOM_HID_HandleTypeDef *hhid = (USBD_CUSTOM_HID_HandleTypeDef *)USBD_CLASS_DATA(pdev);
   uint16_t len = 0U;
   uint8_t *pbuf = NULL;
   uint16_t status_info = 0U;
@@ -513,7 +522,7 @@ static uint8_t USBD_CUSTOM_HID_Setup(USBD_HandleTypeDef *pdev,
       if ((req->wValue >> 8) == CUSTOM_HID_REPORT_DESC)
       {
         len = MIN(USBD_CUSTOM_HID_REPORT_DESC_SIZE, req->wLength);
-        pbuf = ((USBD_CUSTOM_HID_ItfTypeDef *)pdev->pUserData_HID_Custom)->pReport;
+        pbuf = ((USBD_CUSTOM_HID_ItfTypeDef *)USBD_USER_DATA(pdev))->pReport;
       }
       else
       {
@@ -581,19 +590,28 @@ uint8_t USBD_CUSTOM_HID_SendReport(USBD_HandleTypeDef *pdev,
 {
   USBD_CUSTOM_HID_HandleTypeDef *hhid;
 
-  if (pdev->pClassData_HID_Custom == NULL)
+  if (USBD_CoreFindClass(pdev, &USBD_HID_CUSTOM) != USBD_OK)
   {
     return (uint8_t)USBD_FAIL;
   }
 
-  hhid = (USBD_CUSTOM_HID_HandleTypeDef *)pdev->pClassData_HID_Custom;
+  if (USBD_CLASS_DATA(pdev) == NULL)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  hhid = (USBD_CUSTOM_HID_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (pdev->dev_state == USBD_STATE_CONFIGURED)
   {
     if (hhid->state == CUSTOM_HID_IDLE)
     {
       hhid->state = CUSTOM_HID_BUSY;
-      (void)USBD_LL_Transmit(pdev, CUSTOM_HID_IN_EP, report, len);
+#if (USBD_LPM_ENABLED == 1U)
+      /* Hold off LPM L1 until the host has polled the report */
+      (void)USBD_LPM_Veto(pdev, 1U);
+#endif /* (USBD_LPM_ENABLED == 1U) */
+      (void)USBD_LL_Transmit(pdev, CUSTOM_HID_IN_EP(pdev), report, len);
     }
     else
     {
@@ -603,15 +621,111 @@ uint8_t USBD_CUSTOM_HID_SendReport(USBD_HandleTypeDef *pdev,
   return (uint8_t)USBD_OK;
 }
 
+#if (USBD_USE_OS == 1U)
+/**
+  * @brief  USBD_CUSTOM_HID_SendReportWait
+  *         Send a report, blocking until the previous one is sent and then
+  *         until the host has polled this one, report may live on the stack
+  * @param  pdev: device instance
+  * @param  report: pointer to report
+  * @param  len: report length
+  * @param  timeout: kernel ticks to wait, osWaitForever allowed
+  * @retval status: USBD_BUSY on timeout
+  */
+uint8_t USBD_CUSTOM_HID_SendReportWait(USBD_HandleTypeDef *pdev, uint8_t *report, uint16_t len,
+                                       uint32_t timeout)
+{
+  USBD_CUSTOM_HID_HandleTypeDef *hhid;
+  uint8_t ep_addr;
+  USBD_StatusTypeDef ret;
+
+  if (USBD_CoreFindClass(pdev, &USBD_HID_CUSTOM) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  hhid = (USBD_CUSTOM_HID_HandleTypeDef *)USBD_CLASS_DATA(pdev);
+
+  if (hhid == NULL)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  if (pdev->dev_state != USBD_STATE_CONFIGURED)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  /* The selected instance may change while the task sleeps */
+  ep_addr = CUSTOM_HID_IN_EP(pdev);
+
+  ret = USBD_OS_Wait(pdev, ep_addr, USBD_CUSTOM_HID_OS_Claim, hhid, &timeout);
+
+  if (ret != USBD_OK)
+  {
+    return (uint8_t)ret;
+  }
+
+#if (USBD_LPM_ENABLED == 1U)
+  /* Hold off LPM L1 until the host has polled the report, the veto is
+     taken for this class so select it again after the wait */
+  (void)USBD_CoreFindClass(pdev, &USBD_HID_CUSTOM);
+  (void)USBD_LPM_Veto(pdev, 1U);
+#endif /* (USBD_LPM_ENABLED == 1U) */
+  (void)USBD_LL_Transmit(pdev, ep_addr, report, len);
+
+  return (uint8_t)USBD_OS_Wait(pdev, ep_addr, USBD_CUSTOM_HID_OS_IsIdle, hhid, &timeout);
+}
+
+/**
+  * @brief  USBD_CUSTOM_HID_OS_Claim
+  *         Wake-up condition of USBD_CUSTOM_HID_SendReportWait, takes the IN endpoint
+  * @param  arg: class handle
+  * @retval 1 once the endpoint is taken
+  */
+static uint8_t USBD_CUSTOM_HID_OS_Claim(void *arg)
+{
+  USBD_CUSTOM_HID_HandleTypeDef *hhid = (USBD_CUSTOM_HID_HandleTypeDef *)arg;
+  uint32_t primask;
+  uint8_t claimed = 0U;
+
+  USBD_ENTER_CRITICAL(primask);
+
+  if (hhid->state == CUSTOM_HID_IDLE)
+  {
+    hhid->state = CUSTOM_HID_BUSY;
+    claimed = 1U;
+  }
+
+  USBD_EXIT_CRITICAL(primask);
+
+  return claimed;
+}
+
+/**
+  * @brief  USBD_CUSTOM_HID_OS_IsIdle
+  *         Wake-up condition of USBD_CUSTOM_HID_SendReportWait, the report is sent
+  * @param  arg: class handle
+  * @retval 1 once the IN endpoint is idle
+  */
+static uint8_t USBD_CUSTOM_HID_OS_IsIdle(void *arg)
+{
+  return (((USBD_CUSTOM_HID_HandleTypeDef *)arg)->state == CUSTOM_HID_IDLE) ? 1U : 0U;
+}
+#endif /* (USBD_USE_OS == 1U) */
+
 /**
   * @brief  USBD_CUSTOM_HID_GetFSCfgDesc
   *         return FS configuration descriptor
   * @param  speed : current device speed
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_CUSTOM_HID_GetFSCfgDesc(uint16_t *length)
+static uint8_t *USBD_CUSTOM_HID_GetFSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_CUSTOM_HID_CfgFSDesc);
 
   return USBD_CUSTOM_HID_CfgFSDesc;
@@ -621,11 +735,14 @@ static uint8_t *USBD_CUSTOM_HID_GetFSCfgDesc(uint16_t *length)
   * @brief  USBD_CUSTOM_HID_GetHSCfgDesc
   *         return HS configuration descriptor
   * @param  speed : current device speed
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_CUSTOM_HID_GetHSCfgDesc(uint16_t *length)
+static uint8_t *USBD_CUSTOM_HID_GetHSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_CUSTOM_HID_CfgHSDesc);
 
   return USBD_CUSTOM_HID_CfgHSDesc;
@@ -635,11 +752,14 @@ static uint8_t *USBD_CUSTOM_HID_GetHSCfgDesc(uint16_t *length)
   * @brief  USBD_CUSTOM_HID_GetOtherSpeedCfgDesc
   *         return other speed configuration descriptor
   * @param  speed : current device speed
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_CUSTOM_HID_GetOtherSpeedCfgDesc(uint16_t *length)
+static uint8_t *USBD_CUSTOM_HID_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_CUSTOM_HID_OtherSpeedCfgDesc);
 
   return USBD_CUSTOM_HID_OtherSpeedCfgDesc;
@@ -658,7 +778,10 @@ static uint8_t USBD_CUSTOM_HID_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
 
   /* Ensure that the FIFO is empty before a new transfer, this condition could
   be caused by  a new transfer before the end of the previous transfer */
-  ((USBD_CUSTOM_HID_HandleTypeDef *)pdev->pClassData_HID_Custom)->state = CUSTOM_HID_IDLE;
+  ((USBD_CUSTOM_HID_HandleTypeDef *)USBD_CLASS_DATA(pdev))->state = CUSTOM_HID_IDLE;
+#if (USBD_LPM_ENABLED == 1U)
+  (void)USBD_LPM_Veto(pdev, 0U);
+#endif /* (USBD_LPM_ENABLED == 1U) */
 
   return (uint8_t)USBD_OK;
 }
@@ -675,16 +798,16 @@ static uint8_t USBD_CUSTOM_HID_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
   UNUSED(epnum);
   USBD_CUSTOM_HID_HandleTypeDef *hhid;
 
-  if (pdev->pClassData_HID_Custom == NULL)
+  if (USBD_CLASS_DATA(pdev) == NULL)
   {
     return (uint8_t)USBD_FAIL;
   }
 
-  hhid = (USBD_CUSTOM_HID_HandleTypeDef *)pdev->pClassData_HID_Custom;
+  hhid = (USBD_CUSTOM_HID_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   /* USB data will be immediately processed, this allow next USB traffic being
   NAKed till the end of the application processing */
-  ((USBD_CUSTOM_HID_ItfTypeDef *)pdev->pUserData_HID_Custom)->OutEvent(hhid->Report_buf[0], hhid->Report_buf[1]);
+  ((USBD_CUSTOM_HID_ItfTypeDef *)USBD_USER_DATA(pdev))->OutEvent(hhid->Report_buf[0], hhid->Report_buf[1]);
 
   return (uint8_t)USBD_OK;
 }
@@ -699,15 +822,26 @@ uint8_t USBD_CUSTOM_HID_ReceivePacket(USBD_HandleTypeDef *pdev)
 {
   USBD_CUSTOM_HID_HandleTypeDef *hhid;
 
-  if (pdev->pClassData_HID_Custom == NULL)
+  if (USBD_CoreFindClass(pdev, &USBD_HID_CUSTOM) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  if (USBD_CLASS_DATA(pdev) == NULL)
   {
     return (uint8_t)USBD_FAIL;
   }
 
-  hhid = (USBD_CUSTOM_HID_HandleTypeDef *)pdev->pClassData_HID_Custom;
+  hhid = (USBD_CUSTOM_HID_HandleTypeDef *)USBD_CLASS_DATA(pdev);
+
+  /* Nothing to resume when OUT reports come on EP0 */
+  if (CUSTOM_HID_OUT_EP(pdev) == 0U)
+  {
+    return (uint8_t)USBD_OK;
+  }
 
   /* Resume USB Out process */
-  (void)USBD_LL_PrepareReceive(pdev, CUSTOM_HID_OUT_EP, hhid->Report_buf,
+  (void)USBD_LL_PrepareReceive(pdev, CUSTOM_HID_OUT_EP(pdev), hhid->Report_buf,
                                USBD_CUSTOMHID_OUTREPORT_BUF_SIZE);
 
   return (uint8_t)USBD_OK;
@@ -721,7 +855,7 @@ uint8_t USBD_CUSTOM_HID_ReceivePacket(USBD_HandleTypeDef *pdev)
   */
 static uint8_t USBD_CUSTOM_HID_EP0_RxReady(USBD_HandleTypeDef *pdev)
 {
-  USBD_CUSTOM_HID_HandleTypeDef *hhid = (USBD_CUSTOM_HID_HandleTypeDef *)pdev->pClassData_HID_Custom;
+  USBD_CUSTOM_HID_HandleTypeDef *hhid = (USBD_CUSTOM_HID_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hhid == NULL)
   {
@@ -730,7 +864,7 @@ static uint8_t USBD_CUSTOM_HID_EP0_RxReady(USBD_HandleTypeDef *pdev)
 
   if (hhid->IsReportAvailable == 1U)
   {
-    ((USBD_CUSTOM_HID_ItfTypeDef *)pdev->pUserData_HID_Custom)->OutEvent(hhid->Report_buf[0], hhid->Report_buf[1]);
+    ((USBD_CUSTOM_HID_ItfTypeDef *)USBD_USER_DATA(pdev))->OutEvent(hhid->Report_buf[0], hhid->Report_buf[1]);
     hhid->IsReportAvailable = 0U;
   }
 
@@ -740,11 +874,14 @@ static uint8_t USBD_CUSTOM_HID_EP0_RxReady(USBD_HandleTypeDef *pdev)
 /**
   * @brief  DeviceQualifierDescriptor
   *         return Device Qualifier descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_CUSTOM_HID_GetDeviceQualifierDesc(uint16_t *length)
+static uint8_t *USBD_CUSTOM_HID_GetDeviceQualifierDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_CUSTOM_HID_DeviceQualifierDesc);
 
   return USBD_CUSTOM_HID_DeviceQualifierDesc;
@@ -759,27 +896,33 @@ static uint8_t *USBD_CUSTOM_HID_GetDeviceQualifierDesc(uint16_t *length)
 uint8_t USBD_CUSTOM_HID_RegisterInterface(USBD_HandleTypeDef *pdev,
                                           USBD_CUSTOM_HID_ItfTypeDef *fops)
 {
+  if (USBD_CoreFindClass(pdev, &USBD_HID_CUSTOM) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
   if (fops == NULL)
   {
     return (uint8_t)USBD_FAIL;
   }
 
-  pdev->pUserData_HID_Custom = fops;
+  USBD_USER_DATA(pdev) = fops;
 
   return (uint8_t)USBD_OK;
 }
 
-void USBD_Update_HID_Custom_DESC(uint8_t *desc, uint8_t itf_no, uint8_t in_ep, uint8_t out_ep, uint8_t str_idx)
+void USBD_Update_HID_Custom_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no, uint8_t in_ep, uint8_t out_ep, uint8_t str_idx)
 {
   desc[11] = itf_no;
   desc[17] = str_idx;
   desc[29] = in_ep;
   desc[36] = out_ep;
 
-  CUSTOM_HID_IN_EP = in_ep;
-  CUSTOM_HID_OUT_EP = out_ep;
-  CUSTOM_HID_ITF_NBR = itf_no;
-  CUSTOM_HID_STR_DESC_IDX = str_idx;
+  USBD_CLASS_MAP(pdev).in_ep = in_ep;
+  USBD_CLASS_MAP(pdev).out_ep = out_ep;
+  USBD_CLASS_MAP(pdev).itf_nbr = itf_no;
+  USBD_CLASS_MAP(pdev).itf_num = 1U;
+  USBD_CLASS_MAP(pdev).str_idx = str_idx;
 }
 
 /**
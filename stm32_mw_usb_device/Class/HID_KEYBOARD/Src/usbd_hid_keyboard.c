@@ -50,10 +50,6 @@ EndBSPDependencies */
 #define _HID_KEYBOARD_ITF_NBR 0x00
 #define _HID_KEYBOARD_STR_DESC_IDX 0x00U
 
-uint8_t HID_KEYBOARD_IN_EP = _HID_KEYBOARD_IN_EP;
-uint8_t HID_KEYBOARD_ITF_NBR = _HID_KEYBOARD_ITF_NBR;
-uint8_t HID_KEYBOARD_STR_DESC_IDX = _HID_KEYBOARD_STR_DESC_IDX;
-
 /** @addtogroup STM32_USB_DEVICE_LIBRARY
   * @{
   */
@@ -94,10 +90,15 @@ static uint8_t USBD_HID_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
 static uint8_t USBD_HID_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
 static uint8_t USBD_HID_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum);
 
-static uint8_t *USBD_HID_GetFSCfgDesc(uint16_t *length);
-static uint8_t *USBD_HID_GetHSCfgDesc(uint16_t *length);
-static uint8_t *USBD_HID_GetOtherSpeedCfgDesc(uint16_t *length);
-static uint8_t *USBD_HID_GetDeviceQualifierDesc(uint16_t *length);
+static uint8_t *USBD_HID_GetFSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_HID_GetHSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_HID_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_HID_GetDeviceQualifierDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+
+#if (USBD_USE_OS == 1U)
+static uint8_t USBD_HID_Keyboard_OS_Claim(void *arg);
+static uint8_t USBD_HID_Keyboard_OS_IsIdle(void *arg);
+#endif /* (USBD_USE_OS == 1U) */
 
 /**
   * @}
@@ -107,7 +108,7 @@ static uint8_t *USBD_HID_GetDeviceQualifierDesc(uint16_t *length);
   * @{
   */
 
-static USBD_HID_Keyboard_HandleTypeDef USBD_HID_KBD_Instace;
+static USBD_HID_Keyboard_HandleTypeDef USBD_HID_KBD_Instace[USBD_MAX_NUM_DEV][USBD_HID_KEYBOARD_MAX_INST];
 
 USBD_ClassTypeDef USBD_HID_KEYBOARD =
     {
@@ -378,28 +379,28 @@ static uint8_t USBD_HID_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
 
   USBD_HID_Keyboard_HandleTypeDef *hhid;
 
-  hhid = &USBD_HID_KBD_Instace;
+  hhid = &USBD_HID_KBD_Instace[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)];
 
   if (hhid == NULL)
   {
-    pdev->pClassData_HID_Keyboard = NULL;
+    USBD_CLASS_DATA(pdev) = NULL;
     return (uint8_t)USBD_EMEM;
   }
 
-  pdev->pClassData_HID_Keyboard = (void *)hhid;
+  USBD_CLASS_DATA(pdev) = (void *)hhid;
 
   if (pdev->dev_speed == USBD_SPEED_HIGH)
   {
-    pdev->ep_in[HID_KEYBOARD_IN_EP & 0xFU].bInterval = HID_KEYBOARD_HS_BINTERVAL;
+    pdev->ep_in[HID_KEYBOARD_IN_EP(pdev) & 0xFU].bInterval = HID_KEYBOARD_HS_BINTERVAL;
   }
   else /* LOW and FULL-speed endpoints */
   {
-    pdev->ep_in[HID_KEYBOARD_IN_EP & 0xFU].bInterval = HID_KEYBOARD_FS_BINTERVAL;
+    pdev->ep_in[HID_KEYBOARD_IN_EP(pdev) & 0xFU].bInterval = HID_KEYBOARD_FS_BINTERVAL;
   }
 
   /* Open EP IN */
-  (void)USBD_LL_OpenEP(pdev, HID_KEYBOARD_IN_EP, USBD_EP_TYPE_INTR, HID_KEYBOARD_EPIN_SIZE);
-  pdev->ep_in[HID_KEYBOARD_IN_EP & 0xFU].is_used = 1U;
+  (void)USBD_LL_OpenEP(pdev, HID_KEYBOARD_IN_EP(pdev), USBD_EP_TYPE_INTR, HID_KEYBOARD_EPIN_SIZE);
+  pdev->ep_in[HID_KEYBOARD_IN_EP(pdev) & 0xFU].is_used = 1U;
 
   hhid->state = KEYBOARD_HID_IDLE;
 
@@ -418,17 +419,17 @@ static uint8_t USBD_HID_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   UNUSED(cfgidx);
 
   /* Close HID EPs */
-  (void)USBD_LL_CloseEP(pdev, HID_KEYBOARD_IN_EP);
-  pdev->ep_in[HID_KEYBOARD_IN_EP & 0xFU].is_used = 0U;
-  pdev->ep_in[HID_KEYBOARD_IN_EP & 0xFU].bInterval = 0U;
+  (void)USBD_LL_CloseEP(pdev, HID_KEYBOARD_IN_EP(pdev));
+  pdev->ep_in[HID_KEYBOARD_IN_EP(pdev) & 0xFU].is_used = 0U;
+  pdev->ep_in[HID_KEYBOARD_IN_EP(pdev) & 0xFU].bInterval = 0U;
 
   /* Free allocated memory */
-  if (pdev->pClassData_HID_Keyboard != NULL)
+  if (USBD_CLASS_DATA(pdev) != NULL)
   {
 #if (0)
-    (void)USBD_free(pdev->pClassData_HID_Keyboard);
+    (void)USBD_free(USBD_CLASS_DATA(pdev));
 #endif
-    pdev->pClassData_HID_Keyboard = NULL;
+    USBD_CLASS_DATA(pdev) = NULL;
   }
 
   return (uint8_t)USBD_OK;
@@ -443,7 +444,7 @@ static uint8_t USBD_HID_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   */
 static uint8_t USBD_HID_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
-  USBD_HID_Keyboard_HandleTypeDef *hhid = (USBD_HID_Keyboard_HandleTypeDef *)pdev->pClassData_HID_Keyboard;
+  USBD_HID_Keyboard_HandleTypeDef *hhid = (USBD_HID_Keyboard_HandleTypeDef *)USBD_CLASS_DATA(pdev);
   USBD_StatusTypeDef ret = USBD_OK;
   uint16_t len;
   uint8_t *pbuf;
@@ -563,11 +564,14 @@ static uint8_t USBD_HID_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *re
   * @brief  USBD_HID_GetCfgFSDesc
   *         return FS configuration descriptor
   * @param  speed : current device speed
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_HID_GetFSCfgDesc(uint16_t *length)
+static uint8_t *USBD_HID_GetFSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_HID_KEYBOARD_CfgFSDesc);
 
   return USBD_HID_KEYBOARD_CfgFSDesc;
@@ -577,11 +581,14 @@ static uint8_t *USBD_HID_GetFSCfgDesc(uint16_t *length)
   * @brief  USBD_HID_GetCfgHSDesc
   *         return HS configuration descriptor
   * @param  speed : current device speed
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_HID_GetHSCfgDesc(uint16_t *length)
+static uint8_t *USBD_HID_GetHSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_HID_KEYBOARD_CfgHSDesc);
 
   return USBD_HID_KEYBOARD_CfgHSDesc;
@@ -591,11 +598,14 @@ static uint8_t *USBD_HID_GetHSCfgDesc(uint16_t *length)
   * @brief  USBD_HID_GetOtherSpeedCfgDesc
   *         return other speed configuration descriptor
   * @param  speed : current device speed
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_HID_GetOtherSpeedCfgDesc(uint16_t *length)
+static uint8_t *USBD_HID_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_HID_KEYBOARD_CfgFSDesc);
 
   return USBD_HID_KEYBOARD_CfgFSDesc;
@@ -613,7 +623,10 @@ static uint8_t USBD_HID_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
   UNUSED(epnum);
   /* Ensure that the FIFO is empty before a new transfer, this condition could
   be caused by  a new transfer before the end of the previous transfer */
-  ((USBD_HID_Keyboard_HandleTypeDef *)pdev->pClassData_HID_Keyboard)->state = KEYBOARD_HID_IDLE;
+  ((USBD_HID_Keyboard_HandleTypeDef *)USBD_CLASS_DATA(pdev))->state = KEYBOARD_HID_IDLE;
+#if (USBD_LPM_ENABLED == 1U)
+  (void)USBD_LPM_Veto(pdev, 0U);
+#endif /* (USBD_LPM_ENABLED == 1U) */
 
   return (uint8_t)USBD_OK;
 }
@@ -621,11 +634,14 @@ static uint8_t USBD_HID_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
 /**
   * @brief  DeviceQualifierDescriptor
   *         return Device Qualifier descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_HID_GetDeviceQualifierDesc(uint16_t *length)
+static uint8_t *USBD_HID_GetDeviceQualifierDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_HID_DeviceQualifierDesc);
 
   return USBD_HID_DeviceQualifierDesc;
@@ -640,7 +656,14 @@ static uint8_t *USBD_HID_GetDeviceQualifierDesc(uint16_t *length)
   */
 uint8_t USBD_HID_Keybaord_SendReport(USBD_HandleTypeDef *pdev, uint8_t *report, uint16_t len)
 {
-  USBD_HID_Keyboard_HandleTypeDef *hhid = (USBD_HID_Keyboard_HandleTypeDef *)pdev->pClassData_HID_Keyboard;
+  USBD_HID_Keyboard_HandleTypeDef *hhid;
+
+  if (USBD_CoreFindClass(pdev, &USBD_HID_KEYBOARD) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  hhid = (USBD_HID_Keyboard_HandleTypeDef *)USBD_CLASS_DATA(pdev);
 
   if (hhid == NULL)
   {
@@ -652,13 +675,110 @@ uint8_t USBD_HID_Keybaord_SendReport(USBD_HandleTypeDef *pdev, uint8_t *report,
     if (hhid->state == KEYBOARD_HID_IDLE)
     {
       hhid->state = KEYBOARD_HID_BUSY;
-      (void)USBD_LL_Transmit(pdev, HID_KEYBOARD_IN_EP, report, len);
+#if (USBD_LPM_ENABLED == 1U)
+      /* Hold off LPM L1 until the host has polled the report */
+      (void)USBD_LPM_Veto(pdev, 1U);
+#endif /* (USBD_LPM_ENABLED == 1U) */
+      (void)USBD_LL_Transmit(pdev, HID_KEYBOARD_IN_EP(pdev), report, len);
     }
   }
 
   return (uint8_t)USBD_OK;
 }
 
+#if (USBD_USE_OS == 1U)
+/**
+  * @brief  USBD_HID_Keyboard_SendReportWait
+  *         Send a report, blocking until the previous one is sent and then
+  *         until the host has polled this one, report may live on the stack
+  * @param  pdev: device instance
+  * @param  report: pointer to report
+  * @param  len: report length
+  * @param  timeout: kernel ticks to wait, osWaitForever allowed
+  * @retval status: USBD_BUSY on timeout
+  */
+uint8_t USBD_HID_Keyboard_SendReportWait(USBD_HandleTypeDef *pdev, uint8_t *report, uint16_t len,
+                                         uint32_t timeout)
+{
+  USBD_HID_Keyboard_HandleTypeDef *hhid;
+  uint8_t ep_addr;
+  USBD_StatusTypeDef ret;
+
+  if (USBD_CoreFindClass(pdev, &USBD_HID_KEYBOARD) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  hhid = (USBD_HID_Keyboard_HandleTypeDef *)USBD_CLASS_DATA(pdev);
+
+  if (hhid == NULL)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  if (pdev->dev_state != USBD_STATE_CONFIGURED)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  /* The selected instance may change while the task sleeps */
+  ep_addr = HID_KEYBOARD_IN_EP(pdev);
+
+  ret = USBD_OS_Wait(pdev, ep_addr, USBD_HID_Keyboard_OS_Claim, hhid, &timeout);
+
+  if (ret != USBD_OK)
+  {
+    return (uint8_t)ret;
+  }
+
+#if (USBD_LPM_ENABLED == 1U)
+  /* Hold off LPM L1 until the host has polled the report, the veto is
+     taken for this class so select it again after the wait */
+  (void)USBD_CoreFindClass(pdev, &USBD_HID_KEYBOARD);
+  (void)USBD_LPM_Veto(pdev, 1U);
+#endif /* (USBD_LPM_ENABLED == 1U) */
+  (void)USBD_LL_Transmit(pdev, ep_addr, report, len);
+
+  return (uint8_t)USBD_OS_Wait(pdev, ep_addr, USBD_HID_Keyboard_OS_IsIdle, hhid, &timeout);
+}
+
+/**
+  * @brief  USBD_HID_Keyboard_OS_Claim
+  *         Wake-up condition of USBD_HID_Keyboard_SendReportWait, takes the IN endpoint
+  * @param  arg: class handle
+  * @retval 1 once the endpoint is taken
+  */
+static uint8_t USBD_HID_Keyboard_OS_Claim(void *arg)
+{
+  USBD_HID_Keyboard_HandleTypeDef *hhid = (USBD_HID_Keyboard_HandleTypeDef *)arg;
+  uint32_t primask;
+  uint8_t claimed = 0U;
+
+  USBD_ENTER_CRITICAL(primask);
+
+  if (hhid->state == KEYBOARD_HID_IDLE)
+  {
+    hhid->state = KEYBOARD_HID_BUSY;
+    claimed = 1U;
+  }
+
+  USBD_EXIT_CRITICAL(primask);
+
+  return claimed;
+}
+
+/**
+  * @brief  USBD_HID_Keyboard_OS_IsIdle
+  *         Wake-up condition of USBD_HID_Keyboard_SendReportWait, the report is sent
+  * @param  arg: class handle
+  * @retval 1 once the IN endpoint is idle
+  */
+static uint8_t USBD_HID_Keyboard_OS_IsIdle(void *arg)
+{
+  return (((USBD_HID_Keyboard_HandleTypeDef *)arg)->state == KEYBOARD_HID_IDLE) ? 1U : 0U;
+}
+#endif /* (USBD_USE_OS == 1U) */
+
 /**
   * @brief  USBD_HID_GetPollingInterval
   *         return polling interval from endpoint descriptor
@@ -669,6 +789,11 @@ uint32_t USBD_HID_Keyboard_GetPollingInterval(USBD_HandleTypeDef *pdev)
 {
   uint32_t polling_interval;
 
+  if (USBD_CoreFindClass(pdev, &USBD_HID_KEYBOARD) != USBD_OK)
+  {
+    return 0U;
+  }
+
   /* HIGH-speed endpoints */
   if (pdev->dev_speed == USBD_SPEED_HIGH)
   {
@@ -687,15 +812,16 @@ uint32_t USBD_HID_Keyboard_GetPollingInterval(USBD_HandleTypeDef *pdev)
   return ((uint32_t)(polling_interval));
 }
 
-void USBD_Update_HID_KBD_DESC(uint8_t *desc, uint8_t itf_no, uint8_t in_ep, uint8_t str_idx)
+void USBD_Update_HID_KBD_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no, uint8_t in_ep, uint8_t str_idx)
 {
   desc[11] = itf_no;
   desc[17] = str_idx;
   desc[29] = in_ep;
 
-  HID_KEYBOARD_IN_EP = in_ep;
-  HID_KEYBOARD_ITF_NBR = itf_no;
-  HID_KEYBOARD_STR_DESC_IDX = str_idx;
+  USBD_CLASS_MAP(pdev).in_ep = in_ep;
+  USBD_CLASS_MAP(pdev).itf_nbr = itf_no;
+  USBD_CLASS_MAP(pdev).itf_num = 1U;
+  USBD_CLASS_MAP(pdev).str_idx = str_idx;
 }
 
 /**
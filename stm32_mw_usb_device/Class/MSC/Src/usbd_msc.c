@@ -46,11 +46,6 @@ EndBSPDependencies */
 #define _MSC_ITF_NBR 0x00
 #define _MSC_BOT_STR_DESC_IDX 0x00U
 
-uint8_t MSC_IN_EP = _MSC_IN_EP;
-uint8_t MSC_OUT_EP = _MSC_OUT_EP;
-uint8_t MSC_ITF_NBR = _MSC_ITF_NBR;
-uint8_t MSC_BOT_STR_DESC_IDX = _MSC_BOT_STR_DESC_IDX;
-
 /** @addtogroup STM32_USB_DEVICE_LIBRARY
   * @{
   */
@@ -91,10 +86,10 @@ uint8_t USBD_MSC_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
 uint8_t USBD_MSC_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum);
 uint8_t USBD_MSC_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum);
 
-uint8_t *USBD_MSC_GetHSCfgDesc(uint16_t *length);
-uint8_t *USBD_MSC_GetFSCfgDesc(uint16_t *length);
-uint8_t *USBD_MSC_GetOtherSpeedCfgDesc(uint16_t *length);
-uint8_t *USBD_MSC_GetDeviceQualifierDescriptor(uint16_t *length);
+uint8_t *USBD_MSC_GetHSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+uint8_t *USBD_MSC_GetFSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+uint8_t *USBD_MSC_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+uint8_t *USBD_MSC_GetDeviceQualifierDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length);
 
 /**
   * @}
@@ -104,7 +99,7 @@ uint8_t *USBD_MSC_GetDeviceQualifierDescriptor(uint16_t *length);
   * @{
   */
 
-static USBD_MSC_BOT_HandleTypeDef USBD_MSC_Instance;
+static USBD_MSC_BOT_HandleTypeDef USBD_MSC_Instance[USBD_MAX_NUM_DEV][USBD_MSC_MAX_INST];
 
 USBD_ClassTypeDef USBD_MSC =
     {
@@ -297,35 +292,35 @@ uint8_t USBD_MSC_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   UNUSED(cfgidx);
   USBD_MSC_BOT_HandleTypeDef *hmsc;
 
-  hmsc = &USBD_MSC_Instance;
+  hmsc = &USBD_MSC_Instance[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)];
 
   if (hmsc == NULL)
   {
-    pdev->pClassData_MSC = NULL;
+    USBD_CLASS_DATA(pdev) = NULL;
     return (uint8_t)USBD_EMEM;
   }
 
-  pdev->pClassData_MSC = (void *)hmsc;
+  USBD_CLASS_DATA(pdev) = (void *)hmsc;
 
   if (pdev->dev_speed == USBD_SPEED_HIGH)
   {
     /* Open EP OUT */
-    (void)USBD_LL_OpenEP(pdev, MSC_OUT_EP, USBD_EP_TYPE_BULK, MSC_MAX_HS_PACKET);
-    pdev->ep_out[MSC_OUT_EP & 0xFU].is_used = 1U;
+    (void)USBD_LL_OpenEP(pdev, MSC_OUT_EP(pdev), USBD_EP_TYPE_BULK, MSC_MAX_HS_PACKET);
+    pdev->ep_out[MSC_OUT_EP(pdev) & 0xFU].is_used = 1U;
 
     /* Open EP IN */
-    (void)USBD_LL_OpenEP(pdev, MSC_IN_EP, USBD_EP_TYPE_BULK, MSC_MAX_HS_PACKET);
-    pdev->ep_in[MSC_IN_EP & 0xFU].is_used = 1U;
+    (void)USBD_LL_OpenEP(pdev, MSC_IN_EP(pdev), USBD_EP_TYPE_BULK, MSC_MAX_HS_PACKET);
+    pdev->ep_in[MSC_IN_EP(pdev) & 0xFU].is_used = 1U;
   }
   else
   {
     /* Open EP OUT */
-    (void)USBD_LL_OpenEP(pdev, MSC_OUT_EP, USBD_EP_TYPE_BULK, MSC_MAX_FS_PACKET);
-    pdev->ep_out[MSC_OUT_EP & 0xFU].is_used = 1U;
+    (void)USBD_LL_OpenEP(pdev, MSC_OUT_EP(pdev), USBD_EP_TYPE_BULK, MSC_MAX_FS_PACKET);
+    pdev->ep_out[MSC_OUT_EP(pdev) & 0xFU].is_used = 1U;
 
     /* Open EP IN */
-    (void)USBD_LL_OpenEP(pdev, MSC_IN_EP, USBD_EP_TYPE_BULK, MSC_MAX_FS_PACKET);
-    pdev->ep_in[MSC_IN_EP & 0xFU].is_used = 1U;
+    (void)USBD_LL_OpenEP(pdev, MSC_IN_EP(pdev), USBD_EP_TYPE_BULK, MSC_MAX_FS_PACKET);
+    pdev->ep_in[MSC_IN_EP(pdev) & 0xFU].is_used = 1U;
   }
 
   /* Init the BOT  layer */
@@ -346,22 +341,22 @@ uint8_t USBD_MSC_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   UNUSED(cfgidx);
 
   /* Close MSC EPs */
-  (void)USBD_LL_CloseEP(pdev, MSC_OUT_EP);
-  pdev->ep_out[MSC_OUT_EP & 0xFU].is_used = 0U;
+  (void)USBD_LL_CloseEP(pdev, MSC_OUT_EP(pdev));
+  pdev->ep_out[MSC_OUT_EP(pdev) & 0xFU].is_used = 0U;
 
   /* Close EP IN */
-  (void)USBD_LL_CloseEP(pdev, MSC_IN_EP);
-  pdev->ep_in[MSC_IN_EP & 0xFU].is_used = 0U;
+  (void)USBD_LL_CloseEP(pdev, MSC_IN_EP(pdev));
+  pdev->ep_in[MSC_IN_EP(pdev) & 0xFU].is_used = 0U;
 
   /* Free MSC Class Resources */
-  if (pdev->pClassData_MSC != NULL)
+  if (USBD_CLASS_DATA(pdev) != NULL)
   {
     /* De-Init the BOT layer */
     MSC_BOT_DeInit(pdev);
 #if (0)
-    (void)USBD_free(pdev->pClassData_MSC);
+    (void)USBD_free(USBD_CLASS_DATA(pdev));
 #endif
-    pdev->pClassData_MSC = NULL;
+    USBD_CLASS_DATA(pdev) = NULL;
   }
 
   return (uint8_t)USBD_OK;
@@ -375,7 +370,7 @@ uint8_t USBD_MSC_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   */
 uint8_t USBD_MSC_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData_MSC;
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)USBD_CLASS_DATA(pdev);
   USBD_StatusTypeDef ret = USBD_OK;
   uint16_t status_info = 0U;
 
@@ -394,7 +389,7 @@ uint8_t USBD_MSC_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
       if ((req->wValue == 0U) && (req->wLength == 1U) &&
           ((req->bmRequest & 0x80U) == 0x80U))
       {
-        hmsc->max_lun = (uint32_t)((USBD_StorageTypeDef *)pdev->pUserData_MSC)->GetMaxLun();
+        hmsc->max_lun = (uint32_t)((USBD_StorageTypeDef *)USBD_USER_DATA(pdev))->GetMaxLun();
         (void)USBD_CtlSendData(pdev, (uint8_t *)&hmsc->max_lun, 1U);
       }
       else
@@ -524,11 +519,14 @@ uint8_t USBD_MSC_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
 /**
   * @brief  USBD_MSC_GetHSCfgDesc
   *         return configuration descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-uint8_t *USBD_MSC_GetHSCfgDesc(uint16_t *length)
+uint8_t *USBD_MSC_GetHSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_MSC_CfgHSDesc);
 
   return USBD_MSC_CfgHSDesc;
@@ -537,11 +535,14 @@ uint8_t *USBD_MSC_GetHSCfgDesc(uint16_t *length)
 /**
   * @brief  USBD_MSC_GetFSCfgDesc
   *         return configuration descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-uint8_t *USBD_MSC_GetFSCfgDesc(uint16_t *length)
+uint8_t *USBD_MSC_GetFSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_MSC_CfgFSDesc);
 
   return USBD_MSC_CfgFSDesc;
@@ -550,11 +551,14 @@ uint8_t *USBD_MSC_GetFSCfgDesc(uint16_t *length)
 /**
   * @brief  USBD_MSC_GetOtherSpeedCfgDesc
   *         return other speed configuration descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-uint8_t *USBD_MSC_GetOtherSpeedCfgDesc(uint16_t *length)
+uint8_t *USBD_MSC_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_MSC_OtherSpeedCfgDesc);
 
   return USBD_MSC_OtherSpeedCfgDesc;
@@ -562,11 +566,14 @@ uint8_t *USBD_MSC_GetOtherSpeedCfgDesc(uint16_t *length)
 /**
   * @brief  DeviceQualifierDescriptor
   *         return Device Qualifier descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-uint8_t *USBD_MSC_GetDeviceQualifierDescriptor(uint16_t *length)
+uint8_t *USBD_MSC_GetDeviceQualifierDescriptor(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)sizeof(USBD_MSC_DeviceQualifierDesc);
 
   return USBD_MSC_DeviceQualifierDesc;
@@ -579,27 +586,33 @@ uint8_t *USBD_MSC_GetDeviceQualifierDescriptor(uint16_t *length)
   */
 uint8_t USBD_MSC_RegisterStorage(USBD_HandleTypeDef *pdev, USBD_StorageTypeDef *fops)
 {
+  if (USBD_CoreFindClass(pdev, &USBD_MSC) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
   if (fops == NULL)
   {
     return (uint8_t)USBD_FAIL;
   }
 
-  pdev->pUserData_MSC = fops;
+  USBD_USER_DATA(pdev) = fops;
 
   return (uint8_t)USBD_OK;
 }
 
-void USBD_Update_MSC_DESC(uint8_t *desc, uint8_t itf_no, uint8_t in_ep, uint8_t out_ep, uint8_t str_idx)
+void USBD_Update_MSC_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no, uint8_t in_ep, uint8_t out_ep, uint8_t str_idx)
 {
   desc[11] = itf_no;
   desc[17] = str_idx;
   desc[20] = in_ep;
   desc[27] = out_ep;
 
-  MSC_IN_EP = in_ep;
-  MSC_OUT_EP = out_ep;
-  MSC_ITF_NBR = itf_no;
-  MSC_BOT_STR_DESC_IDX = str_idx;
+  USBD_CLASS_MAP(pdev).in_ep = in_ep;
+  USBD_CLASS_MAP(pdev).out_ep = out_ep;
+  USBD_CLASS_MAP(pdev).itf_nbr = itf_no;
+  USBD_CLASS_MAP(pdev).itf_num = 1U;
+  USBD_CLASS_MAP(pdev).str_idx = str_idx;
 }
 
 /**
@@ -123,10 +123,15 @@ typedef struct
 
 extern USBD_ClassTypeDef USBD_PRNT;
 
-extern uint8_t PRNT_IN_EP;
-extern uint8_t PRNT_OUT_EP;
-extern uint8_t PRNT_ITF_NBR;
-extern uint8_t PRINTER_STR_DESC_IDX;
+/* Instances of the class a device can mount */
+#ifndef USBD_PRNT_MAX_INST
+#define USBD_PRNT_MAX_INST  1U
+#endif /* USBD_PRNT_MAX_INST */
+
+#define PRNT_IN_EP(pdev)            (USBD_CLASS_MAP(pdev).in_ep)
+#define PRNT_OUT_EP(pdev)           (USBD_CLASS_MAP(pdev).out_ep)
+#define PRNT_ITF_NBR(pdev)          (USBD_CLASS_MAP(pdev).itf_nbr)
+#define PRINTER_STR_DESC_IDX(pdev)  (USBD_CLASS_MAP(pdev).str_idx)
 
 /**
   * @}
@@ -139,7 +144,7 @@ uint8_t USBD_PRNT_RegisterInterface(USBD_HandleTypeDef *pdev, USBD_PRNT_ItfTypeD
 uint8_t USBD_PRNT_SetRxBuffer(USBD_HandleTypeDef *pdev, uint8_t *pbuff);
 uint8_t USBD_PRNT_ReceivePacket(USBD_HandleTypeDef *pdev);
 
-void USBD_Update_PRNT_DESC(uint8_t *desc, uint8_t itf_no, uint8_t in_ep, uint8_t out_ep, uint8_t str_idx);
+void USBD_Update_PRNT_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t itf_no, uint8_t in_ep, uint8_t out_ep, uint8_t str_idx);
 
 /**
   * @}
@@ -58,11 +58,6 @@
 #define _UVC_VS_IF_NUM 0x01U
 #define _UVC_STR_DESC_IDX 0x00U
 
-uint8_t UVC_IN_EP = _UVC_IN_EP;
-uint8_t UVC_VC_IF_NUM = _UVC_VC_IF_NUM;
-uint8_t UVC_VS_IF_NUM = _UVC_VS_IF_NUM;
-uint8_t UVC_STR_DESC_IDX = _UVC_STR_DESC_IDX;
-
 /** @addtogroup STM32_USB_DEVICE_LIBRARY
   * @{
   */
@@ -84,6 +79,10 @@ uint8_t UVC_STR_DESC_IDX = _UVC_STR_DESC_IDX;
   * @{
   */
 
+#if ((UVC_HEADER_PACKET_CNT * 2U) > USBD_LL_TXV_MAX_SEGMENTS)
+#error "USBD_LL_TXV_MAX_SEGMENTS must hold a header and a data segment per UVC packet"
+#endif
+
 /**
   * @}
   */
@@ -96,13 +95,14 @@ uint8_t UVC_STR_DESC_IDX = _UVC_STR_DESC_IDX;
 static uint8_t USBD_VIDEO_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
 static uint8_t USBD_VIDEO_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
 static uint8_t USBD_VIDEO_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
-static uint8_t *USBD_VIDEO_GetFSCfgDesc(uint16_t *length);
-static uint8_t *USBD_VIDEO_GetHSCfgDesc(uint16_t *length);
-static uint8_t *USBD_VIDEO_GetOtherSpeedCfgDesc(uint16_t *length);
-static uint8_t *USBD_VIDEO_GetDeviceQualifierDesc(uint16_t *length);
+static uint8_t *USBD_VIDEO_GetFSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_VIDEO_GetHSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_VIDEO_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
+static uint8_t *USBD_VIDEO_GetDeviceQualifierDesc(USBD_HandleTypeDef *pdev, uint16_t *length);
 static uint8_t USBD_VIDEO_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum);
 static uint8_t USBD_VIDEO_SOF(USBD_HandleTypeDef *pdev);
 static uint8_t USBD_VIDEO_IsoINIncomplete(USBD_HandleTypeDef *pdev, uint8_t epnum);
+static void USBD_VIDEO_ItfInit(USBD_HandleTypeDef *pdev);
 
 /* VIDEO Requests management functions */
 static void VIDEO_REQ_GetCurrent(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
@@ -111,6 +111,7 @@ static void VIDEO_REQ_SetCurrent(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef
 static USBD_VIDEO_DescHeader_t *USBD_VIDEO_GetNextDesc(uint8_t *pbuf, uint16_t *ptr);
 static void *USBD_VIDEO_GetEpDesc(uint8_t *pConfDesc, uint8_t EpAddr);
 static void *USBD_VIDEO_GetVSFrameDesc(uint8_t *pConfDesc);
+static uint16_t USBD_VIDEO_IsoMPS(USBD_HandleTypeDef *pdev, uint8_t speed);
 
 /**
   * @}
@@ -119,7 +120,10 @@ static void *USBD_VIDEO_GetVSFrameDesc(uint8_t *pConfDesc);
 /** @defgroup USBD_VIDEO_Private_Variables
   * @{
   */
-static USBD_VIDEO_HandleTypeDef USBD_VIDEO_Instance;
+static USBD_VIDEO_HandleTypeDef USBD_VIDEO_Instance[USBD_MAX_NUM_DEV][USBD_UVC_MAX_INST];
+
+/* Isochronous packet size of each speed, 0 keeps the UVC_ISO_xS_MPS default */
+static uint16_t USBD_VIDEO_IsoMaxPacket[USBD_MAX_NUM_DEV][2];
 
 USBD_ClassTypeDef USBD_VIDEO =
     {
@@ -329,8 +333,8 @@ __ALIGN_BEGIN static uint8_t USBD_VIDEO_DeviceQualifierDesc[USB_LEN_DEV_QUALIFIE
         0x00,
 };
 
-/* Video Commit data structure */
-static USBD_VideoControlTypeDef video_Commit_Control =
+/* Default Video Probe and Commit data structure */
+static const USBD_VideoControlTypeDef video_Default_Control =
     {
         .bmHint = 0x0000U,
         .bFormatIndex = 0x01U,
@@ -350,26 +354,9 @@ static USBD_VideoControlTypeDef video_Commit_Control =
         .bMaxVersion = 0x00U,
 };
 
-/* Video Probe data structure */
-static USBD_VideoControlTypeDef video_Probe_Control =
-    {
-        .bmHint = 0x0000U,
-        .bFormatIndex = 0x01U,
-        .bFrameIndex = 0x01U,
-        .dwFrameInterval = UVC_INTERVAL(UVC_CAM_FPS_FS),
-        .wKeyFrameRate = 0x0000U,
-        .wPFrameRate = 0x0000U,
-        .wCompQuality = 0x0000U,
-        .wCompWindowSize = 0x0000U,
-        .wDelay = 0x0000U,
-        .dwMaxVideoFrameSize = 0x0000U,
-        .dwMaxPayloadTransferSize = 0x00000000U,
-        .dwClockFrequency = 0x00000000U,
-        .bmFramingInfo = 0x00U,
-        .bPreferedVersion = 0x00U,
-        .bMinVersion = 0x00U,
-        .bMaxVersion = 0x00U,
-};
+/* Video Probe and Commit data structures */
+static USBD_VideoControlTypeDef video_Probe_Control[USBD_MAX_NUM_DEV][USBD_UVC_MAX_INST];
+static USBD_VideoControlTypeDef video_Commit_Control[USBD_MAX_NUM_DEV][USBD_UVC_MAX_INST];
 
 /**
   * @}
@@ -391,7 +378,7 @@ static uint8_t USBD_VIDEO_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   USBD_VIDEO_HandleTypeDef *hVIDEO;
 
   /* Allocate memory for the video control structure */
-  hVIDEO = &USBD_VIDEO_Instance;
+  hVIDEO = &USBD_VIDEO_Instance[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)];
 
   /* Check if allocated point is NULL, then exit with error code */
   if (hVIDEO == NULL)
@@ -399,30 +386,26 @@ static uint8_t USBD_VIDEO_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
     return (uint8_t)USBD_FAIL;
   }
 
-  /* Assign the pClassData_UVC pointer to the allocated structure */
-  pdev->pClassData_UVC = (void *)hVIDEO;
+  /* Assign the class data pointer of the instance to the allocated structure */
+  USBD_CLASS_DATA(pdev) = (void *)hVIDEO;
 
   /* Open EP IN */
-  if (pdev->dev_speed == USBD_SPEED_HIGH)
-  {
-    (void)USBD_LL_OpenEP(pdev, UVC_IN_EP, USBD_EP_TYPE_ISOC, UVC_ISO_HS_MPS);
-
-    pdev->ep_in[UVC_IN_EP & 0xFU].is_used = 1U;
-    pdev->ep_in[UVC_IN_EP & 0xFU].maxpacket = UVC_ISO_HS_MPS;
-  }
-  else
-  {
-    (void)USBD_LL_OpenEP(pdev, UVC_IN_EP, USBD_EP_TYPE_ISOC, UVC_ISO_FS_MPS);
+  (void)USBD_LL_OpenEP(pdev, UVC_IN_EP(pdev), USBD_EP_TYPE_ISOC, USBD_VIDEO_IsoMPS(pdev, (uint8_t)pdev->dev_speed));
 
-    pdev->ep_in[UVC_IN_EP & 0xFU].is_used = 1U;
-    pdev->ep_in[UVC_IN_EP & 0xFU].maxpacket = UVC_ISO_FS_MPS;
-  }
+  pdev->ep_in[UVC_IN_EP(pdev) & 0xFU].is_used = 1U;
+  pdev->ep_in[UVC_IN_EP(pdev) & 0xFU].maxpacket = USBD_VIDEO_IsoMPS(pdev, (uint8_t)pdev->dev_speed);
 
-  /* Init  physical Interface components */
-  ((USBD_VIDEO_ItfTypeDef *)pdev->pUserData_UVC)->Init();
+  /* Init  physical Interface components, on the first VIDEO request */
+  (void)USBD_CoreDeferInit(pdev, USBD_VIDEO_ItfInit);
 
   /* Init Xfer states */
   hVIDEO->interface = 0U;
+  hVIDEO->payload_header[0] = 0x02U;
+  hVIDEO->payload_header[1] = 0x00U;
+
+  /* Restore the default Probe and Commit controls */
+  video_Probe_Control[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)] = video_Default_Control;
+  video_Commit_Control[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)] = video_Default_Control;
 
   /* Some calls to unused variables, to comply with MISRA-C 2012 rules */
   UNUSED(USBD_VIDEO_CfgDesc);
@@ -432,6 +415,17 @@ static uint8_t USBD_VIDEO_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   return (uint8_t)USBD_OK;
 }
 
+/**
+  * @brief  USBD_VIDEO_ItfInit
+  *         Initialize the physical interface components
+  * @param  pdev: device instance
+  * @retval None
+  */
+static void USBD_VIDEO_ItfInit(USBD_HandleTypeDef *pdev)
+{
+  ((USBD_VIDEO_ItfTypeDef *)USBD_USER_DATA(pdev))->Init();
+}
+
 /**
   * @brief  USBD_VIDEO_DeInit
   *         DeInitialize the VIDEO layer
@@ -444,21 +438,21 @@ static uint8_t USBD_VIDEO_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   UNUSED(cfgidx);
 
   /* Check if the video structure pointer is valid */
-  if (pdev->pClassData_UVC == NULL)
+  if (USBD_CLASS_DATA(pdev) == NULL)
   {
     return (uint8_t)USBD_FAIL;
   }
 
   /* Close EP IN */
-  (void)USBD_LL_CloseEP(pdev, UVC_IN_EP);
-  pdev->ep_in[UVC_IN_EP & 0xFU].is_used = 0U;
+  (void)USBD_LL_CloseEP(pdev, UVC_IN_EP(pdev));
+  pdev->ep_in[UVC_IN_EP(pdev) & 0xFU].is_used = 0U;
 
   /* DeInit  physical Interface components */
-  ((USBD_VIDEO_ItfTypeDef *)pdev->pUserData_UVC)->DeInit();
+  ((USBD_VIDEO_ItfTypeDef *)USBD_USER_DATA(pdev))->DeInit();
 #if (0)
-  USBD_free(pdev->pClassData_UVC);
+  USBD_free(USBD_CLASS_DATA(pdev));
 #endif
-  pdev->pClassData_UVC = NULL;
+  USBD_CLASS_DATA(pdev) = NULL;
 
   /* Exit with no error code */
   return (uint8_t)USBD_OK;
@@ -473,7 +467,7 @@ static uint8_t USBD_VIDEO_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   */
 static uint8_t USBD_VIDEO_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
-  USBD_VIDEO_HandleTypeDef *hVIDEO = (USBD_VIDEO_HandleTypeDef *)pdev->pClassData_UVC;
+  USBD_VIDEO_HandleTypeDef *hVIDEO = (USBD_VIDEO_HandleTypeDef *)USBD_CLASS_DATA(pdev);
   uint8_t ret = (uint8_t)USBD_OK;
   uint16_t len = 0U;
   uint8_t *pbuf = NULL;
@@ -551,14 +545,14 @@ static uint8_t USBD_VIDEO_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *
           if (hVIDEO->interface == 1U)
           {
             /* Start Streaming (First endpoint writing will be done on next SOF) */
-            (void)USBD_LL_FlushEP(pdev, UVC_IN_EP);
+            (void)USBD_LL_FlushEP(pdev, UVC_IN_EP(pdev));
             hVIDEO->uvc_state = UVC_PLAY_STATUS_READY;
           }
           else
           {
             /* Stop Streaming */
             hVIDEO->uvc_state = UVC_PLAY_STATUS_STOP;
-            (void)USBD_LL_FlushEP(pdev, UVC_IN_EP);
+            (void)USBD_LL_FlushEP(pdev, UVC_IN_EP(pdev));
           }
         }
         else
@@ -603,20 +597,26 @@ static uint8_t USBD_VIDEO_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *
   */
 static uint8_t USBD_VIDEO_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
 {
-  USBD_VIDEO_HandleTypeDef *hVIDEO = (USBD_VIDEO_HandleTypeDef *)pdev->pClassData_UVC;
-  static uint8_t packet[UVC_PACKET_SIZE + (UVC_HEADER_PACKET_CNT * 2U)] = {0x00U};
-  static uint8_t *Pcktdata = packet;
-  static uint16_t PcktIdx = 0U;
-  static uint16_t PcktSze = UVC_PACKET_SIZE;
-  static uint8_t payload_header[2] = {0x02U, 0x00U};
-  uint8_t i = 0U;
+  USBD_VIDEO_HandleTypeDef *hVIDEO = (USBD_VIDEO_HandleTypeDef *)USBD_CLASS_DATA(pdev);
+  uint8_t *Pcktdata = NULL;
+  uint16_t PcktIdx = 0U;
+  USBD_SegmentTypeDef seg[UVC_HEADER_PACKET_CNT * 2U];
+  uint32_t maxpacket = pdev->ep_in[UVC_IN_EP(pdev) & 0xFU].maxpacket;
+  /* One transfer carries UVC_HEADER_PACKET_CNT packets, header included */
+  uint16_t PcktMax = (uint16_t)MIN(maxpacket * UVC_HEADER_PACKET_CNT, 0xFFFFU);
+  uint16_t PcktSze = MIN(UVC_PACKET_SIZE, PcktMax);
   uint32_t RemainData, DataOffset = 0U;
+  uint8_t nseg = 0U;
 
   /* Check if the Streaming has already been started */
   if (hVIDEO->uvc_state == UVC_PLAY_STATUS_STREAMING)
   {
-    /* Get the current packet buffer, index and size from the application layer */
-    ((USBD_VIDEO_ItfTypeDef *)pdev->pUserData_UVC)->Data(&Pcktdata, &PcktSze, &PcktIdx);
+    /* Get the current packet buffer, index and size from the application
+       layer, the size is passed in as the most the transfer can carry */
+    ((USBD_VIDEO_ItfTypeDef *)USBD_USER_DATA(pdev))->Data(&Pcktdata, &PcktSze, &PcktIdx);
+
+    /* The image data past what fits is not sent */
+    PcktSze = MIN(PcktSze, PcktMax);
 
     /* Check if end of current image has been reached */
     if (PcktSze > 2U)
@@ -625,44 +625,37 @@ static uint8_t USBD_VIDEO_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
       if (PcktIdx == 0U)
       {
         /* Set the packet start index */
-        payload_header[1] ^= 0x01U;
+        hVIDEO->payload_header[1] ^= 0x01U;
       }
 
       RemainData = PcktSze;
 
-      /* fill the Transmit buffer */
-      while (RemainData > 0U)
+      /* Describe each packet as payload header followed by image data, the
+         LL driver gathers them so the image is not copied in the class */
+      while ((RemainData > 0U) && (nseg < (UVC_HEADER_PACKET_CNT * 2U)))
       {
-        packet[((DataOffset + 0U) * i)] = payload_header[0];
-        packet[((DataOffset + 0U) * i) + 1U] = payload_header[1];
-        if (RemainData > pdev->ep_in[UVC_IN_EP & 0xFU].maxpacket)
-        {
-          DataOffset = pdev->ep_in[UVC_IN_EP & 0xFU].maxpacket;
-          (void)USBD_memcpy((packet + ((DataOffset + 0U) * i) + 2U),
-                            Pcktdata + ((DataOffset - 2U) * i), (DataOffset - 2U));
+        uint32_t len = MIN(RemainData, maxpacket);
 
-          RemainData -= DataOffset;
-          i++;
-        }
-        else
-        {
-          (void)USBD_memcpy((packet + ((DataOffset + 0U) * i) + 2U),
-                            Pcktdata + ((DataOffset - 2U) * i), (RemainData - 2U));
+        seg[nseg].pbuf = hVIDEO->payload_header;
+        seg[nseg].length = 2U;
+        seg[nseg + 1U].pbuf = Pcktdata + DataOffset;
+        seg[nseg + 1U].length = (len > 2U) ? (len - 2U) : 0U;
 
-          RemainData = 0U;
-        }
+        DataOffset += seg[nseg + 1U].length;
+        RemainData -= len;
+        nseg += 2U;
       }
     }
     else
     {
       /* Add the packet header */
-      packet[0] = payload_header[0];
-      packet[1] = payload_header[1];
+      seg[0].pbuf = hVIDEO->payload_header;
+      seg[0].length = 2U;
+      nseg = 1U;
     }
 
     /* Transmit the packet on Endpoint */
-    (void)USBD_LL_Transmit(pdev, (uint8_t)(epnum | 0x80U),
-                           (uint8_t *)&packet, (uint32_t)PcktSze);
+    (void)USBD_LL_TransmitV(pdev, (uint8_t)(epnum | 0x80U), seg, nseg);
   }
 
   /* Exit with no error code */
@@ -677,14 +670,14 @@ static uint8_t USBD_VIDEO_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
   */
 static uint8_t USBD_VIDEO_SOF(USBD_HandleTypeDef *pdev)
 {
-  USBD_VIDEO_HandleTypeDef *hVIDEO = (USBD_VIDEO_HandleTypeDef *)pdev->pClassData_UVC;
+  USBD_VIDEO_HandleTypeDef *hVIDEO = (USBD_VIDEO_HandleTypeDef *)USBD_CLASS_DATA(pdev);
   uint8_t payload[2] = {0x02U, 0x00U};
 
   /* Check if the Streaming has already been started by SetInterface AltSetting 1 */
   if (hVIDEO->uvc_state == UVC_PLAY_STATUS_READY)
   {
     /* Transmit the first packet indicating that Streaming is starting */
-    (void)USBD_LL_Transmit(pdev, UVC_IN_EP, (uint8_t *)payload, 2U);
+    (void)USBD_LL_Transmit(pdev, UVC_IN_EP(pdev), (uint8_t *)payload, 2U);
 
     /* Enable Streaming state */
     hVIDEO->uvc_state = UVC_PLAY_STATUS_STREAMING;
@@ -719,14 +712,14 @@ static uint8_t USBD_VIDEO_IsoINIncomplete(USBD_HandleTypeDef *pdev, uint8_t epnu
 static void VIDEO_REQ_GetCurrent(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
   USBD_VIDEO_HandleTypeDef *hVIDEO;
-  hVIDEO = (USBD_VIDEO_HandleTypeDef *)(pdev->pClassData_UVC);
+  hVIDEO = (USBD_VIDEO_HandleTypeDef *)(USBD_CLASS_DATA(pdev));
   static __IO uint8_t EntityStatus[8] = {0};
 
   /* Reset buffer to zeros */
   (void)USBD_memset(hVIDEO->control.data, 0, USB_MAX_EP0_SIZE);
 
   /* Manage Video Control interface requests */
-  if (LOBYTE(req->wIndex) == UVC_VC_IF_NUM)
+  if (LOBYTE(req->wIndex) == UVC_VC_IF_NUM(pdev))
   {
     if (HIBYTE(req->wValue) == 0x02U)
     {
@@ -748,43 +741,43 @@ static void VIDEO_REQ_GetCurrent(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef
     if (LOBYTE(req->wValue) == (uint8_t)VS_PROBE_CONTROL)
     {
       /* Update bPreferedVersion, bMinVersion and bMaxVersion which must be set only by Device */
-      video_Probe_Control.bPreferedVersion = 0x00U;
-      video_Probe_Control.bMinVersion = 0x00U;
-      video_Probe_Control.bMaxVersion = 0x00U;
-      video_Probe_Control.dwMaxVideoFrameSize = UVC_MAX_FRAME_SIZE;
+      video_Probe_Control[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)].bPreferedVersion = 0x00U;
+      video_Probe_Control[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)].bMinVersion = 0x00U;
+      video_Probe_Control[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)].bMaxVersion = 0x00U;
+      video_Probe_Control[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)].dwMaxVideoFrameSize = UVC_MAX_FRAME_SIZE;
 
-      video_Probe_Control.dwClockFrequency = 0x02DC6C00U;
+      video_Probe_Control[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)].dwClockFrequency = 0x02DC6C00U;
 
       if (pdev->dev_speed == USBD_SPEED_HIGH)
       {
-        video_Probe_Control.dwFrameInterval = (UVC_INTERVAL(UVC_CAM_FPS_HS));
-        video_Probe_Control.dwMaxPayloadTransferSize = UVC_ISO_HS_MPS;
+        video_Probe_Control[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)].dwFrameInterval = (UVC_INTERVAL(UVC_CAM_FPS_HS));
+        video_Probe_Control[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)].dwMaxPayloadTransferSize = USBD_VIDEO_IsoMPS(pdev, USBD_SPEED_HIGH);
       }
       else
       {
-        video_Probe_Control.dwFrameInterval = (UVC_INTERVAL(UVC_CAM_FPS_FS));
-        video_Probe_Control.dwMaxPayloadTransferSize = UVC_ISO_FS_MPS;
+        video_Probe_Control[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)].dwFrameInterval = (UVC_INTERVAL(UVC_CAM_FPS_FS));
+        video_Probe_Control[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)].dwMaxPayloadTransferSize = USBD_VIDEO_IsoMPS(pdev, USBD_SPEED_FULL);
       }
 
       /* Probe Request */
-      (void)USBD_CtlSendData(pdev, (uint8_t *)&video_Probe_Control,
+      (void)USBD_CtlSendData(pdev, (uint8_t *)&video_Probe_Control[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)],
                              MIN(req->wLength, sizeof(USBD_VideoControlTypeDef)));
     }
     else if (LOBYTE(req->wValue) == (uint8_t)VS_COMMIT_CONTROL)
     {
       if (pdev->dev_speed == USBD_SPEED_HIGH)
       {
-        video_Commit_Control.dwFrameInterval = (UVC_INTERVAL(UVC_CAM_FPS_HS));
-        video_Commit_Control.dwMaxPayloadTransferSize = UVC_ISO_HS_MPS;
+        video_Commit_Control[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)].dwFrameInterval = (UVC_INTERVAL(UVC_CAM_FPS_HS));
+        video_Commit_Control[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)].dwMaxPayloadTransferSize = USBD_VIDEO_IsoMPS(pdev, USBD_SPEED_HIGH);
       }
       else
       {
-        video_Commit_Control.dwFrameInterval = (UVC_INTERVAL(UVC_CAM_FPS_FS));
-        video_Commit_Control.dwMaxPayloadTransferSize = UVC_ISO_FS_MPS;
+        video_Commit_Control[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)].dwFrameInterval = (UVC_INTERVAL(UVC_CAM_FPS_FS));
+        video_Commit_Control[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)].dwMaxPayloadTransferSize = USBD_VIDEO_IsoMPS(pdev, USBD_SPEED_FULL);
       }
 
       /* Commit Request */
-      (void)USBD_CtlSendData(pdev, (uint8_t *)&video_Commit_Control,
+      (void)USBD_CtlSendData(pdev, (uint8_t *)&video_Commit_Control[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)],
                              MIN(req->wLength, sizeof(USBD_VideoControlTypeDef)));
     }
     else
@@ -805,7 +798,7 @@ static void VIDEO_REQ_GetCurrent(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef
   */
 static void VIDEO_REQ_SetCurrent(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
-  USBD_VIDEO_HandleTypeDef *hVIDEO = (USBD_VIDEO_HandleTypeDef *)(pdev->pClassData_UVC);
+  USBD_VIDEO_HandleTypeDef *hVIDEO = (USBD_VIDEO_HandleTypeDef *)(USBD_CLASS_DATA(pdev));
 
   /* Check that the request has control data */
   if (req->wLength > 0U)
@@ -814,13 +807,13 @@ static void VIDEO_REQ_SetCurrent(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef
     if (LOBYTE(req->wValue) == (uint8_t)VS_PROBE_CONTROL)
     {
       /* Probe Request */
-      (void)USBD_CtlPrepareRx(pdev, (uint8_t *)&video_Probe_Control,
+      (void)USBD_CtlPrepareRx(pdev, (uint8_t *)&video_Probe_Control[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)],
                               MIN(req->wLength, sizeof(USBD_VideoControlTypeDef)));
     }
     else if (LOBYTE(req->wValue) == (uint8_t)VS_COMMIT_CONTROL)
     {
       /* Commit Request */
-      (void)USBD_CtlPrepareRx(pdev, (uint8_t *)&video_Commit_Control,
+      (void)USBD_CtlPrepareRx(pdev, (uint8_t *)&video_Commit_Control[USBD_DEV_IDX(pdev)][USBD_CLASS_INST(pdev)],
                               MIN(req->wLength, sizeof(USBD_VideoControlTypeDef)));
     }
     else
@@ -835,17 +828,20 @@ static void VIDEO_REQ_SetCurrent(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef
 /**
   * @brief  USBD_VIDEO_GetFSCfgDesc
   *         return configuration descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_VIDEO_GetFSCfgDesc(uint16_t *length)
+static uint8_t *USBD_VIDEO_GetFSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
-  USBD_EpDescTypedef *pEpDesc = USBD_VIDEO_GetEpDesc(USBD_VIDEO_CfgDesc, UVC_IN_EP);
+  UNUSED(pdev);
+
+  USBD_EpDescTypedef *pEpDesc = USBD_VIDEO_GetEpDesc(USBD_VIDEO_CfgDesc, UVC_IN_EP(pdev));
   USBD_VIDEO_VSFrameDescTypeDef *pVSFrameDesc = USBD_VIDEO_GetVSFrameDesc(USBD_VIDEO_CfgDesc);
 
   if (pEpDesc != NULL)
   {
-    pEpDesc->wMaxPacketSize = UVC_ISO_FS_MPS;
+    pEpDesc->wMaxPacketSize = USBD_VIDEO_IsoMPS(pdev, USBD_SPEED_FULL);
   }
 
   if (pVSFrameDesc != NULL)
@@ -863,17 +859,20 @@ static uint8_t *USBD_VIDEO_GetFSCfgDesc(uint16_t *length)
 /**
   * @brief  USBD_VIDEO_GetHSCfgDesc
   *         return configuration descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_VIDEO_GetHSCfgDesc(uint16_t *length)
+static uint8_t *USBD_VIDEO_GetHSCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
-  USBD_EpDescTypedef *pEpDesc = USBD_VIDEO_GetEpDesc(USBD_VIDEO_CfgDesc, UVC_IN_EP);
+  UNUSED(pdev);
+
+  USBD_EpDescTypedef *pEpDesc = USBD_VIDEO_GetEpDesc(USBD_VIDEO_CfgDesc, UVC_IN_EP(pdev));
   USBD_VIDEO_VSFrameDescTypeDef *pVSFrameDesc = USBD_VIDEO_GetVSFrameDesc(USBD_VIDEO_CfgDesc);
 
   if (pEpDesc != NULL)
   {
-    pEpDesc->wMaxPacketSize = UVC_ISO_HS_MPS;
+    pEpDesc->wMaxPacketSize = USBD_VIDEO_IsoMPS(pdev, USBD_SPEED_HIGH);
   }
 
   if (pVSFrameDesc != NULL)
@@ -891,17 +890,20 @@ static uint8_t *USBD_VIDEO_GetHSCfgDesc(uint16_t *length)
 /**
   * @brief  USBD_VIDEO_GetOtherSpeedCfgDesc
   *         return configuration descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_VIDEO_GetOtherSpeedCfgDesc(uint16_t *length)
+static uint8_t *USBD_VIDEO_GetOtherSpeedCfgDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
-  USBD_EpDescTypedef *pEpDesc = USBD_VIDEO_GetEpDesc(USBD_VIDEO_CfgDesc, UVC_IN_EP);
+  UNUSED(pdev);
+
+  USBD_EpDescTypedef *pEpDesc = USBD_VIDEO_GetEpDesc(USBD_VIDEO_CfgDesc, UVC_IN_EP(pdev));
   USBD_VIDEO_VSFrameDescTypeDef *pVSFrameDesc = USBD_VIDEO_GetVSFrameDesc(USBD_VIDEO_CfgDesc);
 
   if (pEpDesc != NULL)
   {
-    pEpDesc->wMaxPacketSize = UVC_ISO_FS_MPS;
+    pEpDesc->wMaxPacketSize = USBD_VIDEO_IsoMPS(pdev, USBD_SPEED_FULL);
   }
 
   if (pVSFrameDesc != NULL)
@@ -919,11 +921,14 @@ static uint8_t *USBD_VIDEO_GetOtherSpeedCfgDesc(uint16_t *length)
 /**
   * @brief  DeviceQualifierDescriptor
   *         return Device Qualifier descriptor
+  * @param  pdev: device instance
   * @param  length : pointer data length
   * @retval pointer to descriptor buffer
   */
-static uint8_t *USBD_VIDEO_GetDeviceQualifierDesc(uint16_t *length)
+static uint8_t *USBD_VIDEO_GetDeviceQualifierDesc(USBD_HandleTypeDef *pdev, uint16_t *length)
 {
+  UNUSED(pdev);
+
   *length = (uint16_t)(sizeof(USBD_VIDEO_DeviceQualifierDesc));
   return USBD_VIDEO_DeviceQualifierDesc;
 }
@@ -1022,6 +1027,25 @@ static void *USBD_VIDEO_GetEpDesc(uint8_t *pConfDesc, uint8_t EpAddr)
   return (void *)pEpDesc;
 }
 
+/**
+  * @brief  USBD_VIDEO_IsoMPS
+  *         Return the isochronous packet size selected for a speed
+  * @param  pdev: device instance
+  * @param  speed: USBD_SPEED_HIGH or USBD_SPEED_FULL
+  * @retval packet size
+  */
+static uint16_t USBD_VIDEO_IsoMPS(USBD_HandleTypeDef *pdev, uint8_t speed)
+{
+  if (speed == (uint8_t)USBD_SPEED_HIGH)
+  {
+    return (USBD_VIDEO_IsoMaxPacket[USBD_DEV_IDX(pdev)][1] != 0U) ?
+           USBD_VIDEO_IsoMaxPacket[USBD_DEV_IDX(pdev)][1] : (uint16_t)UVC_ISO_HS_MPS;
+  }
+
+  return (USBD_VIDEO_IsoMaxPacket[USBD_DEV_IDX(pdev)][0] != 0U) ?
+         USBD_VIDEO_IsoMaxPacket[USBD_DEV_IDX(pdev)][0] : (uint16_t)UVC_ISO_FS_MPS;
+}
+
 /**
   * @brief  USBD_VIDEO_RegisterInterface
   * @param  pdev: instance
@@ -1030,6 +1054,11 @@ static void *USBD_VIDEO_GetEpDesc(uint8_t *pConfDesc, uint8_t EpAddr)
   */
 uint8_t USBD_VIDEO_RegisterInterface(USBD_HandleTypeDef *pdev, USBD_VIDEO_ItfTypeDef *fops)
 {
+  if (USBD_CoreFindClass(pdev, &USBD_VIDEO) != USBD_OK)
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
   /* Check if the FOPS pointer is valid */
   if (fops == NULL)
   {
@@ -1037,13 +1066,48 @@ uint8_t USBD_VIDEO_RegisterInterface(USBD_HandleTypeDef *pdev, USBD_VIDEO_ItfTyp
   }
 
   /* Assign the FOPS pointer */
-  pdev->pUserData_UVC = fops;
+  USBD_USER_DATA(pdev) = fops;
 
   /* Exit with no error code */
   return (uint8_t)USBD_OK;
 }
 
-void USBD_Update_UVC_DESC(uint8_t *desc, uint8_t vc_itf, uint8_t vs_itf, uint8_t in_ep, uint8_t str_idx)
+/**
+  * @brief  USBD_VIDEO_SetIsoMPS
+  *         Select the isochronous packet size of the streaming endpoint,
+  *         used by the configuration descriptors built afterwards
+  * @param  pdev: instance
+  * @param  fs_mps: full speed packet size, 0 restores UVC_ISO_FS_MPS
+  * @param  hs_mps: high speed packet size, 0 restores UVC_ISO_HS_MPS
+  * @retval status
+  */
+uint8_t USBD_VIDEO_SetIsoMPS(USBD_HandleTypeDef *pdev, uint16_t fs_mps, uint16_t hs_mps)
+{
+  /* The bandwidth gets lower, the descriptors keep their size */
+  if ((fs_mps > UVC_ISO_FS_MPS) || (hs_mps > UVC_ISO_HS_MPS))
+  {
+    return (uint8_t)USBD_FAIL;
+  }
+
+  USBD_VIDEO_IsoMaxPacket[USBD_DEV_IDX(pdev)][0] = fs_mps;
+  USBD_VIDEO_IsoMaxPacket[USBD_DEV_IDX(pdev)][1] = hs_mps;
+
+  return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_VIDEO_GetIsoMPS
+  *         Return the isochronous packet size of the streaming endpoint
+  * @param  pdev: instance
+  * @param  speed: USBD_SPEED_HIGH or USBD_SPEED_FULL
+  * @retval packet size
+  */
+uint16_t USBD_VIDEO_GetIsoMPS(USBD_HandleTypeDef *pdev, uint8_t speed)
+{
+  return USBD_VIDEO_IsoMPS(pdev, speed);
+}
+
+void USBD_Update_UVC_DESC(USBD_HandleTypeDef *pdev, uint8_t *desc, uint8_t vc_itf, uint8_t vs_itf, uint8_t in_ep, uint8_t str_idx)
 {
 #ifdef USBD_UVC_FORMAT_UNCOMPRESSED
 #define _OFFSET 44
@@ -1060,10 +1124,10 @@ void USBD_Update_UVC_DESC(uint8_t *desc, uint8_t vc_itf, uint8_t vs_itf, uint8_t
   desc[100 + _OFFSET] = vs_itf;
   desc[109 + _OFFSET] = in_ep;
 
-  UVC_IN_EP = in_ep;
-  UVC_VC_IF_NUM = vc_itf;
-  UVC_VS_IF_NUM = vs_itf;
-  UVC_STR_DESC_IDX = str_idx;
+  USBD_CLASS_MAP(pdev).in_ep = in_ep;
+  USBD_CLASS_MAP(pdev).itf_nbr = vc_itf;
+  USBD_CLASS_MAP(pdev).itf_num = 2U;
+  USBD_CLASS_MAP(pdev).str_idx = str_idx;
 }
 
 /**
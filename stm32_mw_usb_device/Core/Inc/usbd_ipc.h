@@ -0,0 +1,178 @@
+/**
+  ******************************************************************************
+  * @file    usbd_ipc.h
+  * @brief   Header file for the usbd_ipc.c file
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_IPC_H
+#define __USBD_IPC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include  "usbd_def.h"
+
+/** @addtogroup STM32_USB_DEVICE_LIBRARY
+  * @{
+  */
+
+/** @defgroup USBD_IPC
+  * @brief header file for the usbd_ipc.c file
+  * @{
+  */
+
+#if (USBD_USE_IPC == 1U)
+
+/** @defgroup USBD_IPC_Exported_Defines
+  * @{
+  */
+
+/* Messages each ring holds, a power of two. It must cover every message
+   that can be in flight at once: the receive buffers of each class, the
+   IN queue depth of each class and one call */
+#ifndef USBD_IPC_RING_SIZE
+#define USBD_IPC_RING_SIZE                              32U
+#endif /* USBD_IPC_RING_SIZE */
+
+/* Polls of a full ring, or of the reply of a call the service side has not
+   started, before giving up */
+#ifndef USBD_IPC_SPIN
+#define USBD_IPC_SPIN                                   1000000U
+#endif /* USBD_IPC_SPIN */
+
+/* Orders the accesses to the shared memory seen by the other core */
+#ifndef USBD_IPC_BARRIER
+#define USBD_IPC_BARRIER()                              __DMB()
+#endif /* USBD_IPC_BARRIER */
+
+#if ((USBD_IPC_RING_SIZE & (USBD_IPC_RING_SIZE - 1U)) != 0U)
+#error "USBD_IPC_RING_SIZE must be a power of two"
+#endif
+
+/* Rings, named after the side that drains them */
+#define USBD_IPC_TO_SERVICE                             0U
+#define USBD_IPC_TO_STACK                               1U
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_IPC_Exported_Types
+  * @{
+  */
+
+/* One message, the buffer it points to belongs to the receiving side until
+   the matching release, completion or reply comes back */
+typedef struct
+{
+  uint8_t  op;         /* operation, defined by the interface layer */
+  uint8_t  itf;        /* class the message is for */
+  uint8_t  ch;         /* channel or logical unit */
+  int8_t   status;     /* result of the operation */
+  uint32_t seq;        /* call sequence, 0 for a posted message */
+  uint32_t arg[2];
+  uint8_t  *pbuf;
+  uint32_t len;
+} USBD_IPC_MsgTypeDef;
+
+/* Single producer, single consumer ring */
+typedef struct
+{
+  volatile uint32_t head;   /* written by the producer only */
+  volatile uint32_t tail;   /* written by the consumer only */
+  USBD_IPC_MsgTypeDef msg[USBD_IPC_RING_SIZE];
+} USBD_IPC_RingTypeDef;
+
+/* Result of the call in progress, the stack side makes one call at a time.
+   The service side claims a call before it touches its buffer and the
+   stack side cancels one it gave up on: of the two, whichever comes second
+   sees the other, so a buffer is never handed back while in use */
+typedef struct
+{
+  volatile uint32_t seq;
+  volatile int32_t  status;
+  volatile uint32_t arg[2];
+  uint8_t *volatile pbuf;
+  volatile uint32_t claim;  /* call the service side runs, written by it only */
+  volatile uint32_t cancel; /* call the stack side gave up, written by it only */
+} USBD_IPC_ReplyTypeDef;
+
+/* Everything both cores share, placed in the .usbd_ipc section */
+typedef struct
+{
+  USBD_IPC_RingTypeDef ring[2];
+  USBD_IPC_ReplyTypeDef reply;
+} USBD_IPC_ShareTypeDef;
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_IPC_Exported_Macros
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_IPC_Exported_Variables
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_IPC_Exported_FunctionsPrototype
+  * @{
+  */
+
+USBD_StatusTypeDef USBD_IPC_Put(USBD_IPC_RingTypeDef *pring, const USBD_IPC_MsgTypeDef *pmsg);
+USBD_StatusTypeDef USBD_IPC_Get(USBD_IPC_RingTypeDef *pring, USBD_IPC_MsgTypeDef *pmsg);
+
+void USBD_IPC_Init(void);
+USBD_StatusTypeDef USBD_IPC_Post(uint8_t ring, const USBD_IPC_MsgTypeDef *pmsg);
+USBD_StatusTypeDef USBD_IPC_Call(USBD_IPC_MsgTypeDef *pmsg);
+USBD_StatusTypeDef USBD_IPC_Claim(const USBD_IPC_MsgTypeDef *pmsg);
+void USBD_IPC_Reply(const USBD_IPC_MsgTypeDef *pmsg);
+USBD_StatusTypeDef USBD_IPC_Receive(uint8_t ring, USBD_IPC_MsgTypeDef *pmsg);
+
+/* Supplied by the interface layer: signal the side draining a ring */
+void USBD_IPC_Doorbell(uint8_t ring);
+
+/**
+  * @}
+  */
+
+#endif /* (USBD_USE_IPC == 1U) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_IPC_H */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+/********************************** END OF FILE *******************************/
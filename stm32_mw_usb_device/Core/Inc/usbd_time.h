@@ -0,0 +1,127 @@
+/**
+  ******************************************************************************
+  * @file    usbd_time.h
+  * @brief   Header file for the usbd_time.c file
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_TIME_H
+#define __USBD_TIME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include  "usbd_def.h"
+
+/** @addtogroup STM32_USB_DEVICE_LIBRARY
+  * @{
+  */
+
+/** @defgroup USBD_TIME
+  * @brief header file for the usbd_time.c file
+  * @{
+  */
+
+#if (USBD_USE_TIMEBASE == 1U)
+
+/** @defgroup USBD_TIME_Exported_Defines
+  * @{
+  */
+
+/* Proportional gain of the SOF tracking loop, 1 / 2^n of the phase error */
+#ifndef USBD_TIME_KP_SHIFT
+#define USBD_TIME_KP_SHIFT                              3U
+#endif /* USBD_TIME_KP_SHIFT */
+
+/* Integral gain of the SOF tracking loop, 1 / 2^n of the phase error */
+#ifndef USBD_TIME_KI_SHIFT
+#define USBD_TIME_KI_SHIFT                              8U
+#endif /* USBD_TIME_KI_SHIFT */
+
+/* Lock is reported after USBD_TIME_LOCK_COUNT SOFs once the mean phase error
+   is within USBD_TIME_LOCK_US */
+#ifndef USBD_TIME_LOCK_COUNT
+#define USBD_TIME_LOCK_COUNT                            64U
+#endif /* USBD_TIME_LOCK_COUNT */
+
+#ifndef USBD_TIME_LOCK_US
+#define USBD_TIME_LOCK_US                               2U
+#endif /* USBD_TIME_LOCK_US */
+
+#define USBD_TIME_US_PER_UFRAME                         125U
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_TIME_Exported_Types
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_TIME_Exported_Macros
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_TIME_Exported_Variables
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_TIME_Exported_FunctionsPrototype
+  * @{
+  */
+
+void USBD_Time_SOF(USBD_HandleTypeDef *pdev, uint32_t ts);
+void USBD_Time_Reset(USBD_HandleTypeDef *pdev);
+
+uint8_t USBD_Time_IsLocked(USBD_HandleTypeDef *pdev);
+int32_t USBD_Time_GetDrift(USBD_HandleTypeDef *pdev);
+uint64_t USBD_Time_ToFrameTime(USBD_HandleTypeDef *pdev, uint32_t ts);
+uint32_t USBD_Time_ToLocalTime(USBD_HandleTypeDef *pdev, uint64_t usb_us);
+uint64_t USBD_Time_Now(USBD_HandleTypeDef *pdev);
+
+/**
+  * @}
+  */
+
+#endif /* (USBD_USE_TIMEBASE == 1U) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_TIME_H */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+/********************************** END OF FILE *******************************/
@@ -0,0 +1,111 @@
+/**
+  ******************************************************************************
+  * @file    usbd_xfer.h
+  * @brief   Header file for the usbd_xfer.c file
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_XFER_H
+#define __USBD_XFER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include  "usbd_def.h"
+
+/** @addtogroup STM32_USB_DEVICE_LIBRARY
+  * @{
+  */
+
+/** @defgroup USBD_XFER
+  * @brief header file for the usbd_xfer.c file
+  * @{
+  */
+
+/** @defgroup USBD_XFER_Exported_Defines
+  * @{
+  */
+
+/* Transfer descriptor flags */
+#define USBD_XFER_FLAG_NONE                             0x00U
+#define USBD_XFER_FLAG_ZLP                              0x01U /* IN: terminate MPS multiple with a ZLP */
+
+/* Transfer descriptor states */
+#define USBD_XFER_STATE_IDLE                            0x00U
+#define USBD_XFER_STATE_RESERVED                        0x01U /* taken from a pool, not yet submitted */
+#define USBD_XFER_STATE_QUEUED                          0x02U
+#define USBD_XFER_STATE_ACTIVE                          0x03U
+#define USBD_XFER_STATE_ZLP                             0x04U
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_XFER_Exported_Types
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_XFER_Exported_Macros
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_XFER_Exported_Variables
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_XFER_Exported_FunctionsPrototype
+  * @{
+  */
+
+USBD_StatusTypeDef USBD_Xfer_Submit(USBD_HandleTypeDef *pdev, USBD_XferTypeDef *xfer);
+USBD_StatusTypeDef USBD_Xfer_Flush(USBD_HandleTypeDef *pdev, uint8_t ep_addr);
+USBD_XferTypeDef *USBD_Xfer_Alloc(USBD_XferTypeDef *pool, uint8_t count);
+uint8_t USBD_Xfer_IsIdle(USBD_HandleTypeDef *pdev, uint8_t ep_addr);
+
+USBD_StatusTypeDef USBD_Xfer_DataInStage(USBD_HandleTypeDef *pdev, uint8_t epnum);
+USBD_StatusTypeDef USBD_Xfer_DataOutStage(USBD_HandleTypeDef *pdev, uint8_t epnum);
+
+/**
+  * @}
+  */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_XFER_H */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+/********************************** END OF FILE *******************************/
@@ -403,14 +403,20 @@ static void USBD_GetDescriptor(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *r
       break;
 
     case USB_DESC_TYPE_CONFIGURATION:
-      if (pdev->dev_speed == USBD_SPEED_HIGH)
+      if ((uint8_t)(req->wValue) >= USBD_MAX_NUM_CONFIGURATION)
+      {
+        /* No such configuration index */
+        USBD_CtlError(pdev, req);
+        err++;
+      }
+      else if (pdev->dev_speed == USBD_SPEED_HIGH)
       {
-        pbuf = pdev->pClass->GetHSConfigDescriptor(&len);
+        pbuf = pdev->pClass->GetHSConfigDescriptor(pdev, &len);
         pbuf[1] = USB_DESC_TYPE_CONFIGURATION;
       }
       else
       {
-        pbuf = pdev->pClass->GetFSConfigDescriptor(&len);
+        pbuf = pdev->pClass->GetFSConfigDescriptor(pdev, &len);
         pbuf[1] = USB_DESC_TYPE_CONFIGURATION;
       }
       break;
@@ -526,7 +532,7 @@ static void USBD_GetDescriptor(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *r
     case USB_DESC_TYPE_DEVICE_QUALIFIER:
       if (pdev->dev_speed == USBD_SPEED_HIGH)
       {
-        pbuf = pdev->pClass->GetDeviceQualifierDescriptor(&len);
+        pbuf = pdev->pClass->GetDeviceQualifierDescriptor(pdev, &len);
       }
       else
       {
@@ -536,9 +542,10 @@ static void USBD_GetDescriptor(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *r
       break;
 
     case USB_DESC_TYPE_OTHER_SPEED_CONFIGURATION:
-      if (pdev->dev_speed == USBD_SPEED_HIGH)
+      if ((pdev->dev_speed == USBD_SPEED_HIGH) &&
+          ((uint8_t)(req->wValue) < USBD_MAX_NUM_CONFIGURATION))
       {
-        pbuf = pdev->pClass->GetOtherSpeedConfigDescriptor(&len);
+        pbuf = pdev->pClass->GetOtherSpeedConfigDescriptor(pdev, &len);
         pbuf[1] = USB_DESC_TYPE_OTHER_SPEED_CONFIGURATION;
       }
       else
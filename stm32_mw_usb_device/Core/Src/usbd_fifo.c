@@ -0,0 +1,217 @@
+/**
+  ******************************************************************************
+  * @file    usbd_fifo.c
+  * @brief   This file provides the FIFO RAM layout of the OTG cores.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_fifo.h"
+
+/** @addtogroup STM32_USBD_DEVICE_LIBRARY
+  * @{
+  */
+
+
+/** @defgroup USBD_FIFO
+  * @brief usbd FIFO layout module
+  *        The low level driver adds the transmit FIFO each IN endpoint of
+  *        the configuration needs, in any order, and the plan gives the RAM
+  *        left over to the data endpoints and places the FIFOs in increasing
+  *        endpoint number. HAL_PCDEx_SetTxFiFo derives the offset of a FIFO
+  *        from the ones below it, so they must be programmed in that order;
+  *        USBD_FiFo_Check verifies a layout read back from the core.
+  * @{
+  */
+
+/** @defgroup USBD_FIFO_Private_TypesDefinitions
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_FIFO_Private_Defines
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_FIFO_Private_Macros
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_FIFO_Private_FunctionPrototypes
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_FIFO_Private_Variables
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_FIFO_Private_Functions
+  * @{
+  */
+
+/**
+  * @brief  USBD_FiFo_Init
+  *         Start an empty layout
+  * @param  playout: layout
+  * @param  ram_size: FIFO RAM of the core in bytes
+  * @param  rx_size: receive FIFO in bytes
+  * @retval None
+  */
+void USBD_FiFo_Init(USBD_FiFo_LayoutTypeDef *playout, uint16_t ram_size, uint16_t rx_size)
+{
+  (void)USBD_memset(playout, 0, sizeof(*playout));
+  playout->ram_size = ram_size;
+  playout->rx_size = rx_size;
+}
+
+/**
+  * @brief  USBD_FiFo_Add
+  *         Add the transmit FIFO of an IN endpoint
+  * @param  playout: layout
+  * @param  ep_addr: endpoint address, EP0 included
+  * @param  size: smallest FIFO size in bytes
+  * @param  data: 1 for a bulk or isochronous endpoint, taking a share of the spare RAM
+  * @retval None
+  */
+void USBD_FiFo_Add(USBD_FiFo_LayoutTypeDef *playout, uint8_t ep_addr, uint16_t size, uint8_t data)
+{
+  uint8_t ep = ep_addr & 0xFU;
+
+  if ((ep_addr == 0U) || (ep >= USBD_FIFO_MAX_TX))
+  {
+    return;
+  }
+
+  playout->tx_size[ep] = (uint16_t)((size + 3U) & ~3U);
+
+  if (data != 0U)
+  {
+    playout->data |= (uint16_t)(1U << ep);
+  }
+}
+
+/**
+  * @brief  USBD_FiFo_Plan
+  *         Share the spare RAM among the data endpoints and place the
+  *         transmit FIFOs after the receive FIFO, in increasing endpoint
+  *         number
+  * @param  playout: layout
+  * @retval status: USBD_FAIL when the FIFOs do not fit in the RAM
+  */
+USBD_StatusTypeDef USBD_FiFo_Plan(USBD_FiFo_LayoutTypeDef *playout)
+{
+  uint32_t used = playout->rx_size;
+  uint32_t data_num = 0U;
+  uint32_t spare = 0U;
+  uint32_t offset;
+  uint8_t ep;
+
+  for (ep = 0U; ep < USBD_FIFO_MAX_TX; ep++)
+  {
+    used += playout->tx_size[ep];
+    data_num += (playout->data >> ep) & 1U;
+  }
+
+  if ((data_num != 0U) && (playout->ram_size > used))
+  {
+    spare = ((playout->ram_size - used) / data_num) & ~3UL;
+  }
+
+  offset = playout->rx_size;
+
+  for (ep = 0U; ep < USBD_FIFO_MAX_TX; ep++)
+  {
+    if (((playout->data >> ep) & 1U) != 0U)
+    {
+      playout->tx_size[ep] += (uint16_t)spare;
+    }
+
+    playout->tx_offset[ep] = (uint16_t)offset;
+    offset += playout->tx_size[ep];
+  }
+
+  return (used > playout->ram_size) ? USBD_FAIL : USBD_OK;
+}
+
+/**
+  * @brief  USBD_FiFo_Check
+  *         Check that the FIFOs stay in the RAM and none overlaps another
+  * @param  playout: layout, as planned or read back from the core
+  * @retval status: USBD_FAIL on an overlap or a FIFO out of the RAM
+  */
+USBD_StatusTypeDef USBD_FiFo_Check(const USBD_FiFo_LayoutTypeDef *playout)
+{
+  for (uint8_t i = 0U; i < USBD_FIFO_MAX_TX; i++)
+  {
+    uint32_t start = playout->tx_offset[i];
+    uint32_t end = start + playout->tx_size[i];
+
+    if (playout->tx_size[i] == 0U)
+    {
+      continue;
+    }
+
+    if ((start < playout->rx_size) || (end > playout->ram_size))
+    {
+      return USBD_FAIL;
+    }
+
+    for (uint8_t j = i + 1U; j < USBD_FIFO_MAX_TX; j++)
+    {
+      if ((playout->tx_size[j] != 0U) && (playout->tx_offset[j] < end) &&
+          (start < ((uint32_t)playout->tx_offset[j] + playout->tx_size[j])))
+      {
+        return USBD_FAIL;
+      }
+    }
+  }
+
+  return USBD_OK;
+}
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+
+/**
+  * @}
+  */
+
+/********************************** END OF FILE *******************************/
@@ -0,0 +1,383 @@
+/**
+  ******************************************************************************
+  * @file    usbd_time.c
+  * @brief   This file provides the SOF derived device time base.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_time.h"
+#include "usbd_core.h"
+
+/** @addtogroup STM32_USBD_DEVICE_LIBRARY
+  * @{
+  */
+
+
+/** @defgroup USBD_TIME
+  * @brief usbd time base module
+  *        Each SOF latches the (micro)frame number against a free running
+  *        local counter (USBD_LL_GetTimestamp). A second order tracking loop
+  *        filters the interrupt latency out of the latched time and learns
+  *        how many local ticks elapse per host microframe, which gives the
+  *        host to device clock ratio and lets local timestamps be converted
+  *        to USB frame time and back at microsecond resolution.
+  *        The SOF interrupt must be enabled in the PCD init (Sof_enable).
+  * @{
+  */
+
+#if (USBD_USE_TIMEBASE == 1U)
+
+/** @defgroup USBD_TIME_Private_TypesDefinitions
+  * @{
+  */
+
+typedef struct
+{
+  uint64_t uframe;     /* host time of the last SOF, in microframes */
+  uint32_t ts_est;     /* filtered local time of the last SOF */
+  uint32_t ts_raw;     /* local time latched at the last SOF */
+  uint32_t period;     /* local ticks per microframe, 20.12 fixed point */
+  uint64_t period_avg; /* period averaged over 2^USBD_TIME_AVG_SHIFT SOFs, scaled by as much */
+  uint32_t nominal;    /* period of a local clock exactly on frequency */
+  uint32_t err_avg;    /* running mean of the absolute phase error */
+  uint16_t frame;      /* last (micro)frame number read from the core */
+  uint8_t  valid;
+  uint8_t  lock_cnt;
+} USBD_TimeTypeDef;
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_TIME_Private_Defines
+  * @{
+  */
+
+#define USBD_TIME_FRAC_BITS                             12U
+#define USBD_TIME_FRAME_MASK                            0x3FFFU
+#define USBD_TIME_UFRAME_PER_SEC                        8000U
+
+/* The loop period follows the latency jitter of each SOF, the drift is
+   reported from its average */
+#define USBD_TIME_AVG_SHIFT                             8U
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_TIME_Private_Macros
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_TIME_Private_FunctionPrototypes
+  * @{
+  */
+
+static void USBD_Time_Snapshot(USBD_HandleTypeDef *pdev, USBD_TimeTypeDef *ptime);
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_TIME_Private_Variables
+  * @{
+  */
+
+static USBD_TimeTypeDef USBD_Time[USBD_MAX_NUM_DEV];
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_TIME_Private_Functions
+  * @{
+  */
+
+/**
+  * @brief  USBD_Time_SOF
+  *         Track the host frame clock, called from the SOF interrupt
+  * @param  pdev: device instance
+  * @param  ts: local time latched when the SOF interrupt was taken
+  * @retval None
+  */
+void USBD_Time_SOF(USBD_HandleTypeDef *pdev, uint32_t ts)
+{
+  USBD_TimeTypeDef *ptime = &USBD_Time[USBD_DEV_IDX(pdev)];
+  uint16_t frame = (uint16_t)USBD_LL_GetFrameNumber(pdev);
+  uint32_t ticks;
+  uint32_t delta;
+  uint32_t elapsed;
+  uint32_t pred;
+  int32_t err;
+  int32_t corr;
+
+  if (ptime->valid == 0U)
+  {
+    ptime->nominal = (uint32_t)(((uint64_t)USBD_LL_GetTimestampFreq() << USBD_TIME_FRAC_BITS) /
+                                USBD_TIME_UFRAME_PER_SEC);
+
+    /* A rate learnt before a bus reset is still right, keep it */
+    if (ptime->period == 0U)
+    {
+      ptime->period = ptime->nominal;
+      ptime->period_avg = (uint64_t)ptime->nominal << USBD_TIME_AVG_SHIFT;
+    }
+
+    ptime->uframe = frame;
+    ptime->frame = frame;
+    ptime->ts_est = ts;
+    ptime->ts_raw = ts;
+    ptime->lock_cnt = 0U;
+    ptime->err_avg = 0U;
+    ptime->valid = 1U;
+
+    return;
+  }
+
+  ticks = ptime->period >> USBD_TIME_FRAC_BITS;
+  delta = ((uint32_t)frame - ptime->frame) & USBD_TIME_FRAME_MASK;
+  elapsed = ts - ptime->ts_raw;
+
+  ptime->frame = frame;
+  ptime->ts_raw = ts;
+
+  /* After a gap of more than 2 ms (suspend, masked interrupt) the frame
+     counter may have wrapped, count the wraps on the local clock and start
+     tracking again from this SOF */
+  if (elapsed > (ticks * 16U))
+  {
+    uint32_t est = (uint32_t)(((uint64_t)elapsed << USBD_TIME_FRAC_BITS) / ptime->period);
+
+    if (est > delta)
+    {
+      delta += ((est - delta + ((USBD_TIME_FRAME_MASK + 1U) / 2U)) /
+                (USBD_TIME_FRAME_MASK + 1U)) * (USBD_TIME_FRAME_MASK + 1U);
+    }
+
+    ptime->uframe += delta;
+    ptime->ts_est = ts;
+    ptime->lock_cnt = 0U;
+
+    return;
+  }
+
+  if (delta == 0U)
+  {
+    return;
+  }
+
+  ptime->uframe += delta;
+
+  /* Phase error of this SOF against the time predicted by the loop */
+  pred = ptime->ts_est + (uint32_t)((((uint64_t)delta * ptime->period) +
+                                      (1UL << (USBD_TIME_FRAC_BITS - 1U))) >> USBD_TIME_FRAC_BITS);
+  err = (int32_t)(ts - pred);
+
+  if ((err > (int32_t)(ticks / 2U)) || (err < -(int32_t)(ticks / 2U)))
+  {
+    /* Off by more than half a microframe, restart from this SOF */
+    ptime->ts_est = ts;
+    ptime->lock_cnt = 0U;
+
+    return;
+  }
+
+  /* Proportional path corrects the phase, integral path the rate */
+  ptime->ts_est = pred + (uint32_t)(err / (int32_t)(1UL << USBD_TIME_KP_SHIFT));
+
+  corr = (err * (int32_t)(1UL << USBD_TIME_FRAC_BITS)) /
+         ((int32_t)delta << USBD_TIME_KI_SHIFT);
+  ptime->period = (uint32_t)((int32_t)ptime->period + corr);
+
+  /* USB clocks are within 500 ppm, keep the loop in a sane range */
+  if (ptime->period > (ptime->nominal + (ptime->nominal >> 8)))
+  {
+    ptime->period = ptime->nominal + (ptime->nominal >> 8);
+  }
+  else if (ptime->period < (ptime->nominal - (ptime->nominal >> 8)))
+  {
+    ptime->period = ptime->nominal - (ptime->nominal >> 8);
+  }
+  else
+  {
+  }
+
+  ptime->period_avg += (uint64_t)ptime->period - (ptime->period_avg >> USBD_TIME_AVG_SHIFT);
+
+  /* Interrupt latency jitter is averaged out of the lock decision */
+  ptime->err_avg = (uint32_t)((int32_t)ptime->err_avg +
+                              ((((err < 0) ? -err : err) - (int32_t)ptime->err_avg) / 16));
+
+  if (ptime->lock_cnt < USBD_TIME_LOCK_COUNT)
+  {
+    ptime->lock_cnt++;
+  }
+}
+
+/**
+  * @brief  USBD_Time_Reset
+  *         Drop the frame reference, the next SOF starts the tracking again
+  * @param  pdev: device instance
+  * @retval None
+  */
+void USBD_Time_Reset(USBD_HandleTypeDef *pdev)
+{
+  USBD_Time[USBD_DEV_IDX(pdev)].valid = 0U;
+  USBD_Time[USBD_DEV_IDX(pdev)].lock_cnt = 0U;
+}
+
+/**
+  * @brief  USBD_Time_IsLocked
+  *         Check whether the time base tracks the host frame clock
+  * @param  pdev: device instance
+  * @retval 1 once USBD_TIME_LOCK_COUNT SOFs were tracked and the mean phase
+  *         error is within USBD_TIME_LOCK_US
+  */
+uint8_t USBD_Time_IsLocked(USBD_HandleTypeDef *pdev)
+{
+  USBD_TimeTypeDef snap;
+
+  USBD_Time_Snapshot(pdev, &snap);
+
+  if ((snap.valid == 0U) || (snap.lock_cnt < USBD_TIME_LOCK_COUNT))
+  {
+    return 0U;
+  }
+
+  return (snap.err_avg <= (((snap.period >> USBD_TIME_FRAC_BITS) * USBD_TIME_LOCK_US) /
+                           USBD_TIME_US_PER_UFRAME)) ? 1U : 0U;
+}
+
+/**
+  * @brief  USBD_Time_GetDrift
+  *         Return the local clock offset against the host clock
+  * @param  pdev: device instance
+  * @retval drift in ppm, positive when the local clock runs fast
+  */
+int32_t USBD_Time_GetDrift(USBD_HandleTypeDef *pdev)
+{
+  USBD_TimeTypeDef snap;
+
+  USBD_Time_Snapshot(pdev, &snap);
+
+  if ((snap.valid == 0U) || (snap.nominal == 0U))
+  {
+    return 0;
+  }
+
+  return (int32_t)((((int64_t)(snap.period_avg >> USBD_TIME_AVG_SHIFT) - (int64_t)snap.nominal) *
+                    1000000) / (int64_t)snap.nominal);
+}
+
+/**
+  * @brief  USBD_Time_ToFrameTime
+  *         Convert a local timestamp to USB frame time
+  * @param  pdev: device instance
+  * @param  ts: local time, from USBD_LL_GetTimestamp
+  * @retval host time in us, counted from the frame number of the first SOF
+  */
+uint64_t USBD_Time_ToFrameTime(USBD_HandleTypeDef *pdev, uint32_t ts)
+{
+  USBD_TimeTypeDef snap;
+  int64_t dt;
+
+  USBD_Time_Snapshot(pdev, &snap);
+
+  if (snap.valid == 0U)
+  {
+    return 0U;
+  }
+
+  dt = (int64_t)(int32_t)(ts - snap.ts_est);
+  dt = (dt * ((int64_t)USBD_TIME_US_PER_UFRAME << USBD_TIME_FRAC_BITS)) / (int64_t)snap.period;
+
+  return (uint64_t)((int64_t)(snap.uframe * USBD_TIME_US_PER_UFRAME) + dt);
+}
+
+/**
+  * @brief  USBD_Time_ToLocalTime
+  *         Convert USB frame time to a local timestamp, the result is exact
+  *         for times within a few seconds of the last SOF
+  * @param  pdev: device instance
+  * @param  usb_us: host time in us, as returned by USBD_Time_ToFrameTime
+  * @retval local time, in USBD_LL_GetTimestamp ticks
+  */
+uint32_t USBD_Time_ToLocalTime(USBD_HandleTypeDef *pdev, uint64_t usb_us)
+{
+  USBD_TimeTypeDef snap;
+  int64_t dt;
+
+  USBD_Time_Snapshot(pdev, &snap);
+
+  if (snap.valid == 0U)
+  {
+    return 0U;
+  }
+
+  dt = (int64_t)(usb_us - (snap.uframe * USBD_TIME_US_PER_UFRAME));
+  dt = (dt * (int64_t)snap.period) / ((int64_t)USBD_TIME_US_PER_UFRAME << USBD_TIME_FRAC_BITS);
+
+  return snap.ts_est + (uint32_t)dt;
+}
+
+/**
+  * @brief  USBD_Time_Now
+  *         Return the current USB frame time
+  * @param  pdev: device instance
+  * @retval host time in us
+  */
+uint64_t USBD_Time_Now(USBD_HandleTypeDef *pdev)
+{
+  return USBD_Time_ToFrameTime(pdev, USBD_LL_GetTimestamp());
+}
+
+/**
+  * @brief  USBD_Time_Snapshot
+  *         Copy the tracking state without tearing against the SOF interrupt
+  * @param  pdev: device instance
+  * @param  ptime: copy of the state
+  * @retval None
+  */
+static void USBD_Time_Snapshot(USBD_HandleTypeDef *pdev, USBD_TimeTypeDef *ptime)
+{
+  uint32_t primask;
+
+  USBD_ENTER_CRITICAL(primask);
+  *ptime = USBD_Time[USBD_DEV_IDX(pdev)];
+  USBD_EXIT_CRITICAL(primask);
+}
+
+/**
+  * @}
+  */
+
+#endif /* (USBD_USE_TIMEBASE == 1U) */
+
+/**
+  * @}
+  */
+
+
+/**
+  * @}
+  */
+
+/********************************** END OF FILE *******************************/
@@ -0,0 +1,470 @@
+/**
+  ******************************************************************************
+  * @file    usbd_xfer.c
+  * @brief   This file provides the per endpoint transfer queues.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_xfer.h"
+#include "usbd_core.h"
+
+/** @addtogroup STM32_USBD_DEVICE_LIBRARY
+  * @{
+  */
+
+
+/** @defgroup USBD_XFER
+  * @brief usbd transfer queue module
+  *        Each non-control endpoint owns a FIFO of caller provided transfer
+  *        descriptors. The head of the queue is the transfer currently
+  *        programmed in the LL driver; when it completes the next one is
+  *        started from the completion interrupt, before the owner callback
+  *        runs, so back to back bulk transfers leave no idle gap on the bus.
+  * @{
+  */
+
+/** @defgroup USBD_XFER_Private_TypesDefinitions
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_XFER_Private_Defines
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_XFER_Private_Macros
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_XFER_Private_FunctionPrototypes
+  * @{
+  */
+
+static USBD_EndpointTypeDef *USBD_Xfer_GetEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr);
+static USBD_StatusTypeDef USBD_Xfer_Start(USBD_HandleTypeDef *pdev, USBD_EndpointTypeDef *pep,
+                                          USBD_XferTypeDef *xfer);
+static void USBD_Xfer_Complete(USBD_HandleTypeDef *pdev, USBD_EndpointTypeDef *pep,
+                               USBD_XferTypeDef *xfer);
+static void USBD_Xfer_Notify(USBD_HandleTypeDef *pdev, USBD_XferTypeDef *xfer);
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_XFER_Private_Variables
+  * @{
+  */
+
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_XFER_Private_Functions
+  * @{
+  */
+
+/**
+  * @brief  USBD_Xfer_Submit
+  *         Queue a transfer descriptor on its endpoint, the transfer is
+  *         started at once when the endpoint queue is empty
+  * @param  pdev: device instance
+  * @param  xfer: transfer descriptor, owned by the stack until its Cplt runs
+  * @retval status, the LL status when the transfer could not be started; the
+  *         descriptor is then idle again and its Cplt is not called
+  */
+USBD_StatusTypeDef USBD_Xfer_Submit(USBD_HandleTypeDef *pdev, USBD_XferTypeDef *xfer)
+{
+  USBD_EndpointTypeDef *pep;
+  USBD_StatusTypeDef ret = USBD_OK;
+  uint32_t primask;
+
+  if (xfer == NULL)
+  {
+    return USBD_FAIL;
+  }
+
+  if ((xfer->state != USBD_XFER_STATE_IDLE) &&
+      (xfer->state != USBD_XFER_STATE_RESERVED))
+  {
+    return USBD_BUSY;
+  }
+
+  pep = USBD_Xfer_GetEP(pdev, xfer->ep_addr);
+  xfer->next = NULL;
+  xfer->classId = pdev->classId;
+  xfer->status = (uint8_t)USBD_OK;
+  xfer->xfer_count = 0U;
+
+  /* A segmented IN transfer is as long as all of its segments */
+  if (xfer->nseg != 0U)
+  {
+    xfer->length = 0U;
+
+    for (uint8_t i = 0U; i < xfer->nseg; i++)
+    {
+      xfer->length += xfer->pSeg[i].length;
+    }
+  }
+
+  USBD_ENTER_CRITICAL(primask);
+
+  if (pep->xfer_tail == NULL)
+  {
+    pep->xfer_head = xfer;
+    pep->xfer_tail = xfer;
+#if (USBD_LPM_ENABLED == 1U)
+    USBD_LPM_SetEPBusy(pdev, xfer->ep_addr, 1U);
+#endif /* (USBD_LPM_ENABLED == 1U) */
+    ret = USBD_Xfer_Start(pdev, pep, xfer);
+
+    /* Not programmed, leave the endpoint queue as it was */
+    if (ret != USBD_OK)
+    {
+      pep->xfer_head = NULL;
+      pep->xfer_tail = NULL;
+#if (USBD_LPM_ENABLED == 1U)
+      USBD_LPM_SetEPBusy(pdev, xfer->ep_addr, 0U);
+#endif /* (USBD_LPM_ENABLED == 1U) */
+      xfer->state = USBD_XFER_STATE_IDLE;
+    }
+  }
+  else
+  {
+    xfer->state = USBD_XFER_STATE_QUEUED;
+    pep->xfer_tail->next = xfer;
+    pep->xfer_tail = xfer;
+  }
+
+  USBD_EXIT_CRITICAL(primask);
+
+  return ret;
+}
+
+/**
+  * @brief  USBD_Xfer_Flush
+  *         Drop every queued transfer of an endpoint without calling the
+  *         owner callbacks, the descriptors are returned to the idle state
+  * @param  pdev: device instance
+  * @param  ep_addr: endpoint address
+  * @retval status
+  */
+USBD_StatusTypeDef USBD_Xfer_Flush(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  USBD_EndpointTypeDef *pep = USBD_Xfer_GetEP(pdev, ep_addr);
+  USBD_XferTypeDef *xfer;
+  uint32_t primask;
+
+  USBD_ENTER_CRITICAL(primask);
+
+  xfer = pep->xfer_head;
+  pep->xfer_head = NULL;
+  pep->xfer_tail = NULL;
+#if (USBD_LPM_ENABLED == 1U)
+  USBD_LPM_SetEPBusy(pdev, ep_addr, 0U);
+#endif /* (USBD_LPM_ENABLED == 1U) */
+
+  while (xfer != NULL)
+  {
+    USBD_XferTypeDef *next = xfer->next;
+
+    xfer->next = NULL;
+    xfer->state = USBD_XFER_STATE_IDLE;
+    xfer = next;
+  }
+
+  USBD_EXIT_CRITICAL(primask);
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_Xfer_Alloc
+  *         Reserve the first idle descriptor of a class owned pool
+  * @param  pool: descriptor array
+  * @param  count: number of descriptors in the array
+  * @retval reserved descriptor, NULL when every descriptor is in flight
+  */
+USBD_XferTypeDef *USBD_Xfer_Alloc(USBD_XferTypeDef *pool, uint8_t count)
+{
+  USBD_XferTypeDef *xfer = NULL;
+  uint32_t primask;
+
+  USBD_ENTER_CRITICAL(primask);
+
+  for (uint8_t i = 0U; i < count; i++)
+  {
+    if (pool[i].state == USBD_XFER_STATE_IDLE)
+    {
+      pool[i].state = USBD_XFER_STATE_RESERVED;
+      xfer = &pool[i];
+      break;
+    }
+  }
+
+  USBD_EXIT_CRITICAL(primask);
+
+  return xfer;
+}
+
+/**
+  * @brief  USBD_Xfer_IsIdle
+  *         Check whether an endpoint has no queued transfer
+  * @param  pdev: device instance
+  * @param  ep_addr: endpoint address
+  * @retval 1 when the queue is empty, 0 otherwise
+  */
+uint8_t USBD_Xfer_IsIdle(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  return (USBD_Xfer_GetEP(pdev, ep_addr)->xfer_head == NULL) ? 1U : 0U;
+}
+
+/**
+  * @brief  USBD_Xfer_DataInStage
+  *         Handle the completion of the transfer at the head of an IN queue
+  * @param  pdev: device instance
+  * @param  epnum: endpoint index
+  * @retval USBD_OK when the endpoint is served by a queue, USBD_FAIL otherwise
+  */
+USBD_StatusTypeDef USBD_Xfer_DataInStage(USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  USBD_EndpointTypeDef *pep = &pdev->ep_in[epnum & 0xFU];
+  USBD_XferTypeDef *xfer = pep->xfer_head;
+
+  if (xfer == NULL)
+  {
+    return USBD_FAIL;
+  }
+
+  /* last packet is MPS multiple, so send ZLP packet */
+  if ((xfer->state == USBD_XFER_STATE_ACTIVE) &&
+      ((xfer->flags & USBD_XFER_FLAG_ZLP) != 0U) &&
+      (xfer->length > 0U) && (pep->maxpacket > 0U) &&
+      ((xfer->length % pep->maxpacket) == 0U))
+  {
+    xfer->state = USBD_XFER_STATE_ZLP;
+    pep->total_length = 0U;
+
+    if (USBD_LL_Transmit(pdev, xfer->ep_addr, NULL, 0U) == USBD_OK)
+    {
+      return USBD_OK;
+    }
+
+    /* The data went out, only the terminating ZLP is missing */
+  }
+
+  xfer->xfer_count = xfer->length;
+  USBD_Xfer_Complete(pdev, pep, xfer);
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_Xfer_DataOutStage
+  *         Handle the completion of the transfer at the head of an OUT queue
+  * @param  pdev: device instance
+  * @param  epnum: endpoint index
+  * @retval USBD_OK when the endpoint is served by a queue, USBD_FAIL otherwise
+  */
+USBD_StatusTypeDef USBD_Xfer_DataOutStage(USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  USBD_EndpointTypeDef *pep = &pdev->ep_out[epnum & 0xFU];
+  USBD_XferTypeDef *xfer = pep->xfer_head;
+
+  if (xfer == NULL)
+  {
+    return USBD_FAIL;
+  }
+
+  xfer->xfer_count = USBD_LL_GetRxDataSize(pdev, epnum);
+  USBD_Xfer_Complete(pdev, pep, xfer);
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_Xfer_GetEP
+  *         Return the endpoint state matching an endpoint address
+  * @param  pdev: device instance
+  * @param  ep_addr: endpoint address
+  * @retval endpoint state
+  */
+static USBD_EndpointTypeDef *USBD_Xfer_GetEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  if ((ep_addr & 0x80U) == 0x80U)
+  {
+    return &pdev->ep_in[ep_addr & 0xFU];
+  }
+
+  return &pdev->ep_out[ep_addr & 0xFU];
+}
+
+/**
+  * @brief  USBD_Xfer_Start
+  *         Program the head transfer in the LL driver
+  * @param  pdev: device instance
+  * @param  pep: endpoint state
+  * @param  xfer: transfer descriptor
+  * @retval LL status, also kept in the descriptor
+  */
+static USBD_StatusTypeDef USBD_Xfer_Start(USBD_HandleTypeDef *pdev, USBD_EndpointTypeDef *pep,
+                                          USBD_XferTypeDef *xfer)
+{
+  USBD_StatusTypeDef ret;
+
+  xfer->state = USBD_XFER_STATE_ACTIVE;
+
+  if ((xfer->ep_addr & 0x80U) == 0x80U)
+  {
+    /* Update the packet total length */
+    pep->total_length = xfer->length;
+
+    if (xfer->nseg != 0U)
+    {
+      ret = USBD_LL_TransmitV(pdev, xfer->ep_addr, xfer->pSeg, xfer->nseg);
+    }
+    else
+    {
+      ret = USBD_LL_Transmit(pdev, xfer->ep_addr, xfer->pbuf, xfer->length);
+    }
+  }
+  else
+  {
+    ret = USBD_LL_PrepareReceive(pdev, xfer->ep_addr, xfer->pbuf, xfer->length);
+  }
+
+  xfer->status = (uint8_t)ret;
+
+  return ret;
+}
+
+/**
+  * @brief  USBD_Xfer_Complete
+  *         Retire the head transfer, start the next one and notify the owner.
+  *         A queued transfer the LL driver refuses to start is retired too,
+  *         its Cplt runs with the LL status and no data
+  * @param  pdev: device instance
+  * @param  pep: endpoint state
+  * @param  xfer: completed transfer descriptor
+  * @retval None
+  */
+static void USBD_Xfer_Complete(USBD_HandleTypeDef *pdev, USBD_EndpointTypeDef *pep,
+                               USBD_XferTypeDef *xfer)
+{
+  USBD_XferTypeDef *failed = NULL;
+  USBD_XferTypeDef *next;
+  uint32_t primask;
+
+  USBD_ENTER_CRITICAL(primask);
+
+  pep->xfer_head = xfer->next;
+
+  while ((pep->xfer_head != NULL) &&
+         (USBD_Xfer_Start(pdev, pep, pep->xfer_head) != USBD_OK))
+  {
+    /* Unlinked and kept in order, notified once out of the critical section */
+    next = pep->xfer_head;
+    pep->xfer_head = next->next;
+    next->next = NULL;
+
+    if (failed == NULL)
+    {
+      failed = next;
+    }
+    else
+    {
+      USBD_XferTypeDef *last = failed;
+
+      while (last->next != NULL)
+      {
+        last = last->next;
+      }
+      last->next = next;
+    }
+  }
+
+  if (pep->xfer_head == NULL)
+  {
+    pep->xfer_tail = NULL;
+#if (USBD_LPM_ENABLED == 1U)
+    USBD_LPM_SetEPBusy(pdev, xfer->ep_addr, 0U);
+#endif /* (USBD_LPM_ENABLED == 1U) */
+  }
+
+  USBD_EXIT_CRITICAL(primask);
+
+  xfer->status = (uint8_t)USBD_OK;
+  USBD_Xfer_Notify(pdev, xfer);
+
+  while (failed != NULL)
+  {
+    next = failed->next;
+    failed->xfer_count = 0U;
+    USBD_Xfer_Notify(pdev, failed);
+    failed = next;
+  }
+}
+
+/**
+  * @brief  USBD_Xfer_Notify
+  *         Return a retired descriptor to the idle state and call its owner
+  * @param  pdev: device instance
+  * @param  xfer: retired transfer descriptor
+  * @retval None
+  */
+static void USBD_Xfer_Notify(USBD_HandleTypeDef *pdev, USBD_XferTypeDef *xfer)
+{
+  uint8_t classId = pdev->classId;
+
+  /* Descriptor is idle again before the callback so it can be resubmitted */
+  xfer->next = NULL;
+  xfer->state = USBD_XFER_STATE_IDLE;
+
+  /* The callback runs for the class instance that submitted the transfer */
+  if (xfer->Cplt != NULL)
+  {
+    pdev->classId = xfer->classId;
+    xfer->Cplt(pdev, xfer);
+    pdev->classId = classId;
+  }
+}
+
+/**
+  * @}
+  */
+
+
+/**
+  * @}
+  */
+
+
+/**
+  * @}
+  */
+
+/********************************** END OF FILE *******************************/
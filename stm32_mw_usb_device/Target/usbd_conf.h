@@ -76,6 +76,44 @@
 /*---------- -----------*/
 #define USBD_SELF_POWERED                 1U
 /*---------- -----------*/
+#define USBD_MAX_NUM_DEV                  1U
+/*---------- -----------*/
+#define USBD_MAX_CLASS_NUM                16U
+/*---------- -----------*/
+#define USBD_MAX_EP_NUM                   9U
+/*---------- -----------*/
+#define USBD_LL_TXV_CHANNELS              2U
+/*---------- -----------*/
+#define USBD_LL_TXV_MAX_SEGMENTS          4U
+/*---------- -----------*/
+#define USBD_LL_TXV_STAGE_SIZE            512U
+/*---------- -----------*/
+#define USBD_LL_HS_FIFO_RAM_SIZE          4096U
+/*---------- -----------*/
+#define USBD_LL_FS_FIFO_RAM_SIZE          4096U
+/*---------- -----------*/
+#define USBD_LL_DEDICATED_EP1             0U
+/*---------- -----------*/
+#define USBD_USE_OS                       0U
+/*---------- -----------*/
+#define USBD_USE_TIMEBASE                 0U
+/*---------- -----------*/
+#define USBD_ENUM_TRACE                   0U
+/*---------- -----------*/
+#define USBD_USE_GOVERNOR                 0U
+/*---------- -----------*/
+#define USBD_USE_IPC                      0U
+/*---------- -----------*/
+#define USBD_USE_CDC_BRIDGE               0U
+/*---------- -----------*/
+#define USBD_USE_CDC_LOG                  0U
+/*---------- -----------*/
+#define USBD_USE_CDC_BENCH                0U
+/*---------- -----------*/
+#define USBD_USE_CDC_FRAME                0U
+/*---------- -----------*/
+#define USBD_DEFER_CLASS_INIT             0U
+/*---------- -----------*/
 
 
 /****************************************/
@@ -109,6 +147,14 @@
 /** Alias for delay. */
 #define USBD_Delay          HAL_Delay
 
+/* Critical section macros, used by the endpoint transfer queues */
+
+/** Save the interrupt mask in primask and disable interrupts. */
+#define USBD_ENTER_CRITICAL(primask)  do { (primask) = __get_PRIMASK(); __disable_irq(); } while (0)
+
+/** Restore the interrupt mask saved by USBD_ENTER_CRITICAL. */
+#define USBD_EXIT_CRITICAL(primask)   __set_PRIMASK(primask)
+
 /* DEBUG macros */
 
 #if (USBD_DEBUG_LEVEL > 0)
@@ -154,6 +200,10 @@
   */
 
 /* Exported functions -------------------------------------------------------*/
+#if (USBD_LL_DEDICATED_EP1 == 1U)
+void USBD_LL_EP1_IN_IRQHandler(PCD_HandleTypeDef *hpcd);
+void USBD_LL_EP1_OUT_IRQHandler(PCD_HandleTypeDef *hpcd);
+#endif /* (USBD_LL_DEDICATED_EP1 == 1U) */
 
 /**
   * @}
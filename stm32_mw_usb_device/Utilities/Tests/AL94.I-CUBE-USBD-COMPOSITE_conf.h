@@ -0,0 +1,53 @@
+/**
+  ******************************************************************************
+  * @file    AL94.I-CUBE-USBD-COMPOSITE_conf.h
+  * @brief   Composite configuration of the host tests, in place of the one
+  *          CubeMX generates: two CDC ACM channels and no other class.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __AL94__I_CUBE_USBD_COMPOSITE_CONF__H__
+#define __AL94__I_CUBE_USBD_COMPOSITE_CONF__H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+
+/* Exported constants --------------------------------------------------------*/
+
+#define _USBD_USE_HS                      true
+#define _USBD_USE_CDC_ACM                 true
+#define _USBD_CDC_ACM_COUNT               2
+#define _USBD_USE_CDC_RNDIS               false
+#define _USBD_USE_CDC_ECM                 false
+#define _USBD_USE_HID_MOUSE               false
+#define _USBD_USE_HID_KEYBOARD            false
+#define _USBD_USE_HID_CUSTOM              false
+#define _USBD_USE_UAC_MIC                 false
+#define _USBD_USE_UAC_SPKR                false
+#define _USBD_USE_UVC                     false
+#define _USBD_USE_MSC                     false
+#define _USBD_USE_DFU                     false
+#define _USBD_USE_PRNTR                   false
+#define _STM32F1_DEVICE                   false
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AL94__I_CUBE_USBD_COMPOSITE_CONF__H__ */
+
+/********************************** END OF FILE *******************************/
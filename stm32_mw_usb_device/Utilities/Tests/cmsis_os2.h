@@ -0,0 +1,125 @@
+/**
+  ******************************************************************************
+  * @file    cmsis_os2.h
+  * @brief   The part of the CMSIS-RTOS2 API the library uses, implemented on
+  *          POSIX threads by cmsis_os2_posix.c for the host tests.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef CMSIS_OS2_H_
+#define CMSIS_OS2_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+
+/* Exported constants --------------------------------------------------------*/
+
+#define osWaitForever         0xFFFFFFFFU
+
+#define osFlagsWaitAny        0x00000000U
+#define osFlagsWaitAll        0x00000001U
+#define osFlagsNoClear        0x00000002U
+
+#define osFlagsError          0x80000000U
+#define osFlagsErrorTimeout   0xFFFFFFFEU
+
+/* Exported types ------------------------------------------------------------*/
+
+typedef enum
+{
+  osOK             =  0,
+  osError          = -1,
+  osErrorTimeout   = -2,
+  osErrorResource  = -3,
+  osErrorParameter = -4,
+  osErrorNoMemory  = -5
+} osStatus_t;
+
+typedef enum
+{
+  osPriorityNone        = 0,
+  osPriorityLow         = 8,
+  osPriorityNormal      = 24,
+  osPriorityAboveNormal = 32,
+  osPriorityHigh        = 40,
+  osPriorityRealtime    = 48
+} osPriority_t;
+
+typedef void (*osThreadFunc_t)(void *argument);
+
+typedef struct os_event_flags_s *osEventFlagsId_t;
+typedef struct os_message_queue_s *osMessageQueueId_t;
+typedef struct os_thread_s *osThreadId_t;
+
+typedef struct
+{
+  const char *name;
+  uint32_t attr_bits;
+  void *cb_mem;
+  uint32_t cb_size;
+} osEventFlagsAttr_t;
+
+typedef struct
+{
+  const char *name;
+  uint32_t attr_bits;
+  void *cb_mem;
+  uint32_t cb_size;
+  void *mq_mem;
+  uint32_t mq_size;
+} osMessageQueueAttr_t;
+
+typedef struct
+{
+  const char *name;
+  uint32_t attr_bits;
+  void *cb_mem;
+  uint32_t cb_size;
+  void *stack_mem;
+  uint32_t stack_size;
+  osPriority_t priority;
+  uint32_t tz_module;
+  uint32_t reserved;
+} osThreadAttr_t;
+
+/* Exported functions ------------------------------------------------------- */
+
+/* One kernel tick is one millisecond */
+uint32_t osKernelGetTickCount(void);
+
+osThreadId_t osThreadNew(osThreadFunc_t func, void *argument, const osThreadAttr_t *attr);
+
+osEventFlagsId_t osEventFlagsNew(const osEventFlagsAttr_t *attr);
+uint32_t osEventFlagsSet(osEventFlagsId_t ef_id, uint32_t flags);
+uint32_t osEventFlagsClear(osEventFlagsId_t ef_id, uint32_t flags);
+uint32_t osEventFlagsWait(osEventFlagsId_t ef_id, uint32_t flags, uint32_t options, uint32_t timeout);
+
+osMessageQueueId_t osMessageQueueNew(uint32_t msg_count, uint32_t msg_size,
+                                     const osMessageQueueAttr_t *attr);
+osStatus_t osMessageQueuePut(osMessageQueueId_t mq_id, const void *msg_ptr,
+                             uint8_t msg_prio, uint32_t timeout);
+osStatus_t osMessageQueueGet(osMessageQueueId_t mq_id, void *msg_ptr,
+                             uint8_t *msg_prio, uint32_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CMSIS_OS2_H_ */
+
+/********************************** END OF FILE *******************************/
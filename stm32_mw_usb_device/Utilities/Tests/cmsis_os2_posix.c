@@ -0,0 +1,293 @@
+/**
+  ******************************************************************************
+  * @file    cmsis_os2_posix.c
+  * @brief   CMSIS-RTOS2 subset on POSIX threads. Every object shares one
+  *          mutex and one condition, which is plenty for the host tests.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cmsis_os2.h"
+
+/* Private typedef -----------------------------------------------------------*/
+
+struct os_event_flags_s
+{
+  uint32_t flags;
+};
+
+struct os_message_queue_s
+{
+  uint32_t count;
+  uint32_t size;
+  uint32_t head;
+  uint32_t used;
+  uint8_t *pool;
+};
+
+struct os_thread_s
+{
+  pthread_t thread;
+  osThreadFunc_t func;
+  void *argument;
+};
+
+/* Private variables ---------------------------------------------------------*/
+
+static pthread_mutex_t os_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t os_cond;
+static pthread_once_t os_once = PTHREAD_ONCE_INIT;
+
+/* Private functions ---------------------------------------------------------*/
+
+static void os_init(void)
+{
+  pthread_condattr_t attr;
+
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&os_cond, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+static void os_deadline(struct timespec *ts, uint32_t timeout)
+{
+  clock_gettime(CLOCK_MONOTONIC, ts);
+  ts->tv_sec += (time_t)(timeout / 1000U);
+  ts->tv_nsec += (long)(timeout % 1000U) * 1000000L;
+
+  if (ts->tv_nsec >= 1000000000L)
+  {
+    ts->tv_sec++;
+    ts->tv_nsec -= 1000000000L;
+  }
+}
+
+/* Wait on the shared condition, 0 once the deadline passed */
+static int os_wait(const struct timespec *deadline, uint32_t timeout)
+{
+  if (timeout == osWaitForever)
+  {
+    pthread_cond_wait(&os_cond, &os_lock);
+    return 1;
+  }
+
+  return (pthread_cond_timedwait(&os_cond, &os_lock, deadline) == 0) ? 1 : 0;
+}
+
+static void *os_thread_entry(void *arg)
+{
+  struct os_thread_s *t = (struct os_thread_s *)arg;
+
+  t->func(t->argument);
+  return NULL;
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+uint32_t osKernelGetTickCount(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000U + (uint64_t)ts.tv_nsec / 1000000U);
+}
+
+osThreadId_t osThreadNew(osThreadFunc_t func, void *argument, const osThreadAttr_t *attr)
+{
+  struct os_thread_s *t = calloc(1U, sizeof(*t));
+
+  (void)attr;
+  pthread_once(&os_once, os_init);
+
+  if (t == NULL)
+  {
+    return NULL;
+  }
+
+  t->func = func;
+  t->argument = argument;
+
+  if (pthread_create(&t->thread, NULL, os_thread_entry, t) != 0)
+  {
+    free(t);
+    return NULL;
+  }
+
+  (void)pthread_detach(t->thread);
+  return t;
+}
+
+osEventFlagsId_t osEventFlagsNew(const osEventFlagsAttr_t *attr)
+{
+  (void)attr;
+  pthread_once(&os_once, os_init);
+
+  return calloc(1U, sizeof(struct os_event_flags_s));
+}
+
+uint32_t osEventFlagsSet(osEventFlagsId_t ef_id, uint32_t flags)
+{
+  uint32_t ret;
+
+  pthread_mutex_lock(&os_lock);
+  ef_id->flags |= flags;
+  ret = ef_id->flags;
+  pthread_cond_broadcast(&os_cond);
+  pthread_mutex_unlock(&os_lock);
+
+  return ret;
+}
+
+uint32_t osEventFlagsClear(osEventFlagsId_t ef_id, uint32_t flags)
+{
+  uint32_t ret;
+
+  pthread_mutex_lock(&os_lock);
+  ret = ef_id->flags;
+  ef_id->flags &= ~flags;
+  pthread_mutex_unlock(&os_lock);
+
+  return ret;
+}
+
+uint32_t osEventFlagsWait(osEventFlagsId_t ef_id, uint32_t flags, uint32_t options, uint32_t timeout)
+{
+  struct timespec deadline;
+  uint32_t ret;
+
+  os_deadline(&deadline, timeout);
+  pthread_mutex_lock(&os_lock);
+
+  for (;;)
+  {
+    ret = ef_id->flags & flags;
+
+    if (((options & osFlagsWaitAll) != 0U) ? (ret == flags) : (ret != 0U))
+    {
+      ret = ef_id->flags;
+
+      if ((options & osFlagsNoClear) == 0U)
+      {
+        ef_id->flags &= ~flags;
+      }
+      break;
+    }
+
+    if ((timeout == 0U) || (os_wait(&deadline, timeout) == 0))
+    {
+      ret = osFlagsErrorTimeout;
+      break;
+    }
+  }
+
+  pthread_mutex_unlock(&os_lock);
+  return ret;
+}
+
+osMessageQueueId_t osMessageQueueNew(uint32_t msg_count, uint32_t msg_size,
+                                     const osMessageQueueAttr_t *attr)
+{
+  struct os_message_queue_s *mq = calloc(1U, sizeof(*mq));
+
+  (void)attr;
+  pthread_once(&os_once, os_init);
+
+  if (mq == NULL)
+  {
+    return NULL;
+  }
+
+  mq->pool = calloc(msg_count, msg_size);
+
+  if (mq->pool == NULL)
+  {
+    free(mq);
+    return NULL;
+  }
+
+  mq->count = msg_count;
+  mq->size = msg_size;
+  return mq;
+}
+
+osStatus_t osMessageQueuePut(osMessageQueueId_t mq_id, const void *msg_ptr,
+                             uint8_t msg_prio, uint32_t timeout)
+{
+  struct timespec deadline;
+  osStatus_t ret = osOK;
+
+  (void)msg_prio;
+  os_deadline(&deadline, timeout);
+  pthread_mutex_lock(&os_lock);
+
+  while (mq_id->used == mq_id->count)
+  {
+    if ((timeout == 0U) || (os_wait(&deadline, timeout) == 0))
+    {
+      ret = (timeout == 0U) ? osErrorResource : osErrorTimeout;
+      break;
+    }
+  }
+
+  if (ret == osOK)
+  {
+    memcpy(&mq_id->pool[((mq_id->head + mq_id->used) % mq_id->count) * mq_id->size],
+           msg_ptr, mq_id->size);
+    mq_id->used++;
+    pthread_cond_broadcast(&os_cond);
+  }
+
+  pthread_mutex_unlock(&os_lock);
+  return ret;
+}
+
+osStatus_t osMessageQueueGet(osMessageQueueId_t mq_id, void *msg_ptr,
+                             uint8_t *msg_prio, uint32_t timeout)
+{
+  struct timespec deadline;
+  osStatus_t ret = osOK;
+
+  os_deadline(&deadline, timeout);
+  pthread_mutex_lock(&os_lock);
+
+  while (mq_id->used == 0U)
+  {
+    if ((timeout == 0U) || (os_wait(&deadline, timeout) == 0))
+    {
+      ret = (timeout == 0U) ? osErrorResource : osErrorTimeout;
+      break;
+    }
+  }
+
+  if (ret == osOK)
+  {
+    memcpy(msg_ptr, &mq_id->pool[mq_id->head * mq_id->size], mq_id->size);
+    mq_id->head = (mq_id->head + 1U) % mq_id->count;
+    mq_id->used--;
+    pthread_cond_broadcast(&os_cond);
+
+    if (msg_prio != NULL)
+    {
+      *msg_prio = 0U;
+    }
+  }
+
+  pthread_mutex_unlock(&os_lock);
+  return ret;
+}
+
+/********************************** END OF FILE *******************************/
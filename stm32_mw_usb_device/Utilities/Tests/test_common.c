@@ -0,0 +1,68 @@
+/**
+  ******************************************************************************
+  * @file    test_common.c
+  * @brief   Checks and interrupt lock shared by the host tests.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include "test_common.h"
+
+/* Private variables ---------------------------------------------------------*/
+
+static pthread_mutex_t test_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static unsigned int test_checks;
+static unsigned int test_failures;
+
+/* Exported functions --------------------------------------------------------*/
+
+void Test_Check(int ok, const char *file, int line, const char *expr)
+{
+  __atomic_add_fetch(&test_checks, 1U, __ATOMIC_RELAXED);
+
+  if (ok == 0)
+  {
+    __atomic_add_fetch(&test_failures, 1U, __ATOMIC_RELAXED);
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+  }
+}
+
+int Test_Done(const char *name)
+{
+  printf("%s: %u checks, %u failed\n", name, test_checks, test_failures);
+  return (test_failures == 0U) ? 0 : 1;
+}
+
+void Test_Lock(void)
+{
+  pthread_mutex_lock(&test_lock);
+}
+
+void Test_Unlock(void)
+{
+  pthread_mutex_unlock(&test_lock);
+}
+
+void Test_SleepUs(uint32_t us)
+{
+  struct timespec ts;
+
+  ts.tv_sec = (time_t)(us / 1000000U);
+  ts.tv_nsec = (long)(us % 1000000U) * 1000L;
+  (void)nanosleep(&ts, NULL);
+}
+
+/********************************** END OF FILE *******************************/
@@ -0,0 +1,44 @@
+/**
+  ******************************************************************************
+  * @file    test_common.h
+  * @brief   Checks and interrupt lock shared by the host tests.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TEST_COMMON_H
+#define __TEST_COMMON_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported macro ------------------------------------------------------------*/
+
+/* Record a failed condition and go on with the test */
+#define TEST_CHECK(cond)        Test_Check(((cond) ? 1 : 0), __FILE__, __LINE__, #cond)
+
+/* Exported functions ------------------------------------------------------- */
+
+void Test_Check(int ok, const char *file, int line, const char *expr);
+
+/* Print the summary, return the exit status of the test program */
+int Test_Done(const char *name);
+
+/* Lock taken by USBD_ENTER_CRITICAL, recursive as the interrupt mask is */
+void Test_Lock(void);
+void Test_Unlock(void);
+
+void Test_SleepUs(uint32_t us);
+
+#endif /* __TEST_COMMON_H */
+
+/********************************** END OF FILE *******************************/
@@ -0,0 +1,413 @@
+/**
+  ******************************************************************************
+  * @file    test_usbd_cdc_bridge.c
+  * @brief   Host test of the CDC ACM to UART bridge (App/usbd_cdc_bridge.c)
+  *          over a simulated port: a circular reception with the half, full
+  *          and idle line events of a DMA, a sender held while reception is
+  *          stopped, and a transmission completed by the test. The CDC ACM
+  *          class is stood in for by a transmit ring the test reads as the
+  *          host.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_core.h"
+#include "usbd_cdc_bridge.h"
+#include "test_common.h"
+
+/* Private define ------------------------------------------------------------*/
+
+#define CH                  0U
+#define STREAM_SIZE         20000U
+#define CHUNK               100U
+
+/* Private variables ---------------------------------------------------------*/
+
+static USBD_HandleTypeDef dev;
+
+/* Simulated UART */
+static struct
+{
+  uint8_t *rx_buf;
+  uint32_t rx_size;
+  uint32_t rx_pos;
+  uint8_t rx_on;
+  uint32_t rx_starts;
+  uint32_t rx_stops;
+  uint8_t can_hold;       /* RTS/CTS: the sender waits while reception is stopped */
+  uint8_t *tx_buf;
+  uint32_t tx_len;
+  uint8_t tx_on;
+  uint8_t wire[1024];     /* bytes the port sent on the line */
+  uint32_t wire_len;
+  uint32_t cfg_count;
+  uint32_t cfg_bitrate;
+  uint32_t cfg_at;        /* wire_len when the last line coding was applied */
+  uint32_t cfg_bad;       /* line codings applied while the port was running */
+} port;
+
+/* CDC ACM class */
+static uint8_t host_ring[CDC_ACM_TX_RING_SIZE];
+static uint32_t host_used;
+static uint8_t host_rx[STREAM_SIZE];
+static uint32_t host_rx_len;
+static uint8_t *released[8];
+static uint32_t released_count;
+static uint16_t serial_levels;
+static uint16_t serial_events;
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint8_t Pattern(uint32_t i)
+{
+  return (uint8_t)((i * 7U) + (i >> 8));
+}
+
+static int8_t Port_Config(uint8_t ch, USBD_CDC_ACM_LineCodingTypeDef *plc)
+{
+  if ((port.tx_on != 0U) || (port.rx_on != 0U))
+  {
+    port.cfg_bad++;
+  }
+
+  port.cfg_count++;
+  port.cfg_bitrate = plc->bitrate;
+  port.cfg_at = port.wire_len;
+  return 0;
+}
+
+static int8_t Port_StartRx(uint8_t ch, uint8_t *pbuf, uint32_t size)
+{
+  port.rx_buf = pbuf;
+  port.rx_size = size;
+  port.rx_pos = 0U;
+  port.rx_on = 1U;
+  port.rx_starts++;
+  return 0;
+}
+
+static int8_t Port_StopRx(uint8_t ch)
+{
+  if (port.rx_on != 0U)
+  {
+    port.rx_stops++;
+  }
+
+  port.rx_on = 0U;
+  return 0;
+}
+
+static uint32_t Port_RxPos(uint8_t ch)
+{
+  return port.rx_pos;
+}
+
+static int8_t Port_StartTx(uint8_t ch, uint8_t *pbuf, uint32_t len)
+{
+  port.tx_buf = pbuf;
+  port.tx_len = len;
+  port.tx_on = 1U;
+  return 0;
+}
+
+static uint8_t Port_CanHold(uint8_t ch)
+{
+  return port.can_hold;
+}
+
+static const USBD_CDC_Bridge_PortTypeDef sim_port =
+{
+  Port_Config,
+  Port_StartRx,
+  Port_StopRx,
+  Port_RxPos,
+  Port_StartTx,
+  Port_CanHold
+};
+
+/* The line brings bytes in: written at the DMA position while reception
+   runs, with the half and full buffer events, then an idle line event. A
+   held sender keeps the rest, without flow control it is lost. Returns the
+   bytes taken off the sender. */
+static uint32_t Line_Send(uint32_t first, uint32_t len)
+{
+  uint32_t i;
+
+  for (i = 0U; i < len; i++)
+  {
+    if (port.rx_on == 0U)
+    {
+      if (port.can_hold != 0U)
+      {
+        break;
+      }
+      continue;
+    }
+
+    port.rx_buf[port.rx_pos] = Pattern(first + i);
+    port.rx_pos = (port.rx_pos + 1U) % port.rx_size;
+
+    if ((port.rx_pos == 0U) || (port.rx_pos == (port.rx_size / 2U)))
+    {
+      USBD_CDC_Bridge_RxEvent(CH);
+    }
+  }
+
+  USBD_CDC_Bridge_RxEvent(CH);
+
+  return i;
+}
+
+/* The port finished sending its buffer */
+static void Line_TxDone(void)
+{
+  memcpy(&port.wire[port.wire_len], port.tx_buf, port.tx_len);
+  port.wire_len += port.tx_len;
+  port.tx_on = 0U;
+  USBD_CDC_Bridge_TxCplt(CH);
+}
+
+/* The host reads the transmit ring of the channel */
+static void Host_Read(void)
+{
+  uint32_t len = MIN(host_used, STREAM_SIZE - host_rx_len);
+
+  memcpy(&host_rx[host_rx_len], host_ring, len);
+  host_rx_len += len;
+  host_used = 0U;
+}
+
+static int Host_Check(uint32_t len)
+{
+  for (uint32_t i = 0U; i < len; i++)
+  {
+    if (host_rx[i] != Pattern(i))
+    {
+      return 0;
+    }
+  }
+
+  return (host_rx_len == len) ? 1 : 0;
+}
+
+static void Bridge_Start(uint8_t can_hold)
+{
+  memset(&port, 0, sizeof(port));
+  port.can_hold = can_hold;
+  host_used = 0U;
+  host_rx_len = 0U;
+  released_count = 0U;
+  serial_events = 0U;
+
+  (void)USBD_CDC_Bridge_Attach(CH, &dev, &sim_port);
+  USBD_CDC_Bridge_Init(CH);
+}
+
+uint32_t USBD_CDC_TxWrite(uint8_t ch, USBD_HandleTypeDef *pdev, const uint8_t *pbuf,
+                          uint32_t length)
+{
+  uint32_t len = MIN(length, CDC_ACM_TX_RING_SIZE - host_used);
+
+  memcpy(&host_ring[host_used], pbuf, len);
+  host_used += len;
+  return len;
+}
+
+uint8_t USBD_CDC_ReleaseRxBuffer(uint8_t ch, USBD_HandleTypeDef *pdev, uint8_t *pbuff)
+{
+  released[released_count++ % 8U] = pbuff;
+  return (uint8_t)USBD_OK;
+}
+
+uint8_t USBD_CDC_SetSerialState(uint8_t ch, USBD_HandleTypeDef *pdev, uint16_t levels)
+{
+  serial_levels = levels;
+  return (uint8_t)USBD_OK;
+}
+
+uint8_t USBD_CDC_ReportSerialEvent(uint8_t ch, USBD_HandleTypeDef *pdev, uint16_t events)
+{
+  serial_events |= events;
+  return (uint8_t)USBD_OK;
+}
+
+static void Test_UartToUsb(void)
+{
+  uint32_t sent = 0U;
+
+  /* The host keeps up: every byte arrives once and in order */
+  Bridge_Start(0U);
+  TEST_CHECK((port.rx_on == 1U) && (port.rx_size == USBD_CDC_BRIDGE_RX_SIZE));
+  TEST_CHECK(serial_levels == (CDC_SERIAL_STATE_DCD | CDC_SERIAL_STATE_DSR));
+
+  while (sent < STREAM_SIZE)
+  {
+    sent += Line_Send(sent, MIN(CHUNK, STREAM_SIZE - sent));
+    Host_Read();
+  }
+
+  TEST_CHECK(Host_Check(STREAM_SIZE));
+  TEST_CHECK(serial_events == 0U);
+}
+
+static void Test_Hold(void)
+{
+  uint32_t sent = 0U;
+  uint32_t stalled = 0U;
+
+  /* The host stops reading: the ring fills, then the circular buffer up to
+     USBD_CDC_BRIDGE_RX_HOLD, and the port stops the sender */
+  Bridge_Start(1U);
+
+  while (sent < STREAM_SIZE)
+  {
+    uint32_t n = Line_Send(sent, CHUNK);
+
+    sent += n;
+    if (n < CHUNK)
+    {
+      break;
+    }
+  }
+
+  TEST_CHECK(port.rx_on == 0U);
+  TEST_CHECK(port.rx_stops == 1U);
+  TEST_CHECK(sent >= CDC_ACM_TX_RING_SIZE + USBD_CDC_BRIDGE_RX_HOLD);
+  TEST_CHECK(sent < CDC_ACM_TX_RING_SIZE + USBD_CDC_BRIDGE_RX_SIZE);
+
+  /* The host reads again, the main loop forwards the backlog and the port
+     lets the sender go on. Nothing is lost. */
+  while ((sent < STREAM_SIZE) && (stalled < 1000U))
+  {
+    uint32_t n = Line_Send(sent, MIN(CHUNK, STREAM_SIZE - sent));
+
+    sent += n;
+    stalled = (n == 0U) ? (stalled + 1U) : 0U;
+    Host_Read();
+    USBD_CDC_Bridge_Process();
+  }
+
+  Host_Read();
+  USBD_CDC_Bridge_Process();
+  Host_Read();
+
+  TEST_CHECK(Host_Check(STREAM_SIZE));
+  TEST_CHECK(port.rx_starts > 1U);
+  TEST_CHECK(serial_events == 0U);
+}
+
+static void Test_Overrun(void)
+{
+  uint32_t starts;
+
+  /* Without flow control the bytes the port writes over are reported */
+  Bridge_Start(0U);
+  (void)Line_Send(0U, CDC_ACM_TX_RING_SIZE + (2U * USBD_CDC_BRIDGE_RX_SIZE));
+  TEST_CHECK((serial_events & CDC_SERIAL_STATE_OVERRUN) != 0U);
+
+  /* What the host gets is still in order, the newest bytes are kept */
+  Host_Read();
+  TEST_CHECK(host_rx_len == CDC_ACM_TX_RING_SIZE);
+  TEST_CHECK(Host_Check(CDC_ACM_TX_RING_SIZE));
+
+  /* A line error that stopped the port is reported and reception starts
+     over */
+  serial_events = 0U;
+  starts = port.rx_starts;
+  port.rx_on = 0U;
+  USBD_CDC_Bridge_RxError(CH, CDC_SERIAL_STATE_FRAMING, 1U);
+  TEST_CHECK(serial_events == CDC_SERIAL_STATE_FRAMING);
+  TEST_CHECK((port.rx_on == 1U) && (port.rx_starts == starts + 1U));
+}
+
+static void Test_UsbToUart(void)
+{
+  uint8_t buf[3][16];
+
+  for (uint32_t i = 0U; i < sizeof(buf); i++)
+  {
+    buf[i / 16U][i % 16U] = Pattern(i);
+  }
+
+  /* Pool buffers go out one at a time and back to the class once sent */
+  Bridge_Start(0U);
+  TEST_CHECK(USBD_CDC_Bridge_Receive(CH, buf[0], 16U) == USBD_OK);
+  TEST_CHECK(USBD_CDC_Bridge_Receive(CH, buf[1], 16U) == USBD_OK);
+  TEST_CHECK(USBD_CDC_Bridge_Receive(CH, buf[2], 16U) == USBD_OK);
+  TEST_CHECK((port.tx_on == 1U) && (port.tx_buf == buf[0]));
+  TEST_CHECK(released_count == 0U);
+
+  Line_TxDone();
+  TEST_CHECK((released_count == 1U) && (released[0] == buf[0]));
+  TEST_CHECK((port.tx_on == 1U) && (port.tx_buf == buf[1]));
+
+  Line_TxDone();
+  Line_TxDone();
+  TEST_CHECK((released_count == 3U) && (released[2] == buf[2]));
+  TEST_CHECK(port.tx_on == 0U);
+  TEST_CHECK((port.wire_len == sizeof(buf)) && (memcmp(port.wire, buf, sizeof(buf)) == 0));
+}
+
+static void Test_LineCoding(void)
+{
+  USBD_CDC_ACM_LineCodingTypeDef lc = {9600U, 0U, 0U, 8U};
+  uint8_t a[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+  uint8_t b[4] = {9, 10, 11, 12};
+
+  /* A change waits for the data received before it to leave the port, and
+     the data after it waits for the change */
+  Bridge_Start(0U);
+  (void)USBD_CDC_Bridge_Receive(CH, a, sizeof(a));
+  USBD_CDC_Bridge_SetLineCoding(CH, &lc);
+  (void)USBD_CDC_Bridge_Receive(CH, b, sizeof(b));
+  TEST_CHECK(port.cfg_count == 0U);
+
+  Line_TxDone();
+  TEST_CHECK((port.cfg_count == 1U) && (port.cfg_bitrate == 9600U));
+  TEST_CHECK(port.cfg_at == sizeof(a));
+  TEST_CHECK(port.cfg_bad == 0U);
+  TEST_CHECK(port.rx_on == 1U);
+  TEST_CHECK((port.tx_on == 1U) && (port.tx_buf == b));
+
+  Line_TxDone();
+  TEST_CHECK(port.wire_len == sizeof(a) + sizeof(b));
+  TEST_CHECK(released_count == 2U);
+}
+
+static void Test_DeInit(void)
+{
+  uint8_t a[4] = {0};
+
+  /* Once stopped the channel takes nothing more */
+  Bridge_Start(0U);
+  USBD_CDC_Bridge_DeInit(CH);
+  TEST_CHECK(port.rx_on == 0U);
+  TEST_CHECK(serial_levels == 0U);
+  TEST_CHECK(USBD_CDC_Bridge_Receive(CH, a, sizeof(a)) == USBD_FAIL);
+  TEST_CHECK(USBD_CDC_Bridge_IsAttached(1U) == 0U);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main(void)
+{
+  Test_UartToUsb();
+  Test_Hold();
+  Test_Overrun();
+  Test_UsbToUart();
+  Test_LineCoding();
+  Test_DeInit();
+
+  return Test_Done("test_usbd_cdc_bridge");
+}
+
+/********************************** END OF FILE *******************************/
@@ -0,0 +1,342 @@
+/**
+  ******************************************************************************
+  * @file    test_usbd_cdc_frame.c
+  * @brief   Host test of the framed transport (App/usbd_cdc_frame.c). Both
+  *          ends of the protocol are the same, so two CDC ACM channels are
+  *          linked to each other through a wire that corrupts bytes, on a
+  *          simulated clock, and stream payloads both ways.
+  *
+  *          With --stdio the test is instead the device end of a link on
+  *          its standard input and output, sending every payload back, for
+  *          test_usbd_cdc_frame.py to drive with the host side of
+  *          Utilities/usbd_cdc_frame.py.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <time.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include "usbd_core.h"
+#include "usbd_cdc_frame.h"
+#include "test_common.h"
+
+/* Private define ------------------------------------------------------------*/
+
+#define STREAM_COUNT        2000U
+#define STEP_US             500U      /* simulated time of one pass over the wire */
+#define MAX_STEPS           2000000U
+
+#define ECHO_DEPTH          4U
+
+/* Private variables ---------------------------------------------------------*/
+
+static USBD_HandleTypeDef dev;
+static USBD_CDC_Frame_HandleTypeDef frame[2];
+
+static uint8_t real_clock;
+static uint32_t sim_us;
+static double loss;
+
+/* Transmit ring of each channel, emptied onto the wire */
+static uint8_t ring[2][CDC_ACM_TX_RING_SIZE];
+static uint32_t ring_used[2];
+
+/* Payloads received in order by each end, and the ones out of order */
+static uint32_t rx_count[2];
+static uint32_t rx_bad[2];
+static uint32_t rx_busy[2];
+static uint8_t busy_rate;
+
+/* --stdio: payloads waiting to be sent back */
+static uint8_t echo[ECHO_DEPTH][USBD_CDC_FRAME_MTU];
+static uint16_t echo_len[ECHO_DEPTH];
+static uint32_t echo_head;
+static uint32_t echo_tail;
+
+/* Private functions ---------------------------------------------------------*/
+
+uint32_t USBD_LL_GetTimestamp(void)
+{
+  struct timespec ts;
+
+  if (real_clock == 0U)
+  {
+    return sim_us;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(((uint64_t)ts.tv_sec * 1000000U) + ((uint64_t)ts.tv_nsec / 1000U));
+}
+
+uint32_t USBD_LL_GetTimestampFreq(void)
+{
+  return 1000000U;
+}
+
+uint32_t USBD_CDC_TxFree(uint8_t ch, USBD_HandleTypeDef *pdev)
+{
+  return CDC_ACM_TX_RING_SIZE - ring_used[ch];
+}
+
+uint32_t USBD_CDC_TxWrite(uint8_t ch, USBD_HandleTypeDef *pdev, const uint8_t *pbuf,
+                          uint32_t length)
+{
+  uint32_t len = MIN(length, CDC_ACM_TX_RING_SIZE - ring_used[ch]);
+
+  memcpy(&ring[ch][ring_used[ch]], pbuf, len);
+  ring_used[ch] += len;
+  return len;
+}
+
+uint8_t USBD_CDC_ReleaseRxBuffer(uint8_t ch, USBD_HandleTypeDef *pdev, uint8_t *pbuff)
+{
+  return (uint8_t)USBD_OK;
+}
+
+uint16_t USBD_CDC_GetLineState(uint8_t ch, USBD_HandleTypeDef *pdev)
+{
+  return CDC_CONTROL_LINE_DTR;
+}
+
+/* Payload i: its number, then bytes with runs of 0 and of non 0 for COBS */
+static uint16_t Payload(uint32_t i, uint8_t *pbuf)
+{
+  uint16_t len = (uint16_t)(4U + ((i * 37U) % (USBD_CDC_FRAME_MTU - 3U)));
+
+  memcpy(pbuf, &i, 4U);
+  for (uint16_t k = 4U; k < len; k++)
+  {
+    pbuf[k] = ((((k + i) / 300U) & 1U) != 0U) ? (uint8_t)(0x80U | k) : (uint8_t)(((k % 5U) == 0U) ? 0U : k);
+  }
+
+  return len;
+}
+
+static USBD_StatusTypeDef Link_Receive(uint8_t ch, const uint8_t *pbuf, uint16_t len)
+{
+  uint8_t expect[USBD_CDC_FRAME_MTU];
+
+  /* The receiver is sometimes slow, the payload is given again later */
+  if ((busy_rate != 0U) && ((lrand48() % 100) < busy_rate))
+  {
+    rx_busy[ch]++;
+    return USBD_BUSY;
+  }
+
+  if ((Payload(rx_count[ch], expect) != len) || (memcmp(expect, pbuf, len) != 0))
+  {
+    rx_bad[ch]++;
+  }
+
+  rx_count[ch]++;
+  return USBD_OK;
+}
+
+static void Wire_Corrupt(uint8_t *pbuf, uint32_t len)
+{
+  for (uint32_t i = 0U; i < len; i++)
+  {
+    if (drand48() < loss)
+    {
+      pbuf[i] ^= (uint8_t)(1U + (lrand48() % 255));
+    }
+  }
+}
+
+/* One pass: each end sends what it can, the wire carries both rings to the
+   other end in pieces of a USB packet, then time goes on */
+static void Link_Step(uint32_t *psent)
+{
+  uint8_t buf[USBD_CDC_FRAME_MTU];
+  uint8_t pkt[64];
+  uint16_t len;
+
+  for (uint8_t ch = 0U; ch < 2U; ch++)
+  {
+    while (psent[ch] < STREAM_COUNT)
+    {
+      len = Payload(psent[ch], buf);
+      if (USBD_CDC_Frame_Send(ch, buf, len) != USBD_OK)
+      {
+        break;
+      }
+      psent[ch]++;
+    }
+  }
+
+  USBD_CDC_Frame_Process();
+
+  for (uint8_t ch = 0U; ch < 2U; ch++)
+  {
+    for (uint32_t off = 0U; off < ring_used[ch]; off += sizeof(pkt))
+    {
+      uint32_t n = MIN(sizeof(pkt), ring_used[ch] - off);
+
+      memcpy(pkt, &ring[ch][off], n);
+      Wire_Corrupt(pkt, n);
+      (void)USBD_CDC_Frame_Receive((uint8_t)(ch ^ 1U), pkt, n);
+    }
+    ring_used[ch] = 0U;
+  }
+
+  sim_us += STEP_US;
+}
+
+static void Link_Run(double wire_loss, uint8_t busy)
+{
+  USBD_CDC_Frame_StatsTypeDef st[2];
+  uint32_t sent[2] = {0U, 0U};
+  uint32_t steps = 0U;
+
+  loss = wire_loss;
+  busy_rate = busy;
+  memset(rx_count, 0, sizeof(rx_count));
+  memset(rx_bad, 0, sizeof(rx_bad));
+  memset(rx_busy, 0, sizeof(rx_busy));
+  memset(ring_used, 0, sizeof(ring_used));
+
+  for (uint8_t ch = 0U; ch < 2U; ch++)
+  {
+    (void)USBD_CDC_Frame_Attach(ch, &dev, &frame[ch], Link_Receive);
+    USBD_CDC_Frame_Init(ch);
+  }
+
+  while (((rx_count[0] < STREAM_COUNT) || (rx_count[1] < STREAM_COUNT)) && (steps < MAX_STEPS))
+  {
+    Link_Step(sent);
+    steps++;
+  }
+
+  (void)USBD_CDC_Frame_GetStats(0U, &st[0]);
+  (void)USBD_CDC_Frame_GetStats(1U, &st[1]);
+  printf("  loss %g busy %u%%: %u steps, retries %u/%u, errors %u/%u, duplicates %u/%u\n",
+         wire_loss, (unsigned)busy, (unsigned)steps,
+         (unsigned)st[0].TxRetries, (unsigned)st[1].TxRetries,
+         (unsigned)st[0].RxErrors, (unsigned)st[1].RxErrors,
+         (unsigned)st[0].RxDuplicates, (unsigned)st[1].RxDuplicates);
+
+  /* Every payload once, in order and whole, both ways */
+  TEST_CHECK((rx_count[0] == STREAM_COUNT) && (rx_count[1] == STREAM_COUNT));
+  TEST_CHECK((rx_bad[0] == 0U) && (rx_bad[1] == 0U));
+  TEST_CHECK((st[0].RxFrames == STREAM_COUNT) && (st[1].RxFrames == STREAM_COUNT));
+
+  if (wire_loss == 0.0)
+  {
+    /* A clean wire needs no retransmission unless the receiver held back */
+    TEST_CHECK((st[0].RxErrors == 0U) && (st[1].RxErrors == 0U));
+    TEST_CHECK((busy != 0U) || ((st[0].TxRetries == 0U) && (st[1].TxRetries == 0U)));
+  }
+  else
+  {
+    TEST_CHECK((st[0].RxErrors != 0U) && (st[1].RxErrors != 0U));
+    TEST_CHECK((st[0].TxRetries != 0U) && (st[1].TxRetries != 0U));
+  }
+
+  USBD_CDC_Frame_DeInit(0U);
+  USBD_CDC_Frame_DeInit(1U);
+}
+
+static USBD_StatusTypeDef Echo_Receive(uint8_t ch, const uint8_t *pbuf, uint16_t len)
+{
+  if ((echo_head - echo_tail) >= ECHO_DEPTH)
+  {
+    return USBD_BUSY;
+  }
+
+  memcpy(echo[echo_head % ECHO_DEPTH], pbuf, len);
+  echo_len[echo_head % ECHO_DEPTH] = len;
+  echo_head++;
+  return USBD_OK;
+}
+
+/* Device end of a link on the standard input and output, until the input
+   closes */
+static int Echo_Run(void)
+{
+  USBD_CDC_Frame_StatsTypeDef st;
+  uint8_t buf[512];
+  fd_set fds;
+  struct timeval tv;
+  ssize_t n;
+
+  real_clock = 1U;
+  (void)USBD_CDC_Frame_Attach(0U, &dev, &frame[0], Echo_Receive);
+  USBD_CDC_Frame_Init(0U);
+
+  for (;;)
+  {
+    FD_ZERO(&fds);
+    FD_SET(0, &fds);
+    tv.tv_sec = 0;
+    tv.tv_usec = 1000;
+
+    if (select(1, &fds, NULL, NULL, &tv) > 0)
+    {
+      n = read(0, buf, sizeof(buf));
+      if (n <= 0)
+      {
+        break;
+      }
+      Wire_Corrupt(buf, (uint32_t)n);
+      (void)USBD_CDC_Frame_Receive(0U, buf, (uint32_t)n);
+    }
+
+    while ((echo_head != echo_tail) &&
+           (USBD_CDC_Frame_Send(0U, echo[echo_tail % ECHO_DEPTH], echo_len[echo_tail % ECHO_DEPTH]) == USBD_OK))
+    {
+      echo_tail++;
+    }
+
+    USBD_CDC_Frame_Process();
+
+    if (ring_used[0] != 0U)
+    {
+      Wire_Corrupt(ring[0], ring_used[0]);
+      if (fwrite(ring[0], 1U, ring_used[0], stdout) != ring_used[0])
+      {
+        break;
+      }
+      (void)fflush(stdout);
+      ring_used[0] = 0U;
+    }
+  }
+
+  (void)USBD_CDC_Frame_GetStats(0U, &st);
+  fprintf(stderr, "device: tx %u retries %u rx %u duplicates %u errors %u\n",
+          (unsigned)st.TxFrames, (unsigned)st.TxRetries, (unsigned)st.RxFrames,
+          (unsigned)st.RxDuplicates, (unsigned)st.RxErrors);
+
+  return 0;
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+  srand48(1);
+
+  if ((argc > 1) && (strcmp(argv[1], "--stdio") == 0))
+  {
+    loss = (argc > 2) ? atof(argv[2]) : 0.0;
+    return Echo_Run();
+  }
+
+  Link_Run(0.0, 0U);
+  Link_Run(0.0, 20U);
+  Link_Run(1e-4, 0U);
+  Link_Run(1e-3, 10U);
+
+  return Test_Done("test_usbd_cdc_frame");
+}
+
+/********************************** END OF FILE *******************************/
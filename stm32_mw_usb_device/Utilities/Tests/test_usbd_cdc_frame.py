@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""Host side of Utilities/usbd_cdc_frame.py against App/usbd_cdc_frame.c.
+
+Runs test_usbd_cdc_frame --stdio as the device end, which sends every
+payload back, both directions of the pipe corrupting bytes at the given
+rate, and checks that every payload comes back once, whole and in order:
+
+  test_usbd_cdc_frame.py [loss] [payload size] [count]
+"""
+
+import fcntl
+import os
+import random
+import select
+import struct
+import subprocess
+import sys
+import termios
+import threading
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+from usbd_cdc_frame import FramedLink, cobs_encode, cobs_decode  # noqa: E402
+
+
+class Pipe:
+    """The standard input and output of the device, as a serial port."""
+
+    def __init__(self, proc):
+        self.proc = proc
+        self.fd = proc.stdout.fileno()
+
+    @property
+    def in_waiting(self):
+        return struct.unpack('i', fcntl.ioctl(self.fd, termios.FIONREAD, b'\0\0\0\0'))[0]
+
+    def read(self, n):
+        ready, _, _ = select.select([self.fd], [], [], 0.01)
+        return os.read(self.fd, n) if ready else b''
+
+    def write(self, data):
+        self.proc.stdin.write(data)
+        self.proc.stdin.flush()
+
+
+def check_cobs():
+    for _ in range(2000):
+        data = bytes(random.choice([0, 1, 255, random.randrange(256)]) for _ in range(random.randrange(0, 800)))
+        enc = cobs_encode(data)
+        assert 0 not in enc[:-1] and enc[-1] == 0, data
+        assert cobs_decode(enc[:-1]) == data, data
+
+
+def main():
+    loss = sys.argv[1] if len(sys.argv) > 1 else '0.001'
+    size = int(sys.argv[2]) if len(sys.argv) > 2 else 256
+    count = int(sys.argv[3]) if len(sys.argv) > 3 else 500
+    device = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'test_usbd_cdc_frame')
+
+    random.seed(1)
+    check_cobs()
+
+    proc = subprocess.Popen([device, '--stdio', loss], stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+    link = FramedLink(Pipe(proc), window=8, rto=0.02)
+    payloads = [struct.pack('<I', i) + bytes(random.randrange(256) for _ in range(size - 4))
+                for i in range(count)]
+
+    def writer():
+        for payload in payloads:
+            link.send(payload, timeout=30)
+
+    thread = threading.Thread(target=writer, daemon=True)
+    start = time.monotonic()
+    thread.start()
+
+    failed = 0
+    for i in range(count):
+        payload = link.recv(timeout=30)
+        if payload != payloads[i]:
+            print('payload %d: %s' % (i, 'timeout' if payload is None else 'wrong'))
+            failed = 1
+            break
+
+    elapsed = time.monotonic() - start
+    thread.join(1.0)
+    link.close()
+    proc.stdin.close()
+    proc.wait()
+
+    print('  %d payloads of %d bytes back in %.2f s, loss %s, %s' %
+          (count, size, elapsed, loss, dict(sorted(link.stats.items()))))
+    print('test_usbd_cdc_frame.py: %s' % ('failed' if failed else 'passed'))
+    return failed
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,170 @@
+/**
+  ******************************************************************************
+  * @file    test_usbd_fifo.c
+  * @brief   Host test of the FIFO RAM layout (Core/Src/usbd_fifo.c) against
+  *          a model of the OTG FIFO registers programmed the way
+  *          HAL_PCDEx_SetTxFiFo does, each offset taken from the FIFOs below.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_core.h"
+#include "test_common.h"
+
+/* Private define ------------------------------------------------------------*/
+
+/* OTG_HS of the STM32H7 */
+#define RAM_SIZE            4096U
+#define RX_SIZE             1024U
+#define EP0_SIZE            64U
+#define DEV_ENDPOINTS       9U
+
+/* Private variables ---------------------------------------------------------*/
+
+/* Size and offset registers, in bytes */
+static uint16_t reg_size[USBD_FIFO_MAX_TX];
+static uint16_t reg_offset[USBD_FIFO_MAX_TX];
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Core_Reset(void)
+{
+  memset(reg_size, 0, sizeof(reg_size));
+  memset(reg_offset, 0, sizeof(reg_offset));
+}
+
+/* HAL_PCDEx_SetTxFiFo: the offset is the receive FIFO plus the current
+   size of every lower FIFO */
+static void Core_SetTxFiFo(uint8_t fifo, uint16_t size)
+{
+  uint16_t offset = RX_SIZE;
+
+  for (uint8_t i = 0U; i < fifo; i++)
+  {
+    offset += reg_size[i];
+  }
+
+  reg_size[fifo] = size;
+  reg_offset[fifo] = offset;
+}
+
+static void Core_ReadBack(USBD_FiFo_LayoutTypeDef *playout)
+{
+  USBD_FiFo_Init(playout, RAM_SIZE, RX_SIZE);
+  memcpy(playout->tx_size, reg_size, sizeof(reg_size));
+  memcpy(playout->tx_offset, reg_offset, sizeof(reg_offset));
+}
+
+/* CDC ACM on endpoints 2 and 3 first in the registry, MSC moved to the
+   dedicated endpoint 1 after it, HID on endpoint 4 */
+static void Layout_Mixed(USBD_FiFo_LayoutTypeDef *playout)
+{
+  USBD_FiFo_Init(playout, RAM_SIZE, RX_SIZE);
+  USBD_FiFo_Add(playout, 0x80U, EP0_SIZE, 0U);
+  USBD_FiFo_Add(playout, 0x82U, 128U, 1U);
+  USBD_FiFo_Add(playout, 0x83U, 64U, 0U);
+  USBD_FiFo_Add(playout, 0x81U, 128U, 1U);
+  USBD_FiFo_Add(playout, 0x84U, 64U, 0U);
+  USBD_FiFo_Add(playout, 0x00U, 64U, 0U);  /* endpoint left out by the planner */
+}
+
+static void Test_Plan(void)
+{
+  USBD_FiFo_LayoutTypeDef layout;
+  uint32_t end;
+
+  Layout_Mixed(&layout);
+  TEST_CHECK(USBD_FiFo_Plan(&layout) == USBD_OK);
+  TEST_CHECK(USBD_FiFo_Check(&layout) == USBD_OK);
+
+  /* Placed in endpoint order from the receive FIFO, whatever the order
+     they were added in */
+  TEST_CHECK(layout.tx_offset[0] == RX_SIZE);
+  for (uint8_t ep = 1U; ep < USBD_FIFO_MAX_TX; ep++)
+  {
+    TEST_CHECK(layout.tx_offset[ep] == layout.tx_offset[ep - 1U] + layout.tx_size[ep - 1U]);
+  }
+
+  /* The spare RAM goes to the two data endpoints in equal shares */
+  TEST_CHECK(layout.tx_size[1] == layout.tx_size[2]);
+  TEST_CHECK(layout.tx_size[1] > 128U);
+  TEST_CHECK(layout.tx_size[3] == 64U);
+  TEST_CHECK(layout.tx_size[5] == 0U);
+  TEST_CHECK((layout.tx_size[1] & 3U) == 0U);
+  end = layout.tx_offset[USBD_FIFO_MAX_TX - 1U] + layout.tx_size[USBD_FIFO_MAX_TX - 1U];
+  TEST_CHECK((end <= RAM_SIZE) && (end + 8U > RAM_SIZE));
+}
+
+static void Test_ProgramOrder(void)
+{
+  USBD_FiFo_LayoutTypeDef layout;
+  USBD_FiFo_LayoutTypeDef core;
+
+  Layout_Mixed(&layout);
+  (void)USBD_FiFo_Plan(&layout);
+
+  /* Programmed in increasing endpoint number the core ends up with the
+     planned layout */
+  Core_Reset();
+  for (uint8_t fifo = 0U; fifo < DEV_ENDPOINTS; fifo++)
+  {
+    Core_SetTxFiFo(fifo, layout.tx_size[fifo]);
+  }
+  Core_ReadBack(&core);
+  TEST_CHECK(USBD_FiFo_Check(&core) == USBD_OK);
+  TEST_CHECK(memcmp(core.tx_offset, layout.tx_offset, DEV_ENDPOINTS * sizeof(uint16_t)) == 0);
+
+  /* In registry order the FIFO of endpoint 1, sized last, runs into the
+     ones above it and the check of the read back layout says so */
+  Core_Reset();
+  Core_SetTxFiFo(0U, layout.tx_size[0]);
+  Core_SetTxFiFo(2U, layout.tx_size[2]);
+  Core_SetTxFiFo(3U, layout.tx_size[3]);
+  Core_SetTxFiFo(1U, layout.tx_size[1]);
+  Core_SetTxFiFo(4U, layout.tx_size[4]);
+  Core_ReadBack(&core);
+  TEST_CHECK(USBD_FiFo_Check(&core) == USBD_FAIL);
+}
+
+static void Test_Overflow(void)
+{
+  USBD_FiFo_LayoutTypeDef layout;
+
+  /* More than the RAM is reported and the check catches the last FIFO */
+  USBD_FiFo_Init(&layout, RAM_SIZE, RX_SIZE);
+  USBD_FiFo_Add(&layout, 0x80U, EP0_SIZE, 0U);
+  for (uint8_t ep = 1U; ep < DEV_ENDPOINTS; ep++)
+  {
+    USBD_FiFo_Add(&layout, ep | 0x80U, 512U, 1U);
+  }
+  TEST_CHECK(USBD_FiFo_Plan(&layout) == USBD_FAIL);
+  TEST_CHECK(USBD_FiFo_Check(&layout) == USBD_FAIL);
+
+  /* A FIFO over the receive FIFO */
+  USBD_FiFo_Init(&layout, RAM_SIZE, RX_SIZE);
+  layout.tx_size[0] = EP0_SIZE;
+  layout.tx_offset[0] = RX_SIZE - 4U;
+  TEST_CHECK(USBD_FiFo_Check(&layout) == USBD_FAIL);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main(void)
+{
+  Test_Plan();
+  Test_ProgramOrder();
+  Test_Overflow();
+
+  return Test_Done("test_usbd_fifo");
+}
+
+/********************************** END OF FILE *******************************/
@@ -0,0 +1,169 @@
+/**
+  ******************************************************************************
+  * @file    test_usbd_gov.c
+  * @brief   Host test of the clock governor (Core/Src/usbd_gov.c): the policy
+  *          of USBD_Gov_Step on synthetic loads, and the levels applied
+  *          through a low level driver that refuses the levels below the
+  *          bus clock floor of the USB core.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_core.h"
+#include "test_common.h"
+
+/* Private define ------------------------------------------------------------*/
+
+/* 72 MHz AHB clock at full speed: /2 gives 36 MHz, /4 18 MHz is below the
+   30 MHz OTG_HS needs */
+#define HCLK_FULL           72000000U
+#define HCLK_MIN            30000000U
+
+/* Private variables ---------------------------------------------------------*/
+
+static USBD_HandleTypeDef dev;
+static uint8_t ll_level;
+static uint32_t ll_calls;
+
+/* Private functions ---------------------------------------------------------*/
+
+USBD_StatusTypeDef USBD_LL_SetPerfLevel(uint8_t level)
+{
+  ll_calls++;
+
+  if ((HCLK_FULL >> level) < HCLK_MIN)
+  {
+    return USBD_FAIL;
+  }
+
+  ll_level = level;
+  return USBD_OK;
+}
+
+static uint8_t Step_Idle(USBD_GovStateTypeDef *pgov, uint32_t frames)
+{
+  USBD_GovSampleTypeDef sample = {0U, 0U, 0U};
+  uint8_t level = pgov->level;
+
+  for (uint32_t i = 0U; i < frames; i++)
+  {
+    level = USBD_Gov_Step(pgov, &sample);
+  }
+
+  return level;
+}
+
+static void Test_StepIdle(void)
+{
+  USBD_GovStateTypeDef gov = {0U, 0U, 0U};
+
+  /* One level per USBD_GOV_IDLE_FRAMES idle frames, up to the slowest */
+  TEST_CHECK(Step_Idle(&gov, USBD_GOV_IDLE_FRAMES - 1U) == 0U);
+  TEST_CHECK(Step_Idle(&gov, 1U) == 1U);
+  TEST_CHECK(Step_Idle(&gov, USBD_GOV_IDLE_FRAMES) == 2U);
+  TEST_CHECK(Step_Idle(&gov, USBD_GOV_IDLE_FRAMES * 4U) == USBD_GOV_MAX_LEVEL);
+}
+
+static void Test_StepLoad(void)
+{
+  USBD_GovStateTypeDef gov = {0U, 0U, USBD_GOV_MAX_LEVEL};
+  USBD_GovSampleTypeDef sample = {0U, 0U, 0U};
+
+  /* A burst brings the clock back to full speed at once */
+  sample.bytes = USBD_GOV_UP_BYTES;
+  TEST_CHECK(USBD_Gov_Step(&gov, &sample) == 0U);
+
+  /* So does a backed up IN queue with no data moved */
+  gov.level = USBD_GOV_MAX_LEVEL;
+  sample.bytes = 0U;
+  sample.backlog = 1U;
+  TEST_CHECK(USBD_Gov_Step(&gov, &sample) == 0U);
+
+  /* A steady trickle above USBD_GOV_IDLE_BYTES keeps the level */
+  gov.avg = 0U;
+  gov.level = 1U;
+  sample.bytes = USBD_GOV_IDLE_BYTES * 2U;
+  sample.backlog = 0U;
+  for (uint32_t i = 0U; i < USBD_GOV_IDLE_FRAMES * 2U; i++)
+  {
+    (void)USBD_Gov_Step(&gov, &sample);
+  }
+  TEST_CHECK(gov.level == 1U);
+
+  /* An open isochronous endpoint freezes the level whatever the load */
+  gov.avg = 0U;
+  sample.bytes = 0U;
+  sample.iso = 1U;
+  for (uint32_t i = 0U; i < USBD_GOV_IDLE_FRAMES * 2U; i++)
+  {
+    (void)USBD_Gov_Step(&gov, &sample);
+  }
+  TEST_CHECK(gov.level == 1U);
+  TEST_CHECK(gov.idle == 0U);
+  sample.bytes = USBD_GOV_UP_BYTES;
+  TEST_CHECK(USBD_Gov_Step(&gov, &sample) == 1U);
+}
+
+static void Test_Floor(void)
+{
+  /* Idle long enough for the slowest level, the driver stops at /2 */
+  for (uint32_t i = 0U; i < USBD_GOV_IDLE_FRAMES * (USBD_GOV_MAX_LEVEL + 2U); i++)
+  {
+    USBD_Gov_SOF(&dev);
+  }
+  TEST_CHECK(USBD_Gov_GetLevel() == 1U);
+  TEST_CHECK(ll_level == 1U);
+  TEST_CHECK((HCLK_FULL >> ll_level) >= HCLK_MIN);
+
+  /* No retry of the refused level while the policy stays there */
+  ll_calls = 0U;
+  for (uint32_t i = 0U; i < USBD_GOV_IDLE_FRAMES; i++)
+  {
+    USBD_Gov_SOF(&dev);
+  }
+  TEST_CHECK(ll_calls == 0U);
+
+  /* Traffic goes back to full speed without waiting for the SOF */
+  USBD_Gov_Traffic(&dev, USBD_GOV_UP_BYTES);
+  TEST_CHECK(USBD_Gov_GetLevel() == 0U);
+  TEST_CHECK(ll_level == 0U);
+  USBD_Gov_SOF(&dev);
+
+  /* An isochronous endpoint opening at a slow level restores the clock
+     first and keeps it */
+  for (uint32_t i = 0U; i < USBD_GOV_IDLE_FRAMES; i++)
+  {
+    USBD_Gov_SOF(&dev);
+  }
+  TEST_CHECK(ll_level == 1U);
+  USBD_Gov_SetIso(&dev, 0x81U, 1U);
+  TEST_CHECK(ll_level == 0U);
+  for (uint32_t i = 0U; i < USBD_GOV_IDLE_FRAMES * 2U; i++)
+  {
+    USBD_Gov_SOF(&dev);
+  }
+  TEST_CHECK(ll_level == 0U);
+  USBD_Gov_SetIso(&dev, 0x81U, 0U);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main(void)
+{
+  Test_StepIdle();
+  Test_StepLoad();
+  Test_Floor();
+
+  return Test_Done("test_usbd_gov");
+}
+
+/********************************** END OF FILE *******************************/
@@ -0,0 +1,253 @@
+/**
+  ******************************************************************************
+  * @file    test_usbd_ipc.c
+  * @brief   Host test of the inter-core transport (Core/Src/usbd_ipc.c), two
+  *          threads standing in for the two cores: messages streamed both
+  *          ways through the rings, calls answered, and calls cancelled
+  *          before or after the service side claimed them.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <pthread.h>
+#include <sched.h>
+#include "usbd_core.h"
+#include "test_common.h"
+
+/* Private define ------------------------------------------------------------*/
+
+#define STREAM_COUNT        100000U
+
+#define OP_STREAM           0x01U   /* posted, sent back to the stack side */
+#define OP_FILL             0x02U   /* call, fills the buffer with arg[0] */
+#define OP_FILL_SLOW        0x03U   /* call, claimed then answered late */
+
+#define SLOW_US             200000U
+
+/* Private variables ---------------------------------------------------------*/
+
+static pthread_t service_thread;
+static pthread_t stack_rx_thread;
+static volatile int service_run;
+static volatile int service_hold;      /* the service side stops draining */
+static volatile uint32_t service_calls;
+
+static volatile uint32_t stream_rx;
+static volatile uint32_t stream_bad;
+
+/* Private functions ---------------------------------------------------------*/
+
+/* The other side polls, give it the processor as the doorbell interrupt
+   would */
+void USBD_IPC_Doorbell(uint8_t ring)
+{
+  (void)ring;
+  (void)sched_yield();
+}
+
+static void Service_Call(USBD_IPC_MsgTypeDef *pmsg)
+{
+  if (USBD_IPC_Claim(pmsg) != USBD_OK)
+  {
+    return;
+  }
+
+  service_calls++;
+
+  if (pmsg->op == OP_FILL_SLOW)
+  {
+    Test_SleepUs(SLOW_US);
+  }
+
+  memset(pmsg->pbuf, (int)pmsg->arg[0], pmsg->len);
+  pmsg->status = (int8_t)(pmsg->arg[0] & 0x7FU);
+  pmsg->arg[1] = pmsg->len;
+  USBD_IPC_Reply(pmsg);
+}
+
+/* Service side core */
+static void *Service_Main(void *arg)
+{
+  USBD_IPC_MsgTypeDef msg;
+
+  (void)arg;
+
+  while (service_run != 0)
+  {
+    if ((service_hold != 0) || (USBD_IPC_Receive(USBD_IPC_TO_SERVICE, &msg) != USBD_OK))
+    {
+      (void)sched_yield();
+      continue;
+    }
+
+    if (msg.seq != 0U)
+    {
+      Service_Call(&msg);
+    }
+    else if (USBD_IPC_Post(USBD_IPC_TO_STACK, &msg) != USBD_OK)
+    {
+      stream_bad++;
+    }
+  }
+
+  return NULL;
+}
+
+/* Stack side core, draining the ring towards it */
+static void *Stack_Rx_Main(void *arg)
+{
+  USBD_IPC_MsgTypeDef msg;
+
+  (void)arg;
+
+  while (stream_rx < STREAM_COUNT)
+  {
+    if (USBD_IPC_Receive(USBD_IPC_TO_STACK, &msg) != USBD_OK)
+    {
+      (void)sched_yield();
+      continue;
+    }
+
+    /* In order and whole, nothing lost or torn */
+    if ((msg.op != OP_STREAM) || (msg.arg[0] != stream_rx) || (msg.arg[1] != ~stream_rx) ||
+        (msg.len != stream_rx * 3U) || (msg.pbuf != (uint8_t *)(uintptr_t)stream_rx) ||
+        (msg.ch != (uint8_t)stream_rx))
+    {
+      stream_bad++;
+    }
+
+    stream_rx++;
+  }
+
+  return NULL;
+}
+
+static void Test_Stream(void)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+  uint32_t busy = 0U;
+
+  pthread_create(&stack_rx_thread, NULL, Stack_Rx_Main, NULL);
+
+  for (uint32_t i = 0U; i < STREAM_COUNT; i++)
+  {
+    msg.op = OP_STREAM;
+    msg.ch = (uint8_t)i;
+    msg.arg[0] = i;
+    msg.arg[1] = ~i;
+    msg.len = i * 3U;
+    msg.pbuf = (uint8_t *)(uintptr_t)i;
+
+    while (USBD_IPC_Post(USBD_IPC_TO_SERVICE, &msg) != USBD_OK)
+    {
+      busy++;
+      (void)sched_yield();
+    }
+  }
+
+  pthread_join(stack_rx_thread, NULL);
+  printf("  %u messages through both rings, %u full ring timeouts\n", (unsigned)stream_rx, (unsigned)busy);
+  TEST_CHECK(stream_rx == STREAM_COUNT);
+  TEST_CHECK(stream_bad == 0U);
+}
+
+static void Test_Call(void)
+{
+  USBD_IPC_MsgTypeDef msg;
+  uint8_t buf[64];
+  int good = 0;
+
+  for (uint32_t i = 1U; i <= 1000U; i++)
+  {
+    memset(&msg, 0, sizeof(msg));
+    msg.op = OP_FILL;
+    msg.arg[0] = i & 0xFFU;
+    msg.pbuf = buf;
+    msg.len = (i % sizeof(buf)) + 1U;
+
+    if ((USBD_IPC_Call(&msg) == USBD_OK) && (msg.status == (int8_t)(i & 0x7FU)) &&
+        (msg.arg[1] == msg.len) && (buf[msg.len - 1U] == (uint8_t)i))
+    {
+      good++;
+    }
+  }
+
+  TEST_CHECK(good == 1000);
+}
+
+static void Test_CancelBeforeClaim(void)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+  uint8_t buf[16];
+  uint32_t calls;
+
+  /* The service side is stuck: the call gives up and the buffer is the
+     caller's again */
+  service_hold = 1;
+  calls = service_calls;
+  memset(buf, 0xEE, sizeof(buf));
+  msg.op = OP_FILL;
+  msg.arg[0] = 0x11U;
+  msg.pbuf = buf;
+  msg.len = sizeof(buf);
+  TEST_CHECK(USBD_IPC_Call(&msg) == USBD_FAIL);
+
+  /* Once it drains the ring, the cancelled call is dropped untouched */
+  service_hold = 0;
+  Test_SleepUs(SLOW_US);
+  TEST_CHECK(service_calls == calls);
+  TEST_CHECK((buf[0] == 0xEEU) && (buf[sizeof(buf) - 1U] == 0xEEU));
+
+  /* And the next call gets its own reply, not a stale one */
+  msg.op = OP_FILL;
+  msg.arg[0] = 0x22U;
+  TEST_CHECK(USBD_IPC_Call(&msg) == USBD_OK);
+  TEST_CHECK((msg.status == 0x22) && (buf[0] == 0x22U));
+}
+
+static void Test_CancelAfterClaim(void)
+{
+  USBD_IPC_MsgTypeDef msg = {0};
+  uint8_t buf[16];
+
+  /* Claimed before the spin runs out: the call waits for the reply rather
+     than hand back a buffer still being written */
+  memset(buf, 0xEE, sizeof(buf));
+  msg.op = OP_FILL_SLOW;
+  msg.arg[0] = 0x33U;
+  msg.pbuf = buf;
+  msg.len = sizeof(buf);
+  TEST_CHECK(USBD_IPC_Call(&msg) == USBD_OK);
+  TEST_CHECK((msg.status == 0x33) && (buf[sizeof(buf) - 1U] == 0x33U));
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main(void)
+{
+  USBD_IPC_Init();
+
+  service_run = 1;
+  pthread_create(&service_thread, NULL, Service_Main, NULL);
+
+  Test_Stream();
+  Test_Call();
+  Test_CancelBeforeClaim();
+  Test_CancelAfterClaim();
+
+  service_run = 0;
+  pthread_join(service_thread, NULL);
+
+  return Test_Done("test_usbd_ipc");
+}
+
+/********************************** END OF FILE *******************************/
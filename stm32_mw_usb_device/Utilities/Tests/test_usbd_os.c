@@ -0,0 +1,508 @@
+/**
+  ******************************************************************************
+  * @file    test_usbd_os.c
+  * @brief   Host test of the RTOS binding (Core/Src/usbd_os.c) and of the MSC
+  *          storage accesses it runs on the worker task. The test thread
+  *          plays the USB interrupt, holding Test_Lock as the handler runs
+  *          with the other interrupts masked.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <pthread.h>
+#include "usbd_core.h"
+#include "usbd_msc.h"
+#include "test_common.h"
+
+/* Private define ------------------------------------------------------------*/
+
+#define MSC_CLASS_ID        1U
+#define MSC_IN              0x81U
+#define MSC_OUT             0x01U
+#define MSC_BLOCKS          64U
+
+/* Private variables ---------------------------------------------------------*/
+
+static USBD_HandleTypeDef dev;
+static USBD_MSC_BOT_HandleTypeDef msc;
+static pthread_t isr_thread;
+
+/* Endpoint activity seen by the fake low level driver */
+static struct
+{
+  uint32_t tx_count;
+  uint8_t tx_ep;
+  uint8_t *tx_buf;
+  uint32_t tx_len;
+  uint32_t rx_count;
+  uint8_t *rx_buf;
+  uint32_t rx_len;
+  uint32_t stalls;
+} ll;
+
+static uint8_t media[MSC_BLOCKS * 512U];
+static volatile int media_calls;
+static volatile int media_other_thread;
+static volatile int media_fail;
+static volatile int media_hold;
+
+static int8_t inquiry[36];
+
+/* Private functions ---------------------------------------------------------*/
+
+USBD_StatusTypeDef USBD_LL_Transmit(USBD_HandleTypeDef *pdev, uint8_t ep_addr,
+                                    uint8_t *pbuf, uint32_t size)
+{
+  (void)pdev;
+  ll.tx_count++;
+  ll.tx_ep = ep_addr;
+  ll.tx_buf = pbuf;
+  ll.tx_len = size;
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_PrepareReceive(USBD_HandleTypeDef *pdev, uint8_t ep_addr,
+                                          uint8_t *pbuf, uint32_t size)
+{
+  (void)pdev;
+  TEST_CHECK(ep_addr == MSC_OUT);
+  ll.rx_count++;
+  ll.rx_buf = pbuf;
+  ll.rx_len = size;
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_StallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  (void)pdev;
+  (void)ep_addr;
+  ll.stalls++;
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_ClearStallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  (void)pdev;
+  (void)ep_addr;
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_FlushEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  (void)pdev;
+  (void)ep_addr;
+  return USBD_OK;
+}
+
+uint32_t USBD_LL_GetRxDataSize(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  (void)pdev;
+  (void)ep_addr;
+  return USBD_BOT_CBW_LENGTH;
+}
+
+USBD_StatusTypeDef USBD_CoreDeferInit(USBD_HandleTypeDef *pdev,
+                                      void (*DeferredInit)(USBD_HandleTypeDef *pdev))
+{
+  DeferredInit(pdev);
+  return USBD_OK;
+}
+
+static int8_t Storage_Init(uint8_t lun)
+{
+  (void)lun;
+  return 0;
+}
+
+static int8_t Storage_GetCapacity(uint8_t lun, uint32_t *block_num, uint16_t *block_size)
+{
+  (void)lun;
+  *block_num = MSC_BLOCKS;
+  *block_size = 512U;
+  return 0;
+}
+
+static int8_t Storage_IsReady(uint8_t lun)
+{
+  (void)lun;
+  return 0;
+}
+
+static int8_t Storage_IsWriteProtected(uint8_t lun)
+{
+  (void)lun;
+  return 0;
+}
+
+/* A slow medium: the access has to leave the interrupt free meanwhile */
+static int8_t Storage_Access(uint8_t *dst, const uint8_t *src, uint16_t blk_len)
+{
+  media_calls++;
+
+  if (pthread_equal(pthread_self(), isr_thread) == 0)
+  {
+    media_other_thread++;
+  }
+
+  Test_SleepUs(5000U);
+
+  while (media_hold != 0)
+  {
+    Test_SleepUs(1000U);
+  }
+
+  if (media_fail != 0)
+  {
+    return -1;
+  }
+
+  memcpy(dst, src, (size_t)blk_len * 512U);
+  return 0;
+}
+
+static int8_t Storage_Read(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len)
+{
+  (void)lun;
+  return Storage_Access(buf, &media[blk_addr * 512U], blk_len);
+}
+
+static int8_t Storage_Write(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len)
+{
+  (void)lun;
+  return Storage_Access(&media[blk_addr * 512U], buf, blk_len);
+}
+
+static int8_t Storage_GetMaxLun(void)
+{
+  return 0;
+}
+
+static USBD_StorageTypeDef storage =
+{
+  Storage_Init,
+  Storage_GetCapacity,
+  Storage_IsReady,
+  Storage_IsWriteProtected,
+  Storage_Read,
+  Storage_Write,
+  Storage_GetMaxLun,
+  inquiry,
+};
+
+/* Run a class callback as the USB interrupt would */
+static void Isr_DataOut(void)
+{
+  Test_Lock();
+  dev.classId = MSC_CLASS_ID;
+  MSC_BOT_DataOut(&dev, MSC_OUT & 0x7FU);
+  dev.classId = 0U;
+  Test_Unlock();
+}
+
+static void Isr_DataIn(void)
+{
+  Test_Lock();
+  dev.classId = MSC_CLASS_ID;
+  MSC_BOT_DataIn(&dev, MSC_IN & 0x7FU);
+  dev.classId = 0U;
+  Test_Unlock();
+}
+
+static void Isr_Reset(void)
+{
+  Test_Lock();
+  dev.classId = MSC_CLASS_ID;
+  MSC_BOT_Reset(&dev);
+  dev.classId = 0U;
+  Test_Unlock();
+}
+
+static uint32_t Ll_TxCount(void)
+{
+  uint32_t n;
+
+  Test_Lock();
+  n = ll.tx_count;
+  Test_Unlock();
+  return n;
+}
+
+static uint32_t Ll_RxCount(void)
+{
+  uint32_t n;
+
+  Test_Lock();
+  n = ll.rx_count;
+  Test_Unlock();
+  return n;
+}
+
+/* Wait for the worker task to arm an endpoint, 0 on timeout */
+static int Wait_Count(uint32_t (*count)(void), uint32_t target)
+{
+  uint32_t ms;
+
+  for (ms = 0U; ms < 1000U; ms++)
+  {
+    if (count() >= target)
+    {
+      return 1;
+    }
+    Test_SleepUs(1000U);
+  }
+
+  return 0;
+}
+
+static void Host_Cbw(uint8_t opcode, uint8_t dir_in, uint32_t blk_addr, uint16_t blk_len)
+{
+  memset(&msc.cbw, 0, sizeof(msc.cbw));
+  msc.cbw.dSignature = USBD_BOT_CBW_SIGNATURE;
+  msc.cbw.dTag = 0x1234U + opcode;
+  msc.cbw.dDataLength = (uint32_t)blk_len * 512U;
+  msc.cbw.bmFlags = (dir_in != 0U) ? 0x80U : 0U;
+  msc.cbw.bCBLength = 10U;
+  msc.cbw.CB[0] = opcode;
+  msc.cbw.CB[2] = (uint8_t)(blk_addr >> 24);
+  msc.cbw.CB[3] = (uint8_t)(blk_addr >> 16);
+  msc.cbw.CB[4] = (uint8_t)(blk_addr >> 8);
+  msc.cbw.CB[5] = (uint8_t)blk_addr;
+  msc.cbw.CB[7] = (uint8_t)(blk_len >> 8);
+  msc.cbw.CB[8] = (uint8_t)blk_len;
+}
+
+/* Wake-up condition of the binding tests */
+static volatile uint8_t cond_value;
+
+static uint8_t Cond_IsSet(void *arg)
+{
+  (void)arg;
+  return cond_value;
+}
+
+static void *Signal_Later(void *arg)
+{
+  (void)arg;
+  Test_SleepUs(20000U);
+  cond_value = 1U;
+  USBD_OS_Signal(&dev, MSC_IN);
+  return NULL;
+}
+
+static void *Abort_Later(void *arg)
+{
+  (void)arg;
+  Test_SleepUs(20000U);
+  dev.dev_state = USBD_STATE_DEFAULT;
+  USBD_OS_Abort(&dev);
+  return NULL;
+}
+
+static int job_order[3];
+static volatile int job_done;
+static volatile int job_on_worker;
+
+static void Job_Record(USBD_HandleTypeDef *pdev, void *arg)
+{
+  TEST_CHECK(pdev == &dev);
+  job_order[job_done] = (int)(intptr_t)arg;
+  job_on_worker += (pthread_equal(pthread_self(), isr_thread) == 0) ? 1 : 0;
+  job_done++;
+}
+
+static void Test_Binding(void)
+{
+  pthread_t t;
+  uint32_t timeout;
+  uint32_t start;
+  int n;
+
+  /* Jobs run on the worker task, in the order they were posted */
+  for (n = 0; n < 3; n++)
+  {
+    TEST_CHECK(USBD_OS_Post(&dev, Job_Record, (void *)(intptr_t)(n + 1)) == USBD_OK);
+  }
+
+  for (n = 0; (n < 1000) && (job_done < 3); n++)
+  {
+    Test_SleepUs(1000U);
+  }
+
+  TEST_CHECK(job_done == 3);
+  TEST_CHECK(job_on_worker == 3);
+  TEST_CHECK((job_order[0] == 1) && (job_order[1] == 2) && (job_order[2] == 3));
+
+  /* A completion wakes the waiting task, the budget left is returned */
+  cond_value = 0U;
+  timeout = 1000U;
+  start = osKernelGetTickCount();
+  pthread_create(&t, NULL, Signal_Later, NULL);
+  TEST_CHECK(USBD_OS_Wait(&dev, MSC_IN, Cond_IsSet, NULL, &timeout) == USBD_OK);
+  TEST_CHECK((osKernelGetTickCount() - start) < 500U);
+  TEST_CHECK((timeout > 500U) && (timeout < 1000U));
+  pthread_join(t, NULL);
+
+  /* Nothing completes: USBD_BUSY once the budget is spent */
+  cond_value = 0U;
+  timeout = 30U;
+  start = osKernelGetTickCount();
+  TEST_CHECK(USBD_OS_Wait(&dev, MSC_IN, Cond_IsSet, NULL, &timeout) == USBD_BUSY);
+  TEST_CHECK(timeout == 0U);
+  TEST_CHECK((osKernelGetTickCount() - start) >= 30U);
+
+  /* A disconnect releases a task waiting forever */
+  timeout = osWaitForever;
+  pthread_create(&t, NULL, Abort_Later, NULL);
+  TEST_CHECK(USBD_OS_Wait(&dev, MSC_OUT, Cond_IsSet, NULL, &timeout) == USBD_FAIL);
+  pthread_join(t, NULL);
+  dev.dev_state = USBD_STATE_CONFIGURED;
+}
+
+static void Test_MscRead(void)
+{
+  uint32_t tx;
+  uint32_t n;
+
+  for (n = 0U; n < sizeof(media); n++)
+  {
+    media[n] = (uint8_t)(n * 7U + (n >> 9));
+  }
+
+  /* READ(10) of 2 blocks: the interrupt returns before the medium is read */
+  media_calls = 0;
+  media_other_thread = 0;
+  tx = Ll_TxCount();
+  Host_Cbw(0x28U, 1U, 4U, 2U);
+  Isr_DataOut();
+  TEST_CHECK(Ll_TxCount() == tx);
+
+  TEST_CHECK(Wait_Count(Ll_TxCount, tx + 1U));
+  TEST_CHECK((ll.tx_ep == MSC_IN) && (ll.tx_len == 512U));
+  TEST_CHECK(memcmp(ll.tx_buf, &media[4U * 512U], 512U) == 0);
+
+  /* Second block once the first one went out, then the CSW */
+  Isr_DataIn();
+  TEST_CHECK(Wait_Count(Ll_TxCount, tx + 2U));
+  TEST_CHECK(memcmp(ll.tx_buf, &media[5U * 512U], 512U) == 0);
+
+  n = Ll_RxCount();
+  Isr_DataIn();
+  TEST_CHECK(Ll_TxCount() == tx + 3U);
+  TEST_CHECK(ll.tx_len == USBD_BOT_CSW_LENGTH);
+  TEST_CHECK((msc.csw.bStatus == USBD_CSW_CMD_PASSED) && (msc.csw.dDataResidue == 0U));
+  TEST_CHECK((Ll_RxCount() == n + 1U) && (ll.rx_buf == (uint8_t *)&msc.cbw));
+
+  TEST_CHECK((media_calls == 2) && (media_other_thread == 2));
+}
+
+static void Test_MscWrite(void)
+{
+  uint32_t tx;
+  uint32_t rx;
+  uint32_t n;
+
+  /* WRITE(10) of 1 block: the data stage is received first */
+  media_calls = 0;
+  media_other_thread = 0;
+  rx = Ll_RxCount();
+  Host_Cbw(0x2AU, 0U, 9U, 1U);
+  Isr_DataOut();
+  TEST_CHECK((Ll_RxCount() == rx + 1U) && (ll.rx_buf == msc.bot_data) && (ll.rx_len == 512U));
+
+  for (n = 0U; n < 512U; n++)
+  {
+    msc.bot_data[n] = (uint8_t)(0xA5U ^ n);
+  }
+
+  /* The OUT endpoint NAKs while the worker task writes */
+  tx = Ll_TxCount();
+  Isr_DataOut();
+  TEST_CHECK((Ll_TxCount() == tx) && (Ll_RxCount() == rx + 1U));
+
+  TEST_CHECK(Wait_Count(Ll_TxCount, tx + 1U));
+  TEST_CHECK(ll.tx_len == USBD_BOT_CSW_LENGTH);
+  TEST_CHECK(msc.csw.bStatus == USBD_CSW_CMD_PASSED);
+  TEST_CHECK(memcmp(&media[9U * 512U], msc.bot_data, 512U) == 0);
+  TEST_CHECK((media_calls == 1) && (media_other_thread == 1));
+}
+
+static void Test_MscResetAndError(void)
+{
+  uint32_t tx;
+  uint32_t rx;
+  uint32_t stalls;
+
+  /* A BOT reset during the access: the stale block is not sent and the next
+     CBW is only received once the worker task gave bot_data back */
+  media_hold = 1;
+  tx = Ll_TxCount();
+  rx = Ll_RxCount();
+  Host_Cbw(0x28U, 1U, 0U, 1U);
+  Isr_DataOut();
+  Test_SleepUs(2000U);
+  Isr_Reset();
+  TEST_CHECK(Ll_RxCount() == rx);
+  media_hold = 0;
+
+  TEST_CHECK(Wait_Count(Ll_RxCount, rx + 1U));
+  TEST_CHECK(ll.rx_buf == (uint8_t *)&msc.cbw);
+  TEST_CHECK(Ll_TxCount() == tx);
+
+  /* A media error on the first block stalls the IN endpoint, as the
+     interrupt driven path does */
+  media_fail = 1;
+  stalls = ll.stalls;
+  msc.bot_status = USBD_BOT_STATUS_NORMAL;
+  Host_Cbw(0x28U, 1U, 0U, 1U);
+  Isr_DataOut();
+  Test_SleepUs(50000U);
+  Test_Lock();
+  TEST_CHECK(ll.stalls > stalls);
+  TEST_CHECK(ll.tx_count == tx);
+  TEST_CHECK(msc.os_busy == 0U);
+  Test_Unlock();
+  media_fail = 0;
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main(void)
+{
+  isr_thread = pthread_self();
+
+  dev.dev_state = USBD_STATE_CONFIGURED;
+  TEST_CHECK(USBD_OS_Init(&dev) == USBD_OK);
+
+  dev.NumClasses = 2U;
+  dev.tclass[MSC_CLASS_ID].pClassData = &msc;
+  dev.tclass[MSC_CLASS_ID].pUserData = &storage;
+  dev.tclass[MSC_CLASS_ID].map.in_ep = MSC_IN;
+  dev.tclass[MSC_CLASS_ID].map.out_ep = MSC_OUT;
+  msc.scsi_blk_size = 512U;
+  msc.scsi_blk_nbr = MSC_BLOCKS;
+
+  Test_Lock();
+  dev.classId = MSC_CLASS_ID;
+  MSC_BOT_Init(&dev);
+  dev.classId = 0U;
+  Test_Unlock();
+  TEST_CHECK((ll.rx_count == 1U) && (ll.rx_buf == (uint8_t *)&msc.cbw));
+
+  Test_Binding();
+  Test_MscRead();
+  Test_MscWrite();
+  Test_MscResetAndError();
+
+  return Test_Done("test_usbd_os");
+}
+
+/********************************** END OF FILE *******************************/
@@ -0,0 +1,168 @@
+/**
+  ******************************************************************************
+  * @file    test_usbd_time.c
+  * @brief   Host test of the SOF time base (Core/Src/usbd_time.c) against a
+  *          simulated high speed host: a 480 MHz local counter off by a set
+  *          drift, SOF interrupts taken with a random latency.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <math.h>
+#include "usbd_core.h"
+#include "test_common.h"
+
+/* Private define ------------------------------------------------------------*/
+
+#define LOCAL_FREQ          480000000U
+#define LATENCY_MAX_US      4.0
+
+/* Private variables ---------------------------------------------------------*/
+
+static USBD_HandleTypeDef dev;
+
+/* Host time in us and the local clock it maps to */
+static double host_us;
+static double drift_ppm;
+static double local_offset;
+static uint16_t frame_number;
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint32_t Local_Ticks(double us)
+{
+  double ticks = local_offset + us * (LOCAL_FREQ / 1e6) * (1.0 + drift_ppm * 1e-6);
+
+  return (uint32_t)(uint64_t)fmod(ticks, 4294967296.0);
+}
+
+uint32_t USBD_LL_GetFrameNumber(USBD_HandleTypeDef *pdev)
+{
+  (void)pdev;
+  return frame_number;
+}
+
+uint32_t USBD_LL_GetTimestamp(void)
+{
+  return Local_Ticks(host_us);
+}
+
+uint32_t USBD_LL_GetTimestampFreq(void)
+{
+  return LOCAL_FREQ;
+}
+
+/* Run the SOFs of n microframes, the interrupt latched late by a random
+   0 to LATENCY_MAX_US */
+static void Run_Sofs(uint32_t n)
+{
+  uint32_t i;
+
+  for (i = 0U; i < n; i++)
+  {
+    host_us += USBD_TIME_US_PER_UFRAME;
+    frame_number = (uint16_t)(((uint64_t)(host_us / USBD_TIME_US_PER_UFRAME)) & 0x3FFFU);
+
+    Test_Lock();
+    USBD_Time_SOF(&dev, Local_Ticks(host_us + drand48() * LATENCY_MAX_US));
+    Test_Unlock();
+  }
+}
+
+/* Largest error of ToFrameTime over a microframe, in whole us as it
+   returns, against the host time less the mean latency, a constant offset
+   the loop cannot observe */
+static double Max_Frame_Error(void)
+{
+  double worst = 0.0;
+  double err;
+  double t;
+
+  for (t = 0.0; t < USBD_TIME_US_PER_UFRAME; t += 7.3)
+  {
+    err = (double)USBD_Time_ToFrameTime(&dev, Local_Ticks(host_us + t)) -
+          floor(host_us + t - LATENCY_MAX_US / 2.0);
+    worst = fmax(worst, fabs(err));
+  }
+
+  return worst;
+}
+
+static void Test_Track(double ppm)
+{
+  uint64_t usb_us;
+  uint32_t ts;
+  double err;
+
+  drift_ppm = ppm;
+  local_offset = drand48() * 4294967296.0;
+  USBD_Time_Reset(&dev);
+
+  /* Not locked before USBD_TIME_LOCK_COUNT SOFs */
+  Run_Sofs(USBD_TIME_LOCK_COUNT / 2U);
+  TEST_CHECK(USBD_Time_IsLocked(&dev) == 0U);
+
+  /* One second of SOFs, the 32-bit local counter wraps on the way */
+  Run_Sofs(8000U);
+  TEST_CHECK(USBD_Time_IsLocked(&dev) == 1U);
+  TEST_CHECK(abs(USBD_Time_GetDrift(&dev) - (int32_t)ppm) <= 10);
+  printf("  %+5.0f ppm: drift %+d ppm, frame time error %.2f us\n",
+         ppm, (int)USBD_Time_GetDrift(&dev), Max_Frame_Error());
+  TEST_CHECK(Max_Frame_Error() <= 1.0);
+
+  /* Back to local time */
+  usb_us = (uint64_t)(host_us + 60.0);
+  ts = USBD_Time_ToLocalTime(&dev, usb_us);
+  err = fabs((double)(int32_t)(ts - Local_Ticks((double)usb_us + LATENCY_MAX_US / 2.0))) /
+        (LOCAL_FREQ / 1e6);
+  TEST_CHECK(err <= 1.0);
+}
+
+static void Test_Gap(void)
+{
+  /* A suspend of 3.3 s wraps the 14-bit (micro)frame counter, the wrap is
+     counted on the local clock */
+  host_us += 3.3e6;
+  Run_Sofs(USBD_TIME_LOCK_COUNT * 2U);
+  TEST_CHECK(USBD_Time_IsLocked(&dev) == 1U);
+  TEST_CHECK(Max_Frame_Error() <= 1.0);
+
+  /* The phase step of the restart moves the rate for a while */
+  Run_Sofs(8000U);
+  TEST_CHECK(abs(USBD_Time_GetDrift(&dev) - (int32_t)drift_ppm) <= 10);
+}
+
+static void Test_ResetKeepsRate(void)
+{
+  /* The rate learnt before a bus reset is used from the first SOF after */
+  USBD_Time_Reset(&dev);
+  TEST_CHECK(USBD_Time_IsLocked(&dev) == 0U);
+  Run_Sofs(1U);
+  TEST_CHECK(abs(USBD_Time_GetDrift(&dev) - (int32_t)drift_ppm) <= 10);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main(void)
+{
+  srand48(1);
+  host_us = 1000.0 * USBD_TIME_US_PER_UFRAME;
+
+  Test_Track(100.0);
+  Test_Track(-250.0);
+  Test_Gap();
+  Test_ResetKeepsRate();
+
+  return Test_Done("test_usbd_time");
+}
+
+/********************************** END OF FILE *******************************/
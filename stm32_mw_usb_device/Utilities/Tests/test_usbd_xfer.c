@@ -0,0 +1,345 @@
+/**
+  ******************************************************************************
+  * @file    test_usbd_xfer.c
+  * @brief   Host test of the per endpoint transfer queues (usbd_xfer.c),
+  *          on a stub LL driver that records what it is asked to program
+  *          and completes transfers when the test says so.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_core.h"
+#include "usbd_xfer.h"
+#include "test_common.h"
+
+/* Private define ------------------------------------------------------------*/
+
+#define EP_IN               0x81U
+#define EP_OUT              0x01U
+#define MPS                 64U
+
+#define LOG_DEPTH           16U
+
+/* Private variables ---------------------------------------------------------*/
+
+static USBD_HandleTypeDef dev;
+static uint8_t buf[4][256];
+
+/* What the LL driver was asked to program, in order */
+static struct
+{
+  uint8_t ep_addr;
+  uint8_t *pbuf;
+  uint32_t length;
+} ll_log[LOG_DEPTH];
+static uint32_t ll_count;
+static uint32_t ll_fail;        /* number of next requests the LL refuses */
+static uint32_t rx_size;
+
+/* What the completion callbacks saw, in order */
+static struct
+{
+  USBD_XferTypeDef *xfer;
+  uint8_t classId;
+  uint8_t status;
+  uint32_t xfer_count;
+  uint32_t ll_count;            /* LL requests made before the callback */
+  uint8_t next_state;           /* state of the other descriptor of the test */
+} cb_log[LOG_DEPTH];
+static uint32_t cb_count;
+static USBD_XferTypeDef *cb_peer;
+
+/* Private functions ---------------------------------------------------------*/
+
+static USBD_StatusTypeDef LL_Record(uint8_t ep_addr, uint8_t *pbuf, uint32_t length)
+{
+  if (ll_fail != 0U)
+  {
+    ll_fail--;
+    return USBD_FAIL;
+  }
+
+  ll_log[ll_count % LOG_DEPTH].ep_addr = ep_addr;
+  ll_log[ll_count % LOG_DEPTH].pbuf = pbuf;
+  ll_log[ll_count % LOG_DEPTH].length = length;
+  ll_count++;
+
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_Transmit(USBD_HandleTypeDef *pdev, uint8_t ep_addr,
+                                    uint8_t *pbuf, uint32_t size)
+{
+  return LL_Record(ep_addr, pbuf, size);
+}
+
+USBD_StatusTypeDef USBD_LL_TransmitV(USBD_HandleTypeDef *pdev, uint8_t ep_addr,
+                                     USBD_SegmentTypeDef *pSeg, uint8_t nseg)
+{
+  uint32_t length = 0U;
+
+  for (uint8_t i = 0U; i < nseg; i++)
+  {
+    length += pSeg[i].length;
+  }
+
+  return LL_Record(ep_addr, pSeg[0].pbuf, length);
+}
+
+USBD_StatusTypeDef USBD_LL_PrepareReceive(USBD_HandleTypeDef *pdev, uint8_t ep_addr,
+                                          uint8_t *pbuf, uint32_t size)
+{
+  return LL_Record(ep_addr, pbuf, size);
+}
+
+uint32_t USBD_LL_GetRxDataSize(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  return rx_size;
+}
+
+static void Xfer_Cplt(USBD_HandleTypeDef *pdev, USBD_XferTypeDef *xfer)
+{
+  cb_log[cb_count % LOG_DEPTH].xfer = xfer;
+  cb_log[cb_count % LOG_DEPTH].classId = pdev->classId;
+  cb_log[cb_count % LOG_DEPTH].status = xfer->status;
+  cb_log[cb_count % LOG_DEPTH].xfer_count = xfer->xfer_count;
+  cb_log[cb_count % LOG_DEPTH].ll_count = ll_count;
+  cb_log[cb_count % LOG_DEPTH].next_state = (cb_peer != NULL) ? cb_peer->state : 0xFFU;
+  cb_count++;
+
+  /* Idle again, so the owner may resubmit it from here */
+  TEST_CHECK(xfer->state == USBD_XFER_STATE_IDLE);
+}
+
+static void Reset(USBD_XferTypeDef *pxfer, uint8_t count)
+{
+  memset(&dev, 0, sizeof(dev));
+  dev.ep_in[EP_IN & 0xFU].maxpacket = MPS;
+  dev.ep_out[EP_OUT & 0xFU].maxpacket = MPS;
+  memset(pxfer, 0, count * sizeof(*pxfer));
+  ll_count = 0U;
+  ll_fail = 0U;
+  cb_count = 0U;
+  cb_peer = NULL;
+}
+
+static void Xfer_Setup(USBD_XferTypeDef *xfer, uint8_t ep_addr, uint8_t *pbuf,
+                       uint32_t length, uint8_t flags)
+{
+  xfer->ep_addr = ep_addr;
+  xfer->pbuf = pbuf;
+  xfer->length = length;
+  xfer->flags = flags;
+  xfer->Cplt = Xfer_Cplt;
+}
+
+/* A ZLP follows only an exact multiple of the packet size, and only when
+   asked for */
+static void Test_Zlp(void)
+{
+  static const struct
+  {
+    uint32_t length;
+    uint8_t flags;
+    uint8_t zlp;
+  } cases[] =
+  {
+    { 128U, USBD_XFER_FLAG_ZLP,  1U },
+    { MPS,  USBD_XFER_FLAG_ZLP,  1U },
+    { 100U, USBD_XFER_FLAG_ZLP,  0U },
+    { 128U, USBD_XFER_FLAG_NONE, 0U },
+    { 0U,   USBD_XFER_FLAG_ZLP,  0U },
+  };
+  USBD_XferTypeDef xfer;
+
+  for (uint32_t i = 0U; i < (sizeof(cases) / sizeof(cases[0])); i++)
+  {
+    Reset(&xfer, 1U);
+    Xfer_Setup(&xfer, EP_IN, buf[0], cases[i].length, cases[i].flags);
+
+    TEST_CHECK(USBD_Xfer_Submit(&dev, &xfer) == USBD_OK);
+    TEST_CHECK((ll_count == 1U) && (ll_log[0].length == cases[i].length));
+    TEST_CHECK(dev.ep_in[EP_IN & 0xFU].total_length == cases[i].length);
+
+    TEST_CHECK(USBD_Xfer_DataInStage(&dev, EP_IN & 0xFU) == USBD_OK);
+
+    if (cases[i].zlp != 0U)
+    {
+      TEST_CHECK((ll_count == 2U) && (ll_log[1].pbuf == NULL) && (ll_log[1].length == 0U));
+      TEST_CHECK((xfer.state == USBD_XFER_STATE_ZLP) && (cb_count == 0U));
+      TEST_CHECK(USBD_Xfer_DataInStage(&dev, EP_IN & 0xFU) == USBD_OK);
+    }
+
+    TEST_CHECK((ll_count == (1U + cases[i].zlp)) && (cb_count == 1U));
+    TEST_CHECK(cb_log[0].xfer_count == cases[i].length);
+    TEST_CHECK(USBD_Xfer_IsIdle(&dev, EP_IN) == 1U);
+  }
+
+  /* A ZLP the LL refuses still completes the transfer, the data went out */
+  Reset(&xfer, 1U);
+  Xfer_Setup(&xfer, EP_IN, buf[0], 128U, USBD_XFER_FLAG_ZLP);
+  TEST_CHECK(USBD_Xfer_Submit(&dev, &xfer) == USBD_OK);
+  ll_fail = 1U;
+  TEST_CHECK(USBD_Xfer_DataInStage(&dev, EP_IN & 0xFU) == USBD_OK);
+  TEST_CHECK((cb_count == 1U) && (cb_log[0].xfer_count == 128U));
+  TEST_CHECK(USBD_Xfer_IsIdle(&dev, EP_IN) == 1U);
+}
+
+/* The next transfer is programmed from the completion, before the owner of
+   the finished one is told, and each callback runs as its submitter */
+static void Test_Chain(void)
+{
+  USBD_XferTypeDef xfer[2];
+  USBD_SegmentTypeDef seg[2] =
+  {
+    { buf[1], 10U },
+    { buf[2], 20U },
+  };
+
+  Reset(xfer, 2U);
+  Xfer_Setup(&xfer[0], EP_IN, buf[0], 32U, USBD_XFER_FLAG_NONE);
+  Xfer_Setup(&xfer[1], EP_IN, NULL, 0U, USBD_XFER_FLAG_NONE);
+  xfer[1].pSeg = seg;
+  xfer[1].nseg = 2U;
+  cb_peer = &xfer[1];
+
+  dev.classId = 3U;
+  TEST_CHECK(USBD_Xfer_Submit(&dev, &xfer[0]) == USBD_OK);
+  dev.classId = 5U;
+  TEST_CHECK(USBD_Xfer_Submit(&dev, &xfer[1]) == USBD_OK);
+
+  TEST_CHECK((ll_count == 1U) && (ll_log[0].pbuf == buf[0]));
+  TEST_CHECK((xfer[0].state == USBD_XFER_STATE_ACTIVE) && (xfer[1].state == USBD_XFER_STATE_QUEUED));
+  TEST_CHECK(xfer[1].length == 30U);
+  TEST_CHECK(USBD_Xfer_IsIdle(&dev, EP_IN) == 0U);
+
+  dev.classId = 0U;
+  TEST_CHECK(USBD_Xfer_DataInStage(&dev, EP_IN & 0xFU) == USBD_OK);
+
+  TEST_CHECK(cb_count == 1U);
+  TEST_CHECK((cb_log[0].xfer == &xfer[0]) && (cb_log[0].classId == 3U));
+  TEST_CHECK((cb_log[0].ll_count == 2U) && (cb_log[0].next_state == USBD_XFER_STATE_ACTIVE));
+  TEST_CHECK((ll_log[1].pbuf == buf[1]) && (ll_log[1].length == 30U));
+  TEST_CHECK(dev.ep_in[EP_IN & 0xFU].total_length == 30U);
+  TEST_CHECK(dev.classId == 0U);
+
+  TEST_CHECK(USBD_Xfer_DataInStage(&dev, EP_IN & 0xFU) == USBD_OK);
+  TEST_CHECK((cb_count == 2U) && (cb_log[1].xfer == &xfer[1]) && (cb_log[1].classId == 5U));
+  TEST_CHECK(cb_log[1].xfer_count == 30U);
+  TEST_CHECK((dev.classId == 0U) && (USBD_Xfer_IsIdle(&dev, EP_IN) == 1U));
+
+  /* Nothing queued, the completion is not for the queue */
+  TEST_CHECK(USBD_Xfer_DataInStage(&dev, EP_IN & 0xFU) == USBD_FAIL);
+
+  /* OUT: the count is what the LL received */
+  Reset(xfer, 2U);
+  Xfer_Setup(&xfer[0], EP_OUT, buf[0], 256U, USBD_XFER_FLAG_NONE);
+  TEST_CHECK(USBD_Xfer_Submit(&dev, &xfer[0]) == USBD_OK);
+  TEST_CHECK((ll_count == 1U) && (ll_log[0].ep_addr == EP_OUT) && (ll_log[0].length == 256U));
+  rx_size = 17U;
+  TEST_CHECK(USBD_Xfer_DataOutStage(&dev, EP_OUT) == USBD_OK);
+  TEST_CHECK((cb_count == 1U) && (cb_log[0].xfer_count == 17U) && (cb_log[0].status == USBD_OK));
+}
+
+/* Flush hands the descriptors back idle, without callbacks */
+static void Test_Flush(void)
+{
+  USBD_XferTypeDef xfer[3];
+
+  Reset(xfer, 3U);
+
+  for (uint8_t i = 0U; i < 3U; i++)
+  {
+    Xfer_Setup(&xfer[i], EP_OUT, buf[i], 64U, USBD_XFER_FLAG_NONE);
+    TEST_CHECK(USBD_Xfer_Submit(&dev, &xfer[i]) == USBD_OK);
+  }
+
+  /* Already queued, not submitted twice */
+  TEST_CHECK(USBD_Xfer_Submit(&dev, &xfer[1]) == USBD_BUSY);
+  TEST_CHECK(USBD_Xfer_Alloc(xfer, 3U) == NULL);
+
+  TEST_CHECK(USBD_Xfer_Flush(&dev, EP_OUT) == USBD_OK);
+  TEST_CHECK(USBD_Xfer_IsIdle(&dev, EP_OUT) == 1U);
+  TEST_CHECK(dev.ep_out[EP_OUT & 0xFU].xfer_tail == NULL);
+  TEST_CHECK(cb_count == 0U);
+
+  for (uint8_t i = 0U; i < 3U; i++)
+  {
+    TEST_CHECK((xfer[i].state == USBD_XFER_STATE_IDLE) && (xfer[i].next == NULL));
+  }
+
+  TEST_CHECK(USBD_Xfer_Alloc(xfer, 3U) == &xfer[0]);
+  TEST_CHECK(xfer[0].state == USBD_XFER_STATE_RESERVED);
+  TEST_CHECK(USBD_Xfer_Submit(&dev, &xfer[0]) == USBD_OK);
+  TEST_CHECK(USBD_Xfer_DataOutStage(&dev, EP_OUT) == USBD_OK);
+  TEST_CHECK(cb_count == 1U);
+}
+
+/* A transfer the LL refuses to start does not stay queued */
+static void Test_StartFail(void)
+{
+  USBD_XferTypeDef xfer[4];
+
+  /* Submit: the error comes back, the descriptor is free again */
+  Reset(xfer, 4U);
+  Xfer_Setup(&xfer[0], EP_IN, buf[0], 16U, USBD_XFER_FLAG_NONE);
+  ll_fail = 1U;
+  TEST_CHECK(USBD_Xfer_Submit(&dev, &xfer[0]) == USBD_FAIL);
+  TEST_CHECK((xfer[0].state == USBD_XFER_STATE_IDLE) && (cb_count == 0U));
+  TEST_CHECK(USBD_Xfer_IsIdle(&dev, EP_IN) == 1U);
+  TEST_CHECK(dev.ep_in[EP_IN & 0xFU].xfer_tail == NULL);
+  TEST_CHECK(USBD_Xfer_Submit(&dev, &xfer[0]) == USBD_OK);
+  TEST_CHECK(USBD_Xfer_DataInStage(&dev, EP_IN & 0xFU) == USBD_OK);
+  TEST_CHECK((cb_count == 1U) && (cb_log[0].status == USBD_OK));
+
+  /* Complete: the queued ones that fail to start are retired through their
+     callback, in order, after the one that completed */
+  Reset(xfer, 4U);
+
+  for (uint8_t i = 0U; i < 4U; i++)
+  {
+    Xfer_Setup(&xfer[i], EP_IN, buf[i], 16U, USBD_XFER_FLAG_NONE);
+    TEST_CHECK(USBD_Xfer_Submit(&dev, &xfer[i]) == USBD_OK);
+  }
+
+  ll_fail = 2U;
+  TEST_CHECK(USBD_Xfer_DataInStage(&dev, EP_IN & 0xFU) == USBD_OK);
+
+  TEST_CHECK(cb_count == 3U);
+  TEST_CHECK((cb_log[0].xfer == &xfer[0]) && (cb_log[0].status == USBD_OK) && (cb_log[0].xfer_count == 16U));
+  TEST_CHECK((cb_log[1].xfer == &xfer[1]) && (cb_log[1].status == USBD_FAIL) && (cb_log[1].xfer_count == 0U));
+  TEST_CHECK((cb_log[2].xfer == &xfer[2]) && (cb_log[2].status == USBD_FAIL) && (cb_log[2].xfer_count == 0U));
+  TEST_CHECK((xfer[3].state == USBD_XFER_STATE_ACTIVE) && (ll_log[ll_count - 1U].pbuf == buf[3]));
+  TEST_CHECK(dev.ep_in[EP_IN & 0xFU].xfer_head == &xfer[3]);
+
+  /* Every one behind it fails: the queue ends empty */
+  TEST_CHECK(USBD_Xfer_Submit(&dev, &xfer[1]) == USBD_OK);
+  ll_fail = 1U;
+  TEST_CHECK(USBD_Xfer_DataInStage(&dev, EP_IN & 0xFU) == USBD_OK);
+  TEST_CHECK((cb_count == 5U) && (cb_log[4].xfer == &xfer[1]) && (cb_log[4].status == USBD_FAIL));
+  TEST_CHECK(USBD_Xfer_IsIdle(&dev, EP_IN) == 1U);
+  TEST_CHECK(dev.ep_in[EP_IN & 0xFU].xfer_tail == NULL);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main(void)
+{
+  Test_Zlp();
+  Test_Chain();
+  Test_Flush();
+  Test_StartFail();
+
+  return Test_Done("test_usbd_xfer");
+}
+
+/********************************** END OF FILE *******************************/
@@ -0,0 +1,82 @@
+/**
+  ******************************************************************************
+  * @file    usbd_conf.h
+  * @brief   Library configuration of the host tests, in place of
+  *          Target/usbd_conf.h. A test sets its knobs on the command line.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2021 alambe94.
+  * All rights reserved.
+  *
+  * This software is licensed under the MIT License that can be found in the
+  * LICENSE.txt file in the root directory of this repository.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CONF__H__
+#define __USBD_CONF__H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+
+#define USBD_MAX_NUM_INTERFACES           15U
+#define USBD_MAX_NUM_CONFIGURATION        1U
+#define USBD_MAX_STR_DESC_SIZ             512U
+#define USBD_SUPPORT_USER_STRING_DESC     1U
+#define USBD_DEBUG_LEVEL                  0U
+#define USBD_SELF_POWERED                 1U
+#define USBD_MAX_CLASS_NUM                16U
+#define USBD_MAX_EP_NUM                   9U
+
+#define DEVICE_FS                         0
+#define DEVICE_HS                         1
+
+/* Exported macro ------------------------------------------------------------*/
+
+#define __IO                              volatile
+#define __STATIC_INLINE                   static inline
+#define __ALIGN_BEGIN
+#define __ALIGN_END                       __attribute__((aligned(4U)))
+#define __ALIGNED(x)                      __attribute__((aligned(x)))
+
+#ifndef UNUSED
+#define UNUSED(x)                         ((void)(x))
+#endif
+
+#define USBD_malloc                       malloc
+#define USBD_free                         free
+#define USBD_memset                       memset
+#define USBD_memcpy                       memcpy
+#define USBD_Delay(ms)                    ((void)(ms))
+
+/* The interrupt context of a test is a thread, a critical section takes the
+   lock every such thread runs under */
+void Test_Lock(void);
+void Test_Unlock(void);
+
+#define USBD_ENTER_CRITICAL(primask)      do { (primask) = 0U; Test_Lock(); } while (0)
+#define USBD_EXIT_CRITICAL(primask)       do { (void)(primask); Test_Unlock(); } while (0)
+
+#define USBD_UsrLog(...)
+#define USBD_ErrLog(...)
+#define USBD_DbgLog(...)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_CONF__H__ */
+
+/********************************** END OF FILE *******************************/
@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+"""Drive the benchmark personality of App/usbd_cdc_bench.c.
+
+Each run toggles DTR, sends the command block of the mode, moves data for
+the given time, then toggles DTR again and asks the device for its
+counters. Needs pyserial.
+
+  usbd_cdc_bench.py /dev/ttyACM0 sink [seconds]
+  usbd_cdc_bench.py /dev/ttyACM0 source [seconds]
+  usbd_cdc_bench.py /dev/ttyACM0 echo [seconds] [record size]
+  usbd_cdc_bench.py /dev/ttyACM0 roundtrip [seconds]
+"""
+
+import struct
+import sys
+import threading
+import time
+
+import serial
+
+CMD_MAGIC = 0x434E4542
+STATS_MAGIC = b'BSTA'
+MODES = {'sink': 1, 'source': 2, 'echo': 3, 'roundtrip': 4}
+STATS = 5
+FIELDS = ('mode', 'tick_freq', 'rx_bytes', 'tx_bytes', 'elapsed_us', 'records',
+          'gaps', 'errors', 'stalls', 'lat_min', 'lat_max', 'lat_sum')
+PATTERN = bytes(range(256)) * 64
+
+
+def command(port, cmd, arg0=0, arg1=0):
+    """Start a new session and send a command block."""
+    port.dtr = False
+    time.sleep(0.05)
+    port.dtr = True
+    time.sleep(0.05)
+    port.reset_input_buffer()
+    port.write(struct.pack('<IB3xII', CMD_MAGIC, cmd, arg0, arg1))
+
+
+def read_stats(port):
+    """Ask for the counters of the last mode, skipping data still in flight."""
+    command(port, STATS)
+    data = b''
+    deadline = time.monotonic() + 2.0
+
+    while time.monotonic() < deadline:
+        data += port.read(port.in_waiting or 1)
+        start = data.find(STATS_MAGIC)
+        if start >= 0 and len(data) >= start + 4 + 4 * len(FIELDS):
+            values = struct.unpack_from('<%dI' % len(FIELDS), data, start + 4)
+            return dict(zip(FIELDS, values))
+
+    sys.exit('no answer to STATS, is the channel attached to the benchmark?')
+
+
+def sink(port, seconds):
+    end = time.monotonic() + seconds
+    sent = 0
+    while time.monotonic() < end:
+        sent += port.write(PATTERN)
+    port.flush()
+    return {'sent': sent}
+
+
+def source(port, seconds):
+    end = time.monotonic() + seconds
+    expect = 0
+    received = 0
+    errors = 0
+    while time.monotonic() < end:
+        data = port.read(port.in_waiting or 1)
+        for b in data:
+            if b != expect:
+                errors += 1
+                expect = b
+            expect = (expect + 1) & 0xFF
+        received += len(data)
+    return {'received': received, 'pattern_errors': errors}
+
+
+def echo(port, seconds, size):
+    size = max(size, 4)
+    pad = bytes(size - 4)
+    state = {'sent': 0, 'stop': False}
+
+    def writer():
+        seq = 0
+        while not state['stop']:
+            block = b''.join(struct.pack('<I', seq + i) + pad for i in range(max(4096 // size, 1)))
+            seq += max(4096 // size, 1)
+            state['sent'] += port.write(block)
+
+    thread = threading.Thread(target=writer, daemon=True)
+    thread.start()
+
+    end = time.monotonic() + seconds
+    data = b''
+    received = 0
+    expect = 0
+    errors = 0
+    while time.monotonic() < end:
+        data += port.read(port.in_waiting or 1)
+        while len(data) >= size:
+            seq, = struct.unpack_from('<I', data)
+            if seq != expect:
+                errors += 1
+            expect = seq + 1
+            data = data[size:]
+            received += size
+
+    state['stop'] = True
+    thread.join()
+    return {'sent': state['sent'], 'received': received, 'sequence_errors': errors}
+
+
+def roundtrip(port, seconds):
+    end = time.monotonic() + seconds
+    rtt = []
+    seq = 0
+    while time.monotonic() < end:
+        t0 = time.perf_counter_ns()
+        port.write(struct.pack('<IIII', seq, t0 & 0xFFFFFFFF, 0, 0))
+        reply = port.read(16)
+        t1 = time.perf_counter_ns()
+        if len(reply) != 16 or struct.unpack_from('<I', reply)[0] != seq:
+            sys.exit('round trip record %d lost' % seq)
+        rtt.append((t1 - t0) / 1000.0)
+        seq += 1
+    rtt.sort()
+    if not rtt:
+        return {}
+    return {'records': len(rtt), 'rtt_min_us': rtt[0],
+            'rtt_median_us': rtt[len(rtt) // 2],
+            'rtt_p99_us': rtt[min(len(rtt) - 1, len(rtt) * 99 // 100)],
+            'rtt_max_us': rtt[-1]}
+
+
+def main():
+    if len(sys.argv) < 3 or sys.argv[2] not in MODES:
+        sys.exit(__doc__)
+
+    mode = sys.argv[2]
+    seconds = float(sys.argv[3]) if len(sys.argv) > 3 else 5.0
+    size = int(sys.argv[4]) if len(sys.argv) > 4 else 64
+
+    port = serial.Serial(sys.argv[1], timeout=1.0)
+    command(port, MODES[mode], size if mode == 'echo' else 0)
+
+    if mode == 'sink':
+        host = sink(port, seconds)
+    elif mode == 'source':
+        host = source(port, seconds)
+    elif mode == 'echo':
+        host = echo(port, seconds, size)
+    else:
+        host = roundtrip(port, seconds)
+
+    dev = read_stats(port)
+    port.close()
+
+    for key, value in host.items():
+        print('host   %-16s %s' % (key, value))
+    for key in FIELDS[2:9]:
+        print('device %-16s %d' % (key, dev[key]))
+
+    moved = max(dev['rx_bytes'], dev['tx_bytes'])
+    if dev['elapsed_us']:
+        print('device %-16s %.2f MB/s' % ('throughput', moved / dev['elapsed_us']))
+    if dev['records'] and dev['lat_min'] != 0xFFFFFFFF and dev['tick_freq']:
+        us = 1e6 / dev['tick_freq']
+        print('device %-16s %.2f / %.2f / %.2f us (min / avg / max)' % (
+            'turnaround', dev['lat_min'] * us,
+            dev['lat_sum'] * us / dev['records'], dev['lat_max'] * us))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+"""Host side of the framed transport of App/usbd_cdc_frame.c.
+
+FramedLink sends and receives payloads over any object with read(n),
+write(data) and an in_waiting count, a pyserial port usually. Frames are
+COBS encoded bodies ended by a 0 byte; a body is a type byte, a 16-bit
+sequence number, the payload and the CRC-32 of what precedes it, little
+endian. Both sides run selective repeat with the window the peer announces
+in its ACK frames.
+
+Run against a device application that sends every payload back:
+
+  usbd_cdc_frame.py /dev/ttyACM0 [seconds] [payload size] [window]
+"""
+
+import collections
+import struct
+import sys
+import threading
+import time
+import zlib
+
+DATA = 0x01
+ACK = 0x02
+
+
+def cobs_encode(body):
+    out = bytearray()
+    for chunk in body.split(b'\0'):
+        # A chunk longer than 254 bytes is cut into full blocks, with no 0
+        while len(chunk) >= 254:
+            out += b'\xff' + chunk[:254]
+            chunk = chunk[254:]
+        out += bytes([len(chunk) + 1]) + chunk
+    return bytes(out) + b'\0'
+
+
+def cobs_decode(data):
+    """Decode a frame without its delimiter, None when malformed."""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def body(kind, seq, payload):
+    b = struct.pack('<BH', kind, seq & 0xFFFF) + payload
+    return b + struct.pack('<I', zlib.crc32(b))
+
+
+class FramedLink:
+    """Selective repeat over a byte stream, payloads delivered in order."""
+
+    def __init__(self, port, window=8, mtu=512, rto=0.05):
+        self.port = port
+        self.window = window
+        self.mtu = mtu
+        self.rto = rto
+        self.lock = threading.Condition()
+        self.write_lock = threading.Lock()
+        self.tx = {}                        # seq: [body, last send time, acked, fast]
+        self.tx_base = 0
+        self.tx_next = 0
+        self.peer_window = window
+        self.rx_next = 0
+        self.rx_held = {}
+        self.rx_queue = collections.deque()
+        self.stats = collections.Counter()
+        self.running = True
+
+        if hasattr(port, 'dtr'):
+            # A DTR change starts a new session on the device
+            port.dtr = False
+            time.sleep(0.05)
+            port.dtr = True
+            time.sleep(0.05)
+            port.reset_input_buffer()
+
+        self.reader = threading.Thread(target=self._read_loop, daemon=True)
+        self.reader.start()
+
+    def close(self):
+        self.running = False
+        self.reader.join()
+
+    def send(self, payload, timeout=None):
+        """Queue a payload, waiting for room in the window of the device."""
+        if len(payload) > self.mtu:
+            raise ValueError('payload larger than the MTU')
+        with self.lock:
+            if not self.lock.wait_for(lambda: (self.tx_next - self.tx_base) & 0xFFFF < self.peer_window,
+                                      timeout):
+                raise TimeoutError('window of the device stays full')
+            seq = self.tx_next
+            self.tx_next = (seq + 1) & 0xFFFF
+            frame = body(DATA, seq, payload)
+            self.tx[seq] = [frame, time.monotonic(), False, False]
+            self.stats['tx_frames'] += 1
+        self._write(cobs_encode(frame))
+
+    def recv(self, timeout=None):
+        """Return the next payload in order, None on timeout."""
+        with self.lock:
+            if not self.lock.wait_for(lambda: self.rx_queue, timeout):
+                return None
+            return self.rx_queue.popleft()
+
+    def _read_loop(self):
+        pending = bytearray()
+        while self.running:
+            data = self.port.read(self.port.in_waiting or 1)
+            ack = False
+            pending += data
+            while True:
+                end = pending.find(0)
+                if end < 0:
+                    break
+                frame, pending = bytes(pending[:end]), pending[end + 1:]
+                if frame:
+                    ack |= self._dispatch(frame)
+            if ack:
+                self._send_ack()
+            self._resend()
+
+    def _dispatch(self, frame):
+        b = cobs_decode(frame)
+        if b is None or len(b) < 7 or struct.unpack_from('<I', b, len(b) - 4)[0] != zlib.crc32(b[:-4]):
+            self.stats['rx_errors'] += 1
+            return False
+        kind, val = struct.unpack_from('<BH', b)
+        with self.lock:
+            if kind == DATA:
+                self._rx_data(val, b[3:-4])
+                self.lock.notify_all()
+                return True
+            if kind == ACK and len(b) == 12:
+                mask, window = struct.unpack_from('<IB', b, 3)
+                self._rx_ack(val, mask, window)
+                self.lock.notify_all()
+                return False
+        self.stats['rx_errors'] += 1
+        return False
+
+    def _rx_data(self, seq, payload):
+        dist = (seq - self.rx_next) & 0xFFFF
+        if dist == 0:
+            self.rx_queue.append(payload)
+            self.rx_next = (self.rx_next + 1) & 0xFFFF
+            while self.rx_next in self.rx_held:
+                self.rx_queue.append(self.rx_held.pop(self.rx_next))
+                self.rx_next = (self.rx_next + 1) & 0xFFFF
+        elif dist < self.window and seq not in self.rx_held:
+            self.rx_held[seq] = payload
+        else:
+            self.stats['rx_duplicates'] += 1
+
+    def _rx_ack(self, nxt, mask, window):
+        inflight = (self.tx_next - self.tx_base) & 0xFFFF
+        if (nxt - self.tx_base) & 0xFFFF > inflight:
+            return
+        while self.tx_base != nxt:
+            del self.tx[self.tx_base]
+            self.tx_base = (self.tx_base + 1) & 0xFFFF
+        self.peer_window = max(1, min(window, self.window))
+        held = min(mask.bit_length() + 1 if mask else 0, (self.tx_next - nxt) & 0xFFFF)
+        for n in range(held):
+            slot = self.tx[(nxt + n) & 0xFFFF]
+            if n and mask & (1 << (n - 1)):
+                slot[2] = True
+            elif not slot[2] and not slot[3]:
+                # A later frame arrived without this one
+                slot[1] = 0.0
+                slot[3] = True
+
+    def _send_ack(self):
+        with self.lock:
+            mask = 0
+            for seq in self.rx_held:
+                mask |= 1 << (((seq - self.rx_next) & 0xFFFF) - 1)
+            frame = body(ACK, self.rx_next, struct.pack('<IB', mask, self.window))
+        self._write(cobs_encode(frame))
+
+    def _resend(self):
+        now = time.monotonic()
+        out = []
+        with self.lock:
+            for seq in sorted(self.tx, key=lambda s: (s - self.tx_base) & 0xFFFF):
+                slot = self.tx[seq]
+                if not slot[2] and now - slot[1] >= self.rto:
+                    slot[1] = now
+                    out.append(slot[0])
+                    self.stats['tx_retries'] += 1
+        if out:
+            self._write(b''.join(cobs_encode(frame) for frame in out))
+
+    def _write(self, data):
+        # The reader thread and the senders share the port, frames stay whole
+        with self.write_lock:
+            self.port.write(data)
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit(__doc__)
+
+    import serial
+
+    seconds = float(sys.argv[2]) if len(sys.argv) > 2 else 5.0
+    size = int(sys.argv[3]) if len(sys.argv) > 3 else 256
+    window = int(sys.argv[4]) if len(sys.argv) > 4 else 8
+
+    port = serial.Serial(sys.argv[1], timeout=0.01)
+    link = FramedLink(port, window=window)
+    state = {'sent': 0}
+
+    def writer():
+        seq = 0
+        end = time.monotonic() + seconds
+        while time.monotonic() < end:
+            link.send(struct.pack('<I', seq) + bytes(size - 4))
+            seq += 1
+        state['sent'] = seq
+
+    start = time.monotonic()
+    thread = threading.Thread(target=writer, daemon=True)
+    thread.start()
+
+    got = 0
+    errors = 0
+    while thread.is_alive() or got < state['sent']:
+        payload = link.recv(timeout=1.0)
+        if payload is None:
+            if not thread.is_alive():
+                break
+            continue
+        if struct.unpack_from('<I', payload)[0] != got:
+            errors += 1
+        got += 1
+
+    elapsed = time.monotonic() - start
+    link.close()
+    port.close()
+
+    print('payloads  %d sent, %d back, %d out of order' % (state['sent'], got, errors))
+    print('echoed    %.2f MB/s each way' % (got * size / elapsed / 1e6))
+    for key, value in sorted(link.stats.items()):
+        print('%-9s %d' % (key, value))
+
+
+if __name__ == '__main__':
+    main()
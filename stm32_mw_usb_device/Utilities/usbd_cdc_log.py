@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Decode the binary log sent by App/usbd_cdc_log.c.
+
+The format strings are read from the .usbd_log_str section of the ELF file
+of each core, in the order of USBD_CDC_LOG_CORE. The stream is read from a
+capture file, or from the serial port with pyserial.
+
+  usbd_cdc_log.py /dev/ttyACM1 app_cm7.elf [app_cm4.elf]
+"""
+
+import os
+import re
+import struct
+import sys
+
+SECTION = '.usbd_log_str'
+CONVERSION = re.compile(r'%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l|z|j|t)?([diouxXcp%])')
+
+
+def read_strings(path):
+    """Return (address, bytes) of the format string section of an ELF32 file."""
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    if data[:4] != b'\x7fELF' or data[4] != 1:
+        sys.exit('%s: not an ELF32 file' % path)
+
+    end = '<' if data[5] == 1 else '>'
+    shoff, = struct.unpack_from(end + 'I', data, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from(end + 'HHH', data, 0x2E)
+    sections = [struct.unpack_from(end + '10I', data, shoff + i * shentsize) for i in range(shnum)]
+    names = sections[shstrndx][4]
+
+    for sh in sections:
+        start = names + sh[0]
+        if data[start:data.index(b'\0', start)].decode() == SECTION:
+            return sh[3], data[sh[4]:sh[4] + sh[5]]
+
+    sys.exit('%s: no %s section, was the image built with USBD_USE_CDC_LOG?' % (path, SECTION))
+
+
+def varints(body):
+    val, shift = 0, 0
+    for b in body:
+        val |= (b & 0x7F) << shift
+        shift += 7
+        if b < 0x80:
+            yield val
+            val, shift = 0, 0
+
+
+def read_varint(stream):
+    val, shift = 0, 0
+    while True:
+        b = stream.read(1)[0]
+        val |= (b & 0x7F) << shift
+        shift += 7
+        if b < 0x80:
+            return val
+
+
+def render(fmt, args):
+    args = list(args)
+
+    def one(m):
+        flags, conv = m.groups()
+        if conv == '%':
+            return '%'
+        if not args:
+            return '<missing>'
+        val = args.pop(0) & 0xFFFFFFFF
+        if conv in 'di':
+            return ('%' + flags + 'd') % (val - (1 << 32) if val & 0x80000000 else val)
+        if conv == 'c':
+            return ('%' + flags + 'c') % chr(val & 0xFF)
+        if conv == 'p':
+            return '0x%08x' % val
+        return ('%' + flags + conv) % val
+
+    text = CONVERSION.sub(one, fmt)
+    if args:
+        text += ' <%d extra argument(s)>' % len(args)
+    return text
+
+
+def decode(stream, tables, out=sys.stdout):
+    core = 0
+
+    while True:
+        hdr = stream.read(1)
+        if not hdr:
+            return
+
+        if hdr[0] == 0:
+            # Control record: core index, then the frames its ring dropped
+            core = stream.read(1)[0]
+            lost = read_varint(stream)
+            if lost:
+                out.write('[%d] *** %d message(s) lost\n' % (core, lost) if len(tables) > 1
+                          else '*** %d message(s) lost\n' % lost)
+            continue
+
+        body = stream.read(hdr[0])
+        values = list(varints(body))
+        base, strings = tables[core] if core < len(tables) else (0, b'')
+        off = values[0] - base
+
+        if 0 <= off < len(strings):
+            fmt = strings[off:strings.index(b'\0', off)].decode(errors='replace')
+            text = render(fmt, values[1:])
+        else:
+            text = '<unknown id 0x%08x> %s' % (values[0], values[1:])
+
+        out.write('[%d] %s\n' % (core, text) if len(tables) > 1 else text + '\n')
+        out.flush()
+
+
+def main():
+    if len(sys.argv) < 3:
+        sys.exit(__doc__)
+
+    tables = [read_strings(path) for path in sys.argv[2:]]
+
+    if os.path.isfile(sys.argv[1]):
+        stream = open(sys.argv[1], 'rb')
+    else:
+        import serial
+        stream = serial.Serial(sys.argv[1], timeout=None)
+
+    try:
+        decode(stream, tables)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == '__main__':
+    main()